@@ -4,6 +4,7 @@ use align_ext::AlignExt;
 use bitvec::array::BitArray;
 use int_to_c_enum::TryFromInt;
 use ostd::{
+    cpu_local_cell,
     mm::{
         DmaDirection, DmaStream, DmaStreamSlice, FrameAllocOptions, Infallible, USegment, VmIo,
         VmReader, VmWriter,
@@ -13,7 +14,7 @@ use ostd::{
 };
 use spin::Once;
 
-use super::{id::Sid, BlockDevice};
+use super::{id::Sid, mq::BioPlug, BlockDevice};
 use crate::{prelude::*, BLOCK_SIZE, SECTOR_SIZE};
 
 /// The unit for block I/O.
@@ -92,6 +93,7 @@ impl Bio {
         );
         assert!(result.is_ok());
 
+        trace_submitted_bio(&self.0);
         if let Err(e) = block_device.enqueue(SubmittedBio(self.0.clone())) {
             // Fail to submit, revert the status.
             let result = self.0.status.compare_exchange(
@@ -109,6 +111,34 @@ impl Bio {
         })
     }
 
+    /// Submits self to the block device of the `plug` asynchronously.
+    ///
+    /// The `Bio` is held in the `plug` until it is unplugged. If the `Bio`
+    /// fails to be enqueued then, it is completed with an I/O error.
+    ///
+    /// Returns a `BioWaiter` to the caller to wait for its completion.
+    ///
+    /// # Panics
+    ///
+    /// The caller must not submit a `Bio` more than once. Otherwise, a panic shall be triggered.
+    pub fn submit_plugged(&self, plug: &mut BioPlug) -> BioWaiter {
+        // Change the status from "Init" to "Submit".
+        let result = self.0.status.compare_exchange(
+            BioStatus::Init as u32,
+            BioStatus::Submit as u32,
+            Ordering::Release,
+            Ordering::Relaxed,
+        );
+        assert!(result.is_ok());
+
+        trace_submitted_bio(&self.0);
+        plug.add(SubmittedBio(self.0.clone()));
+
+        BioWaiter {
+            bios: vec![self.0.clone()],
+        }
+    }
+
     /// Submits self to the `block_device` and waits for the result synchronously.
     ///
     /// Returns the result status of the `Bio`.
@@ -266,6 +296,11 @@ impl SubmittedBio {
         self.0.status()
     }
 
+    /// Returns another handle to the same `SubmittedBio`.
+    pub(crate) fn dup(&self) -> Self {
+        Self(self.0.clone())
+    }
+
     /// Completes the `Bio` with the `status` and invokes the callback function.
     ///
     /// When the driver finishes the request for this `Bio`, it will call this method.
@@ -281,6 +316,9 @@ impl SubmittedBio {
         );
         assert!(result.is_ok());
 
+        account_completed_bio(self);
+        ostd::tracepoint!(BioComplete, Arc::as_ptr(&self.0), status);
+
         self.0.wait_queue.wake_all();
         if let Some(complete_fn) = self.0.complete_fn {
             complete_fn(self);
@@ -288,6 +326,58 @@ impl SubmittedBio {
     }
 }
 
+fn trace_submitted_bio(bio: &Arc<BioInner>) {
+    let sid_range = bio.sid_range();
+    ostd::tracepoint!(
+        BioSubmit,
+        Arc::as_ptr(bio),
+        bio.type_(),
+        sid_range.start.to_raw(),
+        sid_range.end.to_raw() - sid_range.start.to_raw(),
+    );
+}
+
+cpu_local_cell! {
+    /// The number of `Bio`s completed on the CPU.
+    static NR_COMPLETED_BIOS: u64 = 0;
+    /// The number of sectors read by the `Bio`s completed on the CPU.
+    static NR_READ_SECTORS: u64 = 0;
+    /// The number of sectors written by the `Bio`s completed on the CPU.
+    static NR_WRITTEN_SECTORS: u64 = 0;
+}
+
+fn account_completed_bio(bio: &SubmittedBio) {
+    NR_COMPLETED_BIOS.add_assign(1);
+
+    let sid_range = bio.sid_range();
+    let nr_sectors = sid_range.end.to_raw() - sid_range.start.to_raw();
+    match bio.type_() {
+        BioType::Read => NR_READ_SECTORS.add_assign(nr_sectors),
+        BioType::Write => NR_WRITTEN_SECTORS.add_assign(nr_sectors),
+        BioType::Flush | BioType::Discard => (),
+    }
+}
+
+/// The statistics of the `Bio`s completed since boot.
+#[derive(Clone, Copy, Debug, Default)]
+pub struct BioStats {
+    /// The number of the completed `Bio`s.
+    pub nr_completed: u64,
+    /// The number of the sectors read.
+    pub nr_read_sectors: u64,
+    /// The number of the sectors written.
+    pub nr_written_sectors: u64,
+}
+
+/// Returns the statistics of the `Bio`s completed since boot on all the devices.
+pub fn bio_stats() -> BioStats {
+    BioStats {
+        nr_completed: NR_COMPLETED_BIOS.sum(),
+        nr_read_sectors: NR_READ_SECTORS.sum(),
+        nr_written_sectors: NR_WRITTEN_SECTORS.sum(),
+    }
+}
+
 /// The common inner part of `Bio`.
 struct BioInner {
     /// The type of the I/O
@@ -14,7 +14,6 @@ use crate::{
 
 /// Implements several commonly used APIs for the block device to conveniently
 /// read and write block(s).
-// TODO: Add API to submit bio with multiple segments in scatter/gather manner.
 impl dyn BlockDevice {
     /// Synchronously reads contiguous blocks starting from the `bid`.
     pub fn read_blocks(
@@ -78,6 +77,57 @@ impl dyn BlockDevice {
         bio.submit(self)
     }
 
+    /// Asynchronously reads contiguous blocks starting from the `bid` into
+    /// multiple segments in the scatter/gather manner.
+    ///
+    /// The segments are split into multiple bios if there are more segments
+    /// than a bio of the device can hold.
+    pub fn read_blocks_vectored_async(
+        &self,
+        bid: Bid,
+        bio_segments: Vec<BioSegment>,
+    ) -> Result<BioWaiter, BioEnqueueError> {
+        self.submit_vectored(BioType::Read, bid, bio_segments)
+    }
+
+    /// Asynchronously writes contiguous blocks starting from the `bid` from
+    /// multiple segments in the scatter/gather manner.
+    ///
+    /// The segments are split into multiple bios if there are more segments
+    /// than a bio of the device can hold.
+    pub fn write_blocks_vectored_async(
+        &self,
+        bid: Bid,
+        bio_segments: Vec<BioSegment>,
+    ) -> Result<BioWaiter, BioEnqueueError> {
+        self.submit_vectored(BioType::Write, bid, bio_segments)
+    }
+
+    fn submit_vectored(
+        &self,
+        type_: BioType,
+        bid: Bid,
+        bio_segments: Vec<BioSegment>,
+    ) -> Result<BioWaiter, BioEnqueueError> {
+        // The bio queues reject the bios with as many segments as the limit.
+        let max_nr_segments = self
+            .metadata()
+            .max_nr_segments_per_bio
+            .saturating_sub(1)
+            .max(1);
+
+        let mut bio_waiter = BioWaiter::new();
+        let mut start_sid = Sid::from(bid);
+        let mut bio_segments = bio_segments.into_iter().peekable();
+        while bio_segments.peek().is_some() {
+            let segments = bio_segments.by_ref().take(max_nr_segments).collect();
+            let bio = Bio::new(type_, start_sid, segments, Some(general_complete_fn));
+            start_sid = bio.sid_range().end;
+            bio_waiter.concat(bio.submit(self)?);
+        }
+        Ok(bio_waiter)
+    }
+
     /// Issues a sync request
     pub fn sync(&self) -> Result<BioStatus, BioEnqueueError> {
         let bio = Bio::new(
@@ -9,7 +9,9 @@
 //! for a block device to maintain a queue to handle I/O requests. The users (e.g., fs)
 //! submit I/O requests to this queue and wait for their completion. Drivers implementing
 //! block devices can create their own queues as needed, with the possibility to reorder
-//! and merge requests within the queue.
+//! and merge requests within the queue. The `request_queue` module offers a simple FIFO
+//! queue, and the `mq` module offers a multi-queue layer with per-CPU staging queues and
+//! I/O schedulers.
 //!
 //! This crate also offers the `Bio` related data structures and APIs to accomplish
 //! safe and convenient block I/O operations, for example:
@@ -37,6 +39,7 @@ extern crate alloc;
 pub mod bio;
 pub mod id;
 mod impl_block_device;
+pub mod mq;
 mod prelude;
 pub mod request_queue;
 
@@ -45,7 +48,7 @@ use ostd::sync::SpinLock;
 use spin::Once;
 
 use self::{
-    bio::{BioEnqueueError, SubmittedBio},
+    bio::{BioEnqueueError, BioStatus, SubmittedBio},
     prelude::*,
 };
 
@@ -56,6 +59,21 @@ pub trait BlockDevice: Send + Sync + Any + Debug {
     /// Enqueues a new `SubmittedBio` to the block device.
     fn enqueue(&self, bio: SubmittedBio) -> Result<(), BioEnqueueError>;
 
+    /// Enqueues a batch of `SubmittedBio`s to the block device.
+    ///
+    /// The `SubmittedBio`s that fail to be enqueued are completed with an I/O
+    /// error. The block devices using [`BioRequestMultiQueue`] should override
+    /// this method to stage the batch at once.
+    ///
+    /// [`BioRequestMultiQueue`]: mq::BioRequestMultiQueue
+    fn enqueue_batch(&self, bios: Vec<SubmittedBio>) {
+        for bio in bios {
+            if self.enqueue(bio.dup()).is_err() {
+                bio.complete(BioStatus::IoError);
+            }
+        }
+    }
+
     /// Returns the metadata of the block device.
     fn metadata(&self) -> BlockDeviceMeta;
 }
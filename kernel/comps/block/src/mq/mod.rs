@@ -0,0 +1,440 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! The multi-queue block layer.
+//!
+//! Like the blk-mq of Linux, the requests go through two levels of queues:
+//!
+//! - The software staging queues, one for each CPU. A submitter only locks the
+//!   staging queue of its CPU, so that the submitters on different CPUs do not
+//!   contend with each other;
+//! - The hardware dispatch queues, one for each request queue of the device.
+//!   The staging queue of a CPU is mapped to one hardware queue, which moves
+//!   the staged requests into its I/O scheduler when the driver dispatches the
+//!   requests from it.
+//!
+//! The submitters can batch their bios with a [`BioPlug`], so that the bios
+//! are sorted and merged before they are staged.
+
+mod plug;
+mod scheduler;
+
+use alloc::boxed::Box;
+
+use ostd::{
+    cpu::num_cpus,
+    sync::{SpinLock, WaitQueue},
+};
+pub use plug::BioPlug;
+pub use scheduler::{DeadlineScheduler, IoScheduler, IoSchedulerType, NoneScheduler};
+
+use crate::{
+    bio::{BioEnqueueError, BioStatus, SubmittedBio},
+    prelude::*,
+    request_queue::BioRequest,
+};
+
+/// A block I/O request queue with per-CPU staging queues and hardware
+/// dispatch queues.
+///
+/// The producers (e.g., filesystems) submit requests to the queue, and the
+/// consumers (e.g., the block device driver) dispatch the requests from each
+/// hardware queue, typically one consumer per hardware queue.
+pub struct BioRequestMultiQueue {
+    staging_queues: Box<[SpinLock<VecDeque<BioRequest>>]>,
+    hw_queues: Box<[HwQueue]>,
+    max_nr_segments_per_bio: usize,
+}
+
+/// A hardware dispatch queue.
+struct HwQueue {
+    scheduler: SpinLock<Box<dyn IoScheduler>>,
+    /// The number of the requests in the mapped staging queues and the scheduler.
+    num_requests: AtomicUsize,
+    wait_queue: WaitQueue,
+}
+
+impl BioRequestMultiQueue {
+    /// Creates an empty queue using the I/O scheduler of `scheduler_type`.
+    ///
+    /// # Panics
+    ///
+    /// This method panics if `nr_hw_queues` is zero.
+    pub fn new(
+        nr_hw_queues: usize,
+        max_nr_segments_per_bio: usize,
+        scheduler_type: IoSchedulerType,
+    ) -> Self {
+        Self::with_scheduler(nr_hw_queues, max_nr_segments_per_bio, || {
+            scheduler_type.new_scheduler(max_nr_segments_per_bio)
+        })
+    }
+
+    /// Creates an empty queue using the I/O schedulers created by `new_scheduler`.
+    ///
+    /// # Panics
+    ///
+    /// This method panics if `nr_hw_queues` is zero.
+    pub fn with_scheduler(
+        nr_hw_queues: usize,
+        max_nr_segments_per_bio: usize,
+        new_scheduler: impl Fn() -> Box<dyn IoScheduler>,
+    ) -> Self {
+        assert!(nr_hw_queues > 0);
+
+        let staging_queues = (0..num_cpus())
+            .map(|_| SpinLock::new(VecDeque::new()))
+            .collect();
+        let hw_queues = (0..nr_hw_queues)
+            .map(|_| HwQueue {
+                scheduler: SpinLock::new(new_scheduler()),
+                num_requests: AtomicUsize::new(0),
+                wait_queue: WaitQueue::new(),
+            })
+            .collect();
+
+        Self {
+            staging_queues,
+            hw_queues,
+            max_nr_segments_per_bio,
+        }
+    }
+
+    /// Returns the upper limit for the number of segments per bio.
+    pub fn max_nr_segments_per_bio(&self) -> usize {
+        self.max_nr_segments_per_bio
+    }
+
+    /// Returns the number of hardware queues.
+    pub fn nr_hw_queues(&self) -> usize {
+        self.hw_queues.len()
+    }
+
+    /// Returns the number of requests currently in this queue.
+    pub fn num_requests(&self) -> usize {
+        self.hw_queues
+            .iter()
+            .map(|hw_queue| hw_queue.num_requests.load(Ordering::Relaxed))
+            .sum()
+    }
+
+    /// Enqueues a `SubmittedBio` to the staging queue of the current CPU.
+    ///
+    /// The `SubmittedBio` is merged into the last staged request if the type
+    /// is same and the sector range is contiguous.
+    ///
+    /// This method will wake up the waiter if a new `BioRequest` is enqueued.
+    pub fn enqueue(&self, bio: SubmittedBio) -> Result<(), BioEnqueueError> {
+        if bio.segments().len() >= self.max_nr_segments_per_bio {
+            return Err(BioEnqueueError::TooBig);
+        }
+
+        let cpu = ostd::cpu::current_cpu_racy().as_usize();
+        let hw_queue = self.hw_queue_of(cpu);
+        {
+            let mut staging_queue = self.staging_queues[cpu].lock();
+            if !self.stage_bio(&mut staging_queue, bio) {
+                return Ok(());
+            }
+            // Count the request before it can be moved by the dispatcher.
+            hw_queue.num_requests.fetch_add(1, Ordering::Relaxed);
+        }
+        hw_queue.wait_queue.wake_all();
+
+        Ok(())
+    }
+
+    /// Enqueues a batch of `SubmittedBio`s to the staging queue of the current CPU.
+    ///
+    /// The `SubmittedBio`s that are too big are completed with an I/O error.
+    pub fn enqueue_batch(&self, bios: Vec<SubmittedBio>) {
+        let cpu = ostd::cpu::current_cpu_racy().as_usize();
+        let hw_queue = self.hw_queue_of(cpu);
+        let mut nr_new_requests = 0;
+        let mut too_big_bios = Vec::new();
+        {
+            let mut staging_queue = self.staging_queues[cpu].lock();
+            for bio in bios {
+                if bio.segments().len() >= self.max_nr_segments_per_bio {
+                    too_big_bios.push(bio);
+                    continue;
+                }
+                if self.stage_bio(&mut staging_queue, bio) {
+                    nr_new_requests += 1;
+                }
+            }
+            hw_queue
+                .num_requests
+                .fetch_add(nr_new_requests, Ordering::Relaxed);
+        }
+        if nr_new_requests > 0 {
+            hw_queue.wait_queue.wake_all();
+        }
+
+        for bio in too_big_bios {
+            bio.complete(BioStatus::IoError);
+        }
+    }
+
+    /// Stages a `SubmittedBio`, returning whether a new request is created.
+    fn stage_bio(&self, staging_queue: &mut VecDeque<BioRequest>, bio: SubmittedBio) -> bool {
+        if let Some(request) = staging_queue.back_mut() {
+            if request.can_merge(&bio)
+                && request.num_segments() + bio.segments().len() <= self.max_nr_segments_per_bio
+            {
+                request.merge_bio(bio);
+                return false;
+            }
+        }
+
+        staging_queue.push_back(BioRequest::from(bio));
+        true
+    }
+
+    /// Returns the hardware queue to which the staging queue of `cpu` is mapped.
+    fn hw_queue_of(&self, cpu: usize) -> &HwQueue {
+        &self.hw_queues[cpu % self.hw_queues.len()]
+    }
+
+    /// Dequeues a `BioRequest` from the `hw_idx`-th hardware queue.
+    ///
+    /// This method will wait until one request can be retrieved.
+    ///
+    /// # Panics
+    ///
+    /// This method panics if `hw_idx` is out of bounds.
+    pub fn dequeue(&self, hw_idx: usize) -> BioRequest {
+        let hw_queue = &self.hw_queues[hw_idx];
+
+        loop {
+            if let Some(request) = self.try_dequeue(hw_idx) {
+                return request;
+            }
+
+            hw_queue
+                .wait_queue
+                .wait_until(|| (hw_queue.num_requests.load(Ordering::Relaxed) > 0).then_some(()));
+        }
+    }
+
+    /// Tries to dequeue a `BioRequest` from the `hw_idx`-th hardware queue
+    /// without waiting.
+    ///
+    /// # Panics
+    ///
+    /// This method panics if `hw_idx` is out of bounds.
+    pub fn try_dequeue(&self, hw_idx: usize) -> Option<BioRequest> {
+        let hw_queue = &self.hw_queues[hw_idx];
+        if hw_queue.num_requests.load(Ordering::Relaxed) == 0 {
+            return None;
+        }
+
+        let mut scheduler = hw_queue.scheduler.lock();
+
+        // Move the staged requests into the scheduler, which may merge them.
+        let old_len = scheduler.len();
+        let mut nr_staged = 0;
+        for cpu in (hw_idx..self.staging_queues.len()).step_by(self.hw_queues.len()) {
+            let staged = core::mem::take(&mut *self.staging_queues[cpu].lock());
+            nr_staged += staged.len();
+            for request in staged {
+                scheduler.insert(request);
+            }
+        }
+
+        // The scheduler may also merge the requests when dispatching (e.g.,
+        // when it releases the requests held back by a barrier), so the
+        // number of the removed requests is only known after dispatching.
+        let request = scheduler.dispatch();
+        let nr_removed = old_len + nr_staged - scheduler.len();
+        if nr_removed > 0 {
+            hw_queue
+                .num_requests
+                .fetch_sub(nr_removed, Ordering::Relaxed);
+        }
+
+        request
+    }
+}
+
+impl Debug for BioRequestMultiQueue {
+    fn fmt(&self, f: &mut core::fmt::Formatter) -> core::fmt::Result {
+        f.debug_struct("BioRequestMultiQueue")
+            .field("nr_hw_queues", &self.nr_hw_queues())
+            .field("num_requests", &self.num_requests())
+            .finish()
+    }
+}
+
+#[cfg(ktest)]
+mod test {
+    use core::time::Duration;
+
+    use ostd::{cpu::PinCurrentCpu, prelude::*, task::disable_preempt};
+
+    use super::*;
+    use crate::{
+        bio::{Bio, BioDirection, BioSegment, BioType},
+        id::{Bid, Sid},
+        BlockDevice, BlockDeviceMeta,
+    };
+
+    const MAX_NR_SEGMENTS: usize = 64;
+
+    #[derive(Debug)]
+    struct QueueDisk {
+        queue: BioRequestMultiQueue,
+    }
+
+    impl QueueDisk {
+        fn new(nr_hw_queues: usize, scheduler_type: IoSchedulerType) -> Self {
+            Self {
+                queue: BioRequestMultiQueue::new(nr_hw_queues, MAX_NR_SEGMENTS, scheduler_type),
+            }
+        }
+    }
+
+    impl BlockDevice for QueueDisk {
+        fn enqueue(&self, bio: SubmittedBio) -> core::result::Result<(), BioEnqueueError> {
+            self.queue.enqueue(bio)
+        }
+
+        fn enqueue_batch(&self, bios: Vec<SubmittedBio>) {
+            self.queue.enqueue_batch(bios);
+        }
+
+        fn metadata(&self) -> BlockDeviceMeta {
+            BlockDeviceMeta {
+                max_nr_segments_per_bio: MAX_NR_SEGMENTS,
+                nr_sectors: usize::MAX,
+            }
+        }
+    }
+
+    /// Creates a bio of one block at `bid`, or a flush bio.
+    fn new_bio(type_: BioType, bid: usize) -> Bio {
+        let segments = match type_ {
+            BioType::Read => vec![BioSegment::alloc(1, BioDirection::FromDevice)],
+            BioType::Write => vec![BioSegment::alloc(1, BioDirection::ToDevice)],
+            BioType::Flush | BioType::Discard => Vec::new(),
+        };
+        Bio::new(type_, Sid::from(Bid::new(bid as u64)), segments, None)
+    }
+
+    fn sid_range_of(bids: Range<usize>) -> Range<Sid> {
+        Sid::from(Bid::new(bids.start as u64))..Sid::from(Bid::new(bids.end as u64))
+    }
+
+    /// Creates the requests of one block at each of `bids`, which must not
+    /// be contiguous.
+    fn new_requests(type_: BioType, bids: &[usize]) -> Vec<BioRequest> {
+        let disk = QueueDisk::new(1, IoSchedulerType::None);
+        for bid in bids {
+            new_bio(type_, *bid).submit(&disk).unwrap();
+        }
+        core::iter::from_fn(|| disk.queue.try_dequeue(0)).collect()
+    }
+
+    #[ktest]
+    fn staging_queue_is_mapped_to_hw_queue() {
+        let disk = QueueDisk::new(2, IoSchedulerType::None);
+        let bio = new_bio(BioType::Read, 0);
+
+        let hw_idx = {
+            let preempt_guard = disable_preempt();
+            bio.submit(&disk).unwrap();
+            preempt_guard.current_cpu().as_usize() % 2
+        };
+
+        assert_eq!(disk.queue.num_requests(), 1);
+        assert!(disk.queue.try_dequeue(1 - hw_idx).is_none());
+        let request = disk.queue.try_dequeue(hw_idx).unwrap();
+        assert_eq!(request.sid_range(), &sid_range_of(0..1));
+        assert_eq!(disk.queue.num_requests(), 0);
+    }
+
+    #[ktest]
+    fn contiguous_bios_are_merged() {
+        let disk = QueueDisk::new(1, IoSchedulerType::Deadline);
+        let bios = [
+            new_bio(BioType::Write, 1),
+            new_bio(BioType::Write, 2),
+            new_bio(BioType::Read, 3),
+            new_bio(BioType::Write, 0),
+        ];
+        for bio in bios.iter() {
+            bio.submit(&disk).unwrap();
+        }
+        assert_eq!(disk.queue.num_requests(), 3);
+
+        // The bio at block 0 is not staged next to the other writes, but it
+        // is merged with them by the scheduler.
+        let read = disk.queue.try_dequeue(0).unwrap();
+        assert_eq!(read.type_(), BioType::Read);
+        let write = disk.queue.try_dequeue(0).unwrap();
+        assert_eq!(write.type_(), BioType::Write);
+        assert_eq!(write.sid_range(), &sid_range_of(0..3));
+        assert_eq!(write.bios().count(), 3);
+
+        assert!(disk.queue.try_dequeue(0).is_none());
+        assert_eq!(disk.queue.num_requests(), 0);
+    }
+
+    #[ktest]
+    fn requests_merged_after_barrier_are_counted() {
+        let disk = QueueDisk::new(1, IoSchedulerType::Deadline);
+
+        new_bio(BioType::Write, 0).submit(&disk).unwrap();
+        new_bio(BioType::Flush, 0).submit(&disk).unwrap();
+        let write = disk.queue.try_dequeue(0).unwrap();
+        assert_eq!(write.type_(), BioType::Write);
+
+        // The writes are held back by the flush, and are merged when the
+        // flush is dispatched.
+        new_bio(BioType::Write, 2).submit(&disk).unwrap();
+        new_bio(BioType::Read, 5).submit(&disk).unwrap();
+        new_bio(BioType::Write, 1).submit(&disk).unwrap();
+        assert_eq!(disk.queue.num_requests(), 4);
+        let flush = disk.queue.try_dequeue(0).unwrap();
+        assert_eq!(flush.type_(), BioType::Flush);
+        assert_eq!(disk.queue.num_requests(), 2);
+
+        let read = disk.queue.try_dequeue(0).unwrap();
+        assert_eq!(read.type_(), BioType::Read);
+        let write = disk.queue.try_dequeue(0).unwrap();
+        assert_eq!(write.sid_range(), &sid_range_of(1..3));
+        assert_eq!(disk.queue.num_requests(), 0);
+        assert!(disk.queue.try_dequeue(0).is_none());
+    }
+
+    #[ktest]
+    fn deadline_dispatches_in_sector_order() {
+        let mut scheduler = DeadlineScheduler::new(MAX_NR_SEGMENTS);
+        let mut requests = new_requests(BioType::Read, &[100, 0]).into_iter();
+        scheduler.insert_at(requests.next().unwrap(), Duration::ZERO);
+        scheduler.insert_at(requests.next().unwrap(), Duration::from_millis(100));
+
+        // No request has expired, so the lowest sector goes first.
+        let now = Duration::from_millis(200);
+        let request = scheduler.dispatch_at(now).unwrap();
+        assert_eq!(request.sid_range(), &sid_range_of(0..1));
+        let request = scheduler.dispatch_at(now).unwrap();
+        assert_eq!(request.sid_range(), &sid_range_of(100..101));
+        assert!(scheduler.dispatch_at(now).is_none());
+    }
+
+    #[ktest]
+    fn deadline_dispatches_expired_request_first() {
+        let mut scheduler = DeadlineScheduler::new(MAX_NR_SEGMENTS);
+        let mut requests = new_requests(BioType::Read, &[100, 0]).into_iter();
+        scheduler.insert_at(requests.next().unwrap(), Duration::ZERO);
+        scheduler.insert_at(requests.next().unwrap(), Duration::from_millis(100));
+
+        // The request at block 100 has expired, so it starts the batch.
+        let now = Duration::from_millis(550);
+        let request = scheduler.dispatch_at(now).unwrap();
+        assert_eq!(request.sid_range(), &sid_range_of(100..101));
+        let request = scheduler.dispatch_at(now).unwrap();
+        assert_eq!(request.sid_range(), &sid_range_of(0..1));
+        assert!(scheduler.dispatch_at(now).is_none());
+    }
+}
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use crate::{
+    bio::{BioType, SubmittedBio},
+    prelude::*,
+    BlockDevice,
+};
+
+/// The maximum number of bios held by a plug before it is unplugged.
+const MAX_NR_PLUGGED_BIOS: usize = 32;
+
+/// A plug that holds back the bios submitted to a block device.
+///
+/// The bios submitted with [`Bio::submit_plugged`] are held in the plug, and
+/// are enqueued to the device as a batch, sorted by their sectors, when the
+/// plug is unplugged or dropped, or when too many bios are held. This allows
+/// the device to merge the bios that are submitted out of order, and to stage
+/// them with a single lock acquisition.
+///
+/// [`Bio::submit_plugged`]: crate::bio::Bio::submit_plugged
+pub struct BioPlug<'a> {
+    device: &'a dyn BlockDevice,
+    bios: Vec<SubmittedBio>,
+}
+
+impl<'a> BioPlug<'a> {
+    /// Creates a plug for the `device`.
+    pub fn new(device: &'a dyn BlockDevice) -> Self {
+        Self {
+            device,
+            bios: Vec::new(),
+        }
+    }
+
+    /// Returns the block device of the plug.
+    pub fn device(&self) -> &'a dyn BlockDevice {
+        self.device
+    }
+
+    pub(crate) fn add(&mut self, bio: SubmittedBio) {
+        self.bios.push(bio);
+        if self.bios.len() >= MAX_NR_PLUGGED_BIOS {
+            self.unplug();
+        }
+    }
+
+    /// Enqueues the held bios to the device.
+    pub fn unplug(&mut self) {
+        if self.bios.is_empty() {
+            return;
+        }
+
+        let mut bios = core::mem::take(&mut self.bios);
+        // Sort the reads and writes between the other bios (e.g., flushes),
+        // which must not be reordered with them.
+        for run in bios.split_mut(|bio| !matches!(bio.type_(), BioType::Read | BioType::Write)) {
+            run.sort_by_key(|bio| bio.sid_range().start);
+        }
+        self.device.enqueue_batch(bios);
+    }
+}
+
+impl Drop for BioPlug<'_> {
+    fn drop(&mut self) {
+        self.unplug();
+    }
+}
+
+impl Debug for BioPlug<'_> {
+    fn fmt(&self, f: &mut core::fmt::Formatter) -> core::fmt::Result {
+        f.debug_struct("BioPlug")
+            .field("nr_bios", &self.bios.len())
+            .finish()
+    }
+}
@@ -0,0 +1,367 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! The I/O schedulers of the multi-queue block layer.
+
+use alloc::boxed::Box;
+use core::time::Duration;
+
+use ostd::timer::Jiffies;
+
+use crate::{bio::BioType, id::Sid, prelude::*, request_queue::BioRequest};
+
+/// An I/O scheduler, which decides the order of the requests dispatched to
+/// a hardware queue.
+///
+/// Schedulers may merge the inserted requests with the queued ones. The
+/// schedulers are not required to keep the order of the requests on
+/// overlapping sectors, except that the requests other than reads and writes
+/// (e.g., flushes) must not be reordered with any requests.
+pub trait IoScheduler: Send + Debug {
+    /// Inserts a request.
+    fn insert(&mut self, request: BioRequest);
+
+    /// Dispatches the next request.
+    fn dispatch(&mut self) -> Option<BioRequest>;
+
+    /// Returns the number of queued requests.
+    fn len(&self) -> usize;
+
+    /// Returns whether there are no queued requests.
+    fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+}
+
+/// The types of the I/O schedulers provided by this crate.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum IoSchedulerType {
+    /// Dispatches the requests in FIFO order.
+    ///
+    /// It suits the devices that do not benefit from sorting, or that
+    /// sort the requests themselves.
+    None,
+    /// Sorts the requests by their sectors, with deadlines to prevent
+    /// starvation, like the `mq-deadline` scheduler of Linux.
+    Deadline,
+}
+
+impl IoSchedulerType {
+    /// Creates a scheduler of the type.
+    pub fn new_scheduler(self, max_nr_segments_per_request: usize) -> Box<dyn IoScheduler> {
+        match self {
+            Self::None => Box::new(NoneScheduler::new(max_nr_segments_per_request)),
+            Self::Deadline => Box::new(DeadlineScheduler::new(max_nr_segments_per_request)),
+        }
+    }
+}
+
+/// A scheduler that dispatches the requests in FIFO order.
+///
+/// A new request is merged with the last one if they are contiguous.
+#[derive(Debug)]
+pub struct NoneScheduler {
+    queue: VecDeque<BioRequest>,
+    max_nr_segments_per_request: usize,
+}
+
+impl NoneScheduler {
+    /// Creates an empty scheduler.
+    pub fn new(max_nr_segments_per_request: usize) -> Self {
+        Self {
+            queue: VecDeque::new(),
+            max_nr_segments_per_request,
+        }
+    }
+}
+
+impl IoScheduler for NoneScheduler {
+    fn insert(&mut self, request: BioRequest) {
+        if let Some(last) = self.queue.back_mut() {
+            if can_merge(last, &request, self.max_nr_segments_per_request) {
+                last.merge_request(request);
+                return;
+            }
+        }
+        self.queue.push_back(request);
+    }
+
+    fn dispatch(&mut self) -> Option<BioRequest> {
+        self.queue.pop_front()
+    }
+
+    fn len(&self) -> usize {
+        self.queue.len()
+    }
+}
+
+/// The expiration time of reads.
+const READ_EXPIRE: Duration = Duration::from_millis(500);
+/// The expiration time of writes.
+const WRITE_EXPIRE: Duration = Duration::from_secs(5);
+/// The maximum number of requests dispatched in sector order in a batch.
+const FIFO_BATCH: usize = 16;
+/// The maximum number of read batches before a write batch.
+const WRITES_STARVED: usize = 2;
+
+const READ: usize = 0;
+const WRITE: usize = 1;
+
+/// A scheduler that sorts the requests by their sectors, with deadlines.
+///
+/// The reads and writes are sorted separately, and dispatched in batches
+/// in ascending sector order. A batch starts from the oldest request if it
+/// has expired. The reads are preferred over the writes, unless the writes
+/// have been starved for [`WRITES_STARVED`] batches.
+///
+/// The other requests (e.g., flushes) act as barriers: the requests before
+/// them are dispatched first, and the requests after them are held back until
+/// they are dispatched.
+#[derive(Debug)]
+pub struct DeadlineScheduler {
+    sorted: [SortedRequests; 2],
+    /// The barrier waiting for the sorted requests to be dispatched.
+    barrier: Option<BioRequest>,
+    /// The requests inserted after the barrier.
+    deferred: VecDeque<BioRequest>,
+    /// The direction of the current batch, and the number of requests in it.
+    batch: Option<(usize, usize)>,
+    nr_starved_writes: usize,
+    max_nr_segments_per_request: usize,
+}
+
+impl DeadlineScheduler {
+    /// Creates an empty scheduler.
+    pub fn new(max_nr_segments_per_request: usize) -> Self {
+        Self {
+            sorted: [
+                SortedRequests::new(READ_EXPIRE),
+                SortedRequests::new(WRITE_EXPIRE),
+            ],
+            barrier: None,
+            deferred: VecDeque::new(),
+            batch: None,
+            nr_starved_writes: 0,
+            max_nr_segments_per_request,
+        }
+    }
+
+    /// Inserts a request at the time `now`.
+    pub(super) fn insert_at(&mut self, request: BioRequest, now: Duration) {
+        if self.barrier.is_some() {
+            self.deferred.push_back(request);
+            return;
+        }
+
+        let dir = match request.type_() {
+            BioType::Read => READ,
+            BioType::Write => WRITE,
+            BioType::Flush | BioType::Discard => {
+                self.barrier = Some(request);
+                return;
+            }
+        };
+        self.sorted[dir].insert(request, now, self.max_nr_segments_per_request);
+    }
+
+    /// Dispatches the next request at the time `now`.
+    pub(super) fn dispatch_at(&mut self, now: Duration) -> Option<BioRequest> {
+        if let Some(request) = self.dispatch_sorted(now) {
+            return Some(request);
+        }
+
+        let barrier = self.barrier.take();
+        // Release the deferred requests, which may contain more barriers.
+        for request in core::mem::take(&mut self.deferred) {
+            self.insert_at(request, now);
+        }
+        barrier
+    }
+
+    fn dispatch_sorted(&mut self, now: Duration) -> Option<BioRequest> {
+        if let Some((dir, nr_batched)) = self.batch {
+            if nr_batched < FIFO_BATCH {
+                if let Some(request) = self.sorted[dir].pop_next() {
+                    self.batch = Some((dir, nr_batched + 1));
+                    return Some(request);
+                }
+            }
+        }
+
+        let has_reads = !self.sorted[READ].requests.is_empty();
+        let has_writes = !self.sorted[WRITE].requests.is_empty();
+        let dir = if has_reads && (!has_writes || self.nr_starved_writes < WRITES_STARVED) {
+            if has_writes {
+                self.nr_starved_writes += 1;
+            }
+            READ
+        } else if has_writes {
+            self.nr_starved_writes = 0;
+            WRITE
+        } else {
+            self.batch = None;
+            return None;
+        };
+
+        let request = self.sorted[dir].pop_batch_start(now);
+        self.batch = Some((dir, 1));
+        request
+    }
+}
+
+impl IoScheduler for DeadlineScheduler {
+    fn insert(&mut self, request: BioRequest) {
+        self.insert_at(request, Jiffies::elapsed().as_duration());
+    }
+
+    fn dispatch(&mut self) -> Option<BioRequest> {
+        self.dispatch_at(Jiffies::elapsed().as_duration())
+    }
+
+    fn len(&self) -> usize {
+        self.sorted[READ].requests.len()
+            + self.sorted[WRITE].requests.len()
+            + self.barrier.is_some() as usize
+            + self.deferred.len()
+    }
+}
+
+/// The requests of one direction, sorted by their sectors.
+#[derive(Debug)]
+struct SortedRequests {
+    /// The requests keyed by their start sectors and their sequence numbers,
+    /// which tell apart the requests starting at the same sector.
+    requests: BTreeMap<(Sid, u64), QueuedRequest>,
+    /// The keys of the requests in the order of their deadlines.
+    ///
+    /// The keys of the dispatched or merged requests are left in the FIFO,
+    /// and are skipped later.
+    fifo: VecDeque<(Duration, (Sid, u64))>,
+    /// The sector from which the next request in sector order is searched.
+    next_sid: Sid,
+    next_seq: u64,
+    expire: Duration,
+}
+
+#[derive(Debug)]
+struct QueuedRequest {
+    request: BioRequest,
+    deadline: Duration,
+}
+
+impl SortedRequests {
+    fn new(expire: Duration) -> Self {
+        Self {
+            requests: BTreeMap::new(),
+            fifo: VecDeque::new(),
+            next_sid: Sid::new(0),
+            next_seq: 0,
+            expire,
+        }
+    }
+
+    fn insert(&mut self, mut request: BioRequest, now: Duration, max_nr_segments: usize) {
+        let mut deadline = now + self.expire;
+        let start = request.sid_range().start;
+        let end = request.sid_range().end;
+
+        // Try to merge it at the back of the last request ending at `start`.
+        let prev_key = self
+            .requests
+            .range(..(start, 0))
+            .next_back()
+            .filter(|(_, prev)| can_merge(&prev.request, &request, max_nr_segments))
+            .map(|(key, _)| *key);
+        if let Some(prev_key) = prev_key {
+            let prev = self.requests.get_mut(&prev_key).unwrap();
+            prev.request.merge_request(request);
+            let new_end = prev.request.sid_range().end;
+
+            // The gap between the previous request and the next one may be filled.
+            let next_key = self.key_starting_at(new_end);
+            if let Some(next_key) = next_key {
+                let next = self.requests.get(&next_key).unwrap();
+                let prev = self.requests.get(&prev_key).unwrap();
+                if can_merge(&prev.request, &next.request, max_nr_segments) {
+                    let next = self.requests.remove(&next_key).unwrap();
+                    let prev = self.requests.get_mut(&prev_key).unwrap();
+                    prev.request.merge_request(next.request);
+                    prev.deadline = prev.deadline.min(next.deadline);
+                }
+            }
+            return;
+        }
+
+        // Try to merge it at the front of the first request starting at `end`.
+        if let Some(next_key) = self.key_starting_at(end) {
+            let next = self.requests.get(&next_key).unwrap();
+            if can_merge(&request, &next.request, max_nr_segments) {
+                let next = self.requests.remove(&next_key).unwrap();
+                request.merge_request(next.request);
+                deadline = deadline.min(next.deadline);
+            }
+        }
+
+        let key = (start, self.next_seq);
+        self.next_seq += 1;
+        self.requests
+            .insert(key, QueuedRequest { request, deadline });
+        // The deadline may be inherited from a merged request, so it is not
+        // necessarily the latest one. This only makes it checked late.
+        self.fifo.push_back((deadline, key));
+    }
+
+    fn key_starting_at(&self, sid: Sid) -> Option<(Sid, u64)> {
+        self.requests
+            .range((sid, 0)..=(sid, u64::MAX))
+            .next()
+            .map(|(key, _)| *key)
+    }
+
+    /// Dispatches the next request in sector order.
+    fn pop_next(&mut self) -> Option<BioRequest> {
+        let key = *self.requests.range((self.next_sid, 0)..).next()?.0;
+        Some(self.remove(key))
+    }
+
+    /// Dispatches the first request of a batch.
+    ///
+    /// It is the oldest request if it has expired, or the next request in
+    /// sector order, wrapping around to the lowest sector.
+    fn pop_batch_start(&mut self, now: Duration) -> Option<BioRequest> {
+        // Skip the keys of the requests that are dispatched or merged.
+        while let Some((_, key)) = self.fifo.front() {
+            if self.requests.contains_key(key) {
+                break;
+            }
+            self.fifo.pop_front();
+        }
+
+        let key = self
+            .fifo
+            .front()
+            .filter(|(deadline, _)| *deadline <= now)
+            .map(|(_, key)| *key)
+            .or_else(|| {
+                self.requests
+                    .range((self.next_sid, 0)..)
+                    .next()
+                    .map(|(key, _)| *key)
+            })
+            .or_else(|| self.requests.keys().next().copied())?;
+        Some(self.remove(key))
+    }
+
+    fn remove(&mut self, key: (Sid, u64)) -> BioRequest {
+        let queued = self.requests.remove(&key).unwrap();
+        self.next_sid = queued.request.sid_range().end;
+        if self.requests.is_empty() {
+            self.fifo.clear();
+        }
+        queued.request
+    }
+}
+
+fn can_merge(request: &BioRequest, other: &BioRequest, max_nr_segments: usize) -> bool {
+    request.can_merge_request(other)
+        && request.num_segments() + other.num_segments() <= max_nr_segments
+}
@@ -185,6 +185,37 @@ impl BioRequest {
             || rq_bio.sid_range().end == self.sid_range.start
     }
 
+    /// Returns `true` if can merge another request, `false` otherwise.
+    pub fn can_merge_request(&self, other: &BioRequest) -> bool {
+        if other.type_ != self.type_ {
+            return false;
+        }
+
+        other.sid_range.start == self.sid_range.end || other.sid_range.end == self.sid_range.start
+    }
+
+    /// Merges another request into this request.
+    ///
+    /// The `SubmittedBio`s of the merged request are placed at the front or back.
+    ///
+    /// # Panics
+    ///
+    /// If the request can not be merged, this method will panic.
+    pub fn merge_request(&mut self, mut other: BioRequest) {
+        assert!(self.can_merge_request(&other));
+
+        if other.sid_range.start == self.sid_range.end {
+            self.sid_range.end = other.sid_range.end;
+            self.bios.append(&mut other.bios);
+        } else {
+            self.sid_range.start = other.sid_range.start;
+            other.bios.append(&mut self.bios);
+            self.bios = other.bios;
+        }
+
+        self.num_segments += other.num_segments;
+    }
+
     /// Merges the `SubmittedBio` into this request.
     ///
     /// The merged `SubmittedBio` can only be placed at the front or back.
@@ -7,7 +7,7 @@ use ostd::const_assert;
 use ostd_pod::Pod;
 use serde::{Deserialize, Serialize};
 
-use super::{Iv, Key, Mac};
+use super::{crypto_pool::CryptoPool, Iv, Key, Mac};
 use crate::{
     layers::bio::{BlockId, BlockLog, Buf, BufMut, BufRef, BLOCK_SIZE},
     os::{Aead, HashMap, Mutex, RwLock},
@@ -388,11 +388,8 @@ impl<L: BlockLog> Mht<L> {
         // Search down to the leaves, ready to collect data nodes
         if MhtNode::is_lowest_level(curr_height) {
             debug_assert_eq!(num_data_nodes, nodes_needed);
-            for entry in target_entries {
-                self.storage
-                    .read_data_node(entry, search_ctx.node_buf(search_ctx.offset))?;
-                search_ctx.offset += 1;
-            }
+            let target_entries: Vec<MhtNodeEntry> = target_entries.copied().collect();
+            self.storage.read_data_nodes(&target_entries, search_ctx)?;
             search_ctx.is_completed = true;
             return Ok(());
         }
@@ -514,20 +511,35 @@ impl<L: BlockLog> MhtStorage<L> {
             return Ok(node_entries);
         }
 
-        let mut cipher_buf = Buf::alloc(num_append)?;
-        let mut pos = self.block_log.nblocks() as BlockId;
-        let start_pos = pos;
-        for (i, node) in nodes.iter().enumerate() {
-            let cipher = &mut cipher_buf.as_mut_slice()[i * BLOCK_SIZE..(i + 1) * BLOCK_SIZE];
-            let key = Key::random();
-            let mac = Aead::new().encrypt(&node.0, &key, &Iv::new_zeroed(), &[], cipher)?;
+        // Encrypt the nodes in batches on the crypto pool. The batches are
+        // appended in order as soon as each of them is encrypted, so the
+        // encryption of the later batches overlaps with the I/O of the earlier.
+        let crypto_pool = CryptoPool::get();
+        let tickets: Vec<_> = nodes
+            .chunks(CryptoPool::BLOCKS_PER_JOB)
+            .map(|batch| {
+                let batch = batch.to_vec();
+                crypto_pool.submit(move || encrypt_data_nodes(&batch))
+            })
+            .collect();
 
-            node_entries.push(MhtNodeEntry { pos, key, mac });
-            pos += 1;
+        let start_pos = self.block_log.nblocks() as BlockId;
+        for ticket in tickets {
+            let (cipher_buf, keys_and_macs) = ticket.wait()?;
+            let pos = self.block_log.append(cipher_buf.as_ref())?;
+            node_entries.extend(
+                keys_and_macs
+                    .into_iter()
+                    .enumerate()
+                    .map(|(i, (key, mac))| MhtNodeEntry {
+                        pos: pos + i,
+                        key,
+                        mac,
+                    }),
+            );
         }
 
-        let append_pos = self.block_log.append(cipher_buf.as_ref())?;
-        debug_assert_eq!(start_pos, append_pos);
+        debug_assert_eq!(start_pos, node_entries[0].pos);
         Ok(node_entries)
     }
 
@@ -561,6 +573,57 @@ impl<L: BlockLog> MhtStorage<L> {
         Ok(mht_node)
     }
 
+    /// Reads the data nodes of `entries` to the search context.
+    ///
+    /// The nodes are read with as few I/O requests as possible, and decrypted
+    /// in batches on the crypto pool.
+    fn read_data_nodes(&self, entries: &[MhtNodeEntry], search_ctx: &mut SearchCtx) -> Result<()> {
+        if entries.len() < 2 * CryptoPool::BLOCKS_PER_JOB {
+            for entry in entries {
+                self.read_data_node(entry, search_ctx.node_buf(search_ctx.offset))?;
+                search_ctx.offset += 1;
+            }
+            return Ok(());
+        }
+
+        let crypto_pool = CryptoPool::get();
+        let mut tickets = Vec::new();
+        for batch in entries.chunks(CryptoPool::BLOCKS_PER_JOB) {
+            let mut cipher_buf = Buf::alloc(batch.len())?;
+            self.read_cipher_blocks(batch, cipher_buf.as_mut_slice())?;
+            let batch = batch.to_vec();
+            tickets.push(crypto_pool.submit(move || decrypt_data_nodes(&batch, &cipher_buf)));
+        }
+
+        for ticket in tickets {
+            let plain_buf = ticket.wait()?;
+            for block in plain_buf.as_ref().iter() {
+                search_ctx
+                    .node_buf(search_ctx.offset)
+                    .copy_from_slice(block.as_slice());
+                search_ctx.offset += 1;
+            }
+        }
+        Ok(())
+    }
+
+    /// Reads the encrypted blocks of `entries`, merging the reads of
+    /// consecutive blocks.
+    fn read_cipher_blocks(&self, entries: &[MhtNodeEntry], cipher: &mut [u8]) -> Result<()> {
+        let mut run_start = 0;
+        for i in 1..=entries.len() {
+            if i < entries.len() && entries[i].pos == entries[i - 1].pos + 1 {
+                continue;
+            }
+
+            let run_buf = &mut cipher[run_start * BLOCK_SIZE..i * BLOCK_SIZE];
+            self.block_log
+                .read(entries[run_start].pos, BufMut::try_from(run_buf)?)?;
+            run_start = i;
+        }
+        Ok(())
+    }
+
     fn read_data_node(&self, entry: &MhtNodeEntry, node_buf: &mut [u8]) -> Result<()> {
         debug_assert_eq!(node_buf.len(), BLOCK_SIZE);
         let mut crypt_buf = self.crypt_buf.lock();
@@ -577,6 +640,45 @@ impl<L: BlockLog> MhtStorage<L> {
     }
 }
 
+/// Encrypts the data nodes with random keys.
+///
+/// Returns the encrypted blocks, and the key and the MAC of each block.
+fn encrypt_data_nodes(nodes: &[Arc<DataNode>]) -> Result<(Buf, Vec<(Key, Mac)>)> {
+    let mut cipher_buf = Buf::alloc(nodes.len())?;
+    let mut keys_and_macs = Vec::with_capacity(nodes.len());
+    let aead = Aead::new();
+    for (node, cipher) in nodes
+        .iter()
+        .zip(cipher_buf.as_mut_slice().chunks_exact_mut(BLOCK_SIZE))
+    {
+        let key = Key::random();
+        let mac = aead.encrypt(&node.0, &key, &Iv::new_zeroed(), &[], cipher)?;
+        keys_and_macs.push((key, mac));
+    }
+    Ok((cipher_buf, keys_and_macs))
+}
+
+/// Decrypts and verifies the encrypted data nodes of `entries`.
+fn decrypt_data_nodes(entries: &[MhtNodeEntry], cipher_buf: &Buf) -> Result<Buf> {
+    let mut plain_buf = Buf::alloc(entries.len())?;
+    let aead = Aead::new();
+    for ((entry, cipher), plain) in entries
+        .iter()
+        .zip(cipher_buf.as_slice().chunks_exact(BLOCK_SIZE))
+        .zip(plain_buf.as_mut_slice().chunks_exact_mut(BLOCK_SIZE))
+    {
+        aead.decrypt(
+            cipher,
+            &entry.key,
+            &Iv::new_zeroed(),
+            &[],
+            &entry.mac,
+            plain,
+        )?;
+    }
+    Ok(plain_buf)
+}
+
 impl MhtNode {
     pub fn height(&self) -> Height {
         self.header.height
@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use alloc::collections::VecDeque;
+
+use spin::Once;
+
+use crate::{
+    os::{Condvar, CvarMutex},
+    prelude::*,
+};
+
+/// A pool of worker threads that offloads cryptographic jobs from the submitter.
+///
+/// Encrypting and decrypting blocks dominate the CPU cost of the crypto layer.
+/// Submitting the blocks in batches to `CryptoPool` spreads the cost to all
+/// CPUs, and allows the submitter to overlap the crypto with block I/O, e.g.,
+/// writing the encrypted batches to the disk in order while the following
+/// batches are still being encrypted.
+///
+/// There is one worker per CPU. On a single CPU, jobs are run by the submitter
+/// directly.
+pub(super) struct CryptoPool {
+    inner: Option<Arc<PoolInner>>,
+}
+
+struct PoolInner {
+    jobs: CvarMutex<VecDeque<Job>>,
+    cond: Condvar,
+}
+
+type Job = Box<dyn FnOnce() + Send>;
+
+static CRYPTO_POOL: Once<CryptoPool> = Once::new();
+
+impl CryptoPool {
+    /// The number of blocks that a job should process.
+    ///
+    /// Batches of smaller sizes do not pay off the cost of scheduling.
+    pub const BLOCKS_PER_JOB: usize = 16;
+
+    /// Returns the global `CryptoPool`, spawning its workers if needed.
+    pub fn get() -> &'static Self {
+        CRYPTO_POOL.call_once(|| Self::new(ostd::cpu::num_cpus()))
+    }
+
+    fn new(nr_workers: usize) -> Self {
+        if nr_workers <= 1 {
+            return Self { inner: None };
+        }
+
+        let inner = Arc::new(PoolInner {
+            jobs: CvarMutex::new(VecDeque::new()),
+            cond: Condvar::new(),
+        });
+        for _ in 0..nr_workers {
+            let inner = inner.clone();
+            let _ = crate::os::spawn(move || inner.run_worker());
+        }
+        Self { inner: Some(inner) }
+    }
+
+    /// Submits a job, returning a ticket to wait for its result.
+    pub fn submit<T, F>(&self, job: F) -> CryptoTicket<T>
+    where
+        T: Send + 'static,
+        F: FnOnce() -> T + Send + 'static,
+    {
+        let Some(inner) = &self.inner else {
+            return CryptoTicket::Ready(job());
+        };
+
+        let completion = Arc::new(Completion {
+            result: CvarMutex::new(None),
+            cond: Condvar::new(),
+        });
+        let completion_clone = completion.clone();
+        let job = Box::new(move || {
+            let result = job();
+            *completion_clone.result.lock().unwrap() = Some(result);
+            completion_clone.cond.notify_one();
+        });
+
+        inner.jobs.lock().unwrap().push_back(job);
+        inner.cond.notify_one();
+        CryptoTicket::Pending(completion)
+    }
+}
+
+impl PoolInner {
+    fn run_worker(&self) {
+        loop {
+            let job = {
+                let mut jobs = self.jobs.lock().unwrap();
+                loop {
+                    if let Some(job) = jobs.pop_front() {
+                        break job;
+                    }
+                    jobs = self.cond.wait(jobs).unwrap();
+                }
+            };
+            job();
+        }
+    }
+}
+
+/// A ticket to wait for the result of a job submitted to [`CryptoPool`].
+pub(super) enum CryptoTicket<T> {
+    Ready(T),
+    Pending(Arc<Completion<T>>),
+}
+
+pub(super) struct Completion<T> {
+    result: CvarMutex<Option<T>>,
+    cond: Condvar,
+}
+
+impl<T> CryptoTicket<T> {
+    /// Waits for the job to complete and returns its result.
+    pub fn wait(self) -> T {
+        match self {
+            Self::Ready(result) => result,
+            Self::Pending(completion) => {
+                let mut result = completion.result.lock().unwrap();
+                loop {
+                    if let Some(result) = result.take() {
+                        return result;
+                    }
+                    result = completion.cond.wait(result).unwrap();
+                }
+            }
+        }
+    }
+}
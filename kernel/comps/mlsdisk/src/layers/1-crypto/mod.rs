@@ -5,6 +5,7 @@
 mod crypto_blob;
 mod crypto_chain;
 mod crypto_log;
+mod crypto_pool;
 
 pub use self::{
     crypto_blob::CryptoBlob,
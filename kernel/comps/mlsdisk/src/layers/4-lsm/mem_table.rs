@@ -5,14 +5,14 @@ use core::ops::Range;
 
 use super::{tx_lsm_tree::OnDropRecodeFn, AsKV, RangeQueryCtx, RecordKey, RecordValue, SyncId};
 use crate::{
-    os::{BTreeMap, Condvar, CvarMutex, Mutex, RwLock, RwLockReadGuard},
+    os::{BTreeMap, Condvar, CvarMutex, RwLock, RwLockReadGuard, RwMutex},
     prelude::*,
 };
 
 /// Manager for an mutable `MemTable` and an immutable `MemTable`
 /// in a `TxLsmTree`.
 pub(super) struct MemTableManager<K: RecordKey<K>, V> {
-    mutable: Mutex<MemTable<K, V>>,
+    mutable: RwMutex<MemTable<K, V>>,  // Lookups do not block each other
     immutable: RwLock<MemTable<K, V>>, // Read-only most of the time
     cvar: Condvar,
     is_full: CvarMutex<bool>,
@@ -50,7 +50,7 @@ impl<K: RecordKey<K>, V: RecordValue> MemTableManager<K, V> {
         capacity: usize,
         on_drop_record_in_memtable: Option<Arc<OnDropRecodeFn<K, V>>>,
     ) -> Self {
-        let mutable = Mutex::new(MemTable::new(
+        let mutable = RwMutex::new(MemTable::new(
             capacity,
             sync_id,
             on_drop_record_in_memtable.clone(),
@@ -67,7 +67,7 @@ impl<K: RecordKey<K>, V: RecordValue> MemTableManager<K, V> {
 
     /// Gets the target value of the given key from the `MemTable`s.
     pub fn get(&self, key: &K) -> Option<V> {
-        if let Some(value) = self.mutable.lock().get(key) {
+        if let Some(value) = self.mutable.read().get(key) {
             return Some(*value);
         }
 
@@ -80,7 +80,7 @@ impl<K: RecordKey<K>, V: RecordValue> MemTableManager<K, V> {
 
     /// Gets the range of values from the `MemTable`s.
     pub fn get_range(&self, range_query_ctx: &mut RangeQueryCtx<K, V>) -> bool {
-        let is_completed = self.mutable.lock().get_range(range_query_ctx);
+        let is_completed = self.mutable.read().get_range(range_query_ctx);
         if is_completed {
             return is_completed;
         }
@@ -97,7 +97,7 @@ impl<K: RecordKey<K>, V: RecordValue> MemTableManager<K, V> {
         }
         debug_assert!(!*is_full);
 
-        let mut mutable = self.mutable.lock();
+        let mut mutable = self.mutable.write();
         let _ = mutable.put(key, value);
 
         if mutable.at_capacity() {
@@ -108,7 +108,7 @@ impl<K: RecordKey<K>, V: RecordValue> MemTableManager<K, V> {
 
     /// Sync the mutable `MemTable` with the given sync ID.
     pub fn sync(&self, sync_id: SyncId) {
-        self.mutable.lock().sync(sync_id)
+        self.mutable.write().sync(sync_id)
     }
 
     /// Switch two `MemTable`s. Should only be called in a situation that
@@ -118,7 +118,7 @@ impl<K: RecordKey<K>, V: RecordValue> MemTableManager<K, V> {
         let mut is_full = self.is_full.lock().unwrap();
         debug_assert!(*is_full);
 
-        let mut mutable = self.mutable.lock();
+        let mut mutable = self.mutable.write();
         let sync_id = mutable.sync_id();
 
         let mut immutable = self.immutable.write();
@@ -350,7 +350,7 @@ impl<V: RecordValue> Default for ValueEx<V> {
 impl<K: RecordKey<K>, V: RecordValue> Debug for MemTableManager<K, V> {
     fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
         f.debug_struct("MemTableManager")
-            .field("mutable_memtable_size", &self.mutable.lock().size())
+            .field("mutable_memtable_size", &self.mutable.read().size())
             .field("immutable_memtable_size", &self.immutable_memtable().size())
             .finish()
     }
@@ -18,6 +18,7 @@ use crate::{
     },
     os::Mutex,
     prelude::*,
+    util::BloomFilter,
 };
 
 /// Sorted String Table (SST) for `TxLsmTree`.
@@ -28,6 +29,7 @@ use crate::{
 pub(super) struct SSTable<K, V> {
     id: TxLogId,
     footer: Footer<K>,
+    filter: BloomFilter,
     cache: Mutex<LruCache<BlockId, Arc<RecordBlock>>>,
     phantom: PhantomData<(K, V)>,
 }
@@ -146,6 +148,15 @@ impl<K: RecordKey<K>, V: RecordValue> SSTable<K, V> {
         self.range().contains(key)
     }
 
+    /// Whether the target key may be in this `SSTable`.
+    ///
+    /// The check is answered by an in-memory Bloom filter, so a `false` saves
+    /// the point query from reading any record block. A `true` may be a false
+    /// positive.
+    pub fn may_contain(&self, key: &K) -> bool {
+        self.is_within_range(key) && self.filter.may_contain(key.as_bytes())
+    }
+
     /// Whether the target range is overlapped with the range of this `SSTable`.
     pub fn overlap_with(&self, rhs_range: &RangeInclusive<K>) -> bool {
         let lhs_range = self.range();
@@ -335,32 +346,34 @@ impl<K: RecordKey<K>, V: RecordValue> SSTable<K, V> {
         Self: 'a,
     {
         let mut cache = LruCache::new(NonZeroUsize::new(Self::CACHE_CAP).unwrap());
-        let (total_records, index_vec) =
+        let (total_records, index_vec, filter) =
             Self::build_record_blocks(records_iter, tx_log, &mut cache, event_listener)?;
         let footer = Self::build_footer::<D>(index_vec, total_records, sync_id, tx_log)?;
 
         Ok(Self {
             id: tx_log.id(),
             footer,
+            filter,
             cache: Mutex::new(cache),
             phantom: PhantomData,
         })
     }
 
     /// Builds all the record blocks from the given records. Put the blocks to the log
-    /// and the cache.
+    /// and the cache. Also builds the Bloom filter of the keys.
     fn build_record_blocks<'a, D: BlockSet + 'static, I, KVex>(
         records_iter: I,
         tx_log: &'a TxLog<D>,
         cache: &mut LruCache<BlockId, Arc<RecordBlock>>,
         event_listener: Option<&'a Arc<dyn TxEventListener<K, V>>>,
-    ) -> Result<(usize, Vec<IndexEntry<K>>)>
+    ) -> Result<(usize, Vec<IndexEntry<K>>, BloomFilter)>
     where
         I: Iterator<Item = KVex>,
         KVex: AsKVex<K, V>,
         Self: 'a,
     {
         let mut index_vec = Vec::new();
+        let mut keys = Vec::new();
         let mut total_records = 0;
         let mut pos = 0 as BlockId;
         let (mut first_k, mut curr_k) = (None, None);
@@ -370,6 +383,7 @@ impl<K: RecordKey<K>, V: RecordValue> SSTable<K, V> {
         for kv_ex in records_iter {
             let (key, value_ex) = (*kv_ex.key(), kv_ex.value_ex());
             total_records += 1;
+            keys.push(key);
 
             if inner_offset == 0 {
                 debug_assert!(block_buf.is_empty());
@@ -455,7 +469,12 @@ impl<K: RecordKey<K>, V: RecordValue> SSTable<K, V> {
             Ok(())
         }
 
-        Ok((total_records, index_vec))
+        let mut filter = BloomFilter::new(keys.len(), BloomFilter::BITS_PER_KEY);
+        for key in &keys {
+            filter.insert(key.as_bytes());
+        }
+
+        Ok((total_records, index_vec, filter))
     }
 
     /// Builds the footer from the given index entries. The footer block will be appended
@@ -497,6 +516,8 @@ impl<K: RecordKey<K>, V: RecordValue> SSTable<K, V> {
     }
 
     /// Builds a SST from a `TxLog`, loads the footer and the index blocks.
+    /// The Bloom filter is rebuilt from the record blocks, which are all loaded
+    /// to the cache anyway.
     ///
     /// # Panics
     ///
@@ -513,6 +534,7 @@ impl<K: RecordKey<K>, V: RecordValue> SSTable<K, V> {
         tx_log.read(nblocks - meta.index_nblocks as usize, rbuf.as_mut())?;
         let mut index = Vec::with_capacity(meta.num_index as _);
         let mut cache = LruCache::new(NonZeroUsize::new(Self::CACHE_CAP).unwrap());
+        let mut filter = BloomFilter::new(meta.total_records as _, BloomFilter::BITS_PER_KEY);
         let mut record_block = vec![0; RECORD_BLOCK_SIZE];
         for i in 0..meta.num_index as _ {
             let buf =
@@ -524,7 +546,18 @@ impl<K: RecordKey<K>, V: RecordValue> SSTable<K, V> {
                 K::from_bytes(&buf[Self::INDEX_ENTRY_SIZE - Self::K_SIZE..Self::INDEX_ENTRY_SIZE]);
 
             tx_log.read(pos, BufMut::try_from(&mut record_block[..]).unwrap())?;
-            let _ = cache.put(pos, Arc::new(RecordBlock::from_buf(record_block.clone())));
+            let rb = RecordBlock::from_buf(record_block.clone());
+            let accessor = QueryAccessor::Range(first..=last);
+            let iter = BlockQueryIter::<'_, K, V> {
+                block: &rb,
+                offset: 0,
+                accessor: &accessor,
+                phantom: PhantomData,
+            };
+            for (key, _) in iter {
+                filter.insert(key.as_bytes());
+            }
+            let _ = cache.put(pos, Arc::new(rb));
 
             index.push(IndexEntry { pos, first, last })
         }
@@ -533,6 +566,7 @@ impl<K: RecordKey<K>, V: RecordValue> SSTable<K, V> {
         Ok(Self {
             id: tx_log.id(),
             footer,
+            filter,
             cache: Mutex::new(cache),
             phantom: PhantomData,
         })
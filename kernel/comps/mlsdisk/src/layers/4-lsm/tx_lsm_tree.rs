@@ -437,7 +437,7 @@ impl<K: RecordKey<K>, V: RecordValue, D: BlockSet + 'static> TreeInner<K, V, D>
 
             for (level, _bucket) in LsmLevel::iter() {
                 for (_id, sst) in sst_manager.list_level(level) {
-                    if !sst.is_within_range(key) {
+                    if !sst.may_contain(key) {
                         continue;
                     }
 
@@ -21,7 +21,7 @@ use aes_gcm::{
 };
 use ctr::cipher::{NewCipher, StreamCipher};
 pub use hashbrown::{HashMap, HashSet};
-pub use ostd::sync::{Mutex, MutexGuard, RwLock, SpinLock};
+pub use ostd::sync::{Mutex, MutexGuard, RwLock, RwMutex, SpinLock};
 use ostd::{
     arch::read_random,
     sync::{self, PreemptDisabled, WaitQueue},
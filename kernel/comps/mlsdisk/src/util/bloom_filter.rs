@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use alloc::vec;
+
+use crate::prelude::*;
+
+/// A Bloom filter that tells whether a key may be in a set.
+///
+/// Queries for keys inserted before always return `true`, while queries for
+/// other keys return `false` except for a small false positive rate, which is
+/// about 1% with the default `BITS_PER_KEY`.
+#[derive(Clone, Debug)]
+pub struct BloomFilter {
+    bits: Vec<u64>,
+    nbits: u64,
+    nhashes: u32,
+}
+
+impl BloomFilter {
+    /// The default number of bits for each key.
+    pub const BITS_PER_KEY: usize = 10;
+
+    /// Creates an empty `BloomFilter` to hold `nkeys` keys, using
+    /// `bits_per_key` bits for each key.
+    pub fn new(nkeys: usize, bits_per_key: usize) -> Self {
+        let nbits = (nkeys.max(1) * bits_per_key).max(64).next_multiple_of(64);
+        // The optimal number of hash functions is `bits_per_key * ln(2)`.
+        let nhashes = ((bits_per_key * 69 / 100) as u32).clamp(1, 30);
+        Self {
+            bits: vec![0; nbits / 64],
+            nbits: nbits as u64,
+            nhashes,
+        }
+    }
+
+    /// Inserts a key, given as its bytes.
+    pub fn insert(&mut self, key: &[u8]) {
+        let (mut hash, delta) = Self::hash_pair(key);
+        for _ in 0..self.nhashes {
+            let bit = hash % self.nbits;
+            self.bits[(bit / 64) as usize] |= 1 << (bit % 64);
+            hash = hash.wrapping_add(delta);
+        }
+    }
+
+    /// Returns whether the key, given as its bytes, may have been inserted.
+    pub fn may_contain(&self, key: &[u8]) -> bool {
+        let (mut hash, delta) = Self::hash_pair(key);
+        for _ in 0..self.nhashes {
+            let bit = hash % self.nbits;
+            if self.bits[(bit / 64) as usize] & (1 << (bit % 64)) == 0 {
+                return false;
+            }
+            hash = hash.wrapping_add(delta);
+        }
+        true
+    }
+
+    /// Derives the hash values with double hashing from a single 64-bit
+    /// FNV-1a hash of the key.
+    fn hash_pair(key: &[u8]) -> (u64, u64) {
+        const FNV_OFFSET_BASIS: u64 = 0xcbf2_9ce4_8422_2325;
+        const FNV_PRIME: u64 = 0x0000_0100_0000_01b3;
+
+        let mut hash = FNV_OFFSET_BASIS;
+        for byte in key {
+            hash ^= *byte as u64;
+            hash = hash.wrapping_mul(FNV_PRIME);
+        }
+        // Mix the bits since the FNV hash of short keys is weak in high bits.
+        hash ^= hash >> 33;
+        hash = hash.wrapping_mul(0xff51_afd7_ed55_8ccd);
+        hash ^= hash >> 33;
+
+        (hash, hash.rotate_left(32) | 1)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::BloomFilter;
+
+    #[test]
+    fn no_false_negatives() {
+        let mut filter = BloomFilter::new(1000, BloomFilter::BITS_PER_KEY);
+        for key in 0..1000u64 {
+            filter.insert(&key.to_le_bytes());
+        }
+        for key in 0..1000u64 {
+            assert!(filter.may_contain(&key.to_le_bytes()));
+        }
+    }
+
+    #[test]
+    fn few_false_positives() {
+        let mut filter = BloomFilter::new(1000, BloomFilter::BITS_PER_KEY);
+        for key in 0..1000u64 {
+            filter.insert(&key.to_le_bytes());
+        }
+        let false_positives = (1000..11000u64)
+            .filter(|key| filter.may_contain(&key.to_le_bytes()))
+            .count();
+        assert!(false_positives < 500);
+    }
+}
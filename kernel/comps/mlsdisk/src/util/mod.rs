@@ -2,11 +2,13 @@
 
 //! Utilities.
 mod bitmap;
+mod bloom_filter;
 mod crypto;
 mod lazy_delete;
 
 pub use self::{
     bitmap::BitMap,
+    bloom_filter::BloomFilter,
     crypto::{Aead, RandomInit, Rng, Skcipher},
     lazy_delete::LazyDelete,
 };
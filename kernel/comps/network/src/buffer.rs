@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: MPL-2.0
 
-use alloc::{collections::linked_list::LinkedList, sync::Arc};
+use alloc::{collections::linked_list::LinkedList, sync::Arc, vec::Vec};
+use core::mem::size_of;
 
 use aster_softirq::BottomHalfDisabled;
 use ostd::{
@@ -26,17 +27,31 @@ impl TxBuffer {
         header: &H,
         packet: &[u8],
         pool: &'static SpinLock<LinkedList<DmaStream>, BottomHalfDisabled>,
+    ) -> Self {
+        Self::with_buffer_len(header, packet, TX_BUFFER_LEN, pool)
+    }
+
+    /// Creates a buffer from a pool whose buffers are `buffer_len` bytes.
+    ///
+    /// This is used to send packets larger than [`TX_BUFFER_LEN`], e.g., the packets to be
+    /// segmented by the device.
+    pub fn with_buffer_len<H: Pod>(
+        header: &H,
+        packet: &[u8],
+        buffer_len: usize,
+        pool: &'static SpinLock<LinkedList<DmaStream>, BottomHalfDisabled>,
     ) -> Self {
         let header = header.as_bytes();
         let nbytes = header.len() + packet.len();
 
-        assert!(nbytes <= TX_BUFFER_LEN);
+        assert!(nbytes <= buffer_len);
+        assert!(buffer_len % PAGE_SIZE == 0);
 
         let dma_stream = if let Some(stream) = pool.lock().pop_front() {
             stream
         } else {
             let segment = FrameAllocOptions::new()
-                .alloc_segment(TX_BUFFER_LEN / PAGE_SIZE)
+                .alloc_segment(buffer_len / PAGE_SIZE)
                 .unwrap();
             DmaStream::map(segment.into(), DmaDirection::ToDevice, false).unwrap()
         };
@@ -62,6 +77,16 @@ impl TxBuffer {
         writer
     }
 
+    /// Overwrites the bytes at `offset` of the buffer, e.g., to fill in a checksum field.
+    pub fn write_bytes_at(&self, offset: usize, bytes: &[u8]) {
+        let range = offset..offset + bytes.len();
+        assert!(range.end <= self.nbytes);
+
+        let mut writer = self.dma_stream.writer().unwrap();
+        writer.skip(offset).write(&mut VmReader::from(bytes));
+        self.dma_stream.sync(range).unwrap();
+    }
+
     fn sync(&self) {
         self.dma_stream.sync(0..self.nbytes).unwrap();
     }
@@ -87,6 +112,8 @@ pub struct RxBuffer {
     segment: DmaSegment,
     header_len: usize,
     packet_len: usize,
+    /// The following buffers that the packet spans, if the device merges receive buffers.
+    merged: Vec<RxBuffer>,
 }
 
 impl RxBuffer {
@@ -97,11 +124,39 @@ impl RxBuffer {
             segment,
             header_len,
             packet_len: 0,
+            merged: Vec::new(),
         }
     }
 
-    pub const fn packet_len(&self) -> usize {
-        self.packet_len
+    /// Returns the length of the packet, including the parts in the merged buffers.
+    pub fn packet_len(&self) -> usize {
+        self.packet_len + self.merged.iter().map(|buf| buf.packet_len).sum::<usize>()
+    }
+
+    /// Reads the header that precedes the packet.
+    pub fn header<H: Pod>(&self) -> H {
+        assert_eq!(size_of::<H>(), self.header_len);
+        self.segment.sync(0..self.header_len).unwrap();
+        self.segment.reader().unwrap().read_val().unwrap()
+    }
+
+    /// Appends a buffer that the packet continues in, of which `len` bytes are used.
+    ///
+    /// The appended buffer carries no header, even if it is allocated with one.
+    pub fn append(&mut self, mut next: RxBuffer, len: usize) {
+        debug_assert!(next.merged.is_empty());
+        next.header_len = 0;
+        next.set_packet_len(len);
+        self.merged.push(next);
+    }
+
+    /// Reads the whole packet, including the parts in the merged buffers.
+    pub fn read_packet(&self, writer: &mut VmWriter<'_, Infallible>) -> usize {
+        let mut read_len = self.packet().read(writer);
+        for buf in self.merged.iter() {
+            read_len += buf.packet().read(writer);
+        }
+        read_len
     }
 
     pub fn set_packet_len(&mut self, packet_len: usize) {
@@ -109,6 +164,7 @@ impl RxBuffer {
         self.packet_len = packet_len;
     }
 
+    /// Returns the reader of the packet, excluding the parts in the merged buffers.
     pub fn packet(&self) -> VmReader<'_, Infallible> {
         self.segment
             .sync(self.header_len..self.header_len + self.packet_len)
@@ -144,7 +200,10 @@ pub static RX_BUFFER_POOL: Once<Arc<DmaPool>> = Once::new();
 
 pub fn init() {
     const POOL_INIT_SIZE: usize = 64;
-    const POOL_HIGH_WATERMARK: usize = 128;
+    // Each queue keeps its receive buffers posted, and a packet merged from a 64 KiB
+    // super-segment holds 16 more buffers until it is consumed. So the watermark is set
+    // high to avoid freeing and reallocating the pages under load.
+    const POOL_HIGH_WATERMARK: usize = 512;
     RX_BUFFER_POOL.call_once(|| {
         DmaPool::new(
             RX_BUFFER_LEN,
@@ -6,21 +6,25 @@ use aster_bigtcp::{
     device::{self, NotifyDevice},
     time::Instant,
 };
-use ostd::mm::VmWriter;
+use ostd::{cpu_local_cell, mm::VmWriter};
 
-use crate::{buffer::RxBuffer, AnyNetworkDevice};
+use crate::{buffer::RxBuffer, AnyNetworkDevice, VirtioNetError};
 
 impl device::Device for dyn AnyNetworkDevice {
     type RxToken<'a> = RxToken;
     type TxToken<'a> = TxToken<'a>;
 
     fn receive(&mut self, _timestamp: Instant) -> Option<(Self::RxToken<'_>, Self::TxToken<'_>)> {
-        if self.can_receive() && self.can_send() {
-            let rx_buffer = self.receive().unwrap();
-            Some((RxToken(rx_buffer), TxToken(self)))
-        } else {
-            None
+        while self.can_receive() && self.can_send() {
+            match self.receive() {
+                Ok(rx_buffer) => return Some((RxToken(rx_buffer), TxToken(self))),
+                // Skip a dropped packet and keep draining the packets behind it.
+                Err(VirtioNetError::BadPacket) => NR_RX_DROPPED_PACKETS.add_assign(1),
+                Err(_) => return None,
+            }
         }
+
+        None
     }
 
     fn transmit(&mut self, _timestamp: Instant) -> Option<Self::TxToken<'_>> {
@@ -42,6 +46,25 @@ impl NotifyDevice for dyn AnyNetworkDevice {
     }
 }
 
+cpu_local_cell! {
+    /// The number of packets received on the CPU.
+    static NR_RX_PACKETS: u64 = 0;
+    /// The number of packets transmitted on the CPU.
+    static NR_TX_PACKETS: u64 = 0;
+    /// The number of received packets that are dropped by the drivers on the CPU.
+    static NR_RX_DROPPED_PACKETS: u64 = 0;
+}
+
+/// Returns the numbers of packets received and transmitted by all the network devices since boot.
+pub fn packet_stats() -> (u64, u64) {
+    (NR_RX_PACKETS.sum(), NR_TX_PACKETS.sum())
+}
+
+/// Returns the number of received packets that are dropped by all the network drivers since boot.
+pub fn nr_rx_dropped_packets() -> u64 {
+    NR_RX_DROPPED_PACKETS.sum()
+}
+
 pub struct RxToken(RxBuffer);
 
 impl device::RxToken for RxToken {
@@ -49,9 +72,11 @@ impl device::RxToken for RxToken {
     where
         F: FnOnce(&[u8]) -> R,
     {
-        let mut packet = self.0.packet();
-        let mut buffer = vec![0u8; packet.remain()];
-        packet.read(&mut VmWriter::from(&mut buffer as &mut [u8]));
+        let mut buffer = vec![0u8; self.0.packet_len()];
+        self.0
+            .read_packet(&mut VmWriter::from(&mut buffer as &mut [u8]));
+        NR_RX_PACKETS.add_assign(1);
+        ostd::tracepoint!(NetRx, buffer.len());
         f(&buffer)
     }
 }
@@ -66,6 +91,8 @@ impl device::TxToken for TxToken<'_> {
         let mut buffer = vec![0u8; len];
         let res = f(&mut buffer);
         self.0.send(&buffer).expect("Send packet failed");
+        NR_TX_PACKETS.add_assign(1);
+        ostd::tracepoint!(NetTx, len);
         res
     }
 }
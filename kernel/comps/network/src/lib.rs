@@ -23,6 +23,7 @@ use aster_softirq::{
 pub use buffer::{RxBuffer, TxBuffer, RX_BUFFER_POOL, TX_BUFFER_LEN};
 use component::{init_component, ComponentInitError};
 pub use dma_pool::DmaSegment;
+pub use driver::{nr_rx_dropped_packets, packet_stats};
 use ostd::{sync::SpinLock, Pod};
 use spin::Once;
 
@@ -33,6 +34,8 @@ pub struct EthernetAddr(pub [u8; 6]);
 #[derive(Debug, Clone, Copy)]
 pub enum VirtioNetError {
     NotReady,
+    /// The received packet is dropped, e.g., because its checksum is bad.
+    BadPacket,
     WrongToken,
     Busy,
     Unknown,
@@ -65,6 +68,21 @@ pub trait AnyNetworkDevice: Send + Sync + Any + Debug {
     /// for the entire duration of the polling process.
     /// Thus two polling process cannot happen simultaneously.
     fn notify_poll_end(&mut self);
+
+    /// Starts polling at most `budget` received packets, NAPI-style.
+    ///
+    /// The driver should stop raising interrupts for received packets, and
+    /// [`Self::can_receive`] should return false once `budget` packets are received.
+    fn start_recv_poll(&mut self, _budget: usize) {}
+
+    /// Finishes polling the received packets.
+    ///
+    /// Returns true if some packets are still pending. In this case, the interrupts stay
+    /// disabled and the caller should poll the device again. Otherwise, the interrupts for
+    /// received packets are re-enabled.
+    fn finish_recv_poll(&mut self) -> bool {
+        false
+    }
 }
 
 pub trait NetDeviceCallback = Fn() + Send + Sync + 'static;
@@ -115,16 +133,34 @@ pub fn register_send_callback(name: &str, callback: impl NetDeviceCallback) {
     callbacks.send_callbacks.lock().push(Arc::new(callback));
 }
 
+/// The maximum number of packets received from a device in one softirq.
+///
+/// Under high packet rates, the device interrupts stay disabled and the remaining packets are
+/// received in the following softirqs, so that the interrupts are not raised per packet and
+/// other softirqs are not starved.
+const RX_POLL_BUDGET: usize = 64;
+
 fn handle_rx_softirq() {
     let device_table = COMPONENT.get().unwrap().network_device_table.lock();
+    let mut has_pending = false;
     // TODO: We should handle network events for just one device per softirq,
     // rather than processing events for all devices.
     // This issue should be addressed once new network devices are added.
     for callback_set in device_table.values() {
         let recv_callbacks = callback_set.recv_callbacks.lock();
+        if recv_callbacks.is_empty() {
+            continue;
+        }
+
+        callback_set.device.lock().start_recv_poll(RX_POLL_BUDGET);
         for callback in recv_callbacks.iter() {
             callback();
         }
+        has_pending |= callback_set.device.lock().finish_recv_poll();
+    }
+
+    if has_pending {
+        raise_receive_softirq();
     }
 }
 
@@ -12,14 +12,16 @@ use core::{fmt::Debug, hint::spin_loop, mem::size_of};
 
 use aster_block::{
     bio::{bio_segment_pool_init, BioEnqueueError, BioStatus, BioType, SubmittedBio},
-    request_queue::{BioRequest, BioRequestSingleQueue},
+    mq::{BioRequestMultiQueue, IoSchedulerType},
+    request_queue::BioRequest,
     BlockDeviceMeta,
 };
 use id_alloc::IdAlloc;
 use log::{debug, info};
 use ostd::{
+    cpu::{all_cpus, num_cpus, CpuSet},
     mm::{DmaDirection, DmaStream, DmaStreamSlice, FrameAllocOptions, VmIo},
-    sync::SpinLock,
+    sync::{SpinLock, WaitQueue},
     trap::TrapFrame,
     Pod,
 };
@@ -37,8 +39,8 @@ use crate::{
 #[derive(Debug)]
 pub struct BlockDevice {
     device: Arc<DeviceInner>,
-    /// The software staging queue.
-    queue: BioRequestSingleQueue,
+    /// The multi-queue request queue.
+    queue: BioRequestMultiQueue,
 }
 
 impl BlockDevice {
@@ -53,12 +55,16 @@ impl BlockDevice {
             device.request_device_id()
         };
 
+        // The requests staged on a CPU are dispatched to the virtqueue of the CPU.
+        let nr_queues = device.queues.len();
         let block_device = Arc::new(Self {
             device,
             // Each bio request includes an additional 1 request and 1 response descriptor,
             // therefore this upper bound is set to (QUEUE_SIZE - 2).
-            queue: BioRequestSingleQueue::with_max_nr_segments_per_bio(
+            queue: BioRequestMultiQueue::new(
+                nr_queues,
                 (DeviceInner::QUEUE_SIZE - 2) as usize,
+                IoSchedulerType::Deadline,
             ),
         });
 
@@ -68,23 +74,34 @@ impl BlockDevice {
         Ok(())
     }
 
-    /// Dequeues a `BioRequest` from the software staging queue and
+    /// Returns the number of virtqueues used by the device.
+    ///
+    /// The requests of each virtqueue should be handled by a dedicated thread
+    /// with [`Self::handle_requests`].
+    pub fn nr_queues(&self) -> usize {
+        self.device.queues.len()
+    }
+
+    /// Returns the CPUs whose requests are dispatched to the `queue_idx`-th virtqueue.
+    pub fn queue_cpus(&self, queue_idx: usize) -> CpuSet {
+        let mut cpus = CpuSet::new_empty();
+        all_cpus()
+            .filter(|cpu| cpu.as_usize() % self.nr_queues() == queue_idx)
+            .for_each(|cpu| cpus.add(cpu));
+        cpus
+    }
+
+    /// Dequeues a `BioRequest` for the `queue_idx`-th virtqueue and
     /// processes the request.
-    pub fn handle_requests(&self) {
-        let request = self.queue.dequeue();
+    pub fn handle_requests(&self, queue_idx: usize) {
+        let request = self.queue.dequeue(queue_idx);
         info!("Handle Request: {:?}", request);
-        match request.type_() {
-            BioType::Read => self.device.read(request),
-            BioType::Write => self.device.write(request),
-            BioType::Flush => self.device.flush(request),
-            BioType::Discard => todo!(),
-        }
+        self.device.submit(queue_idx, request);
     }
 
     /// Negotiate features for the device specified bits 0~23
     pub(crate) fn negotiate_features(features: u64) -> u64 {
-        let mut support_features = BlockFeatures::from_bits_truncate(features);
-        support_features.remove(BlockFeatures::MQ);
+        let support_features = BlockFeatures::from_bits_truncate(features);
         support_features.bits
     }
 }
@@ -94,6 +111,10 @@ impl aster_block::BlockDevice for BlockDevice {
         self.queue.enqueue(bio)
     }
 
+    fn enqueue_batch(&self, bios: Vec<SubmittedBio>) {
+        self.queue.enqueue_batch(bios)
+    }
+
     fn metadata(&self) -> BlockDeviceMeta {
         BlockDeviceMeta {
             max_nr_segments_per_bio: self.queue.max_nr_segments_per_bio(),
@@ -106,12 +127,9 @@ impl aster_block::BlockDevice for BlockDevice {
 struct DeviceInner {
     config_manager: ConfigManager<VirtioBlockConfig>,
     features: VirtioBlockFeature,
-    queue: SpinLock<VirtQueue>,
+    /// The virtqueues, one for each CPU if the device supports multiple queues.
+    queues: Vec<BlockQueue>,
     transport: SpinLock<Box<dyn VirtioTransport>>,
-    block_requests: DmaStream,
-    block_responses: DmaStream,
-    id_allocator: SpinLock<IdAlloc>,
-    submitted_requests: SpinLock<BTreeMap<u16, SubmittedRequest>>,
 }
 
 impl DeviceInner {
@@ -126,47 +144,27 @@ impl DeviceInner {
             VirtioBlockConfig::sector_size(),
             "currently not support customized device logical block size"
         );
-        let num_queues = transport.num_queues();
-        if num_queues != 1 {
-            // FIXME: support Multi-Queue Block IO Queueing Mechanism
-            // (`BlkFeatures::MQ`) to accelerate multi-processor requests for
-            // block devices. When SMP is enabled on x86, the feature is on.
-            // We should also consider negotiating the feature in the future.
-            // return Err(VirtioDeviceError::QueuesAmountDoNotMatch(num_queues, 1));
-            log::warn!(
-                "Not supporting Multi-Queue Block IO Queueing Mechanism, only using the first queue"
-            );
-        }
         let features = VirtioBlockFeature::new(transport.as_ref());
-        let queue = VirtQueue::new(0, Self::QUEUE_SIZE, transport.as_mut())
-            .expect("create virtqueue failed");
-        let block_requests = {
-            let segment = FrameAllocOptions::new().alloc_segment(1).unwrap();
-            DmaStream::map(segment.into(), DmaDirection::Bidirectional, false).unwrap()
-        };
-        assert!(Self::QUEUE_SIZE as usize * REQ_SIZE <= block_requests.nbytes());
-        let block_responses = {
-            let segment = FrameAllocOptions::new().alloc_segment(1).unwrap();
-            DmaStream::map(segment.into(), DmaDirection::Bidirectional, false).unwrap()
+        let nr_queues = if features.support_multiqueue {
+            config_manager
+                .num_queues()
+                .min(transport.num_queues())
+                .min(num_cpus() as u16)
+                .max(1)
+        } else {
+            1
         };
-        assert!(Self::QUEUE_SIZE as usize * RESP_SIZE <= block_responses.nbytes());
+        let queues = (0..nr_queues)
+            .map(|idx| BlockQueue::new(idx, transport.as_mut()))
+            .collect::<Result<Vec<_>, _>>()?;
 
         let device = Arc::new(Self {
             config_manager,
             features,
-            queue: SpinLock::new(queue),
+            queues,
             transport: SpinLock::new(transport),
-            block_requests,
-            block_responses,
-            id_allocator: SpinLock::new(IdAlloc::with_capacity(Self::QUEUE_SIZE as usize)),
-            submitted_requests: SpinLock::new(BTreeMap::new()),
         });
 
-        let cloned_device = device.clone();
-        let handle_irq = move |_: &TrapFrame| {
-            cloned_device.handle_irq();
-        };
-
         let cloned_device = device.clone();
         let handle_config_change = move |_: &TrapFrame| {
             cloned_device.handle_config_change();
@@ -177,73 +175,35 @@ impl DeviceInner {
             transport
                 .register_cfg_callback(Box::new(handle_config_change))
                 .unwrap();
-            transport
-                .register_queue_callback(0, Box::new(handle_irq), false)
-                .unwrap();
+            // Each queue gets its own interrupt if there are multiple queues,
+            // so that the queues do not contend for a shared interrupt line.
+            for idx in 0..nr_queues {
+                let cloned_device = device.clone();
+                let handle_irq = move |_: &TrapFrame| {
+                    cloned_device.queues[idx as usize].handle_irq();
+                };
+                transport
+                    .register_queue_callback(idx, Box::new(handle_irq), nr_queues > 1)
+                    .unwrap();
+            }
             transport.finish_init();
         }
+        info!("virtio-blk uses {} queues", nr_queues);
 
         Ok(device)
     }
 
-    /// Handles the irq issued from the device
-    fn handle_irq(&self) {
-        info!("Virtio block device handle irq");
-        // When we enter the IRQs handling function,
-        // IRQs have already been disabled,
-        // so there is no need to call `disable_irq`.
-        loop {
-            // Pops the complete request
-            let complete_request = {
-                let mut queue = self.queue.lock();
-                let Ok((token, _)) = queue.pop_used() else {
-                    return;
-                };
-                self.submitted_requests.lock().remove(&token).unwrap()
-            };
-
-            // Handles the response
-            let id = complete_request.id as usize;
-            let resp_slice = DmaStreamSlice::new(&self.block_responses, id * RESP_SIZE, RESP_SIZE);
-            resp_slice.sync().unwrap();
-            let resp: BlockResp = resp_slice.read_val(0).unwrap();
-            self.id_allocator.lock().free(id);
-            match RespStatus::try_from(resp.status).unwrap() {
-                RespStatus::Ok => {}
-                // FIXME: Return an error instead of triggering a kernel panic
-                _ => panic!("io error in block device"),
-            };
-
-            // Synchronize DMA mapping if read from the device
-            if let BioType::Read = complete_request.bio_request.type_() {
-                complete_request
-                    .bio_request
-                    .bios()
-                    .flat_map(|bio| {
-                        bio.segments()
-                            .iter()
-                            .map(|segment| segment.inner_dma_slice())
-                    })
-                    .for_each(|dma_slice| dma_slice.sync().unwrap());
-            }
-
-            // Completes the bio request
-            complete_request.bio_request.bios().for_each(|bio| {
-                bio.complete(BioStatus::Complete);
-            });
-        }
-    }
-
     fn handle_config_change(&self) {
         info!("Virtio block device config space change");
     }
 
-    // TODO: Most logic is the same as read and write, there should be a refactor.
+    // TODO: Most logic is the same as `BlockQueue::submit`, there should be a refactor.
     // TODO: Should return an Err instead of panic if the device fails.
     fn request_device_id(&self) -> String {
-        let id = self.id_allocator.disable_irq().lock().alloc().unwrap();
+        let queue = &self.queues[0];
+        let id = queue.id_allocator.disable_irq().lock().alloc().unwrap();
         let req_slice = {
-            let req_slice = DmaStreamSlice::new(&self.block_requests, id * REQ_SIZE, REQ_SIZE);
+            let req_slice = DmaStreamSlice::new(&queue.block_requests, id * REQ_SIZE, REQ_SIZE);
             let req = BlockReq {
                 type_: ReqType::GetId as _,
                 reserved: 0,
@@ -255,7 +215,7 @@ impl DeviceInner {
         };
 
         let resp_slice = {
-            let resp_slice = DmaStreamSlice::new(&self.block_responses, id * RESP_SIZE, RESP_SIZE);
+            let resp_slice = DmaStreamSlice::new(&queue.block_responses, id * RESP_SIZE, RESP_SIZE);
             resp_slice.write_val(0, &BlockResp::default()).unwrap();
             resp_slice
         };
@@ -270,20 +230,23 @@ impl DeviceInner {
         let device_id_slice = DmaStreamSlice::new(&device_id_stream, 0, MAX_ID_LENGTH);
         let outputs = vec![&device_id_slice, &resp_slice];
 
-        let mut queue = self.queue.disable_irq().lock();
-        let token = queue
+        let mut virt_queue = queue.queue.disable_irq().lock();
+        let token = virt_queue
             .add_dma_buf(&[&req_slice], outputs.as_slice())
             .expect("add queue failed");
-        if queue.should_notify() {
-            queue.notify();
+        if virt_queue.should_notify() {
+            virt_queue.notify();
         }
-        while !queue.can_pop() {
+        while !virt_queue.can_pop() {
             spin_loop();
         }
-        queue.pop_used_with_token(token).expect("pop used failed");
+        virt_queue
+            .pop_used_with_token(token)
+            .expect("pop used failed");
+        drop(virt_queue);
 
         resp_slice.sync().unwrap();
-        self.id_allocator.disable_irq().lock().free(id);
+        queue.id_allocator.disable_irq().lock().free(id);
         let resp: BlockResp = resp_slice.read_val(0).unwrap();
         match RespStatus::try_from(resp.status).unwrap() {
             RespStatus::Ok => {}
@@ -304,148 +267,161 @@ impl DeviceInner {
         String::from_utf8(device_id).unwrap()
     }
 
-    /// Reads data from the device, this function is non-blocking.
-    fn read(&self, bio_request: BioRequest) {
-        let id = self.id_allocator.disable_irq().lock().alloc().unwrap();
-        let req_slice = {
-            let req_slice =
-                DmaStreamSlice::new(self.block_requests.clone(), id * REQ_SIZE, REQ_SIZE);
-            let req = BlockReq {
-                type_: ReqType::In as _,
-                reserved: 0,
-                sector: bio_request.sid_range().start.to_raw(),
-            };
-            req_slice.write_val(0, &req).unwrap();
-            req_slice.sync().unwrap();
-            req_slice
-        };
+    /// Submits a request to the `queue_idx`-th virtqueue, this function is non-blocking.
+    fn submit(&self, queue_idx: usize, bio_request: BioRequest) {
+        // Flushes any cached data from the guest to the persistent storage on the host.
+        // This will be ignored if the device doesn't support the `VIRTIO_BLK_F_FLUSH` feature.
+        if bio_request.type_() == BioType::Flush && self.features.support_flush {
+            bio_request.bios().for_each(|bio| {
+                bio.complete(BioStatus::Complete);
+            });
+            return;
+        }
 
-        let resp_slice = {
-            let resp_slice =
-                DmaStreamSlice::new(self.block_responses.clone(), id * RESP_SIZE, RESP_SIZE);
-            resp_slice.write_val(0, &BlockResp::default()).unwrap();
-            resp_slice
-        };
+        self.queues[queue_idx].submit(bio_request);
+    }
+}
 
-        let outputs = {
-            let mut outputs: Vec<&DmaStreamSlice<_>> =
-                Vec::with_capacity(bio_request.num_segments() + 1);
-            let dma_slices_iter = bio_request.bios().flat_map(|bio| {
-                bio.segments()
-                    .iter()
-                    .map(|segment| segment.inner_dma_slice())
-            });
-            outputs.extend(dma_slices_iter);
-            outputs.push(&resp_slice);
-            outputs
+/// A virtqueue of the device, with the buffers of the headers and the
+/// responses of its requests.
+#[derive(Debug)]
+struct BlockQueue {
+    queue: SpinLock<VirtQueue>,
+    block_requests: DmaStream,
+    block_responses: DmaStream,
+    id_allocator: SpinLock<IdAlloc>,
+    submitted_requests: SpinLock<BTreeMap<u16, SubmittedRequest>>,
+    /// The submitters waiting for the descriptors to be freed.
+    free_desc_wait_queue: WaitQueue,
+}
+
+impl BlockQueue {
+    fn new(idx: u16, transport: &mut dyn VirtioTransport) -> Result<Self, VirtioDeviceError> {
+        let queue = VirtQueue::new(idx, DeviceInner::QUEUE_SIZE, transport)?;
+        let block_requests = {
+            let segment = FrameAllocOptions::new().alloc_segment(1).unwrap();
+            DmaStream::map(segment.into(), DmaDirection::Bidirectional, false).unwrap()
         };
+        assert!(DeviceInner::QUEUE_SIZE as usize * REQ_SIZE <= block_requests.nbytes());
+        let block_responses = {
+            let segment = FrameAllocOptions::new().alloc_segment(1).unwrap();
+            DmaStream::map(segment.into(), DmaDirection::Bidirectional, false).unwrap()
+        };
+        assert!(DeviceInner::QUEUE_SIZE as usize * RESP_SIZE <= block_responses.nbytes());
 
-        let num_used_descs = outputs.len() + 1;
-        // FIXME: Split the request if it is too big
-        if num_used_descs > Self::QUEUE_SIZE as usize {
-            panic!("The request size surpasses the queue size");
-        }
+        Ok(Self {
+            queue: SpinLock::new(queue),
+            block_requests,
+            block_responses,
+            id_allocator: SpinLock::new(IdAlloc::with_capacity(DeviceInner::QUEUE_SIZE as usize)),
+            submitted_requests: SpinLock::new(BTreeMap::new()),
+            free_desc_wait_queue: WaitQueue::new(),
+        })
+    }
+
+    /// Handles the irq issued from the queue.
+    ///
+    /// The interrupts of the queue are suppressed while the used ring is being
+    /// drained, so the requests completed meanwhile are handled in the same
+    /// batch without raising more interrupts.
+    fn handle_irq(&self) {
+        info!("Virtio block device handle irq");
+        // When we enter the IRQs handling function,
+        // IRQs have already been disabled,
+        // so there is no need to call `disable_irq`.
+        self.queue.lock().disable_callback();
 
         loop {
-            let mut queue = self.queue.disable_irq().lock();
-            if num_used_descs > queue.available_desc() {
+            let completed_requests = self.pop_completed_requests();
+            if !completed_requests.is_empty() {
+                self.complete_requests(completed_requests);
+                self.free_desc_wait_queue.wake_all();
                 continue;
             }
-            let token = queue
-                .add_dma_buf(&[&req_slice], outputs.as_slice())
-                .expect("add queue failed");
-            if queue.should_notify() {
-                queue.notify();
-            }
 
-            // Records the submitted request
-            let submitted_request = SubmittedRequest::new(id as u16, bio_request);
-            self.submitted_requests
-                .disable_irq()
-                .lock()
-                .insert(token, submitted_request);
-            return;
+            // Re-enable the interrupts, and check again in case that some
+            // requests complete before the interrupts are enabled.
+            let mut queue = self.queue.lock();
+            queue.enable_callback();
+            if !queue.can_pop() {
+                return;
+            }
+            queue.disable_callback();
         }
     }
 
-    /// Writes data to the device, this function is non-blocking.
-    fn write(&self, bio_request: BioRequest) {
-        let id = self.id_allocator.disable_irq().lock().alloc().unwrap();
-        let req_slice = {
-            let req_slice =
-                DmaStreamSlice::new(self.block_requests.clone(), id * REQ_SIZE, REQ_SIZE);
-            let req = BlockReq {
-                type_: ReqType::Out as _,
-                reserved: 0,
-                sector: bio_request.sid_range().start.to_raw(),
-            };
-            req_slice.write_val(0, &req).unwrap();
-            req_slice.sync().unwrap();
-            req_slice
-        };
+    /// Pops all the completed requests in the used ring.
+    fn pop_completed_requests(&self) -> Vec<SubmittedRequest> {
+        let mut queue = self.queue.lock();
+        let mut submitted_requests = self.submitted_requests.lock();
 
-        let resp_slice = {
-            let resp_slice =
-                DmaStreamSlice::new(self.block_responses.clone(), id * RESP_SIZE, RESP_SIZE);
-            resp_slice.write_val(0, &BlockResp::default()).unwrap();
-            resp_slice
-        };
+        let mut completed_requests = Vec::new();
+        while let Ok((token, _)) = queue.pop_used() {
+            completed_requests.push(submitted_requests.remove(&token).unwrap());
+        }
+        completed_requests
+    }
 
-        let inputs = {
-            let mut inputs: Vec<&DmaStreamSlice<_>> =
-                Vec::with_capacity(bio_request.num_segments() + 1);
-            inputs.push(&req_slice);
-            let dma_slices_iter = bio_request.bios().flat_map(|bio| {
-                bio.segments()
-                    .iter()
-                    .map(|segment| segment.inner_dma_slice())
-            });
-            inputs.extend(dma_slices_iter);
-            inputs
+    fn complete_requests(&self, completed_requests: Vec<SubmittedRequest>) {
+        // Handles the responses
+        let statuses = {
+            let mut id_allocator = self.id_allocator.lock();
+            completed_requests
+                .iter()
+                .map(|complete_request| {
+                    let id = complete_request.id as usize;
+                    let resp_slice =
+                        DmaStreamSlice::new(&self.block_responses, id * RESP_SIZE, RESP_SIZE);
+                    resp_slice.sync().unwrap();
+                    let resp: BlockResp = resp_slice.read_val(0).unwrap();
+                    id_allocator.free(id);
+                    match RespStatus::try_from(resp.status) {
+                        Ok(RespStatus::Ok) => BioStatus::Complete,
+                        Ok(RespStatus::Unsupported) => BioStatus::NotSupported,
+                        _ => BioStatus::IoError,
+                    }
+                })
+                .collect::<Vec<_>>()
         };
 
-        let num_used_descs = inputs.len() + 1;
-        // FIXME: Split the request if it is too big
-        if num_used_descs > Self::QUEUE_SIZE as usize {
-            panic!("The request size surpasses the queue size");
-        }
-        loop {
-            let mut queue = self.queue.disable_irq().lock();
-            if num_used_descs > queue.available_desc() {
-                continue;
-            }
-            let token = queue
-                .add_dma_buf(inputs.as_slice(), &[&resp_slice])
-                .expect("add queue failed");
-            if queue.should_notify() {
-                queue.notify();
+        for (complete_request, status) in completed_requests.into_iter().zip(statuses) {
+            // Synchronize DMA mapping if read from the device
+            if status == BioStatus::Complete
+                && complete_request.bio_request.type_() == BioType::Read
+            {
+                complete_request
+                    .bio_request
+                    .bios()
+                    .flat_map(|bio| {
+                        bio.segments()
+                            .iter()
+                            .map(|segment| segment.inner_dma_slice())
+                    })
+                    .for_each(|dma_slice| dma_slice.sync().unwrap());
             }
 
-            // Records the submitted request
-            let submitted_request = SubmittedRequest::new(id as u16, bio_request);
-            self.submitted_requests
-                .disable_irq()
-                .lock()
-                .insert(token, submitted_request);
-            return;
+            // Completes the bio request
+            complete_request.bio_request.bios().for_each(|bio| {
+                bio.complete(status);
+            });
         }
     }
 
-    /// Flushes any cached data from the guest to the persistent storage on the host.
-    /// This will be ignored if the device doesn't support the `VIRTIO_BLK_F_FLUSH` feature.
-    fn flush(&self, bio_request: BioRequest) {
-        if self.features.support_flush {
-            bio_request.bios().for_each(|bio| {
-                bio.complete(BioStatus::Complete);
-            });
-            return;
-        }
+    /// Submits a request to the queue, this function is non-blocking.
+    fn submit(&self, bio_request: BioRequest) {
+        let req_type = match bio_request.type_() {
+            BioType::Read => ReqType::In,
+            BioType::Write => ReqType::Out,
+            BioType::Flush => ReqType::Flush,
+            BioType::Discard => todo!(),
+        };
 
         let id = self.id_allocator.disable_irq().lock().alloc().unwrap();
         let req_slice = {
-            let req_slice = DmaStreamSlice::new(&self.block_requests, id * REQ_SIZE, REQ_SIZE);
+            let req_slice =
+                DmaStreamSlice::new(self.block_requests.clone(), id * REQ_SIZE, REQ_SIZE);
             let req = BlockReq {
-                type_: ReqType::Flush as _,
+                type_: req_type as _,
                 reserved: 0,
                 sector: bio_request.sid_range().start.to_raw(),
             };
@@ -455,32 +431,61 @@ impl DeviceInner {
         };
 
         let resp_slice = {
-            let resp_slice = DmaStreamSlice::new(&self.block_responses, id * RESP_SIZE, RESP_SIZE);
+            let resp_slice =
+                DmaStreamSlice::new(self.block_responses.clone(), id * RESP_SIZE, RESP_SIZE);
             resp_slice.write_val(0, &BlockResp::default()).unwrap();
             resp_slice
         };
 
-        let num_used_descs = 1;
-        loop {
-            let mut queue = self.queue.disable_irq().lock();
-            if num_used_descs > queue.available_desc() {
-                continue;
+        // The device reads the request header and the data to write, and then
+        // writes the data read and the response.
+        let dma_slices_iter = bio_request.bios().flat_map(|bio| {
+            bio.segments()
+                .iter()
+                .map(|segment| segment.inner_dma_slice())
+        });
+        let (inputs, outputs) = match req_type {
+            ReqType::In => {
+                let mut outputs: Vec<&DmaStreamSlice<_>> =
+                    Vec::with_capacity(bio_request.num_segments() + 1);
+                outputs.extend(dma_slices_iter);
+                outputs.push(&resp_slice);
+                (vec![&req_slice], outputs)
             }
-            let token = queue
-                .add_dma_buf(&[&req_slice], &[&resp_slice])
-                .expect("add queue failed");
-            if queue.should_notify() {
-                queue.notify();
+            ReqType::Out => {
+                let mut inputs: Vec<&DmaStreamSlice<_>> =
+                    Vec::with_capacity(bio_request.num_segments() + 1);
+                inputs.push(&req_slice);
+                inputs.extend(dma_slices_iter);
+                (inputs, vec![&resp_slice])
             }
+            _ => (vec![&req_slice], vec![&resp_slice]),
+        };
 
-            // Records the submitted request
-            let submitted_request = SubmittedRequest::new(id as u16, bio_request);
-            self.submitted_requests
-                .disable_irq()
-                .lock()
-                .insert(token, submitted_request);
-            return;
+        let num_used_descs = inputs.len() + outputs.len();
+        // FIXME: Split the request if it is too big
+        if num_used_descs > DeviceInner::QUEUE_SIZE as usize {
+            panic!("The request size surpasses the queue size");
+        }
+
+        // Sleep until the completed requests free enough descriptors.
+        let mut queue = self.free_desc_wait_queue.wait_until(|| {
+            let queue = self.queue.disable_irq().lock();
+            (num_used_descs <= queue.available_desc()).then_some(queue)
+        });
+        let token = queue
+            .add_dma_buf(inputs.as_slice(), outputs.as_slice())
+            .expect("add queue failed");
+        if queue.should_notify() {
+            queue.notify();
         }
+
+        // Records the submitted request
+        let submitted_request = SubmittedRequest::new(id as u16, bio_request);
+        self.submitted_requests
+            .disable_irq()
+            .lock()
+            .insert(token, submitted_request);
     }
 }
 
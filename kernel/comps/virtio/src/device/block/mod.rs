@@ -119,6 +119,7 @@ pub struct VirtioBlockTopology {
 #[repr(C)]
 pub struct VirtioBlockFeature {
     support_flush: bool,
+    support_multiqueue: bool,
 }
 
 impl VirtioBlockConfig {
@@ -185,6 +186,13 @@ impl ConfigManager<VirtioBlockConfig> {
             .unwrap() as usize
     }
 
+    /// Returns the number of virtqueues, which is valid only if `VIRTIO_BLK_F_MQ`
+    /// is negotiated.
+    pub(self) fn num_queues(&self) -> u16 {
+        self.read_once::<u16>(offset_of!(VirtioBlockConfig, num_queues))
+            .unwrap()
+    }
+
     pub(self) fn capacity_sectors(&self) -> usize {
         let cap_low = self
             .read_once::<u32>(offset_of!(VirtioBlockConfig, capacity))
@@ -199,7 +207,14 @@ impl ConfigManager<VirtioBlockConfig> {
 
 impl VirtioBlockFeature {
     pub(self) fn new(transport: &dyn VirtioTransport) -> Self {
-        let support_flush = transport.read_device_features() & BlockFeatures::FLUSH.bits() == 1;
-        VirtioBlockFeature { support_flush }
+        let device_features = transport.read_device_features();
+        let support_flush = device_features & BlockFeatures::FLUSH.bits() == 1;
+        // The number of queues is only in the config space of modern devices.
+        let support_multiqueue =
+            device_features & BlockFeatures::MQ.bits() != 0 && !transport.is_legacy_version();
+        VirtioBlockFeature {
+            support_flush,
+            support_multiqueue,
+        }
     }
 }
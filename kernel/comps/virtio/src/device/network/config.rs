@@ -51,7 +51,18 @@ bitflags! {
 
 impl NetworkFeatures {
     pub fn support_features() -> Self {
-        NetworkFeatures::VIRTIO_NET_F_MAC | NetworkFeatures::VIRTIO_NET_F_STATUS
+        NetworkFeatures::VIRTIO_NET_F_MAC
+            | NetworkFeatures::VIRTIO_NET_F_STATUS
+            | NetworkFeatures::VIRTIO_NET_F_CTRL_VQ
+            | NetworkFeatures::VIRTIO_NET_F_MQ
+            | NetworkFeatures::VIRTIO_NET_F_RSS
+            | NetworkFeatures::VIRTIO_NET_F_CSUM
+            | NetworkFeatures::VIRTIO_NET_F_GUEST_CSUM
+            | NetworkFeatures::VIRTIO_NET_F_HOST_TSO4
+            | NetworkFeatures::VIRTIO_NET_F_HOST_TSO6
+            | NetworkFeatures::VIRTIO_NET_F_GUEST_TSO4
+            | NetworkFeatures::VIRTIO_NET_F_GUEST_TSO6
+            | NetworkFeatures::VIRTIO_NET_F_MRG_RXBUF
     }
 }
 
@@ -69,13 +80,13 @@ bitflags! {
 pub struct VirtioNetConfig {
     pub mac: EthernetAddr,
     pub status: Status,
-    max_virtqueue_pairs: u16,
+    pub max_virtqueue_pairs: u16,
     pub mtu: u16,
     speed: u32,
     duplex: u8,
-    rss_max_key_size: u8,
-    rss_max_indirection_table_length: u16,
-    supported_hash_types: u32,
+    pub rss_max_key_size: u8,
+    pub rss_max_indirection_table_length: u16,
+    pub supported_hash_types: u32,
 }
 
 impl VirtioNetConfig {
@@ -100,11 +111,12 @@ impl ConfigManager<VirtioNetConfig> {
         net_config.status.bits = self
             .read_once::<u16>(offset_of!(VirtioNetConfig, status))
             .unwrap();
+        // This field is valid only if `VIRTIO_NET_F_MQ` or `VIRTIO_NET_F_RSS` is negotiated.
+        net_config.max_virtqueue_pairs = self
+            .read_once::<u16>(offset_of!(VirtioNetConfig, max_virtqueue_pairs))
+            .unwrap();
 
         if self.is_modern() {
-            net_config.max_virtqueue_pairs = self
-                .read_once::<u16>(offset_of!(VirtioNetConfig, max_virtqueue_pairs))
-                .unwrap();
             net_config.mtu = self
                 .read_once::<u16>(offset_of!(VirtioNetConfig, mtu))
                 .unwrap();
@@ -0,0 +1,160 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! The control virtqueue of virtio-net devices.
+
+use alloc::vec::Vec;
+use core::{hint::spin_loop, mem::size_of};
+
+use log::warn;
+use ostd::{
+    mm::{DmaDirection, DmaStream, DmaStreamSlice, FrameAllocOptions, VmIo, PAGE_SIZE},
+    Pod,
+};
+
+use crate::{device::VirtioDeviceError, queue::VirtQueue, transport::VirtioTransport};
+
+const VIRTIO_NET_CTRL_MQ: u8 = 4;
+const VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET: u8 = 0;
+const VIRTIO_NET_CTRL_MQ_RSS_CONFIG: u8 = 1;
+
+const VIRTIO_NET_OK: u8 = 0;
+
+/// The hash types of RSS that cover the TCP and UDP flows over IPv4.
+const VIRTIO_NET_RSS_HASH_TYPE_IPV4: u32 = 1 << 0;
+const VIRTIO_NET_RSS_HASH_TYPE_TCPV4: u32 = 1 << 1;
+const VIRTIO_NET_RSS_HASH_TYPE_UDPV4: u32 = 1 << 3;
+
+/// The default Toeplitz hash key, which is also used by Linux and many NICs.
+const RSS_HASH_KEY: [u8; 40] = [
+    0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2, 0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+    0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4, 0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+    0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa,
+];
+
+/// The maximum length of the RSS indirection table that we use.
+const MAX_INDIRECTION_TABLE_LEN: u16 = 128;
+
+const CTRL_QUEUE_SIZE: u16 = 2;
+
+#[derive(Debug, Clone, Copy, Pod)]
+#[repr(C)]
+struct CtrlHeader {
+    class: u8,
+    command: u8,
+}
+
+/// The control virtqueue.
+///
+/// The commands are only sent during initialization, so they are done
+/// synchronously by polling the virtqueue.
+pub(super) struct CtrlQueue {
+    queue: VirtQueue,
+    /// The buffer holding the command header and data, followed by the ack.
+    buffer: DmaStream,
+}
+
+impl CtrlQueue {
+    pub(super) fn new(idx: u16, transport: &mut dyn VirtioTransport) -> Self {
+        let mut queue =
+            VirtQueue::new(idx, CTRL_QUEUE_SIZE, transport).expect("creating ctrl queue fails");
+        // The commands are polled until they complete.
+        queue.disable_callback();
+
+        let buffer = {
+            let segment = FrameAllocOptions::new().alloc_segment(1).unwrap();
+            DmaStream::map(segment.into(), DmaDirection::Bidirectional, false).unwrap()
+        };
+
+        Self { queue, buffer }
+    }
+
+    /// Sets the number of queue pairs that the device uses.
+    ///
+    /// The device steers the received packets of a flow to the queue pair
+    /// that was last used to send packets of the flow.
+    pub(super) fn set_queue_pairs(&mut self, nr_pairs: u16) -> Result<(), VirtioDeviceError> {
+        self.send_command(
+            VIRTIO_NET_CTRL_MQ,
+            VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET,
+            &nr_pairs.to_le_bytes(),
+        )
+    }
+
+    /// Enables RSS, which steers the received packets to the queue pairs by
+    /// the Toeplitz hashes of their flows.
+    pub(super) fn set_rss(
+        &mut self,
+        nr_pairs: u16,
+        max_key_size: u8,
+        max_indirection_table_len: u16,
+        supported_hash_types: u32,
+    ) -> Result<(), VirtioDeviceError> {
+        let hash_types = supported_hash_types
+            & (VIRTIO_NET_RSS_HASH_TYPE_IPV4
+                | VIRTIO_NET_RSS_HASH_TYPE_TCPV4
+                | VIRTIO_NET_RSS_HASH_TYPE_UDPV4);
+        let key_len = RSS_HASH_KEY.len().min(max_key_size as usize);
+        // The length of the indirection table must be a power of two.
+        let table_len = if max_indirection_table_len == 0 {
+            1
+        } else {
+            let len = MAX_INDIRECTION_TABLE_LEN.min(max_indirection_table_len);
+            1 << (u16::BITS - 1 - len.leading_zeros())
+        };
+
+        // Build `struct virtio_net_rss_config`.
+        let mut data = Vec::new();
+        data.extend_from_slice(&hash_types.to_le_bytes());
+        data.extend_from_slice(&(table_len - 1).to_le_bytes()); // indirection_table_mask
+        data.extend_from_slice(&0u16.to_le_bytes()); // unclassified_queue
+        for i in 0..table_len {
+            data.extend_from_slice(&(i % nr_pairs).to_le_bytes());
+        }
+        data.extend_from_slice(&nr_pairs.to_le_bytes()); // max_tx_vq
+        data.push(key_len as u8);
+        data.extend_from_slice(&RSS_HASH_KEY[..key_len]);
+
+        self.send_command(VIRTIO_NET_CTRL_MQ, VIRTIO_NET_CTRL_MQ_RSS_CONFIG, &data)
+    }
+
+    fn send_command(
+        &mut self,
+        class: u8,
+        command: u8,
+        data: &[u8],
+    ) -> Result<(), VirtioDeviceError> {
+        let header_len = size_of::<CtrlHeader>();
+        let req_len = header_len + data.len();
+        assert!(req_len < PAGE_SIZE);
+
+        self.buffer
+            .write_val(0, &CtrlHeader { class, command })
+            .unwrap();
+        self.buffer.write_bytes(header_len, data).unwrap();
+        self.buffer.write_val(req_len, &u8::MAX).unwrap();
+        self.buffer.sync(0..req_len + 1).unwrap();
+
+        let req_slice = DmaStreamSlice::new(&self.buffer, 0, req_len);
+        let ack_slice = DmaStreamSlice::new(&self.buffer, req_len, 1);
+        let token = self.queue.add_dma_buf(&[&req_slice], &[&ack_slice])?;
+        if self.queue.should_notify() {
+            self.queue.notify();
+        }
+        while !self.queue.can_pop() {
+            spin_loop();
+        }
+        self.queue.pop_used_with_token(token)?;
+
+        ack_slice.sync().unwrap();
+        let ack: u8 = ack_slice.read_val(0).unwrap();
+        if ack != VIRTIO_NET_OK {
+            warn!(
+                "virtio-net ctrl command (class = {}, command = {}) fails",
+                class, command
+            );
+            return Err(VirtioDeviceError::QueueUnknownError);
+        }
+
+        Ok(())
+    }
+}
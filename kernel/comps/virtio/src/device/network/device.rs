@@ -1,20 +1,35 @@
 // SPDX-License-Identifier: MPL-2.0
 
 use alloc::{
-    boxed::Box, collections::linked_list::LinkedList, string::ToString, sync::Arc, vec::Vec,
+    boxed::Box, collections::linked_list::LinkedList, string::ToString, sync::Arc, vec, vec::Vec,
+};
+use core::{
+    fmt::Debug,
+    mem::size_of,
+    sync::atomic::{fence, Ordering},
 };
-use core::{fmt::Debug, mem::size_of};
 
 use aster_bigtcp::device::{Checksum, DeviceCapabilities, Medium};
 use aster_network::{
     AnyNetworkDevice, EthernetAddr, RxBuffer, TxBuffer, VirtioNetError, RX_BUFFER_POOL,
+    TX_BUFFER_LEN,
 };
 use aster_softirq::BottomHalfDisabled;
 use aster_util::slot_vec::SlotVec;
-use log::{debug, warn};
-use ostd::{mm::DmaStream, sync::SpinLock, trap::TrapFrame};
+use log::{debug, info, warn};
+use ostd::{
+    cpu::{current_cpu_racy, num_cpus},
+    mm::{DmaStream, VmWriter, PAGE_SIZE},
+    sync::SpinLock,
+    trap::TrapFrame,
+};
 
-use super::{config::VirtioNetConfig, header::VirtioNetHdr};
+use super::{
+    config::VirtioNetConfig,
+    ctrl::CtrlQueue,
+    header::{Flags, VirtioNetHdr, VIRTIO_NET_HDR_LEN},
+    offload::{L4Frame, TsoFrame},
+};
 use crate::{
     device::{network::config::NetworkFeatures, VirtioDeviceError},
     queue::{QueueError, VirtQueue},
@@ -26,15 +41,58 @@ pub struct NetworkDevice {
     // For smoltcp use
     caps: DeviceCapabilities,
     mac_addr: EthernetAddr,
+    /// The queue pairs, one per CPU if the device supports multiqueue.
+    ///
+    /// Packets are sent from the queue pair of the current CPU. The device
+    /// steers the received packets of a flow to the queue pair that sends
+    /// the flow, or by the flow hash if RSS is enabled.
+    queue_pairs: Vec<QueuePair>,
+    transport: Box<dyn VirtioTransport>,
+    /// The number of packets that can still be received in the current NAPI-style poll.
+    ///
+    /// If there is no such poll, this is `None` and the number is unlimited.
+    recv_budget: Option<usize>,
+}
+
+/// A pair of receive and send queues.
+struct QueuePair {
     send_queue: VirtQueue,
     recv_queue: VirtQueue,
-    // Since the virtio net header remains consistent for each sending packet,
-    // we store it to avoid recreating the header repeatedly.
-    header: VirtioNetHdr,
     tx_buffers: Vec<Option<TxBuffer>>,
     rx_buffers: SlotVec<RxBuffer>,
-    transport: Box<dyn VirtioTransport>,
     poll_stat: PollStatistics,
+    offloads: Offloads,
+    /// The TCP packet that is being coalesced from the sent segments.
+    ///
+    /// The packet is sent when a segment cannot be coalesced or the poll ends.
+    pending_tso: Option<TsoFrame>,
+}
+
+/// The offloads that are negotiated with the device.
+#[derive(Clone, Copy, Debug)]
+struct Offloads {
+    /// Whether the device completes the checksums of the sent packets.
+    tx_csum: bool,
+    /// Whether the driver verifies the checksums of the received packets.
+    rx_csum: bool,
+    /// Whether the device segments the sent TCP packets over IPv4.
+    tso4: bool,
+    /// Whether the device segments the sent TCP packets over IPv6.
+    tso6: bool,
+    /// Whether a received packet may span multiple buffers.
+    mrg_rxbuf: bool,
+}
+
+impl Offloads {
+    fn new(features: NetworkFeatures) -> Self {
+        Self {
+            tx_csum: features.contains(NetworkFeatures::VIRTIO_NET_F_CSUM),
+            rx_csum: features.contains(NetworkFeatures::VIRTIO_NET_F_GUEST_CSUM),
+            tso4: features.contains(NetworkFeatures::VIRTIO_NET_F_HOST_TSO4),
+            tso6: features.contains(NetworkFeatures::VIRTIO_NET_F_HOST_TSO6),
+            mrg_rxbuf: features.contains(NetworkFeatures::VIRTIO_NET_F_MRG_RXBUF),
+        }
+    }
 }
 
 /// Structure to track the number of packets sent and received during a single polling process.
@@ -56,7 +114,7 @@ impl NetworkDevice {
     pub(crate) fn negotiate_features(device_features: u64) -> u64 {
         let device_features = NetworkFeatures::from_bits_truncate(device_features);
         let supported_features = NetworkFeatures::support_features();
-        let network_features = device_features & supported_features;
+        let mut network_features = device_features & supported_features;
 
         if network_features != device_features {
             warn!(
@@ -65,6 +123,21 @@ impl NetworkDevice {
             );
         }
 
+        // The segmentation offloads depend on the checksum offloads. In addition, the large
+        // packets can be received only in merged buffers, since each buffer is one page.
+        if !network_features.contains(NetworkFeatures::VIRTIO_NET_F_CSUM) {
+            network_features.remove(
+                NetworkFeatures::VIRTIO_NET_F_HOST_TSO4 | NetworkFeatures::VIRTIO_NET_F_HOST_TSO6,
+            );
+        }
+        if !network_features.contains(
+            NetworkFeatures::VIRTIO_NET_F_GUEST_CSUM | NetworkFeatures::VIRTIO_NET_F_MRG_RXBUF,
+        ) {
+            network_features.remove(
+                NetworkFeatures::VIRTIO_NET_F_GUEST_TSO4 | NetworkFeatures::VIRTIO_NET_F_GUEST_TSO6,
+            );
+        }
+
         debug!("{:?}", network_features);
         network_features.bits()
     }
@@ -81,40 +154,28 @@ impl NetworkDevice {
 
         let caps = init_caps(&features, &config);
 
-        let mut send_queue = VirtQueue::new(QUEUE_SEND, QUEUE_SIZE, transport.as_mut())
-            .expect("create send queue fails");
-        send_queue.disable_callback();
-
-        let mut recv_queue = VirtQueue::new(QUEUE_RECV, QUEUE_SIZE, transport.as_mut())
-            .expect("creating recv queue fails");
-
-        let tx_buffers = (0..QUEUE_SIZE).map(|_| None).collect();
-
-        let mut rx_buffers = SlotVec::new();
-        for i in 0..QUEUE_SIZE {
-            let rx_pool = RX_BUFFER_POOL.get().unwrap();
-            let rx_buffer = RxBuffer::new(size_of::<VirtioNetHdr>(), rx_pool);
-            let token = recv_queue.add_dma_buf(&[], &[&rx_buffer])?;
-            assert_eq!(i, token);
-            assert_eq!(rx_buffers.put(rx_buffer) as u16, i);
-        }
+        let is_multiqueue = features.contains(NetworkFeatures::VIRTIO_NET_F_CTRL_VQ)
+            && features
+                .intersects(NetworkFeatures::VIRTIO_NET_F_MQ | NetworkFeatures::VIRTIO_NET_F_RSS)
+            && config.max_virtqueue_pairs > 1;
+        let nr_pairs = if is_multiqueue {
+            config.max_virtqueue_pairs.min(num_cpus() as u16)
+        } else {
+            1
+        };
 
-        if recv_queue.should_notify() {
-            debug!("notify receive queue");
-            recv_queue.notify();
-        }
+        let offloads = Offloads::new(features);
+        let queue_pairs = (0..nr_pairs)
+            .map(|pair| QueuePair::new(pair, offloads, transport.as_mut()))
+            .collect::<Result<Vec<_>, _>>()?;
 
         let mut device = Self {
             config_manager,
             caps,
             mac_addr,
-            send_queue,
-            recv_queue,
-            header: VirtioNetHdr::default(),
-            tx_buffers,
-            rx_buffers,
+            queue_pairs,
             transport,
-            poll_stat: PollStatistics::new(),
+            recv_budget: None,
         };
 
         /// Interrupt handler if network device config space changes
@@ -134,17 +195,49 @@ impl NetworkDevice {
             .transport
             .register_cfg_callback(Box::new(config_space_change))
             .unwrap();
-        device
-            .transport
-            .register_queue_callback(QUEUE_SEND, Box::new(handle_send_event), true)
-            .unwrap();
-        device
-            .transport
-            .register_queue_callback(QUEUE_RECV, Box::new(handle_recv_event), true)
-            .unwrap();
+        // Each queue gets its own interrupt so that the queues do not contend
+        // for a shared interrupt line.
+        for pair in 0..nr_pairs {
+            device
+                .transport
+                .register_queue_callback(send_queue_idx(pair), Box::new(handle_send_event), true)
+                .unwrap();
+            device
+                .transport
+                .register_queue_callback(recv_queue_idx(pair), Box::new(handle_recv_event), true)
+                .unwrap();
+        }
+
+        // The control queue is after all the queue pairs that the device supports.
+        let ctrl_queue = features
+            .contains(NetworkFeatures::VIRTIO_NET_F_CTRL_VQ)
+            .then(|| {
+                let max_pairs = if features.intersects(
+                    NetworkFeatures::VIRTIO_NET_F_MQ | NetworkFeatures::VIRTIO_NET_F_RSS,
+                ) {
+                    config.max_virtqueue_pairs
+                } else {
+                    1
+                };
+                CtrlQueue::new(2 * max_pairs, device.transport.as_mut())
+            });
 
         device.transport.finish_init();
 
+        if let Some(mut ctrl_queue) = ctrl_queue.filter(|_| is_multiqueue) {
+            if features.contains(NetworkFeatures::VIRTIO_NET_F_RSS) {
+                ctrl_queue.set_rss(
+                    nr_pairs,
+                    config.rss_max_key_size,
+                    config.rss_max_indirection_table_length,
+                    config.supported_hash_types,
+                )?;
+            } else {
+                ctrl_queue.set_queue_pairs(nr_pairs)?;
+            }
+            info!("virtio-net uses {} queue pairs", nr_pairs);
+        }
+
         aster_network::register_device(
             super::DEVICE_NAME.to_string(),
             Arc::new(SpinLock::new(device)),
@@ -152,6 +245,83 @@ impl NetworkDevice {
         Ok(())
     }
 
+    /// Returns the queue pair that the current CPU sends packets from.
+    fn local_pair(&mut self) -> &mut QueuePair {
+        let pair = current_cpu_racy().as_usize() % self.queue_pairs.len();
+        &mut self.queue_pairs[pair]
+    }
+
+    /// Receives a packet from network.
+    ///
+    /// The queue pair of the current CPU is checked first, since its buffers
+    /// are likely to be in the local cache.
+    fn receive(&mut self) -> Result<RxBuffer, VirtioNetError> {
+        let nr_pairs = self.queue_pairs.len();
+        let local = current_cpu_racy().as_usize() % nr_pairs;
+
+        if self.recv_budget == Some(0) {
+            return Err(VirtioNetError::NotReady);
+        }
+
+        for i in 0..nr_pairs {
+            let pair = &mut self.queue_pairs[(local + i) % nr_pairs];
+            if pair.recv_queue.can_pop() {
+                if let Some(budget) = self.recv_budget.as_mut() {
+                    *budget -= 1;
+                }
+                return pair.receive();
+            }
+        }
+
+        Err(VirtioNetError::NotReady)
+    }
+
+    /// Sends a packet to network.
+    fn send(&mut self, packet: &[u8]) -> Result<(), VirtioNetError> {
+        self.local_pair().send(packet)
+    }
+}
+
+impl QueuePair {
+    fn new(
+        pair: u16,
+        offloads: Offloads,
+        transport: &mut dyn VirtioTransport,
+    ) -> Result<Self, VirtioDeviceError> {
+        let mut send_queue = VirtQueue::new(send_queue_idx(pair), QUEUE_SIZE, transport)
+            .expect("create send queue fails");
+        send_queue.disable_callback();
+
+        let mut recv_queue = VirtQueue::new(recv_queue_idx(pair), QUEUE_SIZE, transport)
+            .expect("creating recv queue fails");
+
+        let tx_buffers = (0..QUEUE_SIZE).map(|_| None).collect();
+
+        let mut rx_buffers = SlotVec::new();
+        for i in 0..QUEUE_SIZE {
+            let rx_pool = RX_BUFFER_POOL.get().unwrap();
+            let rx_buffer = RxBuffer::new(size_of::<VirtioNetHdr>(), rx_pool);
+            let token = recv_queue.add_dma_buf(&[], &[&rx_buffer])?;
+            assert_eq!(i, token);
+            assert_eq!(rx_buffers.put(rx_buffer) as u16, i);
+        }
+
+        if recv_queue.should_notify() {
+            debug!("notify receive queue");
+            recv_queue.notify();
+        }
+
+        Ok(Self {
+            send_queue,
+            recv_queue,
+            tx_buffers,
+            rx_buffers,
+            poll_stat: PollStatistics::new(),
+            offloads,
+            pending_tso: None,
+        })
+    }
+
     /// Adds a `RxBuffer` to the receive queue.
     fn add_rx_buffer(&mut self, rx_buffer: RxBuffer) -> Result<(), VirtioNetError> {
         let token = self
@@ -172,30 +342,129 @@ impl NetworkDevice {
     }
 
     /// Receives a packet from network.
+    ///
+    /// The packet is dropped with [`VirtioNetError::BadPacket`] if its checksum is bad.
     fn receive(&mut self) -> Result<RxBuffer, VirtioNetError> {
+        let (mut rx_buffer, len) = self.pop_rx_buffer()?;
+        rx_buffer.set_packet_len(len - VIRTIO_NET_HDR_LEN);
+
+        let header = rx_buffer.header::<VirtioNetHdr>();
+        if self.offloads.mrg_rxbuf {
+            // The device uses all the buffers of a packet before notifying the driver.
+            for _ in 1..header.num_buffers() {
+                let (next_buffer, len) = self.pop_rx_buffer()?;
+                rx_buffer.append(next_buffer, len);
+            }
+        }
+
+        // If `VIRTIO_NET_F_GUEST_CSUM` is negotiated, the network stack does not verify the
+        // checksums. So we verify them unless the device has verified them, or the packet is
+        // sent from the host with a partial checksum, which means that it is not corrupted.
+        if self.offloads.rx_csum
+            && !header
+                .flags()
+                .intersects(Flags::VIRTIO_NET_HDR_F_NEEDS_CSUM | Flags::VIRTIO_NET_HDR_F_DATA_VALID)
+        {
+            let mut frame = vec![0u8; rx_buffer.packet_len()];
+            rx_buffer.read_packet(&mut VmWriter::from(frame.as_mut_slice()));
+            if let Some(layout) = L4Frame::parse(&frame) {
+                if !layout.verify_checksum(&frame) {
+                    debug!("drop a received packet with a bad checksum");
+                    return Err(VirtioNetError::BadPacket);
+                }
+            }
+        }
+
+        Ok(rx_buffer)
+    }
+
+    /// Pops a used buffer from the receive queue and adds a new buffer to the queue.
+    ///
+    /// Returns the used buffer and the number of bytes that the device writes to it.
+    fn pop_rx_buffer(&mut self) -> Result<(RxBuffer, usize), VirtioNetError> {
         let (token, len) = self.recv_queue.pop_used().map_err(queue_to_network_error)?;
         debug!("receive packet: token = {}, len = {}", token, len);
-        let mut rx_buffer = self
+        let rx_buffer = self
             .rx_buffers
             .remove(token as usize)
             .ok_or(VirtioNetError::WrongToken)?;
-        rx_buffer.set_packet_len(len as usize - size_of::<VirtioNetHdr>());
         // FIXME: Ideally, we can reuse the returned buffer without creating new buffer.
         // But this requires locking device to be compatible with smoltcp interface.
         let rx_pool = RX_BUFFER_POOL.get().unwrap();
         let new_rx_buffer = RxBuffer::new(size_of::<VirtioNetHdr>(), rx_pool);
         self.add_rx_buffer(new_rx_buffer)?;
-        Ok(rx_buffer)
+        Ok((rx_buffer, len as usize))
     }
 
     /// Sends a packet to network.
+    ///
+    /// If TSO is negotiated, a TCP segment may be held and coalesced with the following
+    /// segments. The coalesced packet is sent by [`Self::flush_tso`].
     fn send(&mut self, packet: &[u8]) -> Result<(), VirtioNetError> {
         if !self.can_send() {
             return Err(VirtioNetError::Busy);
         }
 
-        let tx_buffer = TxBuffer::new(&self.header, packet, &TX_BUFFER_POOL);
+        if let Some(pending_tso) = self.pending_tso.as_mut() {
+            if pending_tso.try_append(packet, TSO_MAX_FRAME_LEN) {
+                return Ok(());
+            }
+            self.flush_tso()?;
+        }
+
+        let layout = if self.offloads.tx_csum {
+            L4Frame::parse(packet)
+        } else {
+            None
+        };
+
+        if let Some(layout) = layout {
+            let can_segment = if layout.is_ipv6() {
+                self.offloads.tso6
+            } else {
+                self.offloads.tso4
+            };
+            if can_segment {
+                if let Some(tso_frame) = TsoFrame::new(packet, layout, TSO_MAX_FRAME_LEN) {
+                    self.pending_tso = Some(tso_frame);
+                    return Ok(());
+                }
+            }
+        }
+
+        let tx_buffer = if let Some(layout) = layout {
+            let tx_buffer =
+                TxBuffer::new(&layout.partial_checksum_header(), packet, &TX_BUFFER_POOL);
+            tx_buffer.write_bytes_at(
+                VIRTIO_NET_HDR_LEN + layout.checksum_field(),
+                &layout.partial_checksum(packet),
+            );
+            tx_buffer
+        } else {
+            TxBuffer::new(&VirtioNetHdr::default(), packet, &TX_BUFFER_POOL)
+        };
+
+        self.submit(tx_buffer, packet.len())
+    }
+
+    /// Sends the pending TCP packet that is coalesced from the sent segments, if any.
+    fn flush_tso(&mut self) -> Result<(), VirtioNetError> {
+        let Some(pending_tso) = self.pending_tso.take() else {
+            return Ok(());
+        };
+
+        let (header, frame) = pending_tso.finish();
+        let tx_buffer = if VIRTIO_NET_HDR_LEN + frame.len() <= TX_BUFFER_LEN {
+            TxBuffer::new(&header, &frame, &TX_BUFFER_POOL)
+        } else {
+            TxBuffer::with_buffer_len(&header, &frame, TSO_TX_BUFFER_LEN, &TSO_TX_BUFFER_POOL)
+        };
+
+        self.submit(tx_buffer, frame.len())
+    }
 
+    /// Adds a `TxBuffer` to the send queue.
+    fn submit(&mut self, tx_buffer: TxBuffer, packet_len: usize) -> Result<(), VirtioNetError> {
         let token = self
             .send_queue
             .add_dma_buf(&[&tx_buffer], &[])
@@ -209,7 +478,7 @@ impl NetworkDevice {
             self.notify_send_queue();
         }
 
-        debug!("send packet, token = {}, len = {}", token, packet.len());
+        debug!("send packet, token = {}, len = {}", token, packet_len);
 
         debug_assert!(self.tx_buffers[token as usize].is_none());
         self.tx_buffers[token as usize] = Some(tx_buffer);
@@ -261,6 +530,25 @@ impl NetworkDevice {
 
         self.poll_stat.received_packet = 0;
     }
+
+    fn can_send(&self) -> bool {
+        // A descriptor is reserved for the pending TCP packet, if any.
+        self.send_queue.available_desc() >= 1 + self.pending_tso.is_some() as usize
+    }
+
+    fn free_processed_tx_buffers(&mut self) {
+        while let Ok((token, _)) = self.send_queue.pop_used() {
+            self.tx_buffers[token as usize] = None;
+        }
+    }
+}
+
+fn recv_queue_idx(pair: u16) -> u16 {
+    2 * pair
+}
+
+fn send_queue_idx(pair: u16) -> u16 {
+    2 * pair + 1
 }
 
 fn queue_to_network_error(err: QueueError) -> VirtioNetError {
@@ -282,29 +570,29 @@ fn init_caps(features: &NetworkFeatures, config: &VirtioNetConfig) -> DeviceCapa
         // If `VIRTIO_NET_F_MTU` is negotiated, the MTU is decided by the device.
         caps.max_transmission_unit = config.mtu as usize;
     } else {
-        // We do not support these features,
-        // so this asserts that they are _not_ negotiated.
-        //
-        // Without these features, the MTU is 1514 bytes per the virtio-net specification
+        // Without this feature, the MTU is 1514 bytes per the virtio-net specification
         // (see "5.1.6.3 Setting Up Receive Buffers" and "5.1.6.2 Packet Transmission").
-        assert!(
-            !features.contains(NetworkFeatures::VIRTIO_NET_F_GUEST_TSO4)
-                && !features.contains(NetworkFeatures::VIRTIO_NET_F_GUEST_TSO6)
-                && !features.contains(NetworkFeatures::VIRTIO_NET_F_GUEST_UFO)
-        );
+        //
+        // The large packets received with `VIRTIO_NET_F_GUEST_TSO4` or
+        // `VIRTIO_NET_F_GUEST_TSO6` span merged buffers, so they are not limited by it.
         caps.max_transmission_unit = 1514;
     }
 
-    // We do not support checksum offloading.
-    // So the features must not be negotiated,
-    // and we must deliver fully checksummed packets to the device
-    // and validate all checksums for packets from the device.
-    assert!(
-        !features.contains(NetworkFeatures::VIRTIO_NET_F_CSUM)
-            && !features.contains(NetworkFeatures::VIRTIO_NET_F_GUEST_CSUM)
-    );
-    caps.checksum.tcp = Checksum::Both;
-    caps.checksum.udp = Checksum::Both;
+    // If `VIRTIO_NET_F_CSUM` is negotiated, the TCP and UDP checksums of the sent packets are
+    // completed by the device. If `VIRTIO_NET_F_GUEST_CSUM` is negotiated, the TCP and UDP
+    // checksums of the received packets are verified by the driver if the device has not
+    // verified them. Otherwise, the network stack should do the work.
+    let l4_checksum = match (
+        features.contains(NetworkFeatures::VIRTIO_NET_F_CSUM),
+        features.contains(NetworkFeatures::VIRTIO_NET_F_GUEST_CSUM),
+    ) {
+        (false, false) => Checksum::Both,
+        (false, true) => Checksum::Tx,
+        (true, false) => Checksum::Rx,
+        (true, true) => Checksum::None,
+    };
+    caps.checksum.tcp = l4_checksum;
+    caps.checksum.udp = l4_checksum;
     caps.checksum.ipv4 = Checksum::Both;
     caps.checksum.icmpv4 = Checksum::Both;
 
@@ -321,11 +609,16 @@ impl AnyNetworkDevice for NetworkDevice {
     }
 
     fn can_receive(&self) -> bool {
-        self.recv_queue.can_pop()
+        self.recv_budget != Some(0)
+            && self
+                .queue_pairs
+                .iter()
+                .any(|pair| pair.recv_queue.can_pop())
     }
 
     fn can_send(&self) -> bool {
-        self.send_queue.available_desc() >= 1
+        let pair = current_cpu_racy().as_usize() % self.queue_pairs.len();
+        self.queue_pairs[pair].can_send()
     }
 
     fn receive(&mut self) -> Result<RxBuffer, VirtioNetError> {
@@ -337,14 +630,52 @@ impl AnyNetworkDevice for NetworkDevice {
     }
 
     fn free_processed_tx_buffers(&mut self) {
-        while let Ok((token, _)) = self.send_queue.pop_used() {
-            self.tx_buffers[token as usize] = None;
-        }
+        self.queue_pairs
+            .iter_mut()
+            .for_each(QueuePair::free_processed_tx_buffers);
     }
 
     fn notify_poll_end(&mut self) {
-        self.notify_send_queue();
-        self.notify_receive_queue();
+        for pair in self.queue_pairs.iter_mut() {
+            // The descriptor is reserved, so this should not fail.
+            if let Err(err) = pair.flush_tso() {
+                warn!("failed to send the coalesced TCP packet: {:?}", err);
+            }
+            pair.notify_send_queue();
+            pair.notify_receive_queue();
+        }
+    }
+
+    fn start_recv_poll(&mut self, budget: usize) {
+        for pair in self.queue_pairs.iter_mut() {
+            pair.recv_queue.disable_callback();
+        }
+        self.recv_budget = Some(budget);
+    }
+
+    fn finish_recv_poll(&mut self) -> bool {
+        self.recv_budget = None;
+
+        let has_pending =
+            |queue_pairs: &[QueuePair]| queue_pairs.iter().any(|pair| pair.recv_queue.can_pop());
+        if has_pending(&self.queue_pairs) {
+            return true;
+        }
+
+        for pair in self.queue_pairs.iter_mut() {
+            pair.recv_queue.enable_callback();
+        }
+        // A packet may arrive after the check but before the interrupts are enabled, which
+        // will not raise an interrupt. So check again after enabling the interrupts.
+        fence(Ordering::SeqCst);
+        if has_pending(&self.queue_pairs) {
+            for pair in self.queue_pairs.iter_mut() {
+                pair.recv_queue.disable_callback();
+            }
+            return true;
+        }
+
+        false
     }
 }
 
@@ -353,8 +684,7 @@ impl Debug for NetworkDevice {
         f.debug_struct("NetworkDevice")
             .field("config", &self.config_manager.read_config())
             .field("mac_addr", &self.mac_addr)
-            .field("send_queue", &self.send_queue)
-            .field("recv_queue", &self.recv_queue)
+            .field("queue_pairs", &self.queue_pairs.len())
             .field("transport", &self.transport)
             .finish()
     }
@@ -363,6 +693,15 @@ impl Debug for NetworkDevice {
 static TX_BUFFER_POOL: SpinLock<LinkedList<DmaStream>, BottomHalfDisabled> =
     SpinLock::new(LinkedList::new());
 
+/// The pool of the buffers that hold the TCP packets to be segmented by the device.
+static TSO_TX_BUFFER_POOL: SpinLock<LinkedList<DmaStream>, BottomHalfDisabled> =
+    SpinLock::new(LinkedList::new());
+
+/// The length of the buffers in [`TSO_TX_BUFFER_POOL`], which hold an IP packet of at most
+/// 64 KiB with the Ethernet header and the virtio-net header.
+const TSO_TX_BUFFER_LEN: usize = 17 * PAGE_SIZE;
+const TSO_MAX_FRAME_LEN: usize = TSO_TX_BUFFER_LEN - VIRTIO_NET_HDR_LEN;
+
 const QUEUE_RECV: u16 = 0;
 const QUEUE_SEND: u16 = 1;
 
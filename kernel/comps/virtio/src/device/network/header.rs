@@ -22,6 +22,41 @@ pub struct VirtioNetHdr {
                       // padding_reserved: u16,  // Only if VIRTIO_NET_F_HASH_REPORT negotiated
 }
 
+impl VirtioNetHdr {
+    /// Creates a header that asks the device to complete the checksum of the packet.
+    ///
+    /// The device computes the checksum from `csum_start` to the end of the packet, and stores
+    /// it at `csum_start + csum_offset`.
+    pub fn new_partial_checksum(csum_start: u16, csum_offset: u16) -> Self {
+        Self {
+            flags: Flags::VIRTIO_NET_HDR_F_NEEDS_CSUM,
+            csum_start,
+            csum_offset,
+            ..Self::default()
+        }
+    }
+
+    /// Asks the device to segment the packet into segments of `gso_size` bytes of payload.
+    ///
+    /// `hdr_len` is the length of the headers to be replicated in each segment.
+    pub fn set_gso(&mut self, gso_type: GsoType, hdr_len: u16, gso_size: u16) {
+        self.gso_type = gso_type as u8;
+        self.hdr_len = hdr_len;
+        self.gso_size = gso_size;
+    }
+
+    pub fn flags(&self) -> Flags {
+        self.flags
+    }
+
+    /// Returns the number of the buffers that the received packet spans.
+    ///
+    /// This is only valid if `VIRTIO_NET_F_MRG_RXBUF` is negotiated.
+    pub fn num_buffers(&self) -> u16 {
+        self.num_buffers
+    }
+}
+
 bitflags! {
     #[repr(C)]
     #[derive(Default, Pod)]
@@ -1,7 +1,9 @@
 // SPDX-License-Identifier: MPL-2.0
 
 pub mod config;
+mod ctrl;
 pub mod device;
 pub mod header;
+mod offload;
 
 pub static DEVICE_NAME: &str = "Virtio-Net";
@@ -0,0 +1,330 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! Checksum and segmentation offloads.
+//!
+//! The network stack builds Ethernet frames without knowing the offloads. This module
+//! parses the headers of the frames, so that the driver can ask the device to complete
+//! the checksums and to segment the large TCP packets.
+//!
+//! Only the TCP and UDP packets over IPv4 or over IPv6 without extension headers are
+//! offloaded. The other packets are handled by the network stack as usual.
+
+use alloc::vec::Vec;
+
+use super::header::{GsoType, VirtioNetHdr};
+
+const ETHERNET_HEADER_LEN: usize = 14;
+const ETHERTYPE_IPV4: u16 = 0x0800;
+const ETHERTYPE_IPV6: u16 = 0x86dd;
+const IPV4_MIN_HEADER_LEN: usize = 20;
+const IPV6_HEADER_LEN: usize = 40;
+const PROTOCOL_TCP: u8 = 6;
+const PROTOCOL_UDP: u8 = 17;
+const TCP_MIN_HEADER_LEN: usize = 20;
+const UDP_HEADER_LEN: usize = 8;
+
+const TCP_FLAG_PSH: u8 = 0x08;
+const TCP_FLAG_ACK: u8 = 0x10;
+
+/// The maximum length of an IP packet that the device is asked to segment.
+const MAX_TSO_IP_LEN: usize = u16::MAX as usize;
+
+/// The layout of an Ethernet frame that carries a TCP or UDP packet.
+#[derive(Clone, Copy, Debug)]
+pub(super) struct L4Frame {
+    is_ipv6: bool,
+    protocol: u8,
+    /// The offset of the TCP or UDP header.
+    l4_start: usize,
+    /// The end of the IP packet, which excludes the padding of the frame.
+    end: usize,
+}
+
+impl L4Frame {
+    /// Parses the headers of `frame`.
+    ///
+    /// Returns `None` if the frame does not carry a TCP or UDP packet, or the packet is
+    /// fragmented or malformed.
+    pub(super) fn parse(frame: &[u8]) -> Option<Self> {
+        let ip = frame.get(ETHERNET_HEADER_LEN..)?;
+
+        let (is_ipv6, ip_header_len, protocol, ip_len) =
+            match u16::from_be_bytes([frame[12], frame[13]]) {
+                ETHERTYPE_IPV4 => {
+                    if ip.len() < IPV4_MIN_HEADER_LEN || ip[0] >> 4 != 4 {
+                        return None;
+                    }
+                    // The "more fragments" flag and the fragment offset.
+                    if u16::from_be_bytes([ip[6], ip[7]]) & 0x3fff != 0 {
+                        return None;
+                    }
+                    let header_len = (ip[0] & 0xf) as usize * 4;
+                    let total_len = u16::from_be_bytes([ip[2], ip[3]]) as usize;
+                    (false, header_len, ip[9], total_len)
+                }
+                ETHERTYPE_IPV6 => {
+                    if ip.len() < IPV6_HEADER_LEN || ip[0] >> 4 != 6 {
+                        return None;
+                    }
+                    let payload_len = u16::from_be_bytes([ip[4], ip[5]]) as usize;
+                    (true, IPV6_HEADER_LEN, ip[6], IPV6_HEADER_LEN + payload_len)
+                }
+                _ => return None,
+            };
+
+        let l4_min_header_len = match protocol {
+            PROTOCOL_TCP => TCP_MIN_HEADER_LEN,
+            PROTOCOL_UDP => UDP_HEADER_LEN,
+            _ => return None,
+        };
+        if ip_header_len < IPV4_MIN_HEADER_LEN
+            || ip_len < ip_header_len + l4_min_header_len
+            || ip_len > ip.len()
+        {
+            return None;
+        }
+
+        Some(Self {
+            is_ipv6,
+            protocol,
+            l4_start: ETHERNET_HEADER_LEN + ip_header_len,
+            end: ETHERNET_HEADER_LEN + ip_len,
+        })
+    }
+
+    pub(super) fn is_ipv6(&self) -> bool {
+        self.is_ipv6
+    }
+
+    /// Returns the offset of the checksum field in the TCP or UDP header.
+    fn checksum_offset(&self) -> usize {
+        match self.protocol {
+            PROTOCOL_TCP => 16,
+            _ => 6,
+        }
+    }
+
+    /// Returns the ones' complement sum of the pseudo-header.
+    fn pseudo_header_sum(&self, frame: &[u8]) -> u64 {
+        let ip = &frame[ETHERNET_HEADER_LEN..];
+        let addrs = if self.is_ipv6 {
+            &ip[8..40]
+        } else {
+            &ip[12..20]
+        };
+        let l4_len = (self.end - self.l4_start) as u64;
+
+        sum_be_words(addrs) + self.protocol as u64 + l4_len
+    }
+
+    /// Returns the offset of the checksum field in the frame.
+    pub(super) fn checksum_field(&self) -> usize {
+        self.l4_start + self.checksum_offset()
+    }
+
+    /// Returns the partial checksum, which is the pseudo-header sum.
+    ///
+    /// The partial checksum should be stored in the checksum field of a packet whose checksum
+    /// is completed by the device.
+    pub(super) fn partial_checksum(&self, frame: &[u8]) -> [u8; 2] {
+        fold(self.pseudo_header_sum(frame)).to_be_bytes()
+    }
+
+    /// Creates the header that asks the device to complete the checksum.
+    pub(super) fn partial_checksum_header(&self) -> VirtioNetHdr {
+        VirtioNetHdr::new_partial_checksum(self.l4_start as u16, self.checksum_offset() as u16)
+    }
+
+    /// Verifies the checksum of the TCP or UDP packet.
+    pub(super) fn verify_checksum(&self, frame: &[u8]) -> bool {
+        let l4 = &frame[self.l4_start..self.end];
+        if self.protocol == PROTOCOL_UDP && !self.is_ipv6 && l4[6..8] == [0, 0] {
+            // The sender does not compute the checksum.
+            return true;
+        }
+
+        fold(self.pseudo_header_sum(frame) + sum_be_words(l4)) == 0xffff
+    }
+}
+
+/// A TCP packet that is coalesced from consecutive segments of a connection.
+///
+/// The network stack emits TCP segments no larger than the maximum segment size. The
+/// consecutive segments emitted in one poll are coalesced into a large packet, which is sent
+/// as one buffer and segmented again by the device (TSO).
+pub(super) struct TsoFrame {
+    frame: Vec<u8>,
+    layout: L4Frame,
+    tcp_header_len: usize,
+    /// The payload length of the coalesced segments, except the last one.
+    segment_size: usize,
+    nr_segments: usize,
+    /// Whether the last segment is coalesced, i.e., the segment is shorter or has `PSH`.
+    is_closed: bool,
+}
+
+impl TsoFrame {
+    /// Starts coalescing from the segment in `frame`, whose layout is `layout`.
+    ///
+    /// Returns `None` if the segment cannot be coalesced with the following segments.
+    pub(super) fn new(frame: &[u8], layout: L4Frame, max_frame_len: usize) -> Option<Self> {
+        if layout.protocol != PROTOCOL_TCP {
+            return None;
+        }
+
+        let tcp = &frame[layout.l4_start..layout.end];
+        let tcp_header_len = (tcp[12] >> 4) as usize * 4;
+        if tcp_header_len < TCP_MIN_HEADER_LEN || tcp_header_len > tcp.len() {
+            return None;
+        }
+        let segment_size = tcp.len() - tcp_header_len;
+        // Only the segments with `ACK` alone are coalesced. In particular, segmenting the
+        // packets with `CWR` requires `VIRTIO_NET_F_HOST_ECN`, which is not supported.
+        if tcp[13] != TCP_FLAG_ACK || segment_size == 0 || frame.len() * 2 > max_frame_len {
+            return None;
+        }
+
+        let mut tso_frame = Vec::with_capacity(max_frame_len);
+        tso_frame.extend_from_slice(&frame[..layout.end]);
+        Some(Self {
+            frame: tso_frame,
+            layout,
+            tcp_header_len,
+            segment_size,
+            nr_segments: 1,
+            is_closed: false,
+        })
+    }
+
+    /// Tries to append the segment in `frame`.
+    ///
+    /// The segment is appended only if it follows the coalesced segments in the same
+    /// connection, and has the same headers except the lengths, the sequence number, the
+    /// checksums, and the `PSH` flag.
+    pub(super) fn try_append(&mut self, frame: &[u8], max_frame_len: usize) -> bool {
+        if self.is_closed {
+            return false;
+        }
+        let Some(layout) = L4Frame::parse(frame) else {
+            return false;
+        };
+        let l4_start = self.layout.l4_start;
+        let header_len = l4_start + self.tcp_header_len;
+        if layout.protocol != PROTOCOL_TCP
+            || layout.l4_start != l4_start
+            || layout.end < header_len
+            || frame[l4_start + 12] != self.frame[l4_start + 12]
+        {
+            return false;
+        }
+
+        let payload_len = layout.end - header_len;
+        if payload_len == 0
+            || payload_len > self.segment_size
+            || self.frame.len() + payload_len > max_frame_len
+            || self.frame.len() + payload_len - ETHERNET_HEADER_LEN > MAX_TSO_IP_LEN
+        {
+            return false;
+        }
+
+        // Compares the headers, skipping the fields that differ between the segments.
+        let ip_fields_to_skip: &[core::ops::Range<usize>] = if self.layout.is_ipv6 {
+            // The payload length.
+            &[18..20]
+        } else {
+            // The total length, the identification and the header checksum.
+            &[16..20, 24..26]
+        };
+        let tcp_fields_to_skip = [l4_start + 4..l4_start + 8, l4_start + 13..l4_start + 14];
+        let checksum_field = l4_start + 16..l4_start + 18;
+        let mut start = 0;
+        for range in ip_fields_to_skip
+            .iter()
+            .chain(tcp_fields_to_skip.iter())
+            .chain(core::iter::once(&checksum_field))
+        {
+            if frame[start..range.start] != self.frame[start..range.start] {
+                return false;
+            }
+            start = range.end;
+        }
+        if frame[start..header_len] != self.frame[start..header_len] {
+            return false;
+        }
+
+        let flags = frame[l4_start + 13];
+        let seq = u32::from_be_bytes(frame[l4_start + 4..l4_start + 8].try_into().unwrap());
+        let first_seq =
+            u32::from_be_bytes(self.frame[l4_start + 4..l4_start + 8].try_into().unwrap());
+        let expected_seq = first_seq.wrapping_add((self.nr_segments * self.segment_size) as u32);
+        if flags & !TCP_FLAG_PSH != TCP_FLAG_ACK || seq != expected_seq {
+            return false;
+        }
+
+        self.frame.extend_from_slice(&frame[header_len..layout.end]);
+        self.nr_segments += 1;
+        if payload_len < self.segment_size || flags & TCP_FLAG_PSH != 0 {
+            // The device sets `PSH` only in the last segment.
+            self.frame[l4_start + 13] = flags;
+            self.is_closed = true;
+        }
+
+        true
+    }
+
+    /// Returns the header and the frame to be sent.
+    pub(super) fn finish(mut self) -> (VirtioNetHdr, Vec<u8>) {
+        let ip_len = self.frame.len() - ETHERNET_HEADER_LEN;
+        self.layout.end = self.frame.len();
+
+        let ip = &mut self.frame[ETHERNET_HEADER_LEN..];
+        if self.layout.is_ipv6 {
+            let payload_len = (ip_len - IPV6_HEADER_LEN) as u16;
+            ip[4..6].copy_from_slice(&payload_len.to_be_bytes());
+        } else {
+            ip[2..4].copy_from_slice(&(ip_len as u16).to_be_bytes());
+            ip[10..12].fill(0);
+            let header_len = self.layout.l4_start - ETHERNET_HEADER_LEN;
+            let checksum = !fold(sum_be_words(&ip[..header_len]));
+            ip[10..12].copy_from_slice(&checksum.to_be_bytes());
+        }
+
+        let checksum_field = self.layout.checksum_field();
+        let partial_checksum = self.layout.partial_checksum(&self.frame);
+        self.frame[checksum_field..checksum_field + 2].copy_from_slice(&partial_checksum);
+
+        let mut header = self.layout.partial_checksum_header();
+        if self.nr_segments > 1 {
+            let gso_type = if self.layout.is_ipv6 {
+                GsoType::VIRTIO_NET_HDR_GSO_TCPV6
+            } else {
+                GsoType::VIRTIO_NET_HDR_GSO_TCPV4
+            };
+            let hdr_len = self.layout.l4_start + self.tcp_header_len;
+            header.set_gso(gso_type, hdr_len as u16, self.segment_size as u16);
+        }
+
+        (header, self.frame)
+    }
+}
+
+/// Returns the ones' complement sum of the big-endian 16-bit words in `data`, without folding.
+fn sum_be_words(data: &[u8]) -> u64 {
+    let mut chunks = data.chunks_exact(2);
+    let mut sum = chunks
+        .by_ref()
+        .map(|word| u16::from_be_bytes([word[0], word[1]]) as u64)
+        .sum::<u64>();
+    if let [last] = chunks.remainder() {
+        sum += (*last as u64) << 8;
+    }
+    sum
+}
+
+/// Folds the ones' complement sum into 16 bits.
+fn fold(mut sum: u64) -> u16 {
+    while sum >> 16 != 0 {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    sum as u16
+}
@@ -40,7 +40,7 @@ pub struct IfaceCommon<E: Ext> {
 
     interface: SpinLock<PollableIface<E>, BottomHalfDisabled>,
     used_ports: SpinLock<BTreeMap<u16, usize>, BottomHalfDisabled>,
-    sockets: SpinLock<SocketTable<E>, BottomHalfDisabled>,
+    sockets: SocketTable<E>,
     sched_poll: E::ScheduleNextPoll,
 }
 
@@ -61,7 +61,7 @@ impl<E: Ext> IfaceCommon<E> {
             flags,
             interface: SpinLock::new(PollableIface::new(interface)),
             used_ports: SpinLock::new(BTreeMap::new()),
-            sockets: SpinLock::new(SocketTable::new()),
+            sockets: SocketTable::new(),
             sched_poll,
         }
     }
@@ -100,16 +100,19 @@ impl<E: Ext> IfaceCommon<E> {
 // FIXME: This allocator is specific to each network namespace.
 pub static INTERFACE_INDEX_ALLOCATOR: AtomicU32 = AtomicU32::new(1);
 
-// Lock order: `interface` -> `sockets`
+// Lock order: `interface` -> the bucket locks in `sockets`
 impl<E: Ext> IfaceCommon<E> {
     /// Acquires the lock to the interface.
     pub(crate) fn interface(&self) -> SpinLockGuard<'_, PollableIface<E>, BottomHalfDisabled> {
         self.interface.lock()
     }
 
-    /// Acquires the lock to the socket table.
-    pub(crate) fn sockets(&self) -> SpinLockGuard<'_, SocketTable<E>, BottomHalfDisabled> {
-        self.sockets.lock()
+    /// Returns the socket table.
+    ///
+    /// The socket table is internally synchronized. Note that inserting a socket after checking
+    /// for conflicts is not atomic, so such insertions are serialized by the interface lock.
+    pub(crate) fn sockets(&self) -> &SocketTable<E> {
+        &self.sockets
     }
 }
 
@@ -181,19 +184,16 @@ impl<E: Ext> IfaceCommon<E> {
 
 impl<E: Ext> IfaceCommon<E> {
     pub(crate) fn register_udp_socket(&self, socket: Arc<UdpSocketBg<E>>) {
-        let mut sockets = self.sockets.lock();
-        sockets.insert_udp_socket(socket);
+        self.sockets.insert_udp_socket(socket);
     }
 
     pub(crate) fn remove_tcp_listener(&self, socket: &Arc<TcpListenerBg<E>>) {
-        let mut sockets = self.sockets.lock();
-        let removed = sockets.remove_listener(socket.listener_key());
+        let removed = self.sockets.remove_listener(socket);
         debug_assert!(removed.is_some());
     }
 
     pub(crate) fn remove_udp_socket(&self, socket: &Arc<UdpSocketBg<E>>) {
-        let mut sockets = self.sockets.lock();
-        let removed = sockets.remove_udp_socket(socket);
+        let removed = self.sockets.remove_udp_socket(socket);
         debug_assert!(removed.is_some());
     }
 }
@@ -215,32 +215,57 @@ impl<E: Ext> IfaceCommon<E> {
         >,
         Q: FnMut(&Packet, &mut Context, D::TxToken<'_>),
     {
-        let mut interface = self.interface();
-        interface.context_mut().now = get_network_timestamp();
+        let now = get_network_timestamp();
 
-        let mut sockets = self.sockets.lock();
+        let sockets = &self.sockets;
         let mut socket_actions = Vec::new();
 
-        let mut context = PollContext::new(interface.as_mut(), &sockets, &mut socket_actions);
-        context.poll_ingress(device, &mut process_phy, &mut dispatch_phy);
+        // Receive the packets without holding the interface lock, and take the lock for one packet
+        // at a time. This way, the interface is not locked for a whole burst of incoming packets.
+        while let Some((rx_token, tx_token)) = device.receive(now) {
+            let mut interface = self.interface();
+            interface.context_mut().now = now;
+
+            let mut context = PollContext::new(interface.as_mut(), sockets, &mut socket_actions);
+            context.poll_ingress::<D, _, _>(
+                rx_token,
+                tx_token,
+                &mut process_phy,
+                &mut dispatch_phy,
+            );
+
+            self.apply_socket_actions(&mut socket_actions);
+        }
+
+        let mut interface = self.interface();
+        interface.context_mut().now = now;
+
+        let mut context = PollContext::new(interface.as_mut(), sockets, &mut socket_actions);
         context.poll_egress(device, &mut dispatch_phy);
 
-        // Insert new connections and remove dead connections.
-        for action in socket_actions.into_iter() {
+        self.apply_socket_actions(&mut socket_actions);
+
+        // Note that only TCP connections can have timers set, so as far as the time to poll is
+        // concerned, we only need to consider TCP connections.
+        interface.next_poll_at_ms()
+    }
+
+    /// Inserts new connections and removes dead connections.
+    ///
+    /// This must be called with the interface lock held, so that the socket table changes are
+    /// serialized with the processing of the packets.
+    fn apply_socket_actions(&self, socket_actions: &mut Vec<SocketTableAction<E>>) {
+        for action in socket_actions.drain(..) {
             match action {
                 SocketTableAction::AddTcpConn(new_tcp_conn) => {
-                    let res = sockets.insert_connection(new_tcp_conn);
+                    let res = self.sockets.insert_connection(new_tcp_conn);
                     debug_assert!(res.is_ok());
                 }
                 SocketTableAction::DelTcpConn(dead_conn_key) => {
-                    sockets.remove_dead_tcp_connection(&dead_conn_key);
+                    self.sockets.remove_dead_tcp_connection(&dead_conn_key);
                 }
             }
         }
-
-        // Note that only TCP connections can have timers set, so as far as the time to poll is
-        // concerned, we only need to consider TCP connections.
-        interface.next_poll_at_ms()
     }
 }
 
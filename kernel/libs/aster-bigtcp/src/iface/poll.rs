@@ -57,13 +57,14 @@ pub(super) trait FnHelper<A, B, C, O>: FnMut(A, B, C) -> O {}
 impl<A, B, C, O, F> FnHelper<A, B, C, O> for F where F: FnMut(A, B, C) -> O {}
 
 impl<E: Ext> PollContext<'_, E> {
-    pub(super) fn poll_ingress<D, P, Q>(
+    pub(super) fn poll_ingress<'d, D, P, Q>(
         &mut self,
-        device: &mut D,
+        rx_token: D::RxToken<'d>,
+        tx_token: D::TxToken<'d>,
         process_phy: &mut P,
         dispatch_phy: &mut Q,
     ) where
-        D: Device + ?Sized,
+        D: Device + ?Sized + 'd,
         P: for<'pkt, 'cx, 'tx> FnHelper<
             &'pkt [u8],
             &'cx mut Context,
@@ -72,20 +73,18 @@ impl<E: Ext> PollContext<'_, E> {
         >,
         Q: FnMut(&Packet, &mut Context, D::TxToken<'_>),
     {
-        while let Some((rx_token, tx_token)) = device.receive(self.iface.context().now()) {
-            rx_token.consume(|data| {
-                let Some((pkt, tx_token)) = process_phy(data, self.iface.context_mut(), tx_token)
-                else {
-                    return;
-                };
+        rx_token.consume(|data| {
+            let Some((pkt, tx_token)) = process_phy(data, self.iface.context_mut(), tx_token)
+            else {
+                return;
+            };
 
-                let Some(reply) = self.parse_and_process_ipv4(pkt) else {
-                    return;
-                };
+            let Some(reply) = self.parse_and_process_ipv4(pkt) else {
+                return;
+            };
 
-                dispatch_phy(&reply, self.iface.context_mut(), tx_token);
-            });
-        }
+            dispatch_phy(&reply, self.iface.context_mut(), tx_token);
+        });
     }
 
     fn parse_and_process_ipv4<'pkt>(
@@ -193,7 +192,8 @@ impl<E: Ext> PollContext<'_, E> {
                             SocketTableAction::AddTcpConn(conn) => Some(conn),
                             SocketTableAction::DelTcpConn(_) => None,
                         })
-                        .find(|conn| conn.connection_key() == &connection_key),
+                        .find(|conn| conn.connection_key() == &connection_key)
+                        .cloned(),
                 )
             };
 
@@ -221,7 +221,10 @@ impl<E: Ext> PollContext<'_, E> {
         // Process packets that request to create new connections second.
         if tcp_repr.control == TcpControl::Syn && tcp_repr.ack_number.is_none() {
             let listener_key = ListenerKey::new(ip_repr.dst_addr(), tcp_repr.dst_port);
-            if let Some(listener) = self.sockets.lookup_listener(&listener_key) {
+            if let Some(listener) = self
+                .sockets
+                .lookup_listener(&listener_key, connection_key.hash())
+            {
                 let (processed, new_tcp_conn) =
                     listener.process(&mut self.iface, ip_repr, tcp_repr);
 
@@ -278,11 +281,10 @@ impl<E: Ext> PollContext<'_, E> {
     fn process_udp(&mut self, ip_repr: &IpRepr, udp_repr: &UdpRepr, udp_payload: &[u8]) -> bool {
         let mut processed = false;
 
-        for socket in self.sockets.udp_socket_iter() {
-            if !socket.can_process(udp_repr.dst_port) {
-                continue;
-            }
-
+        let sockets = self
+            .sockets
+            .udp_sockets_matching(|socket| socket.can_process(udp_repr.dst_port));
+        for socket in sockets.iter() {
             processed |= socket.process(self.iface.context_mut(), ip_repr, udp_repr, udp_payload);
             if processed && ip_repr.dst_addr().is_unicast() {
                 break;
@@ -488,11 +490,10 @@ impl<E: Ext> PollContext<'_, E> {
 
         let mut actions = Vec::new();
 
-        for socket in self.sockets.udp_socket_iter() {
-            if !socket.need_dispatch() {
-                continue;
-            }
-
+        let sockets = self
+            .sockets
+            .udp_sockets_matching(|socket| socket.need_dispatch());
+        for socket in sockets.iter() {
             // We set `did_something` even if no packets are actually generated. This is because a
             // timer can expire, but no packets are actually generated.
             did_something = true;
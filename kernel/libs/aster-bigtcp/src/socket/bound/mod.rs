@@ -3,6 +3,7 @@
 mod common;
 mod tcp_conn;
 mod tcp_listen;
+mod tcp_loopback;
 mod udp;
 
 pub use common::NeedIfacePoll;
@@ -17,12 +17,13 @@ use smoltcp::{
 use super::{
     common::{Inner, NeedIfacePoll, Socket, SocketBg},
     tcp_listen::TcpListenerBg,
+    tcp_loopback::LoopbackEnd,
 };
 use crate::{
     define_boolean_value,
     errors::tcp::{ConnectError, RecvError, SendError},
     ext::Ext,
-    iface::{BoundPort, PollKey, PollableIfaceMut},
+    iface::{BoundPort, InterfaceFlags, PollKey, PollableIfaceMut},
     socket::{
         event::SocketEvents,
         option::{RawTcpOption, RawTcpSetOption},
@@ -48,6 +49,8 @@ pub struct RawTcpSocketExt<E: Ext> {
     is_recv_shut: bool,
     /// Indicates if the socket is closed by a RST packet.
     is_rst_closed: bool,
+    /// The shortcut to the peer if the connection is paired with it on the loopback iface.
+    loopback: Option<LoopbackEnd<E>>,
 }
 
 impl<E: Ext> Deref for RawTcpSocketExt<E> {
@@ -106,6 +109,25 @@ impl<E: Ext> RawTcpSocketExt<E> {
     pub fn is_rst_closed(&self) -> bool {
         self.is_rst_closed
     }
+
+    /// Checks if there is data to receive.
+    ///
+    /// This is similar to [`RawTcpSocket::can_recv`]. However, this method also checks the data
+    /// sent by the peer over the loopback shortcut (see [`TcpConnection::send`]).
+    pub fn has_recv_data(&self) -> bool {
+        self.can_recv() || self.loopback.as_ref().is_some_and(LoopbackEnd::can_recv)
+    }
+
+    /// Checks if there is space to send data.
+    ///
+    /// This is similar to [`RawTcpSocket::can_send`]. However, if the connection sends data over
+    /// the loopback shortcut (see [`TcpConnection::send`]), this method checks the space there.
+    pub fn has_send_space(&self) -> bool {
+        match self.loopback.as_ref().and_then(LoopbackEnd::can_send) {
+            Some(has_space) => self.may_send() && has_space,
+            None => self.can_send(),
+        }
+    }
 }
 
 define_boolean_value!(
@@ -214,6 +236,64 @@ impl<E: Ext> RawTcpSocketExt<E> {
     }
 }
 
+impl<E: Ext> RawTcpSocketExt<E> {
+    /// Sends some data over the loopback shortcut.
+    ///
+    /// This method returns `Err(f)` if the connection does not send data over the shortcut.
+    fn send_loopback<F, R>(&mut self, f: F) -> Result<Result<R, SendError>, F>
+    where
+        F: FnOnce(&mut [u8]) -> (usize, R),
+    {
+        if self.loopback.is_none() {
+            return Err(f);
+        }
+
+        if self.is_rst_closed {
+            self.is_rst_closed = false;
+            return Ok(Err(SendError::ConnReset));
+        }
+        if !self.may_send() {
+            return Ok(Err(SendError::InvalidState));
+        }
+
+        self.loopback.as_ref().unwrap().send(f).map(Ok)
+    }
+
+    /// Receives some data over the loopback shortcut.
+    ///
+    /// This method returns `Err(f)` if there is no data sent over the shortcut.
+    fn recv_loopback<F, R>(&mut self, f: F) -> Result<R, F>
+    where
+        F: FnOnce(&mut [u8]) -> (usize, R),
+    {
+        match self.loopback {
+            Some(ref loopback) => loopback.recv(f),
+            None => Err(f),
+        }
+    }
+
+    /// Shuts down the receiving half and returns whether there is unread data.
+    fn shut_recv(&mut self) -> bool {
+        self.is_recv_shut = true;
+
+        let has_loopback_data = self.loopback.as_ref().is_some_and(LoopbackEnd::shut_recv);
+        self.recv_queue() != 0 || has_loopback_data
+    }
+
+    /// Checks if the socket can be paired with its peer for the loopback shortcut.
+    ///
+    /// After both ends have been established and their data has been acknowledged and read, no
+    /// data is in flight, so the data sent over the shortcut cannot be reordered with the data
+    /// sent in packets.
+    fn can_pair_loopback(&self) -> bool {
+        self.loopback.is_none()
+            && self.state() == State::Established
+            && self.send_queue() == 0
+            && self.recv_queue() == 0
+            && !self.is_recv_shut
+    }
+}
+
 impl<E: Ext> TcpConnectionInner<E> {
     pub(super) fn new(
         socket: Box<RawTcpSocket>,
@@ -235,6 +315,7 @@ impl<E: Ext> TcpConnectionInner<E> {
             has_connected: false,
             is_recv_shut: false,
             is_rst_closed: false,
+            loopback: None,
         };
 
         TcpConnectionInner {
@@ -301,8 +382,9 @@ impl<E: Ext> TcpConnection<E> {
         let iface = bound.iface().clone();
         // We have to lock `interface` before locking `sockets`
         // to avoid dead lock due to inconsistent lock orders.
+        // This also serializes the insertions of TCP connections.
         let mut interface = iface.common().interface();
-        let mut sockets = iface.common().sockets();
+        let sockets = iface.common().sockets();
 
         let connection_key = ConnectionKey::from((local_endpoint, remote_endpoint));
 
@@ -369,11 +451,20 @@ impl<E: Ext> TcpConnection<E> {
 
     /// Sends some data.
     ///
+    /// If both ends of the connection are on the loopback iface, they are paired once both are
+    /// established and no data is queued at either end. Then the data is copied directly to the
+    /// peer instead of being sent in packets, and polling the iface is not required.
+    ///
     /// Polling the iface _may_ be required after this method succeeds.
     pub fn send<F, R>(&self, f: F) -> Result<(R, NeedIfacePoll), SendError>
     where
         F: FnOnce(&mut [u8]) -> (usize, R),
     {
+        let f = match self.0.inner.lock().send_loopback(f) {
+            Ok(result) => return result.map(|result| (result, NeedIfacePoll::FALSE)),
+            Err(f) => f,
+        };
+
         let common = self.iface().common();
         let mut iface = common.interface();
 
@@ -383,6 +474,15 @@ impl<E: Ext> TcpConnection<E> {
             socket.is_rst_closed = false;
             return Err(SendError::ConnReset);
         }
+
+        let f = if self.try_pair_loopback(&mut socket) {
+            match socket.send_loopback(f) {
+                Ok(result) => return result.map(|result| (result, NeedIfacePoll::FALSE)),
+                Err(f) => f,
+            }
+        } else {
+            f
+        };
         let result = socket.send(f)?;
 
         let poll_at = socket.poll_at(iface.context_mut());
@@ -398,6 +498,13 @@ impl<E: Ext> TcpConnection<E> {
     where
         F: FnOnce(&mut [u8]) -> (usize, R),
     {
+        // The data sent over the loopback shortcut always precedes the data in the receive
+        // buffer, since the peer only sends data in packets again after we shut down receiving.
+        let f = match self.0.inner.lock().recv_loopback(f) {
+            Ok(result) => return Ok((result, NeedIfacePoll::FALSE)),
+            Err(f) => f,
+        };
+
         let common = self.iface().common();
         let mut iface = common.interface();
 
@@ -465,7 +572,7 @@ impl<E: Ext> TcpConnection<E> {
             return false;
         }
 
-        socket.is_recv_shut = true;
+        socket.shut_recv();
 
         true
     }
@@ -480,9 +587,7 @@ impl<E: Ext> TcpConnection<E> {
         let mut iface = self.iface().common().interface();
         let mut socket = self.0.inner.lock();
 
-        socket.is_recv_shut = true;
-
-        if socket.recv_queue() != 0 {
+        if socket.shut_recv() {
             // If there is unread data, reset the connection immediately.
             socket.abort();
         } else {
@@ -509,6 +614,38 @@ impl<E: Ext> TcpConnection<E> {
         iface.update_next_poll_at_ms(&self.0, poll_at);
     }
 
+    /// Pairs the connection with its peer for the loopback shortcut if possible.
+    ///
+    /// The iface must be locked, so that the connections are paired one at a time and the peer
+    /// cannot be locked by others that are pairing.
+    fn try_pair_loopback(&self, socket: &mut RawTcpSocketExt<E>) -> bool {
+        if !socket.can_pair_loopback() || !self.iface().flags().contains(InterfaceFlags::LOOPBACK) {
+            return false;
+        }
+
+        let local_endpoint = socket.local_endpoint().unwrap();
+        let remote_endpoint = socket.remote_endpoint().unwrap();
+        if local_endpoint == remote_endpoint {
+            return false;
+        }
+
+        let peer_key = ConnectionKey::from((remote_endpoint, local_endpoint));
+        let Some(peer) = self.iface().common().sockets().lookup_connection(&peer_key) else {
+            return false;
+        };
+        let mut peer_socket = peer.inner.lock();
+        if !peer_socket.can_pair_loopback() {
+            return false;
+        }
+
+        let (this_end, peer_end) =
+            LoopbackEnd::new_pair(Arc::downgrade(self.0.as_ref()), Arc::downgrade(&peer));
+        socket.loopback = Some(this_end);
+        peer_socket.loopback = Some(peer_end);
+
+        true
+    }
+
     /// Calls `f` with an immutable reference to the associated [`RawTcpSocket`].
     //
     // NOTE: If a mutable reference is required, add a method above that correctly updates the next
@@ -38,13 +38,17 @@ pub struct TcpBacklog<E: Ext> {
 pub struct TcpListenerInner<E: Ext> {
     pub(super) backlog: SpinLock<TcpBacklog<E>, BottomHalfDisabled>,
     listener_key: ListenerKey,
+    reuse_port: bool,
+    incoming_cpu: Option<u32>,
 }
 
 impl<E: Ext> TcpListenerInner<E> {
-    fn new(backlog: TcpBacklog<E>, listener_key: ListenerKey) -> Self {
+    fn new(backlog: TcpBacklog<E>, listener_key: ListenerKey, option: &RawTcpOption) -> Self {
         Self {
             backlog: SpinLock::new(backlog),
             listener_key,
+            reuse_port: option.reuse_port,
+            incoming_cpu: option.incoming_cpu,
         }
     }
 }
@@ -78,11 +82,14 @@ impl<E: Ext> TcpListener<E> {
         };
 
         let iface = bound.iface().clone();
-        let mut sockets = iface.common().sockets();
+        // The interface lock serializes the insertions of TCP listeners, so no conflicting
+        // listener can be inserted between the check and the insertion below.
+        let _interface = iface.common().interface();
+        let sockets = iface.common().sockets();
 
         let listener_key = ListenerKey::new(local_endpoint.addr, local_endpoint.port);
 
-        if sockets.lookup_listener(&listener_key).is_some() {
+        if !sockets.can_insert_listener(&listener_key, option.reuse_port) {
             return Err((bound, ListenError::AddressInUse));
         }
 
@@ -106,7 +113,7 @@ impl<E: Ext> TcpListener<E> {
                 connected: Vec::new(),
             };
 
-            TcpListenerInner::new(backlog, listener_key)
+            TcpListenerInner::new(backlog, listener_key, option)
         };
 
         let listener = Self::new(bound, inner);
@@ -188,6 +195,14 @@ impl<E: Ext> TcpListenerBg<E> {
     pub(crate) const fn listener_key(&self) -> &ListenerKey {
         &self.inner.listener_key
     }
+
+    pub(crate) const fn reuse_port(&self) -> bool {
+        self.inner.reuse_port
+    }
+
+    pub(crate) const fn incoming_cpu(&self) -> Option<u32> {
+        self.inner.incoming_cpu
+    }
 }
 
 impl<E: Ext> TcpListenerBg<E> {
@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! A shortcut for the TCP connections on the loopback iface.
+//!
+//! Sending data over the loopback iface means splitting the data into segments, building the
+//! packets with their checksums, and waking up the polling thread, only for the same packets to
+//! be parsed and verified again on the same host. Instead, once both ends of a connection on the
+//! loopback iface are established and have no data queued, they can be _paired_ (see
+//! [`TcpConnection::send`]). Afterwards, the sender copies the data directly into a pipe, which
+//! the receiver reads before its receive buffer.
+//!
+//! Only the data takes the shortcut. The connection is still established, closed, and reset with
+//! packets, so the TCP states that the user programs see do not change.
+//!
+//! [`TcpConnection::send`]: super::TcpConnection::send
+
+use alloc::{
+    sync::{Arc, Weak},
+    vec,
+};
+
+use aster_softirq::BottomHalfDisabled;
+use ostd::sync::SpinLock;
+use smoltcp::storage::RingBuffer;
+
+use super::tcp_conn::TcpConnectionBg;
+use crate::{
+    ext::Ext,
+    socket::{event::SocketEvents, unbound::TCP_RECV_BUF_LEN},
+};
+
+/// One end of a paired connection on the loopback iface.
+pub(super) struct LoopbackEnd<E: Ext> {
+    /// The pipe from the peer to this end.
+    rx: Arc<LoopbackPipe>,
+    /// The pipe from this end to the peer.
+    tx: Arc<LoopbackPipe>,
+    peer: Weak<TcpConnectionBg<E>>,
+}
+
+/// A pipe that carries the data in one direction.
+struct LoopbackPipe(SpinLock<PipeInner, BottomHalfDisabled>);
+
+struct PipeInner {
+    buffer: RingBuffer<'static, u8>,
+    /// Whether the receiving half of the reader has been shut down.
+    ///
+    /// After that, the writer sends the data in packets again, so the reader handles the new data
+    /// in the same way as it would without the shortcut. The reader reads the pipe before its
+    /// receive buffer, so the data is not reordered.
+    is_reader_shut: bool,
+}
+
+impl LoopbackPipe {
+    fn new() -> Arc<Self> {
+        Arc::new(Self(SpinLock::new(PipeInner {
+            buffer: RingBuffer::new(vec![0u8; TCP_RECV_BUF_LEN]),
+            is_reader_shut: false,
+        })))
+    }
+}
+
+impl<E: Ext> LoopbackEnd<E> {
+    /// Creates the two ends of the connection between `this` and `peer`.
+    pub(super) fn new_pair(
+        this: Weak<TcpConnectionBg<E>>,
+        peer: Weak<TcpConnectionBg<E>>,
+    ) -> (Self, Self) {
+        let this_to_peer = LoopbackPipe::new();
+        let peer_to_this = LoopbackPipe::new();
+
+        let this_end = Self {
+            rx: peer_to_this.clone(),
+            tx: this_to_peer.clone(),
+            peer,
+        };
+        let peer_end = Self {
+            rx: this_to_peer,
+            tx: peer_to_this,
+            peer: this,
+        };
+        (this_end, peer_end)
+    }
+
+    /// Sends some data to the peer.
+    ///
+    /// This method returns `Err(f)` if the peer has shut down its receiving half, in which case
+    /// the data should be sent in packets.
+    pub(super) fn send<F, R>(&self, f: F) -> Result<R, F>
+    where
+        F: FnOnce(&mut [u8]) -> (usize, R),
+    {
+        let mut pipe = self.tx.0.lock();
+        if pipe.is_reader_shut {
+            return Err(f);
+        }
+        let (len, result) = pipe.buffer.enqueue_many_with(f);
+        drop(pipe);
+
+        if len != 0 {
+            self.notify_peer(SocketEvents::CAN_RECV);
+        }
+        Ok(result)
+    }
+
+    /// Receives some data from the peer.
+    ///
+    /// This method returns `Err(f)` if there is no data in the pipe, in which case the data
+    /// should be received from the receive buffer.
+    pub(super) fn recv<F, R>(&self, f: F) -> Result<R, F>
+    where
+        F: FnOnce(&mut [u8]) -> (usize, R),
+    {
+        let mut pipe = self.rx.0.lock();
+        if pipe.buffer.is_empty() {
+            return Err(f);
+        }
+        let (len, result) = pipe.buffer.dequeue_many_with(f);
+        drop(pipe);
+
+        if len != 0 {
+            self.notify_peer(SocketEvents::CAN_SEND);
+        }
+        Ok(result)
+    }
+
+    /// Returns whether there is data to receive in the pipe.
+    pub(super) fn can_recv(&self) -> bool {
+        !self.rx.0.lock().buffer.is_empty()
+    }
+
+    /// Returns whether there is space to send data in the pipe.
+    ///
+    /// This method returns `None` if the data should be sent in packets. See [`Self::send`].
+    pub(super) fn can_send(&self) -> Option<bool> {
+        let pipe = self.tx.0.lock();
+        (!pipe.is_reader_shut).then(|| !pipe.buffer.is_full())
+    }
+
+    /// Shuts down the receiving half and returns whether there is unread data in the pipe.
+    pub(super) fn shut_recv(&self) -> bool {
+        let mut pipe = self.rx.0.lock();
+        pipe.is_reader_shut = true;
+        let has_data = !pipe.buffer.is_empty();
+        drop(pipe);
+
+        // The peer may be able to send more data in packets.
+        self.notify_peer(SocketEvents::CAN_SEND);
+        has_data
+    }
+
+    fn notify_peer(&self, events: SocketEvents) {
+        if let Some(peer) = self.peer.upgrade() {
+            peer.notify_events(events);
+        }
+    }
+}
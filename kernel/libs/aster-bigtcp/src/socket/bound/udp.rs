@@ -167,6 +167,59 @@ impl<E: Ext> UdpSocket<E> {
         Ok(result)
     }
 
+    /// Sends some data as multiple datagrams, which are `segment_size` bytes long except the
+    /// last one.
+    ///
+    /// This is the generic segmentation offload (GSO) of UDP. The datagrams are segmented and
+    /// queued at once with the socket locked, and `f` is called to fill each of them in order. If
+    /// `f` returns `false`, no more datagrams will be queued.
+    ///
+    /// This method fails only if the first datagram cannot be queued. Otherwise, it returns the
+    /// number of the bytes queued, which can be less than `size` if the send buffer is full.
+    ///
+    /// Polling the iface is _always_ required after this method succeeds.
+    pub fn send_segmented<F>(
+        &self,
+        size: usize,
+        segment_size: usize,
+        meta: impl Into<UdpMetadata>,
+        mut f: F,
+    ) -> Result<usize, SendError>
+    where
+        F: FnMut(&mut [u8]) -> bool,
+    {
+        debug_assert!(segment_size > 0);
+
+        let meta = meta.into();
+        let mut socket = self.0.inner.socket.lock();
+
+        if size.min(segment_size) > socket.packet_send_capacity() {
+            return Err(SendError::TooLarge);
+        }
+
+        let mut sent_size = 0;
+        loop {
+            let len = (size - sent_size).min(segment_size);
+            let buffer = match socket.send(len, meta) {
+                Ok(data) => data,
+                Err(err) if sent_size == 0 => return Err(err.into()),
+                Err(_) => break,
+            };
+            sent_size += len;
+
+            if !f(buffer) || sent_size == size {
+                break;
+            }
+        }
+
+        self.0
+            .inner
+            .need_dispatch
+            .store(socket.send_queue() > 0, Ordering::Relaxed);
+
+        Ok(sent_size)
+    }
+
     /// Receives some data.
     ///
     /// Polling the iface is _not_ required after this method succeeds.
@@ -182,6 +235,40 @@ impl<E: Ext> UdpSocket<E> {
         Ok(result)
     }
 
+    /// Receives data from multiple datagrams.
+    ///
+    /// This is the generic receive offload (GRO) of UDP. `f` is called with each of the queued
+    /// datagrams in order, and returns whether the datagram is consumed. The datagrams are
+    /// received until `f` returns `false` or the receive buffer is empty.
+    ///
+    /// This method returns the number of the consumed datagrams. It fails only if the receive
+    /// buffer is empty at first.
+    ///
+    /// Polling the iface is _not_ required after this method succeeds.
+    pub fn recv_while<F>(&self, mut f: F) -> Result<usize, smoltcp::socket::udp::RecvError>
+    where
+        F: FnMut(&[u8], UdpMetadata) -> bool,
+    {
+        let mut socket = self.0.inner.socket.lock();
+
+        let mut nr_datagrams = 0;
+        loop {
+            let should_consume = match socket.peek() {
+                Ok((data, meta)) => f(data, *meta),
+                Err(err) if nr_datagrams == 0 => return Err(err),
+                Err(_) => break,
+            };
+            if !should_consume {
+                break;
+            }
+
+            let _ = socket.recv();
+            nr_datagrams += 1;
+        }
+
+        Ok(nr_datagrams)
+    }
+
     /// Calls `f` with an immutable reference to the associated [`RawUdpSocket`].
     //
     // NOTE: If a mutable reference is required, add a method above that correctly updates the next
@@ -23,6 +23,14 @@ pub struct RawTcpOption {
     pub keep_alive: Option<Duration>,
     /// Whether Nagle's algorithm is enabled.
     pub is_nagle_enabled: bool,
+    /// Whether the listener can share its address with other listeners (SO_REUSEPORT).
+    ///
+    /// This is only used when listening.
+    pub reuse_port: bool,
+    /// The CPU on which the listener prefers to accept connections (SO_INCOMING_CPU).
+    ///
+    /// This is only used when listening.
+    pub incoming_cpu: Option<u32>,
 }
 
 impl RawTcpOption {
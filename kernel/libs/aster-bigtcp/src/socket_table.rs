@@ -3,11 +3,12 @@
 //! This module defines the socket table, which manages all TCP and UDP sockets,
 //! for efficiently inserting, looking up, and removing sockets.
 
-use alloc::{boxed::Box, sync::Arc, vec::Vec};
+use alloc::{boxed::Box, sync::Arc, vec, vec::Vec};
 use core::net::Ipv4Addr;
 
+use aster_softirq::BottomHalfDisabled;
 use jhash::{jhash_1vals, jhash_3vals};
-use ostd::const_assert;
+use ostd::{const_assert, cpu::current_cpu_racy, sync::RwLock};
 use smoltcp::wire::{IpAddress, IpEndpoint, IpListenEndpoint};
 
 use crate::{
@@ -18,11 +19,12 @@ use crate::{
 
 pub type SocketHash = u32;
 
-/// A unique key for identifying a `TcpListener`.
+/// A key for identifying a `TcpListener`.
 ///
 /// Note that two `TcpListener`s cannot listen on the same address
 /// even if both sockets set SO_REUSEADDR to true,
-/// so there cannot be multiple listeners with the same `ListenerKey`.
+/// so there cannot be multiple listeners with the same `ListenerKey`
+/// unless all of them set SO_REUSEPORT to true.
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
 pub(crate) struct ListenerKey {
     addr: IpAddress,
@@ -127,6 +129,10 @@ const fn hash_addr_port(addr: IpAddress, port: PortNum) -> SocketHash {
 /// Unlike the Linux inet hashtable, which is shared across a single network namespace,
 /// this table is currently limited to a single interface.
 ///
+/// Each hash bucket is protected by its own lock, so lookups and updates in different buckets
+/// do not contend. Lookups take the bucket locks as readers and clone the found sockets, so the
+/// locks are held only briefly and never while a socket is being processed.
+///
 // TODO: Modify the table to be shared across a single network namespace
 // to support INADDR_ANY (0.0.0.0).
 pub(crate) struct SocketTable<E: Ext> {
@@ -141,7 +147,7 @@ pub(crate) struct SocketTable<E: Ext> {
     // Here we include UDP sockets in the socket table for simplicity.
     // Note that multiple UDP sockets can be bound to the same address,
     // so we cannot use (addr, port) as a _unique_ key for UDP sockets.
-    udp_sockets: Vec<Arc<UdpSocketBg<E>>>,
+    udp_sockets: RwLock<Vec<Arc<UdpSocketBg<E>>>, BottomHalfDisabled>,
 }
 
 // On Linux, the number of buckets is determined at runtime based on the available memory.
@@ -165,7 +171,7 @@ impl<E: Ext> SocketTable<E> {
             .map(|_| ConnectionHashBucket::new())
             .collect();
 
-        let udp_sockets = Vec::new();
+        let udp_sockets = RwLock::new(Vec::new());
 
         Self {
             listener_buckets,
@@ -174,122 +180,146 @@ impl<E: Ext> SocketTable<E> {
         }
     }
 
+    fn listener_bucket(&self, key: &ListenerKey) -> &ListenerHashBucket<E> {
+        let bucket_index = key.hash() & LISTENER_BUCKET_MASK;
+        &self.listener_buckets[bucket_index as usize]
+    }
+
+    fn connection_bucket(&self, key: &ConnectionKey) -> &ConnectionHashBucket<E> {
+        let bucket_index = key.hash() & CONNECTION_BUCKET_MASK;
+        &self.connection_buckets[bucket_index as usize]
+    }
+
     /// Inserts a TCP listener into the table.
     ///
     /// If a socket with the same [`ListenerKey`] has already been inserted,
-    /// this method will return an error and the listener will not be inserted.
+    /// this method will return an error and the listener will not be inserted,
+    /// unless both sockets enable SO_REUSEPORT (see [`Self::can_insert_listener`]).
     pub(crate) fn insert_listener(
-        &mut self,
+        &self,
         listener: Arc<TcpListenerBg<E>>,
     ) -> Result<(), Arc<TcpListenerBg<E>>> {
         let key = listener.listener_key();
-
-        let bucket = {
-            let hash = key.hash();
-            let bucket_index = hash & LISTENER_BUCKET_MASK;
-            &mut self.listener_buckets[bucket_index as usize]
+        let mut groups = self.listener_bucket(key).groups.write();
+
+        let Some(group) = groups.iter_mut().find(|group| group.key == *key) else {
+            groups.push(ListenerGroup {
+                key: *key,
+                listeners: vec![listener],
+            });
+            return Ok(());
         };
 
-        if bucket
-            .listeners
-            .iter()
-            .any(|tcp_listener| tcp_listener.listener_key() == listener.listener_key())
-        {
+        if !group.can_insert(listener.reuse_port()) {
             return Err(listener);
         }
-
-        bucket.listeners.push(listener);
+        group.listeners.push(listener);
         Ok(())
     }
 
+    /// Returns whether a TCP listener with the [`ListenerKey`] can be inserted.
+    ///
+    /// Multiple listeners can share the same [`ListenerKey`] if all of them enable
+    /// SO_REUSEPORT. Such listeners form a group, and the incoming connections are distributed
+    /// among the listeners in the group.
+    ///
+    /// Note that the result may be outdated once this method returns, unless the caller
+    /// serializes the insertions of the listeners.
+    pub(crate) fn can_insert_listener(&self, key: &ListenerKey, reuse_port: bool) -> bool {
+        let groups = self.listener_bucket(key).groups.read();
+        groups
+            .iter()
+            .find(|group| group.key == *key)
+            .is_none_or(|group| group.can_insert(reuse_port))
+    }
+
+    /// Inserts a TCP connection into the table.
+    ///
+    /// If a socket with the same [`ConnectionKey`] has already been inserted,
+    /// this method will return an error and the connection will not be inserted.
     pub(crate) fn insert_connection(
-        &mut self,
+        &self,
         connection: Arc<TcpConnectionBg<E>>,
     ) -> Result<(), Arc<TcpConnectionBg<E>>> {
         let key = connection.connection_key();
+        let mut connections = self.connection_bucket(key).connections.write();
 
-        let bucket = {
-            let hash = key.hash();
-            let bucket_index = hash & CONNECTION_BUCKET_MASK;
-            &mut self.connection_buckets[bucket_index as usize]
-        };
-
-        if bucket
-            .connections
+        if connections
             .iter()
-            .any(|tcp_connection| tcp_connection.connection_key() == connection.connection_key())
+            .any(|tcp_connection| tcp_connection.connection_key() == key)
         {
             return Err(connection);
         }
 
-        bucket.connections.push(connection);
+        connections.push(connection);
         Ok(())
     }
 
-    pub(crate) fn insert_udp_socket(&mut self, udp_socket: Arc<UdpSocketBg<E>>) {
-        debug_assert!(!self
-            .udp_sockets
+    pub(crate) fn insert_udp_socket(&self, udp_socket: Arc<UdpSocketBg<E>>) {
+        let mut udp_sockets = self.udp_sockets.write();
+        debug_assert!(!udp_sockets
             .iter()
             .any(|socket| Arc::ptr_eq(socket, &udp_socket)));
-        self.udp_sockets.push(udp_socket);
+        udp_sockets.push(udp_socket);
     }
 
-    pub(crate) fn lookup_listener(&self, key: &ListenerKey) -> Option<&Arc<TcpListenerBg<E>>> {
-        let bucket = {
-            let hash = key.hash();
-            let bucket_index = hash & LISTENER_BUCKET_MASK;
-            &self.listener_buckets[bucket_index as usize]
-        };
-
-        bucket
-            .listeners
+    /// Looks up the TCP listener that should handle a new connection.
+    ///
+    /// If there are multiple listeners with the [`ListenerKey`], one of them is selected by
+    /// `conn_hash`, which is the hash value of the new connection. See
+    /// [`ListenerGroup::select`] for details.
+    pub(crate) fn lookup_listener(
+        &self,
+        key: &ListenerKey,
+        conn_hash: SocketHash,
+    ) -> Option<Arc<TcpListenerBg<E>>> {
+        let groups = self.listener_bucket(key).groups.read();
+        groups
             .iter()
-            .find(|listener| listener.listener_key() == key)
+            .find(|group| group.key == *key)
+            .map(|group| group.select(conn_hash).clone())
     }
 
-    pub(crate) fn lookup_connection(
-        &self,
-        key: &ConnectionKey,
-    ) -> Option<&Arc<TcpConnectionBg<E>>> {
-        let bucket = {
-            let hash = key.hash();
-            let bucket_index = hash & CONNECTION_BUCKET_MASK;
-            &self.connection_buckets[bucket_index as usize]
-        };
-
-        bucket
-            .connections
+    pub(crate) fn lookup_connection(&self, key: &ConnectionKey) -> Option<Arc<TcpConnectionBg<E>>> {
+        let connections = self.connection_bucket(key).connections.read();
+        connections
             .iter()
             .find(|connection| connection.connection_key() == key)
+            .cloned()
     }
 
-    pub(crate) fn remove_listener(&mut self, key: &ListenerKey) -> Option<Arc<TcpListenerBg<E>>> {
-        let bucket = {
-            let hash = key.hash();
-            let bucket_index = hash & LISTENER_BUCKET_MASK;
-            &mut self.listener_buckets[bucket_index as usize]
-        };
+    pub(crate) fn remove_listener(
+        &self,
+        listener: &Arc<TcpListenerBg<E>>,
+    ) -> Option<Arc<TcpListenerBg<E>>> {
+        let key = listener.listener_key();
+        let mut groups = self.listener_bucket(key).groups.write();
 
-        let index = bucket
+        let group_index = groups.iter().position(|group| group.key == *key)?;
+        let group = &mut groups[group_index];
+
+        let index = group
             .listeners
             .iter()
-            .position(|tcp_listener| tcp_listener.listener_key() == key)?;
-        Some(bucket.listeners.swap_remove(index))
+            .position(|tcp_listener| Arc::ptr_eq(tcp_listener, listener))?;
+        let removed = group.listeners.swap_remove(index);
+
+        if group.listeners.is_empty() {
+            groups.swap_remove(group_index);
+        }
+
+        Some(removed)
     }
 
-    pub(crate) fn remove_dead_tcp_connection(&mut self, key: &ConnectionKey) {
-        let bucket = {
-            let hash = key.hash();
-            let bucket_index = hash & CONNECTION_BUCKET_MASK;
-            &mut self.connection_buckets[bucket_index as usize]
+    pub(crate) fn remove_dead_tcp_connection(&self, key: &ConnectionKey) {
+        let connection = {
+            let mut connections = self.connection_bucket(key).connections.write();
+            let index = connections
+                .iter()
+                .position(|tcp_connection| tcp_connection.connection_key() == key)
+                .unwrap();
+            connections.swap_remove(index)
         };
-
-        let index = bucket
-            .connections
-            .iter()
-            .position(|tcp_connection| tcp_connection.connection_key() == key)
-            .unwrap();
-        let connection = bucket.connections.swap_remove(index);
         debug_assert!(
             !connection.poll_key().is_active(),
             "there should be no need to poll a dead TCP connection",
@@ -299,18 +329,30 @@ impl<E: Ext> SocketTable<E> {
     }
 
     pub(crate) fn remove_udp_socket(
-        &mut self,
+        &self,
         socket: &Arc<UdpSocketBg<E>>,
     ) -> Option<Arc<UdpSocketBg<E>>> {
-        let index = self
-            .udp_sockets
+        let mut udp_sockets = self.udp_sockets.write();
+        let index = udp_sockets
             .iter()
             .position(|udp_socket| Arc::ptr_eq(udp_socket, socket))?;
-        Some(self.udp_sockets.swap_remove(index))
+        Some(udp_sockets.swap_remove(index))
     }
 
-    pub(crate) fn udp_socket_iter(&self) -> impl Iterator<Item = &Arc<UdpSocketBg<E>>> {
-        self.udp_sockets.iter()
+    /// Returns the UDP sockets that satisfy the predicate.
+    ///
+    /// The sockets are cloned out of the table, so the caller can process them without blocking
+    /// the insertion or removal of UDP sockets.
+    pub(crate) fn udp_sockets_matching<F>(&self, mut predicate: F) -> Vec<Arc<UdpSocketBg<E>>>
+    where
+        F: FnMut(&UdpSocketBg<E>) -> bool,
+    {
+        self.udp_sockets
+            .read()
+            .iter()
+            .filter(|udp_socket| predicate(udp_socket))
+            .cloned()
+            .collect()
     }
 }
 
@@ -321,17 +363,80 @@ impl<E: Ext> Default for SocketTable<E> {
 }
 
 struct ListenerHashBucket<E: Ext> {
-    listeners: Vec<Arc<TcpListenerBg<E>>>,
+    groups: RwLock<Vec<ListenerGroup<E>>, BottomHalfDisabled>,
 }
 
 impl<E: Ext> ListenerHashBucket<E> {
     const fn new() -> Self {
         Self {
-            listeners: Vec::new(),
+            groups: RwLock::new(Vec::new()),
+        }
+    }
+}
+
+struct ConnectionHashBucket<E: Ext> {
+    connections: RwLock<Vec<Arc<TcpConnectionBg<E>>>, BottomHalfDisabled>,
+}
+
+impl<E: Ext> ConnectionHashBucket<E> {
+    const fn new() -> Self {
+        Self {
+            connections: RwLock::new(Vec::new()),
+        }
+    }
+}
+
+/// The TCP listeners with the same [`ListenerKey`].
+///
+/// A group has more than one listener only if all of them enable SO_REUSEPORT. Each listener
+/// has its own backlog, so the listeners (typically owned by different processes or threads)
+/// accept connections without contending for a shared queue.
+struct ListenerGroup<E: Ext> {
+    key: ListenerKey,
+    /// The listeners, which are never empty.
+    listeners: Vec<Arc<TcpListenerBg<E>>>,
+}
+
+impl<E: Ext> ListenerGroup<E> {
+    /// Returns whether a listener can be inserted into the group.
+    fn can_insert(&self, reuse_port: bool) -> bool {
+        // TODO: Linux also requires that the listeners in a group have the same effective user
+        // ID, which prevents other users from hijacking the connections.
+        reuse_port && self.listeners.iter().all(|listener| listener.reuse_port())
+    }
+
+    /// Selects the listener that should handle a new connection.
+    ///
+    /// Following Linux, the listeners whose SO_INCOMING_CPU is the current CPU are preferred, so
+    /// the connection is accepted on the CPU that processes its packets. Among the candidates,
+    /// the listener is selected by `conn_hash`, so the packets of a connection always select the
+    /// same listener while the group is unchanged.
+    fn select(&self, conn_hash: SocketHash) -> &Arc<TcpListenerBg<E>> {
+        if let [listener] = self.listeners.as_slice() {
+            return listener;
+        }
+
+        let current_cpu = current_cpu_racy().as_usize() as u32;
+        let is_local =
+            |listener: &&Arc<TcpListenerBg<E>>| listener.incoming_cpu() == Some(current_cpu);
+
+        let nr_local = self.listeners.iter().filter(is_local).count();
+        if nr_local > 0 {
+            let index = reciprocal_scale(conn_hash, nr_local);
+            return self.listeners.iter().filter(is_local).nth(index).unwrap();
         }
+
+        &self.listeners[reciprocal_scale(conn_hash, self.listeners.len())]
     }
 }
 
+/// Maps `hash` to `[0, n)`.
+///
+/// This is faster than the modulo operation and does not bias towards the low bits of `hash`.
+const fn reciprocal_scale(hash: SocketHash, n: usize) -> usize {
+    ((hash as u64 * n as u64) >> 32) as usize
+}
+
 struct ConnectionHashBucket<E: Ext> {
     connections: Vec<Arc<TcpConnectionBg<E>>>,
 }
@@ -2,6 +2,8 @@
 
 use alloc::vec::Vec;
 
+const WORD_BITS: usize = u64::BITS as usize;
+
 /// SlotVec is the variant of Vector.
 /// It guarantees that the index of one item remains unchanged during adding
 /// or deleting other items of the vector.
@@ -12,6 +14,10 @@ pub struct SlotVec<T> {
     // The number of occupied slots.
     // The i-th slot is occupied if `self.slots[i].is_some()`.
     num_occupied: usize,
+    // The bitmap of the occupied slots, so that `put` can find the lowest empty slot by words.
+    occupied: Vec<u64>,
+    // No slot below this index is empty, like `next_fd` in Linux.
+    next_free: usize,
 }
 
 impl<T> SlotVec<T> {
@@ -20,6 +26,8 @@ impl<T> SlotVec<T> {
         Self {
             slots: Vec::new(),
             num_occupied: 0,
+            occupied: Vec::new(),
+            next_free: 0,
         }
     }
 
@@ -27,6 +35,8 @@ impl<T> SlotVec<T> {
         Self {
             slots: Vec::with_capacity(capacity),
             num_occupied: 0,
+            occupied: Vec::with_capacity(capacity.div_ceil(WORD_BITS)),
+            next_free: 0,
         }
     }
 
@@ -60,18 +70,18 @@ impl<T> SlotVec<T> {
     }
 
     /// Put an item into the vector.
-    /// It may be put into any existing empty slots or the back of the vector.
+    /// It is put into the lowest empty slot, or the back of the vector if there is none.
     ///
     /// Return the index of the inserted item.
     pub fn put(&mut self, entry: T) -> usize {
-        let idx = if self.num_occupied == self.slots.len() {
-            self.slots.push(Some(entry));
-            self.slots.len() - 1
-        } else {
-            let idx = self.slots.iter().position(|x| x.is_none()).unwrap();
+        let idx = self.lowest_free();
+        if idx < self.slots.len() {
             self.slots[idx] = Some(entry);
-            idx
-        };
+        } else {
+            self.slots.push(Some(entry));
+        }
+        self.mark_occupied(idx);
+        self.next_free = idx + 1;
         self.num_occupied += 1;
         idx
     }
@@ -87,6 +97,7 @@ impl<T> SlotVec<T> {
         core::mem::swap(&mut sub_item, &mut self.slots[idx]);
         if sub_item.is_none() {
             self.num_occupied += 1;
+            self.mark_occupied(idx);
         }
         sub_item
     }
@@ -103,6 +114,8 @@ impl<T> SlotVec<T> {
         if del_item.is_some() {
             debug_assert!(self.num_occupied > 0);
             self.num_occupied -= 1;
+            self.occupied[idx / WORD_BITS] &= !(1 << (idx % WORD_BITS));
+            self.next_free = self.next_free.min(idx);
         }
         del_item
     }
@@ -117,10 +130,44 @@ impl<T> SlotVec<T> {
             .map(|(idx, x)| (idx, x.as_ref().unwrap()))
     }
 
+    /// Create an iterator which gives both of the index and the item, starting from the
+    /// index `start`.
+    ///
+    /// Unlike skipping the items of [`Self::idxes_and_items`], this does not iterate over the
+    /// slots before `start`.
+    pub fn idxes_and_items_from(&self, start: usize) -> impl Iterator<Item = (usize, &'_ T)> {
+        let slots = self.slots.get(start..).unwrap_or(&[]);
+        slots
+            .iter()
+            .enumerate()
+            .filter_map(move |(idx, x)| Some((start + idx, x.as_ref()?)))
+    }
+
     /// Create an iterator which just gives the item.
     pub fn iter(&self) -> impl Iterator<Item = &'_ T> {
         self.slots.iter().filter_map(|x| x.as_ref())
     }
+
+    /// Returns the index of the lowest empty slot, or the number of slots if there is none.
+    fn lowest_free(&self) -> usize {
+        // The bits beyond the slots are clear, so the first clear bit may be out of bounds.
+        self.occupied
+            .iter()
+            .enumerate()
+            .skip(self.next_free / WORD_BITS)
+            .find(|(_, word)| **word != u64::MAX)
+            .map_or(self.slots.len(), |(i, word)| {
+                (i * WORD_BITS + word.trailing_ones() as usize).min(self.slots.len())
+            })
+    }
+
+    fn mark_occupied(&mut self, idx: usize) {
+        let word_idx = idx / WORD_BITS;
+        if word_idx >= self.occupied.len() {
+            self.occupied.resize(word_idx + 1, 0);
+        }
+        self.occupied[word_idx] |= 1 << (idx % WORD_BITS);
+    }
 }
 
 impl Default for SlotVec<()> {
@@ -13,7 +13,7 @@ use crate::{
     entry::NodeEntryRef,
     mark::{NoneMark, XMark},
     node::{Height, XNode},
-    XArray, XLockGuard, SLOT_SIZE,
+    XArray, XLockGuard, BITS_PER_LAYER,
 };
 
 /// A type representing the state of a [`Cursor`] or a [`CursorMut`].
@@ -23,9 +23,10 @@ use crate::{
 ///  - `AtNode`: The cursor is positioned on some node and holds a shared reference
 ///    to it.
 ///
-/// A cursor never ends up on an interior node. In other words, when methods
-/// of `Cursor` or `CursorMut` finish, the cursor will either not positioned on any node
-/// or positioned on some leaf node.
+/// A cursor never ends up on an interior node, unless the slot it operates on holds a
+/// multi-index item (see [`CursorMut::store_multi`]). In other words, when methods of
+/// `Cursor` or `CursorMut` finish, the cursor will either not positioned on any node,
+/// or positioned on some leaf node, or positioned on an interior slot holding an item.
 enum CursorState<'a, P>
 where
     P: NonNullPtr + Send + Sync,
@@ -78,13 +79,6 @@ impl<'a, P: NonNullPtr + Send + Sync> CursorState<'a, P> {
             Self::Inactive => false,
         }
     }
-
-    fn is_at_leaf(&self) -> bool {
-        match self {
-            Self::AtNode { node, .. } => node.is_leaf(),
-            Self::Inactive => false,
-        }
-    }
 }
 
 /// A `Cursor` can traverse in the [`XArray`] by setting or increasing the
@@ -148,19 +142,33 @@ impl<'a, P: NonNullPtr + Send + Sync, M, G: AsAtomicModeGuard> Cursor<'a, P, M,
 
     /// Traverses from an interior node to the leaf node according to the target index.
     ///
+    /// The traversal stops early at an interior slot that holds a multi-index item.
+    ///
     /// This method will not create new nodes. If the cursor can not reach the target
     /// leaf node, the cursor will be reset to the inactive state.
     fn continue_traverse_to_target(&mut self) {
-        while !self.state.is_at_leaf() {
+        loop {
             let (current_node, operation_offset) =
                 core::mem::take(&mut self.state).into_node().unwrap();
 
-            let Some(next_node) = current_node
-                .deref_target()
-                .entry_with(self.guard, operation_offset)
-                .map(|operated_entry| operated_entry.left().unwrap())
-            else {
-                self.reset();
+            let next_node = if current_node.is_leaf() {
+                None
+            } else {
+                let Some(operated_entry) = current_node
+                    .deref_target()
+                    .entry_with(self.guard, operation_offset)
+                else {
+                    self.reset();
+                    return;
+                };
+                operated_entry.left()
+            };
+
+            let Some(next_node) = next_node else {
+                self.state = CursorState::AtNode {
+                    node: current_node,
+                    operation_offset,
+                };
                 return;
             };
 
@@ -204,23 +212,19 @@ impl<'a, P: NonNullPtr + Send + Sync, M, G: AsAtomicModeGuard> Cursor<'a, P, M,
     /// Once increased, the cursor will be positioned on the corresponding leaf node
     /// if the leaf node exists.
     pub fn next(&mut self) {
+        let old_index = self.index;
         self.index = self.index.checked_add(1).unwrap();
 
-        if !self.state.is_at_node() {
+        let Some((mut current_node, _)) = core::mem::take(&mut self.state).into_node() else {
             return;
-        }
-
-        let (mut current_node, mut operation_offset) =
-            core::mem::take(&mut self.state).into_node().unwrap();
+        };
 
-        operation_offset += 1;
-        while operation_offset == SLOT_SIZE as u8 {
+        while !current_node.height().in_same_node(old_index, self.index) {
             let Some(parent_node) = current_node.deref_target().parent(self.guard) else {
                 self.reset();
                 return;
             };
 
-            operation_offset = current_node.offset_in_parent() + 1;
             current_node = parent_node;
         }
 
@@ -263,10 +267,11 @@ impl<'a, P: NonNullPtr + Send + Sync, M, G: SpinGuardian> CursorMut<'a, P, M, G>
         Self(Cursor::new(xa, guard, index))
     }
 
-    /// Increases the height of the `XArray` so that the `index`-th element can be stored.
-    fn reserve(&self, index: u64) {
+    /// Increases the height of the `XArray` so that the `index`-th element can be stored
+    /// in an `XNode` at the `min_height`.
+    fn reserve(&self, index: u64, min_height: Height) {
         if self.xa.head.read_with(self.guard).is_none() {
-            let height = Height::from_index(index);
+            let height = Height::from_index(index).max(min_height);
             let new_head = Arc::new(XNode::new_root(height));
             self.xa.head.update(Some(new_head));
             return;
@@ -275,7 +280,7 @@ impl<'a, P: NonNullPtr + Send + Sync, M, G: SpinGuardian> CursorMut<'a, P, M, G>
         loop {
             let head = self.xa.head.read_with(self.guard).unwrap();
             let height = head.height();
-            if height.max_index() >= index {
+            if height.max_index() >= index && height >= min_height {
                 return;
             }
 
@@ -286,34 +291,48 @@ impl<'a, P: NonNullPtr + Send + Sync, M, G: SpinGuardian> CursorMut<'a, P, M, G>
         }
     }
 
-    /// Traverses from the root node to the leaf node according to the target index.
+    /// Traverses from the root node to the `XNode` at the `target_height` according to
+    /// the target index.
+    ///
+    /// If the cursor is already positioned on some node, the traversal continues from
+    /// that node, which must not be lower than the `target_height`.
     ///
     /// This method will potentially create new nodes.
-    fn expand_and_traverse_to_target(&mut self) {
-        if self.state.is_at_node() {
-            return;
-        }
+    fn expand_and_traverse_to_target(&mut self, target_height: Height) {
+        if !self.state.is_at_node() {
+            let head = {
+                self.reserve(self.index, target_height);
+                self.xa.head.read_with(self.guard).unwrap()
+            };
 
-        let head = {
-            self.reserve(self.index);
-            self.xa.head.read_with(self.guard).unwrap()
-        };
+            self.0.state.move_to(head, self.0.index);
+        }
 
-        self.0.state.move_to(head, self.0.index);
-        self.continue_traverse_to_target_mut();
+        self.continue_traverse_to_target_mut(target_height);
     }
 
-    /// Traverses from an interior node to the leaf node according to the target index.
+    /// Traverses from an interior node to the `XNode` at the `target_height` according
+    /// to the target index.
     ///
-    /// This method will potentially create new nodes.
-    fn continue_traverse_to_target_mut(&mut self) {
-        while !self.state.is_at_leaf() {
+    /// Empty slots on the way are filled with new nodes. So are the slots holding
+    /// multi-index items, which means that such items are removed from all the indices
+    /// covered by the slots.
+    fn continue_traverse_to_target_mut(&mut self, target_height: Height) {
+        loop {
             let (current_node, operation_offset) =
                 core::mem::take(&mut self.state).into_node().unwrap();
 
-            if current_node
+            if current_node.height() == target_height {
+                self.0.state = CursorState::AtNode {
+                    node: current_node,
+                    operation_offset,
+                };
+                return;
+            }
+
+            if !current_node
                 .entry_with(self.guard, operation_offset)
-                .is_none()
+                .is_some_and(|entry| entry.is_left())
             {
                 let new_node = XNode::new(current_node.height().go_leaf(), operation_offset);
                 let new_entry = Either::Left(Arc::new(new_node));
@@ -334,15 +353,57 @@ impl<'a, P: NonNullPtr + Send + Sync, M, G: SpinGuardian> CursorMut<'a, P, M, G>
     /**** Public ****/
 
     /// Stores a new `item` at the target index.
+    ///
+    /// If the target index is covered by a multi-index item, the item is removed
+    /// from all the indices that share the same slot with the target index.
     pub fn store(&mut self, item: P) {
-        self.expand_and_traverse_to_target();
+        self.expand_and_traverse_to_target(Height::new(1));
         let (node, operation_offset) = self.state.as_node().unwrap();
         node.set_entry(self.guard, operation_offset, Some(Either::Right(item)));
     }
 
+    /// Stores a multi-index `item` that covers `2^order` indices starting from the
+    /// target index.
+    ///
+    /// The item is held by the slots of an interior node if `order` is large enough,
+    /// so that readers find it without going further down the tree. Any items
+    /// previously stored in the covered indices are replaced.
+    ///
+    /// A later [`Self::store`] or [`Self::remove`] at a covered index affects all
+    /// the indices that share the same slot with it. A slot covers
+    /// `2^(order - order % 6)` indices.
+    ///
+    /// # Panics
+    ///
+    /// This method panics if the target index is not aligned to `2^order`.
+    pub fn store_multi(&mut self, order: u32, item: P)
+    where
+        P: Clone,
+    {
+        assert!(order < u64::BITS);
+        assert_eq!(self.index & ((1 << order) - 1), 0);
+
+        let nr_slots = 1u8 << (order % BITS_PER_LAYER as u32);
+        self.reset();
+        self.expand_and_traverse_to_target(Height::from_order(order));
+
+        let (node, first_offset) = self.state.as_node().unwrap();
+        for offset in first_offset..first_offset + nr_slots - 1 {
+            node.set_entry(self.guard, offset, Some(Either::Right(item.clone())));
+        }
+        node.set_entry(
+            self.guard,
+            first_offset + nr_slots - 1,
+            Some(Either::Right(item)),
+        );
+    }
+
     /// Removes the item at the target index.
     ///
     /// Returns the removed item if it previously exists.
+    ///
+    /// If the target index is covered by a multi-index item, the item is removed
+    /// from all the indices that share the same slot with the target index.
     //
     // TODO: Remove the interior node once it becomes empty.
     pub fn remove(&mut self) -> Option<P::Ref<'a>> {
@@ -14,6 +14,11 @@
 //!
 //! `XArray` also provides a convenient way to mark individual items (see [`XMark`]).
 //!
+//! An item can cover multiple indices (see [`CursorMut::store_multi`]), so that a large
+//! object, e.g., a huge page in the page cache, can be found at every index it covers by a
+//! single lookup. Batched modifications are provided by [`LockedXArray::store_range`] and
+//! [`LockedXArray::remove_range`].
+//!
 //! # Example
 //!
 //! ```
@@ -223,6 +228,29 @@ impl<P: NonNullPtr + Send + Sync, M, G: SpinGuardian> LockedXArray<'_, P, M, G>
         cursor.store(item)
     }
 
+    /// Stores a multi-index `item` that covers `2^order` indices starting from `index`.
+    ///
+    /// See [`CursorMut::store_multi`] for more information.
+    pub fn store_multi(&mut self, index: u64, order: u32, item: P)
+    where
+        P: Clone,
+    {
+        let mut cursor = self.cursor_mut(index);
+        cursor.store_multi(order, item)
+    }
+
+    /// Stores the `items` at the consecutive indices starting from `start`.
+    ///
+    /// This is faster than storing the items one by one, since the tree is only
+    /// traversed from the head when the storing goes across leaf nodes.
+    pub fn store_range(&mut self, start: u64, items: impl IntoIterator<Item = P>) {
+        let mut cursor = self.cursor_mut(start);
+        for item in items {
+            cursor.store(item);
+            cursor.next();
+        }
+    }
+
     /// Removes the item at the target index.
     ///
     /// Returns the removed item if some item was previously stored in the same position.
@@ -231,6 +259,21 @@ impl<P: NonNullPtr + Send + Sync, M, G: SpinGuardian> LockedXArray<'_, P, M, G>
         cursor.remove()
     }
 
+    /// Removes all the items in the specified `range`.
+    ///
+    /// For each removed item, `on_removed` is called with the index where the item is
+    /// found. A multi-index item is removed at once with all the indices sharing its
+    /// slot, so `on_removed` is only called with the first of them in the `range`.
+    pub fn remove_range(&mut self, range: core::ops::Range<u64>, mut on_removed: impl FnMut(u64)) {
+        let mut cursor = self.cursor_mut(range.start);
+        while cursor.index() < range.end {
+            if cursor.remove().is_some() {
+                on_removed(cursor.index());
+            }
+            cursor.next();
+        }
+    }
+
     /// Creates a [`Cursor`] to perform read-related operations.
     pub fn cursor(&self, index: u64) -> Cursor<'_, P, M, XLockGuard<G>> {
         Cursor::new(self.xa, &self.guard, index)
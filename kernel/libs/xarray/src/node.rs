@@ -95,6 +95,22 @@ impl Height {
     pub fn max_index(&self) -> u64 {
         ((SLOT_SIZE as u64) << self.height_shift()) - 1
     }
+
+    /// Creates the `Height` of the `XNode`s whose slots can hold items of the
+    /// given `order`, i.e., items spanning `2^order` indices.
+    ///
+    /// Each slot in such an `XNode` spans `2^(order - order % BITS_PER_LAYER)`
+    /// indices, so an item is stored in `2^(order % BITS_PER_LAYER)` slots.
+    pub fn from_order(order: u32) -> Self {
+        Self::new((order / BITS_PER_LAYER as u32) as u8 + 1)
+    }
+
+    /// Checks whether the `index1`-th and the `index2`-th items belong to
+    /// the same `XNode` at the current height.
+    pub fn in_same_node(&self, index1: u64, index2: u64) -> bool {
+        let shift = self.height_shift() as u32 + BITS_PER_LAYER as u32;
+        index1.checked_shr(shift).unwrap_or(0) == index2.checked_shr(shift).unwrap_or(0)
+    }
 }
 
 /// The `XNode` is the intermediate node in the tree-like structure of the `XArray`.
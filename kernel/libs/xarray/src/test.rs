@@ -273,6 +273,97 @@ fn range() {
     assert_eq!(count, n!(5));
 }
 
+#[ktest]
+fn store_range() {
+    let xarray_arc: XArray<Arc<i32>> = XArray::new();
+    xarray_arc
+        .lock()
+        .store_range(n!(5), (0..n!(100)).map(Arc::new));
+
+    let guard = disable_preempt();
+    assert!(xarray_arc.load(&guard, n!(5) - 1).is_none());
+    for i in 0..n!(100) {
+        let value = xarray_arc.load(&guard, (n!(5) + i) as u64).unwrap();
+        assert_eq!(*value.as_ref(), i);
+    }
+    assert!(xarray_arc.load(&guard, n!(105)).is_none());
+}
+
+#[ktest]
+fn remove_range() {
+    let xarray_arc: XArray<Arc<i32>> = XArray::new();
+    init_sparse_with_arc(&xarray_arc, n!(100));
+
+    let mut count = 0;
+    xarray_arc.lock().remove_range(n!(10)..n!(110), |index| {
+        assert_eq!(index % 2, 0);
+        count += 1;
+    });
+    assert_eq!(count, n!(50));
+
+    let guard = disable_preempt();
+    assert!(xarray_arc.load(&guard, n!(10) - 2).is_some());
+    for i in n!(10)..n!(110) {
+        assert!(xarray_arc.load(&guard, i as u64).is_none());
+    }
+    assert!(xarray_arc.load(&guard, n!(110)).is_some());
+}
+
+#[ktest]
+fn store_multi() {
+    let xarray_arc: XArray<Arc<i32>> = XArray::new();
+    // One slot in a height-2 node.
+    xarray_arc.lock().store_multi(64, 6, Arc::new(6));
+    // Eight slots in a height-2 node, like a 2 MiB huge page.
+    xarray_arc.lock().store_multi(512, 9, Arc::new(9));
+    // Two slots in a leaf node.
+    xarray_arc.lock().store_multi(2, 1, Arc::new(1));
+
+    let guard = disable_preempt();
+    let mut cursor = xarray_arc.cursor(&guard, 0);
+    for i in 0..2048 {
+        let expected = match i {
+            2..4 => Some(1),
+            64..128 => Some(6),
+            512..1024 => Some(9),
+            _ => None,
+        };
+        assert_eq!(cursor.load().map(|value| *value.as_ref()), expected);
+        assert_eq!(
+            xarray_arc.load(&guard, i).map(|value| *value.as_ref()),
+            expected
+        );
+        cursor.next();
+    }
+}
+
+#[ktest]
+fn store_multi_overwrite() {
+    let xarray_arc: XArray<Arc<i32>> = XArray::new();
+    init_continuous_with_arc(&xarray_arc, n!(100));
+
+    let mut locked_xarray = xarray_arc.lock();
+    locked_xarray.store_multi(128, 7, Arc::new(-1));
+    for i in 128..256 {
+        assert_eq!(*locked_xarray.load(i).unwrap().as_ref(), -1);
+    }
+    assert_eq!(*locked_xarray.load(127).unwrap().as_ref(), 127);
+    assert_eq!(*locked_xarray.load(256).unwrap().as_ref(), 256);
+
+    // Storing in a slot of the multi-index item replaces it in the whole slot.
+    locked_xarray.store(130, Arc::new(130));
+    assert_eq!(*locked_xarray.load(130).unwrap().as_ref(), 130);
+    assert!(locked_xarray.load(129).is_none());
+    assert!(locked_xarray.load(191).is_none());
+    assert_eq!(*locked_xarray.load(192).unwrap().as_ref(), -1);
+
+    // Removing in a slot of the multi-index item removes it in the whole slot.
+    assert_eq!(*locked_xarray.remove(200).unwrap().as_ref(), -1);
+    for i in 192..256 {
+        assert!(locked_xarray.load(i).is_none());
+    }
+}
+
 #[ktest]
 fn load_after_clear() {
     let xarray_arc: XArray<Arc<i32>> = XArray::new();
@@ -153,6 +153,24 @@ impl<'a> CurrentUserSpace<'a> {
         Ok(user_writer.write_val(val)?)
     }
 
+    /// Atomically compares and exchanges a `u32` value in the user space of
+    /// the current process.
+    ///
+    /// The value at `dest` is replaced by `new_val` if it equals `old_val`.
+    /// Returns the previous value, which equals `old_val` if and only if the
+    /// exchange succeeds.
+    pub fn atomic_compare_exchange_u32(
+        &self,
+        dest: Vaddr,
+        old_val: u32,
+        new_val: u32,
+    ) -> Result<u32> {
+        check_vaddr(dest)?;
+
+        let user_writer = self.writer(dest, core::mem::size_of::<u32>())?;
+        Ok(user_writer.atomic_compare_exchange_u32(old_val, new_val)?)
+    }
+
     /// Reads a C string from the user space of the current process.
     /// The length of the string should not exceed `max_len`,
     /// including the final `\0` byte.
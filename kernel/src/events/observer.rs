@@ -32,6 +32,18 @@ use super::Events;
 pub trait Observer<E: Events>: Send + Sync {
     /// Notify the observer that some interesting events happen.
     fn on_events(&self, events: &E);
+
+    /// Notify the observer, which is registered as an exclusive observer, that some interesting
+    /// events happen.
+    ///
+    /// The return value indicates whether the observer has accepted the events. A subject stops
+    /// notifying the other exclusive observers once one of them accepts the events.
+    ///
+    /// By default, this method calls [`Self::on_events`] and always accepts the events.
+    fn on_exclusive_events(&self, events: &E) -> bool {
+        self.on_events(events);
+        true
+    }
 }
 
 impl<E: Events> Observer<E> for () {
@@ -9,11 +9,23 @@ use super::{Events, EventsFilter, Observer};
 use crate::prelude::*;
 
 /// A Subject notifies interesting events to registered observers.
+///
+/// An observer can be registered as an exclusive observer (see
+/// [`Subject::register_exclusive_observer`]). Each event notifies all the non-exclusive
+/// observers, but only one of the exclusive observers that accepts the event.
 pub struct Subject<E: Events, F: EventsFilter<E> = ()> {
     // A table that maintains all interesting observers.
-    observers: SpinLock<BTreeMap<KeyableWeak<dyn Observer<E>>, F>, LocalIrqDisabled>,
+    observers: SpinLock<BTreeMap<KeyableWeak<dyn Observer<E>>, Registration<F>>, LocalIrqDisabled>,
     // To reduce lock contentions, we maintain a counter for the size of the table
     num_observers: AtomicUsize,
+    // The exclusive observer from which the next notification starts, so that the events are
+    // distributed among the exclusive observers in a round-robin way.
+    exclusive_cursor: AtomicUsize,
+}
+
+struct Registration<F> {
+    filter: F,
+    is_exclusive: bool,
 }
 
 impl<E: Events, F: EventsFilter<E>> Subject<E, F> {
@@ -21,6 +33,7 @@ impl<E: Events, F: EventsFilter<E>> Subject<E, F> {
         Self {
             observers: SpinLock::new(BTreeMap::new()),
             num_observers: AtomicUsize::new(0),
+            exclusive_cursor: AtomicUsize::new(0),
         }
     }
 
@@ -32,10 +45,31 @@ impl<E: Events, F: EventsFilter<E>> Subject<E, F> {
     /// If the given observer has already been registered, then its registered events
     /// filter will be updated.
     pub fn register_observer(&self, observer: Weak<dyn Observer<E>>, filter: F) {
+        self.register(observer, filter, false);
+    }
+
+    /// Register an exclusive observer.
+    ///
+    /// A registered exclusive observer will get notified through its `on_exclusive_events`
+    /// method. Unlike the non-exclusive observers, an event only notifies the exclusive observers
+    /// until one of them accepts the event. This avoids waking up all the waiters (i.e., the
+    /// thundering herd problem) if only one of them can handle the event.
+    ///
+    /// If the given observer has already been registered, then its registered events
+    /// filter will be updated and it will become exclusive.
+    pub fn register_exclusive_observer(&self, observer: Weak<dyn Observer<E>>, filter: F) {
+        self.register(observer, filter, true);
+    }
+
+    fn register(&self, observer: Weak<dyn Observer<E>>, filter: F, is_exclusive: bool) {
         let mut observers = self.observers.lock();
         let is_new = {
             let observer: KeyableWeak<dyn Observer<E>> = observer.into();
-            observers.insert(observer, filter).is_none()
+            let registration = Registration {
+                filter,
+                is_exclusive,
+            };
+            observers.insert(observer, registration).is_none()
         };
         if is_new {
             // This `Acquire` pairs with the `Release` in `notify_observers`.
@@ -63,6 +97,13 @@ impl<E: Events, F: EventsFilter<E>> Subject<E, F> {
         observer
     }
 
+    /// Returns whether there are any registered observers.
+    ///
+    /// The observers which have been freed are counted until the next notification.
+    pub fn has_observers(&self) -> bool {
+        self.num_observers.load(Ordering::Relaxed) > 0
+    }
+
     /// Notify events to all registered observers.
     ///
     /// It will remove the observers which have been freed.
@@ -78,13 +119,19 @@ impl<E: Events, F: EventsFilter<E>> Subject<E, F> {
 
         // Slow path: broadcast the new events to all observers.
         let mut active_observers = Vec::new();
+        let mut exclusive_observers = Vec::new();
         let mut num_freed = 0;
         let mut observers = self.observers.lock();
-        observers.retain(|observer, filter| {
+        observers.retain(|observer, registration| {
             if let Some(observer) = observer.upgrade() {
-                if filter.filter(events) {
-                    // XXX: Mind the performance impact when there comes many active observers
-                    active_observers.push(observer.clone());
+                if !registration.filter.filter(events) {
+                    return true;
+                }
+                // XXX: Mind the performance impact when there comes many active observers
+                if registration.is_exclusive {
+                    exclusive_observers.push(observer);
+                } else {
+                    active_observers.push(observer);
                 }
                 true
             } else {
@@ -100,6 +147,18 @@ impl<E: Events, F: EventsFilter<E>> Subject<E, F> {
         for observer in active_observers {
             observer.on_events(events);
         }
+
+        if exclusive_observers.is_empty() {
+            return;
+        }
+        let start =
+            self.exclusive_cursor.fetch_add(1, Ordering::Relaxed) % exclusive_observers.len();
+        exclusive_observers.rotate_left(start);
+        for observer in exclusive_observers {
+            if observer.on_exclusive_events(events) {
+                break;
+            }
+        }
     }
 }
 
@@ -147,12 +147,20 @@ impl Entry {
 
         inner.event = event;
         inner.flags = flags;
+        inner
+            .poller
+            .set_exclusive(flags.contains(EpollFlags::EXCLUSIVE));
 
         self.observer.set_enabled(&inner);
 
         file.poll(event.events, Some(&mut inner.poller))
     }
 
+    /// Gets the flags of the epoll entry.
+    pub(super) fn flags(&self) -> EpollFlags {
+        self.inner.lock().flags
+    }
+
     /// Shuts down the epoll entry.
     ///
     /// This method needs to be called in response to `EpollCtl::Del`.
@@ -269,6 +277,13 @@ impl events::Observer<IoEvents> for Observer {
     fn on_events(&self, _events: &IoEvents) {
         self.ready_set.push(self);
     }
+
+    fn on_exclusive_events(&self, _events: &IoEvents) -> bool {
+        // Like Linux, the events are accepted only if some threads are waiting for the epoll
+        // file. Otherwise, the other epoll files are given a chance to wake up their waiters, but
+        // the events are still kept in our ready list.
+        self.ready_set.push(self) && self.ready_set.pollee.has_pollers()
+    }
 }
 
 /// A set of ready epoll entries.
@@ -292,7 +307,10 @@ impl ReadySet {
         }
     }
 
-    pub(super) fn push(&self, observer: &Observer) {
+    /// Pushes the epoll entry to the ready list.
+    ///
+    /// This method returns `false` if the epoll entry is disabled.
+    pub(super) fn push(&self, observer: &Observer) -> bool {
         // Note that we cannot take the `Inner` lock because we may be in the callback of the event
         // observer. Doing so will cause dead locks due to inconsistent locking orders.
         //
@@ -302,7 +320,7 @@ impl ReadySet {
         // - Catching spurious events here is always fine because we always check them later before
         //   returning events to the user (in `Entry::poll`).
         if !observer.is_enabled() {
-            return;
+            return false;
         }
 
         let mut entries = self.entries.lock();
@@ -316,6 +334,8 @@ impl ReadySet {
         // there might be new events that we are interested in.
         // Wake the poller anyway.
         self.pollee.notify(IoEvents::IN);
+
+        true
     }
 
     pub(super) fn lock_pop(&self) -> ReadySetPopIter {
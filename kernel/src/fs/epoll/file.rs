@@ -11,15 +11,18 @@ use super::{
     EpollCtl, EpollEvent, EpollFlags,
 };
 use crate::{
+    current_userspace,
     events::IoEvents,
     fs::{
         file_handle::FileLike,
         file_table::{get_file_fast, FileDesc},
         utils::{InodeMode, IoctlCmd, Metadata},
     },
+    net::iface::busy_poll,
     prelude::*,
     process::{
-        posix_thread::ThreadLocal,
+        credentials::capabilities::CapSet,
+        posix_thread::{AsPosixThread, ThreadLocal},
         signal::{PollHandle, Pollable},
     },
 };
@@ -44,6 +47,8 @@ pub struct EpollFile {
     // Keep this in a separate `Arc` to avoid dropping `EpollFile` in the observer callback, which
     // may cause deadlocks.
     ready: Arc<ReadySet>,
+    // The busy poll parameters.
+    params: SpinLock<EpollParams>,
 }
 
 impl EpollFile {
@@ -52,6 +57,7 @@ impl EpollFile {
         Arc::new(Self {
             interest: Mutex::new(BTreeSet::new()),
             ready: Arc::new(ReadySet::new()),
+            params: SpinLock::new(EpollParams::default()),
         })
     }
 
@@ -87,6 +93,10 @@ impl EpollFile {
     ) -> Result<()> {
         self.warn_unsupported_flags(&ep_flags);
 
+        if ep_flags.contains(EpollFlags::EXCLUSIVE) {
+            Self::check_exclusive(&file, &ep_event, &ep_flags)?;
+        }
+
         // Add the new entry to the interest list and start monitoring its events
         let ready_entry = {
             let mut interest = self.interest.lock();
@@ -147,6 +157,13 @@ impl EpollFile {
     ) -> Result<()> {
         self.warn_unsupported_flags(&new_ep_flags);
 
+        if new_ep_flags.contains(EpollFlags::EXCLUSIVE) {
+            return_errno_with_message!(
+                Errno::EINVAL,
+                "the exclusive flag can only be specified when adding a file"
+            );
+        }
+
         // Update the epoll entry
         let ready_entry = {
             let interest = self.interest.lock();
@@ -155,6 +172,12 @@ impl EpollFile {
                 interest.get(&EntryKey::from((fd, &file))).ok_or_else(|| {
                     Error::with_message(Errno::ENOENT, "the file is not in the interest list")
                 })?;
+            if entry.flags().contains(EpollFlags::EXCLUSIVE) {
+                return_errno_with_message!(
+                    Errno::EINVAL,
+                    "the file is added with the exclusive flag"
+                );
+            }
             let events = entry.update(new_ep_event, new_ep_flags);
 
             if !events.is_empty() {
@@ -182,10 +205,13 @@ impl EpollFile {
     ///
     /// When `max_events` equals to zero, the method returns when the timeout
     /// expires or a signal arrives.
+    ///
+    /// If the busy poll parameters are set, the network interfaces are polled
+    /// for at most `busy_poll_usecs` microseconds before blocking.
     pub fn wait(&self, max_events: usize, timeout: Option<&Duration>) -> Result<Vec<EpollEvent>> {
         let mut ep_events = Vec::new();
 
-        self.wait_events(IoEvents::IN, timeout, || {
+        let mut try_pop_ready = || {
             self.pop_multi_ready(max_events, &mut ep_events);
 
             if ep_events.is_empty() {
@@ -196,11 +222,48 @@ impl EpollFile {
             }
 
             Ok(())
-        })?;
+        };
+
+        let params = *self.params.lock();
+        let busy_poll_time = Duration::from_micros(params.busy_poll_usecs as u64)
+            .min(timeout.copied().unwrap_or(Duration::MAX));
+        if !busy_poll_time.is_zero() {
+            let prefer = params.prefer_busy_poll != 0;
+            match busy_poll(None, busy_poll_time, prefer, &mut try_pop_ready) {
+                Err(err) if err.error() == Errno::EAGAIN => (),
+                result => return result.map(|_| ep_events),
+            }
+        }
+
+        self.wait_events(IoEvents::IN, timeout, try_pop_ready)?;
 
         Ok(ep_events)
     }
 
+    fn set_params(&self, params: EpollParams) -> Result<()> {
+        /// The default packet budget of a poll in Linux.
+        const NAPI_POLL_WEIGHT: u16 = 64;
+
+        if params.busy_poll_usecs > i32::MAX as u32 || params.prefer_busy_poll > 1 {
+            return_errno_with_message!(Errno::EINVAL, "the busy poll parameters are invalid");
+        }
+        if params.pad != 0 {
+            return_errno_with_message!(Errno::EINVAL, "the padding is not zero");
+        }
+        if params.busy_poll_budget > NAPI_POLL_WEIGHT {
+            let credentials = current_thread!().as_posix_thread().unwrap().credentials();
+            if !credentials.effective_capset().contains(CapSet::NET_ADMIN) {
+                return_errno_with_message!(
+                    Errno::EPERM,
+                    "a large busy poll budget requires CAP_NET_ADMIN"
+                );
+            }
+        }
+
+        *self.params.lock() = params;
+        Ok(())
+    }
+
     fn pop_multi_ready(&self, max_events: usize, ep_events: &mut Vec<EpollEvent>) {
         let mut pop_iter = self.ready.lock_pop();
 
@@ -240,10 +303,38 @@ impl EpollFile {
     }
 
     fn warn_unsupported_flags(&self, flags: &EpollFlags) {
-        if flags.intersects(EpollFlags::EXCLUSIVE | EpollFlags::WAKE_UP) {
+        if flags.intersects(EpollFlags::WAKE_UP) {
             warn!("{:?} contains unsupported flags", flags);
         }
     }
+
+    /// Checks whether the file can be added with the exclusive flag.
+    ///
+    /// Like Linux, an exclusive entry only accepts a limited set of events and flags, and it
+    /// cannot monitor another epoll file.
+    fn check_exclusive(
+        file: &Arc<dyn FileLike>,
+        ep_event: &EpollEvent,
+        ep_flags: &EpollFlags,
+    ) -> Result<()> {
+        let allowed_events = IoEvents::IN | IoEvents::OUT | IoEvents::ERR | IoEvents::HUP;
+        let allowed_flags = EpollFlags::EXCLUSIVE | EpollFlags::WAKE_UP | EpollFlags::EDGE_TRIGGER;
+        if !allowed_events.contains(ep_event.events) || !allowed_flags.contains(*ep_flags) {
+            return_errno_with_message!(
+                Errno::EINVAL,
+                "the events or flags are not allowed with the exclusive flag"
+            );
+        }
+
+        if file.downcast_ref::<EpollFile>().is_some() {
+            return_errno_with_message!(
+                Errno::EINVAL,
+                "an epoll file cannot be monitored exclusively"
+            );
+        }
+
+        Ok(())
+    }
 }
 
 impl Pollable for EpollFile {
@@ -262,8 +353,19 @@ impl FileLike for EpollFile {
         return_errno_with_message!(Errno::EINVAL, "epoll files do not support write");
     }
 
-    fn ioctl(&self, _cmd: IoctlCmd, _arg: usize) -> Result<i32> {
-        return_errno_with_message!(Errno::EINVAL, "epoll files do not support ioctl");
+    fn ioctl(&self, cmd: IoctlCmd, arg: usize) -> Result<i32> {
+        match cmd {
+            IoctlCmd::EPIOCSPARAMS => {
+                let params = current_userspace!().read_val(arg)?;
+                self.set_params(params)?;
+            }
+            IoctlCmd::EPIOCGPARAMS => {
+                let params = *self.params.lock();
+                current_userspace!().write_val(arg, &params)?;
+            }
+            _ => return_errno_with_message!(Errno::EINVAL, "the ioctl is not supported"),
+        }
+        Ok(0)
     }
 
     fn metadata(&self) -> Metadata {
@@ -313,3 +415,16 @@ impl Drop for EntryHolder {
         self.0.shutdown();
     }
 }
+
+/// The busy poll parameters of an epoll file (`struct epoll_params` in Linux).
+///
+/// The interfaces are polled until there are no pending packets, so `busy_poll_budget`, the
+/// maximum number of packets processed in one poll, is accepted but has no effect.
+#[repr(C)]
+#[derive(Debug, Default, Clone, Copy, Pod)]
+struct EpollParams {
+    busy_poll_usecs: u32,
+    busy_poll_budget: u16,
+    prefer_busy_poll: u8,
+    pad: u8,
+}
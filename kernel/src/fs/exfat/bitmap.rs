@@ -31,9 +31,24 @@ pub(super) struct ExfatBitmap {
 
     // Used to track the number of free clusters.
     num_free_cluster: u32,
+    // Used to find free clusters without scanning the bits.
+    free_extents: FreeExtentIndex,
     fs: Weak<ExfatFS>,
 }
 
+/// An index of the maximal runs of free clusters in the bitmap.
+///
+/// Indexed both by the start cluster and by the length, so that both the
+/// first free run after a position and the largest free run can be found in
+/// O(log n).
+#[derive(Debug, Default)]
+struct FreeExtentIndex {
+    // Start cluster -> number of clusters.
+    by_start: BTreeMap<ClusterID, u32>,
+    // (Number of clusters, start cluster).
+    by_len: BTreeSet<(u32, ClusterID)>,
+}
+
 impl ExfatBitmap {
     pub(super) fn load(
         fs_weak: Weak<ExfatFS>,
@@ -69,16 +84,27 @@ impl ExfatBitmap {
 
         fs.read_meta_at(chain.physical_cluster_start_offset(), &mut buf)?;
         let mut free_cluster_num = 0;
-        for idx in 0..fs.super_block().num_clusters - EXFAT_RESERVED_CLUSTERS {
+        let mut free_extents = FreeExtentIndex::default();
+        let mut free_start = None;
+        let num_bits = fs.super_block().num_clusters - EXFAT_RESERVED_CLUSTERS;
+        for idx in 0..num_bits {
             if (buf[idx as usize / BITS_PER_BYTE] & (1 << (idx % BITS_PER_BYTE as u32))) == 0 {
                 free_cluster_num += 1;
+                free_start.get_or_insert(idx);
+            } else if let Some(start) = free_start.take() {
+                free_extents.insert(start + EXFAT_RESERVED_CLUSTERS..idx + EXFAT_RESERVED_CLUSTERS);
             }
         }
+        if let Some(start) = free_start {
+            free_extents
+                .insert(start + EXFAT_RESERVED_CLUSTERS..num_bits + EXFAT_RESERVED_CLUSTERS);
+        }
         Ok(ExfatBitmap {
             chain,
             bitvec: BitVec::from_slice(&buf),
             dirty_bytes: VecDeque::new(),
             num_free_cluster: free_cluster_num,
+            free_extents,
             fs: fs_weak,
         })
     }
@@ -130,121 +156,21 @@ impl ExfatBitmap {
 
     /// Return the first unused cluster.
     pub(super) fn find_next_unused_cluster(&self, cluster: ClusterID) -> Result<ClusterID> {
-        let clusters = self.find_next_unused_cluster_range_by_bits(cluster, 1)?;
+        let clusters = self.find_next_unused_extent(cluster, 1)?;
         Ok(clusters.start)
     }
 
-    /// Return the first unused cluster range, set num_clusters=1 to find a single cluster.
-    fn find_next_unused_cluster_range_by_bits(
+    /// Return the first run of unused clusters starting from `search_start_cluster`,
+    /// truncated to at most `max_clusters` clusters.
+    pub(super) fn find_next_unused_extent(
         &self,
         search_start_cluster: ClusterID,
-        num_clusters: u32,
+        max_clusters: u32,
     ) -> Result<Range<ClusterID>> {
-        if !self
-            .fs()
-            .is_cluster_range_valid(search_start_cluster..search_start_cluster + num_clusters)
-        {
-            return_errno_with_message!(Errno::ENOSPC, "free contiguous clusters not available.")
-        }
-
-        let mut cur_index = search_start_cluster - EXFAT_RESERVED_CLUSTERS;
-        let end_index = self.fs().super_block().num_clusters - EXFAT_RESERVED_CLUSTERS;
-        let search_end_index = end_index - num_clusters + 1;
-        let mut range_start_index: ClusterID;
-
-        while cur_index < search_end_index {
-            if !self.is_used(cur_index as usize) {
-                range_start_index = cur_index;
-                let mut cnt = 0;
-                while cnt < num_clusters
-                    && cur_index < end_index
-                    && !self.is_used(cur_index as usize)
-                {
-                    cnt += 1;
-                    cur_index += 1;
-                }
-                if cnt >= num_clusters {
-                    return Ok(range_start_index + EXFAT_RESERVED_CLUSTERS
-                        ..range_start_index + EXFAT_RESERVED_CLUSTERS + num_clusters);
-                }
-            }
-            cur_index += 1;
-        }
-        return_errno!(Errno::ENOSPC)
-    }
-
-    /// Make sure the bit at the range start position is 0.
-    fn adjust_head_pos(
-        &self,
-        bytes: &[BitStore],
-        mut cur_unit_index: u32,
-        mut cur_unit_offset: u32,
-        total_cluster_num: u32,
-    ) -> (u32, u32) {
-        let unit_size: u32 = (BITS_PER_BYTE * core::mem::size_of::<BitStore>()) as u32;
-        while cur_unit_index < total_cluster_num {
-            let leading_zeros = bytes[cur_unit_index as usize].leading_zeros();
-            let head_cluster_num = unit_size - cur_unit_offset;
-            if leading_zeros == 0 {
-                // Fall over to the next unit, we need to continue checking.
-                cur_unit_index += 1;
-                cur_unit_offset = 0;
-            } else {
-                // Stop at current unit, we may need to adjust the cur_offset
-                cur_unit_offset = cur_unit_offset.max(unit_size - leading_zeros);
-                break;
-            }
-        }
-        (cur_unit_index, cur_unit_offset)
-    }
-
-    /// Check if the next mid_unit_num units are zero.
-    /// If not, return the index of the first not zero unit.
-    fn check_mid_units(&self, bytes: &[BitStore], cur_unit_index: u32, mid_unit_num: u32) -> u32 {
-        for i in 1..mid_unit_num + 1 {
-            if bytes[(cur_unit_index + i) as usize] != 0 {
-                return cur_unit_index + 1;
-            }
-        }
-        cur_unit_index
-    }
-
-    /// Check if the tail unit is valid.
-    /// Currently not used.
-    fn check_tail_bits(
-        &self,
-        bytes: &[BitStore],
-        tail_idx: u32,
-        tail_cluster_num: u32,
-        complete_unit_num: u32,
-        rest_cluster_num: u32,
-    ) -> bool {
-        let valid_bytes_num = if rest_cluster_num > 0 {
-            complete_unit_num + 1
-        } else {
-            complete_unit_num
+        let Some(extent) = self.free_extents.iter_from(search_start_cluster).next() else {
+            return_errno!(Errno::ENOSPC)
         };
-        let mut tail_byte: u8 = 0;
-        if tail_idx == complete_unit_num {
-            tail_byte |= 0xFF_u8 - ((1_u8 << rest_cluster_num) - 1);
-        }
-        if tail_idx < valid_bytes_num {
-            tail_byte |= bytes[tail_idx as usize];
-        }
-        let tailing_zeros = tail_byte.trailing_zeros();
-        tailing_zeros >= tail_cluster_num
-    }
-
-    fn make_range(
-        &self,
-        cur_unit_index: u32,
-        cur_unit_offset: u32,
-        num_clusters: u32,
-    ) -> Range<ClusterID> {
-        let unit_size: u32 = (BITS_PER_BYTE * core::mem::size_of::<BitStore>()) as u32;
-        let result_bit_index = cur_unit_index * unit_size + cur_unit_offset;
-        result_bit_index + EXFAT_RESERVED_CLUSTERS
-            ..result_bit_index + EXFAT_RESERVED_CLUSTERS + num_clusters
+        Ok(extent.start..extent.end.min(extent.start + max_clusters))
     }
 
     /// Return the next contiguous unused clusters, set cluster_num=1 to find a single cluster
@@ -260,71 +186,25 @@ impl ExfatBitmap {
             return_errno!(Errno::ENOSPC)
         }
 
-        let bytes: &[BitStore] = self.bitvec.as_raw_slice();
-        let unit_size: u32 = (BITS_PER_BYTE * core::mem::size_of::<BitStore>()) as u32;
-        let start_cluster_index = search_start_cluster - EXFAT_RESERVED_CLUSTERS;
-        let mut cur_unit_index = start_cluster_index / unit_size;
-        let mut cur_unit_offset = start_cluster_index % unit_size;
-        let total_cluster_num = self.fs().super_block().num_clusters - EXFAT_RESERVED_CLUSTERS;
-        let complete_unit_num = total_cluster_num / unit_size;
-        let rest_cluster_num = total_cluster_num % unit_size;
-        let valid_bytes_num = if rest_cluster_num > 0 {
-            complete_unit_num + 1
-        } else {
-            complete_unit_num
-        };
-        if num_clusters <= unit_size {
-            // If this case, back to the simple function
-            return self.find_next_unused_cluster_range_by_bits(search_start_cluster, num_clusters);
-        }
-        // Treat a continuous bit chunk as lead_bits+mid_units+tail_bits (mid_units are unit aligned)
-        // For example: 11110000 00000000 00000000 00111111
-        //                  **** -------- -------- ..
-        //                  ^(start bit)
-        // (*): head_bits;  (-): mid_units;  (.): tail_bits
-        // The start bit can be identified with a pair (cur_unit_index, cur_unit_offset)
-        while cur_unit_index < complete_unit_num {
-            // First, adjust the cur_idx to a proper head.
-            (cur_unit_index, cur_unit_offset) =
-                self.adjust_head_pos(bytes, cur_unit_index, cur_unit_offset, total_cluster_num);
-            let head_cluster_num = unit_size - cur_unit_offset;
-            let mid_unit_num = (num_clusters - head_cluster_num) / unit_size;
-            let tail_cluster_num = (num_clusters - head_cluster_num) % unit_size;
-            // If the last complete unit to be check is out of range, stop searching
-            if cur_unit_index + mid_unit_num >= complete_unit_num {
-                break;
-            }
-            // Then check for the mid units, these units should be all zero
-            // Due to previous check, there will be no array out of bounds situation
-            let ret = self.check_mid_units(bytes, cur_unit_index, mid_unit_num);
-            if ret != cur_unit_index {
-                // Mid_checks failed, should go back to the first step.
-                cur_unit_index = ret;
-                cur_unit_offset = 0;
-                continue;
-            }
-            // At last, check for the tail bits
-            if tail_cluster_num == 0 {
-                return Ok(self.make_range(cur_unit_index, cur_unit_offset, num_clusters));
-            }
-            let mut tail_byte: u8 = 0;
-            let tail_idx = cur_unit_index + mid_unit_num + 1;
-            if tail_idx == complete_unit_num {
-                tail_byte |= 0xFF_u8 - ((1_u8 << rest_cluster_num) - 1);
-            }
-            if tail_idx < valid_bytes_num {
-                tail_byte |= bytes[tail_idx as usize];
-            }
-            let tailing_zeros = tail_byte.trailing_zeros();
-            if tail_cluster_num > tailing_zeros {
-                cur_unit_index = tail_idx;
-                cur_unit_offset = tailing_zeros + 1;
-                continue;
+        self.free_extents
+            .iter_from(search_start_cluster)
+            .find(|extent| extent.len() >= num_clusters as usize)
+            .map(|extent| extent.start..extent.start + num_clusters)
+            .ok_or(Error::new(Errno::ENOSPC))
+    }
+
+    /// Return `num_clusters` unused clusters at the start of the largest run of unused
+    /// clusters, which leaves the most room for the clusters to grow contiguously.
+    pub(super) fn find_largest_unused_cluster_range(
+        &self,
+        num_clusters: u32,
+    ) -> Result<Range<ClusterID>> {
+        match self.free_extents.largest() {
+            Some(extent) if extent.len() >= num_clusters as usize => {
+                Ok(extent.start..extent.start + num_clusters)
             }
-            // If we reach here, it means we have found a result
-            return Ok(self.make_range(cur_unit_index, cur_unit_offset, num_clusters));
+            _ => return_errno!(Errno::ENOSPC),
         }
-        return_errno!(Errno::ENOSPC)
     }
 
     pub(super) fn num_free_clusters(&self) -> u32 {
@@ -348,6 +228,11 @@ impl ExfatBitmap {
             }
         }
 
+        self.free_extents.remove(clusters.clone());
+        if !bit {
+            self.free_extents.insert(clusters.clone());
+        }
+
         self.write_to_disk(clusters.clone(), sync)?;
 
         Ok(())
@@ -385,3 +270,81 @@ impl ExfatBitmap {
         Ok(())
     }
 }
+
+impl FreeExtentIndex {
+    /// Insert a free range, which must not overlap with the indexed ones.
+    fn insert(&mut self, range: Range<ClusterID>) {
+        if range.is_empty() {
+            return;
+        }
+
+        let (mut start, mut end) = (range.start, range.end);
+        if let Some((&prev_start, &prev_len)) = self.by_start.range(..start).next_back() {
+            if prev_start + prev_len == start {
+                self.remove_extent(prev_start, prev_len);
+                start = prev_start;
+            }
+        }
+        if let Some(&next_len) = self.by_start.get(&end) {
+            self.remove_extent(end, next_len);
+            end += next_len;
+        }
+
+        self.by_start.insert(start, end - start);
+        self.by_len.insert((end - start, start));
+    }
+
+    /// Remove a range from the free ranges, which may be partially free.
+    fn remove(&mut self, range: Range<ClusterID>) {
+        if range.is_empty() {
+            return;
+        }
+
+        let first = self
+            .by_start
+            .range(..=range.start)
+            .next_back()
+            .map_or(range.start, |(&start, _)| start);
+        let overlapped: Vec<(ClusterID, u32)> = self
+            .by_start
+            .range(first..range.end)
+            .map(|(&start, &len)| (start, len))
+            .filter(|&(start, len)| start + len > range.start)
+            .collect();
+
+        for (start, len) in overlapped {
+            self.remove_extent(start, len);
+            if start < range.start {
+                self.by_start.insert(start, range.start - start);
+                self.by_len.insert((range.start - start, start));
+            }
+            if start + len > range.end {
+                self.by_start.insert(range.end, start + len - range.end);
+                self.by_len.insert((start + len - range.end, range.end));
+            }
+        }
+    }
+
+    fn remove_extent(&mut self, start: ClusterID, len: u32) {
+        self.by_start.remove(&start);
+        self.by_len.remove(&(len, start));
+    }
+
+    /// Iterate over the free ranges at or after `cluster` in address order.
+    /// The first range is clipped to start at `cluster`.
+    fn iter_from(&self, cluster: ClusterID) -> impl Iterator<Item = Range<ClusterID>> + '_ {
+        let first = self
+            .by_start
+            .range(..=cluster)
+            .next_back()
+            .map_or(cluster, |(&start, _)| start);
+        self.by_start
+            .range(first..)
+            .map(move |(&start, &len)| start.max(cluster)..start + len)
+            .filter(|range| !range.is_empty())
+    }
+
+    fn largest(&self) -> Option<Range<ClusterID>> {
+        self.by_len.last().map(|&(len, start)| start..start + len)
+    }
+}
@@ -63,9 +63,47 @@ pub struct ExfatChain {
     num_clusters: u32,
     // use FAT or not
     flags: FatChainFlags,
+    // runs of contiguous clusters, only used when the FAT is in use
+    runs: ClusterRunCache,
     fs: Weak<ExfatFS>,
 }
 
+/// A run of physically contiguous clusters in a chain.
+#[derive(Debug, Clone, Copy)]
+struct ClusterRun {
+    // the logical index of the first cluster in the chain
+    logical: u32,
+    physical: ClusterID,
+    len: u32,
+}
+
+/// A lazily built, sorted list of the cluster runs in a chain.
+///
+/// With the runs cached, walking to any cluster of a fragmented chain costs a
+/// binary search instead of following the FAT entry by entry. The cache is
+/// dropped whenever the chain is extended or truncated, and is not shared
+/// between clones of the chain.
+#[derive(Default)]
+struct ClusterRunCache(Mutex<Option<Vec<ClusterRun>>>);
+
+impl ClusterRunCache {
+    fn invalidate(&mut self) {
+        *self.0.get_mut() = None;
+    }
+}
+
+impl Clone for ClusterRunCache {
+    fn clone(&self) -> Self {
+        Self::default()
+    }
+}
+
+impl Debug for ClusterRunCache {
+    fn fmt(&self, f: &mut core::fmt::Formatter<'_>) -> core::fmt::Result {
+        f.debug_struct("ClusterRunCache").finish_non_exhaustive()
+    }
+}
+
 // A position by the chain and relative offset in the cluster.
 pub type ExfatChainPosition = (ExfatChain, usize);
 
@@ -80,6 +118,7 @@ impl ExfatChain {
             current,
             num_clusters: 0,
             flags,
+            runs: ClusterRunCache::default(),
             fs,
         };
 
@@ -118,6 +157,7 @@ impl ExfatChain {
 
     fn set_flags(&mut self, flags: FatChainFlags) {
         self.flags = flags;
+        self.runs.invalidate();
     }
 
     fn fs(&self) -> Arc<ExfatFS> {
@@ -178,7 +218,11 @@ impl ExfatChain {
         let mut result_cluster = self.current;
         if !self.fat_in_use() {
             result_cluster = (result_cluster + steps) as ClusterID;
+        } else if steps > 1 && steps < self.num_clusters {
+            result_cluster = self.lookup_cluster_run(steps)?;
         } else {
+            // A single step is served by the FAT cache. Building the runs
+            // for it would cost a walk over the whole chain.
             for _ in 0..steps {
                 let fat = self.fs().read_next_fat(result_cluster)?;
                 match fat {
@@ -196,8 +240,51 @@ impl ExfatChain {
         )
     }
 
+    /// Returns the physical cluster at the logical index `logical` of the
+    /// chain, building the cluster runs on the first call.
+    fn lookup_cluster_run(&self, logical: u32) -> Result<ClusterID> {
+        let mut runs = self.runs.0.lock();
+        if runs.is_none() {
+            *runs = Some(self.collect_cluster_runs()?);
+        }
+        let runs = runs.as_ref().unwrap();
+
+        let idx = runs.partition_point(|run| run.logical <= logical);
+        match idx.checked_sub(1).map(|idx| runs[idx]) {
+            Some(run) if logical < run.logical + run.len => {
+                Ok(run.physical + logical - run.logical)
+            }
+            _ => return_errno_with_message!(Errno::EIO, "invalid access to FAT cluster"),
+        }
+    }
+
+    fn collect_cluster_runs(&self) -> Result<Vec<ClusterRun>> {
+        let fs = self.fs();
+        let mut runs: Vec<ClusterRun> = Vec::new();
+        let mut cluster = self.current;
+        for logical in 0..self.num_clusters {
+            match runs.last_mut() {
+                Some(run) if run.physical + run.len == cluster => run.len += 1,
+                _ => runs.push(ClusterRun {
+                    logical,
+                    physical: cluster,
+                    len: 1,
+                }),
+            }
+            if logical + 1 == self.num_clusters {
+                break;
+            }
+            match fs.read_next_fat(cluster)? {
+                FatValue::Next(next_fat) => cluster = next_fat,
+                _ => return_errno_with_message!(Errno::EIO, "invalid access to FAT cluster"),
+            }
+        }
+        Ok(runs)
+    }
+
     // If current capacity is 0 (no start_cluster), this means we can choose a allocation type
-    // We first try continuous allocation
+    // We first try continuous allocation, at the start of the largest free run so that
+    // sequential writes can keep extending the chain without the FAT
     // If no continuous allocation available, turn to fat allocation
     fn alloc_cluster_from_empty(
         &mut self,
@@ -206,8 +293,7 @@ impl ExfatChain {
         sync_bitmap: bool,
     ) -> Result<ClusterID> {
         // Search for a continuous chunk big enough
-        let search_result =
-            bitmap.find_next_unused_cluster_range(EXFAT_FIRST_CLUSTER, num_to_be_allocated);
+        let search_result = bitmap.find_largest_unused_cluster_range(num_to_be_allocated);
 
         if let Ok(clusters) = search_result {
             bitmap.set_range_used(clusters.clone(), sync_bitmap)?;
@@ -231,21 +317,28 @@ impl ExfatChain {
         bitmap: &mut MutexGuard<ExfatBitmap>,
     ) -> Result<ClusterID> {
         let fs = self.fs();
-        let mut alloc_start_cluster = 0;
+        let mut alloc_start_cluster = None;
         let mut prev_cluster = 0;
-        let mut cur_cluster = EXFAT_FIRST_CLUSTER;
-        for i in 0..num_to_be_allocated {
-            cur_cluster = bitmap.find_next_unused_cluster(cur_cluster)?;
-            bitmap.set_used(cur_cluster, sync)?;
-
-            if i == 0 {
-                alloc_start_cluster = cur_cluster;
-            } else {
-                fs.write_next_fat(prev_cluster, FatValue::Next(cur_cluster), sync)?;
+        let mut search_start_cluster = EXFAT_FIRST_CLUSTER;
+        let mut num_remaining = num_to_be_allocated;
+        // Allocate free runs as a whole, so the chain stays as contiguous as possible.
+        while num_remaining > 0 {
+            let clusters = bitmap.find_next_unused_extent(search_start_cluster, num_remaining)?;
+            bitmap.set_range_used(clusters.clone(), sync)?;
+
+            for cur_cluster in clusters.clone() {
+                if alloc_start_cluster.is_none() {
+                    alloc_start_cluster = Some(cur_cluster);
+                } else {
+                    fs.write_next_fat(prev_cluster, FatValue::Next(cur_cluster), sync)?;
+                }
+                prev_cluster = cur_cluster;
             }
 
-            prev_cluster = cur_cluster;
+            num_remaining -= clusters.end - clusters.start;
+            search_start_cluster = clusters.end;
         }
+        let alloc_start_cluster = alloc_start_cluster.unwrap();
         fs.write_next_fat(prev_cluster, FatValue::EndOfChain, sync)?;
         Ok(alloc_start_cluster)
     }
@@ -305,6 +398,7 @@ impl ClusterAllocator for ExfatChain {
             let allocated =
                 self.alloc_cluster_from_empty(num_to_be_allocated, &mut bitmap, sync)?;
             self.num_clusters += num_to_be_allocated;
+            self.runs.invalidate();
             return Ok(allocated);
         }
 
@@ -345,6 +439,7 @@ impl ClusterAllocator for ExfatChain {
         fs.write_next_fat(tail_cluster, FatValue::Next(allocated_start_cluster), sync)?;
 
         self.num_clusters += num_to_be_allocated;
+        self.runs.invalidate();
 
         Ok(allocated_start_cluster)
     }
@@ -374,6 +469,7 @@ impl ClusterAllocator for ExfatChain {
         }
 
         self.num_clusters -= drop_num;
+        self.runs.invalidate();
 
         Ok(())
     }
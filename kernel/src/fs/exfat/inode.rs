@@ -31,8 +31,8 @@ use crate::{
         exfat::{dentry::ExfatDentryIterator, fat::ExfatChain, fs::ExfatFS},
         path::{is_dot, is_dot_or_dotdot, is_dotdot},
         utils::{
-            CachePage, DirentVisitor, Extension, Inode, InodeMode, InodeType, IoctlCmd, Metadata,
-            MknodType, PageCache, PageCacheBackend,
+            pin_reader_pages, pin_writer_pages, CachePage, DirentVisitor, Extension, Inode,
+            InodeMode, InodeType, IoctlCmd, Metadata, MknodType, PageCache, PageCacheBackend,
         },
     },
     prelude::*,
@@ -198,10 +198,6 @@ impl ExfatInodeInner {
 
     /// Get physical sector id from logical sector id for this Inode.
     fn get_sector_id(&self, sector_id: usize) -> Result<usize> {
-        let chain_offset = self
-            .start_chain
-            .walk_to_cluster_at_offset(sector_id * self.fs().sector_size())?;
-
         let sect_per_cluster = self.fs().super_block().sect_per_cluster as usize;
         let cluster_id = sector_id / sect_per_cluster;
         let cluster = self.get_physical_cluster((sector_id / sect_per_cluster) as ClusterID)?;
@@ -1267,12 +1263,15 @@ impl Inode for ExfatInode {
             (start, end - start)
         };
 
+        // Writes back the dirty pages first, or the reads would miss them.
         inner
             .page_cache
-            .discard_range(read_off..read_off + read_len);
+            .evict_range(read_off..read_off + read_len)?;
 
+        // The blocks are read into the user pages directly if possible.
+        let frames = pin_writer_pages(writer, read_len);
         let mut buf_offset = 0;
-        let bio_segment = BioSegment::alloc(1, BioDirection::FromDevice);
+        let bounce_segment = BioSegment::alloc(1, BioDirection::FromDevice);
 
         let start_pos = inner.start_chain.walk_to_cluster_at_offset(read_off)?;
         let cluster_size = inner.fs().cluster_size();
@@ -1281,11 +1280,20 @@ impl Inode for ExfatInode {
         for _ in Bid::from_offset(read_off)..Bid::from_offset(read_off + read_len) {
             let physical_bid =
                 Bid::from_offset(cur_cluster.cluster_id() as usize * cluster_size + cur_offset);
+            let bio_segment = match &frames {
+                Some(frames) => BioSegment::new_from_segment(
+                    frames[buf_offset / BLOCK_SIZE].clone().into(),
+                    BioDirection::FromDevice,
+                ),
+                None => bounce_segment.clone(),
+            };
             inner
                 .fs()
                 .block_device()
-                .read_blocks(physical_bid, bio_segment.clone())?;
-            bio_segment.reader().unwrap().read_fallible(writer)?;
+                .read_blocks(physical_bid, bio_segment)?;
+            if frames.is_none() {
+                bounce_segment.reader().unwrap().read_fallible(writer)?;
+            }
             buf_offset += BLOCK_SIZE;
 
             cur_offset += BLOCK_SIZE;
@@ -1294,6 +1302,9 @@ impl Inode for ExfatInode {
                 cur_offset %= BLOCK_SIZE;
             }
         }
+        if frames.is_some() {
+            writer.skip(read_len);
+        }
 
         inner.upgrade().update_atime()?;
         Ok(read_len)
@@ -1379,18 +1390,27 @@ impl Inode for ExfatInode {
 
         let inner = self.inner.upread();
 
-        let bio_segment = BioSegment::alloc(1, BioDirection::ToDevice);
+        // The blocks are written from the user pages directly if possible.
+        let frames = pin_reader_pages(reader, write_len);
+        let bounce_segment = BioSegment::alloc(1, BioDirection::ToDevice);
         let start_pos = inner.start_chain.walk_to_cluster_at_offset(offset)?;
         let cluster_size = inner.fs().cluster_size();
         let mut cur_cluster = start_pos.0.clone();
         let mut cur_offset = start_pos.1;
-        for _ in Bid::from_offset(offset)..Bid::from_offset(end_offset) {
-            bio_segment.writer().unwrap().write_fallible(reader)?;
+        for (idx, _) in (Bid::from_offset(offset)..Bid::from_offset(end_offset)).enumerate() {
+            let bio_segment = match &frames {
+                Some(frames) => {
+                    BioSegment::new_from_segment(frames[idx].clone().into(), BioDirection::ToDevice)
+                }
+                None => {
+                    bounce_segment.writer().unwrap().write_fallible(reader)?;
+                    bounce_segment.clone()
+                }
+            };
             let physical_bid =
                 Bid::from_offset(cur_cluster.cluster_id() as usize * cluster_size + cur_offset);
             let fs = inner.fs();
-            fs.block_device()
-                .write_blocks(physical_bid, bio_segment.clone())?;
+            fs.block_device().write_blocks(physical_bid, bio_segment)?;
 
             cur_offset += BLOCK_SIZE;
             if cur_offset >= cluster_size {
@@ -1398,6 +1418,9 @@ impl Inode for ExfatInode {
                 cur_offset %= BLOCK_SIZE;
             }
         }
+        if frames.is_some() {
+            reader.skip(write_len);
+        }
 
         {
             let mut inner = inner.upgrade();
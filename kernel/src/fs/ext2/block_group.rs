@@ -19,6 +19,14 @@ pub(super) struct BlockGroup {
     raw_inodes_cache: PageCache,
 }
 
+/// The usage of a block group, which is used to choose the group of new directories.
+#[derive(Clone, Copy, Debug)]
+pub(super) struct GroupUsage {
+    pub free_inodes: u16,
+    pub free_blocks: u16,
+    pub dirs: u16,
+}
+
 struct BlockGroupImpl {
     inode_table_bid: Ext2Bid,
     raw_inodes_size: usize,
@@ -151,6 +159,17 @@ impl BlockGroup {
         inner.inode_cache.insert(inode_idx, inode);
     }
 
+    /// Returns the usage of this group.
+    pub fn usage(&self) -> GroupUsage {
+        let inner = self.bg_impl.inner.read();
+        let descriptor = &inner.metadata.descriptor;
+        GroupUsage {
+            free_inodes: descriptor.free_inodes_count,
+            free_blocks: descriptor.free_blocks_count,
+            dirs: descriptor.dirs_count,
+        }
+    }
+
     /// Allocates and returns an inode index.
     pub fn alloc_inode(&self, is_dir: bool) -> Option<u32> {
         // The fast path
@@ -218,10 +237,16 @@ impl BlockGroup {
             .unwrap();
     }
 
-    /// Writes back the metadata of this group.
-    pub fn sync_metadata(&self) -> Result<()> {
+    /// Writes back the metadata of this group, adding the requests to `bio_waiter`.
+    ///
+    /// The metadata is marked as clean once the requests are submitted, so that the changes
+    /// during the write-back dirty it again. If the requests fail, the caller should call
+    /// [`Self::redirty_metadata`].
+    ///
+    /// Returns whether the metadata is dirty and requests are submitted.
+    pub fn sync_metadata(&self, bio_waiter: &mut BioWaiter) -> Result<bool> {
         if !self.bg_impl.inner.read().metadata.is_dirty() {
-            return Ok(());
+            return Ok(false);
         }
 
         let mut inner = self.bg_impl.inner.write();
@@ -230,7 +255,6 @@ impl BlockGroup {
         let raw_descriptor = RawGroupDescriptor::from(&inner.metadata.descriptor);
         self.fs().sync_group_descriptor(self.idx, &raw_descriptor)?;
 
-        let mut bio_waiter = BioWaiter::new();
         // Writes back the inode bitmap.
         let inode_bitmap_bid = Bid::new(inner.metadata.descriptor.inode_bitmap_bid as u64);
         bio_waiter.concat(fs.block_device().write_bytes_async(
@@ -245,13 +269,13 @@ impl BlockGroup {
             inner.metadata.block_bitmap.as_bytes(),
         )?);
 
-        // Waits for the completion of all submitted bios.
-        bio_waiter.wait().ok_or_else(|| {
-            Error::with_message(Errno::EIO, "failed to sync metadata of block group")
-        })?;
-
         inner.metadata.clear_dirty();
-        Ok(())
+        Ok(true)
+    }
+
+    /// Marks the metadata of this group as dirty again after a failed write-back.
+    pub fn redirty_metadata(&self) {
+        self.bg_impl.inner.write().metadata.mark_dirty();
     }
 
     /// Writes back all of the cached inodes.
@@ -289,13 +313,17 @@ impl BlockGroup {
         }
         drop(remaining_inodes);
 
-        // Writes back the raw inode metadata.
+        // Writes back the raw inode metadata, keeping it cached for the later lookups.
         self.raw_inodes_cache
-            .pages()
-            .decommit(0..self.bg_impl.raw_inodes_size)?;
+            .evict_range(0..self.bg_impl.raw_inodes_size)?;
         Ok(())
     }
 
+    /// Reads ahead the pages of the raw inode metadata in the background.
+    pub fn prefetch_raw_inodes(&self, page_idx_range: Range<usize>) {
+        self.raw_inodes_cache.pages().prefetch_pages(page_idx_range);
+    }
+
     fn fs(&self) -> Arc<Ext2> {
         self.bg_impl.fs.upgrade().unwrap()
     }
@@ -334,13 +362,18 @@ impl PageCacheBackend for BlockGroupImpl {
     }
 
     fn write_page_async(&self, idx: usize, frame: &CachePage) -> Result<BioWaiter> {
+        self.write_pages_async(idx, core::slice::from_ref(frame))
+    }
+
+    fn write_pages_async(&self, idx: usize, frames: &[CachePage]) -> Result<BioWaiter> {
+        // The inode table is contiguous on the device, so the pages are written with one bio.
         let bid = self.inode_table_bid + idx as Ext2Bid;
-        let bio_segment = BioSegment::alloc(1, BioDirection::ToDevice);
+        let bio_segment = BioSegment::alloc(frames.len(), BioDirection::ToDevice);
         // This requires an additional copy to the pooled bio segment.
-        bio_segment
-            .writer()
-            .unwrap()
-            .write_fallible(&mut frame.reader().to_fallible())?;
+        let mut writer = bio_segment.writer().unwrap();
+        for frame in frames {
+            writer.write_fallible(&mut frame.reader().to_fallible())?;
+        }
         self.fs
             .upgrade()
             .unwrap()
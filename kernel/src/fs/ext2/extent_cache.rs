@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use super::{block_ptr::Ext2Bid, prelude::*};
+
+/// `ExtentCache` caches the mapping from the file's block IDs to the device's
+/// block IDs as extents, i.e., runs of consecutive blocks.
+///
+/// Ext2 maps each block of a file through the block pointers and the indirect
+/// blocks. Once a run of blocks is looked up, the cache allows the later I/O on
+/// the run to find its device blocks without walking the indirect blocks, and
+/// to be submitted as a single bio even if the run spans several indirect blocks.
+#[derive(Debug)]
+pub struct ExtentCache {
+    /// The extents keyed by their start block IDs in the file.
+    extents: BTreeMap<Ext2Bid, Extent>,
+}
+
+/// A run of consecutive blocks of a file, which are also consecutive on the device.
+#[derive(Clone, Copy, Debug)]
+struct Extent {
+    device_start: Ext2Bid,
+    len: Ext2Bid,
+}
+
+impl ExtentCache {
+    /// The upper bound on the number of the cached extents.
+    const MAX_EXTENTS: usize = 64;
+
+    /// Creates a new cache.
+    pub fn new() -> Self {
+        Self {
+            extents: BTreeMap::new(),
+        }
+    }
+
+    /// Looks up the device block IDs of the blocks starting from `bid`.
+    ///
+    /// It returns the device range of the longest cached run that starts at `bid`
+    /// and is no longer than `max_cnt`.
+    pub fn lookup(&self, bid: Ext2Bid, max_cnt: Ext2Bid) -> Option<Range<Ext2Bid>> {
+        let (start, extent) = self.extents.range(..=bid).next_back()?;
+        let offset = bid - start;
+        if offset >= extent.len {
+            return None;
+        }
+
+        let device_start = extent.device_start + offset;
+        let cnt = (extent.len - offset).min(max_cnt);
+        Some(device_start..device_start + cnt)
+    }
+
+    /// Inserts the mapping from the blocks starting from `bid` to `device_range`.
+    ///
+    /// The cached mapping of the overlapping blocks is replaced, and the new extent
+    /// is merged with its neighbors if they are consecutive.
+    pub fn insert(&mut self, bid: Ext2Bid, device_range: Range<Ext2Bid>) {
+        if device_range.is_empty() {
+            return;
+        }
+
+        let mut start = bid;
+        let mut extent = Extent {
+            device_start: device_range.start,
+            len: device_range.len() as Ext2Bid,
+        };
+        self.remove(start..start + extent.len);
+
+        if let Some((&prev_start, prev)) = self.extents.range(..start).next_back() {
+            if prev_start + prev.len == start && prev.device_start + prev.len == extent.device_start
+            {
+                start = prev_start;
+                extent.device_start = prev.device_start;
+                extent.len += prev.len;
+                self.extents.remove(&prev_start);
+            }
+        }
+        let end = start + extent.len;
+        if let Some(next) = self.extents.get(&end) {
+            if extent.device_start + extent.len == next.device_start {
+                extent.len += next.len;
+                self.extents.remove(&end);
+            }
+        }
+
+        if self.extents.len() >= Self::MAX_EXTENTS {
+            // Prefers to evict the extents in the front, which are likely to
+            // have been passed by sequential accesses.
+            self.extents.pop_first();
+        }
+        self.extents.insert(start, extent);
+    }
+
+    /// Removes the cached mapping of the blocks in `range`.
+    pub fn remove(&mut self, range: Range<Ext2Bid>) {
+        if range.is_empty() {
+            return;
+        }
+
+        let head = self
+            .extents
+            .range(..range.start)
+            .next_back()
+            .filter(|(start, extent)| **start + extent.len > range.start)
+            .map(|(start, _)| *start);
+        let overlapped: Vec<Ext2Bid> = head
+            .into_iter()
+            .chain(self.extents.range(range.clone()).map(|(start, _)| *start))
+            .collect();
+        for start in overlapped {
+            let extent = self.extents.remove(&start).unwrap();
+            let end = start + extent.len;
+            // Keeps the parts outside of the range.
+            if start < range.start {
+                self.extents.insert(
+                    start,
+                    Extent {
+                        device_start: extent.device_start,
+                        len: range.start - start,
+                    },
+                );
+            }
+            if end > range.end {
+                self.extents.insert(
+                    range.end,
+                    Extent {
+                        device_start: extent.device_start + (range.end - start),
+                        len: end - range.end,
+                    },
+                );
+            }
+        }
+    }
+
+    /// Removes the cached mapping of the blocks starting from `bid`.
+    pub fn truncate(&mut self, bid: Ext2Bid) {
+        self.remove(bid..Ext2Bid::MAX);
+    }
+}
@@ -2,6 +2,13 @@
 
 #![expect(dead_code)]
 
+use core::sync::atomic::{AtomicBool, AtomicU32, AtomicUsize, Ordering};
+
+use ostd::{
+    cpu::{num_cpus, PinCurrentCpu},
+    task::disable_preempt,
+};
+
 use super::{
     block_group::{BlockGroup, RawGroupDescriptor},
     block_ptr::Ext2Bid,
@@ -9,6 +16,7 @@ use super::{
     prelude::*,
     super_block::{RawSuperBlock, SuperBlock, SUPER_BLOCK_OFFSET},
 };
+use crate::util::PerCpuCounter;
 
 /// The root inode number.
 const ROOT_INO: u32 = 2;
@@ -19,6 +27,25 @@ pub struct Ext2 {
     block_device: Arc<dyn BlockDevice>,
     super_block: RwMutex<Dirty<SuperBlock>>,
     block_groups: Vec<BlockGroup>,
+    /// The number of free blocks, which is folded into the superblock on syncs.
+    free_blocks: PerCpuCounter,
+    /// The number of free inodes, which is folded into the superblock on syncs.
+    free_inodes: PerCpuCounter,
+    /// The windows of blocks reserved for the growing files, keyed by their inode numbers.
+    ///
+    /// The blocks are allocated from the block groups but are not yet owned by the files. They
+    /// are counted as free, and are taken back if the other blocks run out.
+    reservations: SpinLock<BTreeMap<u32, Range<Ext2Bid>>>,
+    /// The number of blocks in `reservations`.
+    nr_reserved_blocks: AtomicU32,
+    /// Whether the block groups and the free counters have changed since the last sync.
+    has_dirty_groups: AtomicBool,
+    /// The block group to continue the allocations from for each CPU, if the desired group is
+    /// full.
+    ///
+    /// The CPUs start from different groups, so that the concurrent writers on different CPUs do
+    /// not contend for the same group after their desired groups are full.
+    preferred_groups: Box<[AtomicUsize]>,
     inodes_per_group: u32,
     blocks_per_group: Ext2Bid,
     inode_size: usize,
@@ -80,6 +107,14 @@ impl Ext2 {
             Ok(block_groups)
         };
 
+        let preferred_groups = {
+            let block_groups_count = super_block.block_groups_count() as usize;
+            let nr_cpus = num_cpus();
+            (0..nr_cpus)
+                .map(|cpu| AtomicUsize::new(cpu * block_groups_count / nr_cpus))
+                .collect()
+        };
+
         let ext2 = Arc::new_cyclic(|weak_ref| Self {
             inodes_per_group: super_block.inodes_per_group(),
             blocks_per_group: super_block.blocks_per_group(),
@@ -91,6 +126,12 @@ impl Ext2 {
                 &group_descriptors_segment,
             )
             .unwrap(),
+            free_blocks: PerCpuCounter::new(super_block.free_blocks_count() as i64),
+            free_inodes: PerCpuCounter::new(super_block.free_inodes_count() as i64),
+            reservations: SpinLock::new(BTreeMap::new()),
+            nr_reserved_blocks: AtomicU32::new(0),
+            has_dirty_groups: AtomicBool::new(false),
+            preferred_groups,
             block_device,
             super_block: RwMutex::new(Dirty::new(super_block)),
             group_descriptors_segment,
@@ -129,6 +170,21 @@ impl Ext2 {
         self.super_block.read()
     }
 
+    /// Returns the number of free blocks, including the blocks reserved for the growing files.
+    ///
+    /// The number is approximate if there are concurrent allocations or frees.
+    pub fn free_blocks_count(&self) -> u32 {
+        let nr_reserved_blocks = self.nr_reserved_blocks.load(Ordering::Relaxed) as i64;
+        (self.free_blocks.sum() + nr_reserved_blocks).clamp(0, u32::MAX as i64) as u32
+    }
+
+    /// Returns the number of free inodes.
+    ///
+    /// The number is approximate if there are concurrent allocations or frees.
+    pub fn free_inodes_count(&self) -> u32 {
+        self.free_inodes.sum().clamp(0, u32::MAX as i64) as u32
+    }
+
     /// Returns the root inode.
     pub fn root_inode(&self) -> Result<Arc<Inode>> {
         self.lookup_inode(ROOT_INO)
@@ -141,6 +197,30 @@ impl Ext2 {
         block_group.lookup_inode(inode_idx)
     }
 
+    /// Reads ahead the raw inodes of `inos` in the background.
+    ///
+    /// The inodes in the same page of an inode table are read only once, and the adjacent pages
+    /// are read together.
+    pub(super) fn prefetch_inodes(&self, inos: &[u32]) {
+        let mut pages: Vec<(usize, usize)> = inos
+            .iter()
+            .filter(|ino| **ino != 0)
+            .filter_map(|ino| {
+                let (block_group_idx, _) = self.block_group_of_ino(*ino).ok()?;
+                let page_idx = self.inode_idx(*ino) as usize * self.inode_size / BLOCK_SIZE;
+                Some((block_group_idx, page_idx))
+            })
+            .collect();
+        pages.sort_unstable();
+        pages.dedup();
+
+        for run in pages.chunk_by(|prev, next| prev.0 == next.0 && prev.1 + 1 == next.1) {
+            let (block_group_idx, start_page_idx) = run[0];
+            self.block_groups[block_group_idx]
+                .prefetch_raw_inodes(start_page_idx..start_page_idx + run.len());
+        }
+    }
+
     /// Creates a new inode.
     pub(super) fn create_inode(
         &self,
@@ -161,38 +241,65 @@ impl Ext2 {
 
     /// Allocates a new inode number, internally used by `new_inode`.
     ///
-    /// Attempts to allocate from the `dir_block_group_idx` group first.
-    /// If allocation is not possible from this group, then search the remaining groups.
+    /// A new file is allocated from the `dir_block_group_idx` group first, while a new directory
+    /// is allocated from the group chosen by [`Self::find_group_for_dir`]. If allocation is not
+    /// possible from this group, then search the remaining groups.
     fn alloc_ino(&self, dir_block_group_idx: usize, is_dir: bool) -> Result<(usize, u32)> {
-        let mut block_group_idx = dir_block_group_idx;
-        if block_group_idx >= self.block_groups.len() {
+        if dir_block_group_idx >= self.block_groups.len() {
             return_errno_with_message!(Errno::EINVAL, "invalid block group idx");
         }
 
-        for _ in 0..self.block_groups.len() {
-            if block_group_idx >= self.block_groups.len() {
-                block_group_idx = 0;
-            }
+        let first_idx = if is_dir {
+            self.find_group_for_dir(dir_block_group_idx)
+        } else {
+            dir_block_group_idx
+        };
+        for block_group_idx in self.groups_to_search(first_idx) {
             let block_group = &self.block_groups[block_group_idx];
             if let Some(inode_idx) = block_group.alloc_inode(is_dir) {
                 let ino = block_group_idx as u32 * self.inodes_per_group + inode_idx + 1;
-                self.super_block.write().dec_free_inodes();
+                self.free_inodes.add(-1);
+                self.mark_groups_dirty();
+                if block_group_idx != first_idx {
+                    self.set_preferred_group(block_group_idx);
+                }
                 return Ok((block_group_idx, ino));
             }
-            block_group_idx += 1;
         }
 
         return_errno_with_message!(Errno::ENOSPC, "no space on device");
     }
 
+    /// Chooses the block group of a new directory in the parent directory's group.
+    ///
+    /// Like the Orlov allocator in Linux, the directories are spread across the groups, so that
+    /// the files in different directories do not crowd into the same groups. The chosen group has
+    /// at least the average number of free inodes and free blocks, and has the fewest directories
+    /// among such groups. The parent directory's group wins the ties to keep the locality.
+    fn find_group_for_dir(&self, parent_block_group_idx: usize) -> usize {
+        let nr_groups = self.block_groups.len();
+        let avg_free_inodes = (self.free_inodes_count() as usize / nr_groups).max(1);
+        let avg_free_blocks = self.free_blocks_count() as usize / nr_groups;
+
+        (0..nr_groups)
+            .map(|i| (parent_block_group_idx + i) % nr_groups)
+            .filter_map(|idx| {
+                let usage = self.block_groups[idx].usage();
+                (usage.free_inodes as usize >= avg_free_inodes
+                    && usage.free_blocks as usize >= avg_free_blocks)
+                    .then_some((usage.dirs, idx))
+            })
+            .min_by_key(|(dirs, _)| *dirs)
+            .map_or(parent_block_group_idx, |(_, idx)| idx)
+    }
+
     /// Frees an inode.
     pub(super) fn free_inode(&self, ino: u32, is_dir: bool) -> Result<()> {
         let (_, block_group) = self.block_group_of_ino(ino)?;
         let inode_idx = self.inode_idx(ino);
-        // In order to prevent value underflow, it is necessary to increment
-        // the free inode counter prior to freeing the inode.
-        self.super_block.write().inc_free_inodes();
         block_group.free_inode(inode_idx, is_dir);
+        self.free_inodes.add(1);
+        self.mark_groups_dirty();
         Ok(())
     }
 
@@ -223,57 +330,139 @@ impl Ext2 {
     ///
     /// Attempts to allocate blocks from the `block_group_idx` group first.
     /// If allocation is not possible from this group, then search the remaining groups.
+    ///
+    /// If no blocks are available, the windows reserved for the growing files are released
+    /// and the allocation is retried.
     pub(super) fn alloc_blocks(
         &self,
-        mut block_group_idx: usize,
+        block_group_idx: usize,
         count: Ext2Bid,
     ) -> Option<Range<Ext2Bid>> {
-        if count > self.super_block.read().free_blocks_count() {
+        if let Some(allocated_range) = self.alloc_unreserved_blocks(block_group_idx, count) {
+            return Some(allocated_range);
+        }
+
+        if !self.release_all_reserved_blocks() {
             return None;
         }
+        self.alloc_unreserved_blocks(block_group_idx, count)
+    }
 
-        let mut remaining_count = count;
-        let mut allocated_range: Option<Range<Ext2Bid>> = None;
-        for _ in 0..self.block_groups.len() {
-            if remaining_count == 0 {
-                break;
-            }
+    /// Allocates blocks for the file of `ino` from the window reserved for it.
+    ///
+    /// If the window is empty, a new window of `window_cnt` blocks is reserved first. The
+    /// returned range may be smaller than `count`. Returns `None` if no window can be reserved.
+    pub(super) fn alloc_reserved_blocks(
+        &self,
+        ino: u32,
+        block_group_idx: usize,
+        count: Ext2Bid,
+        window_cnt: Ext2Bid,
+    ) -> Option<Range<Ext2Bid>> {
+        if let Some(allocated_range) = self.take_reserved_blocks(ino, count) {
+            return Some(allocated_range);
+        }
 
-            if block_group_idx >= self.block_groups.len() {
-                block_group_idx = 0;
-            }
-            let block_group = &self.block_groups[block_group_idx];
-            if let Some(range_in_group) = block_group.alloc_blocks(remaining_count) {
-                let device_range = {
-                    let start =
-                        (block_group_idx as Ext2Bid) * self.blocks_per_group + range_in_group.start;
-                    start..start + (range_in_group.len() as Ext2Bid)
-                };
-                match allocated_range {
-                    Some(ref mut range) => {
-                        if range.end == device_range.start {
-                            // Accumulate consecutive bids
-                            range.end = device_range.end;
-                            remaining_count -= range_in_group.len() as Ext2Bid;
-                        } else {
-                            block_group.free_blocks(range_in_group);
-                            break;
-                        }
-                    }
-                    None => {
-                        allocated_range = Some(device_range);
-                    }
-                }
-            }
-            block_group_idx += 1;
+        // Windows are only reserved from the blocks that are not reserved by others.
+        let window = self.alloc_unreserved_blocks(block_group_idx, window_cnt)?;
+        self.nr_reserved_blocks
+            .fetch_add(window.len() as u32, Ordering::Relaxed);
+        let old_window = self.reservations.lock().insert(ino, window);
+        if let Some(old_window) = old_window {
+            // Another window has been reserved for the file concurrently.
+            self.nr_reserved_blocks
+                .fetch_sub(old_window.len() as u32, Ordering::Relaxed);
+            self.free_blocks(old_window).unwrap();
+        }
+
+        self.take_reserved_blocks(ino, count)
+    }
+
+    /// Takes at most `count` blocks from the window reserved for the file of `ino`.
+    fn take_reserved_blocks(&self, ino: u32, count: Ext2Bid) -> Option<Range<Ext2Bid>> {
+        let mut reservations = self.reservations.lock();
+        let window = reservations.get_mut(&ino)?;
+
+        let start = window.start;
+        let end = (start + count).min(window.end);
+        window.start = end;
+        if window.is_empty() {
+            reservations.remove(&ino);
+        }
+        self.nr_reserved_blocks
+            .fetch_sub(end - start, Ordering::Relaxed);
+        Some(start..end)
+    }
+
+    /// Returns the blocks reserved for the file of `ino` to the block groups.
+    pub(super) fn release_reserved_blocks(&self, ino: u32) {
+        let Some(window) = self.reservations.lock().remove(&ino) else {
+            return;
+        };
+
+        self.nr_reserved_blocks
+            .fetch_sub(window.len() as u32, Ordering::Relaxed);
+        self.free_blocks(window).unwrap();
+    }
+
+    /// Returns the blocks reserved for all the files to the block groups.
+    ///
+    /// Returns whether any blocks are released.
+    fn release_all_reserved_blocks(&self) -> bool {
+        let windows = core::mem::take(&mut *self.reservations.lock());
+        if windows.is_empty() {
+            return false;
         }
 
-        if let Some(range) = allocated_range.as_ref() {
-            self.super_block
-                .write()
-                .dec_free_blocks(range.len() as Ext2Bid);
+        for window in windows.into_values() {
+            self.nr_reserved_blocks
+                .fetch_sub(window.len() as u32, Ordering::Relaxed);
+            self.free_blocks(window).unwrap();
         }
-        allocated_range
+        true
+    }
+
+    /// Allocates a consecutive range of blocks that are not reserved for the growing files.
+    ///
+    /// See [`Self::alloc_blocks`] for the semantics.
+    fn alloc_unreserved_blocks(
+        &self,
+        block_group_idx: usize,
+        count: Ext2Bid,
+    ) -> Option<Range<Ext2Bid>> {
+        if count as i64 > self.free_blocks.exact_sum() {
+            return None;
+        }
+
+        let (mut last_idx, mut allocated_range) =
+            self.groups_to_search(block_group_idx).find_map(|idx| {
+                let range_in_group = self.block_groups[idx].alloc_blocks(count)?;
+                Some((idx, self.device_range(idx, range_in_group)))
+            })?;
+        if last_idx != block_group_idx {
+            self.set_preferred_group(last_idx);
+        }
+
+        // Accumulate consecutive bids from the following groups
+        let nr_groups = self.block_groups.len();
+        while (allocated_range.len() as Ext2Bid) < count && last_idx + 1 < nr_groups {
+            last_idx += 1;
+            let block_group = &self.block_groups[last_idx];
+            let remaining_count = count - allocated_range.len() as Ext2Bid;
+            let Some(range_in_group) = block_group.alloc_blocks(remaining_count) else {
+                break;
+            };
+            let device_range = self.device_range(last_idx, range_in_group.clone());
+            if allocated_range.end != device_range.start {
+                block_group.free_blocks(range_in_group);
+                break;
+            }
+            allocated_range.end = device_range.end;
+        }
+
+        self.free_blocks.add(-(allocated_range.len() as i64));
+        self.mark_groups_dirty();
+        Some(allocated_range)
     }
 
     /// Frees a range of blocks.
@@ -286,18 +475,52 @@ impl Ext2 {
                 let len = (current_range.len() as Ext2Bid).min(self.blocks_per_group - start);
                 start..start + len
             };
-            // In order to prevent value underflow, it is necessary to increment
-            // the free block counter prior to freeing the block.
-            self.super_block
-                .write()
-                .inc_free_blocks(range_in_group.len() as Ext2Bid);
             block_group.free_blocks(range_in_group.clone());
+            self.free_blocks.add(range_in_group.len() as i64);
+            self.mark_groups_dirty();
             current_range.start += range_in_group.len() as Ext2Bid
         }
 
         Ok(())
     }
 
+    /// Returns the indices of the block groups to allocate from, starting from `first_idx`.
+    ///
+    /// If allocation is not possible from `first_idx`, the search continues from the preferred
+    /// group of the current CPU instead of the group next to `first_idx`. So the writers on
+    /// different CPUs do not scan over and contend for the same groups.
+    fn groups_to_search(&self, first_idx: usize) -> impl Iterator<Item = usize> {
+        let nr_groups = self.block_groups.len();
+        let preferred_idx = self.preferred_group();
+        core::iter::once(first_idx).chain(
+            (0..nr_groups)
+                .map(move |i| (preferred_idx + i) % nr_groups)
+                .filter(move |idx| *idx != first_idx),
+        )
+    }
+
+    /// Returns the preferred block group of the current CPU.
+    fn preferred_group(&self) -> usize {
+        let preempt_guard = disable_preempt();
+        let cpu = preempt_guard.current_cpu();
+        self.preferred_groups[cpu.as_usize()].load(Ordering::Relaxed)
+    }
+
+    /// Sets the preferred block group of the current CPU.
+    fn set_preferred_group(&self, block_group_idx: usize) {
+        let preempt_guard = disable_preempt();
+        let cpu = preempt_guard.current_cpu();
+        self.preferred_groups[cpu.as_usize()].store(block_group_idx, Ordering::Relaxed);
+    }
+
+    /// Marks that the block groups and the free counters should be written back.
+    fn mark_groups_dirty(&self) {
+        // Avoid writing the shared cache line if it is already marked.
+        if !self.has_dirty_groups.load(Ordering::Relaxed) {
+            self.has_dirty_groups.store(true, Ordering::Relaxed);
+        }
+    }
+
     /// Reads contiguous blocks starting from the `bid` synchronously.
     pub(super) fn read_blocks(&self, bid: Ext2Bid, bio_segment: BioSegment) -> Result<()> {
         let status = self
@@ -321,6 +544,18 @@ impl Ext2 {
         Ok(waiter)
     }
 
+    /// Reads contiguous blocks starting from the `bid` into multiple segments asynchronously.
+    pub(super) fn read_blocks_vectored_async(
+        &self,
+        bid: Ext2Bid,
+        bio_segments: Vec<BioSegment>,
+    ) -> Result<BioWaiter> {
+        let waiter = self
+            .block_device
+            .read_blocks_vectored_async(Bid::new(bid as u64), bio_segments)?;
+        Ok(waiter)
+    }
+
     /// Writes contiguous blocks starting from the `bid` synchronously.
     pub(super) fn write_blocks(&self, bid: Ext2Bid, bio_segment: BioSegment) -> Result<()> {
         let status = self
@@ -344,38 +579,68 @@ impl Ext2 {
         Ok(waiter)
     }
 
+    /// Writes contiguous blocks starting from the `bid` from multiple segments asynchronously.
+    pub(super) fn write_blocks_vectored_async(
+        &self,
+        bid: Ext2Bid,
+        bio_segments: Vec<BioSegment>,
+    ) -> Result<BioWaiter> {
+        let waiter = self
+            .block_device
+            .write_blocks_vectored_async(Bid::new(bid as u64), bio_segments)?;
+        Ok(waiter)
+    }
+
     /// Writes back the metadata to the block device.
     pub fn sync_metadata(&self) -> Result<()> {
-        // If the superblock is clean, the block groups must be clean.
-        if !self.super_block.read().is_dirty() {
+        if !self.has_dirty_groups.load(Ordering::Relaxed) && !self.super_block.read().is_dirty() {
             return Ok(());
         }
 
         let mut super_block = self.super_block.write();
-        // Writes back the metadata of block groups
-        for block_group in &self.block_groups {
-            block_group.sync_metadata()?;
+        // Fold the free counters into the superblock. If the write-back fails below, the
+        // superblock stays dirty, so the block groups will be written back again later.
+        if self.has_dirty_groups.swap(false, Ordering::Relaxed) {
+            let free_blocks = self.free_blocks.fold().clamp(0, u32::MAX as i64) as u32;
+            let free_inodes = self.free_inodes.fold().clamp(0, u32::MAX as i64) as u32;
+            super_block.set_free_blocks_count(free_blocks);
+            super_block.set_free_inodes_count(free_inodes);
         }
 
-        // Writes back the main superblock and group descriptor table.
-        let mut bio_waiter = BioWaiter::new();
+        // Writes back the metadata of block groups, the main superblock, and the group descriptor
+        // table, and waits for all of them at once.
         let raw_super_block = RawSuperBlock::from((*super_block).deref());
-        bio_waiter.concat(
-            self.block_device
-                .write_bytes_async(SUPER_BLOCK_OFFSET, raw_super_block.as_bytes())?,
-        );
         let group_descriptors_bio_segment = BioSegment::new_from_segment(
             self.group_descriptors_segment.clone(),
             BioDirection::ToDevice,
         );
-        bio_waiter.concat(self.block_device.write_blocks_async(
-            super_block.group_descriptors_bid(0),
-            group_descriptors_bio_segment.clone(),
-        )?);
-        bio_waiter
-            .wait()
-            .ok_or_else(|| Error::with_message(Errno::EIO, "failed to sync main metadata"))?;
-        drop(bio_waiter);
+        let sync_main_metadata = |synced_groups: &mut Vec<_>| -> Result<()> {
+            let mut bio_waiter = BioWaiter::new();
+            for block_group in &self.block_groups {
+                if block_group.sync_metadata(&mut bio_waiter)? {
+                    synced_groups.push(block_group);
+                }
+            }
+            bio_waiter.concat(
+                self.block_device
+                    .write_bytes_async(SUPER_BLOCK_OFFSET, raw_super_block.as_bytes())?,
+            );
+            bio_waiter.concat(self.block_device.write_blocks_async(
+                super_block.group_descriptors_bid(0),
+                group_descriptors_bio_segment.clone(),
+            )?);
+            bio_waiter
+                .wait()
+                .ok_or_else(|| Error::with_message(Errno::EIO, "failed to sync main metadata"))?;
+            Ok(())
+        };
+        let mut synced_groups = Vec::new();
+        if let Err(err) = sync_main_metadata(&mut synced_groups) {
+            for block_group in synced_groups {
+                block_group.redirty_metadata();
+            }
+            return Err(err);
+        }
 
         // Writes back the backups of superblock and group descriptor table.
         let mut raw_super_block_backup = raw_super_block;
@@ -433,6 +698,16 @@ impl Ext2 {
         (ino - 1) % self.inodes_per_group
     }
 
+    #[inline]
+    fn device_range(
+        &self,
+        block_group_idx: usize,
+        range_in_group: Range<Ext2Bid>,
+    ) -> Range<Ext2Bid> {
+        let start = (block_group_idx as Ext2Bid) * self.blocks_per_group + range_in_group.start;
+        start..start + (range_in_group.len() as Ext2Bid)
+    }
+
     #[inline]
     fn block_idx(&self, bid: Ext2Bid) -> Ext2Bid {
         bid % self.blocks_per_group
@@ -1,10 +1,8 @@
 // SPDX-License-Identifier: MPL-2.0
 
-use ostd::sync::RwMutexReadGuard;
-
 use crate::{
     fs::{
-        ext2::{utils::Dirty, Ext2, SuperBlock as Ext2SuperBlock, MAGIC_NUM as EXT2_MAGIC},
+        ext2::{Ext2, MAGIC_NUM as EXT2_MAGIC},
         utils::{FileSystem, FsFlags, Inode, SuperBlock, NAME_MAX},
     },
     prelude::*,
@@ -24,28 +22,23 @@ impl FileSystem for Ext2 {
     }
 
     fn sb(&self) -> SuperBlock {
-        SuperBlock::from(self.super_block())
-    }
-
-    fn flags(&self) -> FsFlags {
-        FsFlags::empty()
-    }
-}
-
-impl From<RwMutexReadGuard<'_, Dirty<Ext2SuperBlock>>> for SuperBlock {
-    fn from(ext2_sb: RwMutexReadGuard<Dirty<Ext2SuperBlock>>) -> Self {
-        Self {
+        let ext2_sb = self.super_block();
+        SuperBlock {
             magic: EXT2_MAGIC as _,
             bsize: ext2_sb.block_size(),
             blocks: ext2_sb.total_blocks() as _,
-            bfree: ext2_sb.free_blocks_count() as _,
-            bavail: ext2_sb.free_blocks_count() as _,
+            bfree: self.free_blocks_count() as _,
+            bavail: self.free_blocks_count() as _,
             files: ext2_sb.total_inodes() as _,
-            ffree: ext2_sb.free_inodes_count() as _,
+            ffree: self.free_inodes_count() as _,
             fsid: 0, // TODO
             namelen: NAME_MAX,
             frsize: ext2_sb.fragment_size(),
             flags: 0, // TODO
         }
     }
+
+    fn flags(&self) -> FsFlags {
+        FsFlags::empty()
+    }
 }
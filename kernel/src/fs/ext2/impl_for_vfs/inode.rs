@@ -4,14 +4,17 @@
 
 use core::time::Duration;
 
+use align_ext::AlignExt;
+use aster_block::BLOCK_SIZE;
 use aster_rights::Full;
 
 use crate::{
     fs::{
         ext2::{FilePerm, Inode as Ext2Inode},
         utils::{
-            DirentVisitor, Extension, FallocMode, FileSystem, Inode, InodeMode, InodeType,
-            IoctlCmd, Metadata, MknodType, XattrName, XattrNamespace, XattrSetFlags,
+            copy_range_by_page_cache, DirentVisitor, Extension, FallocMode, FileSystem, Inode,
+            InodeMode, InodeType, IoctlCmd, Metadata, MknodType, XattrName, XattrNamespace,
+            XattrSetFlags,
         },
     },
     prelude::*,
@@ -111,6 +114,61 @@ impl Inode for Ext2Inode {
         self.write_direct_at(offset, reader)
     }
 
+    fn copy_range_from(
+        &self,
+        src: &dyn Inode,
+        src_offset: usize,
+        offset: usize,
+        len: usize,
+    ) -> Result<usize> {
+        let len = len.min(src.size().saturating_sub(src_offset));
+        let blocks_range = offset.align_up(BLOCK_SIZE)..(offset + len).align_down(BLOCK_SIZE);
+        let src_inode = match src.downcast_ref::<Ext2Inode>() {
+            Some(src_inode)
+                if !core::ptr::eq(src_inode, self)
+                    && Arc::ptr_eq(&src_inode.fs(), &self.fs())
+                    && src_offset % BLOCK_SIZE == offset % BLOCK_SIZE
+                    && blocks_range.start < blocks_range.end =>
+            {
+                src_inode
+            }
+            _ => return copy_range_by_page_cache(src, src_offset, self, offset, len),
+        };
+
+        // Allocates the blocks of the whole range at once, so that they are more
+        // likely to be consecutive on the device.
+        if offset + len > self.file_size() {
+            self.resize(offset + len)?;
+        }
+
+        // Copies the unaligned head and tail through the page caches, and the
+        // whole blocks between them directly on the device.
+        let head_len = blocks_range.start - offset;
+        let copied_len = copy_range_by_page_cache(src, src_offset, self, offset, head_len)?;
+        if copied_len < head_len {
+            return Ok(copied_len);
+        }
+
+        let blocks_len = blocks_range.len();
+        self.copy_blocks_from(
+            src_inode,
+            src_offset + head_len,
+            blocks_range.start,
+            blocks_len,
+        )?;
+
+        let tail_len = len - head_len - blocks_len;
+        let copied_len = copy_range_by_page_cache(
+            src,
+            src_offset + head_len + blocks_len,
+            self,
+            blocks_range.end,
+            tail_len,
+        )?;
+
+        Ok(head_len + blocks_len + copied_len)
+    }
+
     fn create(&self, name: &str, type_: InodeType, mode: InodeMode) -> Result<Arc<dyn Inode>> {
         Ok(self.create(name, type_, mode.into())?)
     }
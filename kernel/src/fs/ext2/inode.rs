@@ -7,11 +7,15 @@ use alloc::{borrow::ToOwned, rc::Rc};
 use core::sync::atomic::{AtomicUsize, Ordering};
 
 use inherit_methods_macro::inherit_methods;
-use ostd::{const_assert, mm::UntypedMem};
+use ostd::{
+    const_assert,
+    mm::{UFrame, UntypedMem},
+};
 
 use super::{
     block_ptr::{BidPath, BlockPtrs, Ext2Bid, BID_SIZE, MAX_BLOCK_PTRS},
     dir::{DirEntryHeader, DirEntryItem, DirEntryReader, DirEntryWriter},
+    extent_cache::ExtentCache,
     fs::Ext2,
     indirect_block_cache::{IndirectBlock, IndirectBlockCache},
     prelude::*,
@@ -22,8 +26,8 @@ use crate::{
     fs::{
         path::{is_dot, is_dot_or_dotdot, is_dotdot},
         utils::{
-            Extension, FallocMode, Inode as _, InodeMode, Metadata, Permission, XattrName,
-            XattrNamespace, XattrSetFlags,
+            pin_reader_pages, pin_writer_pages, Extension, FallocMode, Inode as _, InodeMode,
+            Metadata, Permission, XattrName, XattrNamespace, XattrSetFlags,
         },
     },
     process::{posix_thread::AsPosixThread, Gid, Uid},
@@ -35,6 +39,15 @@ pub const MAX_FNAME_LEN: usize = 255;
 /// Max path length of the fast symlink.
 pub const MAX_FAST_SYMLINK_LEN: usize = MAX_BLOCK_PTRS * BID_SIZE;
 
+/// The lower bound on the number of blocks reserved for a growing file.
+const MIN_RESERVED_BLOCKS: Ext2Bid = 8;
+
+/// The upper bound on the number of blocks reserved for a growing file.
+const MAX_RESERVED_BLOCKS: Ext2Bid = 1024;
+
+/// The upper bound on the number of blocks of a coalesced device range.
+const MAX_BLOCKS_PER_DEVICE_RANGE: usize = 1024;
+
 /// The Ext2 inode.
 pub struct Inode {
     ino: u32,
@@ -607,26 +620,29 @@ impl Inode {
             return_errno!(Errno::ENOTDIR);
         }
 
+        let mut inos = Vec::new();
         let offset_read = {
             let inner = self.inner.read();
             if inner.hard_links() == 0 {
                 return_errno_with_message!(Errno::ENOENT, "dir removed");
             }
 
-            let try_readdir = |offset: &mut usize, visitor: &mut dyn DirentVisitor| -> Result<()> {
-                let mut dir_entry_reader = DirEntryReader::new(&inner.page_cache, *offset);
-                for dir_entry in dir_entry_reader.iter_entries() {
-                    visitor.visit(
-                        dir_entry.name(),
-                        dir_entry.ino() as u64,
-                        dir_entry.type_(),
-                        dir_entry.record_len(),
-                    )?;
-                    *offset += dir_entry.record_len();
-                }
+            let mut try_readdir =
+                |offset: &mut usize, visitor: &mut dyn DirentVisitor| -> Result<()> {
+                    let mut dir_entry_reader = DirEntryReader::new(&inner.page_cache, *offset);
+                    for dir_entry in dir_entry_reader.iter_entries() {
+                        visitor.visit(
+                            dir_entry.name(),
+                            dir_entry.ino() as u64,
+                            dir_entry.type_(),
+                            dir_entry.record_len(),
+                        )?;
+                        inos.push(dir_entry.ino());
+                        *offset += dir_entry.record_len();
+                    }
 
-                Ok(())
-            };
+                    Ok(())
+                };
 
             let mut iterate_offset = offset;
             match try_readdir(&mut iterate_offset, visitor) {
@@ -635,6 +651,8 @@ impl Inode {
             }?
         };
 
+        // The inodes of the entries are likely to be looked up soon, e.g., by `ls -l`.
+        self.fs().prefetch_inodes(&inos);
         self.set_atime(now());
 
         Ok(offset_read)
@@ -749,6 +767,61 @@ impl Inode {
         Ok(bytes_written)
     }
 
+    /// Copies the data in `src_offset..src_offset + len` of `src` to `offset` of the file,
+    /// by transferring the device blocks directly without going through the page caches.
+    ///
+    /// The offsets and the length must be block-aligned, and `src` must be another file
+    /// of the same filesystem.
+    pub fn copy_blocks_from(
+        &self,
+        src: &Inode,
+        src_offset: usize,
+        offset: usize,
+        len: usize,
+    ) -> Result<()> {
+        if self.type_ != InodeType::File || src.type_ != InodeType::File {
+            return_errno!(Errno::EISDIR);
+        }
+        if !is_block_aligned(src_offset) || !is_block_aligned(offset) || !is_block_aligned(len) {
+            return_errno_with_message!(Errno::EINVAL, "not block-aligned");
+        }
+        if core::ptr::eq(self, src) || !Arc::ptr_eq(&self.fs(), &src.fs()) {
+            return_errno_with_message!(Errno::EINVAL, "not another file of the same fs");
+        }
+
+        // Persists the dirty pages of the source, so that its blocks are up to date.
+        // The source is unlocked before the destination is locked, so the copies in
+        // the opposite directions cannot deadlock.
+        let src_block_manager = {
+            let src_inner = src.inner.read();
+            if src_offset + len > src_inner.file_size() {
+                return_errno_with_message!(Errno::EINVAL, "the range exceeds the source");
+            }
+            src_inner
+                .page_cache
+                .evict_range(src_offset..src_offset + len)?;
+            src_inner.inode_impl.block_manager.clone()
+        };
+
+        let mut inner = self.inner.write();
+        if offset + len > inner.file_size() {
+            inner.resize(offset + len)?;
+        }
+        inner.page_cache.discard_range(offset..offset + len);
+        inner.inode_impl.block_manager.copy_blocks_from(
+            &src_block_manager,
+            Bid::from_offset(src_offset).to_raw() as Ext2Bid,
+            Bid::from_offset(offset).to_raw() as Ext2Bid,
+            len / BLOCK_SIZE,
+        )?;
+
+        let now = now();
+        inner.set_mtime(now);
+        inner.set_ctime(now);
+
+        Ok(())
+    }
+
     pub fn sync_all(&self) -> Result<()> {
         let mut inner = self.inner.write();
         inner.sync_data()?;
@@ -1000,7 +1073,8 @@ impl InodeInner {
         if read_len == 0 {
             return Ok(read_len);
         }
-        self.page_cache.discard_range(offset..offset + read_len);
+        // Writes back the dirty pages first, or the reads would miss them.
+        self.page_cache.evict_range(offset..offset + read_len)?;
 
         let start_bid = Bid::from_offset(offset).to_raw() as Ext2Bid;
         let buf_nblocks = read_len / BLOCK_SIZE;
@@ -1203,6 +1277,7 @@ impl InodeImpl {
             nblocks: AtomicUsize::new(desc.blocks_count() as _),
             block_ptrs: RwMutex::new(desc.block_ptrs),
             indirect_blocks: RwMutex::new(IndirectBlockCache::new(fs.clone())),
+            extents: SpinLock::new(ExtentCache::new()),
             fs,
         };
         Self {
@@ -1358,6 +1433,8 @@ impl InodeImpl {
             }
         }
 
+        // Returns the reserved blocks, so that no blocks are leaked on the device.
+        self.release_reserved_blocks();
         self.block_manager.indirect_blocks.write().evict_all()?;
         inode.fs().sync_inode(inode.ino(), &self.desc)?;
         self.desc.clear_dirty();
@@ -1387,7 +1464,8 @@ impl InodeImpl {
 
         // Expands block count if necessary
         if new_blocks > old_blocks {
-            if new_blocks - old_blocks > self.fs().super_block().free_blocks_count() {
+            // The count includes the blocks reserved for this file and the others.
+            if new_blocks - old_blocks > self.fs().free_blocks_count() {
                 return_errno_with_message!(Errno::ENOSPC, "not enough free blocks");
             }
             self.expand_blocks(old_blocks..new_blocks)?;
@@ -1453,7 +1531,6 @@ impl InodeImpl {
         // Allocates the blocks only, no indirect blocks are required.
         if indirect_cnt == 0 {
             let device_range = self
-                .fs()
                 .alloc_blocks(block_group_idx, max_cnt)
                 .ok_or_else(|| Error::new(Errno::ENOSPC))?;
             if let Err(e) = self.set_device_range(range.start, device_range.clone()) {
@@ -1471,7 +1548,7 @@ impl InodeImpl {
             let mut total_cnt = max_cnt + indirect_cnt;
             let mut device_range: Option<Range<Ext2Bid>> = None;
             while device_range.is_none() {
-                let Some(mut range) = self.fs().alloc_blocks(block_group_idx, total_cnt) else {
+                let Some(mut range) = self.alloc_blocks(block_group_idx, total_cnt) else {
                     for indirect_bid in indirect_bids.iter() {
                         self.fs()
                             .free_blocks(*indirect_bid..*indirect_bid + 1)
@@ -1511,6 +1588,37 @@ impl InodeImpl {
         Ok(device_range.len() as Ext2Bid)
     }
 
+    /// Allocates consecutive blocks for the file, preferring the reserved ones.
+    ///
+    /// The returned range may be shorter than `count`. The blocks of a regular
+    /// file are taken from a window of device blocks reserved for it, so that
+    /// the blocks of a growing file stay consecutive even if other files are
+    /// growing at the same time. When the window runs out, a new window
+    /// proportional to the file size is reserved, which makes large files be
+    /// laid out in long runs.
+    fn alloc_blocks(&mut self, block_group_idx: usize, count: Ext2Bid) -> Option<Range<Ext2Bid>> {
+        let fs = self.fs();
+        if self.desc.type_ == InodeType::File {
+            let window_cnt = self
+                .desc
+                .blocks_count()
+                .clamp(MIN_RESERVED_BLOCKS, MAX_RESERVED_BLOCKS)
+                .max(count);
+            let ino = self.inode().ino();
+            if let Some(range) = fs.alloc_reserved_blocks(ino, block_group_idx, count, window_cnt) {
+                return Some(range);
+            }
+        }
+
+        fs.alloc_blocks(block_group_idx, count)
+    }
+
+    /// Returns the blocks reserved for the file to the filesystem.
+    fn release_reserved_blocks(&mut self) {
+        let ino = self.inode().ino();
+        self.fs().release_reserved_blocks(ino);
+    }
+
     /// Sets the device block IDs for a specified range.
     ///
     /// It updates the mapping between the file's block IDs and the device's block IDs
@@ -1520,7 +1628,7 @@ impl InodeImpl {
         match BidPath::from(start_bid) {
             BidPath::Direct(idx) => {
                 let mut block_ptrs = self.block_manager.block_ptrs.write();
-                for (i, bid) in device_range.enumerate() {
+                for (i, bid) in device_range.clone().enumerate() {
                     self.desc.block_ptrs.set_direct(idx as usize + i, bid);
                     block_ptrs.set_direct(idx as usize + i, bid);
                 }
@@ -1530,7 +1638,7 @@ impl InodeImpl {
                 assert!(indirect_bid != 0);
                 let mut indirect_blocks = self.block_manager.indirect_blocks.write();
                 let indirect_block = indirect_blocks.find_mut(indirect_bid)?;
-                for (i, bid) in device_range.enumerate() {
+                for (i, bid) in device_range.clone().enumerate() {
                     indirect_block.write_bid(idx as usize + i, &bid)?;
                 }
             }
@@ -1545,7 +1653,7 @@ impl InodeImpl {
                 assert!(lvl1_indirect_bid != 0);
 
                 let lvl1_indirect_block = indirect_blocks.find_mut(lvl1_indirect_bid)?;
-                for (i, bid) in device_range.enumerate() {
+                for (i, bid) in device_range.clone().enumerate() {
                     lvl1_indirect_block.write_bid(lvl2_idx as usize + i, &bid)?;
                 }
             }
@@ -1565,11 +1673,13 @@ impl InodeImpl {
                 assert!(lvl2_indirect_bid != 0);
 
                 let lvl2_indirect_block = indirect_blocks.find_mut(lvl2_indirect_bid)?;
-                for (i, bid) in device_range.enumerate() {
+                for (i, bid) in device_range.clone().enumerate() {
                     lvl2_indirect_block.write_bid(lvl3_idx as usize + i, &bid)?;
                 }
             }
         }
+
+        self.block_manager.cache_extent(start_bid, device_range);
         Ok(())
     }
 
@@ -1662,6 +1772,9 @@ impl InodeImpl {
     ///
     /// After the reduction, the block count will be decreased to `range.start`.
     fn shrink_blocks(&mut self, range: Range<Ext2Bid>) {
+        self.release_reserved_blocks();
+        self.block_manager.uncache_extents_from(range.start);
+
         let mut current_range = range.clone();
         while !current_range.is_empty() {
             let free_cnt = self.try_shrink_blocks(current_range.clone());
@@ -1804,12 +1917,6 @@ impl InodeImpl {
 
 #[inherit_methods(from = "self.block_manager")]
 impl InodeImpl {
-    pub fn read_blocks_async(
-        &self,
-        bid: Ext2Bid,
-        nblocks: usize,
-        writer: &mut VmWriter,
-    ) -> Result<BioWaiter>;
     pub fn read_blocks(&self, bid: Ext2Bid, nblocks: usize, writer: &mut VmWriter) -> Result<()>;
     pub fn read_block_async(&self, bid: Ext2Bid, frame: &CachePage) -> Result<BioWaiter>;
     pub fn write_blocks_async(
@@ -1832,45 +1939,56 @@ struct InodeBlockManager {
     /// frequent reads access the `InodeDesc` copy without locking.
     block_ptrs: RwMutex<BlockPtrs>,
     indirect_blocks: RwMutex<IndirectBlockCache>,
+    /// Caches the device block IDs of the file's blocks.
+    ///
+    /// It is only updated with the `indirect_blocks` locked, so that the
+    /// mappings read from the block pointers cannot overwrite the newer ones.
+    extents: SpinLock<ExtentCache>,
     fs: Weak<Ext2>,
 }
 
 impl InodeBlockManager {
-    /// Reads one or multiple blocks to the segment start from `bid` asynchronously.
-    pub fn read_blocks_async(
-        &self,
-        bid: Ext2Bid,
-        nblocks: usize,
-        writer: &mut VmWriter,
-    ) -> Result<BioWaiter> {
-        debug_assert!(nblocks * BLOCK_SIZE <= writer.avail());
-        let mut bio_waiter = BioWaiter::new();
-
-        for dev_range in DeviceRangeReader::new(self, bid..bid + nblocks as Ext2Bid)? {
-            let start_bid = dev_range.start as Ext2Bid;
-            let range_nblocks = dev_range.len();
+    /// Reads one or multiple blocks starting from `bid` to the writer.
+    ///
+    /// If the writer points to a page-aligned user buffer, the blocks are read
+    /// into the user pages directly. Otherwise, they are read into bounce
+    /// segments, which are copied to the writer after the reads complete.
+    pub fn read_blocks(&self, bid: Ext2Bid, nblocks: usize, writer: &mut VmWriter) -> Result<()> {
+        let len = nblocks * BLOCK_SIZE;
+        debug_assert!(len <= writer.avail());
+        let range = bid..bid + nblocks as Ext2Bid;
 
-            let bio_segment = BioSegment::alloc(range_nblocks, BioDirection::FromDevice);
-            bio_segment.reader().unwrap().read_fallible(writer)?;
+        if let Some(frames) = pin_writer_pages(writer, len) {
+            self.transfer_blocks_with_frames(range, &frames, BioDirection::FromDevice)?;
+            writer.skip(len);
+            return Ok(());
+        }
 
-            let waiter = self.fs().read_blocks_async(start_bid, bio_segment)?;
+        let mut bio_waiter = BioWaiter::new();
+        let mut bio_segments = Vec::new();
+        for dev_range in self.device_ranges(range)? {
+            let bio_segment = BioSegment::alloc(dev_range.len(), BioDirection::FromDevice);
+            let waiter = self
+                .fs()
+                .read_blocks_async(dev_range.start, bio_segment.clone())?;
             bio_waiter.concat(waiter);
+            bio_segments.push(bio_segment);
         }
 
-        Ok(bio_waiter)
-    }
-
-    pub fn read_blocks(&self, bid: Ext2Bid, nblocks: usize, writer: &mut VmWriter) -> Result<()> {
-        match self.read_blocks_async(bid, nblocks, writer)?.wait() {
-            Some(BioStatus::Complete) => Ok(()),
+        match bio_waiter.wait() {
+            Some(BioStatus::Complete) => (),
             _ => return_errno!(Errno::EIO),
         }
+        for bio_segment in bio_segments {
+            bio_segment.reader().unwrap().read_fallible(writer)?;
+        }
+        Ok(())
     }
 
     pub fn read_block_async(&self, bid: Ext2Bid, frame: &CachePage) -> Result<BioWaiter> {
         let mut bio_waiter = BioWaiter::new();
 
-        for dev_range in DeviceRangeReader::new(self, bid..bid + 1 as Ext2Bid)? {
+        for dev_range in self.device_ranges(bid..bid + 1 as Ext2Bid)? {
             let start_bid = dev_range.start as Ext2Bid;
             // TODO: Should we allocate the bio segment from the pool on reads?
             // This may require an additional copy to the requested frame in the completion callback.
@@ -1895,7 +2013,7 @@ impl InodeBlockManager {
         debug_assert_eq!(nblocks * BLOCK_SIZE, reader.remain());
         let mut bio_waiter = BioWaiter::new();
 
-        for dev_range in DeviceRangeReader::new(self, bid..bid + nblocks as Ext2Bid)? {
+        for dev_range in self.device_ranges(bid..bid + nblocks as Ext2Bid)? {
             let start_bid = dev_range.start as Ext2Bid;
             let range_nblocks = dev_range.len();
 
@@ -1909,7 +2027,19 @@ impl InodeBlockManager {
         Ok(bio_waiter)
     }
 
+    /// Writes one or multiple blocks starting from `bid` from the reader.
+    ///
+    /// If the reader points to a page-aligned user buffer, the blocks are
+    /// written from the user pages directly.
     pub fn write_blocks(&self, bid: Ext2Bid, nblocks: usize, reader: &mut VmReader) -> Result<()> {
+        let len = nblocks * BLOCK_SIZE;
+        if let Some(frames) = pin_reader_pages(reader, len) {
+            let range = bid..bid + nblocks as Ext2Bid;
+            self.transfer_blocks_with_frames(range, &frames, BioDirection::ToDevice)?;
+            reader.skip(len);
+            return Ok(());
+        }
+
         match self.write_blocks_async(bid, nblocks, reader)?.wait() {
             Some(BioStatus::Complete) => Ok(()),
             _ => return_errno!(Errno::EIO),
@@ -1919,7 +2049,7 @@ impl InodeBlockManager {
     pub fn write_block_async(&self, bid: Ext2Bid, frame: &CachePage) -> Result<BioWaiter> {
         let mut bio_waiter = BioWaiter::new();
 
-        for dev_range in DeviceRangeReader::new(self, bid..bid + 1 as Ext2Bid)? {
+        for dev_range in self.device_ranges(bid..bid + 1 as Ext2Bid)? {
             let start_bid = dev_range.start as Ext2Bid;
             let bio_segment = BioSegment::alloc(1, BioDirection::ToDevice);
             // This requires an additional copy to the pooled bio segment.
@@ -1934,6 +2064,182 @@ impl InodeBlockManager {
         Ok(bio_waiter)
     }
 
+    /// Copies `nblocks` blocks starting from `src_bid` of `src` to the blocks
+    /// starting from `bid`.
+    ///
+    /// The blocks are read into a buffer and written back in batches, each of
+    /// which is transferred with one bio per run of consecutive device blocks.
+    pub fn copy_blocks_from(
+        &self,
+        src: &InodeBlockManager,
+        src_bid: Ext2Bid,
+        bid: Ext2Bid,
+        nblocks: usize,
+    ) -> Result<()> {
+        /// The maximum number of blocks copied through the buffer at a time.
+        const MAX_BATCH_NBLOCKS: usize = 256;
+
+        if nblocks == 0 {
+            return Ok(());
+        }
+        let buf_nblocks = nblocks.min(MAX_BATCH_NBLOCKS);
+        let buf: USegment = FrameAllocOptions::new()
+            .zeroed(false)
+            .alloc_segment(buf_nblocks)?
+            .into();
+
+        let mut copied_nblocks = 0;
+        while copied_nblocks < nblocks {
+            let batch_nblocks = buf_nblocks.min(nblocks - copied_nblocks);
+            let src_start = src_bid + copied_nblocks as Ext2Bid;
+            let start = bid + copied_nblocks as Ext2Bid;
+
+            src.transfer_blocks(
+                src_start..src_start + batch_nblocks as Ext2Bid,
+                &buf,
+                BioDirection::FromDevice,
+            )?;
+            self.transfer_blocks(
+                start..start + batch_nblocks as Ext2Bid,
+                &buf,
+                BioDirection::ToDevice,
+            )?;
+            copied_nblocks += batch_nblocks;
+        }
+
+        Ok(())
+    }
+
+    /// Transfers the blocks in `range` between the device and `segment`, and
+    /// waits for the transfer to complete.
+    ///
+    /// The bios use the frames of `segment` directly, so no extra copies are made.
+    fn transfer_blocks(
+        &self,
+        range: Range<Ext2Bid>,
+        segment: &USegment,
+        direction: BioDirection,
+    ) -> Result<()> {
+        let mut bio_waiter = BioWaiter::new();
+        let mut offset = 0;
+
+        for dev_range in self.device_ranges(range)? {
+            let len = dev_range.len() * BLOCK_SIZE;
+            let bio_segment =
+                BioSegment::new_from_segment(segment.slice(&(offset..offset + len)), direction);
+            let waiter = match direction {
+                BioDirection::FromDevice => {
+                    self.fs().read_blocks_async(dev_range.start, bio_segment)?
+                }
+                BioDirection::ToDevice => {
+                    self.fs().write_blocks_async(dev_range.start, bio_segment)?
+                }
+            };
+            bio_waiter.concat(waiter);
+            offset += len;
+        }
+
+        match bio_waiter.wait() {
+            Some(BioStatus::Complete) => Ok(()),
+            _ => return_errno!(Errno::EIO),
+        }
+    }
+
+    /// Transfers the blocks in `range` between the device and `frames`, one
+    /// frame per block, and waits for the transfer to complete.
+    ///
+    /// Each run of consecutive device blocks is transferred with the frames
+    /// as the scatter/gather segments, so no extra copies are made.
+    fn transfer_blocks_with_frames(
+        &self,
+        range: Range<Ext2Bid>,
+        frames: &[UFrame],
+        direction: BioDirection,
+    ) -> Result<()> {
+        debug_assert_eq!(range.len(), frames.len());
+        let mut bio_waiter = BioWaiter::new();
+        let mut frames = frames.iter();
+
+        for dev_range in self.device_ranges(range)? {
+            let bio_segments = frames
+                .by_ref()
+                .take(dev_range.len())
+                .map(|frame| BioSegment::new_from_segment(frame.clone().into(), direction))
+                .collect();
+            let waiter = match direction {
+                BioDirection::FromDevice => self
+                    .fs()
+                    .read_blocks_vectored_async(dev_range.start, bio_segments)?,
+                BioDirection::ToDevice => self
+                    .fs()
+                    .write_blocks_vectored_async(dev_range.start, bio_segments)?,
+            };
+            bio_waiter.concat(waiter);
+        }
+
+        match bio_waiter.wait() {
+            Some(BioStatus::Complete) => Ok(()),
+            _ => return_errno!(Errno::EIO),
+        }
+    }
+
+    /// Returns the device block ID ranges of the blocks in `range`.
+    ///
+    /// The ranges are looked up in the extent cache first, and the missing ones
+    /// are read from the block pointers and then cached. The consecutive device
+    /// ranges are coalesced, so that each of them can be served by one bio.
+    fn device_ranges(&self, range: Range<Ext2Bid>) -> Result<Vec<Range<Ext2Bid>>> {
+        let mut device_ranges: Vec<Range<Ext2Bid>> = Vec::new();
+        let mut push_range = |device_range: Range<Ext2Bid>| match device_ranges.last_mut() {
+            Some(last)
+                if last.end == device_range.start
+                    && last.len() + device_range.len() <= MAX_BLOCKS_PER_DEVICE_RANGE =>
+            {
+                last.end = device_range.end;
+            }
+            _ => device_ranges.push(device_range),
+        };
+
+        let mut current_range = range;
+        while !current_range.is_empty() {
+            let max_cnt = current_range.len().min(MAX_BLOCKS_PER_DEVICE_RANGE);
+            let cached_range = self
+                .extents
+                .lock()
+                .lookup(current_range.start, max_cnt as Ext2Bid);
+            if let Some(device_range) = cached_range {
+                current_range.start += device_range.len() as Ext2Bid;
+                push_range(device_range);
+                continue;
+            }
+
+            // Reads the rest of the mappings from the block pointers.
+            let mut reader = DeviceRangeReader::new(self, current_range.clone())?;
+            while !current_range.is_empty() {
+                let device_range = reader.read()?;
+                self.extents
+                    .lock()
+                    .insert(current_range.start, device_range.clone());
+                current_range.start += device_range.len() as Ext2Bid;
+                push_range(device_range);
+            }
+        }
+
+        Ok(device_ranges)
+    }
+
+    /// Caches the mapping from the blocks starting from `bid` to `device_range`.
+    fn cache_extent(&self, bid: Ext2Bid, device_range: Range<Ext2Bid>) {
+        let _indirect_blocks = self.indirect_blocks.write();
+        self.extents.lock().insert(bid, device_range);
+    }
+
+    /// Removes the cached mappings of the blocks starting from `bid`.
+    fn uncache_extents_from(&self, bid: Ext2Bid) {
+        let _indirect_blocks = self.indirect_blocks.write();
+        self.extents.lock().truncate(bid);
+    }
+
     pub fn nblocks(&self) -> usize {
         self.nblocks.load(Ordering::Acquire)
     }
@@ -43,6 +43,7 @@ pub use super_block::{SuperBlock, MAGIC_NUM};
 mod block_group;
 mod block_ptr;
 mod dir;
+mod extent_cache;
 mod fs;
 mod impl_for_vfs;
 mod indirect_block_cache;
@@ -245,34 +245,33 @@ impl SuperBlock {
     }
 
     /// Returns the number of free blocks.
+    ///
+    /// The number is updated only when the metadata is written back. See
+    /// [`Ext2::free_blocks_count`] for the up-to-date number.
+    ///
+    /// [`Ext2::free_blocks_count`]: super::Ext2::free_blocks_count
     pub fn free_blocks_count(&self) -> u32 {
         self.free_blocks_count
     }
 
-    /// Increase the number of free blocks.
-    pub(super) fn inc_free_blocks(&mut self, count: u32) {
-        self.free_blocks_count = self.free_blocks_count.checked_add(count).unwrap();
-    }
-
-    /// Decrease the number of free blocks.
-    pub(super) fn dec_free_blocks(&mut self, count: u32) {
-        self.free_blocks_count = self.free_blocks_count.checked_sub(count).unwrap();
+    /// Sets the number of free blocks.
+    pub(super) fn set_free_blocks_count(&mut self, count: u32) {
+        self.free_blocks_count = count;
     }
 
     /// Returns the number of free inodes.
+    ///
+    /// The number is updated only when the metadata is written back. See
+    /// [`Ext2::free_inodes_count`] for the up-to-date number.
+    ///
+    /// [`Ext2::free_inodes_count`]: super::Ext2::free_inodes_count
     pub fn free_inodes_count(&self) -> u32 {
         self.free_inodes_count
     }
 
-    /// Increase the number of free inodes.
-    pub(super) fn inc_free_inodes(&mut self) {
-        self.free_inodes_count += 1;
-    }
-
-    /// Decrease the number of free inodes.
-    pub(super) fn dec_free_inodes(&mut self) {
-        debug_assert!(self.free_inodes_count > 0);
-        self.free_inodes_count -= 1;
+    /// Sets the number of free inodes.
+    pub(super) fn set_free_inodes_count(&mut self, count: u32) {
+        self.free_inodes_count = count;
     }
 
     /// Checks if the block group will backup the super block.
@@ -64,6 +64,11 @@ impl<T: Debug> Dirty<T> {
     pub fn clear_dirty(&mut self) {
         self.dirty = false;
     }
+
+    /// Sets the dirty flag.
+    pub fn mark_dirty(&mut self) {
+        self.dirty = true;
+    }
 }
 
 impl<T: Debug> Deref for Dirty<T> {
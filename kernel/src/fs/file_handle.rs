@@ -4,12 +4,15 @@
 
 //! Opened File Handle
 
+use aster_rights::Rights;
+
 use super::inode_handle::InodeHandle;
 use crate::{
     fs::utils::{AccessMode, FallocMode, InodeMode, IoctlCmd, Metadata, SeekFrom, StatusFlags},
     net::socket::Socket,
     prelude::*,
     process::{signal::Pollable, Gid, Uid},
+    vm::vmo::Vmo,
 };
 
 /// The basic operations defined on a file
@@ -101,6 +104,14 @@ pub trait FileLike: Pollable + Send + Sync + Any {
     fn as_socket(&self) -> Option<&dyn Socket> {
         None
     }
+
+    /// Returns the VMO to map if the file is memory-mapped.
+    ///
+    /// Files backed by inodes are mapped through their page caches instead.
+    /// This is for the other files that still support memory mapping.
+    fn mmap_vmo(&self) -> Result<Vmo<Rights>> {
+        return_errno_with_message!(Errno::ENODEV, "the file cannot be memory-mapped");
+    }
 }
 
 impl dyn FileLike {
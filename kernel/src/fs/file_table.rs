@@ -1,8 +1,15 @@
 // SPDX-License-Identifier: MPL-2.0
 
-use core::sync::atomic::{AtomicU8, Ordering};
+use core::{
+    ptr,
+    sync::atomic::{AtomicU8, Ordering},
+};
 
 use aster_util::slot_vec::SlotVec;
+use ostd::{
+    sync::RcuOption,
+    task::{disable_preempt, DisabledPreemptGuard},
+};
 
 use super::{
     file_handle::FileLike,
@@ -24,13 +31,16 @@ pub type FileDesc = i32;
 
 pub struct FileTable {
     table: SlotVec<FileTableEntry>,
+    /// The files published for the lock-free lookups once the table is shared.
+    file_array: Arc<FileArray>,
     subject: Subject<FdEvents>,
 }
 
 impl FileTable {
-    pub const fn new() -> Self {
+    pub fn new() -> Self {
         Self {
             table: SlotVec::new(),
+            file_array: Arc::new(FileArray::new()),
             subject: Subject::new(),
         }
     }
@@ -59,6 +69,7 @@ impl FileTable {
         table.put(FileTableEntry::new(Arc::new(stderr), FdFlags::empty()));
         Self {
             table,
+            file_array: Arc::new(FileArray::new()),
             subject: Subject::new(),
         }
     }
@@ -96,12 +107,27 @@ impl FileTable {
         let min_free_fd = get_min_free_fd();
         let entry = FileTableEntry::new(file, flags);
         self.table.put_at(min_free_fd, entry);
+        self.publish_slot(min_free_fd);
         Ok(min_free_fd as FileDesc)
     }
 
     pub fn insert(&mut self, item: Arc<dyn FileLike>, flags: FdFlags) -> FileDesc {
         let entry = FileTableEntry::new(item, flags);
-        self.table.put(entry) as FileDesc
+        let fd = self.table.put(entry);
+        self.publish_slot(fd);
+        fd as FileDesc
+    }
+
+    /// Inserts all the `files` and returns their file descriptors.
+    pub fn insert_all(
+        &mut self,
+        files: impl IntoIterator<Item = Arc<dyn FileLike>>,
+        flags: FdFlags,
+    ) -> Vec<FileDesc> {
+        files
+            .into_iter()
+            .map(|file| self.insert(file, flags))
+            .collect()
     }
 
     pub fn insert_at(
@@ -112,6 +138,7 @@ impl FileTable {
     ) -> Option<Arc<dyn FileLike>> {
         let entry = FileTableEntry::new(item, flags);
         let entry = self.table.put_at(fd as usize, entry);
+        self.publish_slot(fd as usize);
         if entry.is_some() {
             let events = FdEvents::Close(fd);
             self.notify_fd_events(&events);
@@ -122,6 +149,7 @@ impl FileTable {
 
     pub fn close_file(&mut self, fd: FileDesc) -> Option<Arc<dyn FileLike>> {
         let removed_entry = self.table.remove(fd as usize)?;
+        self.publish_slot(fd as usize);
 
         let events = FdEvents::Close(fd);
         self.notify_fd_events(&events);
@@ -150,9 +178,20 @@ impl FileTable {
                 }
             })
             .collect();
+        if closed_fds.is_empty() {
+            return closed_files;
+        }
+
+        let removed_entries: Vec<FileTableEntry> = closed_fds
+            .iter()
+            .map(|fd| {
+                let entry = self.table.remove(*fd as usize).unwrap();
+                self.publish_slot(*fd as usize);
+                entry
+            })
+            .collect();
 
-        for fd in closed_fds {
-            let removed_entry = self.table.remove(fd as usize).unwrap();
+        for (fd, removed_entry) in closed_fds.into_iter().zip(removed_entries) {
             let events = FdEvents::Close(fd);
             self.notify_fd_events(&events);
             removed_entry.notify_fd_events(&events);
@@ -169,6 +208,27 @@ impl FileTable {
             .ok_or(Error::with_message(Errno::EBADF, "fd not exits"))
     }
 
+    /// Returns the files published for the lock-free lookups.
+    pub fn file_array(&self) -> &Arc<FileArray> {
+        &self.file_array
+    }
+
+    /// Publishes the files for the lock-free lookups.
+    ///
+    /// This must be called before the table is shared, since the lookups fall back to the
+    /// [`FileArray`] only if it is shared. While the table is not shared, the changes to it are
+    /// not published, which saves the cost when most processes are single-threaded.
+    pub fn publish_files(&mut self) {
+        if !self.file_array.is_published() {
+            self.file_array.publish_all(&self.table);
+        }
+    }
+
+    fn publish_slot(&self, fd: usize) {
+        self.file_array
+            .store(fd, self.table.get(fd).map(FileTableEntry::file));
+    }
+
     pub fn get_entry(&self, fd: FileDesc) -> Result<&FileTableEntry> {
         self.table
             .get(fd as usize)
@@ -210,11 +270,139 @@ impl Clone for FileTable {
     fn clone(&self) -> Self {
         Self {
             table: self.table.clone(),
+            file_array: Arc::new(FileArray::new()),
             subject: Subject::new(),
         }
     }
 }
 
+/// The files of a [`FileTable`] published with RCU.
+///
+/// It allows the files to be looked up without locking the file table, which
+/// is contended when the table is shared by many threads. Like `fdtable` in
+/// Linux, each file descriptor has a slot that is updated in place, and the
+/// slots are copied to a larger array only when the array grows. The slots
+/// only hold weak references to the files, so that the replaced ones, which
+/// are freed after the RCU grace period, never drop the files in the RCU
+/// callbacks.
+pub struct FileArray {
+    slots: RcuOption<Box<Vec<FileSlot>>>,
+}
+
+type FileSlot = RcuOption<Box<Weak<dyn FileLike>>>;
+
+impl FileArray {
+    /// The minimum number of slots, which is the same as `NR_OPEN_DEFAULT` in Linux.
+    const MIN_NR_SLOTS: usize = 64;
+
+    fn new() -> Self {
+        Self {
+            slots: RcuOption::new(None),
+        }
+    }
+
+    /// Gets the file of the file descriptor without any locks.
+    pub fn get_file(&self, fd: FileDesc) -> Result<Arc<dyn FileLike>> {
+        self.read_slots(|slots, guard| Self::lookup(slots, fd, guard))
+    }
+
+    /// Gets the files of all the file descriptors without any locks.
+    ///
+    /// The files are looked up in a single RCU read-side critical section.
+    pub fn get_files(&self, fds: &[FileDesc]) -> Result<Vec<Arc<dyn FileLike>>> {
+        self.read_slots(|slots, guard| {
+            fds.iter()
+                .map(|fd| Self::lookup(slots, *fd, guard))
+                .collect()
+        })
+    }
+
+    /// Calls `f` with the current slots in an RCU read-side critical section.
+    ///
+    /// The replaced slots are no longer updated after they are copied to a
+    /// larger array. So `f` is called again if the slots are replaced during
+    /// the call, like `__fget_files_rcu` in Linux.
+    fn read_slots<R>(&self, f: impl Fn(&[FileSlot], &DisabledPreemptGuard) -> R) -> R {
+        loop {
+            let guard = disable_preempt();
+            let Some(slots) = self.slots.read_with(&guard) else {
+                return f(&[], &guard);
+            };
+            let result = f(&slots, &guard);
+            if self
+                .slots
+                .read_with(&guard)
+                .is_some_and(|current| ptr::eq(&*current, &*slots))
+            {
+                return result;
+            }
+            // The files are dropped after the critical section ends.
+            drop(guard);
+            drop(result);
+        }
+    }
+
+    fn lookup(
+        slots: &[FileSlot],
+        fd: FileDesc,
+        guard: &DisabledPreemptGuard,
+    ) -> Result<Arc<dyn FileLike>> {
+        slots
+            .get(fd as usize)
+            .and_then(|slot| slot.read_with(guard)?.upgrade())
+            .ok_or(Error::with_message(Errno::EBADF, "fd not exits"))
+    }
+
+    fn is_published(&self) -> bool {
+        !self.slots.read().is_none()
+    }
+
+    /// Publishes all the files in `table`.
+    ///
+    /// The caller must serialize the calls by locking the file table.
+    fn publish_all(&self, table: &SlotVec<FileTableEntry>) {
+        let nr_slots = table
+            .slots_len()
+            .max(Self::MIN_NR_SLOTS)
+            .next_power_of_two();
+        let slots = (0..nr_slots)
+            .map(|idx| {
+                let file = table.get(idx).map(FileTableEntry::file);
+                RcuOption::new(file.map(|file| Box::new(Arc::downgrade(file))))
+            })
+            .collect();
+        self.slots.update(Some(Box::new(slots)));
+    }
+
+    /// Publishes the file of the file descriptor, if the files are published.
+    ///
+    /// The caller must serialize the calls by locking the file table.
+    fn store(&self, fd: usize, file: Option<&Arc<dyn FileLike>>) {
+        let new_file = file.map(|file| Box::new(Arc::downgrade(file)));
+
+        let guard = self.slots.read();
+        let Some(slots) = guard.get() else {
+            return;
+        };
+        if let Some(slot) = slots.get(fd) {
+            slot.update(new_file);
+            return;
+        }
+
+        // The array is full, so the slots are copied to a larger array.
+        let nr_slots = (fd + 1).next_power_of_two();
+        let mut new_slots: Vec<FileSlot> = Vec::with_capacity(nr_slots);
+        new_slots.extend(slots.iter().map(|slot| {
+            let file = slot.read().get().map(|file| Box::new(Weak::clone(&file)));
+            RcuOption::new(file)
+        }));
+        new_slots.resize_with(nr_slots, || RcuOption::new(None));
+        new_slots[fd] = RcuOption::new(new_file);
+        drop(guard);
+        self.slots.update(Some(Box::new(new_slots)));
+    }
+}
+
 impl Drop for FileTable {
     fn drop(&mut self) {
         // Closes all files first.
@@ -255,9 +443,9 @@ impl WithFileTable for FileTableRefMut<'_> {
 /// If the file table is not shared with another thread, this macro will be free of locks
 /// ([`RwArc::read`]) and free of reference counting ([`Arc::clone`]).
 ///
-/// If the file table is shared, the read lock is taken, the file is cloned, and then the read lock
-/// is released. Cloning and releasing the lock is necessary because we cannot hold such locks when
-/// operating on files, since many operations on files can block.
+/// If the file table is shared, the file is looked up in the [`FileArray`] without any locks and
+/// then cloned. Cloning is necessary because the file may be closed by another thread while we
+/// are operating on it.
 ///
 /// Note: This has to be a macro due to a limitation in the Rust borrow check implementation. Once
 /// <https://github.com/rust-lang/rust/issues/58910> is fixed, we can try to convert this macro to
@@ -276,6 +464,7 @@ macro_rules! get_file_fast {
         };
 
         let file_table: &mut FileTableRefMut<'_> = $file_table;
+        let file_array = file_table.file_array();
         let file_table: &mut RwArc<FileTable> = file_table.unwrap();
         let file_desc: FileDesc = $file_desc;
 
@@ -283,14 +472,33 @@ macro_rules! get_file_fast {
             // Fast path: The file table is not shared, we can get the file in a lockless way.
             Cow::Borrowed(inner.get_file(file_desc)?)
         } else {
-            // Slow path: The file table is shared, we need to hold the lock and clone the file.
-            Cow::Owned(file_table.read().get_file(file_desc)?.clone())
+            // Slow path: The file table is shared, we need to look up the published files and
+            // clone the file.
+            Cow::Owned(file_array.get_file(file_desc)?)
         }
     }};
 }
 
 pub(crate) use get_file_fast;
 
+/// Gets the files from multiple file descriptors as fast as possible.
+///
+/// This is the counterpart of [`get_file_fast`] for multiple file descriptors. The files are
+/// always cloned because they are usually kept after the lookup (e.g., passed with
+/// `SCM_RIGHTS`).
+pub fn get_files_fast(
+    file_table: &mut FileTableRefMut,
+    fds: &[FileDesc],
+) -> Result<Vec<Arc<dyn FileLike>>> {
+    let file_array = file_table.file_array();
+
+    if let Some(inner) = file_table.unwrap().get() {
+        fds.iter().map(|fd| inner.get_file(*fd).cloned()).collect()
+    } else {
+        file_array.get_files(fds)
+    }
+}
+
 #[derive(Copy, Clone, Debug)]
 pub enum FdEvents {
     Close(FileDesc),
@@ -28,11 +28,13 @@ impl InodeHandle<Rights> {
         } else {
             None
         };
+        let generated_contents = inode.generates_contents().then(|| Mutex::new(None));
 
         let inner = Arc::new(InodeHandle_ {
             dentry,
             file_io,
             offset: Mutex::new(0),
+            generated_contents,
             access_mode,
             status_flags: AtomicU32::new(status_flags.bits()),
         });
@@ -53,6 +55,17 @@ impl InodeHandle<Rights> {
         }
         self.0.readdir(visitor)
     }
+
+    pub fn cached_pages_at(
+        &self,
+        offset: usize,
+        max_len: usize,
+    ) -> Result<Option<Vec<(UFrame, Range<usize>)>>> {
+        if !self.1.contains(Rights::READ) {
+            return_errno_with_message!(Errno::EBADF, "file is not readable");
+        }
+        self.0.cached_pages_at(offset, max_len)
+    }
 }
 
 impl Clone for InodeHandle<Rights> {
@@ -7,10 +7,14 @@
 mod dyn_cap;
 mod static_cap;
 
-use core::sync::atomic::{AtomicU32, Ordering};
+use core::{
+    ops::Range,
+    sync::atomic::{AtomicU32, Ordering},
+};
 
 use aster_rights::Rights;
 use inherit_methods_macro::inherit_methods;
+use ostd::mm::UFrame;
 
 use crate::{
     events::IoEvents,
@@ -28,6 +32,7 @@ use crate::{
         signal::{PollHandle, Pollable},
         Gid, Uid,
     },
+    vm::vmo::CommitFlags,
 };
 
 #[derive(Debug)]
@@ -40,6 +45,11 @@ struct InodeHandle_ {
     /// `ioctl` will be provided by `file_io`, instead of `dentry`.
     file_io: Option<Arc<dyn FileIo>>,
     offset: Mutex<usize>,
+    /// The contents generated for this opened file. See [`Inode::generate_contents`].
+    ///
+    /// This is `None` if the inode does not generate its contents, so that the
+    /// reads of the other files do not take the lock.
+    generated_contents: Option<Mutex<Option<Vec<u8>>>>,
     access_mode: AccessMode,
     status_flags: AtomicU32,
 }
@@ -88,6 +98,10 @@ impl InodeHandle_ {
             todo!("support read_at for FileIo");
         }
 
+        if let Some(len) = self.read_generated_at(offset, writer)? {
+            return Ok(len);
+        }
+
         if self.status_flags().contains(StatusFlags::O_DIRECT) {
             self.dentry.inode().read_direct_at(offset, writer)
         } else {
@@ -95,6 +109,31 @@ impl InodeHandle_ {
         }
     }
 
+    /// Reads the contents generated for this opened file.
+    ///
+    /// This method returns `Ok(None)` if the inode does not generate its contents on the fly.
+    fn read_generated_at(&self, offset: usize, writer: &mut VmWriter) -> Result<Option<usize>> {
+        let Some(generated_contents) = &self.generated_contents else {
+            return Ok(None);
+        };
+        let mut generated_contents = generated_contents.lock();
+
+        if offset == 0 {
+            match self.dentry.inode().generate_contents() {
+                Some(contents) => *generated_contents = Some(contents?),
+                None => return Ok(None),
+            }
+        }
+        let Some(ref contents) = *generated_contents else {
+            return Ok(None);
+        };
+
+        let start = contents.len().min(offset);
+        let end = contents.len().min(offset.saturating_add(writer.avail()));
+        writer.write_fallible(&mut (&contents[start..end]).into())?;
+        Ok(Some(end - start))
+    }
+
     pub fn write_at(&self, mut offset: usize, reader: &mut VmReader) -> Result<usize> {
         if let Some(ref file_io) = self.file_io {
             todo!("support write_at for FileIo");
@@ -113,6 +152,47 @@ impl InodeHandle_ {
         }
     }
 
+    /// Returns the pages in the page cache that hold the data at `offset`, no
+    /// more than `max_len` bytes in total.
+    ///
+    /// The data can then be moved out of the file by referencing the pages
+    /// instead of copying them. This method returns `Ok(None)` if the file is
+    /// not read through the page cache.
+    pub fn cached_pages_at(
+        &self,
+        offset: usize,
+        max_len: usize,
+    ) -> Result<Option<Vec<(UFrame, Range<usize>)>>> {
+        if self.file_io.is_some() || self.status_flags().contains(StatusFlags::O_DIRECT) {
+            return Ok(None);
+        }
+
+        let inode = self.dentry.inode();
+        if inode.type_() != InodeType::File {
+            return Ok(None);
+        }
+        let Some(page_cache) = inode.page_cache() else {
+            return Ok(None);
+        };
+
+        let end = inode.size().min(offset.saturating_add(max_len));
+        let mut pages = Vec::new();
+        let mut pos = offset;
+        while pos < end {
+            let frame = match page_cache.commit_on(pos / PAGE_SIZE, CommitFlags::empty()) {
+                Ok(frame) => frame,
+                Err(err) if pages.is_empty() => return Err(err),
+                Err(_) => break,
+            };
+            let start = pos % PAGE_SIZE;
+            let len = (PAGE_SIZE - start).min(end - pos);
+            pages.push((frame, start..start + len));
+            pos += len;
+        }
+
+        Ok(Some(pages))
+    }
+
     pub fn seek(&self, pos: SeekFrom) -> Result<usize> {
         let mut offset = self.offset.lock();
         let new_offset: isize = match pos {
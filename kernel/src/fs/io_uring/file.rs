@@ -0,0 +1,383 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use core::{
+    sync::atomic::{AtomicBool, AtomicUsize, Ordering},
+    time::Duration,
+};
+
+use aster_rights::Rights;
+use ostd::sync::WaitQueue;
+
+use super::{op::Op, ring::Rings, IoCqringOffsets, IoSqringOffsets, IoUringCqe, IoUringSetupFlags};
+use crate::{
+    events::{IoEvents, Observer},
+    fs::{
+        file_handle::FileLike,
+        utils::{InodeMode, InodeType, Metadata},
+    },
+    prelude::*,
+    process::{
+        signal::{PollHandle, Pollable, Pollee},
+        Gid, Uid,
+    },
+    thread::Thread,
+    time::{clocks::RealTimeClock, wait::ManagedTimeout},
+    vm::vmo::Vmo,
+};
+
+/// An io_uring instance.
+pub struct IoUringFile {
+    rings: Rings,
+    flags: IoUringSetupFlags,
+    /// The SQ head, i.e., the next SQE to consume.
+    sq_head: Mutex<u32>,
+    cq: Mutex<CqState>,
+    /// The operations that are waiting for their files to be ready.
+    pending_ops: Mutex<Vec<PendingOp>>,
+    notifier: Arc<ReadyNotifier>,
+}
+
+struct CqState {
+    /// The CQ tail, i.e., the next CQE to post.
+    tail: u32,
+    /// The CQEs that cannot be posted because the CQ ring is full.
+    ///
+    /// They are posted once the user space reaps some CQEs. At most as many
+    /// CQEs as the CQ ring can hold are kept. The others are dropped and
+    /// counted in the CQ ring, like the CQEs that Linux fails to allocate.
+    overflow: VecDeque<IoUringCqe>,
+}
+
+struct PendingOp {
+    op: Op,
+    observer: Arc<OpObserver>,
+    // Keeps the observer registered on the file.
+    _poll_handle: PollHandle,
+}
+
+/// Notifies the waiters when some pending operations may make progress.
+struct ReadyNotifier {
+    nr_ready: AtomicUsize,
+    /// The number of CQEs ever completed, which tells the waiters that
+    /// another thread has completed some operations.
+    nr_posted: AtomicUsize,
+    wait_queue: WaitQueue,
+    pollee: Pollee,
+}
+
+/// Observes the file that a pending operation operates on.
+struct OpObserver {
+    is_ready: AtomicBool,
+    notifier: Arc<ReadyNotifier>,
+}
+
+impl Observer<IoEvents> for OpObserver {
+    fn on_events(&self, _events: &IoEvents) {
+        if self.is_ready.swap(true, Ordering::AcqRel) {
+            return;
+        }
+
+        self.notifier.nr_ready.fetch_add(1, Ordering::Release);
+        self.notifier.wait_queue.wake_all();
+        // The operation will complete in the next `io_uring_enter`, so the
+        // ring is reported as readable to make the user space enter the kernel.
+        self.notifier.pollee.notify(IoEvents::IN);
+    }
+}
+
+impl IoUringFile {
+    /// Creates an io_uring instance with the given numbers of SQEs and CQEs.
+    ///
+    /// Both numbers must be powers of two.
+    pub fn new(sq_entries: u32, cq_entries: u32, flags: IoUringSetupFlags) -> Result<Self> {
+        Ok(Self {
+            rings: Rings::new(sq_entries, cq_entries)?,
+            flags,
+            sq_head: Mutex::new(0),
+            cq: Mutex::new(CqState {
+                tail: 0,
+                overflow: VecDeque::new(),
+            }),
+            pending_ops: Mutex::new(Vec::new()),
+            notifier: Arc::new(ReadyNotifier {
+                nr_ready: AtomicUsize::new(0),
+                nr_posted: AtomicUsize::new(0),
+                wait_queue: WaitQueue::new(),
+                pollee: Pollee::new(),
+            }),
+        })
+    }
+
+    pub fn sq_offsets(&self) -> IoSqringOffsets {
+        self.rings.sq_offsets()
+    }
+
+    pub fn cq_offsets(&self) -> IoCqringOffsets {
+        self.rings.cq_offsets()
+    }
+
+    /// Consumes up to `to_submit` SQEs and issues the operations.
+    ///
+    /// Returns the number of consumed SQEs. Like Linux, this method fails with
+    /// `EBUSY` if some CQEs still overflow the CQ ring, so that the user space
+    /// reaps the CQEs before submitting more operations.
+    pub fn submit(&self, to_submit: u32, ctx: &Context) -> Result<u32> {
+        {
+            let mut cq = self.cq.lock();
+            self.flush_overflow(&mut cq)?;
+            if !cq.overflow.is_empty() {
+                return_errno_with_message!(Errno::EBUSY, "the CQ ring overflows");
+            }
+        }
+
+        let sqes = {
+            let mut sq_head = self.sq_head.lock();
+            let nr_avail = self.rings.sq_tail()?.wrapping_sub(*sq_head);
+            let nr_submit = to_submit.min(nr_avail);
+
+            let mut sqes = Vec::with_capacity(nr_submit as usize);
+            for _ in 0..nr_submit {
+                match self.rings.read_sqe(*sq_head)? {
+                    Some(sqe) => sqes.push(sqe),
+                    None => self.rings.add_sq_dropped()?,
+                }
+                *sq_head = sq_head.wrapping_add(1);
+            }
+            self.rings.set_sq_head(*sq_head)?;
+
+            sqes
+        };
+
+        let nr_submitted = sqes.len() as u32;
+        for sqe in sqes {
+            let op = match Op::new(sqe, ctx) {
+                Ok(op) => op,
+                Err(err) => {
+                    self.complete(sqe.user_data, -(err.error() as i32))?;
+                    continue;
+                }
+            };
+            if let Some(res) = op.try_execute(ctx) {
+                self.complete(op.user_data(), res)?;
+                continue;
+            }
+            self.add_pending(op);
+        }
+
+        Ok(nr_submitted)
+    }
+
+    /// Waits until there are at least `min_complete` CQEs to reap.
+    ///
+    /// The pending operations whose files become ready are completed in the
+    /// caller's context if they are submitted in the caller's address space.
+    /// With `IORING_SETUP_IOPOLL`, the pending operations are busy-polled
+    /// instead of waiting for the notifications.
+    pub fn wait(&self, min_complete: u32, timeout: Option<&Duration>, ctx: &Context) -> Result<()> {
+        let mut timeout = timeout.map(|timeout| ManagedTimeout::new(*timeout));
+        if let Some(timeout) = timeout.as_mut() {
+            timeout.freeze();
+        }
+
+        let is_iopoll = self.flags.contains(IoUringSetupFlags::IORING_SETUP_IOPOLL);
+
+        loop {
+            let nr_posted = self.notifier.nr_posted.load(Ordering::Acquire);
+            let nr_left = self.reap_pending(is_iopoll, ctx)?;
+            if self.nr_completed()? >= min_complete {
+                return Ok(());
+            }
+
+            if is_iopoll {
+                if timeout.as_ref().is_some_and(ManagedTimeout::is_expired) {
+                    return_errno_with_message!(Errno::ETIME, "the time limit is reached");
+                }
+                if ctx.posix_thread.has_pending() {
+                    return_errno_with_message!(Errno::EINTR, "the wait is interrupted by a signal");
+                }
+                Thread::yield_now();
+                continue;
+            }
+
+            self.notifier.wait_queue.pause_until_or_timeout(
+                || {
+                    (self.notifier.nr_ready.load(Ordering::Acquire) > nr_left
+                        || self.notifier.nr_posted.load(Ordering::Acquire) != nr_posted)
+                        .then_some(())
+                },
+                timeout.clone(),
+            )?;
+        }
+    }
+
+    fn add_pending(&self, op: Op) {
+        let observer = Arc::new(OpObserver {
+            is_ready: AtomicBool::new(false),
+            notifier: self.notifier.clone(),
+        });
+        let mut poll_handle = PollHandle::new(Arc::downgrade(&observer) as _);
+
+        // The file may become ready after the operation is tried, so check
+        // the events again after registering the observer.
+        let file = op.file().unwrap();
+        let events = file.poll(op.events(), Some(&mut poll_handle));
+        if !events.is_empty() {
+            observer.on_events(&events);
+        }
+
+        self.pending_ops.lock().push(PendingOp {
+            op,
+            observer,
+            _poll_handle: poll_handle,
+        });
+    }
+
+    /// Retries the pending operations that are ready, or all of them if
+    /// `is_forced` is true.
+    ///
+    /// The operations submitted in other address spaces are left for the
+    /// threads there. Returns the number of such operations that are ready.
+    fn reap_pending(&self, is_forced: bool, ctx: &Context) -> Result<usize> {
+        if !is_forced && self.notifier.nr_ready.load(Ordering::Acquire) == 0 {
+            return Ok(0);
+        }
+
+        let pending_ops = core::mem::take(&mut *self.pending_ops.lock());
+        let mut still_pending = Vec::new();
+        let mut nr_left = 0;
+
+        for pending_op in pending_ops {
+            if !pending_op.op.is_in_address_space(ctx) {
+                if pending_op.observer.is_ready.load(Ordering::Acquire) {
+                    nr_left += 1;
+                }
+                still_pending.push(pending_op);
+                continue;
+            }
+
+            // Clear the state before retrying, so the events arriving during
+            // the retry will make the operation be retried again.
+            let is_ready = pending_op.observer.is_ready.swap(false, Ordering::AcqRel);
+            if is_ready {
+                self.notifier.nr_ready.fetch_sub(1, Ordering::Release);
+            }
+
+            if !is_ready && !is_forced {
+                still_pending.push(pending_op);
+                continue;
+            }
+
+            match pending_op.op.try_execute(ctx) {
+                Some(res) => self.complete(pending_op.op.user_data(), res)?,
+                None => still_pending.push(pending_op),
+            }
+        }
+
+        self.pending_ops.lock().extend(still_pending);
+        Ok(nr_left)
+    }
+
+    /// Posts a CQE for the operation identified by `user_data`.
+    fn complete(&self, user_data: u64, res: i32) -> Result<()> {
+        let cqe = IoUringCqe {
+            user_data,
+            res,
+            flags: 0,
+        };
+
+        let mut cq = self.cq.lock();
+        self.flush_overflow(&mut cq)?;
+        if !cq.overflow.is_empty() || !self.rings.post_cqe(cq.tail, &cqe)? {
+            if cq.overflow.len() < self.rings.cq_entries() as usize {
+                cq.overflow.push_back(cqe);
+            } else {
+                self.rings.add_cq_overflow()?;
+            }
+            self.rings.set_cq_overflow(true)?;
+        } else {
+            cq.tail = cq.tail.wrapping_add(1);
+            self.rings.set_cq_tail(cq.tail)?;
+        }
+        drop(cq);
+
+        // A concurrent waiter may be waiting for this CQE.
+        self.notifier.nr_posted.fetch_add(1, Ordering::Release);
+        self.notifier.wait_queue.wake_all();
+        self.notifier.pollee.notify(IoEvents::IN);
+        Ok(())
+    }
+
+    /// Posts the overflowed CQEs as long as the CQ ring has space.
+    fn flush_overflow(&self, cq: &mut CqState) -> Result<()> {
+        if cq.overflow.is_empty() {
+            return Ok(());
+        }
+
+        while let Some(cqe) = cq.overflow.front() {
+            if !self.rings.post_cqe(cq.tail, cqe)? {
+                break;
+            }
+            cq.overflow.pop_front();
+            cq.tail = cq.tail.wrapping_add(1);
+        }
+        self.rings.set_cq_tail(cq.tail)?;
+        self.rings.set_cq_overflow(!cq.overflow.is_empty())
+    }
+
+    /// Returns the number of CQEs that are completed but not yet reaped.
+    fn nr_completed(&self) -> Result<u32> {
+        let mut cq = self.cq.lock();
+        self.flush_overflow(&mut cq)?;
+        Ok(self.rings.cq_ready(cq.tail)? + cq.overflow.len() as u32)
+    }
+
+    fn check_io_events(&self) -> IoEvents {
+        let mut events = IoEvents::OUT;
+
+        if self.notifier.nr_ready.load(Ordering::Acquire) > 0
+            || self
+                .nr_completed()
+                .is_ok_and(|nr_completed| nr_completed > 0)
+        {
+            events |= IoEvents::IN;
+        }
+
+        events
+    }
+}
+
+impl Pollable for IoUringFile {
+    fn poll(&self, mask: IoEvents, poller: Option<&mut PollHandle>) -> IoEvents {
+        self.notifier
+            .pollee
+            .poll_with(mask, poller, || self.check_io_events())
+    }
+}
+
+impl FileLike for IoUringFile {
+    fn metadata(&self) -> Metadata {
+        // This is a dummy implementation.
+        // TODO: Add "anonymous inode fs" and link `IoUringFile` to it.
+        let now = RealTimeClock::get().read_time();
+        Metadata {
+            dev: 0,
+            ino: 0,
+            size: 0,
+            blk_size: 0,
+            blocks: 0,
+            atime: now,
+            mtime: now,
+            ctime: now,
+            type_: InodeType::File,
+            mode: InodeMode::from_bits_truncate(0o600),
+            nlinks: 1,
+            uid: Uid::new_root(),
+            gid: Gid::new_root(),
+            rdev: 0,
+        }
+    }
+
+    fn mmap_vmo(&self) -> Result<Vmo<Rights>> {
+        self.rings.vmo().dup()
+    }
+}
@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! The io_uring asynchronous I/O interface.
+//!
+//! An io_uring instance consists of a submission queue (SQ) and a completion
+//! queue (CQ), both of which are ring buffers shared between the kernel and
+//! the user space. The user space fills submission queue entries (SQEs) and
+//! submits them in batches with a single `io_uring_enter`. The results are
+//! posted as completion queue entries (CQEs), which the user space reaps
+//! without entering the kernel.
+//!
+//! Operations on files that are not ready (e.g., to read an empty socket) are
+//! not blocking the submitter. Instead, an observer is registered on the file
+//! and the operation is retried when the file reports the events.
+//!
+//! The memory layout of the rings and the entries is compatible with Linux.
+//! See <https://man7.org/linux/man-pages/man7/io_uring.7.html>.
+
+use crate::prelude::*;
+
+mod file;
+mod op;
+mod ring;
+
+pub use file::IoUringFile;
+
+/// The maximum number of SQEs.
+pub const IORING_MAX_ENTRIES: u32 = 32768;
+/// The maximum number of CQEs.
+pub const IORING_MAX_CQ_ENTRIES: u32 = 2 * IORING_MAX_ENTRIES;
+
+/// The `mmap` offset of the SQ ring.
+const IORING_OFF_SQ_RING: usize = 0;
+/// The `mmap` offset of the CQ ring.
+const IORING_OFF_CQ_RING: usize = 0x8000000;
+/// The `mmap` offset of the SQE array.
+const IORING_OFF_SQES: usize = 0x10000000;
+
+bitflags! {
+    /// The flags of `io_uring_setup`.
+    pub struct IoUringSetupFlags: u32 {
+        /// Busy-polls for completions instead of waiting for notifications.
+        const IORING_SETUP_IOPOLL = 1 << 0;
+        /// Polls the SQ with a kernel thread.
+        const IORING_SETUP_SQPOLL = 1 << 1;
+        /// Binds the SQ polling kernel thread to a CPU.
+        const IORING_SETUP_SQ_AFF = 1 << 2;
+        /// Uses the CQ size specified in the parameters.
+        const IORING_SETUP_CQSIZE = 1 << 3;
+        /// Clamps the sizes to the maximum values instead of failing.
+        const IORING_SETUP_CLAMP  = 1 << 4;
+    }
+}
+
+bitflags! {
+    /// The flags of `io_uring_enter`.
+    pub struct IoUringEnterFlags: u32 {
+        /// Waits for the specified number of completions.
+        const IORING_ENTER_GETEVENTS = 1 << 0;
+        /// Wakes up the SQ polling kernel thread.
+        const IORING_ENTER_SQ_WAKEUP = 1 << 1;
+        /// Waits for SQ space to be available.
+        const IORING_ENTER_SQ_WAIT   = 1 << 2;
+        /// Passes the extended argument, [`IoUringGeteventsArg`].
+        const IORING_ENTER_EXT_ARG   = 1 << 3;
+    }
+}
+
+bitflags! {
+    /// The features reported by `io_uring_setup`.
+    pub struct IoUringFeatures: u32 {
+        /// CQEs are never dropped if the CQ ring is full.
+        const IORING_FEAT_NODROP       = 1 << 1;
+        /// An offset of `-1` refers to the current file position.
+        const IORING_FEAT_RW_CUR_POS   = 1 << 3;
+        /// `io_uring_enter` accepts [`IoUringGeteventsArg`].
+        const IORING_FEAT_EXT_ARG      = 1 << 8;
+    }
+}
+
+/// The parameters of `io_uring_setup`.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Pod)]
+pub struct IoUringParams {
+    pub sq_entries: u32,
+    pub cq_entries: u32,
+    pub flags: u32,
+    pub sq_thread_cpu: u32,
+    pub sq_thread_idle: u32,
+    pub features: u32,
+    pub wq_fd: u32,
+    pub resv: [u32; 3],
+    pub sq_off: IoSqringOffsets,
+    pub cq_off: IoCqringOffsets,
+}
+
+/// The offsets of the fields in the SQ ring.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Pod)]
+pub struct IoSqringOffsets {
+    pub head: u32,
+    pub tail: u32,
+    pub ring_mask: u32,
+    pub ring_entries: u32,
+    pub flags: u32,
+    pub dropped: u32,
+    pub array: u32,
+    pub resv1: u32,
+    pub user_addr: u64,
+}
+
+/// The offsets of the fields in the CQ ring.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Pod)]
+pub struct IoCqringOffsets {
+    pub head: u32,
+    pub tail: u32,
+    pub ring_mask: u32,
+    pub ring_entries: u32,
+    pub overflow: u32,
+    pub cqes: u32,
+    pub flags: u32,
+    pub resv1: u32,
+    pub user_addr: u64,
+}
+
+/// The extended argument of `io_uring_enter`.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Pod)]
+pub struct IoUringGeteventsArg {
+    pub sigmask: u64,
+    pub sigmask_sz: u32,
+    pub pad: u32,
+    pub ts: u64,
+}
+
+/// A submission queue entry.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Pod)]
+struct IoUringSqe {
+    opcode: u8,
+    flags: u8,
+    ioprio: u16,
+    fd: i32,
+    off: u64,
+    addr: u64,
+    len: u32,
+    op_flags: u32,
+    user_data: u64,
+    buf_index: u16,
+    personality: u16,
+    splice_fd_in: i32,
+    addr3: u64,
+    __pad2: u64,
+}
+
+/// A completion queue entry.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Pod)]
+struct IoUringCqe {
+    user_data: u64,
+    res: i32,
+    flags: u32,
+}
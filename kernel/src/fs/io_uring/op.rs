@@ -0,0 +1,269 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! The operations that can be submitted to an io_uring instance.
+
+use aster_rights::Full;
+
+use super::IoUringSqe;
+use crate::{
+    events::IoEvents,
+    fs::file_handle::FileLike,
+    net::socket::{MessageHeader, SendRecvFlags},
+    prelude::*,
+    util::{VmReaderArray, VmWriterArray},
+    vm::vmar::Vmar,
+};
+
+const IORING_OP_NOP: u8 = 0;
+const IORING_OP_READV: u8 = 1;
+const IORING_OP_WRITEV: u8 = 2;
+const IORING_OP_FSYNC: u8 = 3;
+const IORING_OP_POLL_ADD: u8 = 6;
+const IORING_OP_READ: u8 = 22;
+const IORING_OP_WRITE: u8 = 23;
+const IORING_OP_SEND: u8 = 26;
+const IORING_OP_RECV: u8 = 27;
+
+/// The flag of `IORING_OP_FSYNC` to only sync the data.
+const IORING_FSYNC_DATASYNC: u32 = 1 << 0;
+
+/// The flag of SQEs to always issue the operation asynchronously.
+///
+/// Operations are always issued without blocking the submitter, so this flag
+/// is accepted and has no extra effect.
+const IOSQE_ASYNC: u8 = 1 << 4;
+
+/// The offset of reads and writes that refers to the current file position.
+const OFFSET_CUR_POS: u64 = u64::MAX;
+
+/// An operation submitted in an SQE.
+pub(super) struct Op {
+    sqe: IoUringSqe,
+    file: Option<Arc<dyn FileLike>>,
+    /// The root VMAR of the submitter if the operation accesses user buffers.
+    ///
+    /// The buffer addresses are only meaningful in the submitter's address
+    /// space, so a pending operation can only be retried by the threads that
+    /// share the address space. This reference also keeps it alive.
+    user_vmar: Option<Vmar<Full>>,
+}
+
+impl Op {
+    /// Parses the SQE and looks up the file that it operates on.
+    pub(super) fn new(sqe: IoUringSqe, ctx: &Context) -> Result<Self> {
+        if sqe.flags & !IOSQE_ASYNC != 0 {
+            return_errno_with_message!(Errno::EINVAL, "the SQE flags are not supported");
+        }
+
+        let file = match sqe.opcode {
+            IORING_OP_NOP => None,
+            IORING_OP_READV | IORING_OP_WRITEV | IORING_OP_FSYNC | IORING_OP_POLL_ADD
+            | IORING_OP_READ | IORING_OP_WRITE | IORING_OP_SEND | IORING_OP_RECV => {
+                let file_table = ctx.thread_local.borrow_file_table();
+                let file = file_table.unwrap().read().get_file(sqe.fd)?.clone();
+                Some(file)
+            }
+            _ => return_errno_with_message!(Errno::EINVAL, "the opcode is not supported"),
+        };
+
+        if sqe.opcode == IORING_OP_POLL_ADD {
+            // Multi-shot polls (the flags in `len`) are not supported.
+            if sqe.len != 0 {
+                return_errno_with_message!(Errno::EINVAL, "the poll flags are not supported");
+            }
+            // A mask without any supported events is rejected, like other invalid arguments.
+            if IoEvents::from_bits_truncate(sqe.op_flags).is_empty() {
+                return_errno_with_message!(Errno::EINVAL, "no supported poll events are given");
+            }
+        }
+
+        let user_vmar = match sqe.opcode {
+            IORING_OP_READV | IORING_OP_WRITEV | IORING_OP_READ | IORING_OP_WRITE
+            | IORING_OP_SEND | IORING_OP_RECV => Some(ctx.user_space().root_vmar().dup()?),
+            _ => None,
+        };
+
+        Ok(Self {
+            sqe,
+            file,
+            user_vmar,
+        })
+    }
+
+    /// Returns the data that identifies the operation in its CQE.
+    pub(super) fn user_data(&self) -> u64 {
+        self.sqe.user_data
+    }
+
+    /// Returns the file that the operation is pending on.
+    pub(super) fn file(&self) -> Option<&Arc<dyn FileLike>> {
+        self.file.as_ref()
+    }
+
+    /// Returns whether the operation can be executed in the address space of
+    /// the current thread.
+    pub(super) fn is_in_address_space(&self, ctx: &Context) -> bool {
+        let Some(user_vmar) = self.user_vmar.as_ref() else {
+            return true;
+        };
+        ctx.thread_local.root_vmar().borrow().as_ref() == Some(user_vmar)
+    }
+
+    /// Returns the events that the operation waits for before it can proceed.
+    pub(super) fn events(&self) -> IoEvents {
+        match self.sqe.opcode {
+            IORING_OP_READV | IORING_OP_READ | IORING_OP_RECV => IoEvents::IN,
+            IORING_OP_WRITEV | IORING_OP_WRITE | IORING_OP_SEND => IoEvents::OUT,
+            IORING_OP_POLL_ADD => IoEvents::from_bits_truncate(self.sqe.op_flags),
+            _ => IoEvents::empty(),
+        }
+    }
+
+    /// Tries to execute the operation without blocking.
+    ///
+    /// Returns `None` if the file is not ready. Otherwise, returns the result
+    /// to post in the CQE.
+    pub(super) fn try_execute(&self, ctx: &Context) -> Option<i32> {
+        debug_assert!(self.is_in_address_space(ctx));
+
+        let Some(file) = self.file.as_ref() else {
+            return Some(0);
+        };
+
+        let events = self.events();
+        if self.sqe.opcode == IORING_OP_POLL_ADD {
+            // Regular files are always ready, so the polls on them complete
+            // at once with their current events.
+            let mask = events | IoEvents::ALWAYS_POLL;
+            let revents = file.poll(mask, None) & mask;
+            return (!revents.is_empty()).then_some(revents.bits() as i32);
+        }
+
+        // Regular files are always ready. The operations on them complete
+        // in the submitter's context.
+        let is_inode = file.as_inode_or_err().is_ok();
+
+        if !is_inode && !events.is_empty() {
+            let revents = file.poll(events | IoEvents::ALWAYS_POLL, None);
+            if revents.is_empty() {
+                return None;
+            }
+        }
+
+        match self.execute(file.as_ref(), ctx) {
+            Ok(len) => Some(len as i32),
+            // The file is not ready despite the events (e.g., when another
+            // reader has consumed the data), so wait for the next events.
+            Err(err) if err.error() == Errno::EAGAIN && !is_inode => None,
+            Err(err) => Some(-(err.error() as i32)),
+        }
+    }
+
+    fn execute(&self, file: &dyn FileLike, ctx: &Context) -> Result<usize> {
+        let sqe = &self.sqe;
+        let addr = sqe.addr as Vaddr;
+        let len = sqe.len as usize;
+        let user_space = ctx.user_space();
+
+        match sqe.opcode {
+            IORING_OP_READ => {
+                let mut writer = user_space.writer(addr, len)?;
+                match self.offset()? {
+                    Some(offset) => file.read_at(offset, &mut writer),
+                    None => file.read(&mut writer),
+                }
+            }
+            IORING_OP_WRITE => {
+                let mut reader = user_space.reader(addr, len)?;
+                match self.offset()? {
+                    Some(offset) => file.write_at(offset, &mut reader),
+                    None => file.write(&mut reader),
+                }
+            }
+            IORING_OP_READV => {
+                let mut writer_array = VmWriterArray::from_user_io_vecs(&user_space, addr, len)?;
+                let mut offset = self.offset()?;
+                let mut total_len = 0;
+                for writer in writer_array.writers_mut() {
+                    if !writer.has_avail() {
+                        continue;
+                    }
+                    let read_len = match offset {
+                        Some(offset) => file.read_at(offset, writer)?,
+                        None => file.read(writer)?,
+                    };
+                    total_len += read_len;
+                    offset = offset.map(|offset| offset + read_len);
+                    if read_len == 0 || writer.has_avail() {
+                        break;
+                    }
+                }
+                Ok(total_len)
+            }
+            IORING_OP_WRITEV => {
+                let mut reader_array = VmReaderArray::from_user_io_vecs(&user_space, addr, len)?;
+                let mut offset = self.offset()?;
+                let mut total_len = 0;
+                for reader in reader_array.readers_mut() {
+                    if !reader.has_remain() {
+                        continue;
+                    }
+                    let write_len = match offset {
+                        Some(offset) => file.write_at(offset, reader)?,
+                        None => file.write(reader)?,
+                    };
+                    total_len += write_len;
+                    offset = offset.map(|offset| offset + write_len);
+                    if write_len == 0 || reader.has_remain() {
+                        break;
+                    }
+                }
+                Ok(total_len)
+            }
+            IORING_OP_FSYNC => {
+                let dentry = file.as_inode_or_err()?.dentry();
+                if sqe.op_flags & IORING_FSYNC_DATASYNC != 0 {
+                    dentry.sync_data()?;
+                } else {
+                    dentry.sync_all()?;
+                }
+                Ok(0)
+            }
+            IORING_OP_SEND => {
+                let socket = file.as_socket_or_err()?;
+                let flags = self.send_recv_flags();
+                let mut reader = user_space.reader(addr, len)?;
+                socket.sendmsg(&mut reader, MessageHeader::new(None, None), flags)
+            }
+            IORING_OP_RECV => {
+                let socket = file.as_socket_or_err()?;
+                let flags = self.send_recv_flags();
+                let mut writer = user_space.writer(addr, len)?;
+                socket
+                    .recvmsg(&mut writer, flags)
+                    .map(|(recv_len, _)| recv_len)
+            }
+            // `IORING_OP_POLL_ADD` completes in `try_execute` without executing anything.
+            _ => return_errno_with_message!(Errno::EINVAL, "the opcode cannot be executed"),
+        }
+    }
+
+    /// Returns the offset of reads and writes, or `None` for the current file position.
+    fn offset(&self) -> Result<Option<usize>> {
+        let offset = self.sqe.off;
+        if offset == OFFSET_CUR_POS {
+            return Ok(None);
+        }
+        if offset > isize::MAX as u64 {
+            return_errno_with_message!(Errno::EINVAL, "the offset is too large");
+        }
+        Ok(Some(offset as usize))
+    }
+
+    /// Returns the flags of sends and receives.
+    ///
+    /// The operations never block the submitter, so `MSG_DONTWAIT` is always set.
+    fn send_recv_flags(&self) -> SendRecvFlags {
+        SendRecvFlags::from_bits_truncate(self.sqe.op_flags as i32) | SendRecvFlags::MSG_DONTWAIT
+    }
+}
@@ -0,0 +1,216 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! The SQ and CQ rings shared with the user space.
+
+use core::sync::atomic::{fence, Ordering};
+
+use align_ext::AlignExt;
+use aster_rights::Rights;
+use ostd::mm::VmIo;
+
+use super::{
+    IoCqringOffsets, IoSqringOffsets, IoUringCqe, IoUringSqe, IORING_OFF_CQ_RING, IORING_OFF_SQES,
+    IORING_OFF_SQ_RING,
+};
+use crate::{
+    prelude::*,
+    vm::vmo::{Vmo, VmoOptions},
+};
+
+// The layout of the SQ ring. The head and the tail are placed in different
+// cache lines, since they are updated by the kernel and the user space
+// respectively.
+const SQ_HEAD: usize = 0;
+const SQ_TAIL: usize = 64;
+const SQ_RING_MASK: usize = 128;
+const SQ_RING_ENTRIES: usize = 132;
+const SQ_FLAGS: usize = 136;
+const SQ_DROPPED: usize = 140;
+const SQ_ARRAY: usize = 192;
+
+// The layout of the CQ ring.
+const CQ_HEAD: usize = 0;
+const CQ_TAIL: usize = 64;
+const CQ_RING_MASK: usize = 128;
+const CQ_RING_ENTRIES: usize = 132;
+const CQ_OVERFLOW: usize = 136;
+const CQ_FLAGS: usize = 140;
+const CQ_CQES: usize = 192;
+
+/// The flag in the SQ ring indicating that CQEs overflow the CQ ring.
+const IORING_SQ_CQ_OVERFLOW: u32 = 1 << 1;
+
+/// The rings of an io_uring instance.
+///
+/// The SQ ring, the CQ ring and the SQE array live in a single VMO at the
+/// `mmap` offsets defined by Linux. The VMO is sparse, so the gaps between
+/// them occupy no memory.
+pub(super) struct Rings {
+    vmo: Vmo<Rights>,
+    sq_entries: u32,
+    cq_entries: u32,
+}
+
+impl Rings {
+    pub(super) fn new(sq_entries: u32, cq_entries: u32) -> Result<Self> {
+        debug_assert!(sq_entries.is_power_of_two() && cq_entries.is_power_of_two());
+
+        let sq_ring_size = SQ_ARRAY + sq_entries as usize * size_of::<u32>();
+        let cq_ring_size = CQ_CQES + cq_entries as usize * size_of::<IoUringCqe>();
+        debug_assert!(IORING_OFF_SQ_RING + sq_ring_size <= IORING_OFF_CQ_RING);
+        debug_assert!(IORING_OFF_CQ_RING + cq_ring_size <= IORING_OFF_SQES);
+        let sqes_size = sq_entries as usize * size_of::<IoUringSqe>();
+
+        let vmo =
+            VmoOptions::<Rights>::new((IORING_OFF_SQES + sqes_size).align_up(PAGE_SIZE)).alloc()?;
+
+        let rings = Self {
+            vmo,
+            sq_entries,
+            cq_entries,
+        };
+        rings.write_sq(SQ_RING_MASK, sq_entries - 1)?;
+        rings.write_sq(SQ_RING_ENTRIES, sq_entries)?;
+        rings.write_cq(CQ_RING_MASK, cq_entries - 1)?;
+        rings.write_cq(CQ_RING_ENTRIES, cq_entries)?;
+
+        Ok(rings)
+    }
+
+    pub(super) fn vmo(&self) -> &Vmo<Rights> {
+        &self.vmo
+    }
+
+    pub(super) fn sq_offsets(&self) -> IoSqringOffsets {
+        IoSqringOffsets {
+            head: SQ_HEAD as u32,
+            tail: SQ_TAIL as u32,
+            ring_mask: SQ_RING_MASK as u32,
+            ring_entries: SQ_RING_ENTRIES as u32,
+            flags: SQ_FLAGS as u32,
+            dropped: SQ_DROPPED as u32,
+            array: SQ_ARRAY as u32,
+            resv1: 0,
+            user_addr: 0,
+        }
+    }
+
+    pub(super) fn cq_offsets(&self) -> IoCqringOffsets {
+        IoCqringOffsets {
+            head: CQ_HEAD as u32,
+            tail: CQ_TAIL as u32,
+            ring_mask: CQ_RING_MASK as u32,
+            ring_entries: CQ_RING_ENTRIES as u32,
+            overflow: CQ_OVERFLOW as u32,
+            cqes: CQ_CQES as u32,
+            flags: CQ_FLAGS as u32,
+            resv1: 0,
+            user_addr: 0,
+        }
+    }
+
+    /// Returns the SQ tail published by the user space.
+    pub(super) fn sq_tail(&self) -> Result<u32> {
+        let tail = self.read_sq(SQ_TAIL)?;
+        // Pairs with the release store of the tail in the user space, so that
+        // the SQEs are read after they are filled.
+        fence(Ordering::Acquire);
+        Ok(tail)
+    }
+
+    /// Publishes the SQ head, which returns the consumed SQEs to the user space.
+    pub(super) fn set_sq_head(&self, head: u32) -> Result<()> {
+        fence(Ordering::Release);
+        self.write_sq(SQ_HEAD, head)
+    }
+
+    /// Reads the SQE at `head`.
+    ///
+    /// Returns `None` if the SQ array refers to an invalid SQE.
+    pub(super) fn read_sqe(&self, head: u32) -> Result<Option<IoUringSqe>> {
+        let slot = (head & (self.sq_entries - 1)) as usize;
+        let index = self.read_sq(SQ_ARRAY + slot * size_of::<u32>())?;
+        if index >= self.sq_entries {
+            return Ok(None);
+        }
+
+        let offset = IORING_OFF_SQES + index as usize * size_of::<IoUringSqe>();
+        Ok(Some(self.vmo.read_val(offset)?))
+    }
+
+    /// Counts an SQE that is dropped because it is invalid.
+    pub(super) fn add_sq_dropped(&self) -> Result<()> {
+        let dropped = self.read_sq(SQ_DROPPED)?;
+        self.write_sq(SQ_DROPPED, dropped.wrapping_add(1))
+    }
+
+    /// Returns the number of entries in the CQ ring.
+    pub(super) fn cq_entries(&self) -> u32 {
+        self.cq_entries
+    }
+
+    /// Returns the number of CQEs that are posted but not yet reaped.
+    pub(super) fn cq_ready(&self, tail: u32) -> Result<u32> {
+        let head = self.read_cq(CQ_HEAD)?;
+        Ok(tail.wrapping_sub(head))
+    }
+
+    /// Posts a CQE at `tail` if the CQ ring is not full.
+    ///
+    /// Returns whether the CQE is posted. The new tail is not published until
+    /// [`Self::set_cq_tail`] is called.
+    pub(super) fn post_cqe(&self, tail: u32, cqe: &IoUringCqe) -> Result<bool> {
+        if self.cq_ready(tail)? >= self.cq_entries {
+            return Ok(false);
+        }
+
+        let slot = (tail & (self.cq_entries - 1)) as usize;
+        self.vmo.write_val(
+            IORING_OFF_CQ_RING + CQ_CQES + slot * size_of::<IoUringCqe>(),
+            cqe,
+        )?;
+        Ok(true)
+    }
+
+    /// Publishes the CQ tail, which makes the posted CQEs visible to the user space.
+    pub(super) fn set_cq_tail(&self, tail: u32) -> Result<()> {
+        fence(Ordering::Release);
+        self.write_cq(CQ_TAIL, tail)
+    }
+
+    /// Counts a CQE that is dropped because too many CQEs overflow the CQ ring.
+    pub(super) fn add_cq_overflow(&self) -> Result<()> {
+        let overflow = self.read_cq(CQ_OVERFLOW)?;
+        self.write_cq(CQ_OVERFLOW, overflow.wrapping_add(1))
+    }
+
+    /// Sets or clears the flag telling the user space that some CQEs overflow.
+    pub(super) fn set_cq_overflow(&self, is_overflowed: bool) -> Result<()> {
+        let flags = self.read_sq(SQ_FLAGS)?;
+        let new_flags = if is_overflowed {
+            flags | IORING_SQ_CQ_OVERFLOW
+        } else {
+            flags & !IORING_SQ_CQ_OVERFLOW
+        };
+        if new_flags != flags {
+            self.write_sq(SQ_FLAGS, new_flags)?;
+        }
+        Ok(())
+    }
+
+    fn read_sq(&self, offset: usize) -> Result<u32> {
+        Ok(self.vmo.read_val(IORING_OFF_SQ_RING + offset)?)
+    }
+
+    fn write_sq(&self, offset: usize, val: u32) -> Result<()> {
+        Ok(self.vmo.write_val(IORING_OFF_SQ_RING + offset, &val)?)
+    }
+
+    fn read_cq(&self, offset: usize) -> Result<u32> {
+        Ok(self.vmo.read_val(IORING_OFF_CQ_RING + offset)?)
+    }
+
+    fn write_cq(&self, offset: usize, val: u32) -> Result<()> {
+        Ok(self.vmo.write_val(IORING_OFF_CQ_RING + offset, &val)?)
+    }
+}
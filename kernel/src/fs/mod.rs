@@ -9,6 +9,7 @@ pub mod file_handle;
 pub mod file_table;
 pub mod fs_resolver;
 pub mod inode_handle;
+pub mod io_uring;
 pub mod named_pipe;
 pub mod overlayfs;
 pub mod path;
@@ -34,15 +35,22 @@ use crate::{
 
 fn start_block_device(device_name: &str) -> Result<Arc<dyn BlockDevice>> {
     if let Some(device) = aster_block::get_device(device_name) {
-        let cloned_device = device.clone();
-        let task_fn = move || {
-            info!("spawn the virt-io-block thread");
-            let virtio_block_device = cloned_device.downcast_ref::<VirtIoBlockDevice>().unwrap();
-            loop {
-                virtio_block_device.handle_requests();
-            }
-        };
-        crate::ThreadOptions::new(task_fn).spawn();
+        let virtio_block_device = device.downcast_ref::<VirtIoBlockDevice>().unwrap();
+        // Each virtqueue is handled by a thread running on the CPUs that submit to it.
+        for queue_idx in 0..virtio_block_device.nr_queues() {
+            let cloned_device = device.clone();
+            let task_fn = move || {
+                info!("spawn the virt-io-block thread for queue {}", queue_idx);
+                let virtio_block_device =
+                    cloned_device.downcast_ref::<VirtIoBlockDevice>().unwrap();
+                loop {
+                    virtio_block_device.handle_requests(queue_idx);
+                }
+            };
+            crate::ThreadOptions::new(task_fn)
+                .cpu_affinity(virtio_block_device.queue_cpus(queue_idx))
+                .spawn();
+        }
         Ok(device)
     } else {
         return_errno_with_message!(Errno::ENOENT, "Device does not exist")
@@ -50,6 +58,9 @@ fn start_block_device(device_name: &str) -> Result<Arc<dyn BlockDevice>> {
 }
 
 pub fn lazy_init() {
+    utils::lazy_init();
+    path::lazy_init();
+
     //The device name is specified in qemu args as --serial={device_name}
     let ext2_device_name = "vext2";
     let exfat_device_name = "vexfat";
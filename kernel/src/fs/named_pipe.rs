@@ -28,6 +28,16 @@ impl NamedPipe {
 
         Ok(Self { reader, writer })
     }
+
+    /// Returns the maximum number of bytes in the pipe.
+    pub fn capacity(&self) -> usize {
+        self.writer.capacity()
+    }
+
+    /// Changes the maximum number of bytes in the pipe.
+    pub fn set_capacity(&self, capacity: usize) -> Result<()> {
+        self.writer.set_capacity(capacity)
+    }
 }
 
 impl Pollable for NamedPipe {
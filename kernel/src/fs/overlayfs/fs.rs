@@ -4,15 +4,16 @@
 
 use alloc::format;
 use core::{
-    sync::atomic::{AtomicU64, Ordering},
+    sync::atomic::{AtomicU64, AtomicU8, Ordering},
     time::Duration,
 };
 
-use align_ext::AlignExt;
 use aster_block::BLOCK_SIZE;
 use aster_rights::Full;
+use atomic_integer_wrapper::define_atomic_version_of_integer_like_type;
 use hashbrown::HashSet;
 use inherit_methods_macro::inherit_methods;
+use int_to_c_enum::TryFromInt;
 use ostd::mm::{FrameAllocOptions, UntypedMem};
 
 use crate::{
@@ -72,6 +73,31 @@ struct OverlayWork {
     // TODO: Align the work directory's behavior with Linux.
 }
 
+/// The data copy-up state of an `OverlayInode`.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, TryFromInt)]
+#[repr(u8)]
+enum CopyUpState {
+    /// The data resides in the upper inode, or there is no data to copy up.
+    Done = 0,
+    /// The upper inode is a metacopy file, whose data still resides in
+    /// the top lower inode.
+    Metacopy = 1,
+    /// The data is being copied up. The readers are still served from
+    /// the top lower inode.
+    CopyingData = 2,
+}
+
+define_atomic_version_of_integer_like_type!(CopyUpState, try_from = true, {
+    #[derive(Debug)]
+    struct AtomicCopyUpState(AtomicU8);
+});
+
+impl From<CopyUpState> for u8 {
+    fn from(value: CopyUpState) -> Self {
+        value as _
+    }
+}
+
 /// Provides an unified inode abstraction for its user, internal it
 /// manages the layered regular inodes.
 struct OverlayInode {
@@ -89,6 +115,10 @@ struct OverlayInode {
     upper: Mutex<Option<Arc<dyn Inode>>>,
     /// Whether the upper inode is an opaque directory.
     upper_is_opaque: bool,
+    /// The data copy-up state of the upper inode.
+    copy_up_state: AtomicCopyUpState,
+    /// Serializes the data copy-ups of this inode.
+    data_copy_up_lock: Mutex<()>,
     /// The immutable lower layered regular inodes.
     lowers: Vec<Arc<dyn Inode>>,
     /// Weak fs reference.
@@ -103,7 +133,10 @@ impl OverlayFS {
             upper: OverlayUpper { dentry: upper },
             lower: OverlayLower { dentries: lower },
             work: OverlayWork { dentry: work },
-            config: OverlayConfig::default(),
+            config: OverlayConfig {
+                metacopy: true,
+                ..Default::default()
+            },
             sb: OverlaySB,
             next_ino: AtomicU64::new(0),
             self_: weak.clone(),
@@ -124,6 +157,8 @@ impl FileSystem for OverlayFS {
             parent: None,
             upper: Mutex::new(Some(upper_inode)),
             upper_is_opaque: false,
+            copy_up_state: AtomicCopyUpState::new(CopyUpState::Done),
+            data_copy_up_lock: Mutex::new(()),
             lowers: fs
                 .lower
                 .dentries
@@ -229,6 +264,8 @@ impl OverlayInode {
             parent: Some(self.self_.upgrade().unwrap()),
             upper: Mutex::new(Some(new_upper)),
             upper_is_opaque,
+            copy_up_state: AtomicCopyUpState::new(CopyUpState::Done),
+            data_copy_up_lock: Mutex::new(()),
             lowers: Vec::new(),
             fs: self.fs.clone(),
             self_: weak.clone(),
@@ -243,7 +280,7 @@ impl OverlayInode {
         if self.type_ == InodeType::Dir {
             return_errno!(Errno::EISDIR);
         }
-        let upper = self.build_upper_recursively_if_needed()?;
+        let upper = self.copy_up_data_if_needed()?;
         upper.write_at(offset, reader)
     }
 
@@ -251,7 +288,7 @@ impl OverlayInode {
         if self.type_ == InodeType::Dir {
             return_errno!(Errno::EISDIR);
         }
-        let upper = self.build_upper_recursively_if_needed()?;
+        let upper = self.copy_up_data_if_needed()?;
         upper.write_direct_at(offset, reader)
     }
 
@@ -259,14 +296,15 @@ impl OverlayInode {
         if self.type_ == InodeType::Dir {
             return_errno!(Errno::EISDIR);
         }
-        self.get_top_valid_inode().read_at(offset, writer)
+        self.get_top_valid_data_inode().read_at(offset, writer)
     }
 
     pub fn read_direct_at(&self, offset: usize, writer: &mut VmWriter) -> Result<usize> {
         if self.type_ == InodeType::Dir {
             return_errno!(Errno::EISDIR);
         }
-        self.get_top_valid_inode().read_direct_at(offset, writer)
+        self.get_top_valid_data_inode()
+            .read_direct_at(offset, writer)
     }
 
     /// Returns the children objects in a unified view.
@@ -389,7 +427,7 @@ impl OverlayInode {
             return Ok(());
         }
 
-        let upper = self.build_upper_recursively_if_needed()?;
+        let upper = self.copy_up_data_if_needed()?;
         upper.resize(new_size)
     }
 
@@ -410,7 +448,7 @@ impl OverlayInode {
     pub fn page_cache(&self) -> Option<Vmo<Full>> {
         let _ = self.get_top_valid_inode().page_cache()?;
         // Do copy-up for the potential memory mapping operations
-        let upper = self.build_upper_recursively_if_needed().unwrap();
+        let upper = self.copy_up_data_if_needed().unwrap();
         upper.page_cache()
     }
 
@@ -493,16 +531,19 @@ impl OverlayInode {
     ) -> Result<usize>;
 }
 
-#[inherit_methods(from = "self.build_upper_recursively_if_needed()?")]
+#[inherit_methods(from = "self.build_upper_for_metadata()?")]
 impl OverlayInode {
-    // TODO: Support the `metacopy` feature for efficiency
     pub fn set_mode(&self, mode: InodeMode) -> Result<()>;
     pub fn set_owner(&self, uid: Uid) -> Result<()>;
     pub fn set_group(&self, gid: Gid) -> Result<()>;
+}
+
+#[inherit_methods(from = "self.copy_up_data_if_needed()?")]
+impl OverlayInode {
     pub fn fallocate(&self, mode: FallocMode, offset: usize, len: usize) -> Result<()>;
 }
 
-#[inherit_methods(from = "self.build_upper_recursively_if_needed().unwrap()")]
+#[inherit_methods(from = "self.build_upper_for_metadata().unwrap()")]
 impl OverlayInode {
     pub fn set_atime(&self, time: Duration);
     pub fn set_mtime(&self, time: Duration);
@@ -521,6 +562,20 @@ impl OverlayInode {
             .unwrap()
     }
 
+    // Returns the top valid inode who holds the data, which is the top valid
+    // lower inode if the upper is missing or is a metacopy file.
+    fn get_top_valid_data_inode(&self) -> Arc<dyn Inode> {
+        if let Some(upper) = self.upper() {
+            if self.copy_up_state.load(Ordering::Acquire) == CopyUpState::Done {
+                return upper;
+            }
+        }
+
+        self.get_top_valid_lower_inode()
+            .map(|lower| lower.clone())
+            .unwrap()
+    }
+
     /// Returns the top valid lower inode.
     fn get_top_valid_lower_inode(&self) -> Option<&Arc<dyn Inode>> {
         if !self.has_valid_lower() {
@@ -576,6 +631,7 @@ impl OverlayInode {
         let mut type_ = None;
         let mut upper_is_opaque = false;
         let mut upper_is_not_dir = false;
+        let mut upper_is_metacopy = false;
 
         let upper_child = if let Some(upper) = self.upper.lock().as_ref() {
             // First check whiteout then opaque
@@ -589,6 +645,8 @@ impl OverlayInode {
                     let child_type = child.type_();
                     if child_type == InodeType::Dir {
                         upper_is_opaque = is_opaque_dir(&child)?;
+                    } else if child_type == InodeType::File && is_metacopy_file(&child)? {
+                        upper_is_metacopy = true;
                     } else {
                         upper_is_not_dir = true;
                     }
@@ -610,6 +668,23 @@ impl OverlayInode {
 
         let lower_children = if upper_is_opaque || upper_is_not_dir {
             vec![]
+        } else if upper_is_metacopy {
+            // Only the top lower file is needed, which holds the data.
+            let mut children = Vec::new();
+            for lower in &self.lowers {
+                if lower.lookup(&whiteout_name(name)).is_ok() {
+                    break;
+                }
+                if let Ok(child) = lower.lookup(name) {
+                    if child.type_() == InodeType::File {
+                        children.push(child);
+                    }
+                    break;
+                }
+            }
+            // The data is lost if the lower file is gone, fall back to the upper.
+            upper_is_metacopy = !children.is_empty();
+            children
         } else {
             let mut children = Vec::new();
             for lower in &self.lowers {
@@ -657,6 +732,12 @@ impl OverlayInode {
             parent: Some(self.self_.upgrade().unwrap()),
             upper: Mutex::new(upper_child),
             upper_is_opaque,
+            copy_up_state: AtomicCopyUpState::new(if upper_is_metacopy {
+                CopyUpState::Metacopy
+            } else {
+                CopyUpState::Done
+            }),
+            data_copy_up_lock: Mutex::new(()),
             lowers: lower_children,
             fs: self.fs.clone(),
             self_: weak.clone(),
@@ -719,6 +800,58 @@ impl OverlayInode {
         Ok(overlay_visitor)
     }
 
+    /// Builds the upper inode for metadata changes. The data is copied up as
+    /// well unless the `metacopy` feature is enabled.
+    fn build_upper_for_metadata(&self) -> Result<Arc<dyn Inode>> {
+        if self.overlay_fs().config.metacopy {
+            self.build_upper_recursively_if_needed()
+        } else {
+            self.copy_up_data_if_needed()
+        }
+    }
+
+    /// Builds the upper inode with the data copied up, for data changes.
+    ///
+    /// The data copy-up is done without holding the upper lock, so that
+    /// concurrent readers are served from the lower inode in the meantime.
+    fn copy_up_data_if_needed(&self) -> Result<Arc<dyn Inode>> {
+        let upper = self.build_upper_recursively_if_needed()?;
+        if self.copy_up_state.load(Ordering::Acquire) == CopyUpState::Done {
+            return Ok(upper);
+        }
+
+        let _copy_up_guard = self.data_copy_up_lock.lock();
+        if self.copy_up_state.load(Ordering::Acquire) == CopyUpState::Done {
+            return Ok(upper);
+        }
+        self.copy_up_state
+            .store(CopyUpState::CopyingData, Ordering::Relaxed);
+
+        let res = self.copy_up_data_locked(&upper);
+        let new_state = if res.is_ok() {
+            CopyUpState::Done
+        } else {
+            CopyUpState::Metacopy
+        };
+        self.copy_up_state.store(new_state, Ordering::Release);
+
+        res.map(|_| upper)
+    }
+
+    /// Copies up the data of a metacopy upper inode.
+    ///
+    /// The caller must hold the `data_copy_up_lock`.
+    fn copy_up_data_locked(&self, upper: &Arc<dyn Inode>) -> Result<()> {
+        // Another `OverlayInode` of the same file may have finished the copy-up.
+        if !is_metacopy_file(upper)? {
+            return Ok(());
+        }
+
+        let lower = self.get_top_valid_lower_inode().unwrap();
+        Self::copy_up_data(lower, upper)?;
+        upper.remove_xattr(XattrName::try_from_full_name(METACOPY_XATTR_NAME).unwrap())
+    }
+
     fn build_upper_recursively_if_needed(&self) -> Result<Arc<dyn Inode>> {
         let mut upper_guard = self.upper.lock();
         if let Some(upper) = upper_guard.as_ref() {
@@ -759,14 +892,22 @@ impl OverlayInode {
             return Ok(());
         }
 
-        // First copy the metadata, then the data, finally the xattr
+        // First copy the metadata, then the xattr. The data of a non-empty file
+        // is copied up lazily, until then the upper is marked as a metacopy file
+        // that has the same size as the lower.
         Self::copy_up_metadata(lower_inode, upper_inode)?;
+        Self::copy_up_xattr(lower_inode, upper_inode)?;
 
-        if upper_type == InodeType::File {
-            Self::copy_up_data(lower_inode, upper_inode)?;
+        if upper_type == InodeType::File && lower_inode.size() > 0 {
+            upper_inode.resize(lower_inode.size())?;
+            upper_inode.set_xattr(
+                XattrName::try_from_full_name(METACOPY_XATTR_NAME).unwrap(),
+                &mut VmReader::from([].as_slice()).to_fallible(),
+                XattrSetFlags::CREATE_ONLY,
+            )?;
+            self.copy_up_state
+                .store(CopyUpState::Metacopy, Ordering::Release);
         }
-
-        Self::copy_up_xattr(lower_inode, upper_inode)?;
         Ok(())
     }
 
@@ -788,17 +929,18 @@ impl OverlayInode {
             return Ok(());
         }
 
-        // TODO: Find a way to cut this copy, like just copy chunks of data from two page caches directly.
+        // Copy from the page cache of the lower directly, without an intermediate
+        // buffer as large as the file.
         let lower_size = lower.size();
-        let data_buf = FrameAllocOptions::new()
-            .zeroed(false)
-            .alloc_segment(lower_size.align_up(BLOCK_SIZE) / BLOCK_SIZE)?;
-
-        let mut writer = data_buf.writer().to_fallible();
-        let read_len = lower.read_at(0, &mut writer)?;
-
-        let mut reader = data_buf.reader().to_fallible();
-        let _ = upper.write_at(0, reader.limit(read_len))?;
+        let mut offset = 0;
+        while offset < lower_size {
+            let copied_len =
+                upper.copy_range_from(lower.as_ref(), offset, offset, lower_size - offset)?;
+            if copied_len == 0 {
+                break;
+            }
+            offset += copied_len;
+        }
         Ok(())
     }
 
@@ -845,6 +987,7 @@ impl OverlayInode {
 
 const WHITEOUT_XATTR_NAME: &str = "trusted.overlay.whiteout";
 const OPAQUE_DIR_XATTR_NAME: &str = "trusted.overlay.opaque";
+const METACOPY_XATTR_NAME: &str = "trusted.overlay.metacopy";
 const WHITEOUT_AND_OPAQUE_XATTR_VALUE: [u8; 1] = [121u8]; // "y", represents the xattr is set
 
 const WHITEOUT_PREFIX: &str = ".wh.";
@@ -874,6 +1017,20 @@ fn is_opaque_dir(inode: &Arc<dyn Inode>) -> Result<bool> {
     Ok(value == WHITEOUT_AND_OPAQUE_XATTR_VALUE)
 }
 
+fn is_metacopy_file(inode: &Arc<dyn Inode>) -> Result<bool> {
+    assert_eq!(inode.type_(), InodeType::File);
+
+    // The metacopy xattr has an empty value, only its existence matters.
+    let name = XattrName::try_from_full_name(METACOPY_XATTR_NAME).unwrap();
+    match inode.get_xattr(name, &mut VmWriter::from([].as_mut_slice()).to_fallible()) {
+        Ok(_) => Ok(true),
+        Err(e) => match e.error() {
+            Errno::ENODATA | Errno::EOPNOTSUPP => Ok(false),
+            _ => Err(e),
+        },
+    }
+}
+
 #[inherit_methods(from = "self")]
 impl Inode for OverlayInode {
     fn size(&self) -> usize;
@@ -1274,6 +1431,39 @@ mod tests {
         assert_eq!(xattr_value.as_slice(), "f2_xattr_value".as_bytes());
     }
 
+    #[ktest]
+    fn metacopy() {
+        let fs = create_overlay_fs();
+        let root = fs.root_inode();
+
+        let f2 = root.lookup("f2").unwrap();
+        f2.set_group(Gid::new(88)).unwrap();
+
+        let f2_inode = f2.downcast_ref::<OverlayInode>().unwrap();
+        assert!(f2_inode.has_valid_upper());
+        assert_eq!(
+            f2_inode.copy_up_state.load(Ordering::Relaxed),
+            CopyUpState::Metacopy
+        );
+        assert_eq!(f2.size(), 4);
+
+        // A new lookup finds the metacopy upper and still reads the lower data.
+        let f2 = root.lookup("f2").unwrap();
+        assert_eq!(f2.group().unwrap(), Gid::new(88));
+        let mut data = [0u8; 4];
+        f2.read_bytes_at(0, data.as_mut_slice()).unwrap();
+        assert_eq!(data, [8u8; 4]);
+
+        f2.write_bytes_at(0, &[9u8; 1]).unwrap();
+        let f2_inode = f2.downcast_ref::<OverlayInode>().unwrap();
+        assert_eq!(
+            f2_inode.copy_up_state.load(Ordering::Relaxed),
+            CopyUpState::Done
+        );
+        f2.read_bytes_at(0, data.as_mut_slice()).unwrap();
+        assert_eq!(data, [9u8, 8, 8, 8]);
+    }
+
     #[ktest]
     fn basic_operations() {
         let fs = create_overlay_fs();
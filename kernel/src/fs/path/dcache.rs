@@ -0,0 +1,210 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! The global dentry cache.
+//!
+//! The cached children of a directory are owned by the directory's
+//! `DentryChildren`, which is protected by a sleeping lock. The dentry cache
+//! indexes all the cached children, including the negative ones, in a hash
+//! table keyed by their parents and names, so that a path component can be
+//! looked up without taking any locks.
+//!
+//! Each bucket of the table is an immutable list published with RCU. Lookups
+//! read the list within an RCU read-side critical section, while updates,
+//! which are serialized by the lock of the bucket, replace the list with an
+//! updated copy. The table only holds weak references to the dentries, so the
+//! replaced lists can be freed after the grace period without dropping dentries
+//! in the RCU callbacks.
+
+use core::sync::atomic::{AtomicUsize, Ordering};
+
+use ostd::sync::RcuOption;
+use spin::Once;
+
+use super::dentry::Dentry_;
+use crate::{fs::utils::Shrinker, prelude::*};
+
+/// The number of buckets in the hash table.
+const NR_BUCKETS: usize = 4096;
+
+static DCACHE: Once<DentryCache> = Once::new();
+
+/// Returns the global dentry cache.
+pub(super) fn dcache() -> &'static DentryCache {
+    DCACHE.call_once(DentryCache::new)
+}
+
+/// The hash table of dentries keyed by their parents and names.
+pub(super) struct DentryCache {
+    buckets: Box<[Bucket]>,
+    /// The bucket from which the shrinker continues to scan.
+    shrink_cursor: AtomicUsize,
+}
+
+struct Bucket {
+    entries: RcuOption<Box<Vec<Entry>>>,
+    /// Serializes the updates of `entries`.
+    update_lock: SpinLock<()>,
+}
+
+#[derive(Clone)]
+struct Entry {
+    parent: Weak<Dentry_>,
+    hash: u64,
+    name: String,
+    /// The dentry, or `None` for a negative dentry.
+    dentry: Option<Weak<Dentry_>>,
+}
+
+impl Entry {
+    fn matches(&self, parent: *const Dentry_, hash: u64, name: &str) -> bool {
+        self.hash == hash && self.parent.as_ptr() == parent && self.name == name
+    }
+}
+
+impl DentryCache {
+    fn new() -> Self {
+        let buckets = (0..NR_BUCKETS)
+            .map(|_| Bucket {
+                entries: RcuOption::new(None),
+                update_lock: SpinLock::new(()),
+            })
+            .collect();
+        Self {
+            buckets,
+            shrink_cursor: AtomicUsize::new(0),
+        }
+    }
+
+    /// Looks up the child of `parent` with `name`, without taking any locks.
+    ///
+    /// Returns `Some(None)` for a negative dentry, and `None` if the child is
+    /// not cached.
+    pub(super) fn lookup(&self, parent: &Dentry_, name: &str) -> Option<Option<Arc<Dentry_>>> {
+        let parent = parent as *const Dentry_;
+        let hash = hash_of(parent, name);
+
+        let entries = self.bucket(hash).entries.read();
+        let entries = entries.get()?;
+        let entry = entries
+            .iter()
+            .find(|entry| entry.matches(parent, hash, name))?;
+        match entry.dentry.as_ref() {
+            Some(dentry) => dentry.upgrade().map(Some),
+            None => Some(None),
+        }
+    }
+
+    /// Inserts the child of `parent` with `name`, or a negative dentry if
+    /// `dentry` is `None`.
+    pub(super) fn insert(&self, parent: &Weak<Dentry_>, name: &str, dentry: Option<&Arc<Dentry_>>) {
+        let hash = hash_of(parent.as_ptr(), name);
+        let new_entry = Entry {
+            parent: parent.clone(),
+            hash,
+            name: String::from(name),
+            dentry: dentry.map(Arc::downgrade),
+        };
+        self.update_bucket(hash, |entries| {
+            entries.retain(|entry| !entry.matches(parent.as_ptr(), hash, name));
+            entries.push(new_entry);
+        });
+    }
+
+    /// Removes the child of `parent` with `name`.
+    pub(super) fn remove(&self, parent: &Weak<Dentry_>, name: &str) {
+        let hash = hash_of(parent.as_ptr(), name);
+        self.update_bucket(hash, |entries| {
+            entries.retain(|entry| !entry.matches(parent.as_ptr(), hash, name));
+        });
+    }
+
+    fn update_bucket(&self, hash: u64, update: impl FnOnce(&mut Vec<Entry>)) {
+        let bucket = self.bucket(hash);
+        let _guard = bucket.update_lock.lock();
+
+        let mut entries = bucket
+            .entries
+            .read()
+            .get()
+            .map(|entries| entries.to_vec())
+            .unwrap_or_default();
+        update(&mut entries);
+        bucket
+            .entries
+            .update((!entries.is_empty()).then(|| Box::new(entries)));
+    }
+
+    fn bucket(&self, hash: u64) -> &Bucket {
+        &self.buckets[hash as usize % NR_BUCKETS]
+    }
+
+    /// Evicts at most `nr_to_scan` cached dentries that are not in use.
+    ///
+    /// A dentry is in use if it is referenced outside of its parent, e.g., by
+    /// an opened file, a mount, or its own cached children. Thus the dentries
+    /// are evicted from the leaves of the tree.
+    fn shrink(&self, nr_to_scan: usize) -> usize {
+        let mut nr_scanned = 0;
+        let mut nr_evicted = 0;
+
+        for _ in 0..NR_BUCKETS {
+            if nr_scanned >= nr_to_scan {
+                break;
+            }
+
+            let idx = self.shrink_cursor.fetch_add(1, Ordering::Relaxed) % NR_BUCKETS;
+            let entries = self.buckets[idx]
+                .entries
+                .read()
+                .get()
+                .map(|entries| entries.to_vec())
+                .unwrap_or_default();
+            nr_scanned += entries.len();
+
+            for entry in entries {
+                // A lookup might have upgraded the dentry just before its
+                // eviction. The evicted dentry is still valid to be used, but
+                // it is no longer found by the lookups afterward.
+                let evicted = match entry.parent.upgrade() {
+                    Some(parent) => parent.try_evict_child(&entry.name),
+                    None => {
+                        // The parent is gone, so are the dentries owned by it.
+                        self.remove(&entry.parent, &entry.name);
+                        true
+                    }
+                };
+                if evicted {
+                    nr_evicted += 1;
+                }
+            }
+        }
+
+        nr_evicted
+    }
+}
+
+/// The shrinker of the global dentry cache.
+pub(super) static DCACHE_SHRINKER: DentryCacheShrinker = DentryCacheShrinker;
+
+pub(super) struct DentryCacheShrinker;
+
+impl Shrinker for DentryCacheShrinker {
+    fn shrink(&self, nr_to_scan: usize) -> usize {
+        dcache().shrink(nr_to_scan)
+    }
+}
+
+/// Hashes the parent and the name of a dentry with the FNV-1a algorithm.
+fn hash_of(parent: *const Dentry_, name: &str) -> u64 {
+    const FNV_OFFSET_BASIS: u64 = 0xcbf2_9ce4_8422_2325;
+    const FNV_PRIME: u64 = 0x0100_0000_01b3;
+
+    let parent = parent as usize as u64;
+    parent
+        .to_le_bytes()
+        .iter()
+        .chain(name.as_bytes())
+        .fold(FNV_OFFSET_BASIS, |hash, byte| {
+            (hash ^ *byte as u64).wrapping_mul(FNV_PRIME)
+        })
+}
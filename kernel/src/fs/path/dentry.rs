@@ -12,7 +12,7 @@ use hashbrown::HashMap;
 use inherit_methods_macro::inherit_methods;
 use ostd::sync::RwMutexWriteGuard;
 
-use super::{is_dot, is_dot_or_dotdot, is_dotdot};
+use super::{dcache::dcache, is_dot, is_dot_or_dotdot, is_dotdot};
 use crate::{
     fs::{
         path::mount::MountNode,
@@ -60,7 +60,7 @@ impl Dentry_ {
                 DentryOptions::Leaf(name_and_parent) => RwLock::new(Some(name_and_parent)),
                 _ => RwLock::new(None),
             },
-            children: RwMutex::new(DentryChildren::new()),
+            children: RwMutex::new(DentryChildren::new(weak_self.clone())),
             flags: AtomicU32::new(DentryFlags::empty().bits()),
             this: weak_self.clone(),
         })
@@ -169,15 +169,24 @@ impl Dentry_ {
         Ok(new_child)
     }
 
-    /// Lookups a target `Dentry_` from the cache in children.
+    /// Lookups a target `Dentry_` from the dentry cache.
+    ///
+    /// This method does not take any locks.
     pub fn lookup_via_cache(&self, name: &str) -> Result<Option<Arc<Dentry_>>> {
-        let children = self.children.read();
-        children.find(name)
+        match dcache().lookup(self, name) {
+            Some(Some(child)) => Ok(Some(child)),
+            Some(None) => return_errno_with_message!(Errno::ENOENT, "found a negative dentry"),
+            None => Ok(None),
+        }
     }
 
     /// Lookups a target `Dentry_` from the file system.
     pub fn lookup_via_fs(&self, name: &str) -> Result<Arc<Dentry_>> {
         let children = self.children.upread();
+        // The child may have been cached while waiting for the lock.
+        if let Some(child) = children.find(name)? {
+            return Ok(child);
+        }
 
         let inode = match self.inode.lookup(name) {
             Ok(inode) => inode,
@@ -277,6 +286,20 @@ impl Dentry_ {
         Ok(())
     }
 
+    /// Tries to evict the cached child with `name` if it is not in use.
+    ///
+    /// Returns whether the child is evicted. This method does not wait for
+    /// the lock of the children.
+    pub(super) fn try_evict_child(&self, name: &str) -> bool {
+        let Some(mut children) = self.children.try_write() else {
+            return false;
+        };
+        let evicted = children.evict(name);
+        drop(children);
+        // Drops the evicted dentry after releasing the lock.
+        evicted.is_some()
+    }
+
     /// Renames a `Dentry_` to the new `Dentry_` by `rename()` the inner inode.
     pub fn rename(&self, old_name: &str, new_dir: &Arc<Self>, new_name: &str) -> Result<()> {
         if is_dot_or_dotdot(old_name) || is_dot_or_dotdot(new_name) {
@@ -420,17 +443,22 @@ enum DentryOptions {
 ///
 /// A _negative_ dentry reflects a failed filename lookup, saving potential
 /// repeated and costly lookups in the future.
-// TODO: Address the issue of negative dentry bloating. See the reference
-// https://lwn.net/Articles/894098/ for more details.
+///
+/// The child dentries are also indexed in the global dentry cache for the
+/// lock-free lookups, which is kept in sync with `dentries`. The unused
+/// dentries, including the negative ones, are evicted by the shrinker of
+/// the global dentry cache under memory pressure.
 struct DentryChildren {
     dentries: HashMap<String, Option<Arc<Dentry_>>>,
+    parent: Weak<Dentry_>,
 }
 
 impl DentryChildren {
-    /// Creates an empty dentry cache.
-    pub fn new() -> Self {
+    /// Creates an empty dentry cache for the children of `parent`.
+    pub fn new(parent: Weak<Dentry_>) -> Self {
         Self {
             dentries: HashMap::new(),
+            parent,
         }
     }
 
@@ -458,17 +486,40 @@ impl DentryChildren {
         // Assume the caller has checked that the dentry is cacheable
         // and will be newly created if looked up from the parent.
         debug_assert!(dentry.is_dentry_cacheable());
+        dcache().insert(&self.parent, &name, Some(&dentry));
         let _ = self.dentries.insert(name, Some(dentry));
     }
 
     /// Inserts a negative dentry.
     pub fn insert_negative(&mut self, name: String) {
+        dcache().insert(&self.parent, &name, None);
         let _ = self.dentries.insert(name, None);
     }
 
     /// Deletes a dentry by name, turning it into a negative entry if exists.
     pub fn delete(&mut self, name: &str) -> Option<Arc<Dentry_>> {
-        self.dentries.get_mut(name).and_then(Option::take)
+        let child = self.dentries.get_mut(name)?;
+        dcache().insert(&self.parent, name, None);
+        child.take()
+    }
+
+    /// Evicts a dentry by name if it is negative or is not in use.
+    ///
+    /// Returns the evicted entry.
+    pub fn evict(&mut self, name: &str) -> Option<Option<Arc<Dentry_>>> {
+        let Some(child) = self.dentries.get(name) else {
+            // Removes the stale index entry.
+            dcache().remove(&self.parent, name);
+            return Some(None);
+        };
+        if let Some(dentry) = child {
+            if Arc::strong_count(dentry) > 1 || dentry.is_mountpoint() {
+                return None;
+            }
+        }
+
+        dcache().remove(&self.parent, name);
+        self.dentries.remove(name)
     }
 
     /// Checks whether the dentry is a mount point. Returns an error if it is.
@@ -5,9 +5,14 @@
 pub use dentry::{Dentry, DentryKey};
 pub use mount::MountNode;
 
+mod dcache;
 mod dentry;
 mod mount;
 
+pub(super) fn lazy_init() {
+    crate::fs::utils::register_shrinker(&dcache::DCACHE_SHRINKER);
+}
+
 /// Checks if the file name is ".", indicating it's the current directory.
 pub const fn is_dot(filename: &str) -> bool {
     let name_bytes = filename.as_bytes();
@@ -0,0 +1,562 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! The buffer of pipes.
+//!
+//! Like the `pipe_buffer`s of Linux, the buffer of a pipe is a queue of page
+//! slices rather than a ring of bytes. The bytes written to the pipe are copied
+//! into the pages owned by the pipe, while the pages of the page cache or of
+//! another pipe can be queued by reference. Thus `splice` and `tee` can move
+//! the data between files and pipes without copying them.
+//!
+//! The producers and the consumers of a pipe are serialized by separate locks,
+//! so that they can access the pages without holding the lock of the queue:
+//!
+//! - A producer knows that the free space of the pipe does not shrink until it
+//!   finishes, so it can fill the pages before queueing them;
+//! - A consumer knows that the queued pages are not consumed by others until it
+//!   finishes, so it can consume the pages before dequeueing them, and even
+//!   move them to another pipe.
+//!
+//! The queue itself is protected by a spin lock that is only held to push or
+//! pop the pages. The number of bytes in the pipe is mirrored in an atomic, so
+//! the readiness can be checked without any lock. The readers are notified on
+//! every write, since edge-triggered pollers expect an event for each write
+//! even if the pipe is not empty. The writers are only notified when the free
+//! space grows from at most `PIPE_BUF`, which is when they can be unblocked.
+
+use core::{
+    ops::Range,
+    sync::atomic::{AtomicBool, AtomicUsize, Ordering},
+};
+
+use ostd::mm::{FrameAllocOptions, Infallible, UFrame, UntypedMem};
+
+use crate::{
+    events::IoEvents,
+    fs::utils::PIPE_BUF,
+    prelude::*,
+    process::signal::{PollHandle, Pollee},
+    util::{MultiRead, MultiWrite},
+};
+
+/// A slice of a page queued in a pipe.
+#[derive(Clone)]
+pub struct PipePage {
+    frame: UFrame,
+    range: Range<usize>,
+    /// Whether the subsequent writes can be merged into the page.
+    ///
+    /// Only the pages allocated by the pipe can be written. The pages shared
+    /// with the page cache or with other pipes are read-only.
+    can_merge: bool,
+}
+
+impl PipePage {
+    /// Creates a read-only slice of `range` in the `frame`.
+    ///
+    /// # Panics
+    ///
+    /// This method panics if `range` is not within the page.
+    pub fn new(frame: UFrame, range: Range<usize>) -> Self {
+        assert!(range.start <= range.end && range.end <= PAGE_SIZE);
+
+        Self {
+            frame,
+            range,
+            can_merge: false,
+        }
+    }
+
+    /// Returns the number of bytes in the slice.
+    pub fn len(&self) -> usize {
+        self.range.len()
+    }
+
+    /// Returns a reader of the bytes in the slice.
+    pub fn reader(&self) -> VmReader<'_, Infallible> {
+        let mut reader = self.frame.reader();
+        reader.skip(self.range.start).limit(self.range.len());
+        reader
+    }
+
+    /// Returns a read-only slice of the first `len` bytes.
+    fn share(&self, len: usize) -> Self {
+        Self::new(
+            self.frame.clone(),
+            self.range.start..self.range.start + len.min(self.len()),
+        )
+    }
+}
+
+/// The buffer of a pipe.
+pub struct PipeBuffer {
+    state: SpinLock<State>,
+    /// The number of bytes in the pipe.
+    ///
+    /// It is only modified with the lock of `state` held.
+    len: AtomicUsize,
+    /// The maximum number of bytes in the pipe.
+    ///
+    /// It is only modified with the lock of `state` held.
+    capacity: AtomicUsize,
+    /// Serializes the consumers.
+    read_lock: Mutex<()>,
+    /// Serializes the producers.
+    write_lock: Mutex<()>,
+    is_shutdown: AtomicBool,
+    reader_pollee: Pollee,
+    writer_pollee: Pollee,
+}
+
+struct State {
+    pages: VecDeque<PipePage>,
+}
+
+impl PipeBuffer {
+    /// Creates a new buffer with the given capacity in bytes.
+    ///
+    /// # Panics
+    ///
+    /// This method will panic if the given capacity is zero.
+    pub fn with_capacity(capacity: usize) -> Self {
+        Self::with_capacity_and_pollees(capacity, None, None)
+    }
+
+    /// Creates a new buffer with the given capacity in bytes and pollees.
+    ///
+    /// The given pollees are invalidated and then used to notify the events of
+    /// the consumers and the producers, respectively.
+    ///
+    /// # Panics
+    ///
+    /// This method will panic if the given capacity is zero.
+    pub fn with_capacity_and_pollees(
+        capacity: usize,
+        reader_pollee: Option<Pollee>,
+        writer_pollee: Option<Pollee>,
+    ) -> Self {
+        assert!(capacity > 0);
+
+        let reader_pollee = reader_pollee
+            .inspect(|pollee| pollee.invalidate())
+            .unwrap_or_default();
+        let writer_pollee = writer_pollee
+            .inspect(|pollee| pollee.invalidate())
+            .unwrap_or_default();
+
+        Self {
+            state: SpinLock::new(State {
+                pages: VecDeque::new(),
+            }),
+            len: AtomicUsize::new(0),
+            capacity: AtomicUsize::new(capacity),
+            read_lock: Mutex::new(()),
+            write_lock: Mutex::new(()),
+            is_shutdown: AtomicBool::new(false),
+            reader_pollee,
+            writer_pollee,
+        }
+    }
+
+    pub fn capacity(&self) -> usize {
+        self.capacity.load(Ordering::Relaxed)
+    }
+
+    /// Changes the maximum number of bytes in the pipe.
+    ///
+    /// Returns `Err(EBUSY)` if the bytes in the pipe do not fit in the new
+    /// capacity.
+    ///
+    /// # Panics
+    ///
+    /// This method will panic if the given capacity is zero.
+    pub fn set_capacity(&self, capacity: usize) -> Result<()> {
+        assert!(capacity > 0);
+
+        let state = self.state.lock();
+        if self.len() > capacity || state.pages.len() > capacity.div_ceil(PAGE_SIZE) {
+            return_errno_with_message!(Errno::EBUSY, "the data do not fit in the new capacity");
+        }
+        let old_free_len = self.free_len(&state);
+        self.capacity.store(capacity, Ordering::Relaxed);
+        let new_free_len = self.free_len(&state);
+        drop(state);
+
+        if old_free_len <= PIPE_BUF && new_free_len > PIPE_BUF {
+            self.writer_pollee.notify(IoEvents::OUT);
+        } else {
+            self.writer_pollee.invalidate();
+        }
+        Ok(())
+    }
+
+    /// Returns the number of bytes in the pipe.
+    pub fn len(&self) -> usize {
+        self.len.load(Ordering::Relaxed)
+    }
+
+    pub fn is_shutdown(&self) -> bool {
+        self.is_shutdown.load(Ordering::Relaxed)
+    }
+
+    pub fn shutdown(&self) {
+        if self.is_shutdown.swap(true, Ordering::Relaxed) {
+            return;
+        }
+
+        // The POLLHUP event indicates that the write end is shut down.
+        self.reader_pollee.notify(IoEvents::HUP);
+
+        // The POLLERR event indicates that the read end is shut down (so any subsequent writes
+        // will fail with an `EPIPE` error).
+        self.writer_pollee.notify(IoEvents::ERR | IoEvents::OUT);
+    }
+
+    pub fn poll_reader(&self, mask: IoEvents, poller: Option<&mut PollHandle>) -> IoEvents {
+        self.reader_pollee
+            .poll_with(mask, poller, || self.check_reader_events())
+    }
+
+    pub fn poll_writer(&self, mask: IoEvents, poller: Option<&mut PollHandle>) -> IoEvents {
+        self.writer_pollee
+            .poll_with(mask, poller, || self.check_writer_events())
+    }
+
+    /// Returns whether a consumer will not fail with `EAGAIN`.
+    pub fn is_readable(&self) -> bool {
+        !self.check_reader_events().is_empty()
+    }
+
+    /// Returns whether a producer of a single byte will not fail with `EAGAIN`.
+    pub fn is_writable(&self) -> bool {
+        self.is_shutdown() || self.free_len(&self.state.lock()) > 0
+    }
+
+    fn check_reader_events(&self) -> IoEvents {
+        let mut events = IoEvents::empty();
+        if self.is_shutdown() {
+            events |= IoEvents::HUP;
+        }
+        if self.len() > 0 {
+            events |= IoEvents::IN;
+        }
+        events
+    }
+
+    fn check_writer_events(&self) -> IoEvents {
+        if self.is_shutdown() {
+            IoEvents::ERR | IoEvents::OUT
+        } else if self.free_len(&self.state.lock()) > PIPE_BUF {
+            IoEvents::OUT
+        } else {
+            IoEvents::empty()
+        }
+    }
+
+    /// Returns the number of bytes that can be written to the pipe.
+    fn free_len(&self, state: &State) -> usize {
+        let tail_room = match state.pages.back() {
+            Some(page) if page.can_merge => PAGE_SIZE - page.range.end,
+            _ => 0,
+        };
+        let nr_free_pages = self.max_nr_pages().saturating_sub(state.pages.len());
+
+        self.capacity()
+            .saturating_sub(self.len())
+            .min(tail_room + nr_free_pages * PAGE_SIZE)
+    }
+
+    /// Returns the maximum number of pages in the pipe.
+    fn max_nr_pages(&self) -> usize {
+        self.capacity().div_ceil(PAGE_SIZE)
+    }
+}
+
+impl PipeBuffer {
+    /// Tries to write the bytes from `reader` to the pipe.
+    ///
+    /// - Returns `Ok(_)` with the number of bytes written if successful.
+    /// - Returns `Err(EPIPE)` if the pipe is shut down.
+    /// - Returns `Err(EAGAIN)` if the pipe is full.
+    pub fn try_write(&self, reader: &mut dyn MultiRead) -> Result<usize> {
+        if reader.is_empty() {
+            // Even after shutdown, writing an empty buffer is still fine.
+            return Ok(0);
+        }
+
+        let len = reader.sum_lens();
+        self.try_write_with(len, len <= PIPE_BUF, |mut writer| reader.read(&mut writer))
+    }
+
+    /// Tries to write at most `max_len` bytes produced by `fill` to the pipe.
+    ///
+    /// The bytes are copied into the pages owned by the pipe. `fill` is called
+    /// with the writers of the free space in order until it returns an error
+    /// or fills a writer partially, and it returns the number of bytes filled.
+    /// If `is_atomic` is true, no bytes are written unless all `max_len` bytes
+    /// can be written.
+    ///
+    /// - Returns `Ok(_)` with the number of bytes written if successful.
+    /// - Returns `Err(EPIPE)` if the pipe is shut down.
+    /// - Returns `Err(EAGAIN)` if the pipe is full.
+    pub fn try_write_with<F>(&self, max_len: usize, is_atomic: bool, mut fill: F) -> Result<usize>
+    where
+        F: FnMut(VmWriter<'_, Infallible>) -> Result<usize>,
+    {
+        let _guard = self.write_lock.lock();
+
+        if self.is_shutdown() {
+            return_errno_with_message!(Errno::EPIPE, "the pipe is shut down");
+        }
+
+        let (free_len, tail) = {
+            let state = self.state.lock();
+            let tail = state
+                .pages
+                .back()
+                .filter(|page| page.can_merge && page.range.end < PAGE_SIZE)
+                .map(|page| (page.frame.clone(), page.range.end));
+            (self.free_len(&state), tail)
+        };
+        if free_len == 0 || (is_atomic && free_len < max_len) {
+            return_errno_with_message!(Errno::EAGAIN, "the pipe is full");
+        }
+        let max_len = max_len.min(free_len);
+
+        // Fill the room in the tail page at first, and then the new pages.
+        let mut pages = Vec::new();
+        let mut written_len = 0;
+        let mut error: Option<Error> = None;
+        let mut next_page = tail;
+        while written_len < max_len {
+            let (frame, start): (UFrame, usize) = match next_page.take() {
+                Some(tail) => tail,
+                None => match FrameAllocOptions::new().zeroed(false).alloc_frame() {
+                    Ok(frame) => (frame.into(), 0),
+                    Err(err) => {
+                        error = Some(err.into());
+                        break;
+                    }
+                },
+            };
+
+            let len = (PAGE_SIZE - start).min(max_len - written_len);
+            let mut writer = frame.writer();
+            writer.skip(start).limit(len);
+            let filled_len = match fill(writer) {
+                Ok(filled_len) => filled_len,
+                Err(err) => {
+                    error = Some(err);
+                    break;
+                }
+            };
+
+            if filled_len > 0 {
+                pages.push(PipePage {
+                    frame,
+                    range: start..start + filled_len,
+                    can_merge: true,
+                });
+                written_len += filled_len;
+            }
+            if filled_len < len {
+                break;
+            }
+        }
+
+        if written_len > 0 {
+            let mut state = self.state.lock();
+            for page in pages {
+                push_or_merge(&mut state.pages, page);
+            }
+            self.len.fetch_add(written_len, Ordering::Relaxed);
+            drop(state);
+
+            self.reader_pollee.notify(IoEvents::IN);
+            self.writer_pollee.invalidate();
+        }
+
+        match error {
+            Some(err) if written_len == 0 => Err(err),
+            _ => Ok(written_len),
+        }
+    }
+
+    /// Tries to queue the `pages` to the pipe by reference.
+    ///
+    /// The pages are queued in order until the pipe is full, so the last queued
+    /// page may be truncated. The queued pages are read-only to the pipe.
+    ///
+    /// - Returns `Ok(_)` with the number of bytes queued if successful.
+    /// - Returns `Err(EPIPE)` if the pipe is shut down.
+    /// - Returns `Err(EAGAIN)` if the pipe is full.
+    pub fn try_push(&self, pages: &[PipePage]) -> Result<usize> {
+        let _guard = self.write_lock.lock();
+
+        if self.is_shutdown() {
+            return_errno_with_message!(Errno::EPIPE, "the pipe is shut down");
+        }
+
+        let mut state = self.state.lock();
+        let old_len = self.len();
+        let mut pushed_len = 0;
+        for page in pages.iter().filter(|page| page.len() > 0) {
+            let free_len = self.capacity().saturating_sub(old_len + pushed_len);
+            if free_len == 0 || state.pages.len() >= self.max_nr_pages() {
+                break;
+            }
+
+            let page = page.share(free_len);
+            pushed_len += page.len();
+            state.pages.push_back(page);
+        }
+        self.len.fetch_add(pushed_len, Ordering::Relaxed);
+        drop(state);
+
+        if pushed_len > 0 {
+            self.reader_pollee.notify(IoEvents::IN);
+            self.writer_pollee.invalidate();
+            Ok(pushed_len)
+        } else {
+            return_errno_with_message!(Errno::EAGAIN, "the pipe is full");
+        }
+    }
+
+    /// Tries to read the bytes in the pipe to `writer`.
+    ///
+    /// - Returns `Ok(_)` with the number of bytes read if successful.
+    /// - Returns `Ok(0)` if the pipe is shut down and there is no data left.
+    /// - Returns `Err(EAGAIN)` if the pipe is empty.
+    pub fn try_read(&self, writer: &mut dyn MultiWrite) -> Result<usize> {
+        if writer.is_empty() {
+            return Ok(0);
+        }
+
+        self.try_consume(writer.sum_lens(), |page| writer.write(&mut page.reader()))
+    }
+
+    /// Tries to consume at most `max_len` bytes in the pipe with `consume`.
+    ///
+    /// `consume` is called with the queued pages in order until it returns an
+    /// error or consumes a page partially, and it returns the number of bytes
+    /// consumed from the front of the page. The consumed bytes are removed from
+    /// the pipe.
+    ///
+    /// - Returns `Ok(_)` with the number of bytes consumed if successful.
+    /// - Returns `Ok(0)` if the pipe is shut down and there is no data left.
+    /// - Returns `Err(EAGAIN)` if the pipe is empty.
+    pub fn try_consume<F>(&self, max_len: usize, consume: F) -> Result<usize>
+    where
+        F: FnMut(&PipePage) -> Result<usize>,
+    {
+        self.consume_with(max_len, true, consume)
+    }
+
+    /// Tries to peek at most `max_len` bytes in the pipe with `peek`.
+    ///
+    /// This method is the same as [`Self::try_consume`], except that the bytes
+    /// are left in the pipe.
+    pub fn try_peek<F>(&self, max_len: usize, peek: F) -> Result<usize>
+    where
+        F: FnMut(&PipePage) -> Result<usize>,
+    {
+        self.consume_with(max_len, false, peek)
+    }
+
+    fn consume_with<F>(&self, max_len: usize, should_remove: bool, mut consume: F) -> Result<usize>
+    where
+        F: FnMut(&PipePage) -> Result<usize>,
+    {
+        let _guard = self.read_lock.lock();
+
+        // This must be recorded before the actual operation to avoid race conditions.
+        let is_shutdown = self.is_shutdown();
+
+        let pages: Vec<PipePage> = {
+            let state = self.state.lock();
+            let mut remain = max_len;
+            state
+                .pages
+                .iter()
+                .map_while(|page| {
+                    let len = page.len().min(remain);
+                    remain -= len;
+                    (len > 0).then(|| page.share(len))
+                })
+                .collect()
+        };
+        if pages.is_empty() && max_len > 0 {
+            if is_shutdown {
+                return Ok(0);
+            }
+            return_errno_with_message!(Errno::EAGAIN, "the pipe is empty");
+        }
+
+        let mut consumed_len = 0;
+        let mut error: Option<Error> = None;
+        for page in pages.iter() {
+            match consume(page) {
+                Ok(len) => {
+                    consumed_len += len;
+                    if len < page.len() {
+                        break;
+                    }
+                }
+                Err(err) => {
+                    error = Some(err);
+                    break;
+                }
+            }
+        }
+
+        if should_remove {
+            if consumed_len > 0 {
+                let mut state = self.state.lock();
+                let old_free_len = self.free_len(&state);
+                self.len.fetch_sub(consumed_len, Ordering::Relaxed);
+                let mut remain = consumed_len;
+                while remain > 0 {
+                    let page = state.pages.front_mut().unwrap();
+                    let len = page.len().min(remain);
+                    page.range.start += len;
+                    remain -= len;
+                    if page.len() == 0 {
+                        state.pages.pop_front();
+                    }
+                }
+                drop(state);
+
+                // Producers only block if the free space is at most `PIPE_BUF`.
+                if old_free_len <= PIPE_BUF {
+                    self.writer_pollee.notify(IoEvents::OUT);
+                }
+            }
+
+            self.reader_pollee.invalidate();
+        }
+
+        match error {
+            Some(err) if consumed_len == 0 => Err(err),
+            _ => Ok(consumed_len),
+        }
+    }
+}
+
+/// Pushes `page` to the back of `pages`, or merges it into the last page if
+/// they are contiguous in the same page owned by the pipe.
+///
+/// The last page may have been consumed and removed while the producer fills
+/// its room, in which case `page` is pushed as a new one.
+fn push_or_merge(pages: &mut VecDeque<PipePage>, page: PipePage) {
+    if let Some(last) = pages.back_mut() {
+        if last.can_merge
+            && last.frame.start_paddr() == page.frame.start_paddr()
+            && last.range.end == page.range.start
+        {
+            last.range.end = page.range.end;
+            return;
+        }
+    }
+
+    pages.push_back(page);
+}
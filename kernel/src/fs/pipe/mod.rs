@@ -0,0 +1,547 @@
+// SPDX-License-Identifier: MPL-2.0
+
+mod buffer;
+
+use core::sync::atomic::{AtomicU32, Ordering};
+
+pub use buffer::{PipeBuffer, PipePage};
+use ostd::mm::Infallible;
+
+use super::{
+    file_handle::FileLike,
+    utils::{AccessMode, InodeMode, InodeType, Metadata, StatusFlags},
+};
+use crate::{
+    events::IoEvents,
+    prelude::*,
+    process::{
+        signal::{PollHandle, Pollable},
+        Gid, Uid,
+    },
+    time::clocks::RealTimeCoarseClock,
+};
+
+const DEFAULT_PIPE_BUF_SIZE: usize = 65536;
+
+/// The maximum capacity of a pipe that can be set with `F_SETPIPE_SZ`.
+///
+/// This is the default value of `/proc/sys/fs/pipe-max-size` on Linux.
+pub const MAX_PIPE_BUF_SIZE: usize = 1048576;
+
+/// Rounds the capacity requested by `F_SETPIPE_SZ` up to a power of two
+/// number of pages, as Linux does.
+pub fn round_capacity(capacity: usize) -> Result<usize> {
+    if capacity > MAX_PIPE_BUF_SIZE {
+        return_errno_with_message!(Errno::EPERM, "the pipe capacity exceeds the limit");
+    }
+
+    Ok(capacity.max(PAGE_SIZE).next_power_of_two())
+}
+
+pub fn new_pair() -> Result<(Arc<PipeReader>, Arc<PipeWriter>)> {
+    new_pair_with_capacity(DEFAULT_PIPE_BUF_SIZE)
+}
+
+pub fn new_pair_with_capacity(capacity: usize) -> Result<(Arc<PipeReader>, Arc<PipeWriter>)> {
+    let buffer = Arc::new(PipeBuffer::with_capacity(capacity));
+
+    Ok((
+        PipeReader::new(buffer.clone(), StatusFlags::empty())?,
+        PipeWriter::new(buffer, StatusFlags::empty())?,
+    ))
+}
+
+pub struct PipeReader {
+    buffer: Arc<PipeBuffer>,
+    status_flags: AtomicU32,
+}
+
+impl PipeReader {
+    pub fn new(buffer: Arc<PipeBuffer>, status_flags: StatusFlags) -> Result<Arc<Self>> {
+        check_status_flags(status_flags)?;
+
+        Ok(Arc::new(Self {
+            buffer,
+            status_flags: AtomicU32::new(status_flags.bits()),
+        }))
+    }
+
+    /// Consumes at most `max_len` bytes in the pipe with `consume`.
+    ///
+    /// See [`PipeBuffer::try_consume`] for the semantics of `consume`. If the
+    /// pipe is empty, this method blocks unless `is_nonblocking` is true or the
+    /// pipe is opened with `O_NONBLOCK`.
+    pub fn consume_with<F>(
+        &self,
+        max_len: usize,
+        is_nonblocking: bool,
+        mut consume: F,
+    ) -> Result<usize>
+    where
+        F: FnMut(&PipePage) -> Result<usize>,
+    {
+        if is_nonblocking || self.is_nonblocking() {
+            self.buffer.try_consume(max_len, consume)
+        } else {
+            self.wait_events(IoEvents::IN, None, || {
+                self.buffer.try_consume(max_len, &mut consume)
+            })
+        }
+    }
+
+    /// Peeks at most `max_len` bytes in the pipe with `peek`.
+    ///
+    /// This method is the same as [`Self::consume_with`], except that the
+    /// bytes are left in the pipe.
+    pub fn peek_with<F>(&self, max_len: usize, is_nonblocking: bool, mut peek: F) -> Result<usize>
+    where
+        F: FnMut(&PipePage) -> Result<usize>,
+    {
+        if is_nonblocking || self.is_nonblocking() {
+            self.buffer.try_peek(max_len, peek)
+        } else {
+            self.wait_events(IoEvents::IN, None, || {
+                self.buffer.try_peek(max_len, &mut peek)
+            })
+        }
+    }
+
+    /// Waits until the pipe has some data or its write end is closed.
+    pub fn wait_readable(&self) -> Result<()> {
+        self.wait_events(IoEvents::IN, None, || {
+            if self.buffer.is_readable() {
+                Ok(())
+            } else {
+                return_errno_with_message!(Errno::EAGAIN, "the pipe is empty");
+            }
+        })
+    }
+
+    /// Returns the maximum number of bytes in the pipe.
+    pub fn capacity(&self) -> usize {
+        self.buffer.capacity()
+    }
+
+    /// Changes the maximum number of bytes in the pipe.
+    ///
+    /// See [`PipeBuffer::set_capacity`] for the details.
+    pub fn set_capacity(&self, capacity: usize) -> Result<()> {
+        self.buffer.set_capacity(capacity)
+    }
+
+    /// Returns whether `writer` is the write end of the same pipe.
+    pub fn is_peer_of(&self, writer: &PipeWriter) -> bool {
+        Arc::ptr_eq(&self.buffer, &writer.buffer)
+    }
+
+    fn is_nonblocking(&self) -> bool {
+        self.status_flags().contains(StatusFlags::O_NONBLOCK)
+    }
+}
+
+impl Pollable for PipeReader {
+    fn poll(&self, mask: IoEvents, poller: Option<&mut PollHandle>) -> IoEvents {
+        self.buffer.poll_reader(mask, poller)
+    }
+}
+
+impl FileLike for PipeReader {
+    fn read(&self, writer: &mut VmWriter) -> Result<usize> {
+        let read_len = if self.is_nonblocking() {
+            self.buffer.try_read(writer)?
+        } else {
+            self.wait_events(IoEvents::IN, None, || self.buffer.try_read(writer))?
+        };
+        Ok(read_len)
+    }
+
+    fn status_flags(&self) -> StatusFlags {
+        StatusFlags::from_bits_truncate(self.status_flags.load(Ordering::Relaxed))
+    }
+
+    fn set_status_flags(&self, new_flags: StatusFlags) -> Result<()> {
+        check_status_flags(new_flags)?;
+
+        self.status_flags.store(new_flags.bits(), Ordering::Relaxed);
+        Ok(())
+    }
+
+    fn access_mode(&self) -> AccessMode {
+        AccessMode::O_RDONLY
+    }
+
+    fn metadata(&self) -> Metadata {
+        // This is a dummy implementation.
+        // TODO: Add "PipeFS" and link `PipeReader` to it.
+        let now = RealTimeCoarseClock::get().read_time();
+        Metadata {
+            dev: 0,
+            ino: 0,
+            size: 0,
+            blk_size: 0,
+            blocks: 0,
+            atime: now,
+            mtime: now,
+            ctime: now,
+            type_: InodeType::NamedPipe,
+            mode: InodeMode::from_bits_truncate(0o400),
+            nlinks: 1,
+            uid: Uid::new_root(),
+            gid: Gid::new_root(),
+            rdev: 0,
+        }
+    }
+}
+
+impl Drop for PipeReader {
+    fn drop(&mut self) {
+        self.buffer.shutdown();
+    }
+}
+
+pub struct PipeWriter {
+    buffer: Arc<PipeBuffer>,
+    status_flags: AtomicU32,
+}
+
+impl PipeWriter {
+    pub fn new(buffer: Arc<PipeBuffer>, status_flags: StatusFlags) -> Result<Arc<Self>> {
+        check_status_flags(status_flags)?;
+
+        Ok(Arc::new(Self {
+            buffer,
+            status_flags: AtomicU32::new(status_flags.bits()),
+        }))
+    }
+
+    /// Returns the maximum number of bytes in the pipe.
+    pub fn capacity(&self) -> usize {
+        self.buffer.capacity()
+    }
+
+    /// Changes the maximum number of bytes in the pipe.
+    ///
+    /// See [`PipeBuffer::set_capacity`] for the details.
+    pub fn set_capacity(&self, capacity: usize) -> Result<()> {
+        self.buffer.set_capacity(capacity)
+    }
+
+    /// Writes at most `max_len` bytes produced by `fill` to the pipe.
+    ///
+    /// See [`PipeBuffer::try_write_with`] for the semantics of `fill`. The
+    /// write is never atomic. If the pipe is full, this method blocks unless
+    /// `is_nonblocking` is true or the pipe is opened with `O_NONBLOCK`.
+    pub fn write_with<F>(&self, max_len: usize, is_nonblocking: bool, mut fill: F) -> Result<usize>
+    where
+        F: FnMut(VmWriter<'_, Infallible>) -> Result<usize>,
+    {
+        if is_nonblocking || self.is_nonblocking() {
+            self.buffer.try_write_with(max_len, false, fill)
+        } else {
+            self.wait_events(IoEvents::OUT, None, || {
+                self.buffer.try_write_with(max_len, false, &mut fill)
+            })
+        }
+    }
+
+    /// Queues the `pages` to the pipe by reference.
+    ///
+    /// See [`PipeBuffer::try_push`] for the details. If the pipe is full, this
+    /// method blocks unless `is_nonblocking` is true or the pipe is opened with
+    /// `O_NONBLOCK`.
+    pub fn push_pages(&self, pages: &[PipePage], is_nonblocking: bool) -> Result<usize> {
+        if is_nonblocking || self.is_nonblocking() {
+            self.buffer.try_push(pages)
+        } else {
+            self.wait_events(IoEvents::OUT, None, || self.buffer.try_push(pages))
+        }
+    }
+
+    /// Waits until the pipe has some free space or its read end is closed.
+    pub fn wait_writable(&self) -> Result<()> {
+        self.wait_events(IoEvents::OUT, None, || {
+            if self.buffer.is_writable() {
+                Ok(())
+            } else {
+                return_errno_with_message!(Errno::EAGAIN, "the pipe is full");
+            }
+        })
+    }
+
+    fn is_nonblocking(&self) -> bool {
+        self.status_flags().contains(StatusFlags::O_NONBLOCK)
+    }
+}
+
+impl Pollable for PipeWriter {
+    fn poll(&self, mask: IoEvents, poller: Option<&mut PollHandle>) -> IoEvents {
+        self.buffer.poll_writer(mask, poller)
+    }
+}
+
+impl FileLike for PipeWriter {
+    fn write(&self, reader: &mut VmReader) -> Result<usize> {
+        if self.is_nonblocking() {
+            self.buffer.try_write(reader)
+        } else {
+            self.wait_events(IoEvents::OUT, None, || self.buffer.try_write(reader))
+        }
+    }
+
+    fn status_flags(&self) -> StatusFlags {
+        StatusFlags::from_bits_truncate(self.status_flags.load(Ordering::Relaxed))
+    }
+
+    fn set_status_flags(&self, new_flags: StatusFlags) -> Result<()> {
+        check_status_flags(new_flags)?;
+
+        self.status_flags.store(new_flags.bits(), Ordering::Relaxed);
+        Ok(())
+    }
+
+    fn access_mode(&self) -> AccessMode {
+        AccessMode::O_WRONLY
+    }
+
+    fn metadata(&self) -> Metadata {
+        // This is a dummy implementation.
+        // TODO: Add "PipeFS" and link `PipeWriter` to it.
+        let now = RealTimeCoarseClock::get().read_time();
+        Metadata {
+            dev: 0,
+            ino: 0,
+            size: 0,
+            blk_size: 0,
+            blocks: 0,
+            atime: now,
+            mtime: now,
+            ctime: now,
+            type_: InodeType::NamedPipe,
+            mode: InodeMode::from_bits_truncate(0o200),
+            nlinks: 1,
+            uid: Uid::new_root(),
+            gid: Gid::new_root(),
+            rdev: 0,
+        }
+    }
+}
+
+impl Drop for PipeWriter {
+    fn drop(&mut self) {
+        self.buffer.shutdown();
+    }
+}
+
+fn check_status_flags(status_flags: StatusFlags) -> Result<()> {
+    if status_flags.contains(StatusFlags::O_DIRECT) {
+        // "O_DIRECT .. Older kernels that do not support this flag will indicate this via an
+        // EINVAL error."
+        //
+        // See <https://man7.org/linux/man-pages/man2/pipe.2.html>.
+        return_errno_with_message!(Errno::EINVAL, "the `O_DIRECT` flag is not supported");
+    }
+
+    // TODO: Setting most of the other flags will succeed on Linux, but their effects need to be
+    // validated.
+
+    Ok(())
+}
+
+#[cfg(ktest)]
+mod test {
+    use alloc::sync::Arc;
+    use core::sync::atomic::{self, AtomicBool};
+
+    use ostd::{
+        mm::{FrameAllocOptions, UFrame, UntypedMem},
+        prelude::*,
+    };
+
+    use super::*;
+    use crate::thread::{kernel_thread::ThreadOptions, Thread};
+
+    #[derive(Clone, Copy, Debug, PartialEq, Eq)]
+    enum Ordering {
+        WriteThenRead,
+        ReadThenWrite,
+    }
+
+    fn test_blocking<W, R>(write: W, read: R, ordering: Ordering)
+    where
+        W: FnOnce(Arc<PipeWriter>) + Send + 'static,
+        R: FnOnce(Arc<PipeReader>) + Send + 'static,
+    {
+        let buffer = Arc::new(PipeBuffer::with_capacity(2));
+
+        let writer = PipeWriter::new(buffer.clone(), StatusFlags::empty()).unwrap();
+        let reader = PipeReader::new(buffer, StatusFlags::empty()).unwrap();
+
+        let signal_writer = Arc::new(AtomicBool::new(false));
+        let signal_reader = signal_writer.clone();
+
+        let writer = ThreadOptions::new(move || {
+            if ordering == Ordering::ReadThenWrite {
+                while !signal_writer.load(atomic::Ordering::Relaxed) {
+                    Thread::yield_now();
+                }
+            } else {
+                signal_writer.store(true, atomic::Ordering::Relaxed);
+            }
+
+            write(writer);
+        })
+        .spawn();
+
+        let reader = ThreadOptions::new(move || {
+            if ordering == Ordering::WriteThenRead {
+                while !signal_reader.load(atomic::Ordering::Relaxed) {
+                    Thread::yield_now();
+                }
+            } else {
+                signal_reader.store(true, atomic::Ordering::Relaxed);
+            }
+
+            read(reader);
+        })
+        .spawn();
+
+        writer.join();
+        reader.join();
+    }
+
+    #[ktest]
+    fn test_read_empty() {
+        test_blocking(
+            |writer| {
+                assert_eq!(writer.write(&mut reader_from(&[1])).unwrap(), 1);
+            },
+            |reader| {
+                let mut buf = [0; 1];
+                assert_eq!(reader.read(&mut writer_from(&mut buf)).unwrap(), 1);
+                assert_eq!(&buf, &[1]);
+            },
+            Ordering::ReadThenWrite,
+        );
+    }
+
+    #[ktest]
+    fn test_write_full() {
+        test_blocking(
+            |writer| {
+                assert_eq!(writer.write(&mut reader_from(&[1, 2, 3])).unwrap(), 2);
+                assert_eq!(writer.write(&mut reader_from(&[2])).unwrap(), 1);
+            },
+            |reader| {
+                let mut buf = [0; 3];
+                assert_eq!(reader.read(&mut writer_from(&mut buf)).unwrap(), 2);
+                assert_eq!(&buf[..2], &[1, 2]);
+                assert_eq!(reader.read(&mut writer_from(&mut buf)).unwrap(), 1);
+                assert_eq!(&buf[..1], &[2]);
+            },
+            Ordering::WriteThenRead,
+        );
+    }
+
+    #[ktest]
+    fn test_read_closed() {
+        test_blocking(
+            drop,
+            |reader| {
+                let mut buf = [0; 1];
+                assert_eq!(reader.read(&mut writer_from(&mut buf)).unwrap(), 0);
+            },
+            Ordering::ReadThenWrite,
+        );
+    }
+
+    #[ktest]
+    fn test_write_closed() {
+        test_blocking(
+            |writer| {
+                assert_eq!(writer.write(&mut reader_from(&[1, 2, 3])).unwrap(), 2);
+                assert_eq!(
+                    writer.write(&mut reader_from(&[2])).unwrap_err().error(),
+                    Errno::EPIPE
+                );
+            },
+            drop,
+            Ordering::WriteThenRead,
+        );
+    }
+
+    #[ktest]
+    fn test_write_atomicity() {
+        test_blocking(
+            |writer| {
+                assert_eq!(writer.write(&mut reader_from(&[1])).unwrap(), 1);
+                assert_eq!(writer.write(&mut reader_from(&[1, 2])).unwrap(), 2);
+            },
+            |reader| {
+                let mut buf = [0; 3];
+                assert_eq!(reader.read(&mut writer_from(&mut buf)).unwrap(), 1);
+                assert_eq!(&buf[..1], &[1]);
+                assert_eq!(reader.read(&mut writer_from(&mut buf)).unwrap(), 2);
+                assert_eq!(&buf[..2], &[1, 2]);
+            },
+            Ordering::WriteThenRead,
+        );
+    }
+
+    #[ktest]
+    fn test_push_and_peek_pages() {
+        let (reader, writer) = new_pair_with_capacity(PAGE_SIZE).unwrap();
+
+        let frame: UFrame = FrameAllocOptions::new().alloc_frame().unwrap().into();
+        frame
+            .writer()
+            .write(&mut VmReader::from([1, 2, 3].as_slice()));
+        let page = PipePage::new(frame, 1..3);
+        // A pipe of one page can hold only one queued page.
+        assert_eq!(writer.push_pages(&[page.clone(), page], true).unwrap(), 2);
+
+        let mut buf = [0; 3];
+        let peeked_len = reader
+            .peek_with(3, true, |page| {
+                Ok(page.reader().read(&mut VmWriter::from(buf.as_mut_slice())))
+            })
+            .unwrap();
+        assert_eq!(peeked_len, 2);
+        assert_eq!(&buf[..2], &[2, 3]);
+
+        assert_eq!(reader.read(&mut writer_from(&mut buf)).unwrap(), 2);
+        assert_eq!(&buf[..2], &[2, 3]);
+        assert_eq!(
+            reader
+                .consume_with(1, true, |page| Ok(page.len()))
+                .unwrap_err()
+                .error(),
+            Errno::EAGAIN
+        );
+    }
+
+    #[ktest]
+    fn test_set_capacity() {
+        let (reader, writer) = new_pair_with_capacity(PAGE_SIZE).unwrap();
+
+        writer.set_capacity(PAGE_SIZE * 4).unwrap();
+        assert_eq!(reader.capacity(), PAGE_SIZE * 4);
+
+        let data = vec![1; PAGE_SIZE * 2];
+        assert_eq!(writer.write(&mut reader_from(&data)).unwrap(), data.len());
+        // The pipe cannot shrink below the pages in use.
+        assert_eq!(
+            reader.set_capacity(PAGE_SIZE).unwrap_err().error(),
+            Errno::EBUSY
+        );
+        reader.set_capacity(PAGE_SIZE * 2).unwrap();
+        assert_eq!(writer.capacity(), PAGE_SIZE * 2);
+    }
+
+    fn reader_from(buf: &[u8]) -> VmReader {
+        VmReader::from(buf).to_fallible()
+    }
+
+    fn writer_from(buf: &mut [u8]) -> VmWriter {
+        VmWriter::from(buf).to_fallible()
+    }
+}
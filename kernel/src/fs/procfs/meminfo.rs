@@ -11,7 +11,7 @@ use alloc::format;
 use crate::{
     fs::{
         procfs::template::{FileOps, ProcFileBuilder},
-        utils::Inode,
+        utils::{nr_cached_pages, Inode},
     },
     prelude::*,
 };
@@ -32,14 +32,17 @@ impl FileOps for MemInfoFileOps {
         // An estimation of how much memory is available for starting new
         // applications, without disk operations.
         let available = osdk_frame_allocator::load_total_free_size();
+        // The memory used by the page caches.
+        let cached = nr_cached_pages() * PAGE_SIZE;
 
         // Convert the values to KiB.
         let total = total / 1024;
         let available = available / 1024;
         let free = total - available;
+        let cached = cached / 1024;
         let output = format!(
-            "MemTotal:\t{} kB\nMemFree:\t{} kB\nMemAvailable:\t{} kB\n",
-            total, free, available
+            "MemTotal:\t{} kB\nMemFree:\t{} kB\nMemAvailable:\t{} kB\nCached:\t\t{} kB\n",
+            total, free, available, cached
         );
         Ok(output.into_bytes())
     }
@@ -10,9 +10,11 @@ use self::{
     meminfo::MemInfoFileOps,
     pid::PidDirOps,
     self_::SelfSymOps,
+    stat::StatFileOps,
     sys::SysDirOps,
     template::{DirOps, ProcDir, ProcDirBuilder, ProcSymBuilder, SymOps},
     thread_self::ThreadSelfSymOps,
+    vmstat::VmStatFileOps,
 };
 use crate::{
     events::Observer,
@@ -33,15 +35,20 @@ mod loadavg;
 mod meminfo;
 mod pid;
 mod self_;
+mod stat;
 mod sys;
+#[cfg(feature = "syscall_stats")]
+mod syscall_stats;
 mod template;
 mod thread_self;
+mod vmstat;
 
 pub(super) fn init() {
     FILESYSTEM_TYPES.call_once(|| {
         vec![
             FileSystemType::new("proc", true),
             FileSystemType::new("ramfs", true),
+            FileSystemType::new("tmpfs", true),
             FileSystemType::new("devpts", true),
             FileSystemType::new("ext2", false),
             FileSystemType::new("exfat", false),
@@ -120,6 +127,11 @@ impl Observer<PidEvent> for ProcDir<RootDirOps> {
 
 impl DirOps for RootDirOps {
     fn lookup_child(&self, this_ptr: Weak<dyn Inode>, name: &str) -> Result<Arc<dyn Inode>> {
+        #[cfg(feature = "syscall_stats")]
+        if name == "syscall_stats" {
+            return Ok(syscall_stats::SyscallStatsFileOps::new_inode(this_ptr));
+        }
+
         let child = if name == "self" {
             SelfSymOps::new_inode(this_ptr.clone())
         } else if name == "sys" {
@@ -134,6 +146,10 @@ impl DirOps for RootDirOps {
             LoadAvgFileOps::new_inode(this_ptr.clone())
         } else if name == "cpuinfo" {
             CpuInfoFileOps::new_inode(this_ptr.clone())
+        } else if name == "stat" {
+            StatFileOps::new_inode(this_ptr.clone())
+        } else if name == "vmstat" {
+            VmStatFileOps::new_inode(this_ptr.clone())
         } else if let Ok(pid) = name.parse::<Pid>() {
             let process_ref =
                 process_table::get_process(pid).ok_or_else(|| Error::new(Errno::ENOENT))?;
@@ -164,6 +180,13 @@ impl DirOps for RootDirOps {
             .put_entry_if_not_found("loadavg", || LoadAvgFileOps::new_inode(this_ptr.clone()));
         cached_children
             .put_entry_if_not_found("cpuinfo", || CpuInfoFileOps::new_inode(this_ptr.clone()));
+        cached_children.put_entry_if_not_found("stat", || StatFileOps::new_inode(this_ptr.clone()));
+        cached_children
+            .put_entry_if_not_found("vmstat", || VmStatFileOps::new_inode(this_ptr.clone()));
+        #[cfg(feature = "syscall_stats")]
+        cached_children.put_entry_if_not_found("syscall_stats", || {
+            syscall_stats::SyscallStatsFileOps::new_inode(this_ptr.clone())
+        });
         for process in process_table::process_table_mut().iter() {
             let pid = process.pid().to_string();
             cached_children.put_entry_if_not_found(&pid, || {
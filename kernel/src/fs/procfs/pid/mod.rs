@@ -18,6 +18,7 @@ mod cmdline;
 mod comm;
 mod exe;
 mod fd;
+mod schedstat;
 mod stat;
 mod status;
 mod task;
@@ -65,6 +66,7 @@ impl DirOps for PidDirOps {
             "cmdline" => CmdlineFileOps::new_inode(self.0.clone(), this_ptr.clone()),
             "status" => status::StatusFileOps::new_inode(self.0.clone(), this_ptr.clone()),
             "stat" => stat::StatFileOps::new_inode(self.0.clone(), this_ptr.clone()),
+            "schedstat" => schedstat::SchedStatFileOps::new_inode(self.0.clone(), this_ptr.clone()),
             "task" => TaskDirOps::new_inode(self.0.clone(), this_ptr.clone()),
             _ => return_errno!(Errno::ENOENT),
         };
@@ -95,6 +97,9 @@ impl DirOps for PidDirOps {
         cached_children.put_entry_if_not_found("stat", || {
             stat::StatFileOps::new_inode(self.0.clone(), this_ptr.clone())
         });
+        cached_children.put_entry_if_not_found("schedstat", || {
+            schedstat::SchedStatFileOps::new_inode(self.0.clone(), this_ptr.clone())
+        });
         cached_children.put_entry_if_not_found("task", || {
             TaskDirOps::new_inode(self.0.clone(), this_ptr.clone())
         });
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use core::fmt::Write;
+
+use crate::{
+    fs::{
+        procfs::template::{FileOps, ProcFileBuilder},
+        utils::Inode,
+    },
+    prelude::*,
+    process::posix_thread::AsPosixThread,
+    time::Clock,
+    Process,
+};
+
+/// Represents the inode at `/proc/[pid]/schedstat`.
+///
+/// The statistics are of the main thread of the process.
+/// See <https://docs.kernel.org/scheduler/sched-stats.html>.
+///
+/// Fields:
+/// - run time     : Time spent on the CPU (nanoseconds).
+/// - wait time    : Time spent waiting on a runqueue (nanoseconds), which
+///   is not tracked yet and is always zero.
+/// - timeslices   : Number of timeslices run on a CPU.
+pub struct SchedStatFileOps(Arc<Process>);
+
+impl SchedStatFileOps {
+    pub fn new_inode(process_ref: Arc<Process>, parent: Weak<dyn Inode>) -> Arc<dyn Inode> {
+        ProcFileBuilder::new(Self(process_ref))
+            .parent(parent)
+            .build()
+            .unwrap()
+    }
+}
+
+impl FileOps for SchedStatFileOps {
+    fn data(&self) -> Result<Vec<u8>> {
+        let main_thread = self.0.main_thread();
+        let posix_thread = main_thread.as_posix_thread().unwrap();
+
+        let run_time = posix_thread.prof_clock().read_time().as_nanos();
+        let nr_timeslices = main_thread.nr_switches();
+
+        let mut schedstat_output = String::new();
+        writeln!(schedstat_output, "{} 0 {}", run_time, nr_timeslices).unwrap();
+        Ok(schedstat_output.into_bytes())
+    }
+}
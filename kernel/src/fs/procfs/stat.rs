@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! This module offers `/proc/stat` file support, which tells the user space
+//! about the kernel and system statistics since boot.
+//!
+//! Only the following fields are supported: the `cpu` lines (in which the
+//! `nice`, `iowait`, `irq`, `softirq`, `steal`, `guest` and `guest_nice`
+//! columns are always zero), `ctxt`, `btime`, `processes` and `procs_running`.
+//!
+//! Reference: <https://man7.org/linux/man-pages/man5/proc_stat.5.html>
+
+use alloc::format;
+use core::fmt::Write;
+
+use ostd::{arch::timer::TIMER_FREQ, cpu::all_cpus, task::nr_context_switches};
+
+use crate::{
+    fs::{
+        procfs::template::{FileOps, ProcFileBuilder},
+        utils::Inode,
+    },
+    prelude::*,
+    process::posix_thread,
+    sched::{self, CpuTime},
+    time::{
+        clocks::{MonotonicClock, RealTimeClock},
+        Clock,
+    },
+};
+
+/// The unit of the CPU time reported to the user space, in ticks per second.
+const USER_HZ: u64 = 100;
+
+/// Represents the inode at `/proc/stat`.
+pub struct StatFileOps;
+
+impl StatFileOps {
+    pub fn new_inode(parent: Weak<dyn Inode>) -> Arc<dyn Inode> {
+        ProcFileBuilder::new(Self).parent(parent).build().unwrap()
+    }
+}
+
+impl FileOps for StatFileOps {
+    fn data(&self) -> Result<Vec<u8>> {
+        let mut output = String::new();
+
+        let cpu_times: Vec<_> = all_cpus().map(sched::cpu_time).collect();
+        let total = cpu_times
+            .iter()
+            .fold(CpuTime::default(), |total, cpu_time| CpuTime {
+                user: total.user + cpu_time.user,
+                system: total.system + cpu_time.system,
+                idle: total.idle + cpu_time.idle,
+            });
+        write_cpu_line(&mut output, "cpu ", &total);
+        for (cpu_id, cpu_time) in cpu_times.iter().enumerate() {
+            write_cpu_line(&mut output, &format!("cpu{}", cpu_id), cpu_time);
+        }
+
+        let boot_time = RealTimeClock::get()
+            .read_time()
+            .saturating_sub(MonotonicClock::get().read_time());
+        let (nr_queued, nr_running) = sched::nr_queued_and_running();
+
+        writeln!(output, "ctxt {}", nr_context_switches()).unwrap();
+        writeln!(output, "btime {}", boot_time.as_secs()).unwrap();
+        writeln!(output, "processes {}", posix_thread::last_tid()).unwrap();
+        writeln!(output, "procs_running {}", nr_queued + nr_running).unwrap();
+
+        Ok(output.into_bytes())
+    }
+}
+
+fn write_cpu_line(output: &mut String, name: &str, cpu_time: &CpuTime) {
+    writeln!(
+        output,
+        "{} {} 0 {} {} 0 0 0 0 0 0",
+        name,
+        to_user_hz(cpu_time.user),
+        to_user_hz(cpu_time.system),
+        to_user_hz(cpu_time.idle),
+    )
+    .unwrap();
+}
+
+fn to_user_hz(ticks: u64) -> u64 {
+    ticks * USER_HZ / TIMER_FREQ
+}
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! This module offers `/proc/syscall_stats` file support, which tells the user
+//! space about the counts and the latencies of the syscalls since boot.
+//!
+//! The file exists only if the kernel is built with the `syscall_stats` feature.
+//! Each line describes a syscall that has been handled at least once, with the
+//! following fields:
+//!
+//! ```text
+//! <name> <count> <total cycles> <bucket 0> <bucket 1> ... <bucket 31>
+//! ```
+//!
+//! The `i`-th bucket counts the syscalls that took `[2^i, 2^(i+1))` TSC cycles.
+//! The first line is a comment that tells the TSC frequency in Hz.
+
+use core::fmt::Write;
+
+use crate::{
+    fs::{
+        procfs::template::{FileOps, ProcFileBuilder},
+        utils::Inode,
+    },
+    prelude::*,
+    syscall::syscall_stats,
+};
+
+/// Represents the inode at `/proc/syscall_stats`.
+pub struct SyscallStatsFileOps;
+
+impl SyscallStatsFileOps {
+    pub fn new_inode(parent: Weak<dyn Inode>) -> Arc<dyn Inode> {
+        ProcFileBuilder::new(Self).parent(parent).build().unwrap()
+    }
+}
+
+impl FileOps for SyscallStatsFileOps {
+    fn data(&self) -> Result<Vec<u8>> {
+        let mut output = String::new();
+        writeln!(output, "# tsc_freq {}", ostd::arch::tsc_freq()).unwrap();
+
+        for stat in syscall_stats() {
+            write!(output, "{} {} {}", stat.name, stat.count, stat.total_cycles).unwrap();
+            for bucket in stat.histogram {
+                write!(output, " {}", bucket).unwrap();
+            }
+            writeln!(output).unwrap();
+        }
+
+        Ok(output.into_bytes())
+    }
+}
@@ -160,12 +160,14 @@ impl<D: DirOps + 'static> Inode for ProcDir<D> {
         } else if is_dotdot(name) {
             self.parent().unwrap_or(self.this())
         } else {
+            if let Some(inode) = find_cached_child(&self.cached_children.read(), name) {
+                return Ok(inode);
+            }
+
             let mut cached_children = self.cached_children.write();
-            if let Some((_, inode)) = cached_children
-                .iter()
-                .find(|(child_name, inode)| child_name.as_str() == name)
-            {
-                return Ok(inode.clone());
+            // Another thread may have looked up the child after we checked.
+            if let Some(inode) = find_cached_child(&cached_children, name) {
+                return Ok(inode);
             }
             let inode = self.inner.lookup_child(self.this.clone(), name)?;
             cached_children.put((String::from(name), inode.clone()));
@@ -183,6 +185,16 @@ impl<D: DirOps + 'static> Inode for ProcDir<D> {
     }
 }
 
+fn find_cached_child(
+    cached_children: &SlotVec<(String, Arc<dyn Inode>)>,
+    name: &str,
+) -> Option<Arc<dyn Inode>> {
+    cached_children
+        .iter()
+        .find(|(child_name, _)| child_name.as_str() == name)
+        .map(|(_, inode)| inode.clone())
+}
+
 pub trait DirOps: Sync + Send {
     fn lookup_child(&self, this_ptr: Weak<dyn Inode>, name: &str) -> Result<Arc<dyn Inode>> {
         Err(Error::new(Errno::ENOENT))
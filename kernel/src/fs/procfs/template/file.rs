@@ -75,6 +75,14 @@ impl<F: FileOps + 'static> Inode for ProcFile<F> {
         self.read_at(offset, writer)
     }
 
+    fn generate_contents(&self) -> Option<Result<Vec<u8>>> {
+        Some(self.inner.data())
+    }
+
+    fn generates_contents(&self) -> bool {
+        true
+    }
+
     fn write_at(&self, _offset: usize, _reader: &mut VmReader) -> Result<usize> {
         Err(Error::new(Errno::EPERM))
     }
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! This module offers `/proc/vmstat` file support, which tells the user space
+//! about the virtual memory statistics since boot.
+//!
+//! Besides a subset of the fields of Linux, the numbers of the completed block
+//! I/O requests and of the network packets are reported, with the names of
+//! `nr_bio_completed`, `nr_net_rx_packets`, `nr_net_tx_packets` and
+//! `nr_net_rx_dropped`.
+//!
+//! Reference: <https://man7.org/linux/man-pages/man5/proc_vmstat.5.html>
+
+use core::fmt::Write;
+
+use aster_block::{bio::bio_stats, SECTOR_SIZE};
+use ostd::mm::frame::allocator::{nr_allocated_frames, nr_deallocated_frames};
+
+use crate::{
+    fs::{
+        procfs::template::{FileOps, ProcFileBuilder},
+        utils::{nr_cached_pages, Inode},
+    },
+    prelude::*,
+    vm::vmar::nr_page_faults,
+};
+
+/// Represents the inode at `/proc/vmstat`.
+pub struct VmStatFileOps;
+
+impl VmStatFileOps {
+    pub fn new_inode(parent: Weak<dyn Inode>) -> Arc<dyn Inode> {
+        ProcFileBuilder::new(Self).parent(parent).build().unwrap()
+    }
+}
+
+impl FileOps for VmStatFileOps {
+    fn data(&self) -> Result<Vec<u8>> {
+        let nr_free_pages = osdk_frame_allocator::load_total_free_size() / PAGE_SIZE;
+        let bio_stats = bio_stats();
+        let (nr_rx_packets, nr_tx_packets) = aster_network::packet_stats();
+
+        // The paged in and out data are in KiB.
+        let sectors_to_kib = |nr_sectors: u64| nr_sectors * SECTOR_SIZE as u64 / 1024;
+
+        let mut output = String::new();
+        writeln!(output, "nr_free_pages {}", nr_free_pages).unwrap();
+        writeln!(output, "nr_file_pages {}", nr_cached_pages()).unwrap();
+        writeln!(
+            output,
+            "pgpgin {}",
+            sectors_to_kib(bio_stats.nr_read_sectors)
+        )
+        .unwrap();
+        writeln!(
+            output,
+            "pgpgout {}",
+            sectors_to_kib(bio_stats.nr_written_sectors)
+        )
+        .unwrap();
+        writeln!(output, "pgalloc_normal {}", nr_allocated_frames()).unwrap();
+        writeln!(output, "pgfree {}", nr_deallocated_frames()).unwrap();
+        writeln!(output, "pgfault {}", nr_page_faults()).unwrap();
+        writeln!(output, "nr_bio_completed {}", bio_stats.nr_completed).unwrap();
+        writeln!(output, "nr_net_rx_packets {}", nr_rx_packets).unwrap();
+        writeln!(output, "nr_net_tx_packets {}", nr_tx_packets).unwrap();
+        writeln!(
+            output,
+            "nr_net_rx_dropped {}",
+            aster_network::nr_rx_dropped_packets()
+        )
+        .unwrap();
+
+        Ok(output.into_bytes())
+    }
+}
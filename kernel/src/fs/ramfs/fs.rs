@@ -32,6 +32,7 @@ use crate::{
     prelude::*,
     process::{signal::PollHandle, Gid, Uid},
     time::clocks::RealTimeCoarseClock,
+    util::PerCpuCounter,
     vm::vmo::Vmo,
 };
 
@@ -43,10 +44,81 @@ pub struct RamFS {
     root: Arc<RamInode>,
     /// An inode allocator
     inode_allocator: AtomicU64,
+    /// The usage and the limits of the blocks and inodes
+    usage: RamFsUsage,
+}
+
+/// The limits of a `RamFS`, like the `size` and `nr_inodes` mount options of tmpfs.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct RamFsLimits {
+    /// The maximum number of blocks used by the regular files.
+    pub max_blocks: Option<usize>,
+    /// The maximum number of inodes.
+    pub max_inodes: Option<usize>,
+}
+
+/// The usage of the blocks and inodes of a `RamFS`.
+///
+/// The usage is counted per CPU, so the files created and written on different CPUs do not
+/// contend for the same counters. The limits are checked against the sum of the counters, which
+/// may be exceeded slightly by concurrent allocations.
+struct RamFsUsage {
+    limits: RamFsLimits,
+    used_blocks: PerCpuCounter,
+    used_inodes: PerCpuCounter,
+}
+
+impl RamFsUsage {
+    fn new(limits: RamFsLimits) -> Self {
+        Self {
+            limits,
+            used_blocks: PerCpuCounter::new(0),
+            // The root inode.
+            used_inodes: PerCpuCounter::new(1),
+        }
+    }
+
+    fn alloc_blocks(&self, nr_blocks: usize) -> Result<()> {
+        if exceeds(&self.used_blocks, nr_blocks, self.limits.max_blocks) {
+            return_errno_with_message!(Errno::ENOSPC, "the ramfs has no free blocks");
+        }
+        self.used_blocks.add(nr_blocks as i64);
+        Ok(())
+    }
+
+    /// Updates the usage for a file whose blocks change from `old_blocks` to `new_blocks`,
+    /// without checking the limit.
+    fn update_blocks(&self, old_blocks: usize, new_blocks: usize) {
+        self.used_blocks.add(new_blocks as i64 - old_blocks as i64);
+    }
+
+    fn alloc_inode(&self) -> Result<()> {
+        if exceeds(&self.used_inodes, 1, self.limits.max_inodes) {
+            return_errno_with_message!(Errno::ENOSPC, "the ramfs has no free inodes");
+        }
+        self.used_inodes.add(1);
+        Ok(())
+    }
+
+    fn free_inode(&self) {
+        self.used_inodes.add(-1);
+    }
+}
+
+/// Returns whether allocating `count` more exceeds the limit `max`.
+fn exceeds(used: &PerCpuCounter, count: usize, max: Option<usize>) -> bool {
+    let Some(max) = max else {
+        return false;
+    };
+    used.sum().max(0) as usize + count > max
 }
 
 impl RamFS {
     pub fn new() -> Arc<Self> {
+        Self::with_limits(RamFsLimits::default())
+    }
+
+    pub fn with_limits(limits: RamFsLimits) -> Arc<Self> {
         Arc::new_cyclic(|weak_fs| Self {
             sb: SuperBlock::new(RAMFS_MAGIC, BLOCK_SIZE, NAME_MAX),
             root: Arc::new_cyclic(|weak_root| RamInode {
@@ -64,6 +136,7 @@ impl RamFS {
                 xattr: RamXattr::new(),
             }),
             inode_allocator: AtomicU64::new(ROOT_INO + 1),
+            usage: RamFsUsage::new(limits),
         })
     }
 
@@ -83,7 +156,20 @@ impl FileSystem for RamFS {
     }
 
     fn sb(&self) -> SuperBlock {
-        self.sb.clone()
+        let mut sb = self.sb.clone();
+        let usage = &self.usage;
+        if let Some(max_blocks) = usage.limits.max_blocks {
+            let used_blocks = usage.used_blocks.sum().max(0) as usize;
+            sb.blocks = max_blocks;
+            sb.bfree = max_blocks.saturating_sub(used_blocks);
+            sb.bavail = sb.bfree;
+        }
+        if let Some(max_inodes) = usage.limits.max_inodes {
+            let used_inodes = usage.used_inodes.sum().max(0) as usize;
+            sb.files = max_inodes;
+            sb.ffree = max_inodes.saturating_sub(used_inodes);
+        }
+        sb
     }
 
     fn flags(&self) -> FsFlags {
@@ -361,12 +447,8 @@ impl DirEntry {
                 *idx += 1;
             }
             // Read the normal child entries.
-            let start_idx = *idx;
-            for (offset_children, (name, child)) in self
-                .children
-                .idxes_and_items()
-                .skip_while(|(offset, _)| offset + NUM_SPECIAL_ENTRIES < start_idx)
-            {
+            let start_idx = *idx - NUM_SPECIAL_ENTRIES;
+            for (offset_children, (name, child)) in self.children.idxes_and_items_from(start_idx) {
                 let offset = offset_children + NUM_SPECIAL_ENTRIES;
                 visitor.visit(name.as_str().unwrap(), child.ino, child.typ, offset)?;
                 *idx = offset + 1;
@@ -491,6 +573,29 @@ impl RamInode {
             .ok_or(Error::new(Errno::ENOENT))?;
         Ok(inode)
     }
+
+    /// Charges the blocks of the file for growing to `nr_blocks` blocks.
+    fn expand_blocks(&self, nr_blocks: usize) -> Result<()> {
+        let mut inode_meta = self.metadata.lock();
+        if nr_blocks > inode_meta.blocks {
+            let fs = self.fs.upgrade().unwrap();
+            fs.usage.alloc_blocks(nr_blocks - inode_meta.blocks)?;
+            inode_meta.blocks = nr_blocks;
+        }
+        Ok(())
+    }
+}
+
+impl Drop for RamInode {
+    fn drop(&mut self) {
+        let Some(fs) = self.fs.upgrade() else {
+            return;
+        };
+        fs.usage.free_inode();
+        if self.typ == InodeType::File {
+            fs.usage.update_blocks(self.metadata.get_mut().blocks, 0);
+        }
+    }
 }
 
 impl PageCacheBackend for RamInode {
@@ -565,6 +670,7 @@ impl Inode for RamInode {
                 let should_expand_size = new_size > file_size;
                 let new_size_aligned = new_size.align_up(BLOCK_SIZE);
                 if should_expand_size {
+                    self.expand_blocks(new_size_aligned / BLOCK_SIZE)?;
                     page_cache.resize(new_size_aligned)?;
                 }
                 page_cache.pages().write(offset, reader)?;
@@ -575,7 +681,6 @@ impl Inode for RamInode {
                 inode_meta.set_ctime(now);
                 if should_expand_size {
                     inode_meta.size = new_size;
-                    inode_meta.blocks = new_size_aligned / BLOCK_SIZE;
                 }
                 write_len
             }
@@ -613,13 +718,17 @@ impl Inode for RamInode {
         }
 
         let page_cache = self.inner.as_file().unwrap();
+        self.expand_blocks(new_size.align_up(BLOCK_SIZE) / BLOCK_SIZE)?;
         page_cache.resize(new_size)?;
 
         let now = now();
         let mut inode_meta = self.metadata.lock();
         inode_meta.set_mtime(now);
         inode_meta.set_ctime(now);
+        let old_blocks = inode_meta.blocks;
         inode_meta.resize(new_size);
+        let fs = self.fs.upgrade().unwrap();
+        fs.usage.update_blocks(old_blocks, inode_meta.blocks);
         Ok(())
     }
 
@@ -701,6 +810,7 @@ impl Inode for RamInode {
             return_errno_with_message!(Errno::EEXIST, "entry exists");
         }
 
+        self.fs.upgrade().unwrap().usage.alloc_inode()?;
         let new_inode = match type_ {
             MknodType::CharDeviceNode(device) | MknodType::BlockDeviceNode(device) => {
                 RamInode::new_device(
@@ -734,6 +844,10 @@ impl Inode for RamInode {
         self.inner.as_device().cloned()
     }
 
+    fn as_named_pipe(&self) -> Option<&NamedPipe> {
+        self.inner.as_named_pipe()
+    }
+
     fn create(&self, name: &str, type_: InodeType, mode: InodeMode) -> Result<Arc<dyn Inode>> {
         if name.len() > NAME_MAX {
             return_errno!(Errno::ENAMETOOLONG);
@@ -748,6 +862,7 @@ impl Inode for RamInode {
         }
 
         let fs = self.fs.upgrade().unwrap();
+        fs.usage.alloc_inode()?;
         let new_inode = match type_ {
             InodeType::File => RamInode::new_file(&fs, mode, Uid::new_root(), Gid::new_root()),
             InodeType::SymLink => {
@@ -31,9 +31,9 @@ pub struct Channel<T> {
 /// For more details, see the description of `PIPE_BUF` in
 /// <https://man7.org/linux/man-pages/man7/pipe.7.html>.
 #[cfg(not(ktest))]
-const PIPE_BUF: usize = 4096;
+pub const PIPE_BUF: usize = 4096;
 #[cfg(ktest)]
-const PIPE_BUF: usize = 2;
+pub const PIPE_BUF: usize = 2;
 
 impl<T> Channel<T> {
     /// Creates a new channel with the given capacity.
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! Helpers for direct I/O that transfers data by DMA to and from user buffers.
+
+use ostd::{
+    mm::{Fallible, VmReader, VmWriter, MAX_USERSPACE_VADDR},
+    task::Task,
+};
+
+use crate::{prelude::*, process::posix_thread::AsThreadLocal, vm::vmar::PinnedFrames};
+
+/// Pins the user pages that `writer` writes `len` bytes to.
+///
+/// See [`pin_user_pages`] for the details.
+pub fn pin_writer_pages(writer: &VmWriter<'_, Fallible>, len: usize) -> Option<PinnedFrames> {
+    debug_assert!(len <= writer.avail());
+    pin_user_pages(writer.cursor() as Vaddr, len, true)
+}
+
+/// Pins the user pages that `reader` reads `len` bytes from.
+///
+/// See [`pin_user_pages`] for the details.
+pub fn pin_reader_pages(reader: &VmReader<'_, Fallible>, len: usize) -> Option<PinnedFrames> {
+    debug_assert!(len <= reader.remain());
+    pin_user_pages(reader.cursor() as Vaddr, len, false)
+}
+
+/// Pins the pages of the user buffer at `vaddr..vaddr + len` in the user
+/// space of the current task.
+///
+/// The returned frames can be the targets of DMA, which spares the copies
+/// through kernel buffers. The process cannot fork until they are dropped. If `is_write` is set, the frames are to be written
+/// by the device, so they are made private to the current process first.
+///
+/// Returns `None` if the buffer is not page-aligned, not in the user space,
+/// or not fully accessible. The callers should fall back to copying in this
+/// case, which reports the faults on inaccessible buffers as usual.
+fn pin_user_pages(vaddr: Vaddr, len: usize, is_write: bool) -> Option<PinnedFrames> {
+    if len == 0 || vaddr % PAGE_SIZE != 0 || len % PAGE_SIZE != 0 {
+        return None;
+    }
+    if vaddr.checked_add(len)? > MAX_USERSPACE_VADDR {
+        return None;
+    }
+
+    let current_task = Task::current()?;
+    let root_vmar = current_task.as_thread_local()?.root_vmar().borrow();
+    root_vmar
+        .as_ref()?
+        .pin_pages(vaddr..vaddr + len, is_write)
+        .ok()
+}
@@ -6,7 +6,7 @@ use core::{any::TypeId, time::Duration};
 
 use aster_rights::Full;
 use core2::io::{Error as IoError, ErrorKind as IoErrorKind, Result as IoResult, Write};
-use ostd::task::Task;
+use ostd::{mm::UntypedMem, task::Task};
 
 use super::{
     AccessMode, DirentVisitor, FallocMode, FileSystem, IoctlCmd, XattrName, XattrNamespace,
@@ -14,11 +14,14 @@ use super::{
 };
 use crate::{
     events::IoEvents,
-    fs::device::{Device, DeviceType},
+    fs::{
+        device::{Device, DeviceType},
+        named_pipe::NamedPipe,
+    },
     prelude::*,
     process::{posix_thread::AsPosixThread, signal::PollHandle, Gid, Uid},
     time::clocks::RealTimeCoarseClock,
-    vm::vmo::Vmo,
+    vm::vmo::{CommitFlags, Vmo},
 };
 
 #[repr(u16)]
@@ -393,6 +396,24 @@ pub trait Inode: Any + Sync + Send {
         Err(Error::new(Errno::EISDIR))
     }
 
+    /// Generates the contents, if the contents of the inode are generated on the fly.
+    ///
+    /// An opened file generates the contents when it reads from the start, and serves the reads
+    /// at other offsets from the contents generated last time, like `seq_file` in Linux. So the
+    /// inodes that generate their contents on each read (e.g., those in procfs) should implement
+    /// this method, to avoid generating the contents again for each piece that is read.
+    fn generate_contents(&self) -> Option<Result<Vec<u8>>> {
+        None
+    }
+
+    /// Returns whether the contents of the inode are generated on the fly.
+    ///
+    /// The inodes that implement [`Self::generate_contents`] should return `true`. The value
+    /// must not change over the lifetime of the inode.
+    fn generates_contents(&self) -> bool {
+        false
+    }
+
     fn write_at(&self, offset: usize, reader: &mut VmReader) -> Result<usize> {
         Err(Error::new(Errno::EISDIR))
     }
@@ -401,6 +422,21 @@ pub trait Inode: Any + Sync + Send {
         Err(Error::new(Errno::EISDIR))
     }
 
+    /// Copies at most `len` bytes at `src_offset` of `src` to `offset` of this file.
+    ///
+    /// Returns the number of bytes copied, which is less than `len` if the end of
+    /// `src` is reached. The default implementation copies the data from the page
+    /// cache of `src` without any intermediate buffers.
+    fn copy_range_from(
+        &self,
+        src: &dyn Inode,
+        src_offset: usize,
+        offset: usize,
+        len: usize,
+    ) -> Result<usize> {
+        copy_range_by_page_cache(src, src_offset, self, offset, len)
+    }
+
     fn create(&self, name: &str, type_: InodeType, mode: InodeMode) -> Result<Arc<dyn Inode>> {
         Err(Error::new(Errno::ENOTDIR))
     }
@@ -413,6 +449,11 @@ pub trait Inode: Any + Sync + Send {
         None
     }
 
+    /// Returns the pipe if the inode is a named pipe (FIFO).
+    fn as_named_pipe(&self) -> Option<&NamedPipe> {
+        None
+    }
+
     fn readdir_at(&self, offset: usize, visitor: &mut dyn DirentVisitor) -> Result<usize> {
         Err(Error::new(Errno::ENOTDIR))
     }
@@ -597,6 +638,70 @@ impl dyn Inode {
     }
 }
 
+/// Copies at most `len` bytes at `src_offset` of `src` to `offset` of `dst`.
+///
+/// The cached pages of `src` are written to `dst` directly. If `src` has no
+/// page cache, the data are copied through an intermediate buffer instead.
+pub fn copy_range_by_page_cache<I: Inode + ?Sized>(
+    src: &dyn Inode,
+    src_offset: usize,
+    dst: &I,
+    offset: usize,
+    len: usize,
+) -> Result<usize> {
+    let len = len.min(src.size().saturating_sub(src_offset));
+    let Some(page_cache) = src.page_cache() else {
+        return copy_range_by_buffer(src, src_offset, dst, offset, len);
+    };
+
+    let mut copied_len = 0;
+    while copied_len < len {
+        let pos = src_offset + copied_len;
+        let page_offset = pos % PAGE_SIZE;
+        let copy_len = (PAGE_SIZE - page_offset).min(len - copied_len);
+
+        let frame = page_cache.commit_on(pos / PAGE_SIZE, CommitFlags::empty())?;
+        let mut reader = frame.reader();
+        reader.skip(page_offset).limit(copy_len);
+        let written_len = dst.write_at(offset + copied_len, &mut reader.to_fallible())?;
+        copied_len += written_len;
+        if written_len < copy_len {
+            break;
+        }
+    }
+
+    Ok(copied_len)
+}
+
+fn copy_range_by_buffer<I: Inode + ?Sized>(
+    src: &dyn Inode,
+    src_offset: usize,
+    dst: &I,
+    offset: usize,
+    len: usize,
+) -> Result<usize> {
+    const MAX_BUF_LEN: usize = 16 * PAGE_SIZE;
+
+    let mut buf = vec![0u8; len.min(MAX_BUF_LEN)];
+    let mut copied_len = 0;
+    while copied_len < len {
+        let buf_len = buf.len().min(len - copied_len);
+        let read_len = src.read_bytes_at(src_offset + copied_len, &mut buf[..buf_len])?;
+        if read_len == 0 {
+            break;
+        }
+
+        let mut reader = VmReader::from(&buf[..read_len]).to_fallible();
+        let written_len = dst.write_at(offset + copied_len, &mut reader)?;
+        copied_len += written_len;
+        if written_len < read_len {
+            break;
+        }
+    }
+
+    Ok(copied_len)
+}
+
 pub struct InodeWriter<'a> {
     inner: &'a dyn Inode,
     offset: usize,
@@ -43,4 +43,8 @@ pub enum IoctlCmd {
     TIOCGPTPEER = 0x40045441,
     /// Get tdx report using TDCALL
     TDXGETREPORT = 0xc4405401,
+    /// Set the busy poll parameters of an epoll file
+    EPIOCSPARAMS = 0x40088a01,
+    /// Get the busy poll parameters of an epoll file
+    EPIOCGPARAMS = 0x80088a02,
 }
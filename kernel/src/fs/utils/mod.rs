@@ -3,17 +3,22 @@
 //! VFS components
 
 pub use access_mode::AccessMode;
-pub use channel::{Channel, Consumer, Producer};
+pub use channel::{Channel, Consumer, Producer, PIPE_BUF};
 pub use creation_flags::CreationFlags;
+pub use direct_io::{pin_reader_pages, pin_writer_pages};
 pub use dirent_visitor::DirentVisitor;
 pub use direntry_vec::DirEntryVecExt;
 pub use falloc_mode::FallocMode;
 pub use file_creation_mask::FileCreationMask;
 pub use flock::{FlockItem, FlockList, FlockType};
 pub use fs::{FileSystem, FsFlags, SuperBlock};
-pub use inode::{Extension, Inode, InodeMode, InodeType, Metadata, MknodType, Permission};
+pub use inode::{
+    copy_range_by_page_cache, Extension, Inode, InodeMode, InodeType, Metadata, MknodType,
+    Permission,
+};
 pub use ioctl::IoctlCmd;
-pub use page_cache::{CachePage, PageCache, PageCacheBackend};
+pub use page_cache::{CachePage, PageCache, PageCacheBackend, ReadaheadStats};
+pub use page_reclaim::{nr_cached_pages, register_shrinker, Shrinker};
 pub use random_test::{generate_random_operation, new_fs_in_memory};
 pub use range_lock::{
     FileRange, RangeLockItem, RangeLockItemBuilder, RangeLockList, RangeLockType, OFFSET_MAX,
@@ -27,6 +32,7 @@ pub use xattr::{
 mod access_mode;
 mod channel;
 mod creation_flags;
+mod direct_io;
 mod dirent_visitor;
 mod direntry_vec;
 mod falloc_mode;
@@ -36,6 +42,8 @@ mod fs;
 mod inode;
 mod ioctl;
 mod page_cache;
+mod page_reclaim;
+mod page_writeback;
 mod random_test;
 mod range_lock;
 mod status_flags;
@@ -48,6 +56,12 @@ use core::{
 
 use crate::prelude::*;
 
+/// Spawns the kernel threads that reclaim and write back the pages of page caches.
+pub(super) fn lazy_init() {
+    page_reclaim::spawn_reclaimer();
+    page_writeback::spawn_flusher();
+}
+
 #[derive(Copy, PartialEq, Eq, Clone, Debug)]
 pub enum SeekFrom {
     Start(usize),
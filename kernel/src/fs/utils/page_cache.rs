@@ -5,7 +5,8 @@
 use core::{
     iter,
     ops::Range,
-    sync::atomic::{AtomicU8, Ordering},
+    sync::atomic::{AtomicBool, AtomicU8, Ordering},
+    time::Duration,
 };
 
 use align_ext::AlignExt;
@@ -14,12 +15,15 @@ use aster_rights::Full;
 use lru::LruCache;
 use ostd::{
     impl_untyped_frame_meta_for,
-    mm::{Frame, FrameAllocOptions, UFrame, VmIo},
+    mm::{Frame, FrameAllocOptions, Paddr, UFrame, VmIo},
+    sync::synchronize_rcu,
+    timer::Jiffies,
 };
 
+use super::{page_reclaim, page_writeback};
 use crate::{
     prelude::*,
-    vm::vmo::{get_page_idx_range, Pager, Vmo, VmoFlags, VmoOptions},
+    vm::vmo::{get_page_idx_range, AccessPattern, Pager, Vmo, VmoFlags, VmoOptions},
 };
 
 pub struct PageCache {
@@ -30,11 +34,12 @@ pub struct PageCache {
 impl PageCache {
     /// Creates an empty size page cache associated with a new backend.
     pub fn new(backend: Weak<dyn PageCacheBackend>) -> Result<Self> {
-        let manager = Arc::new(PageCacheManager::new(backend));
+        let manager = PageCacheManager::new(backend);
         let pages = VmoOptions::<Full>::new(0)
             .flags(VmoFlags::RESIZABLE)
             .pager(manager.clone())
             .alloc()?;
+        manager.attach_vmo(pages.dup());
         Ok(Self { pages, manager })
     }
 
@@ -43,11 +48,12 @@ impl PageCache {
     /// The `capacity` is the initial cache size required by the backend.
     /// This size usually corresponds to the size of the backend.
     pub fn with_capacity(capacity: usize, backend: Weak<dyn PageCacheBackend>) -> Result<Self> {
-        let manager = Arc::new(PageCacheManager::new(backend));
+        let manager = PageCacheManager::new(backend);
         let pages = VmoOptions::<Full>::new(capacity)
             .flags(VmoFlags::RESIZABLE)
             .pager(manager.clone())
             .alloc()?;
+        manager.attach_vmo(pages.dup());
         Ok(Self { pages, manager })
     }
 
@@ -70,11 +76,27 @@ impl PageCache {
         self.manager.discard_range(range)
     }
 
+    /// Drops the clean pages that lie entirely within the range from the page cache.
+    ///
+    /// Unlike [`Self::discard_range`], no data is lost, since the dirty pages are kept.
+    pub fn drop_clean_range(&self, range: Range<usize>) {
+        let start = range.start.div_ceil(PAGE_SIZE);
+        let end = range.end / PAGE_SIZE;
+        if start < end {
+            self.manager.drop_clean_pages(start..end);
+        }
+    }
+
     /// Returns the backend.
     pub fn backend(&self) -> Arc<dyn PageCacheBackend> {
         self.manager.backend()
     }
 
+    /// Returns the statistics of the readahead.
+    pub fn readahead_stats(&self) -> ReadaheadStats {
+        self.manager.readahead_stats()
+    }
+
     /// Resizes the current page cache to a target size.
     pub fn resize(&self, new_size: usize) -> Result<()> {
         // If the new size is smaller and not page-aligned,
@@ -128,6 +150,8 @@ impl Drop for PageCache {
         // In contrast, resizing the `VMO` to zero greatly accelerates the process.
         // We need to find out the underlying cause of this discrepancy.
         let _ = self.pages.resize(0);
+        // Break the reference cycle between the VMO and its pager.
+        self.manager.detach_vmo();
     }
 }
 
@@ -187,27 +211,78 @@ impl ReadaheadWindow {
     }
 }
 
+/// A readahead window whose reads have been submitted to the backend.
+struct InflightWindow {
+    range: Range<usize>,
+    waiter: BioWaiter,
+    /// The time when the reads are submitted.
+    submit_time: Duration,
+}
+
+impl InflightWindow {
+    fn is_completed(&self) -> bool {
+        (0..self.waiter.nreqs()).all(|i| self.waiter.status(i) != BioStatus::Submit)
+    }
+
+    fn is_successful(&self) -> bool {
+        (0..self.waiter.nreqs()).all(|i| self.waiter.status(i) == BioStatus::Complete)
+    }
+}
+
+/// The statistics of the readahead of a page cache.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct ReadaheadStats {
+    /// The number of readahead windows submitted.
+    pub nr_windows: usize,
+    /// The number of pages read ahead.
+    pub nr_pages: usize,
+    /// The number of commits that find the page ready in the cache.
+    pub nr_hits: usize,
+    /// The number of commits that wait for an in-flight readahead window.
+    pub nr_stalls: usize,
+    /// The number of commits that read the page synchronously.
+    pub nr_sync_reads: usize,
+    /// The moving average of the observed latencies of readahead windows.
+    pub avg_latency: Duration,
+}
+
 struct ReadaheadState {
-    /// Current readahead window.
+    /// The last readahead window, which the next window follows.
     ra_window: Option<ReadaheadWindow>,
+    /// The readahead windows in flight, in the order of submission.
+    ///
+    /// The readers only wait for the window that contains the requested
+    /// page, so the windows ahead of it keep being read in the background.
+    inflight: VecDeque<Arc<InflightWindow>>,
     /// Maximum window size.
     max_size: usize,
+    /// Maximum number of windows in flight.
+    max_depth: usize,
+    /// The access pattern advised by the user.
+    pattern: AccessPattern,
     /// The last page visited, used to determine sequential I/O.
     prev_page: Option<usize>,
-    /// Readahead requests waiter.
-    waiter: BioWaiter,
+    stats: ReadaheadStats,
 }
 
 impl ReadaheadState {
     const INIT_WINDOW_SIZE: usize = 4;
     const DEFAULT_MAX_SIZE: usize = 32;
+    /// The limit that the maximum window size can grow to.
+    const MAX_SIZE_LIMIT: usize = 256;
+    const DEFAULT_MAX_DEPTH: usize = 2;
+    /// The limit that the maximum number of windows in flight can grow to.
+    const MAX_DEPTH_LIMIT: usize = 4;
 
     pub fn new() -> Self {
         Self {
             ra_window: None,
+            inflight: VecDeque::new(),
             max_size: Self::DEFAULT_MAX_SIZE,
+            max_depth: Self::DEFAULT_MAX_DEPTH,
+            pattern: AccessPattern::Normal,
             prev_page: None,
-            waiter: BioWaiter::new(),
+            stats: ReadaheadStats::default(),
         }
     }
 
@@ -216,7 +291,25 @@ impl ReadaheadState {
         self.max_size = size;
     }
 
+    /// Sets the access pattern advised by the user.
+    ///
+    /// Sequential accesses read ahead with larger windows from the start,
+    /// while random accesses do not read ahead at all.
+    pub fn set_pattern(&mut self, pattern: AccessPattern) {
+        self.pattern = pattern;
+        self.max_size = match pattern {
+            AccessPattern::Sequential => Self::DEFAULT_MAX_SIZE * 2,
+            AccessPattern::Normal | AccessPattern::Random => Self::DEFAULT_MAX_SIZE,
+        };
+        self.max_depth = Self::DEFAULT_MAX_DEPTH;
+        self.ra_window = None;
+    }
+
     fn is_sequential(&self, idx: usize) -> bool {
+        if self.pattern == AccessPattern::Sequential {
+            return true;
+        }
+
         if let Some(prev) = self.prev_page {
             idx == prev || idx == prev + 1
         } else {
@@ -224,76 +317,111 @@ impl ReadaheadState {
         }
     }
 
-    /// The number of bio requests in waiter.
-    /// This number will be zero if there are no previous readahead.
-    pub fn request_number(&self) -> usize {
-        self.waiter.nreqs()
-    }
-
-    /// Checks for the previous readahead.
-    /// Returns true if the previous readahead has been completed.
-    pub fn prev_readahead_is_completed(&self) -> bool {
-        let nreqs = self.request_number();
-        if nreqs == 0 {
-            return false;
-        }
-
-        for i in 0..nreqs {
-            if self.waiter.status(i) == BioStatus::Submit {
-                return false;
+    /// Finishes the in-flight windows that have been completed.
+    ///
+    /// The pages of a successful window become ready for read. The pages of
+    /// a failed window are removed from the page cache, so they will be read
+    /// synchronously, which reports the error to the reader.
+    pub fn reap_completed(&mut self, pages: &mut MutexGuard<LruCache<usize, CachePage>>) {
+        let now = Jiffies::elapsed().as_duration();
+
+        // The windows may be completed out of order.
+        let mut i = 0;
+        while i < self.inflight.len() {
+            if !self.inflight[i].is_completed() {
+                i += 1;
+                continue;
             }
-        }
-        true
-    }
 
-    /// Waits for the previous readahead.
-    pub fn wait_for_prev_readahead(
-        &mut self,
-        pages: &mut MutexGuard<LruCache<usize, CachePage>>,
-    ) -> Result<()> {
-        if matches!(self.waiter.wait(), Some(BioStatus::Complete)) {
-            let Some(window) = &self.ra_window else {
-                return_errno!(Errno::EINVAL)
-            };
-            for idx in window.readahead_range() {
-                if let Some(page) = pages.get_mut(&idx) {
+            let window = self.inflight.remove(i).unwrap();
+            let is_successful = window.is_successful();
+            for idx in window.range.clone() {
+                // The page may have been overwritten during the readahead.
+                let Some(page) = pages
+                    .peek_mut(&idx)
+                    .filter(|page| page.load_state() == PageState::Uninit)
+                else {
+                    continue;
+                };
+                if is_successful {
                     page.store_state(PageState::UpToDate);
+                } else {
+                    pages.pop(&idx);
                 }
             }
-            self.waiter.clear();
-        } else {
-            return_errno!(Errno::EIO)
+
+            let latency = now.saturating_sub(window.submit_time);
+            self.stats.avg_latency = (self.stats.avg_latency * 7 + latency) / 8;
         }
+    }
 
-        Ok(())
+    /// Returns the in-flight window that contains the page.
+    pub fn inflight_window_of(&self, idx: usize) -> Option<Arc<InflightWindow>> {
+        self.inflight
+            .iter()
+            .find(|window| window.range.contains(&idx))
+            .cloned()
+    }
+
+    /// Records that a reader has to wait for an in-flight window.
+    ///
+    /// The readahead cannot keep up with the reader, so larger windows and
+    /// more windows in flight are used to cover the latency of the backend.
+    pub fn record_stall(&mut self) {
+        self.stats.nr_stalls += 1;
+
+        if self.max_size < Self::MAX_SIZE_LIMIT {
+            self.max_size = (self.max_size * 2).min(Self::MAX_SIZE_LIMIT);
+        } else {
+            self.max_depth = (self.max_depth + 1).min(Self::MAX_DEPTH_LIMIT);
+        }
     }
 
     /// Determines whether a new readahead should be performed.
-    /// We only consider readahead for sequential I/O now.
-    /// There should be at most one in-progress readahead.
-    pub fn should_readahead(&self, idx: usize, max_page: usize) -> bool {
-        if self.request_number() == 0 && self.is_sequential(idx) {
-            if let Some(cur_window) = &self.ra_window {
-                let trigger_readahead =
-                    idx == cur_window.lookahead_index() || idx == cur_window.readahead_index();
-                let next_window_exist = cur_window.readahead_range().end < max_page;
-                trigger_readahead && next_window_exist
-            } else {
-                let new_window_start = idx + 1;
-                new_window_start < max_page
+    ///
+    /// We only consider readahead for sequential I/O. The readahead is
+    /// triggered once the reader enters the last readahead window.
+    pub fn should_readahead(&mut self, idx: usize, max_page: usize) -> bool {
+        if self.pattern == AccessPattern::Random {
+            return false;
+        }
+
+        let is_sequential = self.is_sequential(idx);
+        if let Some(cur_window) = &self.ra_window {
+            let is_in_window =
+                idx >= cur_window.lookahead_index() && idx <= cur_window.readahead_index();
+            if !is_sequential && !is_in_window {
+                // Start over from the initial window upon the next sequential access.
+                self.ra_window = None;
+                return false;
             }
+            is_in_window && cur_window.readahead_index() < max_page
         } else {
-            false
+            is_sequential && idx + 1 < max_page
         }
     }
 
+    /// Determines whether one more window should be submitted after the last one.
+    fn can_extend(&self, max_page: usize) -> bool {
+        self.inflight.len() < self.max_depth
+            && self
+                .ra_window
+                .as_ref()
+                .is_some_and(|window| window.readahead_index() < max_page)
+    }
+
     /// Setup the new readahead window.
     pub fn setup_window(&mut self, idx: usize, max_page: usize) {
         let new_window = if let Some(cur_window) = &self.ra_window {
             cur_window.next(self.max_size, max_page)
         } else {
             let start_idx = idx + 1;
-            let init_size = Self::INIT_WINDOW_SIZE.min(self.max_size);
+            let init_size = match self.pattern {
+                AccessPattern::Sequential => self.max_size,
+                AccessPattern::Normal | AccessPattern::Random => {
+                    Self::INIT_WINDOW_SIZE.min(self.max_size)
+                }
+            };
             let end_idx = (start_idx + init_size).min(max_page);
             ReadaheadWindow::new(start_idx..end_idx)
         };
@@ -301,27 +429,67 @@ impl ReadaheadState {
     }
 
     /// Conducts the new readahead.
-    /// Sends the relevant read request and sets the relevant page in the page cache to `Uninit`.
+    ///
+    /// Sends the relevant read requests without waiting for them and inserts
+    /// the pages to the page cache as `Uninit`. The pages that are already in
+    /// the page cache are skipped.
+    ///
+    /// Readahead is only a hint, so failing to read ahead a page just stops
+    /// the window there.
     pub fn conduct_readahead(
         &mut self,
         pages: &mut MutexGuard<LruCache<usize, CachePage>>,
-        backend: Arc<dyn PageCacheBackend>,
-    ) -> Result<()> {
+        backend: &Arc<dyn PageCacheBackend>,
+        manager: &Weak<PageCacheManager>,
+    ) {
         let Some(window) = &self.ra_window else {
-            return_errno!(Errno::EINVAL)
+            return;
         };
-        for async_idx in window.readahead_range() {
-            let mut async_page = CachePage::alloc_uninit()?;
-            let pg_waiter = backend.read_page_async(async_idx, &async_page)?;
+        let range = window.readahead_range();
+        self.submit_reads(range, pages, backend, manager);
+    }
+
+    /// Sends the read requests of the pages in `range` that are not in the
+    /// page cache, and tracks them as an in-flight window.
+    fn submit_reads(
+        &mut self,
+        range: Range<usize>,
+        pages: &mut MutexGuard<LruCache<usize, CachePage>>,
+        backend: &Arc<dyn PageCacheBackend>,
+        manager: &Weak<PageCacheManager>,
+    ) {
+        let mut waiter = BioWaiter::new();
+        let mut nr_pages = 0;
+        for async_idx in range.clone() {
+            if pages.contains(&async_idx) {
+                continue;
+            }
+            let Ok(mut async_page) = CachePage::alloc_uninit() else {
+                break;
+            };
+            let Ok(pg_waiter) = backend.read_page_async(async_idx, &async_page) else {
+                break;
+            };
             if pg_waiter.nreqs() > 0 {
-                self.waiter.concat(pg_waiter);
+                waiter.concat(pg_waiter);
             } else {
                 // Some backends (e.g. RamFS) do not issue requests, but fill the page directly.
                 async_page.store_state(PageState::UpToDate);
             }
+            page_reclaim::add_page(manager, async_idx, &async_page);
             pages.put(async_idx, async_page);
+            nr_pages += 1;
+        }
+
+        self.stats.nr_windows += 1;
+        self.stats.nr_pages += nr_pages;
+        if waiter.nreqs() > 0 {
+            self.inflight.push_back(Arc::new(InflightWindow {
+                range,
+                waiter,
+                submit_time: Jiffies::elapsed().as_duration(),
+            }));
         }
-        Ok(())
     }
 
     /// Sets the last page visited.
@@ -330,19 +498,40 @@ impl ReadaheadState {
     }
 }
 
-struct PageCacheManager {
+pub(super) struct PageCacheManager {
     pages: Mutex<LruCache<usize, CachePage>>,
     backend: Weak<dyn PageCacheBackend>,
     ra_state: Mutex<ReadaheadState>,
+    /// The VMO of the page cache, through which the pages are reclaimed.
+    ///
+    /// It is detached when the page cache is dropped.
+    vmo: Mutex<Option<Vmo<Full>>>,
+    /// The lock held during writebacks.
+    ///
+    /// It ensures that [`Self::evict_range`] does not return before the
+    /// background writeback of the pages in the range completes.
+    writeback_lock: Mutex<()>,
+    this: Weak<Self>,
 }
 
 impl PageCacheManager {
-    pub fn new(backend: Weak<dyn PageCacheBackend>) -> Self {
-        Self {
+    pub fn new(backend: Weak<dyn PageCacheBackend>) -> Arc<Self> {
+        Arc::new_cyclic(|this| Self {
             pages: Mutex::new(LruCache::unbounded()),
             backend,
             ra_state: Mutex::new(ReadaheadState::new()),
-        }
+            vmo: Mutex::new(None),
+            writeback_lock: Mutex::new(()),
+            this: this.clone(),
+        })
+    }
+
+    fn attach_vmo(&self, vmo: Vmo<Full>) {
+        *self.vmo.lock() = Some(vmo);
+    }
+
+    fn detach_vmo(&self) {
+        self.vmo.lock().take();
     }
 
     pub fn backend(&self) -> Arc<dyn PageCacheBackend> {
@@ -361,17 +550,19 @@ impl PageCacheManager {
     pub fn evict_range(&self, range: Range<usize>) -> Result<()> {
         let page_idx_range = get_page_idx_range(&range);
 
+        let _writeback_guard = self.writeback_lock.lock();
         let mut bio_waiter = BioWaiter::new();
         let mut pages = self.pages.lock();
         let backend = self.backend();
         let backend_npages = backend.npages();
-        for idx in page_idx_range.start..page_idx_range.end {
-            if let Some(page) = pages.peek(&idx) {
-                if page.load_state() == PageState::Dirty && idx < backend_npages {
-                    let waiter = backend.write_page_async(idx, page)?;
-                    bio_waiter.concat(waiter);
-                }
-            }
+        let dirty_pages: Vec<(usize, CachePage)> = (page_idx_range.start..page_idx_range.end)
+            .filter_map(|idx| Some((idx, pages.peek(&idx)?.clone())))
+            .filter(|(idx, page)| page.load_state() == PageState::Dirty && *idx < backend_npages)
+            .collect();
+        for run in adjacent_runs(&dirty_pages) {
+            let (idx, frames) = run_frames(run);
+            let waiter = backend.write_pages_async(idx, &frames)?;
+            bio_waiter.concat(waiter);
         }
 
         if !matches!(bio_waiter.wait(), Some(BioStatus::Complete)) {
@@ -389,57 +580,309 @@ impl PageCacheManager {
     }
 
     fn ondemand_readahead(&self, idx: usize) -> Result<UFrame> {
-        let mut pages = self.pages.lock();
-        let mut ra_state = self.ra_state.lock();
         let backend = self.backend();
-        // Checks for the previous readahead.
-        if ra_state.prev_readahead_is_completed() {
-            ra_state.wait_for_prev_readahead(&mut pages)?;
-        }
-        // There are three possible conditions that could be encountered upon reaching here.
-        // 1. The requested page is ready for read in page cache.
-        // 2. The requested page is in previous readahead range, not ready for now.
-        // 3. The requested page is on disk, need a sync read operation here.
+        let mut is_stalled = false;
+
+        let (mut pages, mut ra_state) = loop {
+            let mut pages = self.pages.lock();
+            let mut ra_state = self.ra_state.lock();
+            // Checks for the previous readahead.
+            ra_state.reap_completed(&mut pages);
+
+            let window = match pages.peek(&idx) {
+                Some(page) if page.load_state() == PageState::Uninit => {
+                    ra_state.inflight_window_of(idx)
+                }
+                _ => None,
+            };
+            let Some(window) = window else {
+                break (pages, ra_state);
+            };
+
+            // The requested page is in an in-flight readahead window. Wait for
+            // the window without holding the locks, so the other readers and
+            // the readahead of the other windows can proceed.
+            if !is_stalled {
+                is_stalled = true;
+                ra_state.record_stall();
+            }
+            drop(ra_state);
+            drop(pages);
+            window.waiter.wait();
+        };
+
+        // There are two possible conditions that could be encountered upon reaching here.
+        // 1. The requested page is in page cache.
+        // 2. The requested page is on disk, need a sync read operation here.
         let frame = if let Some(page) = pages.get(&idx) {
-            // Cond 1 & 2.
-            if let PageState::Uninit = page.load_state() {
-                // Cond 2: We should wait for the previous readahead.
-                // If there is no previous readahead, an error must have occurred somewhere.
-                assert!(ra_state.request_number() != 0);
-                ra_state.wait_for_prev_readahead(&mut pages)?;
-                pages.get(&idx).unwrap().clone()
-            } else {
-                // Cond 1.
-                page.clone()
+            // Cond 1.
+            if !is_stalled {
+                ra_state.stats.nr_hits += 1;
             }
+            page.mark_referenced();
+            page.clone()
         } else {
-            // Cond 3.
+            // Cond 2.
             // Conducts the sync read operation.
             let page = if idx < backend.npages() {
                 let mut page = CachePage::alloc_uninit()?;
                 backend.read_page(idx, &page)?;
                 page.store_state(PageState::UpToDate);
+                ra_state.stats.nr_sync_reads += 1;
                 page
             } else {
                 CachePage::alloc_zero(PageState::Uninit)?
             };
             let frame = page.clone();
+            page_reclaim::add_page(&self.this, idx, &page);
             pages.put(idx, page);
             frame
         };
-        if ra_state.should_readahead(idx, backend.npages()) {
-            ra_state.setup_window(idx, backend.npages());
-            ra_state.conduct_readahead(&mut pages, backend)?;
+
+        let max_page = backend.npages();
+        if ra_state.should_readahead(idx, max_page) {
+            // Keep up to `max_depth` windows in flight.
+            for _ in 0..ra_state.max_depth {
+                ra_state.setup_window(idx, max_page);
+                ra_state.conduct_readahead(&mut pages, &backend, &self.this);
+                if !ra_state.can_extend(max_page) {
+                    break;
+                }
+            }
         }
         ra_state.set_prev_page(idx);
         Ok(frame.into())
     }
+
+    fn readahead_stats(&self) -> ReadaheadStats {
+        self.ra_state.lock().stats
+    }
+
+    /// Reads the pages in the range ahead, without waiting for them.
+    ///
+    /// The reads are submitted in windows of the maximum readahead size, and
+    /// do not disturb the readahead state of sequential accesses.
+    fn prefetch(&self, idx_range: Range<usize>) {
+        let Some(backend) = self.backend.upgrade() else {
+            return;
+        };
+        let max_nr_pages = ReadaheadState::MAX_SIZE_LIMIT * ReadaheadState::MAX_DEPTH_LIMIT;
+        let end = idx_range
+            .end
+            .min(backend.npages())
+            .min(idx_range.start.saturating_add(max_nr_pages));
+
+        let mut pages = self.pages.lock();
+        let mut ra_state = self.ra_state.lock();
+        ra_state.reap_completed(&mut pages);
+        let window_size = ra_state.max_size;
+        for start in (idx_range.start..end).step_by(window_size) {
+            let window = start..(start + window_size).min(end);
+            ra_state.submit_reads(window, &mut pages, &backend, &self.this);
+        }
+    }
+
+    /// Returns whether the page at `idx` is still the page at `paddr`.
+    pub(super) fn contains_page(&self, idx: usize, paddr: Paddr) -> bool {
+        self.pages
+            .lock()
+            .peek(&idx)
+            .is_some_and(|page| page.start_paddr() == paddr)
+    }
+
+    /// Drops the clean pages in the range from the page cache.
+    ///
+    /// The dirty pages, the pages being read and the pages used by others
+    /// (e.g., mapped to the user space) are kept.
+    pub fn drop_clean_pages(&self, idx_range: Range<usize>) {
+        let candidates: Vec<usize> = self
+            .pages
+            .lock()
+            .iter()
+            .filter(|(idx, page)| {
+                idx_range.contains(*idx) && page.load_state() == PageState::UpToDate
+            })
+            .map(|(idx, _)| *idx)
+            .collect();
+        self.evict_clean_pages(&candidates);
+    }
+
+    /// Tries to reclaim the pages scanned by the reclaimer.
+    ///
+    /// A page is reclaimed only if it is clean, not referenced since the last
+    /// scan and not used by anyone other than the page cache and its VMO.
+    pub(super) fn reclaim_pages(&self, entries: &[(usize, Paddr)]) -> Vec<page_reclaim::Verdict> {
+        use page_reclaim::Verdict;
+
+        let mut verdicts = Vec::with_capacity(entries.len());
+        let mut candidates = Vec::new();
+        {
+            let pages = self.pages.lock();
+            for &(idx, paddr) in entries {
+                let verdict = match pages.peek(&idx) {
+                    None => Verdict::Gone,
+                    Some(page) if page.start_paddr() != paddr => Verdict::Gone,
+                    Some(page) if page.test_and_clear_referenced() => Verdict::Activate,
+                    // The dirty pages are left to the flusher, and the
+                    // uninitialized pages are still being read.
+                    Some(page) if page.load_state() != PageState::UpToDate => Verdict::Keep,
+                    // The page is activated unless it is reclaimed below.
+                    Some(_) => {
+                        candidates.push(idx);
+                        Verdict::Activate
+                    }
+                };
+                verdicts.push(verdict);
+            }
+        }
+        for idx in self.evict_clean_pages(&candidates) {
+            if let Some(i) = entries.iter().position(|&(entry_idx, _)| entry_idx == idx) {
+                verdicts[i] = Verdict::Reclaimed;
+            }
+        }
+
+        verdicts
+    }
+
+    /// Evicts the clean pages at `idxs` from the VMO and the page cache.
+    ///
+    /// Returns the indices of the evicted pages. The pages that are used by
+    /// others or dirtied in the meantime are kept.
+    fn evict_clean_pages(&self, idxs: &[usize]) -> Vec<usize> {
+        if idxs.is_empty() {
+            return Vec::new();
+        }
+
+        // The page cache and the VMO cannot be locked at the same time, since
+        // the VMO calls into the page cache with its lock held.
+        let evicted = {
+            let vmo = self.vmo.lock();
+            let Some(vmo) = vmo.as_ref() else {
+                return Vec::new();
+            };
+            // The page cache holds an extra reference to each page.
+            vmo.evict_unused_pages(idxs, 1)
+        };
+        if evicted.is_empty() {
+            return Vec::new();
+        }
+
+        // The lockless readers of the VMO may still get the evicted pages
+        // before an RCU grace period passes.
+        synchronize_rcu();
+
+        let mut pages = self.pages.lock();
+        let mut dropped = Vec::with_capacity(evicted.len());
+        for (idx, frame) in evicted {
+            let Some(page) = pages.peek(&idx) else {
+                continue;
+            };
+            if page.start_paddr() != frame.start_paddr() {
+                continue;
+            }
+            // Only `frame` and the page cache hold the page. Otherwise, the
+            // page is being used, and it will be committed to the VMO again
+            // from the page cache on the next access.
+            if frame.reference_count() > 2 || page.load_state() != PageState::UpToDate {
+                continue;
+            }
+            pages.pop(&idx);
+            dropped.push(idx);
+        }
+
+        dropped
+    }
+
+    /// Writes back the dirty pages at `idxs` in the background.
+    ///
+    /// The pages are marked as clean before they are written, so that the
+    /// writes to them during the writeback dirty them again.
+    pub(super) fn writeback_pages(&self, idxs: &[usize]) {
+        let Some(backend) = self.backend.upgrade() else {
+            return;
+        };
+
+        let _writeback_guard = self.writeback_lock.lock();
+        let mut bio_waiter = BioWaiter::new();
+        let mut written = Vec::new();
+        {
+            let mut pages = self.pages.lock();
+            let backend_npages = backend.npages();
+            let mut dirty_pages = Vec::new();
+            for &idx in idxs {
+                if idx >= backend_npages {
+                    continue;
+                }
+                let Some(page) = pages.peek_mut(&idx) else {
+                    continue;
+                };
+                if page.load_state() != PageState::Dirty {
+                    continue;
+                }
+                page.store_state(PageState::UpToDate);
+                dirty_pages.push((idx, page.clone()));
+            }
+
+            dirty_pages.sort_unstable_by_key(|(idx, _)| *idx);
+            for run in adjacent_runs(&dirty_pages) {
+                let (idx, frames) = run_frames(run);
+                match backend.write_pages_async(idx, &frames) {
+                    Ok(waiter) => {
+                        bio_waiter.concat(waiter);
+                        written.extend_from_slice(run);
+                    }
+                    Err(_) => {
+                        // Redirty the pages to retry later.
+                        for (idx, mut page) in run.iter().cloned() {
+                            page.store_state(PageState::Dirty);
+                            page_writeback::add_dirty_page(&self.this, idx);
+                        }
+                    }
+                }
+            }
+        }
+        if written.is_empty() {
+            return;
+        }
+
+        if matches!(bio_waiter.wait(), Some(BioStatus::Complete)) {
+            return;
+        }
+
+        // Redirty the pages to retry later.
+        warn!("the background writeback of the page cache fails");
+        for (idx, mut page) in written {
+            if page.load_state() != PageState::Dirty {
+                page.store_state(PageState::Dirty);
+                page_writeback::add_dirty_page(&self.this, idx);
+            }
+        }
+    }
+}
+
+/// The maximum number of pages that are written back with a single request.
+const MAX_WRITE_RUN_PAGES: usize = 32;
+
+/// Splits the pages, sorted by their indices, into the runs of adjacent pages.
+///
+/// The runs have at most [`MAX_WRITE_RUN_PAGES`] pages.
+fn adjacent_runs(pages: &[(usize, CachePage)]) -> impl Iterator<Item = &[(usize, CachePage)]> {
+    pages
+        .chunk_by(|(prev_idx, _), (idx, _)| prev_idx + 1 == *idx)
+        .flat_map(|run| run.chunks(MAX_WRITE_RUN_PAGES))
+}
+
+/// Returns the index of the first page in the run, and the pages of the run.
+fn run_frames(run: &[(usize, CachePage)]) -> (usize, Vec<CachePage>) {
+    let frames = run.iter().map(|(_, page)| page.clone()).collect();
+    (run[0].0, frames)
 }
 
 impl Debug for PageCacheManager {
     fn fmt(&self, f: &mut core::fmt::Formatter) -> core::fmt::Result {
         f.debug_struct("PageCacheManager")
             .field("pages", &self.pages.lock())
+            .field("readahead_stats", &self.readahead_stats())
             .finish()
     }
 }
@@ -452,7 +895,11 @@ impl Pager for PageCacheManager {
     fn update_page(&self, idx: usize) -> Result<()> {
         let mut pages = self.pages.lock();
         if let Some(page) = pages.get_mut(&idx) {
-            page.store_state(PageState::Dirty);
+            page.mark_referenced();
+            if page.load_state() != PageState::Dirty {
+                page.store_state(PageState::Dirty);
+                page_writeback::add_dirty_page(&self.this, idx);
+            }
         } else {
             warn!("The page {} is not in page cache", idx);
         }
@@ -482,7 +929,31 @@ impl Pager for PageCacheManager {
         }
 
         let page = CachePage::alloc_uninit()?;
-        Ok(self.pages.lock().get_or_insert(idx, || page).clone().into())
+        let mut pages = self.pages.lock();
+        let page = pages.get_or_insert(idx, || {
+            page_reclaim::add_page(&self.this, idx, &page);
+            page
+        });
+        Ok(page.clone().into())
+    }
+
+    fn advise_access(&self, pattern: AccessPattern) {
+        self.ra_state.lock().set_pattern(pattern);
+    }
+
+    fn prefetch_pages(&self, idx_range: Range<usize>) {
+        self.prefetch(idx_range);
+    }
+
+    fn deactivate_pages(&self, idx_range: Range<usize>) {
+        // The pages that are not referenced since the last scan of the
+        // reclaimer are reclaimed once they are scanned again.
+        let pages = self.pages.lock();
+        for idx in idx_range {
+            if let Some(page) = pages.peek(&idx) {
+                page.test_and_clear_referenced();
+            }
+        }
     }
 }
 
@@ -493,10 +964,14 @@ pub type CachePage = Frame<CachePageMeta>;
 #[derive(Debug)]
 pub struct CachePageMeta {
     pub state: AtomicPageState,
+    /// Whether the page has been referenced since the reclaimer last scanned it.
+    referenced: AtomicBool,
     // TODO: Add a reverse mapping from the page to VMO for eviction.
 }
 
-impl_untyped_frame_meta_for!(CachePageMeta);
+impl_untyped_frame_meta_for!(CachePageMeta, {
+    page_reclaim::dec_cached_pages();
+});
 
 pub trait CachePageExt {
     /// Gets the metadata associated with the cache page.
@@ -506,10 +981,12 @@ pub trait CachePageExt {
     fn alloc_uninit() -> Result<CachePage> {
         let meta = CachePageMeta {
             state: AtomicPageState::new(PageState::Uninit),
+            referenced: AtomicBool::new(false),
         };
         let page = FrameAllocOptions::new()
             .zeroed(false)
             .alloc_frame_with(meta)?;
+        page_reclaim::inc_cached_pages();
         Ok(page)
     }
 
@@ -517,10 +994,12 @@ pub trait CachePageExt {
     fn alloc_zero(state: PageState) -> Result<CachePage> {
         let meta = CachePageMeta {
             state: AtomicPageState::new(state),
+            referenced: AtomicBool::new(false),
         };
         let page = FrameAllocOptions::new()
             .zeroed(true)
             .alloc_frame_with(meta)?;
+        page_reclaim::inc_cached_pages();
         Ok(page)
     }
 
@@ -533,6 +1012,16 @@ pub trait CachePageExt {
     fn store_state(&mut self, new_state: PageState) {
         self.metadata().state.store(new_state, Ordering::Relaxed);
     }
+
+    /// Marks the cache page as referenced, which protects it from reclamation.
+    fn mark_referenced(&self) {
+        self.metadata().referenced.store(true, Ordering::Relaxed);
+    }
+
+    /// Clears the referenced mark, returning whether the page was referenced.
+    fn test_and_clear_referenced(&self) -> bool {
+        self.metadata().referenced.swap(false, Ordering::Relaxed)
+    }
 }
 
 impl CachePageExt for CachePage {
@@ -589,6 +1078,17 @@ pub trait PageCacheBackend: Sync + Send {
     fn read_page_async(&self, idx: usize, frame: &CachePage) -> Result<BioWaiter>;
     /// Writes a page to the backend asynchronously.
     fn write_page_async(&self, idx: usize, frame: &CachePage) -> Result<BioWaiter>;
+    /// Writes the consecutive pages starting from `idx` to the backend asynchronously.
+    ///
+    /// The backends that store the consecutive pages contiguously can override this to write
+    /// them with a single request.
+    fn write_pages_async(&self, idx: usize, frames: &[CachePage]) -> Result<BioWaiter> {
+        let mut waiter = BioWaiter::new();
+        for (i, frame) in frames.iter().enumerate() {
+            waiter.concat(self.write_page_async(idx + i, frame)?);
+        }
+        Ok(waiter)
+    }
     /// Returns the number of pages in the backend.
     fn npages(&self) -> usize;
 }
@@ -611,3 +1111,64 @@ impl dyn PageCacheBackend {
         }
     }
 }
+
+#[cfg(ktest)]
+mod test {
+    use ostd::prelude::*;
+
+    use super::*;
+
+    #[ktest]
+    fn readahead_sequential_access() {
+        let mut ra_state = ReadaheadState::new();
+        // The first access is not known to be sequential.
+        assert!(!ra_state.should_readahead(0, 100));
+        ra_state.set_prev_page(0);
+
+        assert!(ra_state.should_readahead(1, 100));
+        ra_state.setup_window(1, 100);
+        ra_state.set_prev_page(1);
+        let window = ra_state.ra_window.as_ref().unwrap();
+        assert_eq!(window.readahead_range(), 2..6);
+
+        // Entering the window triggers the next one.
+        assert!(ra_state.should_readahead(2, 100));
+        ra_state.setup_window(2, 100);
+        ra_state.set_prev_page(2);
+        let window = ra_state.ra_window.as_ref().unwrap();
+        assert_eq!(window.readahead_range(), 6..14);
+
+        // A random access starts over.
+        assert!(!ra_state.should_readahead(50, 100));
+        assert!(ra_state.ra_window.is_none());
+    }
+
+    #[ktest]
+    fn readahead_advice() {
+        let mut ra_state = ReadaheadState::new();
+
+        ra_state.set_pattern(AccessPattern::Random);
+        ra_state.set_prev_page(0);
+        assert!(!ra_state.should_readahead(1, 100));
+
+        ra_state.set_pattern(AccessPattern::Sequential);
+        assert!(ra_state.should_readahead(10, 100));
+        ra_state.setup_window(10, 100);
+        let window = ra_state.ra_window.as_ref().unwrap();
+        assert_eq!(window.readahead_range(), 11..75);
+    }
+
+    #[ktest]
+    fn readahead_stall_grows_pipeline() {
+        let mut ra_state = ReadaheadState::new();
+        while ra_state.max_size < ReadaheadState::MAX_SIZE_LIMIT {
+            ra_state.record_stall();
+        }
+        assert_eq!(ra_state.max_depth, ReadaheadState::DEFAULT_MAX_DEPTH);
+
+        for _ in 0..ReadaheadState::MAX_DEPTH_LIMIT {
+            ra_state.record_stall();
+        }
+        assert_eq!(ra_state.max_depth, ReadaheadState::MAX_DEPTH_LIMIT);
+    }
+}
@@ -0,0 +1,302 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! Reclamation of the pages in page caches.
+//!
+//! The pages of all page caches are kept in a kernel-wide LRU, which is split
+//! into an active list and an inactive list like that of Linux. New pages
+//! enter the inactive list. The reclaimer scans the inactive list from its
+//! oldest end: the pages referenced since the last scan are promoted to the
+//! active list, and the others are reclaimed if they are clean and not in
+//! use. The active list is aged into the inactive list, so that the pages
+//! that are no longer referenced eventually get reclaimed.
+//!
+//! The reclaimer thread starts to reclaim pages once the free memory of the
+//! frame allocator drops below the low watermark, and stops when the free
+//! memory reaches the high watermark.
+//!
+//! Other kernel caches (e.g., the dentry cache) can register a [`Shrinker`],
+//! which is asked to release its objects along with the pages.
+
+use core::{
+    sync::atomic::{AtomicUsize, Ordering},
+    time::Duration,
+};
+
+use ostd::{mm::Paddr, sync::WaitQueue};
+use spin::Once;
+
+use super::{
+    page_cache::{CachePage, PageCacheManager},
+    page_writeback,
+};
+use crate::{prelude::*, thread::kernel_thread::ThreadOptions, WaitTimeout};
+
+/// The interval at which the reclaimer checks the free memory.
+const RECLAIM_INTERVAL: Duration = Duration::from_millis(100);
+/// The maximum number of pages scanned in a batch.
+const SCAN_BATCH: usize = 64;
+/// The number of stale LRU entries tolerated before they are pruned.
+const PRUNE_SLACK: usize = 4096;
+
+/// The number of pages allocated for page caches.
+static NR_CACHED_PAGES: AtomicUsize = AtomicUsize::new(0);
+
+static PAGE_LRU: SpinLock<PageLru> = SpinLock::new(PageLru {
+    active: VecDeque::new(),
+    inactive: VecDeque::new(),
+});
+
+static RECLAIMER_WAIT_QUEUE: WaitQueue = WaitQueue::new();
+
+static SHRINKERS: SpinLock<Vec<&'static dyn Shrinker>> = SpinLock::new(Vec::new());
+
+static WATERMARKS: Once<Watermarks> = Once::new();
+
+/// The watermarks of the free memory, in bytes.
+struct Watermarks {
+    low: usize,
+    high: usize,
+}
+
+/// A page in the LRU lists.
+///
+/// The entries are not removed when the pages are removed from their page
+/// caches by other means (e.g., truncation). Such stale entries are detected
+/// against the physical address of the page and dropped when scanned.
+struct LruEntry {
+    manager: Weak<PageCacheManager>,
+    idx: usize,
+    paddr: Paddr,
+}
+
+/// The LRU lists, of which the fronts hold the oldest pages.
+struct PageLru {
+    active: VecDeque<LruEntry>,
+    inactive: VecDeque<LruEntry>,
+}
+
+impl PageLru {
+    fn len(&self) -> usize {
+        self.active.len() + self.inactive.len()
+    }
+
+    /// Moves the oldest active pages to the inactive list until the active
+    /// list is no longer larger than the inactive list.
+    fn balance(&mut self, max_nr_moved: usize) {
+        for _ in 0..max_nr_moved {
+            if self.active.len() <= self.inactive.len() {
+                break;
+            }
+            let entry = self.active.pop_front().unwrap();
+            self.inactive.push_back(entry);
+        }
+    }
+}
+
+/// The verdict of the reclaimer on a scanned page.
+pub(super) enum Verdict {
+    /// The page has been reclaimed.
+    Reclaimed,
+    /// The page is referenced or in use, so it is promoted to the active list.
+    Activate,
+    /// The page cannot be reclaimed for now (e.g., it is dirty), so it stays
+    /// in the inactive list.
+    Keep,
+    /// The page is no longer in the page cache.
+    Gone,
+}
+
+/// Adds a new page of the page cache to the inactive list.
+pub(super) fn add_page(manager: &Weak<PageCacheManager>, idx: usize, page: &CachePage) {
+    PAGE_LRU.lock().inactive.push_back(LruEntry {
+        manager: manager.clone(),
+        idx,
+        paddr: page.start_paddr(),
+    });
+
+    // Loading the free memory is not cheap, so it is only checked once in a while.
+    if nr_cached_pages() % 32 == 0
+        && WATERMARKS
+            .get()
+            .is_some_and(|watermarks| free_memory() < watermarks.low)
+    {
+        RECLAIMER_WAIT_QUEUE.wake_all();
+    }
+}
+
+/// Counts a page allocated for a page cache.
+pub(super) fn inc_cached_pages() {
+    NR_CACHED_PAGES.fetch_add(1, Ordering::Relaxed);
+}
+
+/// Counts a page of a page cache that is freed.
+pub(super) fn dec_cached_pages() {
+    NR_CACHED_PAGES.fetch_sub(1, Ordering::Relaxed);
+}
+
+/// Returns the number of pages allocated for page caches.
+pub fn nr_cached_pages() -> usize {
+    NR_CACHED_PAGES.load(Ordering::Relaxed)
+}
+
+fn free_memory() -> usize {
+    osdk_frame_allocator::load_total_free_size()
+}
+
+/// A cache that can release its objects under memory pressure.
+pub trait Shrinker: Sync {
+    /// Releases at most `nr_to_scan` objects that are not in use.
+    ///
+    /// Returns the number of the released objects.
+    fn shrink(&self, nr_to_scan: usize) -> usize;
+}
+
+/// Registers a shrinker, which is called when the free memory is low.
+pub fn register_shrinker(shrinker: &'static dyn Shrinker) {
+    SHRINKERS.lock().push(shrinker);
+}
+
+/// Calls the shrinkers, returning the total number of the released objects.
+fn shrink_caches(nr_to_scan: usize) -> usize {
+    let shrinkers = SHRINKERS.lock().clone();
+    shrinkers
+        .iter()
+        .map(|shrinker| shrinker.shrink(nr_to_scan))
+        .sum()
+}
+
+/// Spawns the reclaimer thread.
+pub(super) fn spawn_reclaimer() {
+    let mem_total = crate::vm::mem_total();
+    WATERMARKS.call_once(|| Watermarks {
+        low: mem_total / 64,
+        high: mem_total / 32,
+    });
+
+    ThreadOptions::new(reclaimer_loop).spawn();
+}
+
+fn reclaimer_loop() {
+    let watermarks = WATERMARKS.get().unwrap();
+
+    loop {
+        let _ = RECLAIMER_WAIT_QUEUE.wait_until_or_timeout(
+            || (free_memory() < watermarks.low).then_some(()),
+            &RECLAIM_INTERVAL,
+        );
+
+        if free_memory() >= watermarks.low {
+            prune_stale_entries();
+            continue;
+        }
+
+        while free_memory() < watermarks.high {
+            let nr_reclaimed = shrink_inactive_list(SCAN_BATCH) + shrink_caches(SCAN_BATCH);
+            if nr_reclaimed > 0 {
+                continue;
+            }
+            // The clean pages are used up, so the dirty pages should be
+            // written back before they can be reclaimed.
+            page_writeback::wake_flusher();
+            break;
+        }
+    }
+}
+
+/// Scans the oldest pages in the inactive list and reclaims them.
+///
+/// Returns the number of reclaimed pages.
+fn shrink_inactive_list(nr_to_scan: usize) -> usize {
+    let scanned = {
+        let mut lru = PAGE_LRU.lock();
+        lru.balance(nr_to_scan);
+        let nr_scanned = nr_to_scan.min(lru.inactive.len());
+        lru.inactive.drain(..nr_scanned).collect::<Vec<_>>()
+    };
+    if scanned.is_empty() {
+        return 0;
+    }
+
+    let mut nr_reclaimed = 0;
+    let mut to_activate = Vec::new();
+    let mut to_keep = Vec::new();
+    for (manager, entries) in group_by_manager(scanned) {
+        let Some(page_cache) = manager.upgrade() else {
+            continue;
+        };
+        let verdicts = page_cache.reclaim_pages(&entries);
+
+        for ((idx, paddr), verdict) in entries.into_iter().zip(verdicts) {
+            let entry = LruEntry {
+                manager: manager.clone(),
+                idx,
+                paddr,
+            };
+            match verdict {
+                Verdict::Reclaimed => nr_reclaimed += 1,
+                Verdict::Activate => to_activate.push(entry),
+                Verdict::Keep => to_keep.push(entry),
+                Verdict::Gone => (),
+            }
+        }
+    }
+
+    let mut lru = PAGE_LRU.lock();
+    lru.active.extend(to_activate);
+    lru.inactive.extend(to_keep);
+
+    nr_reclaimed
+}
+
+/// Drops the stale entries if there are too many of them.
+fn prune_stale_entries() {
+    let entries = {
+        let mut lru = PAGE_LRU.lock();
+        if lru.len() <= nr_cached_pages() * 2 + PRUNE_SLACK {
+            return;
+        }
+        let active = core::mem::take(&mut lru.active);
+        let inactive = core::mem::take(&mut lru.inactive);
+        (active, inactive)
+    };
+
+    let (active, inactive) = entries;
+    let active = retain_present(active);
+    let inactive = retain_present(inactive);
+
+    // The entries added meanwhile are newer, so the old entries are put
+    // before them.
+    let mut lru = PAGE_LRU.lock();
+    let new_active = core::mem::replace(&mut lru.active, active);
+    lru.active.extend(new_active);
+    let new_inactive = core::mem::replace(&mut lru.inactive, inactive);
+    lru.inactive.extend(new_inactive);
+}
+
+fn retain_present(entries: VecDeque<LruEntry>) -> VecDeque<LruEntry> {
+    let mut retained = VecDeque::with_capacity(entries.len());
+    for entry in entries {
+        let Some(manager) = entry.manager.upgrade() else {
+            continue;
+        };
+        if manager.contains_page(entry.idx, entry.paddr) {
+            retained.push_back(entry);
+        }
+    }
+    retained
+}
+
+/// Groups the entries by their page caches, keeping the order in each group.
+fn group_by_manager(entries: Vec<LruEntry>) -> Vec<(Weak<PageCacheManager>, Vec<(usize, Paddr)>)> {
+    let mut groups: BTreeMap<usize, (Weak<PageCacheManager>, Vec<(usize, Paddr)>)> =
+        BTreeMap::new();
+    for entry in entries {
+        let key = entry.manager.as_ptr() as usize;
+        groups
+            .entry(key)
+            .or_insert_with(|| (entry.manager.clone(), Vec::new()))
+            .1
+            .push((entry.idx, entry.paddr));
+    }
+    groups.into_values().collect()
+}
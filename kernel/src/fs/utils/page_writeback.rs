@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! Background writeback of the dirty pages in page caches.
+//!
+//! The dirty pages of all page caches are queued in the order they are
+//! dirtied. Like the writeback of BDIs in Linux, the flusher thread wakes up
+//! periodically to write back the pages that have been dirty for long enough,
+//! in batches grouped by page cache. Once there are too many dirty pages, or
+//! the reclaimer runs out of clean pages, the flusher is woken up to write
+//! back all dirty pages regardless of their ages.
+
+use core::{
+    sync::atomic::{AtomicBool, Ordering},
+    time::Duration,
+};
+
+use ostd::{sync::WaitQueue, timer::Jiffies};
+
+use super::page_cache::PageCacheManager;
+use crate::{prelude::*, thread::kernel_thread::ThreadOptions, WaitTimeout};
+
+/// The interval at which the flusher wakes up.
+const WRITEBACK_INTERVAL: Duration = Duration::from_secs(5);
+/// The age beyond which dirty pages are written back.
+const DIRTY_EXPIRE: Duration = Duration::from_secs(30);
+/// The maximum number of pages written back in a batch.
+const WRITEBACK_BATCH: usize = 256;
+/// The percentage of memory in dirty pages that starts the writeback.
+const DIRTY_BACKGROUND_RATIO: usize = 10;
+
+static DIRTY_PAGES: SpinLock<VecDeque<DirtyEntry>> = SpinLock::new(VecDeque::new());
+
+static FLUSHER_WAIT_QUEUE: WaitQueue = WaitQueue::new();
+
+/// Whether the flusher is requested to write back all dirty pages.
+static IS_FLUSH_REQUESTED: AtomicBool = AtomicBool::new(false);
+
+/// A dirty page in the queue.
+///
+/// The entries are not removed when the pages are cleaned by other means
+/// (e.g., `fsync`), and are skipped when written back.
+struct DirtyEntry {
+    manager: Weak<PageCacheManager>,
+    idx: usize,
+    dirtied_at: Duration,
+}
+
+/// Queues a page of the page cache that becomes dirty.
+pub(super) fn add_dirty_page(manager: &Weak<PageCacheManager>, idx: usize) {
+    let nr_dirty = {
+        let mut dirty_pages = DIRTY_PAGES.lock();
+        dirty_pages.push_back(DirtyEntry {
+            manager: manager.clone(),
+            idx,
+            dirtied_at: Jiffies::elapsed().as_duration(),
+        });
+        dirty_pages.len()
+    };
+
+    let background_thresh = crate::vm::mem_total() / PAGE_SIZE * DIRTY_BACKGROUND_RATIO / 100;
+    if nr_dirty > background_thresh {
+        wake_flusher();
+    }
+}
+
+/// Wakes up the flusher to write back all dirty pages.
+pub(super) fn wake_flusher() {
+    if !IS_FLUSH_REQUESTED.swap(true, Ordering::AcqRel) {
+        FLUSHER_WAIT_QUEUE.wake_all();
+    }
+}
+
+/// Spawns the flusher thread.
+pub(super) fn spawn_flusher() {
+    ThreadOptions::new(flusher_loop).spawn();
+}
+
+fn flusher_loop() {
+    loop {
+        let _ = FLUSHER_WAIT_QUEUE.wait_until_or_timeout(
+            || IS_FLUSH_REQUESTED.load(Ordering::Acquire).then_some(()),
+            &WRITEBACK_INTERVAL,
+        );
+
+        let is_forced = IS_FLUSH_REQUESTED.swap(false, Ordering::AcqRel);
+        while writeback_oldest(is_forced) > 0 {}
+    }
+}
+
+/// Writes back a batch of the oldest dirty pages.
+///
+/// Unless `is_forced` is true, only the expired pages are written back.
+/// Returns the number of dequeued entries.
+fn writeback_oldest(is_forced: bool) -> usize {
+    let now = Jiffies::elapsed().as_duration();
+    let entries = {
+        let mut dirty_pages = DIRTY_PAGES.lock();
+        let nr_expired = if is_forced {
+            dirty_pages.len()
+        } else {
+            dirty_pages
+                .iter()
+                .take(WRITEBACK_BATCH)
+                .take_while(|entry| now.saturating_sub(entry.dirtied_at) >= DIRTY_EXPIRE)
+                .count()
+        };
+        let nr_entries = nr_expired.min(WRITEBACK_BATCH);
+        dirty_pages.drain(..nr_entries).collect::<Vec<_>>()
+    };
+    let nr_entries = entries.len();
+
+    // Group the pages by their page caches, keeping the order in each group.
+    let mut groups: BTreeMap<usize, (Weak<PageCacheManager>, Vec<usize>)> = BTreeMap::new();
+    for entry in entries {
+        let key = entry.manager.as_ptr() as usize;
+        groups
+            .entry(key)
+            .or_insert_with(|| (entry.manager.clone(), Vec::new()))
+            .1
+            .push(entry.idx);
+    }
+
+    for (manager, idxs) in groups.into_values() {
+        if let Some(page_cache) = manager.upgrade() {
+            page_cache.writeback_pages(&idxs);
+        }
+    }
+
+    nr_entries
+}
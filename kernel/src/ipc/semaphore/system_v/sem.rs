@@ -7,14 +7,13 @@ use core::{
 };
 
 use atomic_integer_wrapper::define_atomic_version_of_integer_like_type;
-use ostd::sync::{PreemptDisabled, Waiter, Waker};
+use ostd::sync::{Waiter, Waker};
 
-use super::sem_set::{SemSetInner, SEMVMX};
+use super::sem_set::SEMVMX;
 use crate::{
     ipc::{key_t, semaphore::system_v::sem_set::sem_sets, IpcFlags},
     prelude::*,
-    process::Pid,
-    time::{clocks::JIFFIES_TIMER_MANAGER, timer::Timeout},
+    process::{signal::Pause, Pid},
 };
 
 #[derive(Clone, Copy, Debug, Pod)]
@@ -54,7 +53,7 @@ impl From<Status> for u16 {
 }
 
 define_atomic_version_of_integer_like_type!(Status, try_from = true, {
-    struct AtomicStatus(AtomicU16);
+    pub(super) struct AtomicStatus(AtomicU16);
 });
 
 /// Pending atomic semop.
@@ -71,7 +70,7 @@ impl PendingOp {
     }
 
     pub fn set_status(&self, status: Status) {
-        self.status.store(status, Ordering::Relaxed);
+        self.status.store(status, Ordering::Release);
     }
 
     pub fn waker(&self) -> &Option<Arc<Waker>> {
@@ -81,6 +80,33 @@ impl PendingOp {
     pub fn pid(&self) -> Pid {
         self.pid
     }
+
+    pub(super) fn status(&self) -> &Arc<AtomicStatus> {
+        &self.status
+    }
+
+    /// Returns whether the operation is on a single semaphore.
+    ///
+    /// Such an operation is queued in the [`SemEntry`] of the semaphore instead of the set, so it
+    /// can be performed and woken up with only the semaphore locked.
+    pub(super) fn is_simple(&self) -> bool {
+        self.sops.len() == 1
+    }
+
+    /// Returns the semaphores that the operation modifies.
+    pub(super) fn altered_sems(&self) -> impl Iterator<Item = u16> + '_ {
+        self.sops
+            .iter()
+            .filter(|sop| sop.sem_op != 0)
+            .map(|sop| sop.sem_num)
+    }
+
+    /// Marks the operation as done and moves it to `wake_queue`, from which it should be woken up
+    /// with [`wake_ops`] after releasing the locks.
+    fn complete(mut list: LinkedList<PendingOp>, wake_queue: &mut LinkedList<PendingOp>) {
+        list.front().unwrap().set_status(Status::Normal);
+        wake_queue.append(&mut list);
+    }
 }
 
 impl Debug for PendingOp {
@@ -128,6 +154,79 @@ impl Semaphore {
     }
 }
 
+/// A semaphore with the pending operations on it alone.
+#[derive(Debug)]
+pub(super) struct SemEntry {
+    pub(super) sem: Semaphore,
+    /// Pending alter operations on this semaphore alone.
+    pub(super) pending_alter: LinkedList<PendingOp>,
+    /// Pending zero operations on this semaphore alone.
+    pub(super) pending_const: LinkedList<PendingOp>,
+}
+
+impl SemEntry {
+    pub(super) fn new(val: i32) -> Self {
+        Self {
+            sem: Semaphore::new(val),
+            pending_alter: LinkedList::new(),
+            pending_const: LinkedList::new(),
+        }
+    }
+
+    /// Performs the pending operations that can be completed now, and moves them to `wake_queue`.
+    ///
+    /// Ref: <https://elixir.bootlin.com/linux/v6.0.9/source/ipc/sem.c#L1029>
+    pub(super) fn update_pending(&mut self, wake_queue: &mut LinkedList<PendingOp>) {
+        loop {
+            if self.sem.val == 0 {
+                while let Some(const_op) = self.pending_const.pop_front() {
+                    let mut list = LinkedList::new();
+                    list.push_back(const_op);
+                    PendingOp::complete(list, wake_queue);
+                }
+            }
+
+            // Restart from the first operation after completing one, since it may have made the
+            // previous ones possible.
+            let mut cursor = self.pending_alter.cursor_front_mut();
+            let mut has_completed = false;
+            while let Some(alter_op) = cursor.current() {
+                if let Ok(true) = perform_atomic_semop(&mut self.sem, alter_op) {
+                    PendingOp::complete(cursor.remove_current_as_list().unwrap(), wake_queue);
+                    has_completed = true;
+                    break;
+                }
+                cursor.move_next();
+            }
+            if !has_completed {
+                return;
+            }
+        }
+    }
+}
+
+/// Semaphores that an operation can be performed on.
+pub(super) trait Sems {
+    /// Returns the semaphore of the number.
+    ///
+    /// The number must be valid, i.e., less than the number of semaphores in the set.
+    fn sem_mut(&mut self, sem_num: u16) -> &mut Semaphore;
+}
+
+/// A single semaphore, on which the [simple](PendingOp::is_simple) operations are performed.
+impl Sems for Semaphore {
+    fn sem_mut(&mut self, _sem_num: u16) -> &mut Semaphore {
+        self
+    }
+}
+
+/// All semaphores in a set, which requires the whole set to be locked.
+impl Sems for [SpinLock<SemEntry>] {
+    fn sem_mut(&mut self, sem_num: u16) -> &mut Semaphore {
+        &mut self[sem_num as usize].get_mut().sem
+    }
+}
+
 pub fn sem_op(
     sem_id: key_t,
     sops: Vec<SemBuf>,
@@ -138,7 +237,7 @@ pub fn sem_op(
     debug!("[semop] sops: {:?}", sops);
 
     let pid = ctx.process.pid();
-    let mut pending_op = PendingOp {
+    let pending_op = PendingOp {
         sops,
         status: Arc::new(AtomicStatus::new(Status::Pending)),
         waker: None,
@@ -153,141 +252,115 @@ pub fn sem_op(
         warn!("Found duplicate sop");
     }
 
+    let status = pending_op.status.clone();
+    let simple_sem_num = pending_op.is_simple().then(|| pending_op.sops[0].sem_num);
+
     let local_sem_sets = sem_sets();
     let sem_set = local_sem_sets
         .get(&sem_id)
         .ok_or(Error::new(Errno::EINVAL))?;
-    let mut inner = sem_set.inner();
-
-    if perform_atomic_semop(&mut inner.sems, &mut pending_op)? {
-        if alter {
-            let wake_queue = do_smart_update(&mut inner, &pending_op);
-            for wake_op in wake_queue {
-                wake_op.set_status(Status::Normal);
-                if let Some(waker) = wake_op.waker {
-                    waker.wake_up();
-                }
-            }
-        }
+    if pending_op
+        .sops_iter()
+        .any(|sop| sop.sem_num as usize >= sem_set.nsems())
+    {
+        return_errno!(Errno::EFBIG);
+    }
 
+    let Some(waiter) = sem_set.perform_or_queue(pending_op, alter)? else {
         sem_set.update_otime();
         return Ok(());
-    }
-
-    // Prepare to wait
-    let status = pending_op.status.clone();
-    let (waiter, waker) = Waiter::new_pair();
-
-    // Check if timeout exists to avoid calling `Arc::clone()`
-    if let Some(timeout) = timeout {
-        pending_op.waker = Some(waker.clone());
-
-        let jiffies_timer = JIFFIES_TIMER_MANAGER.get().unwrap().create_timer(move || {
-            waker.wake_up();
-        });
-        jiffies_timer.set_timeout(Timeout::After(timeout));
-    } else {
-        pending_op.waker = Some(waker);
-    }
-
-    if alter {
-        inner.pending_alter.push_back(pending_op);
-    } else {
-        inner.pending_const.push_back(pending_op);
-    }
-
-    drop(inner);
+    };
     drop(local_sem_sets);
 
-    waiter.wait();
-    match status.load(Ordering::Relaxed) {
-        Status::Normal => Ok(()),
-        Status::Removed => Err(Error::new(Errno::EIDRM)),
-        Status::Pending => {
-            // FIXME: Getting sem_sets maybe time-consuming.
+    let result = waiter.pause_until_or_timeout(
+        || match status.load(Ordering::Acquire) {
+            Status::Pending => None,
+            status => Some(status),
+        },
+        timeout.as_ref(),
+    );
+    let status = match result {
+        Ok(status) => status,
+        Err(err) => {
+            // Dequeue the operation unless it has completed in the meantime.
             let sem_sets = sem_sets();
-            let sem_set = sem_sets.get(&sem_id).ok_or(Error::new(Errno::EINVAL))?;
-            let mut inner = sem_set.inner();
-
-            let pending_ops = if alter {
-                &mut inner.pending_alter
-            } else {
-                &mut inner.pending_const
+            let status = match sem_sets.get(&sem_id) {
+                Some(sem_set) => sem_set.dequeue(&status, simple_sem_num, alter),
+                None => status.load(Ordering::Acquire),
             };
-            pending_ops.retain(|op| op.pid != pid);
-
-            Err(Error::new(Errno::EAGAIN))
+            if let Status::Pending = status {
+                return if err.error() == Errno::ETIME {
+                    Err(Error::with_message(
+                        Errno::EAGAIN,
+                        "the time limit is reached",
+                    ))
+                } else {
+                    Err(err)
+                };
+            }
+            status
         }
+    };
+
+    match status {
+        Status::Normal => Ok(()),
+        Status::Removed => Err(Error::new(Errno::EIDRM)),
+        Status::Pending => unreachable!(),
     }
 }
 
-/// Update pending const and alter operations, ref: <https://elixir.bootlin.com/linux/v6.0.9/source/ipc/sem.c#L1029>
-pub(super) fn do_smart_update(
-    inner: &mut SpinLockGuard<SemSetInner, PreemptDisabled>,
-    pending_op: &PendingOp,
-) -> LinkedList<PendingOp> {
-    let mut wake_queue = LinkedList::new();
-
-    let (sems, pending_alter, pending_const) = inner.field_mut();
-
-    if !pending_const.is_empty() {
-        do_smart_wakeup_zero(sems, pending_const, pending_op, &mut wake_queue);
-    }
-    if !pending_alter.is_empty() {
-        update_pending_alter(sems, pending_alter, pending_const, &mut wake_queue);
+/// Wakes up the completed operations.
+pub(super) fn wake_ops(wake_queue: LinkedList<PendingOp>) {
+    for wake_op in wake_queue {
+        if let Some(waker) = wake_op.waker {
+            waker.wake_up();
+        }
     }
+}
 
-    wake_queue
+/// Queues the operation to wait and returns the waiter to wait for its completion.
+pub(super) fn queue_op(list: &mut LinkedList<PendingOp>, mut pending_op: PendingOp) -> Waiter {
+    let (waiter, waker) = Waiter::new_pair();
+    pending_op.waker = Some(waker);
+    list.push_back(pending_op);
+    waiter
 }
 
-/// Look for pending alter operations that can be completed, ref: <https://elixir.bootlin.com/linux/v6.0.9/source/ipc/sem.c#L949>
-pub(super) fn update_pending_alter(
-    sems: &mut Box<[Semaphore]>,
-    pending_alter: &mut LinkedList<PendingOp>,
-    pending_const: &mut LinkedList<PendingOp>,
+/// Performs the pending operations on multiple semaphores that can be completed after the
+/// semaphores in `changed` have changed, and moves them to `wake_queue`.
+///
+/// The pending operations on a single semaphore are updated with [`SemEntry::update_pending`].
+///
+/// Ref: <https://elixir.bootlin.com/linux/v6.0.9/source/ipc/sem.c#L949>
+pub(super) fn update_pending_complex(
+    sems: &mut [SpinLock<SemEntry>],
+    complex_alter: &mut LinkedList<PendingOp>,
+    complex_const: &mut LinkedList<PendingOp>,
+    mut changed: Vec<u16>,
     wake_queue: &mut LinkedList<PendingOp>,
 ) {
-    let mut cursor = pending_alter.cursor_front_mut();
-    while let Some(alter_op) = cursor.current() {
-        if let Ok(true) = perform_atomic_semop(sems, alter_op) {
-            let mut alter_op = cursor.remove_current_as_list().unwrap();
-
-            do_smart_wakeup_zero(sems, pending_const, alter_op.front().unwrap(), wake_queue);
-
-            wake_queue.append(&mut alter_op);
-        } else {
-            cursor.move_next();
+    while !changed.is_empty() {
+        for sem_num in changed.drain(..) {
+            sems[sem_num as usize].get_mut().update_pending(wake_queue);
         }
-    }
-}
 
-/// Wakeup all wait for zero tasks, ref: <https://elixir.bootlin.com/linux/v6.0.9/source/ipc/sem.c#L893>
-fn do_smart_wakeup_zero(
-    sems: &mut Box<[Semaphore]>,
-    pending_const: &mut LinkedList<PendingOp>,
-    pending_op: &PendingOp,
-    wake_queue: &mut LinkedList<PendingOp>,
-) {
-    for sop in pending_op.sops_iter() {
-        if sems.get(sop.sem_num as usize).unwrap().val == 0 {
-            wake_const_ops(sems, pending_const, wake_queue);
-            return;
+        let mut cursor = complex_const.cursor_front_mut();
+        while let Some(const_op) = cursor.current() {
+            if let Ok(true) = perform_atomic_semop(sems, const_op) {
+                PendingOp::complete(cursor.remove_current_as_list().unwrap(), wake_queue);
+            } else {
+                cursor.move_next();
+            }
         }
-    }
-}
 
-/// Wakeup pending const operations, ref: <https://elixir.bootlin.com/linux/v6.0.9/source/ipc/sem.c#L854>
-pub(super) fn wake_const_ops(
-    sems: &mut Box<[Semaphore]>,
-    pending_const: &mut LinkedList<PendingOp>,
-    wake_queue: &mut LinkedList<PendingOp>,
-) {
-    let mut cursor = pending_const.cursor_front_mut();
-    while let Some(const_op) = cursor.current() {
-        if let Ok(true) = perform_atomic_semop(sems, const_op) {
-            wake_queue.append(&mut cursor.remove_current_as_list().unwrap());
-        } else {
-            cursor.move_next();
+        let mut cursor = complex_alter.cursor_front_mut();
+        while let Some(alter_op) = cursor.current() {
+            if let Ok(true) = perform_atomic_semop(sems, alter_op) {
+                changed.extend(alter_op.altered_sems());
+                PendingOp::complete(cursor.remove_current_as_list().unwrap(), wake_queue);
+            } else {
+                cursor.move_next();
+            }
         }
     }
 }
@@ -316,45 +389,48 @@ fn get_sops_flags(pending_op: &PendingOp) -> (bool, bool) {
 /// 1. Return Ok(true) if the operation success.
 /// 2. Return Ok(false) if the caller needs to wait.
 /// 3. Return Err(err) if the operation cause error.
-fn perform_atomic_semop(sems: &mut Box<[Semaphore]>, pending_op: &mut PendingOp) -> Result<bool> {
-    let mut result;
-    for op in pending_op.sops_iter() {
-        let sem = sems.get(op.sem_num as usize).ok_or(Errno::EFBIG)?;
+///
+/// The semaphore numbers of the operation must be valid for `sems`.
+pub(super) fn perform_atomic_semop<S: Sems + ?Sized>(
+    sems: &mut S,
+    pending_op: &PendingOp,
+) -> Result<bool> {
+    // Apply the operations one by one, so that the duplicate operations on the same semaphore
+    // add up, and revert them if any of them fails.
+    let revert = |sems: &mut S, nr_applied: usize| {
+        for op in pending_op.sops[..nr_applied].iter() {
+            sems.sem_mut(op.sem_num).val -= i32::from(op.sem_op);
+        }
+    };
+
+    for (index, op) in pending_op.sops_iter().enumerate() {
+        let sem = sems.sem_mut(op.sem_num);
         let flags = IpcFlags::from_bits_truncate(op.sem_flags as u32);
-        result = sem.val();
+        let result = sem.val() + i32::from(op.sem_op);
 
         // Zero condition
-        if op.sem_op == 0 && result != 0 {
-            if flags.contains(IpcFlags::IPC_NOWAIT) {
-                return_errno!(Errno::EAGAIN);
-            } else {
-                return Ok(false);
+        let would_block = (op.sem_op == 0 && sem.val() != 0) || result < 0;
+        if would_block || result > SEMVMX {
+            revert(sems, index);
+            if !would_block {
+                return_errno!(Errno::ERANGE);
             }
-        }
-
-        result += i32::from(op.sem_op);
-        if result < 0 {
             if flags.contains(IpcFlags::IPC_NOWAIT) {
                 return_errno!(Errno::EAGAIN);
-            } else {
-                return Ok(false);
             }
+            return Ok(false);
         }
 
-        if result > SEMVMX {
-            return_errno!(Errno::ERANGE);
-        }
         if flags.contains(IpcFlags::SEM_UNDO) {
             todo!()
         }
+        sem.val = result;
     }
 
-    // Success, do operation
+    // Success, record the modifier
     for op in pending_op.sops_iter() {
-        let sem = &mut sems[op.sem_num as usize];
         if op.sem_op != 0 {
-            sem.val += i32::from(op.sem_op);
-            sem.latest_modified_pid = pending_op.pid;
+            sems.sem_mut(op.sem_num).latest_modified_pid = pending_op.pid;
         }
     }
 
@@ -8,15 +8,18 @@ use core::{
 
 use aster_rights::ReadOp;
 use id_alloc::IdAlloc;
-use ostd::sync::{PreemptDisabled, RwLockReadGuard, RwLockWriteGuard};
+use ostd::sync::{PreemptDisabled, RwLockReadGuard, RwLockWriteGuard, Waiter};
 use spin::Once;
 
 use super::{
-    sem::{update_pending_alter, wake_const_ops, PendingOp, Status},
+    sem::{
+        perform_atomic_semop, queue_op, update_pending_complex, wake_ops, AtomicStatus, PendingOp,
+        SemEntry, Semaphore, Status,
+    },
     PermissionMode,
 };
 use crate::{
-    ipc::{key_t, semaphore::system_v::sem::Semaphore, IpcPermission},
+    ipc::{key_t, IpcPermission},
     prelude::*,
     process::{Credentials, Pid},
     time::clocks::RealTimeCoarseClock,
@@ -42,7 +45,11 @@ pub struct SemaphoreSet {
     /// Number of semaphores in the set
     nsems: usize,
     /// Inner
-    inner: SpinLock<SemSetInner>,
+    ///
+    /// An operation on a single semaphore locks this for reading and then locks the semaphore, so
+    /// such operations on different semaphores run in parallel. Other operations lock this for
+    /// writing.
+    inner: RwLock<SemSetInner>,
     /// Semaphore permission
     permission: IpcPermission,
     /// Creation time or last modification via `semctl`
@@ -53,57 +60,40 @@ pub struct SemaphoreSet {
 
 #[derive(Debug)]
 pub(super) struct SemSetInner {
-    /// Semaphores
-    pub(super) sems: Box<[Semaphore]>,
-    /// Pending alter operations.
-    pub(super) pending_alter: LinkedList<PendingOp>,
-    /// Pending zeros operations.
-    pub(super) pending_const: LinkedList<PendingOp>,
+    /// Semaphores with the pending operations on each of them alone.
+    pub(super) sems: Box<[SpinLock<SemEntry>]>,
+    /// Pending alter operations on multiple semaphores.
+    pub(super) complex_alter: LinkedList<PendingOp>,
+    /// Pending zeros operations on multiple semaphores.
+    pub(super) complex_const: LinkedList<PendingOp>,
 }
 
 impl SemSetInner {
-    pub fn field_mut(
-        &mut self,
-    ) -> (
-        &mut Box<[Semaphore]>,
-        &mut LinkedList<PendingOp>,
-        &mut LinkedList<PendingOp>,
-    ) {
-        (
-            &mut self.sems,
-            &mut self.pending_alter,
-            &mut self.pending_const,
-        )
+    /// Returns whether an operation that alters a single semaphore can be performed with only
+    /// the semaphore locked.
+    ///
+    /// This is not the case if some pending operations on multiple semaphores may be completed by
+    /// the change. The result does not change as long as the set is locked for reading.
+    fn allows_simple_alter(&self) -> bool {
+        self.complex_alter.is_empty() && self.complex_const.is_empty()
     }
 }
 
 impl SemaphoreSet {
     pub fn pending_const_count(&self, sem_num: u16) -> usize {
-        let inner = self.inner.lock();
-        let pending_const = &inner.pending_const;
-        let mut count = 0;
-        for i in pending_const.iter() {
-            for sem_buf in i.sops_iter() {
-                if sem_buf.sem_num() == sem_num {
-                    count += 1;
-                }
-            }
-        }
-        count
+        let inner = self.inner.read();
+        let Some(entry) = inner.sems.get(sem_num as usize) else {
+            return 0;
+        };
+        entry.lock().pending_const.len() + count_sops(&inner.complex_const, sem_num)
     }
 
     pub fn pending_alter_count(&self, sem_num: u16) -> usize {
-        let inner = self.inner.lock();
-        let pending_alter = &inner.pending_alter;
-        let mut count = 0;
-        for i in pending_alter.iter() {
-            for sem_buf in i.sops_iter() {
-                if sem_buf.sem_num() == sem_num {
-                    count += 1;
-                }
-            }
-        }
-        count
+        let inner = self.inner.read();
+        let Some(entry) = inner.sems.get(sem_num as usize) else {
+            return 0;
+        };
+        entry.lock().pending_alter.len() + count_sops(&inner.complex_alter, sem_num)
     }
 
     pub fn nsems(&self) -> usize {
@@ -114,37 +104,47 @@ impl SemaphoreSet {
         if !(0..SEMVMX).contains(&val) {
             return_errno!(Errno::ERANGE);
         }
-
-        let mut inner = self.inner();
-        let (sems, pending_alter, pending_const) = inner.field_mut();
-        let sem = sems.get_mut(sem_num).ok_or(Error::new(Errno::EINVAL))?;
-
-        sem.set_val(val);
-        sem.set_latest_modified_pid(pid);
+        if sem_num >= self.nsems {
+            return_errno!(Errno::EINVAL);
+        }
 
         let mut wake_queue = LinkedList::new();
-        if val == 0 {
-            wake_const_ops(sems, pending_const, &mut wake_queue);
+        let inner = self.inner.read();
+        if inner.allows_simple_alter() {
+            let mut entry = inner.sems[sem_num].lock();
+            entry.sem.set_val(val);
+            entry.sem.set_latest_modified_pid(pid);
+            entry.update_pending(&mut wake_queue);
         } else {
-            update_pending_alter(sems, pending_alter, pending_const, &mut wake_queue);
-        }
-
-        for wake_op in wake_queue {
-            wake_op.set_status(Status::Normal);
-            if let Some(waker) = wake_op.waker() {
-                waker.wake_up();
-            }
+            drop(inner);
+            let mut inner = self.inner.write();
+            let SemSetInner {
+                sems,
+                complex_alter,
+                complex_const,
+            } = &mut *inner;
+
+            let sem = &mut sems[sem_num].get_mut().sem;
+            sem.set_val(val);
+            sem.set_latest_modified_pid(pid);
+            update_pending_complex(
+                sems,
+                complex_alter,
+                complex_const,
+                vec![sem_num as u16],
+                &mut wake_queue,
+            );
         }
+        wake_ops(wake_queue);
 
         self.update_ctime();
         Ok(())
     }
 
     pub fn get<T>(&self, sem_num: usize, func: &dyn Fn(&Semaphore) -> T) -> Result<T> {
-        let inner = self.inner();
-        Ok(func(
-            inner.sems.get(sem_num).ok_or(Error::new(Errno::EINVAL))?,
-        ))
+        let inner = self.inner.read();
+        let entry = inner.sems.get(sem_num).ok_or(Error::new(Errno::EINVAL))?;
+        Ok(func(&entry.lock().sem))
     }
 
     pub fn permission(&self) -> &IpcPermission {
@@ -169,8 +169,120 @@ impl SemaphoreSet {
         );
     }
 
-    pub(super) fn inner(&self) -> SpinLockGuard<SemSetInner, PreemptDisabled> {
-        self.inner.lock()
+    /// Performs the operation, or queues it if it needs to wait.
+    ///
+    /// Returns `None` if the operation has been performed, or the waiter to wait for the
+    /// completion of the queued operation.
+    pub(super) fn perform_or_queue(
+        &self,
+        pending_op: PendingOp,
+        alter: bool,
+    ) -> Result<Option<Waiter>> {
+        let mut wake_queue = LinkedList::new();
+        let waiter = self.do_perform_or_queue(pending_op, alter, &mut wake_queue)?;
+        wake_ops(wake_queue);
+        Ok(waiter)
+    }
+
+    fn do_perform_or_queue(
+        &self,
+        pending_op: PendingOp,
+        alter: bool,
+        wake_queue: &mut LinkedList<PendingOp>,
+    ) -> Result<Option<Waiter>> {
+        // Fast path: Lock only the semaphore for an operation on it alone.
+        if pending_op.is_simple() {
+            let inner = self.inner.read();
+            if !alter || inner.allows_simple_alter() {
+                let sem_num = pending_op.sops_iter().next().unwrap().sem_num();
+                let mut entry = inner.sems[sem_num as usize].lock();
+
+                if perform_atomic_semop(&mut entry.sem, &pending_op)? {
+                    if alter {
+                        entry.update_pending(wake_queue);
+                    }
+                    return Ok(None);
+                }
+
+                let pending_ops = if alter {
+                    &mut entry.pending_alter
+                } else {
+                    &mut entry.pending_const
+                };
+                return Ok(Some(queue_op(pending_ops, pending_op)));
+            }
+        }
+
+        let mut inner = self.inner.write();
+        let SemSetInner {
+            sems,
+            complex_alter,
+            complex_const,
+        } = &mut *inner;
+
+        if perform_atomic_semop(&mut **sems, &pending_op)? {
+            if alter {
+                let changed = pending_op.altered_sems().collect();
+                update_pending_complex(sems, complex_alter, complex_const, changed, wake_queue);
+            }
+            return Ok(None);
+        }
+
+        let pending_ops = match (pending_op.is_simple(), alter) {
+            (true, _) => {
+                let sem_num = pending_op.sops_iter().next().unwrap().sem_num();
+                let entry = sems[sem_num as usize].get_mut();
+                if alter {
+                    &mut entry.pending_alter
+                } else {
+                    &mut entry.pending_const
+                }
+            }
+            (false, true) => complex_alter,
+            (false, false) => complex_const,
+        };
+        Ok(Some(queue_op(pending_ops, pending_op)))
+    }
+
+    /// Removes the queued operation of the status from the set, e.g., when its wait times out.
+    ///
+    /// Returns the final status of the operation, which is [`Status::Pending`] if the operation
+    /// is removed, or the status that it has completed with otherwise.
+    pub(super) fn dequeue(
+        &self,
+        status: &Arc<AtomicStatus>,
+        simple_sem_num: Option<u16>,
+        alter: bool,
+    ) -> Status {
+        let is_other_op = |op: &PendingOp| !Arc::ptr_eq(op.status(), status);
+
+        // The status only changes with the operation locked, so it is up-to-date after locking.
+        if let Some(sem_num) = simple_sem_num {
+            let inner = self.inner.read();
+            let mut entry = inner.sems[sem_num as usize].lock();
+            let final_status = status.load(Ordering::Acquire);
+            if let Status::Pending = final_status {
+                let pending_ops = if alter {
+                    &mut entry.pending_alter
+                } else {
+                    &mut entry.pending_const
+                };
+                pending_ops.retain(is_other_op);
+            }
+            final_status
+        } else {
+            let mut inner = self.inner.write();
+            let final_status = status.load(Ordering::Acquire);
+            if let Status::Pending = final_status {
+                let pending_ops = if alter {
+                    &mut inner.complex_alter
+                } else {
+                    &mut inner.complex_const
+                };
+                pending_ops.retain(is_other_op);
+            }
+            final_status
+        }
     }
 
     fn new(key: key_t, nsems: usize, mode: u16, credentials: Credentials<ReadOp>) -> Result<Self> {
@@ -178,7 +290,7 @@ impl SemaphoreSet {
 
         let mut sems = Vec::with_capacity(nsems);
         for _ in 0..nsems {
-            sems.push(Semaphore::new(0));
+            sems.push(SpinLock::new(SemEntry::new(0)));
         }
 
         let permission =
@@ -189,35 +301,40 @@ impl SemaphoreSet {
             permission,
             sem_ctime: AtomicU64::new(RealTimeCoarseClock::get().read_time().as_secs()),
             sem_otime: AtomicU64::new(0),
-            inner: SpinLock::new(SemSetInner {
+            inner: RwLock::new(SemSetInner {
                 sems: sems.into_boxed_slice(),
-                pending_alter: LinkedList::new(),
-                pending_const: LinkedList::new(),
+                complex_alter: LinkedList::new(),
+                complex_const: LinkedList::new(),
             }),
         })
     }
 }
 
+/// Counts the operations on the semaphore in the pending operations.
+fn count_sops(pending_ops: &LinkedList<PendingOp>, sem_num: u16) -> usize {
+    pending_ops
+        .iter()
+        .flat_map(PendingOp::sops_iter)
+        .filter(|sem_buf| sem_buf.sem_num() == sem_num)
+        .count()
+}
+
 impl Drop for SemaphoreSet {
     fn drop(&mut self) {
-        let mut inner = self.inner();
-        let pending_alter = &mut inner.pending_alter;
-        for pending_alter in pending_alter.iter_mut() {
-            pending_alter.set_status(Status::Removed);
-            if let Some(ref waker) = pending_alter.waker() {
-                waker.wake_up();
-            }
-        }
-        pending_alter.clear();
-
-        let pending_const = &mut inner.pending_const;
-        for pending_const in pending_const.iter_mut() {
-            pending_const.set_status(Status::Removed);
-            if let Some(ref waker) = pending_const.waker() {
-                waker.wake_up();
+        let inner = self.inner.get_mut();
+        let entries = inner.sems.iter_mut().map(SpinLock::get_mut);
+        let pending_ops = entries
+            .flat_map(|entry| [&mut entry.pending_alter, &mut entry.pending_const])
+            .chain([&mut inner.complex_alter, &mut inner.complex_const]);
+        for pending_ops in pending_ops {
+            for pending_op in pending_ops.iter() {
+                pending_op.set_status(Status::Removed);
+                if let Some(ref waker) = pending_op.waker() {
+                    waker.wake_up();
+                }
             }
+            pending_ops.clear();
         }
-        pending_const.clear();
 
         ID_ALLOCATOR
             .get()
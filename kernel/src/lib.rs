@@ -60,10 +60,13 @@ pub mod kcmdline;
 pub mod net;
 pub mod prelude;
 mod process;
+#[cfg(target_arch = "x86_64")]
+mod profiler;
 mod sched;
 pub mod syscall;
 pub mod thread;
 pub mod time;
+mod trace;
 mod util;
 pub(crate) mod vdso;
 pub mod vm;
@@ -95,10 +98,12 @@ pub fn init() {
     #[cfg(target_arch = "x86_64")]
     net::init();
     sched::init();
+    sched::init_cpu_time_on_current_cpu();
     fs::rootfs::init(boot_info().initramfs.expect("No initramfs found!")).unwrap();
     device::init().unwrap();
     syscall::init();
     vdso::init();
+    trace::init();
     process::init();
 }
 
@@ -109,15 +114,14 @@ fn ap_init() {
         drop(preempt_guard);
         log::info!("Kernel idle thread for CPU #{} started.", cpu_id.as_usize());
 
-        loop {
-            crate::thread::Thread::yield_now();
-            ostd::cpu::sleep_for_interrupt();
-        }
+        sched::idle_loop();
     }
     let preempt_guard = ostd::task::disable_preempt();
     let cpu_id = preempt_guard.current_cpu();
     drop(preempt_guard);
 
+    sched::init_cpu_time_on_current_cpu();
+
     ThreadOptions::new(ap_idle_thread)
         .cpu_affinity(cpu_id.into())
         .sched_policy(SchedPolicy::Idle)
@@ -132,7 +136,10 @@ fn init_thread() {
     #[cfg(target_arch = "x86_64")]
     net::lazy_init();
     fs::lazy_init();
+    vm::lazy_init();
     ipc::init();
+    #[cfg(target_arch = "x86_64")]
+    profiler::init();
     // driver::pci::virtio::block::block_device_test();
     let thread = ThreadOptions::new(|| {
         println!("[kernel] Hello world from kernel!");
@@ -46,7 +46,13 @@ pub fn init() {
         for (name, _) in aster_network::all_devices() {
             // TODO: further check that the irq num is the same as iface's irq num
             let callback = || iface_virtio.poll();
-            aster_network::register_recv_callback(&name, callback);
+            // The received packets are left to the busy-pollers that prefer to process them.
+            let recv_callback = || {
+                if !iface_virtio.sched_poll().is_busy_poll_preferred() {
+                    iface_virtio.poll();
+                }
+            };
+            aster_network::register_recv_callback(&name, recv_callback);
             aster_network::register_send_callback(&name, callback);
         }
     }
@@ -8,8 +8,11 @@ use ostd::timer::Jiffies;
 
 use super::{iter_all_ifaces, Iface};
 use crate::{
+    prelude::*,
+    process::posix_thread::AsPosixThread,
     sched::{Nice, SchedPolicy},
     thread::kernel_thread::ThreadOptions,
+    time::{clocks::MonotonicClock, Clock},
     WaitTimeout,
 };
 
@@ -25,6 +28,78 @@ pub(super) fn poll_ifaces() {
     }
 }
 
+/// Busy-polls the interface until `try_op` gives a result or `duration` elapses.
+///
+/// If `iface` is `None`, all the interfaces are polled. This function fails with `EAGAIN` if
+/// `try_op` still fails with `EAGAIN` when `duration` elapses, or when a signal arrives. Then the
+/// caller should block to wait for the events instead.
+///
+/// If `prefer` is true, the interrupts of the interfaces leave the received packets to be
+/// processed by the busy-poller, like `SO_PREFER_BUSY_POLL` in Linux.
+pub fn busy_poll<F, R>(
+    iface: Option<&Arc<Iface>>,
+    duration: Duration,
+    prefer: bool,
+    mut try_op: F,
+) -> Result<R>
+where
+    F: FnMut() -> Result<R>,
+{
+    let ifaces: Vec<&Arc<Iface>> = match iface {
+        Some(iface) => vec![iface],
+        None => iter_all_ifaces().collect(),
+    };
+    let _guard = prefer.then(|| PreferredBusyPollGuard::new(&ifaces));
+
+    let deadline = MonotonicClock::get().read_time() + duration;
+    let current_thread = current_thread!();
+    let posix_thread = current_thread.as_posix_thread();
+    loop {
+        for iface in ifaces.iter() {
+            if prefer {
+                iface.sched_poll().record_busy_poll();
+            }
+            iface.poll();
+        }
+
+        match try_op() {
+            Err(err) if err.error() == Errno::EAGAIN => (),
+            result => return result,
+        }
+
+        if MonotonicClock::get().read_time() >= deadline
+            || posix_thread.is_some_and(|thread| thread.has_pending())
+        {
+            return_errno_with_message!(Errno::EAGAIN, "no events arrive when busy polling");
+        }
+
+        core::hint::spin_loop();
+    }
+}
+
+struct PreferredBusyPollGuard<'a> {
+    ifaces: &'a [&'a Arc<Iface>],
+}
+
+impl<'a> PreferredBusyPollGuard<'a> {
+    fn new(ifaces: &'a [&'a Arc<Iface>]) -> Self {
+        for iface in ifaces.iter() {
+            iface.sched_poll().inc_preferred_busy_pollers();
+        }
+        Self { ifaces }
+    }
+}
+
+impl Drop for PreferredBusyPollGuard<'_> {
+    fn drop(&mut self) {
+        for iface in self.ifaces.iter() {
+            iface.sched_poll().dec_preferred_busy_pollers();
+            // The interrupts may have left some packets to us.
+            iface.poll();
+        }
+    }
+}
+
 fn spawn_background_poll_thread(iface: Arc<Iface>) {
     let task_fn = move || {
         trace!("spawn background poll thread for {}", iface.name());
@@ -1,9 +1,16 @@
 // SPDX-License-Identifier: MPL-2.0
 
-use core::sync::atomic::{AtomicU64, Ordering};
+use core::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
 
 use aster_bigtcp::iface::ScheduleNextPoll;
-use ostd::sync::WaitQueue;
+use ostd::{sync::WaitQueue, timer::Jiffies};
+
+/// The longest time for which the interrupts leave the packets to the busy-pollers that have
+/// stopped polling the interface, like `gro_flush_timeout` in Linux.
+///
+/// After this, the interrupts process the packets again, so that the packets of the other
+/// sockets are not delayed by a busy-poller that is, e.g., preempted.
+const BUSY_POLL_DEFER_TIMEOUT_MS: u64 = 2;
 
 pub struct PollScheduler {
     /// The time when we should do the next poll.
@@ -11,6 +18,11 @@ pub struct PollScheduler {
     next_poll_at_ms: AtomicU64,
     /// The wait queue that the background polling thread will sleep on.
     polling_wait_queue: WaitQueue,
+    /// The number of the busy-pollers that prefer to process the packets themselves.
+    nr_preferred_busy_pollers: AtomicUsize,
+    /// The time when a preferred busy-poller last polled the interface, in milliseconds since
+    /// the system booted.
+    last_busy_poll_at_ms: AtomicU64,
 }
 
 impl PollScheduler {
@@ -18,6 +30,8 @@ impl PollScheduler {
         Self {
             next_poll_at_ms: AtomicU64::new(0),
             polling_wait_queue: WaitQueue::new(),
+            nr_preferred_busy_pollers: AtomicUsize::new(0),
+            last_busy_poll_at_ms: AtomicU64::new(0),
         }
     }
 
@@ -33,6 +47,41 @@ impl PollScheduler {
     pub(super) fn polling_wait_queue(&self) -> &WaitQueue {
         &self.polling_wait_queue
     }
+
+    /// Returns whether the interrupts of the device should leave the packets to the
+    /// busy-pollers (`SO_PREFER_BUSY_POLL`).
+    ///
+    /// The packets are only left while the busy-pollers keep polling the interface. See
+    /// [`BUSY_POLL_DEFER_TIMEOUT_MS`].
+    pub(super) fn is_busy_poll_preferred(&self) -> bool {
+        if self.nr_preferred_busy_pollers.load(Ordering::Relaxed) == 0 {
+            return false;
+        }
+
+        let last_busy_poll_at_ms = self.last_busy_poll_at_ms.load(Ordering::Relaxed);
+        now_as_ms() <= last_busy_poll_at_ms + BUSY_POLL_DEFER_TIMEOUT_MS
+    }
+
+    pub(super) fn inc_preferred_busy_pollers(&self) {
+        self.record_busy_poll();
+        self.nr_preferred_busy_pollers
+            .fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// Records that a preferred busy-poller has polled the interface.
+    pub(super) fn record_busy_poll(&self) {
+        self.last_busy_poll_at_ms
+            .store(now_as_ms(), Ordering::Relaxed);
+    }
+
+    pub(super) fn dec_preferred_busy_pollers(&self) {
+        self.nr_preferred_busy_pollers
+            .fetch_sub(1, Ordering::Relaxed);
+    }
+}
+
+fn now_as_ms() -> u64 {
+    Jiffies::elapsed().as_duration().as_millis() as u64
 }
 
 impl ScheduleNextPoll for PollScheduler {
@@ -1,5 +1,7 @@
 // SPDX-License-Identifier: MPL-2.0
 
+use core::time::Duration;
+
 use aster_bigtcp::{
     errors::BindError,
     iface::BindPortConfig,
@@ -7,7 +9,11 @@ use aster_bigtcp::{
 };
 
 use crate::{
-    net::iface::{iter_all_ifaces, loopback_iface, virtio_iface, BoundPort, Iface},
+    events::IoEvents,
+    net::{
+        iface::{busy_poll, iter_all_ifaces, loopback_iface, virtio_iface, BoundPort, Iface},
+        socket::private::SocketPrivate,
+    },
     prelude::*,
 };
 
@@ -77,6 +83,35 @@ impl From<BindError> for Error {
     }
 }
 
+/// Performs `try_op` like [`SocketPrivate::block_on`], except that the interface is busy-polled
+/// for `busy_poll_usecs` microseconds before blocking (`SO_BUSY_POLL`).
+///
+/// `iface` is called to get the interface only if busy polling is enabled.
+pub(super) fn block_on_with_busy_poll<S, I, F, R>(
+    socket: &S,
+    events: IoEvents,
+    (busy_poll_usecs, prefer_busy_poll): (u32, bool),
+    iface: I,
+    mut try_op: F,
+) -> Result<R>
+where
+    S: SocketPrivate,
+    I: FnOnce() -> Option<Arc<Iface>>,
+    F: FnMut() -> Result<R>,
+{
+    if busy_poll_usecs > 0 && !socket.is_nonblocking() {
+        if let Some(iface) = iface() {
+            let duration = Duration::from_micros(busy_poll_usecs as u64);
+            match busy_poll(Some(&iface), duration, prefer_busy_poll, &mut try_op) {
+                Err(err) if err.error() == Errno::EAGAIN => (),
+                result => return result,
+            }
+        }
+    }
+
+    socket.block_on(events, try_op)
+}
+
 pub(super) fn get_ephemeral_endpoint(remote_endpoint: &IpEndpoint) -> IpEndpoint {
     let iface = get_ephemeral_iface(&remote_endpoint.addr);
     let ip_addr = iface.ipv4_addr().unwrap();
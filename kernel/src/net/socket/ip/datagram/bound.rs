@@ -5,6 +5,7 @@ use aster_bigtcp::{
     wire::IpEndpoint,
 };
 
+use super::options::UDP_MAX_SEGMENTS;
 use crate::{
     events::IoEvents,
     net::{
@@ -31,6 +32,102 @@ impl BoundDatagram {
     pub(super) fn iface(&self) -> &Arc<Iface> {
         self.bound_socket.iface()
     }
+
+    /// Receives the queued datagrams that can be coalesced into one (`UDP_GRO`).
+    ///
+    /// The datagrams are coalesced if they come from the same endpoint and have the same size,
+    /// except that the last one can be shorter. The segment size is returned along with the
+    /// received bytes if more than one datagram is coalesced.
+    pub(super) fn try_recv_coalesced(
+        &self,
+        writer: &mut dyn MultiWrite,
+    ) -> Result<(usize, IpEndpoint, Option<usize>)> {
+        let mut recv_bytes = 0;
+        let mut first_datagram = None;
+        let mut nr_datagrams = 0;
+        let mut last_len = 0;
+        let mut error = None;
+
+        let result = self.bound_socket.recv_while(|packet, udp_metadata| {
+            match first_datagram {
+                None => first_datagram = Some((udp_metadata.endpoint, packet.len())),
+                Some((endpoint, segment_size)) => {
+                    if endpoint != udp_metadata.endpoint
+                        || segment_size == 0
+                        || last_len < segment_size
+                        || packet.len() > segment_size
+                        || packet.len() > writer.sum_lens()
+                        || nr_datagrams >= UDP_MAX_SEGMENTS
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            match writer.write(&mut VmReader::from(packet)) {
+                Ok(len) => recv_bytes += len,
+                Err(err) => {
+                    error = Some(err);
+                    return false;
+                }
+            }
+            last_len = packet.len();
+            nr_datagrams += 1;
+            true
+        });
+
+        match result {
+            Ok(_) if nr_datagrams == 0 => Err(error.unwrap()),
+            Ok(_) => {
+                let (endpoint, segment_size) = first_datagram.unwrap();
+                Ok((
+                    recv_bytes,
+                    endpoint,
+                    (nr_datagrams > 1).then_some(segment_size),
+                ))
+            }
+            Err(RecvError::Exhausted) => {
+                return_errno_with_message!(Errno::EAGAIN, "the receive buffer is empty")
+            }
+            Err(RecvError::Truncated) => {
+                unreachable!("`recv_while` should never fail with `RecvError::Truncated`")
+            }
+        }
+    }
+
+    /// Sends the data as multiple datagrams of `segment_size` bytes (`UDP_SEGMENT`).
+    pub(super) fn try_send_segmented(
+        &self,
+        reader: &mut dyn MultiRead,
+        remote: &IpEndpoint,
+        segment_size: usize,
+    ) -> Result<usize> {
+        let size = reader.sum_lens();
+        if size.div_ceil(segment_size) > UDP_MAX_SEGMENTS {
+            return_errno_with_message!(Errno::EINVAL, "the message has too many segments");
+        }
+
+        let mut error = None;
+        let result =
+            self.bound_socket
+                .send_segmented(size, segment_size, *remote, |socket_buffer| {
+                    // FIXME: If copy failed, we should not send any packet.
+                    match reader.read(&mut VmWriter::from(socket_buffer)) {
+                        Ok(_) => true,
+                        Err(err) => {
+                            warn!("unexpected UDP packet {err:#?} will be sent");
+                            error = Some(err);
+                            false
+                        }
+                    }
+                });
+
+        match (result, error) {
+            (Ok(_), Some(err)) => Err(err),
+            (Ok(sent_bytes), None) => Ok(sent_bytes),
+            (Err(err), _) => Err(send_error_to_errno(err)),
+        }
+    }
 }
 
 impl datagram_common::Bound for BoundDatagram {
@@ -91,15 +188,7 @@ impl datagram_common::Bound for BoundDatagram {
 
         match result {
             Ok(inner) => inner,
-            Err(SendError::TooLarge) => {
-                return_errno_with_message!(Errno::EMSGSIZE, "the message is too large");
-            }
-            Err(SendError::Unaddressable) => {
-                return_errno_with_message!(Errno::EINVAL, "the destination address is invalid");
-            }
-            Err(SendError::BufferFull) => {
-                return_errno_with_message!(Errno::EAGAIN, "the send buffer is full");
-            }
+            Err(err) => Err(send_error_to_errno(err)),
         }
     }
 
@@ -119,3 +208,13 @@ impl datagram_common::Bound for BoundDatagram {
         })
     }
 }
+
+fn send_error_to_errno(err: SendError) -> Error {
+    match err {
+        SendError::TooLarge => Error::with_message(Errno::EMSGSIZE, "the message is too large"),
+        SendError::Unaddressable => {
+            Error::with_message(Errno::EINVAL, "the destination address is invalid")
+        }
+        SendError::BufferFull => Error::with_message(Errno::EAGAIN, "the send buffer is full"),
+    }
+}
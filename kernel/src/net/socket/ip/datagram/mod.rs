@@ -3,13 +3,14 @@
 use core::sync::atomic::{AtomicBool, Ordering};
 
 use aster_bigtcp::wire::IpEndpoint;
+use options::{UdpGro, UdpOptionSet, UdpSegment};
 use unbound::BindOptions;
 
 use self::{bound::BoundDatagram, unbound::UnboundDatagram};
-use super::UNSPECIFIED_LOCAL_ENDPOINT;
+use super::{common::block_on_with_busy_poll, UNSPECIFIED_LOCAL_ENDPOINT};
 use crate::{
     events::IoEvents,
-    match_sock_option_mut,
+    match_sock_option_mut, match_sock_option_ref,
     net::socket::{
         options::{Error as SocketError, SocketOption},
         private::SocketPrivate,
@@ -18,7 +19,7 @@ use crate::{
             options::{SetSocketLevelOption, SocketOptionSet},
             send_recv_flags::SendRecvFlags,
             socket_addr::SocketAddr,
-            MessageHeader,
+            ControlMessage, MessageHeader,
         },
         Socket,
     },
@@ -29,6 +30,7 @@ use crate::{
 
 mod bound;
 mod observer;
+pub mod options;
 mod unbound;
 
 pub(in crate::net) use self::observer::DatagramObserver;
@@ -36,13 +38,14 @@ pub(in crate::net) use self::observer::DatagramObserver;
 #[derive(Debug, Clone)]
 struct OptionSet {
     socket: SocketOptionSet,
-    // TODO: UDP option set
+    udp: UdpOptionSet,
 }
 
 impl OptionSet {
     fn new() -> Self {
         let socket = SocketOptionSet::new_udp();
-        OptionSet { socket }
+        let udp = UdpOptionSet::new();
+        OptionSet { socket, udp }
     }
 }
 
@@ -70,15 +73,26 @@ impl DatagramSocket {
         &self,
         writer: &mut dyn MultiWrite,
         flags: SendRecvFlags,
-    ) -> Result<(usize, SocketAddr)> {
-        let recv_bytes = self
-            .inner
-            .read()
-            .try_recv(writer, flags)
-            .map(|(recv_bytes, remote_endpoint)| (recv_bytes, remote_endpoint.into()))?;
+        is_gro: bool,
+    ) -> Result<(usize, SocketAddr, Option<ControlMessage>)> {
+        let inner = self.inner.read();
+        let (recv_bytes, remote_endpoint, control_message) = match &*inner {
+            Inner::Bound(bound_datagram) if is_gro => {
+                let (recv_bytes, remote_endpoint, segment_size) =
+                    bound_datagram.try_recv_coalesced(writer)?;
+                let control_message =
+                    segment_size.map(|size| ControlMessage::UdpGroSegmentSize(size as u16));
+                (recv_bytes, remote_endpoint, control_message)
+            }
+            _ => {
+                let (recv_bytes, remote_endpoint) = inner.try_recv(writer, flags)?;
+                (recv_bytes, remote_endpoint, None)
+            }
+        };
+        drop(inner);
         self.pollee.invalidate();
 
-        Ok(recv_bytes)
+        Ok((recv_bytes, remote_endpoint.into(), control_message))
     }
 
     fn try_send(
@@ -86,6 +100,7 @@ impl DatagramSocket {
         reader: &mut dyn MultiRead,
         remote: Option<&IpEndpoint>,
         flags: SendRecvFlags,
+        gso_size: u16,
     ) -> Result<usize> {
         let (sent_bytes, iface_to_poll) = select_remote_and_bind(
             &self.inner,
@@ -102,7 +117,11 @@ impl DatagramSocket {
                     .bind_ephemeral(remote_endpoint, &self.pollee)
             },
             |bound_datagram, remote_endpoint| {
-                let sent_bytes = bound_datagram.try_send(reader, remote_endpoint, flags)?;
+                let sent_bytes = if gso_size == 0 {
+                    bound_datagram.try_send(reader, remote_endpoint, flags)?
+                } else {
+                    bound_datagram.try_send_segmented(reader, remote_endpoint, gso_size as usize)?
+                };
                 let iface_to_poll = bound_datagram.iface().clone();
                 Ok((sent_bytes, iface_to_poll))
             },
@@ -193,8 +212,10 @@ impl Socket for DatagramSocket {
             warn!("sending control message is not supported");
         }
 
+        let gso_size = self.options.read().udp.gso_size();
+
         // TODO: Block if the send buffer is full
-        self.try_send(reader, endpoint.as_ref(), flags)
+        self.try_send(reader, endpoint.as_ref(), flags, gso_size)
     }
 
     fn recvmsg(
@@ -203,16 +224,35 @@ impl Socket for DatagramSocket {
         flags: SendRecvFlags,
     ) -> Result<(usize, MessageHeader)> {
         // TODO: Deal with flags
-        if !flags.is_all_supported() {
+        if !(flags - SendRecvFlags::MSG_DONTWAIT).is_all_supported() {
             warn!("unsupported flags: {:?}", flags);
         }
 
-        let (received_bytes, peer_addr) =
-            self.block_on(IoEvents::IN, || self.try_recv(writer, flags))?;
-
-        // TODO: Receive control message
+        let (is_gro, busy_poll) = {
+            let options = self.options.read();
+            let busy_poll = (
+                options.socket.busy_poll(),
+                options.socket.prefer_busy_poll(),
+            );
+            (options.udp.gro(), busy_poll)
+        };
+        let (received_bytes, peer_addr, control_message) =
+            if flags.contains(SendRecvFlags::MSG_DONTWAIT) {
+                self.try_recv(writer, flags, is_gro)?
+            } else {
+                block_on_with_busy_poll(
+                    self,
+                    IoEvents::IN,
+                    busy_poll,
+                    || match &*self.inner.read() {
+                        Inner::Bound(bound_datagram) => Some(bound_datagram.iface().clone()),
+                        Inner::Unbound(_) => None,
+                    },
+                    || self.try_recv(writer, flags, is_gro),
+                )?
+            };
 
-        let message_header = MessageHeader::new(Some(peer_addr), None);
+        let message_header = MessageHeader::new(Some(peer_addr), control_message);
 
         Ok((received_bytes, message_header))
     }
@@ -224,6 +264,16 @@ impl Socket for DatagramSocket {
                 socket_errors.set(None);
                 return Ok(());
             },
+            udp_segment: UdpSegment => {
+                let gso_size = self.options.read().udp.gso_size();
+                udp_segment.set(gso_size as u32);
+                return Ok(());
+            },
+            udp_gro: UdpGro => {
+                let gro = self.options.read().udp.gro();
+                udp_gro.set(gro);
+                return Ok(());
+            },
             _ => ()
         });
 
@@ -231,6 +281,22 @@ impl Socket for DatagramSocket {
     }
 
     fn set_option(&self, option: &dyn SocketOption) -> Result<()> {
+        match_sock_option_ref!(option, {
+            udp_segment: UdpSegment => {
+                let gso_size = u16::try_from(*udp_segment.get().unwrap()).map_err(|_| {
+                    Error::with_message(Errno::EINVAL, "the segment size is too large")
+                })?;
+                self.options.write().udp.set_gso_size(gso_size);
+                return Ok(());
+            },
+            udp_gro: UdpGro => {
+                let gro = udp_gro.get().unwrap();
+                self.options.write().udp.set_gro(*gro);
+                return Ok(());
+            },
+            _ => ()
+        });
+
         let inner = self.inner.read();
         let mut options = self.options.write();
 
@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use crate::{impl_socket_options, prelude::*};
+
+impl_socket_options!(
+    pub struct UdpSegment(u32);
+    pub struct UdpGro(bool);
+);
+
+/// UDP-level socket options.
+#[derive(Debug, Clone, Copy, CopyGetters, Setters)]
+#[get_copy = "pub"]
+#[set = "pub"]
+pub(super) struct UdpOptionSet {
+    /// The size of the segments that the sent data are split into, or zero if the data are sent
+    /// as one datagram.
+    gso_size: u16,
+    /// Whether the received datagrams can be coalesced.
+    gro: bool,
+}
+
+/// The maximum number of the segments that the data of one send can be split into.
+///
+/// Reference: <https://elixir.bootlin.com/linux/v6.0.9/source/include/linux/udp.h#L97>.
+pub(super) const UDP_MAX_SEGMENTS: usize = 64;
+
+impl UdpOptionSet {
+    pub(super) const fn new() -> Self {
+        Self {
+            gso_size: 0,
+            gro: false,
+        }
+    }
+}
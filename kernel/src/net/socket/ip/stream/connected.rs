@@ -172,13 +172,13 @@ impl ConnectedStream {
             // otherwise, check if the socket can receive.
             if is_receiving_closed {
                 events |= IoEvents::IN | IoEvents::RDHUP;
-            } else if socket.can_recv() {
+            } else if socket.has_recv_data() {
                 events |= IoEvents::IN;
             }
 
             // If the sending side is closed, always add an OUT event;
             // otherwise, check if the socket can send.
-            if is_sending_closed || socket.can_send() {
+            if is_sending_closed || socket.has_send_space() {
                 events |= IoEvents::OUT;
             }
 
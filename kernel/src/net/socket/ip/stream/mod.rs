@@ -19,6 +19,7 @@ use takeable::Takeable;
 use util::{Retrans, TcpOptionSet};
 
 use super::{
+    common::block_on_with_busy_poll,
     options::{IpOptionSet, SetIpLevelOption},
     UNSPECIFIED_LOCAL_ENDPOINT,
 };
@@ -96,6 +97,8 @@ impl OptionSet {
         RawTcpOption {
             keep_alive: self.socket.keep_alive().then_some(KEEPALIVE_INTERVAL),
             is_nagle_enabled: !self.tcp.no_delay(),
+            reuse_port: self.socket.reuse_port(),
+            incoming_cpu: u32::try_from(self.socket.incoming_cpu()).ok(),
         }
     }
 }
@@ -433,7 +436,11 @@ impl Socket for StreamSocket {
             return_errno_with_message!(Errno::EINVAL, "the socket is already bound to an address");
         };
 
-        let can_reuse = self.options.read().socket.reuse_addr();
+        // Sockets with SO_REUSEPORT can bind to the same port, and then listen on it together.
+        let can_reuse = {
+            let options = self.options.read();
+            options.socket.reuse_addr() || options.socket.reuse_port()
+        };
         init_stream.bind(&endpoint, can_reuse)
     }
 
@@ -574,7 +581,20 @@ impl Socket for StreamSocket {
             warn!("unsupported flags: {:?}", flags);
         }
 
-        let (received_bytes, _) = self.block_on(IoEvents::IN, || self.try_recv(writer, flags))?;
+        let busy_poll = {
+            let options = self.options.read();
+            (
+                options.socket.busy_poll(),
+                options.socket.prefer_busy_poll(),
+            )
+        };
+        let (received_bytes, _) = block_on_with_busy_poll(
+            self,
+            IoEvents::IN,
+            busy_poll,
+            || self.state.read().iface().cloned(),
+            || self.try_recv(writer, flags),
+        )?;
 
         // TODO: Receive control message
 
@@ -3,7 +3,7 @@
 use self::options::SocketOption;
 pub use self::util::{
     options::LingerOption, send_recv_flags::SendRecvFlags, shutdown_cmd::SockShutdownCmd,
-    socket_addr::SocketAddr, MessageHeader,
+    socket_addr::SocketAddr, ControlMessage, MessageHeader,
 };
 use crate::{
     fs::{
@@ -20,4 +20,7 @@ impl_socket_options!(
     pub struct Error(Option<crate::error::Error>);
     pub struct Linger(LingerOption);
     pub struct KeepAlive(bool);
+    pub struct IncomingCpu(i32);
+    pub struct BusyPoll(u32);
+    pub struct PreferBusyPoll(bool);
 );
@@ -4,9 +4,10 @@ use core::ops::Deref;
 
 use ostd::sync::PreemptDisabled;
 
+use super::inflight::InflightFiles;
 use crate::{
     events::IoEvents,
-    fs::utils::{Channel, Consumer, Producer},
+    fs::{file_handle::FileLike, pipe::PipeBuffer},
     net::socket::{
         unix::{addr::UnixSocketAddrBound, UnixSocketAddr},
         SockShutdownCmd,
@@ -18,8 +19,8 @@ use crate::{
 
 pub(super) struct Connected {
     addr: AddrView,
-    reader: Consumer<u8>,
-    writer: Producer<u8>,
+    reader: Arc<StreamBuffer>,
+    writer: Arc<StreamBuffer>,
 }
 
 impl Connected {
@@ -29,10 +30,10 @@ impl Connected {
         reader_pollee: Option<Pollee>,
         writer_pollee: Option<Pollee>,
     ) -> (Connected, Connected) {
-        let (writer_peer, reader_this) =
-            Channel::with_capacity_and_pollees(DEFAULT_BUF_SIZE, None, reader_pollee).split();
-        let (writer_this, reader_peer) =
-            Channel::with_capacity_and_pollees(DEFAULT_BUF_SIZE, writer_pollee, None).split();
+        let reader_this = Arc::new(StreamBuffer::new(reader_pollee, None));
+        let writer_this = Arc::new(StreamBuffer::new(None, writer_pollee));
+        let reader_peer = writer_this.clone();
+        let writer_peer = reader_this.clone();
 
         let (addr_this, addr_peer) = AddrView::new_pair(addr, peer_addr);
 
@@ -71,33 +72,169 @@ impl Connected {
         Ok(())
     }
 
-    pub(super) fn try_read(&self, writer: &mut dyn MultiWrite) -> Result<usize> {
+    /// Tries to read the bytes and the files passed with them.
+    ///
+    /// The read stops before the bytes that carry other files, so the files
+    /// are received along with the first byte sent with them.
+    pub(super) fn try_read(
+        &self,
+        writer: &mut dyn MultiWrite,
+    ) -> Result<(usize, Option<Vec<Arc<dyn FileLike>>>)> {
         self.reader.try_read(writer)
     }
 
-    pub(super) fn try_write(&self, reader: &mut dyn MultiRead) -> Result<usize> {
-        self.writer.try_write(reader)
+    /// Tries to write the bytes and the files passed with them.
+    ///
+    /// `files` is taken only if some bytes are written.
+    pub(super) fn try_write(
+        &self,
+        reader: &mut dyn MultiRead,
+        files: &mut Option<InflightFiles>,
+    ) -> Result<usize> {
+        self.writer.try_write(reader, files)
     }
 
     pub(super) fn shutdown(&self, cmd: SockShutdownCmd) {
         if cmd.shut_read() {
-            self.reader.shutdown();
+            self.reader.buffer.shutdown();
         }
 
         if cmd.shut_write() {
-            self.writer.shutdown();
+            self.writer.buffer.shutdown();
         }
     }
 
     pub(super) fn poll(&self, mask: IoEvents, mut poller: Option<&mut PollHandle>) -> IoEvents {
         // Note that `mask | IoEvents::ALWAYS_POLL` contains all the events we care about.
-        let reader_events = self.reader.poll(mask, poller.as_deref_mut());
-        let writer_events = self.writer.poll(mask, poller);
+        let reader_events = self.reader.buffer.poll_reader(mask, poller.as_deref_mut());
+        let writer_events = self.writer.buffer.poll_writer(mask, poller);
 
         combine_io_events(mask, reader_events, writer_events)
     }
 }
 
+impl Drop for Connected {
+    fn drop(&mut self) {
+        self.reader.buffer.shutdown();
+        self.writer.buffer.shutdown();
+    }
+}
+
+/// The buffer of the bytes sent in one direction.
+///
+/// The bytes are copied into the pages allocated by the sender, which are then
+/// moved to the receiver by reference. Like a pipe, the sender and the receiver
+/// only contend for the queue of the pages, instead of a ring of bytes.
+///
+/// The files passed with `SCM_RIGHTS` are queued along with the offsets of the
+/// bytes that carry them. A sender pushes the files before writing the bytes,
+/// and a receiver only takes the files after seeing the bytes, so the files
+/// are removed by the sender if writing fails, before anyone can take them.
+struct StreamBuffer {
+    buffer: PipeBuffer,
+    /// The number of the written bytes, which also serializes the writers.
+    write_offset: Mutex<usize>,
+    /// The number of the read bytes, which also serializes the readers.
+    read_offset: Mutex<usize>,
+    /// The passed files and the offsets of the bytes that carry them.
+    files: Mutex<VecDeque<(usize, InflightFiles)>>,
+}
+
+impl StreamBuffer {
+    fn new(reader_pollee: Option<Pollee>, writer_pollee: Option<Pollee>) -> Self {
+        Self {
+            buffer: PipeBuffer::with_capacity_and_pollees(
+                DEFAULT_BUF_SIZE,
+                reader_pollee,
+                writer_pollee,
+            ),
+            write_offset: Mutex::new(0),
+            read_offset: Mutex::new(0),
+            files: Mutex::new(VecDeque::new()),
+        }
+    }
+
+    fn try_write(
+        &self,
+        reader: &mut dyn MultiRead,
+        files: &mut Option<InflightFiles>,
+    ) -> Result<usize> {
+        let mut write_offset = self.write_offset.lock();
+
+        // Like Linux, the files are dropped if no bytes are sent with them.
+        let has_files = match files.take() {
+            Some(files) if !reader.is_empty() => {
+                self.files.lock().push_back((*write_offset, files));
+                true
+            }
+            _ => false,
+        };
+
+        let result = self.buffer.try_write(reader);
+        match result {
+            Ok(written_len) if written_len > 0 => *write_offset += written_len,
+            _ if has_files => *files = self.files.lock().pop_back().map(|(_, files)| files),
+            _ => (),
+        }
+
+        result
+    }
+
+    fn try_read(
+        &self,
+        writer: &mut dyn MultiWrite,
+    ) -> Result<(usize, Option<Vec<Arc<dyn FileLike>>>)> {
+        if writer.is_empty() {
+            return Ok((0, None));
+        }
+
+        let mut read_offset = self.read_offset.lock();
+
+        // This must be recorded before the actual operation to avoid race conditions.
+        let is_shutdown = self.buffer.is_shutdown();
+
+        let (max_len, files) = {
+            let mut queued_files = self.files.lock();
+
+            // The bytes in the buffer have been written completely, so the offsets of the files
+            // pushed later are not before the end of them.
+            let len = self.buffer.len();
+            if len == 0 {
+                if is_shutdown {
+                    return Ok((0, None));
+                }
+                return_errno_with_message!(Errno::EAGAIN, "the buffer is empty");
+            }
+
+            let files = match queued_files.front() {
+                Some((offset, _)) if *offset == *read_offset => queued_files.pop_front(),
+                _ => None,
+            };
+            let max_len = match queued_files.front() {
+                Some((offset, _)) => len.min(*offset - *read_offset),
+                None => len,
+            };
+            (max_len.min(writer.sum_lens()), files)
+        };
+
+        let result = self
+            .buffer
+            .try_consume(max_len, |page| writer.write(&mut page.reader()));
+        match result {
+            Ok(read_len) if read_len > 0 => {
+                *read_offset += read_len;
+                Ok((read_len, files.map(|(_, files)| files.into_files())))
+            }
+            result => {
+                if let Some(files) = files {
+                    self.files.lock().push_front(files);
+                }
+                result.map(|read_len| (read_len, None))
+            }
+        }
+    }
+}
+
 pub(super) fn combine_io_events(
     mask: IoEvents,
     reader_events: IoEvents,
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use crate::{
+    fs::file_handle::FileLike,
+    prelude::*,
+    process::{credentials::capabilities::CapSet, posix_thread::AsPosixThread, ResourceType},
+};
+
+/// The number of the files in flight charged to each user.
+static NR_INFLIGHT_FILES: SpinLock<BTreeMap<u32, usize>> = SpinLock::new(BTreeMap::new());
+
+/// The files passed with `SCM_RIGHTS` that are sent but not yet received.
+///
+/// The files are charged to the real user of the sender until they are
+/// received or dropped. Like `too_many_unix_fds` in Linux, a user cannot pass
+/// more files once its files in flight exceed its `RLIMIT_NOFILE`, unless it
+/// has `CAP_SYS_RESOURCE` or `CAP_SYS_ADMIN`. The sockets in flight can form
+/// reference cycles that are not garbage collected, so this bounds the files
+/// that a user can leak in this way.
+pub(super) struct InflightFiles {
+    files: Vec<Arc<dyn FileLike>>,
+    user: u32,
+}
+
+impl InflightFiles {
+    /// Charges the files to the current user.
+    pub(super) fn new(files: Vec<Arc<dyn FileLike>>) -> Result<Self> {
+        let credentials = current_thread!().as_posix_thread().unwrap().credentials();
+        let user = u32::from(credentials.ruid());
+        let is_privileged = credentials
+            .effective_capset()
+            .intersects(CapSet::SYS_RESOURCE | CapSet::SYS_ADMIN);
+        let max_nr_files = current!()
+            .resource_limits()
+            .get_rlimit(ResourceType::RLIMIT_NOFILE)
+            .get_cur();
+
+        let mut nr_inflight_files = NR_INFLIGHT_FILES.lock();
+        let nr_files = nr_inflight_files.entry(user).or_insert(0);
+        if *nr_files as u64 > max_nr_files && !is_privileged {
+            return_errno_with_message!(Errno::ETOOMANYREFS, "too many files are in flight");
+        }
+        *nr_files += files.len();
+
+        Ok(Self { files, user })
+    }
+
+    /// Releases the charge and returns the files, which are received.
+    pub(super) fn into_files(mut self) -> Vec<Arc<dyn FileLike>> {
+        self.uncharge();
+        core::mem::take(&mut self.files)
+    }
+
+    fn uncharge(&self) {
+        if self.files.is_empty() {
+            return;
+        }
+
+        let mut nr_inflight_files = NR_INFLIGHT_FILES.lock();
+        let nr_files = nr_inflight_files.get_mut(&self.user).unwrap();
+        *nr_files -= self.files.len();
+        if *nr_files == 0 {
+            nr_inflight_files.remove(&self.user);
+        }
+    }
+}
+
+impl Drop for InflightFiles {
+    fn drop(&mut self) {
+        // The files are dropped after the lock is released, since dropping a socket may drop
+        // the files in flight over it.
+        self.uncharge();
+    }
+}
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: MPL-2.0
 
 mod connected;
+mod inflight;
 mod init;
 mod listener;
 mod socket;
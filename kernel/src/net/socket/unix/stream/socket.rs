@@ -6,6 +6,7 @@ use takeable::Takeable;
 
 use super::{
     connected::Connected,
+    inflight::InflightFiles,
     init::Init,
     listener::{get_backlog, Backlog, Listener},
 };
@@ -15,7 +16,9 @@ use crate::{
     net::socket::{
         private::SocketPrivate,
         unix::UnixSocketAddr,
-        util::{send_recv_flags::SendRecvFlags, socket_addr::SocketAddr, MessageHeader},
+        util::{
+            send_recv_flags::SendRecvFlags, socket_addr::SocketAddr, ControlMessage, MessageHeader,
+        },
         SockShutdownCmd, Socket,
     },
     prelude::*,
@@ -63,16 +66,25 @@ impl UnixStreamSocket {
         )
     }
 
-    fn try_send(&self, buf: &mut dyn MultiRead, _flags: SendRecvFlags) -> Result<usize> {
+    fn try_send(
+        &self,
+        buf: &mut dyn MultiRead,
+        files: &mut Option<InflightFiles>,
+        _flags: SendRecvFlags,
+    ) -> Result<usize> {
         match self.state.read().as_ref() {
-            State::Connected(connected) => connected.try_write(buf),
+            State::Connected(connected) => connected.try_write(buf, files),
             State::Init(_) | State::Listen(_) => {
                 return_errno_with_message!(Errno::ENOTCONN, "the socket is not connected")
             }
         }
     }
 
-    fn try_recv(&self, buf: &mut dyn MultiWrite, _flags: SendRecvFlags) -> Result<usize> {
+    fn try_recv(
+        &self,
+        buf: &mut dyn MultiWrite,
+        _flags: SendRecvFlags,
+    ) -> Result<(usize, Option<Vec<Arc<dyn FileLike>>>)> {
         match self.state.read().as_ref() {
             State::Connected(connected) => connected.try_read(buf),
             State::Init(_) | State::Listen(_) => {
@@ -261,12 +273,16 @@ impl Socket for UnixStreamSocket {
             control_message, ..
         } = message_header;
 
-        if control_message.is_some() {
-            // TODO: Support sending control message
-            warn!("sending control message is not supported");
-        }
+        let mut files = match control_message {
+            Some(ControlMessage::Rights(files)) => Some(InflightFiles::new(files)?),
+            Some(control_message) => {
+                warn!("unsupported control message: {:?}", control_message);
+                None
+            }
+            None => None,
+        };
 
-        self.block_on(IoEvents::OUT, || self.try_send(reader, flags))
+        self.block_on(IoEvents::OUT, || self.try_send(reader, &mut files, flags))
     }
 
     fn recvmsg(
@@ -279,11 +295,10 @@ impl Socket for UnixStreamSocket {
             warn!("unsupported flags: {:?}", flags);
         }
 
-        let received_bytes = self.block_on(IoEvents::IN, || self.try_recv(writer, flags))?;
-
-        // TODO: Receive control message
+        let (received_bytes, files) =
+            self.block_on(IoEvents::IN, || self.try_recv(writer, flags))?;
 
-        let message_header = MessageHeader::new(None, None);
+        let message_header = MessageHeader::new(None, files.map(ControlMessage::Rights));
 
         Ok((received_bytes, message_header))
     }
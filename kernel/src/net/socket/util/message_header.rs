@@ -1,7 +1,12 @@
 // SPDX-License-Identifier: MPL-2.0
 
+use align_ext::AlignExt;
+
 use super::socket_addr::SocketAddr;
-use crate::prelude::*;
+use crate::{
+    fs::{file_handle::FileLike, file_table::FileDesc},
+    prelude::*,
+};
 
 /// Message header used for sendmsg/recvmsg.
 #[derive(Debug)]
@@ -23,10 +28,140 @@ impl MessageHeader {
     pub fn addr(&self) -> Option<&SocketAddr> {
         self.addr.as_ref()
     }
+
+    /// Returns the control message.
+    pub fn control_message(&self) -> Option<&ControlMessage> {
+        self.control_message.as_ref()
+    }
+
+    /// Takes the control message.
+    pub fn into_control_message(self) -> Option<ControlMessage> {
+        self.control_message
+    }
 }
 
 /// Control message carried by MessageHeader.
 ///
-/// TODO: Implement the struct. The struct is empty now.
-#[derive(Debug)]
-pub struct ControlMessage;
+/// TODO: Support more control messages.
+pub enum ControlMessage {
+    /// The size of the segments that are coalesced into the received datagram (`UDP_GRO`).
+    UdpGroSegmentSize(u16),
+    /// The files passed over a UNIX socket (`SCM_RIGHTS`).
+    Rights(Vec<Arc<dyn FileLike>>),
+}
+
+impl Debug for ControlMessage {
+    fn fmt(&self, f: &mut core::fmt::Formatter<'_>) -> core::fmt::Result {
+        match self {
+            Self::UdpGroSegmentSize(size) => {
+                f.debug_tuple("UdpGroSegmentSize").field(size).finish()
+            }
+            Self::Rights(files) => f
+                .debug_struct("Rights")
+                .field("nr_files", &files.len())
+                .finish(),
+        }
+    }
+}
+
+/// The maximum number of the files passed in one message, which is the same as Linux.
+pub const SCM_MAX_FD: usize = 253;
+
+const SOL_SOCKET: i32 = 1;
+const SCM_RIGHTS: i32 = 1;
+
+impl ControlMessage {
+    /// Encodes the control message in the format of `struct cmsghdr`.
+    ///
+    /// The length of the returned bytes is aligned as if it is followed by another control
+    /// message, i.e., the length is `CMSG_SPACE` of the data.
+    ///
+    /// # Panics
+    ///
+    /// This method panics if the control message is [`Self::Rights`]. The files should be
+    /// installed in the file table of the receiver first, and the resulting file descriptors
+    /// are encoded with [`Self::rights_to_bytes`].
+    pub fn to_bytes(&self) -> Vec<u8> {
+        const SOL_UDP: i32 = 17;
+        const UDP_GRO: i32 = 104;
+
+        match self {
+            Self::UdpGroSegmentSize(size) => {
+                encode(SOL_UDP, UDP_GRO, &(*size as i32).to_ne_bytes())
+            }
+            Self::Rights(_) => panic!("the passed files cannot be encoded before installed"),
+        }
+    }
+
+    /// Encodes the `SCM_RIGHTS` control message that carries `fds`.
+    pub fn rights_to_bytes(fds: &[FileDesc]) -> Vec<u8> {
+        encode(SOL_SOCKET, SCM_RIGHTS, fds.as_bytes())
+    }
+
+    /// Returns the maximum number of the file descriptors in an `SCM_RIGHTS` control
+    /// message of at most `len` bytes.
+    pub fn max_rights_in(len: usize) -> usize {
+        len.saturating_sub(size_of::<CControlMessageHeader>()) / size_of::<FileDesc>()
+    }
+
+    /// Decodes the control messages in `bytes`, which are in the format of `struct cmsghdr`.
+    ///
+    /// The file descriptors of all the `SCM_RIGHTS` control messages are collected and returned.
+    /// Other control messages are ignored.
+    pub fn decode_rights(bytes: &[u8]) -> Result<Vec<FileDesc>> {
+        let header_len = size_of::<CControlMessageHeader>();
+
+        let mut fds = Vec::new();
+        let mut offset = 0;
+        while offset + header_len <= bytes.len() {
+            let header = CControlMessageHeader::from_bytes(&bytes[offset..offset + header_len]);
+            if header.len < header_len || header.len > bytes.len() - offset {
+                return_errno_with_message!(Errno::EINVAL, "the control message is invalid");
+            }
+
+            let data = &bytes[offset + header_len..offset + header.len];
+            if header.level == SOL_SOCKET && header.type_ == SCM_RIGHTS {
+                if fds.len() + data.len() / size_of::<FileDesc>() > SCM_MAX_FD {
+                    return_errno_with_message!(Errno::EINVAL, "too many files are passed");
+                }
+                fds.extend(
+                    data.chunks_exact(size_of::<FileDesc>())
+                        .map(FileDesc::from_bytes),
+                );
+            } else {
+                warn!(
+                    "unsupported control message: level = {}, type = {}",
+                    header.level, header.type_
+                );
+            }
+
+            offset += header.len.align_up(size_of::<usize>());
+        }
+
+        Ok(fds)
+    }
+}
+
+fn encode(level: i32, type_: i32, data: &[u8]) -> Vec<u8> {
+    let header = CControlMessageHeader {
+        len: size_of::<CControlMessageHeader>() + data.len(),
+        level,
+        type_,
+    };
+    let mut bytes = header.as_bytes().to_vec();
+    bytes.extend_from_slice(data);
+    bytes.resize(bytes.len().align_up(size_of::<usize>()), 0);
+    bytes
+}
+
+/// `struct cmsghdr` in Linux.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Pod)]
+struct CControlMessageHeader {
+    /// The length of the control message, including the header.
+    len: usize,
+    /// The originating protocol.
+    level: i32,
+    /// The protocol-specific type.
+    type_: i32,
+}
@@ -7,4 +7,4 @@ pub mod send_recv_flags;
 pub mod shutdown_cmd;
 pub mod socket_addr;
 
-pub use message_header::MessageHeader;
+pub use message_header::{ControlMessage, MessageHeader};
@@ -9,9 +9,11 @@ use aster_bigtcp::socket::{
 use crate::{
     match_sock_option_mut, match_sock_option_ref,
     net::socket::options::{
-        KeepAlive, Linger, RecvBuf, ReuseAddr, ReusePort, SendBuf, SocketOption,
+        BusyPoll, IncomingCpu, KeepAlive, Linger, PreferBusyPoll, RecvBuf, ReuseAddr, ReusePort,
+        SendBuf, SocketOption,
     },
     prelude::*,
+    process::{credentials::capabilities::CapSet, posix_thread::AsPosixThread},
 };
 
 #[derive(Debug, Clone, CopyGetters, Setters)]
@@ -24,6 +26,12 @@ pub struct SocketOptionSet {
     recv_buf: u32,
     linger: LingerOption,
     keep_alive: bool,
+    /// The CPU on which the socket prefers to process packets, or -1 if there is none.
+    incoming_cpu: i32,
+    /// The microseconds to busy-poll the interface before blocking on receiving.
+    busy_poll: u32,
+    /// Whether the busy-poller prefers to process the received packets itself.
+    prefer_busy_poll: bool,
 }
 
 impl SocketOptionSet {
@@ -36,6 +44,9 @@ impl SocketOptionSet {
             recv_buf: TCP_RECV_BUF_LEN as u32,
             linger: LingerOption::default(),
             keep_alive: false,
+            incoming_cpu: -1,
+            busy_poll: 0,
+            prefer_busy_poll: false,
         }
     }
 
@@ -48,6 +59,9 @@ impl SocketOptionSet {
             recv_buf: UDP_RECV_PAYLOAD_LEN as u32,
             linger: LingerOption::default(),
             keep_alive: false,
+            incoming_cpu: -1,
+            busy_poll: 0,
+            prefer_busy_poll: false,
         }
     }
 
@@ -82,6 +96,18 @@ impl SocketOptionSet {
                 let keep_alive = self.keep_alive();
                 socket_keepalive.set(keep_alive);
             },
+            socket_incoming_cpu: IncomingCpu => {
+                let incoming_cpu = self.incoming_cpu();
+                socket_incoming_cpu.set(incoming_cpu);
+            },
+            socket_busy_poll: BusyPoll => {
+                let busy_poll = self.busy_poll();
+                socket_busy_poll.set(busy_poll);
+            },
+            socket_prefer_busy_poll: PreferBusyPoll => {
+                let prefer_busy_poll = self.prefer_busy_poll();
+                socket_prefer_busy_poll.set(prefer_busy_poll);
+            },
             _ => return_errno_with_message!(Errno::ENOPROTOOPT, "the socket option to get is unknown")
         });
         Ok(())
@@ -127,6 +153,33 @@ impl SocketOptionSet {
                 self.set_keep_alive(*keep_alive);
                 return Ok(socket.set_keep_alive(*keep_alive));
             },
+            socket_incoming_cpu: IncomingCpu => {
+                let incoming_cpu = socket_incoming_cpu.get().unwrap();
+                // Like Linux, a negative value clears the preference.
+                self.set_incoming_cpu((*incoming_cpu).max(-1));
+            },
+            socket_busy_poll: BusyPoll => {
+                let busy_poll = socket_busy_poll.get().unwrap();
+                // The value is an `int` in Linux, which cannot be negative.
+                if *busy_poll > i32::MAX as u32 {
+                    return_errno_with_message!(Errno::EINVAL, "the busy poll time is negative");
+                }
+                self.set_busy_poll(*busy_poll);
+            },
+            socket_prefer_busy_poll: PreferBusyPoll => {
+                let prefer_busy_poll = socket_prefer_busy_poll.get().unwrap();
+                // Like Linux, leaving the packets of the interface to the socket is privileged.
+                if *prefer_busy_poll {
+                    let credentials = current_thread!().as_posix_thread().unwrap().credentials();
+                    if !credentials.effective_capset().contains(CapSet::NET_ADMIN) {
+                        return_errno_with_message!(
+                            Errno::EPERM,
+                            "preferring busy polling requires CAP_NET_ADMIN"
+                        );
+                    }
+                }
+                self.set_prefer_busy_poll(*prefer_busy_poll);
+            },
             _ => return_errno_with_message!(Errno::ENOPROTOOPT, "the socket option to be set is unknown")
         });
 
@@ -32,6 +32,7 @@ bitflags! {
         // const MSG_EOF         MSG_FIN
         const MSG_NO_SHARED_FRAGS = 0x80000; /* sendpage() internal : page frags are not shared */
         const MSG_SENDPAGE_DECRYPTED	= 0x100000; /* sendpage() internal : page may carry plain text and require encryption */
+        const MSG_CMSG_CLOEXEC = 0x40000000;	/* Set close_on_exec for SCM_RIGHTS fds */
     }
 }
 
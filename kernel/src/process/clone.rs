@@ -267,6 +267,7 @@ fn clone_child_task(
         let mut thread_builder = PosixThreadBuilder::new(child_tid, child_user_ctx, credentials)
             .process(posix_thread.weak_process())
             .sig_mask(sig_mask)
+            .mem_policy(*posix_thread.mem_policy().lock())
             .file_table(child_file_table)
             .fs(child_fs);
 
@@ -352,6 +353,7 @@ fn clone_child_process(
             PosixThreadBuilder::new(child_tid, child_user_ctx, credentials)
                 .thread_name(Some(child_thread_name))
                 .sig_mask(child_sig_mask)
+                .mem_policy(*posix_thread.mem_policy().lock())
                 .file_table(child_file_table)
                 .fs(child_fs)
         };
@@ -490,6 +492,9 @@ fn clone_files(parent_file_table: &RwArc<FileTable>, clone_flags: CloneFlags) ->
     // Otherwise, the child will deep copy a new file table.
     // FIXME: the clone may not be deep copy.
     if clone_flags.contains(CloneFlags::CLONE_FILES) {
+        // The files must be published before the file table is shared, so that they can be
+        // looked up without locks (see `get_file_fast`).
+        parent_file_table.write().publish_files();
         parent_file_table.clone()
     } else {
         RwArc::new(parent_file_table.read().clone())
@@ -6,7 +6,7 @@ use ostd::{
     task::Task,
 };
 
-use super::{thread_table, PosixThread, ThreadLocal};
+use super::{futex::PiFutexState, thread_table, PosixThread, ThreadLocal};
 use crate::{
     fs::{file_table::FileTable, thread_info::ThreadFsInfo},
     prelude::*,
@@ -18,6 +18,7 @@ use crate::{
     sched::{Nice, SchedPolicy},
     thread::{task, Thread, Tid},
     time::{clocks::ProfClock, TimerManager},
+    vm::mempolicy::MemPolicy,
 };
 
 /// The builder to build a posix thread
@@ -37,6 +38,7 @@ pub struct PosixThreadBuilder {
     sig_mask: AtomicSigMask,
     sig_queues: SigQueues,
     sched_policy: SchedPolicy,
+    mem_policy: MemPolicy,
 }
 
 impl PosixThreadBuilder {
@@ -54,6 +56,7 @@ impl PosixThreadBuilder {
             sig_mask: AtomicSigMask::new_empty(),
             sig_queues: SigQueues::new(),
             sched_policy: SchedPolicy::Fair(Nice::default()),
+            mem_policy: MemPolicy::Default,
         }
     }
 
@@ -92,6 +95,11 @@ impl PosixThreadBuilder {
         self
     }
 
+    pub fn mem_policy(mut self, mem_policy: MemPolicy) -> Self {
+        self.mem_policy = mem_policy;
+        self
+    }
+
     pub fn build(self) -> Arc<Task> {
         let Self {
             tid,
@@ -106,6 +114,7 @@ impl PosixThreadBuilder {
             sig_mask,
             sig_queues,
             sched_policy,
+            mem_policy,
         } = self;
 
         let file_table = file_table.unwrap_or_else(|| RwArc::new(FileTable::new_with_stdio()));
@@ -139,6 +148,8 @@ impl PosixThreadBuilder {
                     prof_clock,
                     virtual_timer_manager,
                     prof_timer_manager,
+                    pi_futex_state: PiFutexState::default(),
+                    mem_policy: SpinLock::new(mem_policy),
                 }
             };
 
@@ -0,0 +1,643 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use core::sync::atomic::{fence, AtomicUsize, Ordering};
+
+use ostd::{
+    cpu::num_cpus,
+    sync::{Waiter, Waker},
+};
+use spin::Once;
+
+use self::pi::PiWaiter;
+pub use self::pi::{
+    futex_cmp_requeue_pi, futex_lock_pi, futex_trylock_pi, futex_unlock_pi, futex_wait_requeue_pi,
+    PiFutexState,
+};
+use crate::{prelude::*, process::Pid, time::wait::ManagedTimeout};
+
+mod pi;
+
+type FutexBitSet = u32;
+
+const FUTEX_OP_MASK: u32 = 0x0000_000F;
+const FUTEX_FLAGS_MASK: u32 = 0xFFFF_FFF0;
+const FUTEX_BITSET_MATCH_ANY: FutexBitSet = 0xFFFF_FFFF;
+
+/// The bit of a PI or robust futex word that indicates there are waiters in the kernel.
+pub const FUTEX_WAITERS: u32 = 0x8000_0000;
+/// The bit of a PI or robust futex word that indicates the owner died without unlocking.
+pub const FUTEX_OWNER_DIED: u32 = 0x4000_0000;
+/// The bits of a PI or robust futex word that hold the TID of the owner.
+pub const FUTEX_TID_MASK: u32 = 0x3FFF_FFFF;
+
+/// do futex wait
+pub fn futex_wait(
+    futex_addr: u64,
+    futex_val: i32,
+    timeout: Option<ManagedTimeout>,
+    ctx: &Context,
+    pid: Option<Pid>,
+) -> Result<()> {
+    futex_wait_bitset(
+        futex_addr as _,
+        futex_val,
+        timeout,
+        FUTEX_BITSET_MATCH_ANY,
+        ctx,
+        pid,
+    )
+}
+
+/// Does futex wait bitset
+pub fn futex_wait_bitset(
+    futex_addr: Vaddr,
+    futex_val: i32,
+    timeout: Option<ManagedTimeout>,
+    bitset: FutexBitSet,
+    ctx: &Context,
+    pid: Option<Pid>,
+) -> Result<()> {
+    debug!(
+        "futex_wait_bitset addr: {:#x}, val: {}, bitset: {:#x}",
+        futex_addr, futex_val, bitset
+    );
+
+    if bitset == 0 {
+        return_errno_with_message!(Errno::EINVAL, "at least one bit should be set");
+    }
+
+    let futex_key = FutexKey::new(futex_addr, bitset, pid);
+    let (futex_item, waiter) = FutexItem::create(futex_key, None);
+    let waker = waiter.waker();
+
+    let (_, futex_bucket) = get_futex_bucket(futex_key);
+    futex_bucket.enqueue_if_val_matches(futex_item, futex_val, ctx)?;
+
+    let result = waiter.pause_timeout(&timeout.into());
+
+    // If the wait is interrupted by a signal or times out, the futex item is
+    // still enqueued. Dequeue it so that it does not persist in memory.
+    //
+    // Note that if the item has been requeued to another futex, it is left
+    // there until that futex is woken up, when it is dropped without waking
+    // anyone.
+    if result.is_err() {
+        futex_bucket.remove_item(futex_key, &waker);
+    }
+
+    match result {
+        // FIXME: If the futex is woken up and a signal comes at the same time, we should succeed
+        // instead of failing with `EINTR`. The code below is of course wrong, but was needed to
+        // make the gVisor tests happy. See <https://github.com/asterinas/asterinas/pull/1577>.
+        Err(err) if err.error() == Errno::EINTR => Ok(()),
+        res => res,
+    }
+}
+
+/// The maximum number of futexes that can be waited on by [`futex_waitv`].
+pub const FUTEX_WAITV_MAX: usize = 128;
+
+/// Does futex wait on multiple futexes.
+///
+/// Each of `futexes` is a tuple of the futex address, the expected value,
+/// and whether the futex is process private or shared. The thread sleeps
+/// until any of the futexes is woken up, and the index of that futex is
+/// returned.
+pub fn futex_waitv(
+    futexes: &[(Vaddr, i32, Option<Pid>)],
+    timeout: Option<ManagedTimeout>,
+    ctx: &Context,
+) -> Result<usize> {
+    debug!("futex_waitv futexes: {:x?}", futexes);
+
+    if futexes.is_empty() || futexes.len() > FUTEX_WAITV_MAX {
+        return_errno_with_message!(Errno::EINVAL, "the number of futexes is invalid");
+    }
+
+    let (waiter, waker) = Waiter::new_pair();
+    let woken_index = Arc::new(AtomicUsize::new(NOT_WOKEN));
+
+    let keys = futexes
+        .iter()
+        .map(|&(addr, _, pid)| FutexKey::new(addr, FUTEX_BITSET_MATCH_ANY, pid))
+        .collect::<Vec<_>>();
+    let dequeue_all = |keys: &[FutexKey]| {
+        for &key in keys {
+            get_futex_bucket(key).1.remove_item(key, &waker);
+        }
+    };
+
+    for (index, (&key, &(_, futex_val, _))) in keys.iter().zip(futexes).enumerate() {
+        let futex_item = FutexItem {
+            key,
+            waker: waker.clone(),
+            waitv: Some((woken_index.clone(), index)),
+            pi: None,
+        };
+        if let Err(err) = get_futex_bucket(key)
+            .1
+            .enqueue_if_val_matches(futex_item, futex_val, ctx)
+        {
+            dequeue_all(&keys[..index]);
+            return Err(err);
+        }
+    }
+
+    let result = waiter.pause_timeout(&timeout.into());
+    dequeue_all(&keys);
+
+    match woken_index.load(Ordering::Relaxed) {
+        NOT_WOKEN => {
+            result?;
+            return_errno_with_message!(Errno::EAGAIN, "no futex is woken up");
+        }
+        index => Ok(index),
+    }
+}
+
+/// Does futex wake
+pub fn futex_wake(futex_addr: Vaddr, max_count: usize, pid: Option<Pid>) -> Result<usize> {
+    futex_wake_bitset(futex_addr, max_count, FUTEX_BITSET_MATCH_ANY, pid)
+}
+
+/// Does futex wake with bitset
+pub fn futex_wake_bitset(
+    futex_addr: Vaddr,
+    max_count: usize,
+    bitset: FutexBitSet,
+    pid: Option<Pid>,
+) -> Result<usize> {
+    debug!(
+        "futex_wake_bitset addr: {:#x}, max_count: {}, bitset: {:#x}",
+        futex_addr, max_count, bitset
+    );
+
+    if bitset == 0 {
+        return_errno_with_message!(Errno::EINVAL, "at least one bit should be set");
+    }
+
+    let futex_key = FutexKey::new(futex_addr, bitset, pid);
+    let (_, futex_bucket) = get_futex_bucket(futex_key);
+
+    // Fast path: There is no one to wake up.
+    if !futex_bucket.has_waiters() {
+        return Ok(0);
+    }
+
+    let mut queues = futex_bucket.queues.lock();
+    let (nwakes, nremoved) = queues.remove_and_wake_items(futex_key, max_count);
+    drop(queues);
+    futex_bucket.sub_waiters(nremoved);
+
+    Ok(nwakes)
+}
+
+/// Does futex requeue
+pub fn futex_requeue(
+    futex_addr: Vaddr,
+    max_nwakes: usize,
+    max_nrequeues: usize,
+    futex_new_addr: Vaddr,
+    pid: Option<Pid>,
+) -> Result<usize> {
+    if futex_new_addr == futex_addr {
+        return futex_wake(futex_addr, max_nwakes, pid);
+    }
+
+    let futex_key = FutexKey::new(futex_addr, FUTEX_BITSET_MATCH_ANY, pid);
+    let futex_new_key = FutexKey::new(futex_new_addr, FUTEX_BITSET_MATCH_ANY, pid);
+    let (bucket_idx, futex_bucket) = get_futex_bucket(futex_key);
+    let (new_bucket_idx, futex_new_bucket) = get_futex_bucket(futex_new_key);
+
+    // Fast path: There is no one to wake up or requeue.
+    if !futex_bucket.has_waiters() {
+        return Ok(0);
+    }
+
+    if bucket_idx == new_bucket_idx {
+        let mut queues = futex_bucket.queues.lock();
+        let (nwakes, nremoved) = queues.remove_and_wake_items(futex_key, max_nwakes);
+        for mut item in queues.take_items(futex_key, max_nrequeues, |_| true) {
+            item.key = futex_new_key;
+            queues.add_item(item);
+        }
+        drop(queues);
+        futex_bucket.sub_waiters(nremoved);
+        return Ok(nwakes);
+    }
+
+    let (mut queues, mut new_queues) = if bucket_idx < new_bucket_idx {
+        let queues = futex_bucket.queues.lock();
+        let new_queues = futex_new_bucket.queues.lock();
+        (queues, new_queues)
+    } else {
+        // bucket_idx > new_bucket_idx
+        let new_queues = futex_new_bucket.queues.lock();
+        let queues = futex_bucket.queues.lock();
+        (queues, new_queues)
+    };
+
+    let (nwakes, nremoved) = queues.remove_and_wake_items(futex_key, max_nwakes);
+
+    let requeued = queues.take_items(futex_key, max_nrequeues, |_| true);
+    let nrequeued = requeued.len();
+    // Count the requeued waiters in the new bucket before moving them, so that
+    // wakers of the new futex never miss them.
+    futex_new_bucket.add_waiters(nrequeued);
+    for mut item in requeued {
+        item.key = futex_new_key;
+        new_queues.add_item(item);
+    }
+
+    drop(new_queues);
+    drop(queues);
+    futex_bucket.sub_waiters(nremoved + nrequeued);
+
+    Ok(nwakes)
+}
+
+static FUTEX_BUCKETS: Once<FutexBucketVec> = Once::new();
+
+/// Get the futex hash bucket count.
+///
+/// This number is calculated the same way as Linux's:
+/// <https://github.com/torvalds/linux/blob/master/kernel/futex/core.c>
+fn get_bucket_count() -> usize {
+    ((1 << 8) * num_cpus()).next_power_of_two()
+}
+
+fn get_futex_bucket(key: FutexKey) -> (usize, &'static FutexBucket) {
+    FUTEX_BUCKETS.get().unwrap().get_bucket(key)
+}
+
+/// Initialize the futex system.
+pub fn init() {
+    FUTEX_BUCKETS.call_once(|| FutexBucketVec::new(get_bucket_count()));
+}
+
+struct FutexBucketVec {
+    vec: Vec<FutexBucket>,
+}
+
+impl FutexBucketVec {
+    pub fn new(size: usize) -> FutexBucketVec {
+        debug_assert!(size.is_power_of_two());
+        let mut buckets = FutexBucketVec {
+            vec: Vec::with_capacity(size),
+        };
+        for _ in 0..size {
+            buckets.vec.push(FutexBucket::new());
+        }
+        buckets
+    }
+
+    pub fn get_bucket(&self, key: FutexKey) -> (usize, &FutexBucket) {
+        let index = (self.size() - 1) & key.hash();
+        (index, &self.vec[index])
+    }
+
+    fn size(&self) -> usize {
+        self.vec.len()
+    }
+}
+
+/// A futex hash bucket.
+struct FutexBucket {
+    /// The number of waiters that are queued, or about to be queued, in the bucket.
+    ///
+    /// It allows wakers to skip locking the bucket if there are no waiters.
+    nr_waiters: AtomicUsize,
+    queues: SpinLock<FutexQueues>,
+}
+
+impl FutexBucket {
+    fn new() -> Self {
+        Self {
+            nr_waiters: AtomicUsize::new(0),
+            queues: SpinLock::new(FutexQueues::new()),
+        }
+    }
+
+    /// Enqueues the futex item if the futex value matches `futex_val`.
+    fn enqueue_if_val_matches(&self, item: FutexItem, futex_val: i32, ctx: &Context) -> Result<()> {
+        // Count the waiter before loading the futex value. The fence pairs
+        // with the one in `has_waiters`: either the waker sees the waiter, or
+        // the waiter sees the new value.
+        self.add_waiters(1);
+        fence(Ordering::SeqCst);
+
+        // lock futex bucket ref here to avoid data race
+        let mut queues = self.queues.lock();
+
+        if !item.key.load_val(ctx).is_ok_and(|val| val == futex_val) {
+            drop(queues);
+            self.sub_waiters(1);
+            return_errno_with_message!(
+                Errno::EAGAIN,
+                "futex value does not match or load_val failed"
+            );
+        }
+
+        queues.add_item(item);
+        Ok(())
+    }
+
+    /// Removes the futex item associated with `waker`, if it is still enqueued.
+    ///
+    /// Returns whether the item is found and removed.
+    fn remove_item(&self, key: FutexKey, waker: &Arc<Waker>) -> bool {
+        let mut queues = self.queues.lock();
+        let removed = queues.remove_item(key, waker);
+        drop(queues);
+
+        if removed {
+            self.sub_waiters(1);
+        }
+        removed
+    }
+
+    fn has_waiters(&self) -> bool {
+        // The fence orders the waker's store to the futex word before the
+        // load of the counter. It pairs with the one in
+        // `enqueue_if_val_matches`.
+        fence(Ordering::SeqCst);
+        self.nr_waiters.load(Ordering::Relaxed) != 0
+    }
+
+    fn add_waiters(&self, nr: usize) {
+        self.nr_waiters.fetch_add(nr, Ordering::SeqCst);
+    }
+
+    fn sub_waiters(&self, nr: usize) {
+        if nr > 0 {
+            self.nr_waiters.fetch_sub(nr, Ordering::Relaxed);
+        }
+    }
+}
+
+/// The futex queues in a hash bucket.
+///
+/// The waiters of each futex word are kept in a separate FIFO queue, so that
+/// waking up a futex does not need to scan the waiters of other futexes that
+/// happen to collide in the same bucket.
+struct FutexQueues {
+    queues: BTreeMap<FutexQueueId, VecDeque<FutexItem>>,
+    /// The states of the PI futexes that have waiters.
+    pi_states: BTreeMap<FutexQueueId, pi::PiState>,
+}
+
+impl FutexQueues {
+    pub fn new() -> FutexQueues {
+        FutexQueues {
+            queues: BTreeMap::new(),
+            pi_states: BTreeMap::new(),
+        }
+    }
+
+    pub fn add_item(&mut self, item: FutexItem) {
+        self.queues
+            .entry(item.key.queue_id())
+            .or_default()
+            .push_back(item);
+    }
+
+    /// Removes and wakes up at most `max_count` items that match `key`.
+    ///
+    /// Returns the number of woken items as well as the number of removed
+    /// items. The latter can be larger since items whose waiters are no
+    /// longer waiting are removed without being counted as woken.
+    pub fn remove_and_wake_items(&mut self, key: FutexKey, max_count: usize) -> (usize, usize) {
+        let queue_id = key.queue_id();
+        let Some(queue) = self.queues.get_mut(&queue_id) else {
+            return (0, 0);
+        };
+
+        let mut count = 0;
+        let mut nremoved = 0;
+
+        queue.retain(|item| {
+            if item.key.match_up(&key) && count < max_count {
+                if item.wake() {
+                    count += 1;
+                }
+                nremoved += 1;
+                false
+            } else {
+                true
+            }
+        });
+
+        if queue.is_empty() {
+            self.queues.remove(&queue_id);
+        }
+
+        (count, nremoved)
+    }
+
+    /// Takes at most `max_count` items that match `key` and satisfy `cond`
+    /// out of the queues.
+    pub fn take_items(
+        &mut self,
+        key: FutexKey,
+        max_count: usize,
+        cond: impl Fn(&FutexItem) -> bool,
+    ) -> Vec<FutexItem> {
+        let queue_id = key.queue_id();
+        let Some(queue) = self.queues.get_mut(&queue_id) else {
+            return Vec::new();
+        };
+
+        let mut taken = Vec::new();
+        let mut kept = VecDeque::with_capacity(queue.len());
+        for item in core::mem::take(queue) {
+            if item.key.match_up(&key) && taken.len() < max_count && cond(&item) {
+                taken.push(item);
+            } else {
+                kept.push_back(item);
+            }
+        }
+        *queue = kept;
+
+        if queue.is_empty() {
+            self.queues.remove(&queue_id);
+        }
+
+        taken
+    }
+
+    /// Removes the item associated with `waker` from the queue of `key`.
+    ///
+    /// Returns whether the item is found and removed.
+    pub fn remove_item(&mut self, key: FutexKey, waker: &Arc<Waker>) -> bool {
+        let queue_id = key.queue_id();
+        let Some(queue) = self.queues.get_mut(&queue_id) else {
+            return false;
+        };
+
+        let Some(pos) = queue
+            .iter()
+            .position(|item| Arc::ptr_eq(&item.waker, waker))
+        else {
+            return false;
+        };
+        queue.remove(pos);
+
+        if queue.is_empty() {
+            self.queues.remove(&queue_id);
+        }
+
+        true
+    }
+}
+
+/// The value of the woken index of a [`futex_waitv`] call if no futex is woken.
+const NOT_WOKEN: usize = usize::MAX;
+
+struct FutexItem {
+    key: FutexKey,
+    waker: Arc<Waker>,
+    /// The index of the futex in a [`futex_waitv`] call and the place to
+    /// report the index when the futex is woken up.
+    waitv: Option<(Arc<AtomicUsize>, usize)>,
+    /// The waiting thread if it waits for a PI futex.
+    pi: Option<PiWaiter>,
+}
+
+impl FutexItem {
+    pub fn create(key: FutexKey, waitv: Option<(Arc<AtomicUsize>, usize)>) -> (Self, Waiter) {
+        let (waiter, waker) = Waiter::new_pair();
+        let futex_item = FutexItem {
+            key,
+            waker,
+            waitv,
+            pi: None,
+        };
+
+        (futex_item, waiter)
+    }
+
+    #[must_use]
+    pub fn wake(&self) -> bool {
+        if let Some((woken_index, index)) = &self.waitv {
+            // Only the first woken futex is reported. The store is ordered
+            // before the wakeup by the release semantics of `wake_up`.
+            let _ = woken_index.compare_exchange(
+                NOT_WOKEN,
+                *index,
+                Ordering::Relaxed,
+                Ordering::Relaxed,
+            );
+        }
+        self.waker.wake_up()
+    }
+}
+
+/// The identifier of a futex word, used to key the futex queues.
+type FutexQueueId = (Option<Pid>, Vaddr);
+
+// The addr of a futex, it should be used to mark different futex word
+#[derive(Debug, Clone, Copy)]
+struct FutexKey {
+    addr: Vaddr,
+    bitset: FutexBitSet,
+    /// Specify whether this `FutexKey` is process private or shared. If `pid` is
+    /// None, then this `FutexKey` is shared.
+    pid: Option<Pid>,
+}
+
+impl FutexKey {
+    pub fn new(addr: Vaddr, bitset: FutexBitSet, pid: Option<Pid>) -> Self {
+        Self { addr, bitset, pid }
+    }
+
+    pub fn load_val(&self, ctx: &Context) -> Result<i32> {
+        // FIXME: how to implement a atomic load?
+        warn!("implement an atomic load");
+        ctx.user_space().read_val(self.addr)
+    }
+
+    pub fn queue_id(&self) -> FutexQueueId {
+        (self.pid, self.addr)
+    }
+
+    /// Hashes the futex word, regardless of the bitset.
+    pub fn hash(&self) -> usize {
+        // The addr is the multiples of 4, so we ignore the last 2 bits.
+        let word = (self.addr as u64 >> 2) ^ ((self.pid.unwrap_or(0) as u64) << 40);
+        // Fibonacci hashing, which spreads adjacent futex words across buckets.
+        (word.wrapping_mul(0x9E37_79B9_7F4A_7C15) >> 32) as usize
+    }
+
+    pub fn match_up(&self, another: &Self) -> bool {
+        self.addr == another.addr && (self.bitset & another.bitset) != 0 && self.pid == another.pid
+    }
+}
+
+// The implementation is from occlum
+
+#[derive(PartialEq, Debug, Clone, Copy)]
+#[expect(non_camel_case_types)]
+pub enum FutexOp {
+    FUTEX_WAIT = 0,
+    FUTEX_WAKE = 1,
+    FUTEX_FD = 2,
+    FUTEX_REQUEUE = 3,
+    FUTEX_CMP_REQUEUE = 4,
+    FUTEX_WAKE_OP = 5,
+    FUTEX_LOCK_PI = 6,
+    FUTEX_UNLOCK_PI = 7,
+    FUTEX_TRYLOCK_PI = 8,
+    FUTEX_WAIT_BITSET = 9,
+    FUTEX_WAKE_BITSET = 10,
+    FUTEX_WAIT_REQUEUE_PI = 11,
+    FUTEX_CMP_REQUEUE_PI = 12,
+    FUTEX_LOCK_PI2 = 13,
+}
+
+impl FutexOp {
+    pub fn from_u32(bits: u32) -> Result<FutexOp> {
+        match bits {
+            0 => Ok(FutexOp::FUTEX_WAIT),
+            1 => Ok(FutexOp::FUTEX_WAKE),
+            2 => Ok(FutexOp::FUTEX_FD),
+            3 => Ok(FutexOp::FUTEX_REQUEUE),
+            4 => Ok(FutexOp::FUTEX_CMP_REQUEUE),
+            5 => Ok(FutexOp::FUTEX_WAKE_OP),
+            6 => Ok(FutexOp::FUTEX_LOCK_PI),
+            7 => Ok(FutexOp::FUTEX_UNLOCK_PI),
+            8 => Ok(FutexOp::FUTEX_TRYLOCK_PI),
+            9 => Ok(FutexOp::FUTEX_WAIT_BITSET),
+            10 => Ok(FutexOp::FUTEX_WAKE_BITSET),
+            11 => Ok(FutexOp::FUTEX_WAIT_REQUEUE_PI),
+            12 => Ok(FutexOp::FUTEX_CMP_REQUEUE_PI),
+            13 => Ok(FutexOp::FUTEX_LOCK_PI2),
+            _ => return_errno_with_message!(Errno::EINVAL, "Unknown futex op"),
+        }
+    }
+}
+
+bitflags! {
+    pub struct FutexFlags : u32 {
+        const FUTEX_PRIVATE         = 128;
+        const FUTEX_CLOCK_REALTIME  = 256;
+    }
+}
+
+impl FutexFlags {
+    pub fn from_u32(bits: u32) -> Result<FutexFlags> {
+        FutexFlags::from_bits(bits)
+            .ok_or_else(|| Error::with_message(Errno::EINVAL, "unknown futex flags"))
+    }
+}
+
+pub fn futex_op_and_flags_from_u32(bits: u32) -> Result<(FutexOp, FutexFlags)> {
+    let op = {
+        let op_bits = bits & FUTEX_OP_MASK;
+        FutexOp::from_u32(op_bits)?
+    };
+    let flags = {
+        let flags_bits = bits & FUTEX_FLAGS_MASK;
+        FutexFlags::from_u32(flags_bits)?
+    };
+    Ok((op, flags))
+}
@@ -0,0 +1,689 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! Priority-inheritance (PI) futexes.
+//!
+//! The word of a PI futex holds the TID of its owner, along with the
+//! [`FUTEX_WAITERS`] bit if there are waiters in the kernel and the
+//! [`FUTEX_OWNER_DIED`] bit if a previous owner died without unlocking it.
+//! User space locks and unlocks an uncontended PI futex with atomic
+//! instructions, so the kernel is only involved when there is contention.
+//! The kernel also updates the word with atomic compare-and-exchange, so that
+//! no concurrent update from user space is lost.
+//!
+//! While a PI futex has waiters, its owner is tracked by a [`PiState`] in the
+//! futex bucket. The owner inherits the most urgent real-time policy among the
+//! waiters (see [`SchedAttr::set_pi_boost`]), and the boost is propagated
+//! along the chain of owners that are in turn blocked on other PI futexes. On
+//! unlocking, the futex is handed over to the most urgent waiter directly, so
+//! that a lower-priority thread cannot steal it in between.
+//!
+//! [`SchedAttr::set_pi_boost`]: crate::sched::SchedAttr::set_pi_boost
+
+use core::sync::atomic::{AtomicU8, Ordering};
+
+use ostd::{
+    sync::{Waiter, Waker},
+    task::scheduler::requeue_target,
+};
+
+use super::{
+    get_futex_bucket, FutexItem, FutexKey, FutexQueueId, FutexQueues, FUTEX_BITSET_MATCH_ANY,
+    FUTEX_OWNER_DIED, FUTEX_TID_MASK, FUTEX_WAITERS,
+};
+use crate::{
+    prelude::*,
+    process::{
+        posix_thread::{thread_table, AsPosixThread},
+        Pid,
+    },
+    sched::SchedPolicy,
+    thread::{Thread, Tid},
+    time::wait::ManagedTimeout,
+};
+
+/// The maximum length of the owner chains that a boost is propagated along.
+///
+/// This also bounds the work if user space creates a deadlock cycle.
+const MAX_PI_CHAIN_DEPTH: usize = 16;
+
+/// The per-thread state of PI futexes.
+#[derive(Default)]
+pub struct PiFutexState {
+    /// The most urgent policy among the waiters of each PI futex owned by the thread.
+    boosts: SpinLock<BTreeMap<FutexQueueId, SchedPolicy>>,
+    /// The PI futex that the thread is blocked on.
+    blocked_on: SpinLock<Option<FutexKey>>,
+}
+
+/// The kernel state of a PI futex that has waiters.
+pub(super) struct PiState {
+    owner: Arc<Thread>,
+}
+
+/// A thread that waits for a PI futex.
+pub(super) struct PiWaiter {
+    thread: Arc<Thread>,
+    tid: Tid,
+    status: Arc<AtomicU8>,
+}
+
+/// The waiter is waiting, either for a PI futex or for a non-PI futex to be
+/// requeued to a PI futex.
+const PI_WAITING: u8 = 0;
+/// The waiter has been requeued to a PI futex.
+const PI_REQUEUED: u8 = 1;
+/// The PI futex has been handed over to the waiter.
+const PI_ACQUIRED: u8 = 2;
+
+impl PiWaiter {
+    fn set_status(&self, status: u8) {
+        self.status.store(status, Ordering::Relaxed);
+    }
+}
+
+/// Locks a PI futex.
+///
+/// The timeout is an absolute time.
+pub fn futex_lock_pi(
+    futex_addr: Vaddr,
+    timeout: Option<ManagedTimeout>,
+    ctx: &Context,
+    pid: Option<Pid>,
+) -> Result<()> {
+    debug!("futex_lock_pi addr: {:#x}", futex_addr);
+
+    let futex_key = FutexKey::new(futex_addr, FUTEX_BITSET_MATCH_ANY, pid);
+    let (_, futex_bucket) = get_futex_bucket(futex_key);
+
+    let thread = current_thread!();
+
+    loop {
+        let (futex_item, status, waiter) = create_pi_item(futex_key, &thread);
+        let waker = waiter.waker();
+
+        futex_bucket.add_waiters(1);
+        let mut queues = futex_bucket.queues.lock();
+
+        let owner = match try_acquire(futex_key, &thread, true, &mut queues, ctx) {
+            Ok(Some(owner_tid)) => queues.pi_owner(futex_key, owner_tid).map(Some),
+            result => result.map(|_| None),
+        };
+        let owner = match owner {
+            Ok(Some(owner)) => owner,
+            Ok(None) => {
+                drop(queues);
+                futex_bucket.sub_waiters(1);
+                return Ok(());
+            }
+            Err(err) => {
+                drop(queues);
+                futex_bucket.sub_waiters(1);
+                return Err(err);
+            }
+        };
+
+        queues.add_item(futex_item);
+        queues.pi_states.remove(&futex_key.queue_id());
+        let policy_changed = queues.add_pi_state(futex_key, owner.clone());
+        set_blocked_on(&thread, Some(futex_key));
+        drop(queues);
+
+        if policy_changed {
+            propagate_boost(owner);
+        }
+
+        let result = waiter.pause_timeout(&timeout.clone().into());
+
+        if status.load(Ordering::Relaxed) != PI_ACQUIRED {
+            remove_pi_waiter(futex_key, &waker);
+        }
+        set_blocked_on(&thread, None);
+        // The futex may be handed over before the waiter is removed.
+        if status.load(Ordering::Relaxed) == PI_ACQUIRED {
+            return Ok(());
+        }
+
+        // Otherwise, the waiter is woken up by a non-PI wakeup, e.g., when the
+        // owner dies and the robust futex is released. Retry in this case.
+        result?;
+    }
+}
+
+/// Tries to lock a PI futex without waiting.
+pub fn futex_trylock_pi(futex_addr: Vaddr, ctx: &Context, pid: Option<Pid>) -> Result<()> {
+    debug!("futex_trylock_pi addr: {:#x}", futex_addr);
+
+    let futex_key = FutexKey::new(futex_addr, FUTEX_BITSET_MATCH_ANY, pid);
+    let (_, futex_bucket) = get_futex_bucket(futex_key);
+
+    let mut queues = futex_bucket.queues.lock();
+    match try_acquire(futex_key, &current_thread!(), false, &mut queues, ctx)? {
+        None => Ok(()),
+        Some(_) => return_errno_with_message!(Errno::EAGAIN, "the futex is locked"),
+    }
+}
+
+/// Unlocks a PI futex, handing it over to the most urgent waiter if any.
+pub fn futex_unlock_pi(futex_addr: Vaddr, ctx: &Context, pid: Option<Pid>) -> Result<()> {
+    debug!("futex_unlock_pi addr: {:#x}", futex_addr);
+
+    let futex_key = FutexKey::new(futex_addr, FUTEX_BITSET_MATCH_ANY, pid);
+    let queue_id = futex_key.queue_id();
+    let (_, futex_bucket) = get_futex_bucket(futex_key);
+
+    let mut queues = futex_bucket.queues.lock();
+
+    let new_owner_tid = queues
+        .peek_top_pi_waiter(futex_key)
+        .map(|pi_waiter| pi_waiter.tid);
+    let has_more_waiters = queues.nr_pi_waiters(futex_key) > 1;
+    let new_val = match new_owner_tid {
+        Some(tid) if has_more_waiters => tid | FUTEX_WAITERS,
+        Some(tid) => tid,
+        None => 0,
+    };
+    update_word(futex_addr, ctx, |futex_val| {
+        if futex_val & FUTEX_TID_MASK != ctx.posix_thread.tid() {
+            return_errno_with_message!(
+                Errno::EPERM,
+                "the futex is not owned by the current thread"
+            );
+        }
+        Ok(new_val)
+    })?;
+
+    if new_owner_tid.is_none() {
+        queues.pi_states.remove(&queue_id);
+        drop(queues);
+        update_boost(ctx.thread, queue_id, None);
+        return Ok(());
+    }
+
+    let item = queues.take_top_pi_waiter(futex_key).unwrap();
+    let pi_waiter = item.pi.as_ref().unwrap();
+    pi_waiter.set_status(PI_ACQUIRED);
+    let _ = item.wake();
+
+    queues.pi_states.remove(&queue_id);
+    if has_more_waiters {
+        // The new owner is running rather than blocked, so there is no need
+        // to propagate its boost.
+        queues.add_pi_state(futex_key, pi_waiter.thread.clone());
+    }
+    drop(queues);
+    futex_bucket.sub_waiters(1);
+
+    update_boost(ctx.thread, queue_id, None);
+
+    Ok(())
+}
+
+/// Waits on a non-PI futex, expecting to be requeued to the PI futex at
+/// `pi_futex_addr` by [`futex_cmp_requeue_pi`].
+///
+/// On success, the PI futex is locked by the current thread. The timeout is
+/// an absolute time.
+pub fn futex_wait_requeue_pi(
+    futex_addr: Vaddr,
+    futex_val: i32,
+    timeout: Option<ManagedTimeout>,
+    pi_futex_addr: Vaddr,
+    ctx: &Context,
+    pid: Option<Pid>,
+) -> Result<()> {
+    debug!(
+        "futex_wait_requeue_pi addr: {:#x}, val: {}, pi addr: {:#x}",
+        futex_addr, futex_val, pi_futex_addr
+    );
+
+    if futex_addr == pi_futex_addr {
+        return_errno_with_message!(Errno::EINVAL, "the two futexes should be different");
+    }
+
+    let futex_key = FutexKey::new(futex_addr, FUTEX_BITSET_MATCH_ANY, pid);
+    let pi_futex_key = FutexKey::new(pi_futex_addr, FUTEX_BITSET_MATCH_ANY, pid);
+
+    let thread = current_thread!();
+    let (futex_item, status, waiter) = create_pi_item(futex_key, &thread);
+    let waker = waiter.waker();
+
+    let (_, futex_bucket) = get_futex_bucket(futex_key);
+    futex_bucket.enqueue_if_val_matches(futex_item, futex_val, ctx)?;
+
+    let result = waiter.pause_timeout(&timeout.clone().into());
+
+    if status.load(Ordering::Relaxed) != PI_ACQUIRED {
+        futex_bucket.remove_item(futex_key, &waker);
+        remove_pi_waiter(pi_futex_key, &waker);
+    }
+    // The waiter may be requeued before it is removed, so the blocked-on
+    // futex can only be reset after that.
+    set_blocked_on(&thread, None);
+
+    match status.load(Ordering::Relaxed) {
+        PI_ACQUIRED => Ok(()),
+        PI_REQUEUED => {
+            result?;
+            // Woken up by a non-PI wakeup after being requeued. Lock the PI
+            // futex as if the thread had been requeued and then woken up.
+            futex_lock_pi(pi_futex_addr, timeout, ctx, pid)
+        }
+        _ => {
+            result?;
+            return_errno_with_message!(Errno::EAGAIN, "the futex is woken up without requeuing");
+        }
+    }
+}
+
+/// Requeues the waiters of [`futex_wait_requeue_pi`] from a non-PI futex to
+/// the PI futex at `pi_futex_addr`.
+///
+/// If the PI futex is unlocked, it is locked on behalf of the first waiter,
+/// who is then woken up. The rest of the waiters, at most `max_nrequeues`,
+/// are requeued to the PI futex. Returns the number of the woken and
+/// requeued waiters.
+pub fn futex_cmp_requeue_pi(
+    futex_addr: Vaddr,
+    max_nwakes: usize,
+    max_nrequeues: usize,
+    pi_futex_addr: Vaddr,
+    futex_val: i32,
+    ctx: &Context,
+    pid: Option<Pid>,
+) -> Result<usize> {
+    debug!(
+        "futex_cmp_requeue_pi addr: {:#x}, max_nrequeues: {}, pi addr: {:#x}",
+        futex_addr, max_nrequeues, pi_futex_addr
+    );
+
+    // Ref: <https://elixir.bootlin.com/linux/v6.13/source/kernel/futex/requeue.c#L386>
+    if max_nwakes != 1 {
+        return_errno_with_message!(Errno::EINVAL, "only one waiter can be woken up");
+    }
+    if futex_addr == pi_futex_addr {
+        return_errno_with_message!(Errno::EINVAL, "the two futexes should be different");
+    }
+
+    let futex_key = FutexKey::new(futex_addr, FUTEX_BITSET_MATCH_ANY, pid);
+    let pi_futex_key = FutexKey::new(pi_futex_addr, FUTEX_BITSET_MATCH_ANY, pid);
+    let (bucket_idx, futex_bucket) = get_futex_bucket(futex_key);
+    let (pi_bucket_idx, pi_futex_bucket) = get_futex_bucket(pi_futex_key);
+
+    let (mut queues, mut pi_queues) = match bucket_idx.cmp(&pi_bucket_idx) {
+        core::cmp::Ordering::Less => {
+            let queues = futex_bucket.queues.lock();
+            (queues, Some(pi_futex_bucket.queues.lock()))
+        }
+        core::cmp::Ordering::Greater => {
+            let pi_queues = pi_futex_bucket.queues.lock();
+            (futex_bucket.queues.lock(), Some(pi_queues))
+        }
+        core::cmp::Ordering::Equal => (futex_bucket.queues.lock(), None),
+    };
+
+    let (nwakes, nrequeued, boosted_owner) = requeue_pi_locked(
+        futex_key,
+        pi_futex_key,
+        futex_val,
+        max_nrequeues,
+        &mut queues,
+        pi_queues.as_deref_mut(),
+        ctx,
+    )?;
+
+    drop(pi_queues);
+    drop(queues);
+    futex_bucket.sub_waiters(nwakes + nrequeued);
+
+    if let Some(owner) = boosted_owner {
+        propagate_boost(owner);
+    }
+
+    Ok(nwakes + nrequeued)
+}
+
+/// Does the work of [`futex_cmp_requeue_pi`] with the bucket locks held.
+///
+/// If the two futexes are in the same bucket, `pi_queues` is `None`. Returns
+/// the number of the woken and requeued waiters, as well as the owner of the
+/// PI futex if its effective policy changes.
+fn requeue_pi_locked(
+    futex_key: FutexKey,
+    pi_futex_key: FutexKey,
+    futex_val: i32,
+    max_nrequeues: usize,
+    queues: &mut FutexQueues,
+    mut pi_queues: Option<&mut FutexQueues>,
+    ctx: &Context,
+) -> Result<(usize, usize, Option<Arc<Thread>>)> {
+    if !futex_key.load_val(ctx).is_ok_and(|val| val == futex_val) {
+        return_errno_with_message!(
+            Errno::EAGAIN,
+            "futex value does not match or load_val failed"
+        );
+    }
+
+    let Some(first_tid) = queues.queues.get(&futex_key.queue_id()).and_then(|queue| {
+        queue
+            .iter()
+            .find(|item| item.pi.is_some() && item.key.match_up(&futex_key))
+            .and_then(|item| item.pi.as_ref())
+            .map(|pi_waiter| pi_waiter.tid)
+    }) else {
+        return Ok((0, 0, None));
+    };
+
+    // Update and validate the PI futex before dequeuing any waiters, so that
+    // no waiter is lost on failures.
+    let waiters_bit = if max_nrequeues > 0 && queues.nr_pi_waiters(futex_key) > 1 {
+        FUTEX_WAITERS
+    } else {
+        0
+    };
+    let pi_futex_val = update_word(pi_futex_key.addr, ctx, |futex_val| {
+        Ok(match futex_val & FUTEX_TID_MASK {
+            // Lock the PI futex on behalf of the first waiter.
+            0 => first_tid | (futex_val & FUTEX_OWNER_DIED) | waiters_bit,
+            _ if max_nrequeues == 0 => futex_val,
+            _ => futex_val | FUTEX_WAITERS,
+        })
+    })?;
+
+    let (owner, max_ntakes) = match pi_futex_val & FUTEX_TID_MASK {
+        0 => (None, max_nrequeues.saturating_add(1)),
+        _ if max_nrequeues == 0 => return Ok((0, 0, None)),
+        owner_tid => {
+            let dst = pi_queues.as_deref().unwrap_or(&*queues);
+            let owner = dst.pi_owner(pi_futex_key, owner_tid)?;
+            (Some(owner), max_nrequeues)
+        }
+    };
+
+    let mut items = queues
+        .take_items(futex_key, max_ntakes, |item| item.pi.is_some())
+        .into_iter();
+    let dst = match pi_queues.as_deref_mut() {
+        Some(pi_queues) => pi_queues,
+        None => queues,
+    };
+    let pi_queue_id = pi_futex_key.queue_id();
+
+    let (owner, nwakes) = match owner {
+        Some(owner) => (owner, 0),
+        None => {
+            let item = items.next().unwrap();
+            let pi_waiter = item.pi.as_ref().unwrap();
+            pi_waiter.set_status(PI_ACQUIRED);
+            let _ = item.wake();
+
+            if let Some(stale) = dst.pi_states.remove(&pi_queue_id) {
+                update_boost(&stale.owner, pi_queue_id, None);
+            }
+            (pi_waiter.thread.clone(), 1)
+        }
+    };
+
+    let requeued = items.collect::<Vec<_>>();
+    let nrequeued = requeued.len();
+    if nrequeued == 0 {
+        return Ok((nwakes, 0, None));
+    }
+
+    get_futex_bucket(pi_futex_key).1.add_waiters(nrequeued);
+    for mut item in requeued {
+        item.key = pi_futex_key;
+        let pi_waiter = item.pi.as_ref().unwrap();
+        pi_waiter.set_status(PI_REQUEUED);
+        set_blocked_on(&pi_waiter.thread, Some(pi_futex_key));
+        dst.add_item(item);
+    }
+
+    dst.pi_states.remove(&pi_queue_id);
+    let policy_changed = dst.add_pi_state(pi_futex_key, owner.clone());
+
+    Ok((nwakes, nrequeued, policy_changed.then_some(owner)))
+}
+
+impl FutexQueues {
+    /// Returns the number of the PI waiters that match `key`.
+    fn nr_pi_waiters(&self, key: FutexKey) -> usize {
+        self.queues.get(&key.queue_id()).map_or(0, |queue| {
+            queue
+                .iter()
+                .filter(|item| item.pi.is_some() && item.key.match_up(&key))
+                .count()
+        })
+    }
+
+    /// Returns the position of the most urgent PI waiter that matches `key`.
+    ///
+    /// Waiters with the same policy are served in FIFO order.
+    fn top_pi_waiter_pos(&self, key: FutexKey) -> Option<usize> {
+        let queue = self.queues.get(&key.queue_id())?;
+        queue
+            .iter()
+            .enumerate()
+            .filter_map(|(pos, item)| {
+                let pi_waiter = item.pi.as_ref().filter(|_| item.key.match_up(&key))?;
+                Some((pi_waiter.thread.sched_attr().effective_policy(), pos))
+            })
+            .min()
+            .map(|(_, pos)| pos)
+    }
+
+    fn peek_top_pi_waiter(&self, key: FutexKey) -> Option<&PiWaiter> {
+        let pos = self.top_pi_waiter_pos(key)?;
+        self.queues[&key.queue_id()][pos].pi.as_ref()
+    }
+
+    fn take_top_pi_waiter(&mut self, key: FutexKey) -> Option<FutexItem> {
+        let pos = self.top_pi_waiter_pos(key)?;
+        let queue_id = key.queue_id();
+        let queue = self.queues.get_mut(&queue_id).unwrap();
+        let item = queue.remove(pos);
+        if queue.is_empty() {
+            self.queues.remove(&queue_id);
+        }
+        item
+    }
+
+    /// Returns the owner of the PI futex, which is locked by `owner_tid`.
+    fn pi_owner(&self, key: FutexKey, owner_tid: Tid) -> Result<Arc<Thread>> {
+        let owner = match self.pi_states.get(&key.queue_id()) {
+            Some(pi_state) => pi_state.owner.clone(),
+            None => thread_table::get_thread(owner_tid).ok_or_else(|| {
+                Error::with_message(Errno::ESRCH, "the futex owner does not exist")
+            })?,
+        };
+
+        if owner.as_posix_thread().unwrap().tid() != owner_tid {
+            return_errno_with_message!(Errno::EINVAL, "the futex owner is inconsistent");
+        }
+        Ok(owner)
+    }
+
+    /// Records `owner` as the owner of the PI futex and boosts it according
+    /// to the waiters.
+    ///
+    /// Returns whether the effective policy of the owner changes.
+    fn add_pi_state(&mut self, key: FutexKey, owner: Arc<Thread>) -> bool {
+        let queue_id = key.queue_id();
+        let top_policy = self
+            .peek_top_pi_waiter(key)
+            .map(|pi_waiter| pi_waiter.thread.sched_attr().effective_policy());
+        let policy_changed = update_boost(&owner, queue_id, top_policy);
+        self.pi_states.insert(queue_id, PiState { owner });
+        policy_changed
+    }
+}
+
+fn create_pi_item(key: FutexKey, thread: &Arc<Thread>) -> (FutexItem, Arc<AtomicU8>, Waiter) {
+    let (mut futex_item, waiter) = FutexItem::create(key, None);
+    let status = Arc::new(AtomicU8::new(PI_WAITING));
+    futex_item.pi = Some(PiWaiter {
+        thread: thread.clone(),
+        tid: thread.as_posix_thread().unwrap().tid(),
+        status: status.clone(),
+    });
+
+    (futex_item, status, waiter)
+}
+
+/// Tries to lock the PI futex for `thread`.
+///
+/// Returns `None` if the futex is locked successfully, or the TID of the
+/// current owner otherwise. In the latter case, if `set_waiters_bit` is true,
+/// the [`FUTEX_WAITERS`] bit is set in the same atomic update that observes
+/// the owner, so that the owner has to unlock the futex through the kernel.
+fn try_acquire(
+    key: FutexKey,
+    thread: &Arc<Thread>,
+    set_waiters_bit: bool,
+    queues: &mut FutexQueues,
+    ctx: &Context,
+) -> Result<Option<Tid>> {
+    let tid = thread.as_posix_thread().unwrap().tid();
+    let has_waiters = queues.nr_pi_waiters(key) > 0;
+    let waiters_bit = if has_waiters { FUTEX_WAITERS } else { 0 };
+
+    let futex_val = update_word(key.addr, ctx, |futex_val| {
+        Ok(match futex_val & FUTEX_TID_MASK {
+            0 => tid | (futex_val & FUTEX_OWNER_DIED) | waiters_bit,
+            owner_tid if owner_tid != tid && set_waiters_bit => futex_val | FUTEX_WAITERS,
+            _ => futex_val,
+        })
+    })?;
+
+    match futex_val & FUTEX_TID_MASK {
+        0 => {
+            // The previous owner may die with waiters, e.g., for robust futexes.
+            let queue_id = key.queue_id();
+            if let Some(stale) = queues.pi_states.remove(&queue_id) {
+                update_boost(&stale.owner, queue_id, None);
+            }
+            if has_waiters {
+                queues.add_pi_state(key, thread.clone());
+            }
+            Ok(None)
+        }
+        owner_tid if owner_tid == tid => {
+            return_errno_with_message!(Errno::EDEADLK, "the futex is already locked by the thread")
+        }
+        owner_tid => Ok(Some(owner_tid)),
+    }
+}
+
+/// Updates the futex word atomically, since user space may update it
+/// concurrently with its own atomic instructions.
+///
+/// `update` maps the current value to the new one. It is called again with
+/// the latest value if user space changes the word in between. Returns the
+/// value that the successful update is based on.
+fn update_word(
+    futex_addr: Vaddr,
+    ctx: &Context,
+    mut update: impl FnMut(u32) -> Result<u32>,
+) -> Result<u32> {
+    let user_space = ctx.user_space();
+
+    let mut futex_val = user_space.read_val::<u32>(futex_addr)?;
+    loop {
+        let new_val = update(futex_val)?;
+        if new_val == futex_val {
+            return Ok(futex_val);
+        }
+
+        let prev_val = user_space.atomic_compare_exchange_u32(futex_addr, futex_val, new_val)?;
+        if prev_val == futex_val {
+            return Ok(futex_val);
+        }
+        futex_val = prev_val;
+    }
+}
+
+/// Removes the PI waiter associated with `waker`, if it is still enqueued, and
+/// updates the boost of the owner accordingly.
+fn remove_pi_waiter(key: FutexKey, waker: &Arc<Waker>) {
+    let queue_id = key.queue_id();
+    let (_, futex_bucket) = get_futex_bucket(key);
+
+    let mut queues = futex_bucket.queues.lock();
+    if !queues.remove_item(key, waker) {
+        return;
+    }
+
+    let changed_owner = queues.pi_states.remove(&queue_id).and_then(|pi_state| {
+        let owner = pi_state.owner;
+        let policy_changed = if queues.nr_pi_waiters(key) > 0 {
+            queues.add_pi_state(key, owner.clone())
+        } else {
+            update_boost(&owner, queue_id, None)
+        };
+        policy_changed.then_some(owner)
+    });
+    drop(queues);
+    futex_bucket.sub_waiters(1);
+
+    if let Some(owner) = changed_owner {
+        propagate_boost(owner);
+    }
+}
+
+fn pi_futex_state(thread: &Thread) -> &PiFutexState {
+    thread.as_posix_thread().unwrap().pi_futex_state()
+}
+
+fn set_blocked_on(thread: &Thread, key: Option<FutexKey>) {
+    *pi_futex_state(thread).blocked_on.lock() = key;
+}
+
+/// Updates the policy inherited by `owner` from the waiters of a PI futex.
+///
+/// If the effective policy of the owner changes and the owner is runnable, it
+/// is moved to the run queue of its new scheduling class at once. Otherwise, a
+/// boosted owner could be stuck behind the threads that preempt it, which is
+/// exactly the priority inversion that PI futexes should prevent.
+///
+/// Returns whether the effective policy of the owner changes.
+fn update_boost(owner: &Thread, queue_id: FutexQueueId, policy: Option<SchedPolicy>) -> bool {
+    let mut boosts = pi_futex_state(owner).boosts.lock();
+    match policy {
+        Some(policy) => boosts.insert(queue_id, policy),
+        None => boosts.remove(&queue_id),
+    };
+
+    let policy_changed = owner
+        .sched_attr()
+        .set_pi_boost(boosts.values().min().copied());
+    drop(boosts);
+
+    // An owner whose task has been dropped is in no run queue.
+    if policy_changed && let Some(task) = owner.try_task() {
+        requeue_target(&task);
+    }
+    policy_changed
+}
+
+/// Propagates the changed policy of `thread` to the owners of the PI futexes
+/// that it is transitively blocked on.
+fn propagate_boost(mut thread: Arc<Thread>) {
+    for _ in 0..MAX_PI_CHAIN_DEPTH {
+        let Some(key) = *pi_futex_state(&thread).blocked_on.lock() else {
+            return;
+        };
+
+        let (_, futex_bucket) = get_futex_bucket(key);
+        let mut queues = futex_bucket.queues.lock();
+        let Some(pi_state) = queues.pi_states.remove(&key.queue_id()) else {
+            return;
+        };
+        let owner = pi_state.owner;
+        let policy_changed = queues.add_pi_state(key, owner.clone());
+        drop(queues);
+
+        if !policy_changed {
+            return;
+        }
+        thread = owner;
+    }
+}
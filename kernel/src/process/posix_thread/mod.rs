@@ -24,6 +24,7 @@ use crate::{
     process::signal::constants::SIGCONT,
     thread::{Thread, Tid},
     time::{clocks::ProfClock, Timer, TimerManager},
+    vm::mempolicy::MemPolicy,
 };
 
 mod builder;
@@ -76,6 +77,12 @@ pub struct PosixThread {
 
     /// A manager that manages timers based on the profiling clock of the current thread.
     prof_timer_manager: Arc<TimerManager>,
+
+    /// The state of the priority-inheritance futexes owned or waited by the thread.
+    pi_futex_state: futex::PiFutexState,
+
+    /// The NUMA memory policy of the thread.
+    mem_policy: SpinLock<MemPolicy>,
 }
 
 impl PosixThread {
@@ -104,6 +111,15 @@ impl PosixThread {
         &self.fs
     }
 
+    pub(in crate::process) fn pi_futex_state(&self) -> &futex::PiFutexState {
+        &self.pi_futex_state
+    }
+
+    /// Returns the NUMA memory policy of the thread.
+    pub fn mem_policy(&self) -> &SpinLock<MemPolicy> {
+        &self.mem_policy
+    }
+
     /// Get the reference to the signal mask of the thread.
     ///
     /// Note that while this function offers mutable access to the signal mask,
@@ -4,7 +4,12 @@
 
 use ostd::task::Task;
 
-use crate::{current_userspace, prelude::*, process::posix_thread::futex::futex_wake, thread::Tid};
+use crate::{
+    current_userspace,
+    prelude::*,
+    process::posix_thread::futex::{futex_wake, FUTEX_OWNER_DIED, FUTEX_TID_MASK, FUTEX_WAITERS},
+    thread::Tid,
+};
 
 #[repr(C)]
 #[derive(Clone, Copy, Debug, Pod)]
@@ -120,12 +125,7 @@ impl Iterator for FutexIter<'_> {
     }
 }
 
-const FUTEX_WAITERS: u32 = 0x8000_0000;
-const FUTEX_OWNER_DIED: u32 = 0x4000_0000;
-const FUTEX_TID_MASK: u32 = 0x3FFF_FFFF;
-
 /// Wakeup one robust futex owned by the thread
-/// FIXME: requires atomic operations here
 pub fn wake_robust_futex(futex_addr: Vaddr, tid: Tid) -> Result<()> {
     let task = Task::current().unwrap();
     let user_space = CurrentUserSpace::new(&task);
@@ -143,15 +143,14 @@ pub fn wake_robust_futex(futex_addr: Vaddr, tid: Tid) -> Result<()> {
             break;
         }
         let new_val = (old_val & FUTEX_WAITERS) | FUTEX_OWNER_DIED;
-        let cur_val = user_space.read_val(futex_addr)?;
-        if cur_val != new_val {
+        let cur_val = user_space.atomic_compare_exchange_u32(futex_addr, old_val, new_val)?;
+        if cur_val != old_val {
             // The futex value has changed, let's retry with current value
             old_val = cur_val;
-            user_space.write_val(futex_addr, &new_val)?;
             continue;
         }
         // Wakeup one waiter
-        if cur_val & FUTEX_WAITERS != 0 {
+        if new_val & FUTEX_WAITERS != 0 {
             debug!("wake robust futex addr: {:?}", futex_addr);
             futex_wake(futex_addr, 1, None)?;
         }
@@ -1,12 +1,17 @@
 // SPDX-License-Identifier: MPL-2.0
 
+use alloc::sync::Arc;
 use core::cell::{Cell, Ref, RefCell, RefMut};
 
 use aster_rights::Full;
 use ostd::{mm::Vaddr, sync::RwArc, task::CurrentTask};
 
 use super::RobustListHead;
-use crate::{fs::file_table::FileTable, process::signal::SigStack, vm::vmar::Vmar};
+use crate::{
+    fs::file_table::{FileArray, FileTable},
+    process::signal::{PollCache, SigStack},
+    vm::vmar::Vmar,
+};
 
 /// Local data for a POSIX thread.
 pub struct ThreadLocal {
@@ -24,6 +29,8 @@ pub struct ThreadLocal {
 
     // Files.
     file_table: RefCell<Option<RwArc<FileTable>>>,
+    /// The published files of `file_table` for the lock-free lookups.
+    file_array: Arc<FileArray>,
 
     // Signal.
     /// `ucontext` address for the signal handler.
@@ -32,6 +39,10 @@ pub struct ThreadLocal {
     sig_context: Cell<Option<Vaddr>>,
     /// Stack address, size, and flags for the signal handler.
     sig_stack: RefCell<Option<SigStack>>,
+
+    // Polling.
+    /// The poller of the last `poll` or `select`, which can be reused by the next call.
+    poll_cache: RefCell<Option<PollCache>>,
 }
 
 impl ThreadLocal {
@@ -41,14 +52,17 @@ impl ThreadLocal {
         root_vmar: Vmar<Full>,
         file_table: RwArc<FileTable>,
     ) -> Self {
+        let file_array = file_table.read().file_array().clone();
         Self {
             set_child_tid: Cell::new(set_child_tid),
             clear_child_tid: Cell::new(clear_child_tid),
             root_vmar: RefCell::new(Some(root_vmar)),
             robust_list: RefCell::new(None),
             file_table: RefCell::new(Some(file_table)),
+            file_array,
             sig_context: Cell::new(None),
             sig_stack: RefCell::new(None),
+            poll_cache: RefCell::new(None),
         }
     }
 
@@ -73,7 +87,14 @@ impl ThreadLocal {
     }
 
     pub fn borrow_file_table_mut(&self) -> FileTableRefMut {
-        FileTableRefMut(self.file_table.borrow_mut())
+        FileTableRefMut(self.file_table.borrow_mut(), &self.file_array)
+    }
+
+    /// Returns the published files of the file table.
+    ///
+    /// The files can be looked up without borrowing or locking the file table.
+    pub fn file_array(&self) -> &FileArray {
+        &self.file_array
     }
 
     pub fn sig_context(&self) -> &Cell<Option<Vaddr>> {
@@ -83,6 +104,10 @@ impl ThreadLocal {
     pub fn sig_stack(&self) -> &RefCell<Option<SigStack>> {
         &self.sig_stack
     }
+
+    pub fn poll_cache(&self) -> &RefCell<Option<PollCache>> {
+        &self.poll_cache
+    }
 }
 
 /// An immutable, shared reference to the file table in [`ThreadLocal`].
@@ -100,9 +125,9 @@ impl FileTableRef<'_> {
 }
 
 /// A mutable, exclusive reference to the file table in [`ThreadLocal`].
-pub struct FileTableRefMut<'a>(RefMut<'a, Option<RwArc<FileTable>>>);
+pub struct FileTableRefMut<'a>(RefMut<'a, Option<RwArc<FileTable>>>, &'a FileArray);
 
-impl FileTableRefMut<'_> {
+impl<'a> FileTableRefMut<'a> {
     /// Unwraps and returns a reference to the file table.
     ///
     /// # Panics
@@ -112,6 +137,14 @@ impl FileTableRefMut<'_> {
         self.0.as_mut().unwrap()
     }
 
+    /// Returns the published files of the file table.
+    ///
+    /// The files are published only while the file table is shared, so that they can be looked
+    /// up without locking the file table.
+    pub fn file_array(&self) -> &'a FileArray {
+        self.1
+    }
+
     /// Removes the file table and drops it.
     pub(super) fn remove(&mut self) {
         *self.0 = None;
@@ -615,6 +615,18 @@ impl Process {
 
         // TODO: check that the signal is not user signal
 
+        // Prefer the current thread if it is in the process and does not block the signal. The
+        // thread handles the signal on its way back to the user space, so no other thread needs to
+        // be woken up and the threads need not be scanned.
+        if let Some(task) = Task::current()
+            && let Some(posix_thread) = task.as_posix_thread()
+            && core::ptr::eq(posix_thread.weak_process().as_ptr(), self)
+            && !posix_thread.has_signal_blocked(signal.num())
+        {
+            posix_thread.enqueue_signal(Box::new(signal));
+            return;
+        }
+
         // Enqueue signal to the first thread that does not block the signal
         let threads = self.tasks.lock();
         for thread in threads.as_slice() {
@@ -87,6 +87,12 @@ impl ProcessVmarGuard<'_> {
         self.inner.as_ref().unwrap()
     }
 
+    /// Returns a reference to the process VMAR, or `None` if the process has
+    /// exited and its VMAR has been dropped.
+    pub fn get(&self) -> Option<&Vmar<Full>> {
+        self.inner.as_ref()
+    }
+
     /// Sets a new VMAR for the binding process.
     ///
     /// If the `new_vmar` is `None`, this method will remove the
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! A cache of the parsed ELF files.
+//!
+//! The same programs, e.g., the shell and the dynamic linker, are executed
+//! over and over again. The cache keeps their parsed ELF headers, program
+//! headers and interpreter paths, so that an `execve` of a cached program
+//! neither reads nor parses its headers again.
+//!
+//! An entry is keyed by the device and the inode number of the file, and it
+//! is valid only if the modification time and the size of the file are not
+//! changed since the file was parsed.
+
+use core::{num::NonZeroUsize, time::Duration};
+
+use lru::LruCache;
+use spin::Once;
+
+use super::elf_file::Elf;
+use crate::{fs::utils::Inode, prelude::*};
+
+/// The maximum number of the cached ELF files.
+const ELF_CACHE_SIZE: usize = 64;
+
+static ELF_CACHE: Once<SpinLock<LruCache<ElfKey, CachedElf>>> = Once::new();
+
+type ElfKey = (u64, u64);
+
+struct CachedElf {
+    mtime: Duration,
+    size: usize,
+    elf: Arc<Elf>,
+}
+
+fn elf_cache() -> &'static SpinLock<LruCache<ElfKey, CachedElf>> {
+    ELF_CACHE.call_once(|| SpinLock::new(LruCache::new(NonZeroUsize::new(ELF_CACHE_SIZE).unwrap())))
+}
+
+/// Returns the cached ELF of the inode, if it is cached and still valid.
+pub fn lookup(inode: &dyn Inode) -> Option<Arc<Elf>> {
+    let metadata = inode.metadata();
+    let mut cache = elf_cache().lock();
+
+    let cached = cache.get(&(metadata.dev, metadata.ino))?;
+    if cached.mtime == metadata.mtime && cached.size == metadata.size {
+        return Some(cached.elf.clone());
+    }
+
+    cache.pop(&(metadata.dev, metadata.ino));
+    None
+}
+
+/// Parses the ELF from the file header of the inode and caches it.
+///
+/// The file header should contain the first page of the file.
+pub fn parse_and_insert(inode: &dyn Inode, file_header: &[u8]) -> Result<Arc<Elf>> {
+    let metadata = inode.metadata();
+    let elf = Arc::new(Elf::parse_elf(file_header)?);
+
+    let cached = CachedElf {
+        mtime: metadata.mtime,
+        size: metadata.size,
+        elf: elf.clone(),
+    };
+    elf_cache().lock().put((metadata.dev, metadata.ino), cached);
+
+    Ok(elf)
+}
+
+/// Returns the parsed ELF of the inode, from the cache if possible.
+pub fn lookup_or_parse(inode: &dyn Inode) -> Result<Arc<Elf>> {
+    if let Some(elf) = lookup(inode) {
+        return Ok(elf);
+    }
+
+    let mut file_header = Box::new([0u8; PAGE_SIZE]);
+    inode.read_bytes_at(0, &mut *file_header)?;
+    parse_and_insert(inode, &*file_header)
+}
@@ -10,6 +10,8 @@ use crate::prelude::*;
 pub struct Elf {
     pub elf_header: ElfHeader,
     pub program_headers: Vec<ProgramHeader64>,
+    /// The path of the ldso specified by the interpret section, if any.
+    ldso_path: Option<String>,
 }
 
 impl Elf {
@@ -42,9 +44,11 @@ impl Elf {
             };
             program_headers.push(ph64);
         }
+        let ldso_path = parse_ldso_path(&program_headers, input)?;
         Ok(Self {
             elf_header,
             program_headers,
+            ldso_path,
         })
     }
 
@@ -89,23 +93,9 @@ impl Elf {
         self.elf_header.pt2.type_.as_type() == header::Type::SharedObject
     }
 
-    /// read the ldso path from the elf interpret section
-    pub fn ldso_path(&self, file_header_buf: &[u8]) -> Result<Option<String>> {
-        for program_header in &self.program_headers {
-            let type_ = program_header.get_type().map_err(|_| {
-                Error::with_message(Errno::ENOEXEC, "parse program header type fails")
-            })?;
-            if type_ == program::Type::Interp {
-                let file_size = program_header.file_size as usize;
-                let file_offset = program_header.offset as usize;
-                debug_assert!(file_offset + file_size <= file_header_buf.len());
-                let ldso = CStr::from_bytes_with_nul(
-                    &file_header_buf[file_offset..file_offset + file_size],
-                )?;
-                return Ok(Some(ldso.to_string_lossy().to_string()));
-            }
-        }
-        Ok(None)
+    /// the ldso path from the elf interpret section
+    pub fn ldso_path(&self) -> Option<&str> {
+        self.ldso_path.as_deref()
     }
 
     // An offset to be subtracted from ELF vaddr for PIE
@@ -115,6 +105,27 @@ impl Elf {
     }
 }
 
+/// read the ldso path from the elf interpret section
+fn parse_ldso_path(
+    program_headers: &[ProgramHeader64],
+    file_header_buf: &[u8],
+) -> Result<Option<String>> {
+    for program_header in program_headers {
+        let type_ = program_header
+            .get_type()
+            .map_err(|_| Error::with_message(Errno::ENOEXEC, "parse program header type fails"))?;
+        if type_ == program::Type::Interp {
+            let file_size = program_header.file_size as usize;
+            let file_offset = program_header.offset as usize;
+            debug_assert!(file_offset + file_size <= file_header_buf.len());
+            let ldso =
+                CStr::from_bytes_with_nul(&file_header_buf[file_offset..file_offset + file_size])?;
+            return Ok(Some(ldso.to_string_lossy().to_string()));
+        }
+    }
+    Ok(None)
+}
+
 pub struct ElfHeader {
     pub pt1: HeaderPt1,
     pub pt2: HeaderPt2_64,
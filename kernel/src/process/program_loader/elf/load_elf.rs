@@ -10,7 +10,7 @@ use aster_rights::Full;
 use ostd::mm::{CachePolicy, PageFlags, PageProperty, VmIo};
 use xmas_elf::program::{self, ProgramHeader64};
 
-use super::elf_file::Elf;
+use super::{elf_cache, elf_file::Elf};
 use crate::{
     fs::{
         fs_resolver::{FsPath, FsResolver, AT_FDCWD},
@@ -37,17 +37,15 @@ use crate::{
 /// initialize process init stack.
 pub fn load_elf_to_vm(
     process_vm: &ProcessVm,
-    file_header: &[u8],
+    parsed_elf: &Elf,
     elf_file: Dentry,
     fs_resolver: &FsResolver,
     argv: Vec<CString>,
     envp: Vec<CString>,
 ) -> Result<ElfLoadInfo> {
-    let parsed_elf = Elf::parse_elf(file_header)?;
-
-    let ldso = lookup_and_parse_ldso(&parsed_elf, file_header, fs_resolver)?;
+    let ldso = lookup_and_parse_ldso(parsed_elf, fs_resolver)?;
 
-    match init_and_map_vmos(process_vm, ldso, &parsed_elf, &elf_file) {
+    match init_and_map_vmos(process_vm, ldso, parsed_elf, &elf_file) {
         Ok((entry_point, mut aux_vec)) => {
             // Map and set vdso entry.
             // Since vdso does not require being mapped to any specific address,
@@ -87,22 +85,16 @@ pub fn load_elf_to_vm(
 
 fn lookup_and_parse_ldso(
     elf: &Elf,
-    file_header: &[u8],
     fs_resolver: &FsResolver,
-) -> Result<Option<(Dentry, Elf)>> {
+) -> Result<Option<(Dentry, Arc<Elf>)>> {
     let ldso_file = {
-        let Some(ldso_path) = elf.ldso_path(file_header)? else {
+        let Some(ldso_path) = elf.ldso_path() else {
             return Ok(None);
         };
-        let fs_path = FsPath::new(AT_FDCWD, &ldso_path)?;
+        let fs_path = FsPath::new(AT_FDCWD, ldso_path)?;
         fs_resolver.lookup(&fs_path)?
     };
-    let ldso_elf = {
-        let mut buf = Box::new([0u8; PAGE_SIZE]);
-        let inode = ldso_file.inode();
-        inode.read_bytes_at(0, &mut *buf)?;
-        Elf::parse_elf(&*buf)?
-    };
+    let ldso_elf = elf_cache::lookup_or_parse(ldso_file.inode().as_ref())?;
     Ok(Some((ldso_file, ldso_elf)))
 }
 
@@ -116,7 +108,7 @@ fn load_ldso(root_vmar: &Vmar<Full>, ldso_file: &Dentry, ldso_elf: &Elf) -> Resu
 
 fn init_and_map_vmos(
     process_vm: &ProcessVm,
-    ldso: Option<(Dentry, Elf)>,
+    ldso: Option<(Dentry, Arc<Elf>)>,
     parsed_elf: &Elf,
     elf_file: &Dentry,
 ) -> Result<(Vaddr, AuxVec)> {
@@ -305,6 +297,12 @@ fn map_segment_vmo(
         vm_map_options = vm_map_options.offset(offset).handle_page_faults_around();
         let map_addr = vm_map_options.build()?;
 
+        // The text pages that are already in the page cache are mapped at
+        // once, instead of being faulted in one by one.
+        if perms.contains(VmPerms::EXEC) {
+            root_vmar.map_committed_pages(map_addr..map_addr + segment_size)?;
+        }
+
         // Write zero as paddings. There are head padding and tail padding.
         // Head padding: if the segment's virtual address is not page-aligned,
         // then the bytes in first page from start to virtual address should be padded zeros.
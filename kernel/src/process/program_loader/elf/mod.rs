@@ -1,6 +1,9 @@
 // SPDX-License-Identifier: MPL-2.0
 
+mod elf_cache;
 mod elf_file;
 mod load_elf;
 
+pub use elf_cache::{lookup as lookup_cached_elf, parse_and_insert as parse_and_cache_elf};
+pub use elf_file::Elf;
 pub use load_elf::{load_elf_to_vm, ElfLoadInfo};
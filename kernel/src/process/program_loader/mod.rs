@@ -4,7 +4,7 @@ pub mod elf;
 mod shebang;
 
 use self::{
-    elf::{load_elf_to_vm, ElfLoadInfo},
+    elf::{load_elf_to_vm, lookup_cached_elf, parse_and_cache_elf, Elf, ElfLoadInfo},
     shebang::parse_shebang_line,
 };
 use super::process_vm::ProcessVm;
@@ -19,11 +19,11 @@ use crate::{
 
 /// Represents an executable file that is ready to be loaded into memory and executed.
 ///
-/// This struct encapsulates the ELF file to be executed along with its header data,
+/// This struct encapsulates the ELF file to be executed along with its parsed headers,
 /// the `argv` and the `envp` which is required for the program execution.
 pub struct ProgramToLoad {
     elf_file: Dentry,
-    file_header: Box<[u8; PAGE_SIZE]>,
+    parsed_elf: Arc<Elf>,
     argv: Vec<CString>,
     envp: Vec<CString>,
 }
@@ -44,6 +44,16 @@ impl ProgramToLoad {
         recursion_limit: usize,
     ) -> Result<Self> {
         let inode = elf_file.inode();
+        // A cached ELF file is parsed already, and it cannot be a shebang script.
+        if let Some(parsed_elf) = lookup_cached_elf(inode.as_ref()) {
+            return Ok(Self {
+                elf_file,
+                parsed_elf,
+                argv,
+                envp,
+            });
+        }
+
         let file_header = {
             // read the first page of file header
             let mut file_header_buffer = Box::new([0u8; PAGE_SIZE]);
@@ -70,9 +80,10 @@ impl ProgramToLoad {
             );
         }
 
+        let parsed_elf = parse_and_cache_elf(inode.as_ref(), &*file_header)?;
         Ok(Self {
             elf_file,
-            file_header,
+            parsed_elf,
             argv,
             envp,
         })
@@ -91,7 +102,7 @@ impl ProgramToLoad {
         let abs_path = self.elf_file.abs_path();
         let elf_load_info = load_elf_to_vm(
             process_vm,
-            &*self.file_header,
+            &self.parsed_elf,
             self.elf_file,
             fs_resolver,
             self.argv,
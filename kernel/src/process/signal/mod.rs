@@ -21,7 +21,7 @@ use constants::SIGSEGV;
 pub use events::{SigEvents, SigEventsFilter};
 use ostd::{cpu::context::UserContext, user::UserContextApi};
 pub use pause::{with_sigmask_changed, Pause};
-pub use poll::{PollAdaptor, PollHandle, Pollable, Pollee, Poller};
+pub use poll::{PollAdaptor, PollCache, PollHandle, Pollable, Pollee, Poller};
 use sig_action::{SigAction, SigActionFlags, SigDefaultAction};
 use sig_mask::SigMask;
 use sig_num::SigNum;
@@ -30,9 +30,9 @@ pub use sig_stack::{SigStack, SigStackFlags};
 use super::posix_thread::ThreadLocal;
 use crate::{
     cpu::LinuxAbi,
-    current_userspace,
     prelude::*,
     process::{posix_thread::do_exit_group, TermStatus},
+    vm::vmar::ROOT_VMAR_LOWEST_ADDR,
 };
 
 pub trait SignalContext {
@@ -193,15 +193,22 @@ pub fn handle_user_signal(
     // To avoid corrupting signal stack, we minus 128 first.
     stack_pointer -= 128;
 
-    let user_space = ctx.user_space();
-
-    // 1. Write siginfo_t
-    stack_pointer -= mem::size_of::<siginfo_t>() as u64;
-    user_space.write_val(stack_pointer as _, &sig_info)?;
-    let siginfo_addr = stack_pointer;
+    // The signal frame consists of, from the lower addresses to the higher addresses, the address
+    // of the restorer code (if provided), the `ucontext_t` aligned to 16 bytes, and the
+    // `siginfo_t`.
+    let siginfo_addr = stack_pointer - mem::size_of::<siginfo_t>() as u64;
+    let ucontext_addr =
+        alloc_aligned_in_user_stack(siginfo_addr, mem::size_of::<ucontext_t>(), 16)?;
+    stack_pointer = if flags.contains(SigActionFlags::SA_RESTORER) {
+        ucontext_addr - mem::size_of::<u64>() as u64
+    } else {
+        ucontext_addr
+    };
+    let frame_end = siginfo_addr + mem::size_of::<siginfo_t>() as u64;
+    if stack_pointer < ROOT_VMAR_LOWEST_ADDR as u64 {
+        return_errno_with_message!(Errno::EFAULT, "the signal stack is invalid");
+    }
 
-    // 2. Write ucontext_t.
-    stack_pointer = alloc_aligned_in_user_stack(stack_pointer, mem::size_of::<ucontext_t>(), 16)?;
     let mut ucontext = ucontext_t {
         uc_sigmask: mask.into(),
         ..Default::default()
@@ -218,22 +225,27 @@ pub fn handle_user_signal(
         ucontext.uc_link = 0;
     }
     // TODO: store fp regs in ucontext
-    user_space.write_val(stack_pointer as _, &ucontext)?;
-    let ucontext_addr = stack_pointer;
-    // Store the ucontext addr in sig context of current thread.
-    ctx.thread_local
-        .sig_context()
-        .set(Some(ucontext_addr as Vaddr));
 
-    // 3. Write the address of the restorer code.
+    // Write the whole frame with a single writer, so that the user space range is checked once.
+    let mut writer = ctx
+        .user_space()
+        .writer(stack_pointer as Vaddr, (frame_end - stack_pointer) as usize)?;
+    // 1. Write the address of the restorer code.
     if flags.contains(SigActionFlags::SA_RESTORER) {
         // If the SA_RESTORER flag is present, the restorer code address is provided by the user.
-        stack_pointer = write_u64_to_user_stack(stack_pointer, restorer_addr as u64)?;
-        trace!(
-            "After writing restorer addr: user_rsp = 0x{:x}",
-            stack_pointer
-        );
+        writer.write_val(&(restorer_addr as u64))?;
     }
+    // 2. Write ucontext_t.
+    writer.write_val(&ucontext)?;
+    // 3. Write siginfo_t.
+    writer.skip((siginfo_addr - ucontext_addr) as usize - mem::size_of::<ucontext_t>());
+    writer.write_val(&sig_info)?;
+    trace!("signal frame: user_rsp = 0x{:x}", stack_pointer);
+
+    // Store the ucontext addr in sig context of current thread.
+    ctx.thread_local
+        .sig_context()
+        .set(Some(ucontext_addr as Vaddr));
 
     // 4. Set correct register values
     user_ctx.set_instruction_pointer(handler_addr as _);
@@ -282,12 +294,6 @@ fn use_alternate_signal_stack(thread_local: &ThreadLocal) -> Option<usize> {
     Some(stack_pointer)
 }
 
-fn write_u64_to_user_stack(rsp: u64, value: u64) -> Result<u64> {
-    let rsp = rsp - 8;
-    current_userspace!().write_val(rsp as Vaddr, &value)?;
-    Ok(rsp)
-}
-
 /// alloc memory of size on user stack, the return address should respect the align argument.
 fn alloc_aligned_in_user_stack(rsp: u64, size: usize, align: usize) -> Result<u64> {
     if !align.is_power_of_two() {
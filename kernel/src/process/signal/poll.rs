@@ -12,6 +12,7 @@ use ostd::{
 
 use crate::{
     events::{IoEvents, Observer, Subject},
+    fs::file_handle::FileLike,
     prelude::*,
     time::wait::TimeoutExt,
 };
@@ -157,9 +158,12 @@ impl Pollee {
     /// the same poller. Unlike [`Self::poll_with`], this method performs poller registration
     /// without checking (and perhaps caching) the current events.
     pub fn register_poller(&self, poller: &mut PollHandle, mask: IoEvents) {
-        self.inner
-            .subject
-            .register_observer(poller.observer.clone(), mask);
+        let subject = &self.inner.subject;
+        if poller.is_exclusive {
+            subject.register_exclusive_observer(poller.observer.clone(), mask);
+        } else {
+            subject.register_observer(poller.observer.clone(), mask);
+        }
 
         poller.pollees.push(Arc::downgrade(&self.inner));
     }
@@ -177,6 +181,14 @@ impl Pollee {
         self.inner.subject.notify_observers(&events);
     }
 
+    /// Returns whether there are any registered pollers.
+    ///
+    /// The result may be spurious since the pollers that have been dropped are only removed
+    /// lazily.
+    pub fn has_pollers(&self) -> bool {
+        self.inner.subject.has_observers()
+    }
+
     /// Invalidates the (internal) cached events.
     ///
     /// This method should be called whenever old events disappear but no new events arrive. The
@@ -201,6 +213,8 @@ pub struct PollHandle {
     observer: Weak<dyn Observer<IoEvents>>,
     // The associated pollees.
     pollees: Vec<Weak<PolleeInner>>,
+    // Whether the observer is registered as an exclusive observer.
+    is_exclusive: bool,
 }
 
 impl PollHandle {
@@ -213,9 +227,20 @@ impl PollHandle {
         Self {
             observer,
             pollees: Vec::new(),
+            is_exclusive: false,
         }
     }
 
+    /// Sets whether the observer should be notified exclusively.
+    ///
+    /// An exclusive observer is notified of an event only if no other exclusive observers of the
+    /// same pollee have accepted the event. See [`Observer::on_exclusive_events`] for details.
+    ///
+    /// This only takes effect on the pollees with which the handle is registered afterwards.
+    pub fn set_exclusive(&mut self, is_exclusive: bool) {
+        self.is_exclusive = is_exclusive;
+    }
+
     /// Resets the handle.
     ///
     /// The observer will be unregistered and will no longer receive events.
@@ -304,6 +329,15 @@ impl Poller {
         &mut self.poller
     }
 
+    /// Resets the timeout, so that the poller can be reused for another wait.
+    ///
+    /// The timeout has the same meaning as the one in [`Self::new`].
+    pub fn reset_timeout(&mut self, timeout: Option<&Duration>) {
+        let mut timeout_ext = TimeoutExt::from(timeout);
+        timeout_ext.freeze();
+        self.timeout = timeout_ext;
+    }
+
     /// Waits until some interesting events happen since the last wait.
     ///
     /// This method will fail with [`EINTR`] if interrupted by signals or [`ETIME`] on timeout.
@@ -315,6 +349,64 @@ impl Poller {
     }
 }
 
+/// A [`Poller`] that is kept registered with the files after a `poll`-like system call.
+///
+/// Programs often poll the same set of files over and over, and registering the poller with each
+/// file and unregistering it afterwards dominates the cost of polling many files. So the poller
+/// is cached in the thread after each call, and the next call reuses it as is if it polls the same
+/// files for the same events.
+///
+/// The cached poller may be woken up by the events that occur between the calls. Such a wakeup
+/// is spurious and the woken call just checks the events again.
+pub struct PollCache {
+    files: Vec<(Weak<dyn FileLike>, IoEvents)>,
+    poller: Poller,
+}
+
+impl PollCache {
+    /// Creates a cache of the poller that is registered with the files for the events.
+    pub fn new<'a>(
+        poller: Poller,
+        files: impl Iterator<Item = (&'a Arc<dyn FileLike>, IoEvents)>,
+    ) -> Self {
+        let files = files
+            .map(|(file, events)| (Arc::downgrade(file), events))
+            .collect();
+        Self { files, poller }
+    }
+
+    /// Returns whether the poller is registered with exactly the files for the events.
+    ///
+    /// `None` in `files` stands for a file that does not exist, which never matches.
+    pub fn matches<'a>(
+        &self,
+        mut files: impl ExactSizeIterator<Item = Option<(&'a Arc<dyn FileLike>, IoEvents)>>,
+    ) -> bool {
+        if files.len() != self.files.len() {
+            return false;
+        }
+
+        // The cached `Weak`s keep the allocations of the files alive, so the addresses cannot be
+        // reused by other files.
+        self.files.iter().all(|(cached_file, cached_events)| {
+            files.next().flatten().is_some_and(|(file, events)| {
+                core::ptr::addr_eq(cached_file.as_ptr(), Arc::as_ptr(file))
+                    && *cached_events == events
+            })
+        })
+    }
+
+    /// Returns a reference to the poller.
+    pub fn poller(&self) -> &Poller {
+        &self.poller
+    }
+
+    /// Returns a mutable reference to the poller.
+    pub fn poller_mut(&mut self) -> &mut Poller {
+        &mut self.poller
+    }
+}
+
 impl Observer<IoEvents> for Waker {
     fn on_events(&self, _events: &IoEvents) {
         self.wake_up();
@@ -1,6 +1,6 @@
 // SPDX-License-Identifier: MPL-2.0
 
-use core::sync::atomic::{AtomicUsize, Ordering};
+use core::sync::atomic::{AtomicU64, Ordering};
 
 use super::{
     constants::*,
@@ -15,9 +15,12 @@ use crate::{
 };
 
 pub struct SigQueues {
-    // The number of pending signals.
-    // Useful for quickly determining if any signals are pending without locking `queues`.
-    count: AtomicUsize,
+    /// The set of pending signals.
+    ///
+    /// This mirrors the non-empty queues in `queues` and is only modified
+    /// with `queues` locked. It allows checking for the pending signals, which
+    /// happens on every return to the user space, without locking `queues`.
+    pending: AtomicU64,
     queues: Mutex<Queues>,
     subject: Subject<SigEvents, SigEventsFilter>,
 }
@@ -25,14 +28,14 @@ pub struct SigQueues {
 impl SigQueues {
     pub fn new() -> Self {
         Self {
-            count: AtomicUsize::new(0),
+            pending: AtomicU64::new(0),
             queues: Mutex::new(Queues::new()),
             subject: Subject::new(),
         }
     }
 
     pub fn is_empty(&self) -> bool {
-        self.count.load(Ordering::Relaxed) == 0
+        self.pending.load(Ordering::Relaxed) == 0
     }
 
     pub fn enqueue(&self, signal: Box<dyn Signal>) {
@@ -40,7 +43,8 @@ impl SigQueues {
 
         let mut queues = self.queues.lock();
         if queues.enqueue(signal) {
-            self.count.fetch_add(1, Ordering::Relaxed);
+            self.pending
+                .fetch_or(u64::from(SigSet::from(signum)), Ordering::Release);
             // Avoid holding lock when notifying observers
             drop(queues);
             self.subject.notify_observers(&SigEvents::new(signum));
@@ -48,31 +52,29 @@ impl SigQueues {
     }
 
     pub fn dequeue(&self, blocked: &SigMask) -> Option<Box<dyn Signal>> {
-        // Fast path for the common case of no pending signals
-        if self.is_empty() {
+        // Fast path for the common case of no pending signals that are not blocked
+        if !self.has_pending(*blocked) {
             return None;
         }
 
         let mut queues = self.queues.lock();
-        let signal = queues.dequeue(blocked);
-        if signal.is_some() {
-            self.count.fetch_sub(1, Ordering::Relaxed);
+        let signal = queues.dequeue(blocked)?;
+        let signum = signal.num();
+        if !queues.has_queued(signum) {
+            self.pending
+                .fetch_and(!u64::from(SigSet::from(signum)), Ordering::Relaxed);
         }
-        signal
+        Some(signal)
     }
 
     /// Returns the pending signals
     pub fn sig_pending(&self) -> SigSet {
-        let queues = self.queues.lock();
-        queues.sig_pending()
+        SigSet::from(self.pending.load(Ordering::Acquire))
     }
 
     /// Returns whether there's some pending signals that are not blocked
     pub fn has_pending(&self, blocked: SigMask) -> bool {
-        if self.is_empty() {
-            return false;
-        }
-        self.queues.lock().has_pending(blocked)
+        !(self.sig_pending() - blocked).is_empty()
     }
 
     pub fn register_observer(
@@ -198,13 +200,15 @@ impl Queues {
         None
     }
 
-    /// Returns whether the `SigQueues` has some pending signals which are not blocked
-    fn has_pending(&self, blocked: SigMask) -> bool {
-        self.std_queues.iter().any(|signal| {
-            signal
-                .as_ref()
-                .is_some_and(|signal| !blocked.contains(signal.num()))
-        }) || self.rt_queues.iter().any(|rt_queue| !rt_queue.is_empty())
+    /// Returns whether there are some queued signals of the number
+    fn has_queued(&self, signum: SigNum) -> bool {
+        if signum.is_std() {
+            let idx = (signum.as_u8() - MIN_STD_SIG_NUM) as usize;
+            self.std_queues[idx].is_some()
+        } else {
+            let idx = (signum.as_u8() - MIN_RT_SIG_NUM) as usize;
+            !self.rt_queues[idx].is_empty()
+        }
     }
 
     fn get_std_queue_mut(&mut self, signum: SigNum) -> &mut Option<Box<dyn Signal>> {
@@ -218,24 +222,4 @@ impl Queues {
         let idx = (signum.as_u8() - MIN_RT_SIG_NUM) as usize;
         &mut self.rt_queues[idx]
     }
-
-    fn sig_pending(&self) -> SigSet {
-        let mut pending = SigSet::new_empty();
-
-        // Process standard signal queues
-        for (idx, signal) in self.std_queues.iter().enumerate() {
-            if signal.is_some() {
-                pending += SigNum::from_u8(idx as u8 + MIN_STD_SIG_NUM);
-            }
-        }
-
-        // Process real-time signal queues
-        for (idx, signals) in self.rt_queues.iter().enumerate() {
-            if !signals.is_empty() {
-                pending += SigNum::from_u8(idx as u8 + MIN_RT_SIG_NUM);
-            }
-        }
-
-        pending
-    }
 }
@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! The export of the samples of the in-kernel sampling profiler.
+//!
+//! If the kernel command line contains `profile.freq=<Hz>`, the CPUs are
+//! sampled at the frequency since boot, and a kernel thread exports the
+//! samples over the virtio console every second, or over the serial console
+//! if there is no virtio console.
+//!
+//! The samples are aggregated by their CPUs and stacks before they are
+//! exported, one line for each distinct stack:
+//!
+//! ```text
+//! -<!OSDK_PROF_SAMPLE!>- <cpu> <count> <pc>,<return address>,...
+//! -<!OSDK_PROF_SAMPLE!>- <cpu> <count> user
+//! ```
+//!
+//! The addresses are in hexadecimal, from the innermost frame. The samples
+//! taken in the user mode are counted as `user`. `cargo osdk profile
+//! --kernel-samples <console log>` turns the lines into flame graphs.
+
+use core::{fmt::Write, time::Duration};
+
+use ostd::{boot::boot_info, profiler, sync::WaitQueue};
+
+use crate::{
+    kcmdline::{KCmdlineArg, ModuleArg},
+    prelude::*,
+    thread::kernel_thread::ThreadOptions,
+    WaitTimeout,
+};
+
+/// The marker of the lines of the samples.
+const SAMPLE_MARKER: &str = "-<!OSDK_PROF_SAMPLE!>-";
+
+/// The interval between two exports.
+const EXPORT_INTERVAL: Duration = Duration::from_secs(1);
+
+pub(super) fn init() {
+    let Some(freq) = profile_freq() else {
+        return;
+    };
+
+    if let Err(err) = profiler::start(freq) {
+        log::warn!("[kernel] failed to start the profiler: {:?}", err);
+        return;
+    }
+    println!("[kernel] Profiling at {} Hz", freq);
+
+    ThreadOptions::new(export_samples_loop).spawn();
+}
+
+/// Returns the sampling frequency in the `profile.freq` option on the kernel command line.
+fn profile_freq() -> Option<u64> {
+    let karg: KCmdlineArg = boot_info().kernel_cmdline.as_str().into();
+    let args = karg.get_module_args("profile")?;
+
+    args.iter().find_map(|arg| {
+        let ModuleArg::KeyVal(key, value) = arg else {
+            return None;
+        };
+        if key.as_bytes() != b"freq" {
+            return None;
+        }
+        let freq = value.to_str().ok().and_then(|value| value.parse().ok());
+        if freq.is_none() {
+            log::warn!("[kernel] invalid profile.freq: {:?}", value);
+        }
+        freq
+    })
+}
+
+fn export_samples_loop() {
+    let wait_queue = WaitQueue::new();
+    let console = aster_console::all_devices()
+        .into_iter()
+        .find(|(name, _)| name == aster_virtio::device::console::DEVICE_NAME)
+        .map(|(_, device)| device);
+
+    // The key is the CPU and the kernel stack, which is empty for the user samples.
+    let mut stacks: BTreeMap<(u32, Vec<Vaddr>), u64> = BTreeMap::new();
+    let mut nr_reported_dropped = 0;
+    loop {
+        let _ = wait_queue.wait_until_or_timeout(|| None::<()>, &EXPORT_INTERVAL);
+
+        profiler::drain(|cpu, sample| {
+            let key = (cpu.as_usize() as u32, sample.kernel_stack().to_vec());
+            *stacks.entry(key).or_default() += 1;
+        });
+        if stacks.is_empty() {
+            continue;
+        }
+
+        let mut output = String::new();
+        for ((cpu, stack), count) in stacks.iter() {
+            write!(output, "{} {} {} ", SAMPLE_MARKER, cpu, count).unwrap();
+            if stack.is_empty() {
+                output.push_str("user");
+            }
+            for (i, addr) in stack.iter().enumerate() {
+                let separator = if i == 0 { "" } else { "," };
+                write!(output, "{}{:x}", separator, addr).unwrap();
+            }
+            output.push('\n');
+        }
+        stacks.clear();
+
+        match &console {
+            Some(console) => console.send(output.as_bytes()),
+            None => ostd::early_print!("{}", output),
+        }
+
+        let nr_dropped = profiler::nr_dropped_samples();
+        if nr_dropped != nr_reported_dropped {
+            log::warn!("[kernel] {} profile samples dropped", nr_dropped);
+            nr_reported_dropped = nr_dropped;
+        }
+    }
+}
@@ -6,6 +6,9 @@ mod stats;
 
 pub use self::{
     nice::{AtomicNice, Nice},
-    sched_class::{init, RealTimePolicy, RealTimePriority, SchedAttr, SchedPolicy},
-    stats::{loadavg, nr_queued_and_running},
+    sched_class::{idle_loop, init, RealTimePolicy, RealTimePriority, SchedAttr, SchedPolicy},
+    stats::{
+        cpu_time, init_cpu_time_on_current_cpu, loadavg, nr_migrations, nr_queued_and_running,
+        CpuTime,
+    },
 };
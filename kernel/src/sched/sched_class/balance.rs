@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! Load balancing between the per-CPU run queues.
+//!
+//! Tasks are placed on a CPU by [`ClassScheduler::select_cpu`] when they are
+//! spawned and stick to that CPU afterwards. Without balancing, bursty
+//! workloads may leave some CPUs idle while others have long run queues.
+//!
+//! The balancer pulls FAIR tasks from the busiest run queue to the local one.
+//! It runs in two situations:
+//!  - _idle balancing_, whenever the local CPU has nothing to run;
+//!  - _periodic balancing_, every [`BALANCE_INTERVAL_JIFFIES`] on busy CPUs.
+//!
+//! The load of a run queue is measured by the sum of the weights (see
+//! [`nice_to_weight`]) of its FAIR tasks, including the running one. The loads
+//! are published in per-CPU atomics so that finding the busiest run queue
+//! does not require locking any remote run queue.
+//!
+//! Idle CPUs whose ticks are stopped do not notice the queued tasks on other
+//! CPUs. A busy CPU with queued tasks wakes one of them up at its periodic
+//! balancing, which then balances as an idle CPU.
+//!
+//! Currently, OSTD does not provide any information about the CPU topology,
+//! so all CPUs form a single balancing domain.
+//!
+//! [`nice_to_weight`]: super::fair::nice_to_weight
+
+use core::sync::atomic::{AtomicU32, AtomicU64, Ordering::Relaxed};
+
+use ostd::{
+    cpu::{all_cpus, CpuId},
+    smp::inter_processor_call,
+    task::{scheduler::info::CommonSchedInfo, Task},
+    timer::{self, Jiffies},
+};
+
+use super::{policy::SchedPolicyKind, ClassScheduler, PerCpuClassRqSet, SchedClassRq};
+use crate::thread::AsThread;
+
+/// The interval of periodic balancing, measured in jiffies.
+const BALANCE_INTERVAL_JIFFIES: u64 = 4;
+
+/// The maximum number of tasks to migrate in one balancing pass.
+const MAX_NR_MIGRATE: usize = 8;
+
+/// The published load of a per-CPU run queue.
+#[derive(Debug, Default)]
+pub(super) struct RqLoad {
+    /// The total weight of the FAIR tasks, including the running one.
+    weight: AtomicU64,
+    /// The number of queued (not running) FAIR tasks.
+    nr_fair_queued: AtomicU32,
+    /// The number of queued and running tasks of all classes except IDLE.
+    nr_busy: AtomicU32,
+}
+
+impl RqLoad {
+    /// Returns whether the CPU has nothing to run other than idle tasks.
+    pub(super) fn is_idle(&self) -> bool {
+        self.nr_busy.load(Relaxed) == 0
+    }
+
+    /// Returns whether the CPU runs one task and has no other tasks waiting.
+    pub(super) fn is_running_one(&self) -> bool {
+        self.nr_busy.load(Relaxed) == 1
+    }
+}
+
+impl PerCpuClassRqSet {
+    fn fair_load(&self) -> u64 {
+        let current_weight = match &self.current {
+            Some(((_, thread), _))
+                if thread.sched_attr().policy_kind() == SchedPolicyKind::Fair =>
+            {
+                thread.sched_attr().fair.weight()
+            }
+            _ => 0,
+        };
+        self.fair.queued_weight() + current_weight
+    }
+
+    /// Returns the number of queued and running tasks that are not IDLE tasks.
+    fn nr_busy(&self) -> u32 {
+        let current_is_busy = match &self.current {
+            Some(((_, thread), _)) => thread.sched_attr().policy_kind() != SchedPolicyKind::Idle,
+            None => false,
+        };
+        let queued = self.stop.len() + self.real_time.len() + self.fair.len();
+        (queued + usize::from(current_is_busy)) as u32
+    }
+
+    /// Returns whether the CPU has nothing to run other than idle tasks.
+    fn is_idle(&self) -> bool {
+        self.nr_busy() == 0
+    }
+}
+
+impl ClassScheduler {
+    /// Publishes the load of the run queue of `cpu` for the balancer.
+    pub(super) fn publish_load(&self, cpu: CpuId, rq: &PerCpuClassRqSet) {
+        let load = &self.loads[cpu.as_usize()];
+        load.weight.store(rq.fair_load(), Relaxed);
+        load.nr_fair_queued.store(rq.fair.len() as u32, Relaxed);
+        load.nr_busy.store(rq.nr_busy(), Relaxed);
+    }
+
+    /// Balances the load between the local run queue and the busiest one.
+    ///
+    /// The caller must hold the lock of the local run queue of `cpu`. The
+    /// remote run queue is only try-locked, so that the balancer never
+    /// deadlocks against balancers on other CPUs.
+    pub(super) fn balance(&self, cpu: CpuId, local: &mut PerCpuClassRqSet) {
+        let is_idle = local.is_idle();
+        if !is_idle {
+            let now = Jiffies::elapsed().as_u64();
+            if now < local.next_balance {
+                return;
+            }
+            local.next_balance = now + BALANCE_INTERVAL_JIFFIES;
+
+            if !local.fair.is_empty() {
+                kick_tick_stopped_cpu(cpu);
+            }
+        }
+
+        let local_load = local.fair_load();
+        let Some((busiest, busiest_load)) = self.find_busiest(cpu, local_load) else {
+            return;
+        };
+
+        // Move half of the difference, so that the two run queues end up with
+        // roughly the same load.
+        let imbalance = (busiest_load - local_load) / 2;
+        if imbalance == 0 && !is_idle {
+            return;
+        }
+
+        let Some(mut remote) = self.rqs[busiest.as_usize()].try_lock() else {
+            return;
+        };
+
+        let can_migrate = |task: &Task| {
+            task.as_thread()
+                .is_some_and(|thread| thread.atomic_cpu_affinity().contains(cpu, Relaxed))
+        };
+        // An idle CPU should always pull at least one task, even if the task
+        // is heavier than the imbalance, because any waiting task is better
+        // run here than waiting there.
+        let detached =
+            remote
+                .fair
+                .detach_migratable(imbalance, MAX_NR_MIGRATE, is_idle, can_migrate);
+        if detached.is_empty() {
+            return;
+        }
+
+        let nr_migrated = detached.len();
+        for (task, lag) in detached {
+            task.cpu().set_anyway(cpu);
+            task.as_thread().unwrap().sched_attr().set_last_cpu(cpu);
+            local.fair.attach_migrated(task, lag);
+        }
+
+        self.publish_load(busiest, &remote);
+        drop(remote);
+        self.publish_load(cpu, local);
+
+        self.nr_migrations.fetch_add(nr_migrated as u64, Relaxed);
+    }
+
+    /// Finds the run queue with the heaviest FAIR load that has queued tasks.
+    ///
+    /// Only run queues whose load exceeds `local_load` are considered.
+    fn find_busiest(&self, cpu: CpuId, local_load: u64) -> Option<(CpuId, u64)> {
+        let mut busiest = None;
+        let mut busiest_load = local_load;
+
+        for candidate in all_cpus() {
+            if candidate == cpu {
+                continue;
+            }
+
+            let load = &self.loads[candidate.as_usize()];
+            if load.nr_fair_queued.load(Relaxed) == 0 {
+                continue;
+            }
+
+            let weight = load.weight.load(Relaxed);
+            if weight > busiest_load {
+                busiest = Some(candidate);
+                busiest_load = weight;
+            }
+        }
+
+        busiest.map(|busiest| (busiest, busiest_load))
+    }
+}
+
+/// Wakes up an idle CPU whose tick is stopped, if any, to pull the queued
+/// tasks of `cpu`.
+fn kick_tick_stopped_cpu(cpu: CpuId) {
+    let Some(idle_cpu) = timer::tick_stopped_cpus()
+        .iter()
+        .find(|&idle_cpu| idle_cpu != cpu)
+    else {
+        return;
+    };
+
+    // The CPU balances in the idle loop right after the interrupt.
+    inter_processor_call(&idle_cpu.into(), || {});
+}
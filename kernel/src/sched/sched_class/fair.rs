@@ -1,6 +1,6 @@
 // SPDX-License-Identifier: MPL-2.0
 
-use alloc::{collections::BinaryHeap, sync::Arc};
+use alloc::{collections::BinaryHeap, sync::Arc, vec::Vec};
 use core::{
     cmp::{self, Reverse},
     sync::atomic::{AtomicU64, Ordering::Relaxed},
@@ -111,6 +111,10 @@ impl FairAttr {
         self.weight.store(nice_to_weight(nice), Relaxed);
     }
 
+    pub fn weight(&self) -> u64 {
+        self.weight.load(Relaxed)
+    }
+
     fn update_vruntime(&self, delta: u64) -> (u64, u64) {
         let weight = self.weight.load(Relaxed);
         let delta = delta * WEIGHT_0 / weight;
@@ -217,6 +221,68 @@ impl FairClassRq {
     fn time_slice(&self, cur_weight: u64) -> u64 {
         self.period() * cur_weight / (self.total_weight + cur_weight)
     }
+
+    /// Returns the total weight of the ready-to-run threads.
+    pub fn queued_weight(&self) -> u64 {
+        self.total_weight
+    }
+
+    /// Detaches ready-to-run threads so that they can be migrated to another CPU.
+    ///
+    /// Threads with the largest vruntimes are detached first, since they are
+    /// the last ones to run here and the least likely to be cache-hot. A thread
+    /// is only detached if `can_migrate` returns `true` for it and the total
+    /// detached weight stays within `max_weight`, except that the first thread
+    /// is detached regardless of its weight if `force_one` is set.
+    ///
+    /// Each detached thread is returned along with its vruntime lag relative to
+    /// `min_vruntime`, which should be passed to [`Self::attach_migrated`].
+    pub fn detach_migratable(
+        &mut self,
+        max_weight: u64,
+        max_nr: usize,
+        force_one: bool,
+        can_migrate: impl Fn(&Task) -> bool,
+    ) -> Vec<(Arc<Task>, u64)> {
+        let mut detached = Vec::new();
+        let mut detached_weight = 0;
+
+        let mut items = core::mem::take(&mut self.entities).into_vec();
+        items.sort_unstable_by_key(|Reverse(item)| Reverse(item.key()));
+        items.retain(|Reverse(FairQueueItem(entity, vruntime))| {
+            if detached.len() >= max_nr || !can_migrate(entity) {
+                return true;
+            }
+
+            let weight = entity.as_thread().unwrap().sched_attr().fair.weight();
+            let within_budget = detached_weight + weight <= max_weight;
+            if !within_budget && !(force_one && detached.is_empty()) {
+                return true;
+            }
+
+            detached_weight += weight;
+            detached.push((entity.clone(), vruntime.saturating_sub(self.min_vruntime)));
+            false
+        });
+
+        self.entities = BinaryHeap::from(items);
+        self.total_weight -= detached_weight;
+
+        detached
+    }
+
+    /// Attaches a thread detached from another CPU by [`Self::detach_migratable`].
+    ///
+    /// The vruntime of the thread is rebased on the local `min_vruntime` so
+    /// that it neither starves nor monopolizes the CPU after migration.
+    pub fn attach_migrated(&mut self, entity: Arc<Task>, lag: u64) {
+        let fair_attr = &entity.as_thread().unwrap().sched_attr().fair;
+        let vruntime = self.min_vruntime + lag;
+        fair_attr.vruntime.store(vruntime, Relaxed);
+
+        self.total_weight += fair_attr.weight();
+        self.entities.push(Reverse(FairQueueItem(entity, vruntime)));
+    }
 }
 
 impl SchedClassRq for FairClassRq {
@@ -252,6 +318,19 @@ impl SchedClassRq for FairClassRq {
         Some(entity)
     }
 
+    fn remove(&mut self, task: &Arc<Task>) -> bool {
+        let len = self.entities.len();
+        self.entities
+            .retain(|Reverse(FairQueueItem(entity, _))| !Arc::ptr_eq(entity, task));
+        if self.entities.len() == len {
+            return false;
+        }
+
+        let sched_attr = task.as_thread().unwrap().sched_attr();
+        self.total_weight -= sched_attr.fair.weight.load(Relaxed);
+        true
+    }
+
     fn update_current(
         &mut self,
         rt: &CurrentRuntime,
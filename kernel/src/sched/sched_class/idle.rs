@@ -2,12 +2,45 @@
 
 use alloc::sync::Arc;
 
-use ostd::task::{
-    scheduler::{EnqueueFlags, UpdateFlags},
-    Task,
+use ostd::{
+    arch::timer::TIMER_FREQ,
+    task::{
+        scheduler::{EnqueueFlags, UpdateFlags},
+        Task,
+    },
+    timer::{self, Jiffies},
 };
 
 use super::{CurrentRuntime, SchedAttr, SchedClassRq};
+use crate::{
+    sched::stats::account_idle_ticks, thread::Thread, time::clocks::ticks_until_next_timer,
+};
+
+/// The maximum number of ticks for which an idle CPU stops its tick.
+///
+/// Most of the work of an idle CPU is triggered by interrupts or armed as
+/// timers. This bounds the delay of the rest.
+const MAX_IDLE_TICKS: u64 = TIMER_FREQ;
+
+/// Runs the loop of the per-CPU idle thread.
+///
+/// The loop yields the CPU to any runnable task. If there is none, the CPU
+/// sleeps with its tick stopped until the earliest timer of the CPU expires or
+/// another interrupt arrives.
+pub fn idle_loop() -> ! {
+    loop {
+        Thread::yield_now();
+
+        let max_ticks =
+            ticks_until_next_timer().map_or(MAX_IDLE_TICKS, |ticks| ticks.min(MAX_IDLE_TICKS));
+        let start = Jiffies::elapsed().as_u64();
+        timer::sleep_without_tick(max_ticks);
+
+        // The tick that wakes up the CPU, if any, has been accounted.
+        let skipped = Jiffies::elapsed().as_u64().saturating_sub(start + 1);
+        account_idle_ticks(skipped);
+    }
+}
 
 /// The per-cpu run queue for the IDLE scheduling class.
 ///
@@ -54,6 +87,12 @@ impl SchedClassRq for IdleClassRq {
         self.entity.take()
     }
 
+    fn remove(&mut self, task: &Arc<Task>) -> bool {
+        self.entity
+            .take_if(|entity| Arc::ptr_eq(entity, task))
+            .is_some()
+    }
+
     fn update_current(&mut self, _: &CurrentRuntime, _: &SchedAttr, _flags: UpdateFlags) -> bool {
         // Idle entities has the greatest priority value. They should always be preempted.
         true
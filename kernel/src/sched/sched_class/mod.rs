@@ -2,12 +2,16 @@
 
 #![warn(unused)]
 
-use alloc::{boxed::Box, sync::Arc};
-use core::{fmt, sync::atomic::Ordering};
+use alloc::{boxed::Box, sync::Arc, vec::Vec};
+use core::{
+    fmt,
+    sync::atomic::{AtomicU64, Ordering},
+};
 
 use ostd::{
     arch::read_tsc as sched_clock,
-    cpu::{all_cpus, CpuId, PinCurrentCpu},
+    cpu::{all_cpus, CpuId, CpuSet, PinCurrentCpu},
+    mm::numa,
     sync::SpinLock,
     task::{
         scheduler::{
@@ -25,8 +29,10 @@ use super::{
 };
 use crate::thread::{AsThread, Thread};
 
+mod balance;
 mod policy;
 mod time;
+mod wake_affine;
 
 mod fair;
 mod idle;
@@ -35,6 +41,7 @@ mod stop;
 
 use self::policy::{SchedPolicyKind, SchedPolicyState};
 pub use self::{
+    idle::idle_loop,
     policy::SchedPolicy,
     real_time::{RealTimePolicy, RealTimePriority},
 };
@@ -58,7 +65,9 @@ pub fn init() {
 /// information may also be stored here.
 pub struct ClassScheduler {
     rqs: Box<[SpinLock<PerCpuClassRqSet>]>,
+    loads: Box<[balance::RqLoad]>,
     last_chosen_cpu: AtomicCpuId,
+    nr_migrations: AtomicU64,
 }
 
 /// Represents the run queue for each CPU core. It stores a list of run queues for
@@ -70,6 +79,8 @@ struct PerCpuClassRqSet {
     fair: fair::FairClassRq,
     idle: idle::IdleClassRq,
     current: Option<(SchedEntity, CurrentRuntime)>,
+    /// The next time to do periodic load balancing, measured in jiffies.
+    next_balance: u64,
 }
 
 /// Stores the runtime information of the current task.
@@ -118,6 +129,9 @@ trait SchedClassRq: Send + fmt::Debug {
     /// Picks the next task for running.
     fn pick_next(&mut self) -> Option<Arc<Task>>;
 
+    /// Removes a task from the run queue. Returns whether the task is found.
+    fn remove(&mut self, task: &Arc<Task>) -> bool;
+
     /// Update the information of the current task.
     fn update_current(&mut self, rt: &CurrentRuntime, attr: &SchedAttr, flags: UpdateFlags)
         -> bool;
@@ -131,6 +145,8 @@ trait SchedClassRq: Send + fmt::Debug {
 pub struct SchedAttr {
     policy: SchedPolicyState,
     last_cpu: AtomicCpuId,
+    /// The sched clock when the thread was last descheduled to sleep.
+    last_run: AtomicU64,
     real_time: real_time::RealTimeAttr,
     fair: fair::FairAttr,
 }
@@ -141,6 +157,7 @@ impl SchedAttr {
         Self {
             policy: SchedPolicyState::new(policy),
             last_cpu: AtomicCpuId::default(),
+            last_run: AtomicU64::new(0),
             real_time: {
                 let (prio, policy) = match policy {
                     SchedPolicy::RealTime { rt_prio, rt_policy } => (rt_prio.get(), rt_policy),
@@ -160,6 +177,12 @@ impl SchedAttr {
         self.policy.get()
     }
 
+    /// Retrieves the scheduling policy that is in effect, taking priority
+    /// inheritance into account.
+    pub fn effective_policy(&self) -> SchedPolicy {
+        self.policy.get_effective()
+    }
+
     fn policy_kind(&self) -> SchedPolicyKind {
         self.policy.kind()
     }
@@ -169,13 +192,32 @@ impl SchedAttr {
     /// Specifically for real-time policies, if the new policy doesn't
     /// specify a base slice factor for RR, the old one will be kept.
     pub fn set_policy(&self, policy: SchedPolicy) {
-        self.policy.set(policy, |policy| match policy {
+        self.policy.set(policy, |policy| self.apply_policy(policy));
+    }
+
+    /// Boosts the thread to the policy inherited from the waiters of
+    /// priority-inheritance locks, or removes the boost if `boost` is `None`.
+    ///
+    /// As in Linux, only real-time policies are inherited; other boosts are
+    /// ignored. Returns whether the effective policy changes, in which case
+    /// the caller should requeue the task of the thread with
+    /// [`requeue_target`] so that a runnable thread moves to the run queue of
+    /// its new scheduling class immediately.
+    ///
+    /// [`requeue_target`]: ostd::task::scheduler::requeue_target
+    pub fn set_pi_boost(&self, boost: Option<SchedPolicy>) -> bool {
+        self.policy
+            .set_boost(boost, |policy| self.apply_policy(policy))
+    }
+
+    fn apply_policy(&self, policy: SchedPolicy) {
+        match policy {
             SchedPolicy::RealTime { rt_prio, rt_policy } => {
                 self.real_time.update(rt_prio.get(), rt_policy);
             }
             SchedPolicy::Fair(nice) => self.fair.update(nice),
             _ => {}
-        });
+        }
     }
 
     pub fn update_policy<T>(&self, f: impl FnOnce(&mut SchedPolicy) -> T) -> T {
@@ -189,48 +231,83 @@ impl SchedAttr {
     fn set_last_cpu(&self, cpu_id: CpuId) {
         self.last_cpu.set_anyway(cpu_id);
     }
+
+    fn last_run(&self) -> u64 {
+        self.last_run.load(Ordering::Relaxed)
+    }
+
+    fn set_last_run(&self, clock: u64) {
+        self.last_run.store(clock, Ordering::Relaxed);
+    }
 }
 
 impl Scheduler for ClassScheduler {
     fn enqueue(&self, task: Arc<Task>, flags: EnqueueFlags) -> Option<CpuId> {
         let thread = task.as_thread()?.clone();
-
-        let (still_in_rq, cpu) = {
-            let selected_cpu_id = self.select_cpu(&thread, flags);
-
-            if let Err(task_cpu_id) = task.cpu().set_if_is_none(selected_cpu_id) {
-                debug_assert!(flags != EnqueueFlags::Spawn);
-                (true, task_cpu_id)
-            } else {
-                (false, selected_cpu_id)
-            }
-        };
+        let (still_in_rq, cpu) = self.target_cpu(&task, &thread, flags);
 
         let mut rq = self.rqs[cpu.as_usize()].disable_irq().lock();
+        let should_preempt = rq.enqueue_to(cpu, (task, thread), still_in_rq, flags)?;
+        self.publish_load(cpu, &rq);
 
-        // Note: call set_if_is_none again to prevent a race condition.
-        if still_in_rq && task.cpu().set_if_is_none(cpu).is_err() {
-            return None;
+        should_preempt.then_some(cpu)
+    }
+
+    fn enqueue_batch(
+        &self,
+        runnables: &mut dyn Iterator<Item = Arc<Task>>,
+        flags: EnqueueFlags,
+        preempt_cpus: &mut CpuSet,
+    ) {
+        let mut targets: Vec<_> = runnables
+            .filter_map(|task| {
+                let thread = task.as_thread()?.clone();
+                let (still_in_rq, cpu) = self.target_cpu(&task, &thread, flags);
+                Some((cpu, still_in_rq, (task, thread)))
+            })
+            .collect();
+        // Group the tasks by CPU so that each runqueue is locked only once.
+        targets.sort_unstable_by_key(|(cpu, _, _)| cpu.as_usize());
+
+        let mut targets = targets.into_iter().peekable();
+        while let Some(&(cpu, _, _)) = targets.peek() {
+            let mut rq = self.rqs[cpu.as_usize()].disable_irq().lock();
+            while let Some((_, still_in_rq, entity)) = targets.next_if(|(c, _, _)| *c == cpu) {
+                if rq.enqueue_to(cpu, entity, still_in_rq, flags) == Some(true) {
+                    preempt_cpus.add(cpu);
+                }
+            }
+            self.publish_load(cpu, &rq);
         }
+    }
 
-        // Preempt if the new task has a higher priority.
-        let should_preempt = rq
-            .current
-            .as_ref()
-            .is_none_or(|((_, rq_current_thread), _)| {
-                thread.sched_attr().policy() < rq_current_thread.sched_attr().policy()
-            });
+    fn requeue(&self, task: &Arc<Task>) -> Option<CpuId> {
+        let thread = task.as_thread()?;
 
-        thread.sched_attr().set_last_cpu(cpu);
-        rq.enqueue_entity((task, thread), Some(flags));
+        loop {
+            // A task without a CPU is sleeping. Its new policy is read when it is enqueued, which
+            // happens under the policy lock after `task.cpu()` is set (see `enqueue_to`).
+            let cpu = task.cpu().get()?;
 
-        should_preempt.then_some(cpu)
+            let mut rq = self.rqs[cpu.as_usize()].disable_irq().lock();
+            // The task may be migrated or dequeued before the runqueue is locked.
+            if task.cpu().get() != Some(cpu) {
+                continue;
+            }
+            let should_preempt = rq.requeue_entity(task, thread);
+            self.publish_load(cpu, &rq);
+
+            return should_preempt.then_some(cpu);
+        }
     }
 
     fn local_mut_rq_with(&self, f: &mut dyn FnMut(&mut dyn LocalRunQueue)) {
         let guard = disable_local();
-        let mut lock = self.rqs[guard.current_cpu().as_usize()].lock();
-        f(&mut *lock)
+        let cpu = guard.current_cpu();
+        let mut lock = self.rqs[cpu.as_usize()].lock();
+        self.balance(cpu, &mut lock);
+        f(&mut *lock);
+        self.publish_load(cpu, &lock);
     }
 
     fn local_rq_with(&self, f: &mut dyn FnMut(&dyn LocalRunQueue)) {
@@ -248,24 +325,53 @@ impl ClassScheduler {
                 fair: fair::FairClassRq::new(cpu),
                 idle: idle::IdleClassRq::new(),
                 current: None,
+                next_balance: 0,
             })
         };
         ClassScheduler {
             rqs: all_cpus().map(class_rq).collect(),
+            loads: all_cpus().map(|_| balance::RqLoad::default()).collect(),
             last_chosen_cpu: AtomicCpuId::default(),
+            nr_migrations: AtomicU64::new(0),
         }
     }
 
-    // TODO: Implement a better algorithm and replace the current naive implementation.
-    fn select_cpu(&self, thread: &Thread, flags: EnqueueFlags) -> CpuId {
-        if let Some(last_cpu) = thread.sched_attr().last_cpu() {
-            return last_cpu;
+    /// Selects the CPU to enqueue the task to.
+    ///
+    /// The returned boolean is true if the task is still in the runqueue of the returned CPU.
+    fn target_cpu(&self, task: &Task, thread: &Thread, flags: EnqueueFlags) -> (bool, CpuId) {
+        let selected_cpu_id = self.select_cpu(thread, flags);
+
+        if let Err(task_cpu_id) = task.cpu().set_if_is_none(selected_cpu_id) {
+            debug_assert!(flags != EnqueueFlags::Spawn);
+            (true, task_cpu_id)
+        } else {
+            (false, selected_cpu_id)
         }
-        debug_assert!(flags == EnqueueFlags::Spawn);
+    }
+
+    fn select_cpu(&self, thread: &Thread, flags: EnqueueFlags) -> CpuId {
         let guard = disable_local();
         let affinity = thread.atomic_cpu_affinity().load(Ordering::Relaxed);
+
+        if let Some(last_cpu) = thread
+            .sched_attr()
+            .last_cpu()
+            .filter(|&cpu| affinity.contains(cpu))
+        {
+            return match flags {
+                EnqueueFlags::Wake => {
+                    self.select_wake_cpu(thread, last_cpu, guard.current_cpu(), &affinity)
+                }
+                EnqueueFlags::Spawn => last_cpu,
+            };
+        }
+
+        // TODO: Implement a better algorithm for newly spawned tasks and
+        // replace the current naive implementation.
         let mut selected = guard.current_cpu();
-        let mut minimum_load = u32::MAX;
+        let mut minimum_load = (u32::MAX, true);
+        let current_node = numa::node_of_cpu(selected);
         let last_chosen = match self.last_chosen_cpu.get() {
             Some(cpu) => cpu.as_usize() as isize,
             None => -1,
@@ -285,7 +391,10 @@ impl ClassScheduler {
             );
         for candidate in affinity_iter {
             let rq = self.rqs[candidate.as_usize()].lock();
-            let (load, _) = rq.nr_queued_and_running();
+            let (nr_queued, _) = rq.nr_queued_and_running();
+            // Among equally loaded CPUs, prefer the ones on the current NUMA
+            // node, where the memory of the parent is.
+            let load = (nr_queued, numa::node_of_cpu(candidate) != current_node);
             if load < minimum_load {
                 minimum_load = load;
                 selected = candidate;
@@ -308,8 +417,79 @@ impl PerCpuClassRqSet {
             })
     }
 
+    /// Enqueues the entity to this runqueue, which belongs to `cpu`.
+    ///
+    /// This method returns whether the current task of the CPU should be preempted, or `None` if
+    /// the task is already in the runqueue.
+    fn enqueue_to(
+        &mut self,
+        cpu: CpuId,
+        (task, thread): SchedEntity,
+        still_in_rq: bool,
+        flags: EnqueueFlags,
+    ) -> Option<bool> {
+        // Note: call set_if_is_none again to prevent a race condition.
+        if still_in_rq && task.cpu().set_if_is_none(cpu).is_err() {
+            return None;
+        }
+
+        // The policy is read under the policy lock. So either a concurrent requeue finds the task
+        // in this runqueue, or the policy that it has set is seen here.
+        let policy = thread.sched_attr().effective_policy();
+
+        // Preempt if the new task has a higher priority.
+        let should_preempt = self.should_preempt_for(policy);
+
+        thread.sched_attr().set_last_cpu(cpu);
+        self.enqueue_entity_as(policy.kind(), task, Some(flags));
+
+        Some(should_preempt)
+    }
+
+    /// Moves the entity to the run queue of its current scheduling class.
+    ///
+    /// This method returns whether the current task of the CPU should be preempted.
+    fn requeue_entity(&mut self, task: &Arc<Task>, thread: &Arc<Thread>) -> bool {
+        if (self.current.as_ref()).is_some_and(|((current, _), _)| Arc::ptr_eq(current, task)) {
+            // Let the CPU compare the running task with the queued ones again.
+            return true;
+        }
+
+        let is_queued = self.stop.remove(task)
+            || self.real_time.remove(task)
+            || self.fair.remove(task)
+            || self.idle.remove(task);
+        if !is_queued {
+            // The task is being enqueued to this runqueue with its new policy.
+            return false;
+        }
+
+        let policy = thread.sched_attr().effective_policy();
+        let should_preempt = self.should_preempt_for(policy);
+        self.enqueue_entity_as(policy.kind(), task.clone(), None);
+
+        should_preempt
+    }
+
+    fn should_preempt_for(&self, policy: SchedPolicy) -> bool {
+        self.current
+            .as_ref()
+            .is_none_or(|((_, rq_current_thread), _)| {
+                policy < rq_current_thread.sched_attr().effective_policy()
+            })
+    }
+
     fn enqueue_entity(&mut self, (task, thread): SchedEntity, flags: Option<EnqueueFlags>) {
-        match thread.sched_attr().policy_kind() {
+        self.enqueue_entity_as(thread.sched_attr().policy_kind(), task, flags);
+    }
+
+    fn enqueue_entity_as(
+        &mut self,
+        kind: SchedPolicyKind,
+        task: Arc<Task>,
+        flags: Option<EnqueueFlags>,
+    ) {
+        match kind {
             SchedPolicyKind::Stop => self.stop.enqueue(task, flags),
             SchedPolicyKind::RealTime => self.real_time.enqueue(task, flags),
             SchedPolicyKind::Fair => self.fair.enqueue(task, flags),
@@ -362,7 +542,8 @@ impl LocalRunQueue for PerCpuClassRqSet {
     }
 
     fn dequeue_current(&mut self) -> Option<Arc<Task>> {
-        self.current.take().map(|((cur_task, _), _)| {
+        self.current.take().map(|((cur_task, cur_thread), _)| {
+            cur_thread.sched_attr().set_last_run(sched_clock());
             cur_task.schedule_info().cpu.set_to_none();
             cur_task
         })
@@ -376,6 +557,10 @@ impl SchedulerStats for ClassScheduler {
             (queued + q, running + r)
         })
     }
+
+    fn nr_migrations(&self) -> u64 {
+        self.nr_migrations.load(Ordering::Relaxed)
+    }
 }
 
 impl Default for ClassScheduler {
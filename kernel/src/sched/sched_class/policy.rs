@@ -57,14 +57,39 @@ impl From<SchedPolicyKind> for u8 {
 #[derive(Debug)]
 pub(super) struct SchedPolicyState {
     kind: AtomicSchedPolicyKind,
-    policy: SpinLock<SchedPolicy>,
+    policy: SpinLock<Policies>,
+}
+
+/// The policies of a thread.
+#[derive(Debug, Clone, Copy)]
+struct Policies {
+    /// The policy chosen by the user.
+    base: SchedPolicy,
+    /// The policy inherited from the waiters of priority-inheritance locks.
+    boost: Option<SchedPolicy>,
+}
+
+impl Policies {
+    /// Returns the policy that the scheduler actually uses.
+    ///
+    /// A smaller policy has a higher priority, so the boost takes effect only
+    /// if it is more urgent than the base policy.
+    fn effective(&self) -> SchedPolicy {
+        match self.boost {
+            Some(boost) => boost.min(self.base),
+            None => self.base,
+        }
+    }
 }
 
 impl SchedPolicyState {
     pub fn new(policy: SchedPolicy) -> Self {
         Self {
             kind: AtomicSchedPolicyKind::new(policy.kind()),
-            policy: SpinLock::new(policy),
+            policy: SpinLock::new(Policies {
+                base: policy,
+                boost: None,
+            }),
         }
     }
 
@@ -73,7 +98,11 @@ impl SchedPolicyState {
     }
 
     pub fn get(&self) -> SchedPolicy {
-        *self.policy.disable_irq().lock()
+        self.policy.disable_irq().lock().base
+    }
+
+    pub fn get_effective(&self) -> SchedPolicy {
+        self.policy.disable_irq().lock().effective()
     }
 
     pub fn set(&self, mut policy: SchedPolicy, update: impl FnOnce(SchedPolicy)) {
@@ -92,17 +121,75 @@ impl SchedPolicyState {
                 rt_policy: RealTimePolicy::RoundRobin { base_slice_factor },
                 ..
             },
-        ) = (*this, &mut policy)
+        ) = (this.base, &mut policy)
         {
             *base_slice_factor = slot.or(*base_slice_factor);
         }
 
-        update(policy);
-        self.kind.store(policy.kind(), Relaxed);
-        *this = policy;
+        this.base = policy;
+        let effective = this.effective();
+        update(effective);
+        self.kind.store(effective.kind(), Relaxed);
+    }
+
+    /// Sets the boosted policy and returns whether the effective policy changes.
+    ///
+    /// Only real-time policies are inherited, as in Linux. Inheriting a FAIR
+    /// policy would change the weight of a thread that may be in a FAIR run
+    /// queue, whose total weight would then be corrupted.
+    pub fn set_boost(&self, boost: Option<SchedPolicy>, update: impl FnOnce(SchedPolicy)) -> bool {
+        let boost = boost.filter(|policy| policy.kind() == SchedPolicyKind::RealTime);
+        let mut this = self.policy.disable_irq().lock();
+
+        let old_effective = this.effective();
+        this.boost = boost;
+        let effective = this.effective();
+        if effective == old_effective {
+            return false;
+        }
+
+        update(effective);
+        self.kind.store(effective.kind(), Relaxed);
+        true
     }
 
     pub fn update<T>(&self, update: impl FnOnce(&mut SchedPolicy) -> T) -> T {
-        update(&mut *self.policy.disable_irq().lock())
+        update(&mut self.policy.disable_irq().lock().base)
+    }
+}
+
+#[cfg(ktest)]
+mod test {
+    use ostd::prelude::*;
+
+    use super::*;
+
+    #[ktest]
+    fn pi_boost_takes_the_more_urgent_policy() {
+        let rt_policy = SchedPolicy::RealTime {
+            rt_prio: RealTimePriority::new(10),
+            rt_policy: RealTimePolicy::Fifo,
+        };
+        let state = SchedPolicyState::new(SchedPolicy::Fair(Nice::default()));
+
+        assert!(state.set_boost(Some(rt_policy), |_| {}));
+        assert_eq!(state.kind(), SchedPolicyKind::RealTime);
+        assert_eq!(state.get(), SchedPolicy::Fair(Nice::default()));
+        assert_eq!(state.get_effective(), rt_policy);
+
+        // A less urgent boost does not take effect.
+        assert!(state.set_boost(Some(SchedPolicy::Idle), |_| {}));
+        assert_eq!(state.kind(), SchedPolicyKind::Fair);
+        assert!(!state.set_boost(None, |_| {}));
+        assert_eq!(state.get_effective(), SchedPolicy::Fair(Nice::default()));
+    }
+
+    #[ktest]
+    fn pi_boost_ignores_fair_policies() {
+        let state = SchedPolicyState::new(SchedPolicy::Fair(Nice::default()));
+        let urgent_fair = SchedPolicy::Fair(Nice::MIN);
+
+        assert!(!state.set_boost(Some(urgent_fair), |_| panic!("the weight changes")));
+        assert_eq!(state.get_effective(), SchedPolicy::Fair(Nice::default()));
     }
 }
@@ -128,6 +128,22 @@ impl PrioArray {
         }
         Some(thread)
     }
+
+    fn remove(&mut self, thread: &Arc<Task>) -> bool {
+        let Some((prio, pos)) = self.map.iter_ones().find_map(|prio| {
+            let pos = (self.queue[prio].iter()).position(|queued| Arc::ptr_eq(queued, thread))?;
+            Some((prio, pos))
+        }) else {
+            return false;
+        };
+
+        let queue = &mut self.queue[prio];
+        queue.remove(pos);
+        if queue.is_empty() {
+            self.map.set(prio, false);
+        }
+        true
+    }
 }
 
 /// The per-cpu run queue for the REAL-TIME scheduling class.
@@ -205,6 +221,14 @@ impl SchedClassRq for RealTimeClassRq {
             .inspect(|_| self.nr_running -= 1)
     }
 
+    fn remove(&mut self, task: &Arc<Task>) -> bool {
+        let is_removed = self.array.iter_mut().any(|array| array.remove(task));
+        if is_removed {
+            self.nr_running -= 1;
+        }
+        is_removed
+    }
+
     fn update_current(
         &mut self,
         rt: &CurrentRuntime,
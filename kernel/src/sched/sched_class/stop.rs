@@ -55,6 +55,12 @@ impl SchedClassRq for StopClassRq {
         self.entity.take()
     }
 
+    fn remove(&mut self, task: &Arc<Task>) -> bool {
+        self.entity
+            .take_if(|entity| Arc::ptr_eq(entity, task))
+            .is_some()
+    }
+
     fn update_current(&mut self, _: &CurrentRuntime, _: &SchedAttr, _flags: UpdateFlags) -> bool {
         // Stop entities has the lowest priority value. They should never be preempted.
         false
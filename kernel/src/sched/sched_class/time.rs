@@ -34,11 +34,19 @@ pub const BASE_SLICE_NS: u64 = 750_000;
 /// The minimum scheduling period, measured in nanoseconds.
 pub const MIN_PERIOD_NS: u64 = 6_000_000;
 
-fn consts() -> (u64, u64) {
-    static CONSTS: Once<(u64, u64)> = Once::new();
+/// The time within which a descheduled thread is considered cache-hot on its
+/// last CPU, measured in nanoseconds.
+pub const MIGRATION_COST_NS: u64 = 500_000;
+
+fn consts() -> (u64, u64, u64) {
+    static CONSTS: Once<(u64, u64, u64)> = Once::new();
     *CONSTS.call_once(|| {
         let (a, b) = tsc_factors();
-        (BASE_SLICE_NS * b / a, MIN_PERIOD_NS * b / a)
+        (
+            BASE_SLICE_NS * b / a,
+            MIN_PERIOD_NS * b / a,
+            MIGRATION_COST_NS * b / a,
+        )
     })
 }
 
@@ -51,3 +59,9 @@ pub fn base_slice_clocks() -> u64 {
 pub fn min_period_clocks() -> u64 {
     consts().1
 }
+
+/// Returns the time within which a descheduled thread is considered cache-hot,
+/// measured in TSC clock units.
+pub fn migration_cost_clocks() -> u64 {
+    consts().2
+}
@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! CPU selection for woken tasks.
+//!
+//! A woken task is usually best run on the CPU it last ran on, where its
+//! working set may still be in the cache. However, when a task wakes up
+//! another one and is about to sleep (e.g., the two ends of a pipe or a UNIX
+//! socket doing request-response), running the wakee on the waker's CPU
+//! avoids both an IPI and bouncing the shared data between caches.
+//!
+//! How long a task's cache footprint lasts is approximated by the time since
+//! it was descheduled: within [`migration_cost_clocks`] it is considered
+//! cache-hot on its last CPU, and the hotness decays to nothing afterwards.
+//!
+//! [`migration_cost_clocks`]: super::time::migration_cost_clocks
+
+use ostd::{
+    arch::read_tsc as sched_clock,
+    cpu::{CpuId, CpuSet},
+    mm::numa,
+};
+
+use super::{time::migration_cost_clocks, ClassScheduler};
+use crate::thread::Thread;
+
+impl ClassScheduler {
+    /// Selects the CPU for `thread` that is woken by a task running on `waker_cpu`.
+    ///
+    /// `prev_cpu` is the CPU that `thread` last ran on. Both `prev_cpu` and
+    /// the returned CPU are in `affinity`.
+    pub(super) fn select_wake_cpu(
+        &self,
+        thread: &Thread,
+        prev_cpu: CpuId,
+        waker_cpu: CpuId,
+        affinity: &CpuSet,
+    ) -> CpuId {
+        if prev_cpu == waker_cpu {
+            return prev_cpu;
+        }
+
+        let prev_load = &self.loads[prev_cpu.as_usize()];
+        let is_cache_hot =
+            sched_clock().saturating_sub(thread.sched_attr().last_run()) < migration_cost_clocks();
+
+        // The previous CPU is free and still holds the working set.
+        if prev_load.is_idle() && is_cache_hot {
+            return prev_cpu;
+        }
+
+        // The waker is the only task on its CPU and is likely to sleep soon,
+        // so pull the wakee next to it.
+        if affinity.contains(waker_cpu) && self.loads[waker_cpu.as_usize()].is_running_one() {
+            return waker_cpu;
+        }
+
+        if prev_load.is_idle() {
+            return prev_cpu;
+        }
+
+        // Find any idle CPU, starting after the previous CPU to spread wakees.
+        // The CPUs on the node of the previous CPU are tried first, since the
+        // memory of the task is likely allocated on that node.
+        let prev_node = numa::node_of_cpu(prev_cpu);
+        let idle_cpus = || {
+            affinity
+                .iter()
+                .filter(|cpu| cpu.as_usize() > prev_cpu.as_usize())
+                .chain(
+                    affinity
+                        .iter()
+                        .filter(|cpu| cpu.as_usize() < prev_cpu.as_usize()),
+                )
+                .filter(|cpu| self.loads[cpu.as_usize()].is_idle())
+        };
+        let idle_cpu = idle_cpus()
+            .find(|cpu| numa::node_of_cpu(*cpu) == prev_node)
+            .or_else(|| idle_cpus().next());
+        if let Some(idle_cpu) = idle_cpu {
+            return idle_cpu;
+        }
+
+        prev_cpu
+    }
+}
@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! This module accounts the time that each CPU spends in user mode, in kernel
+//! mode and being idle, which is reported in `/proc/stat`.
+//!
+//! The time is sampled at the timer interrupts: each tick is charged to the
+//! state in which the CPU is interrupted. The ticks that an idle CPU skips
+//! while its tick is stopped are charged as idle by the idle loop.
+
+use ostd::{arch::trap::is_kernel_interrupted, cpu::CpuId, cpu_local_cell, timer};
+
+use crate::{sched::SchedPolicy, thread::Thread};
+
+cpu_local_cell! {
+    static USER_TICKS: u64 = 0;
+    static SYSTEM_TICKS: u64 = 0;
+    static IDLE_TICKS: u64 = 0;
+}
+
+/// The time that a CPU has spent since boot, in timer ticks.
+#[derive(Clone, Copy, Debug, Default)]
+pub struct CpuTime {
+    /// The time spent in user mode.
+    pub user: u64,
+    /// The time spent in kernel mode, except for the idle threads.
+    pub system: u64,
+    /// The time spent by the idle threads.
+    pub idle: u64,
+}
+
+/// Returns the time that the CPU has spent since boot.
+pub fn cpu_time(cpu_id: CpuId) -> CpuTime {
+    CpuTime {
+        user: USER_TICKS.load_on_cpu(cpu_id),
+        system: SYSTEM_TICKS.load_on_cpu(cpu_id),
+        idle: IDLE_TICKS.load_on_cpu(cpu_id),
+    }
+}
+
+/// Starts accounting the time of the current CPU.
+///
+/// The timer callbacks are per-CPU, so this function should be called once on
+/// each CPU.
+pub fn init_cpu_time_on_current_cpu() {
+    timer::register_callback(account_tick);
+}
+
+fn account_tick() {
+    if !is_kernel_interrupted() {
+        USER_TICKS.add_assign(1);
+        return;
+    }
+
+    let is_idle = Thread::current()
+        .is_some_and(|thread| matches!(thread.sched_attr().policy(), SchedPolicy::Idle));
+    if is_idle {
+        IDLE_TICKS.add_assign(1);
+    } else {
+        SYSTEM_TICKS.add_assign(1);
+    }
+}
+
+/// Charges the ticks that the current CPU has skipped while being idle.
+pub(in crate::sched) fn account_idle_ticks(ticks: u64) {
+    IDLE_TICKS.add_assign(ticks);
+}
@@ -1,6 +1,11 @@
 // SPDX-License-Identifier: MPL-2.0
 
+mod cpu_time;
 pub mod loadavg;
 mod scheduler_stats;
 
-pub use scheduler_stats::{nr_queued_and_running, set_stats_from_scheduler, SchedulerStats};
+pub(super) use cpu_time::account_idle_ticks;
+pub use cpu_time::{cpu_time, init_cpu_time_on_current_cpu, CpuTime};
+pub use scheduler_stats::{
+    nr_migrations, nr_queued_and_running, set_stats_from_scheduler, SchedulerStats,
+};
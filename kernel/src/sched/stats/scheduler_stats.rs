@@ -29,9 +29,17 @@ pub trait SchedulerStats: Sync + Send {
     /// We decided to return a tuple instead of having two separate functions to
     /// avoid the overhead of disabling the preemption twice to inspect the scheduler.
     fn nr_queued_and_running(&self) -> (u32, u32);
+
+    /// Returns the number of tasks migrated between CPUs by load balancing.
+    fn nr_migrations(&self) -> u64;
 }
 
 /// Get the amount of tasks in the runqueues and the amount of running tasks.
 pub fn nr_queued_and_running() -> (u32, u32) {
     SCHEDULER_STATS.get().unwrap().nr_queued_and_running()
 }
+
+/// Get the number of tasks migrated between CPUs by load balancing.
+pub fn nr_migrations() -> u64 {
+    SCHEDULER_STATS.get().unwrap().nr_migrations()
+}
@@ -11,21 +11,24 @@ use crate::syscall::{
     chmod::{sys_fchmod, sys_fchmodat},
     chown::{sys_fchown, sys_fchownat},
     chroot::sys_chroot,
+    clock_getres::sys_clock_getres,
     clock_gettime::sys_clock_gettime,
     clone::{sys_clone, sys_clone3},
     close::sys_close,
     connect::sys_connect,
+    copy_file_range::sys_copy_file_range,
     dup::{sys_dup, sys_dup3},
     epoll::{sys_epoll_create1, sys_epoll_ctl, sys_epoll_pwait},
     eventfd::sys_eventfd2,
     execve::{sys_execve, sys_execveat},
     exit::sys_exit,
     exit_group::sys_exit_group,
+    fadvise64::sys_fadvise64,
     fallocate::sys_fallocate,
     fcntl::sys_fcntl,
     flock::sys_flock,
     fsync::{sys_fdatasync, sys_fsync},
-    futex::sys_futex,
+    futex::{sys_futex, sys_futex_waitv},
     get_priority::sys_get_priority,
     getcpu::sys_getcpu,
     getcwd::sys_getcwd,
@@ -49,17 +52,20 @@ use crate::syscall::{
     gettimeofday::sys_gettimeofday,
     getuid::sys_getuid,
     impl_syscall_nums_and_dispatch_fn,
+    io_uring::{sys_io_uring_enter, sys_io_uring_setup},
     ioctl::sys_ioctl,
     kill::sys_kill,
     link::sys_linkat,
     listen::sys_listen,
     lseek::sys_lseek,
     madvise::sys_madvise,
+    mempolicy::{sys_get_mempolicy, sys_mbind, sys_set_mempolicy},
     mkdir::sys_mkdirat,
     mknod::sys_mknodat,
     mmap::sys_mmap,
     mount::sys_mount,
     mprotect::sys_mprotect,
+    mremap::sys_mremap,
     msync::sys_msync,
     munmap::sys_munmap,
     nanosleep::{sys_clock_nanosleep, sys_nanosleep},
@@ -75,6 +81,7 @@ use crate::syscall::{
     read::sys_read,
     readlink::sys_readlinkat,
     recvfrom::sys_recvfrom,
+    recvmmsg::sys_recvmmsg,
     recvmsg::sys_recvmsg,
     rename::sys_renameat,
     rt_sigaction::sys_rt_sigaction,
@@ -95,6 +102,7 @@ use crate::syscall::{
     semget::sys_semget,
     semop::{sys_semop, sys_semtimedop},
     sendfile::sys_sendfile,
+    sendmmsg::sys_sendmmsg,
     sendmsg::sys_sendmsg,
     sendto::sys_sendto,
     set_priority::sys_set_priority,
@@ -118,11 +126,13 @@ use crate::syscall::{
     signalfd::sys_signalfd4,
     socket::sys_socket,
     socketpair::sys_socketpair,
+    splice::sys_splice,
     stat::{sys_fstat, sys_fstatat},
     statfs::{sys_fstatfs, sys_statfs},
     statx::sys_statx,
     symlink::sys_symlinkat,
     sync::sys_sync,
+    tee::sys_tee,
     tgkill::sys_tgkill,
     timer_create::{sys_timer_create, sys_timer_delete},
     timer_settime::{sys_timer_gettime, sys_timer_settime},
@@ -135,6 +145,7 @@ use crate::syscall::{
     uname::sys_uname,
     unlink::sys_unlinkat,
     utimens::sys_utimensat,
+    vmsplice::sys_vmsplice,
     wait4::sys_wait4,
     waitid::sys_waitid,
     write::sys_write,
@@ -188,6 +199,9 @@ impl_syscall_nums_and_dispatch_fn! {
     SYS_SENDFILE64 = 71          => sys_sendfile(args[..4]);
     SYS_PSELECT6 = 72            => sys_pselect6(args[..6]);
     SYS_SIGNALFD4 = 74           => sys_signalfd4(args[..4]);
+    SYS_VMSPLICE = 75            => sys_vmsplice(args[..4]);
+    SYS_SPLICE = 76              => sys_splice(args[..6]);
+    SYS_TEE = 77                 => sys_tee(args[..4]);
     SYS_READLINKAT = 78          => sys_readlinkat(args[..4]);
     SYS_NEWFSTATAT = 79          => sys_fstatat(args[..4]);
     SYS_NEWFSTAT = 80            => sys_fstat(args[..2]);
@@ -277,23 +291,32 @@ impl_syscall_nums_and_dispatch_fn! {
     SYS_RECVMSG = 212            => sys_recvmsg(args[..3]);
     SYS_BRK = 214                => sys_brk(args[..1]);
     SYS_MUNMAP = 215             => sys_munmap(args[..2]);
+    SYS_MREMAP = 216             => sys_mremap(args[..5]);
     SYS_CLONE = 220              => sys_clone(args[..5], &user_ctx);
     SYS_EXECVE = 221             => sys_execve(args[..3], &mut user_ctx);
     SYS_MMAP = 222               => sys_mmap(args[..6]);
+    SYS_FADVISE64 = 223          => sys_fadvise64(args[..4]);
     SYS_MPROTECT = 226           => sys_mprotect(args[..3]);
     SYS_MSYNC = 227              => sys_msync(args[..3]);
     SYS_MADVISE = 233            => sys_madvise(args[..3]);
+    SYS_MBIND = 235              => sys_mbind(args[..6]);
+    SYS_GET_MEMPOLICY = 236      => sys_get_mempolicy(args[..5]);
+    SYS_SET_MEMPOLICY = 237      => sys_set_mempolicy(args[..3]);
     SYS_ACCEPT4 = 242            => sys_accept4(args[..4]);
+    SYS_RECVMMSG = 243           => sys_recvmmsg(args[..5]);
     SYS_WAIT4 = 260              => sys_wait4(args[..4]);
     SYS_PRLIMIT64 = 261          => sys_prlimit64(args[..4]);
+    SYS_SENDMMSG = 269           => sys_sendmmsg(args[..4]);
     SYS_SCHED_SETATTR = 274      => sys_sched_setattr(args[..3]);
     SYS_SCHED_GETATTR = 275      => sys_sched_getattr(args[..4]);
     SYS_GETRANDOM = 278          => sys_getrandom(args[..3]);
     SYS_EXECVEAT = 281           => sys_execveat(args[..5], &mut user_ctx);
+    SYS_COPY_FILE_RANGE = 285    => sys_copy_file_range(args[..6]);
     SYS_PREADV2 = 286            => sys_preadv2(args[..5]);
     SYS_PWRITEV2 = 287           => sys_pwritev2(args[..5]);
     SYS_STATX = 291              => sys_statx(args[..5]);
     SYS_CLOCK_GETTIME = 403      => sys_clock_gettime(args[..2]);
+    SYS_CLOCK_GETRES = 406       => sys_clock_getres(args[..2]);
     SYS_CLOCK_NANOSLEEP = 407    => sys_clock_nanosleep(args[..4]);
     SYS_TIMER_GETTIME = 408      => sys_timer_gettime(args[..2]);
     SYS_TIMER_SETTIME = 409      => sys_timer_settime(args[..4]);
@@ -301,6 +324,9 @@ impl_syscall_nums_and_dispatch_fn! {
     SYS_TIMERFD_SETTIME = 411    => sys_timerfd_settime(args[..4]);
     SYS_UTIMENSAT = 412          => sys_utimensat(args[..4]);
     SYS_SEMTIMEDOP = 420         => sys_semtimedop(args[..4]);
+    SYS_IO_URING_SETUP = 425     => sys_io_uring_setup(args[..2]);
+    SYS_IO_URING_ENTER = 426     => sys_io_uring_enter(args[..6]);
     SYS_CLONE3 = 435             => sys_clone3(args[..2], &user_ctx);
     SYS_FACCESSAT2 = 439         => sys_faccessat2(args[..4]);
+    SYS_FUTEX_WAITV = 449        => sys_futex_waitv(args[..5]);
 }
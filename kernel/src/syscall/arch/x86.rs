@@ -13,22 +13,25 @@ use crate::syscall::{
     chmod::{sys_chmod, sys_fchmod, sys_fchmodat},
     chown::{sys_chown, sys_fchown, sys_fchownat, sys_lchown},
     chroot::sys_chroot,
+    clock_getres::sys_clock_getres,
     clock_gettime::sys_clock_gettime,
     clone::{sys_clone, sys_clone3},
     close::sys_close,
     connect::sys_connect,
+    copy_file_range::sys_copy_file_range,
     dup::{sys_dup, sys_dup2, sys_dup3},
     epoll::{sys_epoll_create, sys_epoll_create1, sys_epoll_ctl, sys_epoll_pwait, sys_epoll_wait},
     eventfd::{sys_eventfd, sys_eventfd2},
     execve::{sys_execve, sys_execveat},
     exit::sys_exit,
     exit_group::sys_exit_group,
+    fadvise64::sys_fadvise64,
     fallocate::sys_fallocate,
     fcntl::sys_fcntl,
     flock::sys_flock,
     fork::{sys_fork, sys_vfork},
     fsync::{sys_fdatasync, sys_fsync},
-    futex::sys_futex,
+    futex::{sys_futex, sys_futex_waitv},
     get_priority::sys_get_priority,
     getcpu::sys_getcpu,
     getcwd::sys_getcwd,
@@ -54,6 +57,7 @@ use crate::syscall::{
     getuid::sys_getuid,
     getxattr::{sys_fgetxattr, sys_getxattr, sys_lgetxattr},
     impl_syscall_nums_and_dispatch_fn,
+    io_uring::{sys_io_uring_enter, sys_io_uring_setup},
     ioctl::sys_ioctl,
     kill::sys_kill,
     link::{sys_link, sys_linkat},
@@ -61,11 +65,13 @@ use crate::syscall::{
     listxattr::{sys_flistxattr, sys_listxattr, sys_llistxattr},
     lseek::sys_lseek,
     madvise::sys_madvise,
+    mempolicy::{sys_get_mempolicy, sys_mbind, sys_set_mempolicy},
     mkdir::{sys_mkdir, sys_mkdirat},
     mknod::{sys_mknod, sys_mknodat},
     mmap::sys_mmap,
     mount::sys_mount,
     mprotect::sys_mprotect,
+    mremap::sys_mremap,
     msync::sys_msync,
     munmap::sys_munmap,
     nanosleep::{sys_clock_nanosleep, sys_nanosleep},
@@ -84,6 +90,7 @@ use crate::syscall::{
     read::sys_read,
     readlink::{sys_readlink, sys_readlinkat},
     recvfrom::sys_recvfrom,
+    recvmmsg::sys_recvmmsg,
     recvmsg::sys_recvmsg,
     removexattr::{sys_fremovexattr, sys_lremovexattr, sys_removexattr},
     rename::{sys_rename, sys_renameat},
@@ -108,6 +115,7 @@ use crate::syscall::{
     semget::sys_semget,
     semop::{sys_semop, sys_semtimedop},
     sendfile::sys_sendfile,
+    sendmmsg::sys_sendmmsg,
     sendmsg::sys_sendmsg,
     sendto::sys_sendto,
     set_priority::sys_set_priority,
@@ -132,12 +140,14 @@ use crate::syscall::{
     signalfd::{sys_signalfd, sys_signalfd4},
     socket::sys_socket,
     socketpair::sys_socketpair,
+    splice::sys_splice,
     stat::{sys_fstat, sys_fstatat, sys_lstat, sys_stat},
     statfs::{sys_fstatfs, sys_statfs},
     statx::sys_statx,
     symlink::{sys_symlink, sys_symlinkat},
     sync::sys_sync,
     sysinfo::sys_sysinfo,
+    tee::sys_tee,
     tgkill::sys_tgkill,
     time::sys_time,
     timer_create::{sys_timer_create, sys_timer_delete},
@@ -151,6 +161,7 @@ use crate::syscall::{
     uname::sys_uname,
     unlink::{sys_unlink, sys_unlinkat},
     utimens::{sys_futimesat, sys_utime, sys_utimensat, sys_utimes},
+    vmsplice::sys_vmsplice,
     wait4::sys_wait4,
     waitid::sys_waitid,
     write::sys_write,
@@ -181,6 +192,7 @@ impl_syscall_nums_and_dispatch_fn! {
     SYS_ACCESS = 21            => sys_access(args[..2]);
     SYS_PIPE = 22              => sys_pipe(args[..1]);
     SYS_SELECT = 23            => sys_select(args[..5]);
+    SYS_MREMAP = 25            => sys_mremap(args[..5]);
     SYS_MSYNC = 26             => sys_msync(args[..3]);
     SYS_SCHED_YIELD = 24       => sys_sched_yield(args[..0]);
     SYS_MADVISE = 28           => sys_madvise(args[..3]);
@@ -314,17 +326,22 @@ impl_syscall_nums_and_dispatch_fn! {
     SYS_GETDENTS64 = 217       => sys_getdents64(args[..3]);
     SYS_SET_TID_ADDRESS = 218  => sys_set_tid_address(args[..1]);
     SYS_SEMTIMEDOP = 220       => sys_semtimedop(args[..4]);
+    SYS_FADVISE64 = 221        => sys_fadvise64(args[..4]);
     SYS_TIMER_CREATE = 222     => sys_timer_create(args[..3]);
     SYS_TIMER_SETTIME = 223    => sys_timer_settime(args[..4]);
     SYS_TIMER_GETTIME = 224    => sys_timer_gettime(args[..2]);
     SYS_TIMER_DELETE = 226     => sys_timer_delete(args[..1]);
     SYS_CLOCK_GETTIME = 228    => sys_clock_gettime(args[..2]);
+    SYS_CLOCK_GETRES = 229     => sys_clock_getres(args[..2]);
     SYS_CLOCK_NANOSLEEP = 230  => sys_clock_nanosleep(args[..4]);
     SYS_EXIT_GROUP = 231       => sys_exit_group(args[..1]);
     SYS_EPOLL_WAIT = 232       => sys_epoll_wait(args[..4]);
     SYS_EPOLL_CTL = 233        => sys_epoll_ctl(args[..4]);
     SYS_TGKILL = 234           => sys_tgkill(args[..3]);
     SYS_UTIMES = 235           => sys_utimes(args[..2]);
+    SYS_MBIND = 237            => sys_mbind(args[..6]);
+    SYS_SET_MEMPOLICY = 238    => sys_set_mempolicy(args[..3]);
+    SYS_GET_MEMPOLICY = 239    => sys_get_mempolicy(args[..5]);
     SYS_WAITID = 247           => sys_waitid(args[..5]);
     SYS_OPENAT = 257           => sys_openat(args[..4]);
     SYS_MKDIRAT = 258          => sys_mkdirat(args[..3]);
@@ -342,6 +359,9 @@ impl_syscall_nums_and_dispatch_fn! {
     SYS_PSELECT6 = 270         => sys_pselect6(args[..6]);
     SYS_PPOLL = 271            => sys_ppoll(args[..5]);
     SYS_SET_ROBUST_LIST = 273  => sys_set_robust_list(args[..2]);
+    SYS_SPLICE = 275           => sys_splice(args[..6]);
+    SYS_TEE = 276              => sys_tee(args[..4]);
+    SYS_VMSPLICE = 278         => sys_vmsplice(args[..4]);
     SYS_UTIMENSAT = 280        => sys_utimensat(args[..4]);
     SYS_EPOLL_PWAIT = 281      => sys_epoll_pwait(args[..6]);
     SYS_SIGNALFD = 282         => sys_signalfd(args[..3]);
@@ -358,15 +378,21 @@ impl_syscall_nums_and_dispatch_fn! {
     SYS_PIPE2 = 293            => sys_pipe2(args[..2]);
     SYS_PREADV = 295           => sys_preadv(args[..4]);
     SYS_PWRITEV = 296          => sys_pwritev(args[..4]);
+    SYS_RECVMMSG = 299         => sys_recvmmsg(args[..5]);
     SYS_PRLIMIT64 = 302        => sys_prlimit64(args[..4]);
+    SYS_SENDMMSG = 307         => sys_sendmmsg(args[..4]);
     SYS_GETCPU = 309           => sys_getcpu(args[..3]);
     SYS_SCHED_SETATTR = 314    => sys_sched_setattr(args[..3]);
     SYS_SCHED_GETATTR = 315    => sys_sched_getattr(args[..4]);
     SYS_GETRANDOM = 318        => sys_getrandom(args[..3]);
     SYS_EXECVEAT = 322         => sys_execveat(args[..5], &mut user_ctx);
+    SYS_COPY_FILE_RANGE = 326  => sys_copy_file_range(args[..6]);
     SYS_PREADV2 = 327          => sys_preadv2(args[..5]);
     SYS_PWRITEV2 = 328         => sys_pwritev2(args[..5]);
     SYS_STATX = 332            => sys_statx(args[..5]);
+    SYS_IO_URING_SETUP = 425   => sys_io_uring_setup(args[..2]);
+    SYS_IO_URING_ENTER = 426   => sys_io_uring_enter(args[..6]);
     SYS_CLONE3 = 435           => sys_clone3(args[..2], &user_ctx);
     SYS_FACCESSAT2 = 439       => sys_faccessat2(args[..4]);
+    SYS_FUTEX_WAITV = 449      => sys_futex_waitv(args[..5]);
 }
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use core::time::Duration;
+
+use super::{
+    clock_gettime::{ClockId, DynamicClockIdInfo},
+    SyscallReturn,
+};
+use crate::{
+    prelude::*,
+    process::{posix_thread::thread_table, process_table},
+    time::{
+        clockid_t,
+        clocks::{
+            BootTimeClock, MonotonicClock, MonotonicCoarseClock, MonotonicRawClock, RealTimeClock,
+            RealTimeCoarseClock,
+        },
+        timespec_t, Clock,
+    },
+};
+
+pub fn sys_clock_getres(
+    clockid: clockid_t,
+    res_addr: Vaddr,
+    ctx: &Context,
+) -> Result<SyscallReturn> {
+    debug!("clockid = {:?}, res_addr = 0x{:x}", clockid, res_addr);
+
+    let resolution = clock_resolution(clockid, ctx)?;
+
+    // If the address is NULL, only the clock ID is validated.
+    if res_addr != 0 {
+        let timespec = timespec_t::from(Duration::from_nanos(resolution));
+        ctx.user_space().write_val(res_addr, &timespec)?;
+    }
+
+    Ok(SyscallReturn::Return(0))
+}
+
+/// Returns the resolution in nanoseconds of a clock specified by the input clock ID.
+fn clock_resolution(clockid: clockid_t, ctx: &Context) -> Result<u64> {
+    if clockid >= 0 {
+        let clock_id = ClockId::try_from(clockid)?;
+        let resolution = match clock_id {
+            ClockId::CLOCK_REALTIME => RealTimeClock::get().resolution(),
+            ClockId::CLOCK_MONOTONIC => MonotonicClock::get().resolution(),
+            ClockId::CLOCK_MONOTONIC_RAW => MonotonicRawClock::get().resolution(),
+            ClockId::CLOCK_REALTIME_COARSE => RealTimeCoarseClock::get().resolution(),
+            ClockId::CLOCK_MONOTONIC_COARSE => MonotonicCoarseClock::get().resolution(),
+            ClockId::CLOCK_BOOTTIME => BootTimeClock::get().resolution(),
+            ClockId::CLOCK_PROCESS_CPUTIME_ID => ctx.process.prof_clock().resolution(),
+            ClockId::CLOCK_THREAD_CPUTIME_ID => ctx.posix_thread.prof_clock().resolution(),
+        };
+        return Ok(resolution);
+    }
+
+    // The CPU-time clocks are all sampled at the timer tick, so only the existence of the
+    // process or thread needs to be checked.
+    match DynamicClockIdInfo::try_from(clockid)? {
+        DynamicClockIdInfo::Pid(pid, _) => {
+            if process_table::get_process(pid).is_none() {
+                return_errno_with_message!(Errno::EINVAL, "invalid clock ID");
+            }
+        }
+        DynamicClockIdInfo::Tid(tid, _) => {
+            if thread_table::get_thread(tid).is_none() {
+                return_errno_with_message!(Errno::EINVAL, "invalid clock ID");
+            }
+        }
+        DynamicClockIdInfo::Fd(_) => {
+            return_errno_with_message!(
+                Errno::EINVAL,
+                "the file descriptor clocks are not supported"
+            );
+        }
+    }
+    Ok(ctx.process.prof_clock().resolution())
+}
@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use super::SyscallReturn;
+use crate::{
+    fs::{
+        file_handle::FileLike,
+        file_table::{FileDesc, WithFileTable},
+        utils::{InodeType, SeekFrom, StatusFlags},
+    },
+    prelude::*,
+};
+
+pub fn sys_copy_file_range(
+    fd_in: FileDesc,
+    off_in_ptr: Vaddr,
+    fd_out: FileDesc,
+    off_out_ptr: Vaddr,
+    len: usize,
+    flags: u32,
+    ctx: &Context,
+) -> Result<SyscallReturn> {
+    debug!(
+        "fd_in = {}, off_in = 0x{:x}, fd_out = {}, off_out = 0x{:x}, len = 0x{:x}, flags = {}",
+        fd_in, off_in_ptr, fd_out, off_out_ptr, len, flags
+    );
+
+    if flags != 0 {
+        return_errno_with_message!(Errno::EINVAL, "invalid flags");
+    }
+
+    let (in_file, out_file) = ctx
+        .thread_local
+        .borrow_file_table_mut()
+        .read_with(|inner| {
+            let in_file = inner.get_file(fd_in)?.clone();
+            let out_file = inner.get_file(fd_out)?.clone();
+            Ok::<_, Error>((in_file, out_file))
+        })?;
+    let in_handle = in_file.as_inode_or_err()?;
+    let out_handle = out_file.as_inode_or_err()?;
+
+    let in_inode = in_handle.dentry().inode();
+    let out_inode = out_handle.dentry().inode();
+    for inode in [in_inode, out_inode] {
+        match inode.type_() {
+            InodeType::File => (),
+            InodeType::Dir => {
+                return_errno_with_message!(Errno::EISDIR, "the file is a directory");
+            }
+            _ => {
+                return_errno_with_message!(Errno::EINVAL, "the file is not a regular file");
+            }
+        }
+    }
+
+    if !in_handle.access_mode().is_readable() {
+        return_errno_with_message!(Errno::EBADF, "the input file is not readable");
+    }
+    if !out_handle.access_mode().is_writable() {
+        return_errno_with_message!(Errno::EBADF, "the output file is not writable");
+    }
+    if out_handle.status_flags().contains(StatusFlags::O_APPEND) {
+        return_errno_with_message!(Errno::EBADF, "the output file is opened with O_APPEND");
+    }
+
+    let in_offset = match read_offset(off_in_ptr, ctx)? {
+        Some(offset) => offset,
+        None => in_handle.offset(),
+    };
+    let out_offset = match read_offset(off_out_ptr, ctx)? {
+        Some(offset) => offset,
+        None => out_handle.offset(),
+    };
+    if in_offset.checked_add(len).is_none() || out_offset.checked_add(len).is_none() {
+        return_errno_with_message!(Errno::EOVERFLOW, "the range is too large");
+    }
+    if Arc::ptr_eq(in_inode, out_inode)
+        && in_offset < out_offset + len
+        && out_offset < in_offset + len
+    {
+        return_errno_with_message!(Errno::EINVAL, "the ranges overlap in the same file");
+    }
+
+    if len == 0 {
+        return Ok(SyscallReturn::Return(0));
+    }
+
+    let copied_len = out_inode.copy_range_from(in_inode.as_ref(), in_offset, out_offset, len)?;
+
+    if off_in_ptr == 0 {
+        in_handle.seek(SeekFrom::Current(copied_len as isize))?;
+    } else {
+        ctx.user_space()
+            .write_val(off_in_ptr, &((in_offset + copied_len) as i64))?;
+    }
+    if off_out_ptr == 0 {
+        out_handle.seek(SeekFrom::Current(copied_len as isize))?;
+    } else {
+        ctx.user_space()
+            .write_val(off_out_ptr, &((out_offset + copied_len) as i64))?;
+    }
+
+    Ok(SyscallReturn::Return(copied_len as _))
+}
+
+fn read_offset(offset_ptr: Vaddr, ctx: &Context) -> Result<Option<usize>> {
+    if offset_ptr == 0 {
+        return Ok(None);
+    }
+
+    let offset: i64 = ctx.user_space().read_val(offset_ptr)?;
+    if offset < 0 {
+        return_errno_with_message!(Errno::EINVAL, "offset cannot be negative");
+    }
+    Ok(Some(offset as usize))
+}
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use super::SyscallReturn;
+use crate::{
+    fs::file_table::{get_file_fast, FileDesc},
+    prelude::*,
+    vm::vmo::{get_page_idx_range, AccessPattern},
+};
+
+pub fn sys_fadvise64(
+    fd: FileDesc,
+    offset: i64,
+    len: i64,
+    advice: i32,
+    ctx: &Context,
+) -> Result<SyscallReturn> {
+    let advice = FadviseAdvice::try_from(advice)?;
+    debug!(
+        "fd = {}, offset = {}, len = {}, advice = {:?}",
+        fd, offset, len, advice
+    );
+
+    if len < 0 {
+        return_errno_with_message!(Errno::EINVAL, "len is negative");
+    }
+
+    let mut file_table = ctx.thread_local.borrow_file_table_mut();
+    let file = get_file_fast!(&mut file_table, fd);
+    let Ok(inode_handle) = file.as_inode_or_err() else {
+        return_errno_with_message!(Errno::ESPIPE, "the file is not related to an inode");
+    };
+    // The advice is not applicable to files without a page cache.
+    let Some(page_cache) = inode_handle.dentry().inode().page_cache() else {
+        return Ok(SyscallReturn::Return(0));
+    };
+
+    // A zero length extends the range to the end of the file.
+    let start = offset.max(0) as usize;
+    let end = if len == 0 {
+        usize::MAX
+    } else {
+        offset.saturating_add(len).max(0) as usize
+    };
+
+    // The access patterns apply to the whole file, while the other advices
+    // apply to the pages in the range.
+    match advice {
+        FadviseAdvice::POSIX_FADV_NORMAL => page_cache.advise_access(AccessPattern::Normal),
+        FadviseAdvice::POSIX_FADV_SEQUENTIAL => page_cache.advise_access(AccessPattern::Sequential),
+        FadviseAdvice::POSIX_FADV_RANDOM => page_cache.advise_access(AccessPattern::Random),
+        FadviseAdvice::POSIX_FADV_WILLNEED => {
+            let end = end.min(page_cache.pages().size());
+            if start < end {
+                page_cache
+                    .pages()
+                    .prefetch_pages(get_page_idx_range(&(start..end)));
+            }
+        }
+        FadviseAdvice::POSIX_FADV_DONTNEED | FadviseAdvice::POSIX_FADV_NOREUSE => {
+            page_cache.drop_clean_range(start..end);
+        }
+    }
+
+    Ok(SyscallReturn::Return(0))
+}
+
+#[repr(i32)]
+#[derive(Debug, Clone, Copy, TryFromInt)]
+#[expect(non_camel_case_types)]
+enum FadviseAdvice {
+    POSIX_FADV_NORMAL = 0,
+    POSIX_FADV_RANDOM = 1,
+    POSIX_FADV_SEQUENTIAL = 2,
+    POSIX_FADV_WILLNEED = 3,
+    POSIX_FADV_DONTNEED = 4,
+    POSIX_FADV_NOREUSE = 5,
+}
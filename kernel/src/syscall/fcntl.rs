@@ -5,6 +5,9 @@ use crate::{
     fs::{
         file_handle::FileLike,
         file_table::{get_file_fast, FdFlags, FileDesc, WithFileTable},
+        inode_handle::InodeHandle,
+        named_pipe::NamedPipe,
+        pipe::{self, PipeReader, PipeWriter},
         utils::{
             FileRange, RangeLockItem, RangeLockItemBuilder, RangeLockType, StatusFlags, OFFSET_MAX,
         },
@@ -31,6 +34,8 @@ pub fn sys_fcntl(fd: FileDesc, cmd: i32, arg: u64, ctx: &Context) -> Result<Sysc
         }),
         FcntlCmd::F_GETOWN => handle_getown(fd, ctx),
         FcntlCmd::F_SETOWN => handle_setown(fd, arg, ctx),
+        FcntlCmd::F_SETPIPE_SZ => handle_setpipe_sz(fd, arg, ctx),
+        FcntlCmd::F_GETPIPE_SZ => handle_getpipe_sz(fd, ctx),
     }
 }
 
@@ -162,6 +167,44 @@ fn handle_setown(fd: FileDesc, arg: u64, ctx: &Context) -> Result<SyscallReturn>
     Ok(SyscallReturn::Return(0))
 }
 
+fn handle_setpipe_sz(fd: FileDesc, arg: u64, ctx: &Context) -> Result<SyscallReturn> {
+    let capacity = pipe::round_capacity(arg.min(usize::MAX as u64) as usize)?;
+
+    let mut file_table = ctx.thread_local.borrow_file_table_mut();
+    let file = get_file_fast!(&mut file_table, fd);
+    if let Some(reader) = file.downcast_ref::<PipeReader>() {
+        reader.set_capacity(capacity)?;
+    } else if let Some(writer) = file.downcast_ref::<PipeWriter>() {
+        writer.set_capacity(capacity)?;
+    } else if let Some(named_pipe) = named_pipe_of(&file) {
+        named_pipe.set_capacity(capacity)?;
+    } else {
+        return_errno_with_message!(Errno::EBADF, "the file is not a pipe");
+    }
+    Ok(SyscallReturn::Return(capacity as _))
+}
+
+fn handle_getpipe_sz(fd: FileDesc, ctx: &Context) -> Result<SyscallReturn> {
+    let mut file_table = ctx.thread_local.borrow_file_table_mut();
+    let file = get_file_fast!(&mut file_table, fd);
+    let capacity = if let Some(reader) = file.downcast_ref::<PipeReader>() {
+        reader.capacity()
+    } else if let Some(writer) = file.downcast_ref::<PipeWriter>() {
+        writer.capacity()
+    } else if let Some(named_pipe) = named_pipe_of(&file) {
+        named_pipe.capacity()
+    } else {
+        return_errno_with_message!(Errno::EBADF, "the file is not a pipe");
+    };
+    Ok(SyscallReturn::Return(capacity as _))
+}
+
+/// Returns the pipe of an opened FIFO.
+fn named_pipe_of(file: &Arc<dyn FileLike>) -> Option<&NamedPipe> {
+    let inode_handle = file.downcast_ref::<InodeHandle>()?;
+    inode_handle.dentry().inode().as_named_pipe()
+}
+
 #[repr(i32)]
 #[derive(Debug, Clone, Copy, TryFromInt)]
 #[expect(non_camel_case_types)]
@@ -177,6 +220,8 @@ enum FcntlCmd {
     F_SETOWN = 8,
     F_GETOWN = 9,
     F_DUPFD_CLOEXEC = 1030,
+    F_SETPIPE_SZ = 1031,
+    F_GETPIPE_SZ = 1032,
 }
 
 #[expect(non_camel_case_types)]
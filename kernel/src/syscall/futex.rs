@@ -6,11 +6,13 @@ use crate::{
     current_userspace,
     prelude::*,
     process::posix_thread::futex::{
-        futex_op_and_flags_from_u32, futex_requeue, futex_wait, futex_wait_bitset, futex_wake,
-        futex_wake_bitset, FutexFlags, FutexOp,
+        futex_cmp_requeue_pi, futex_lock_pi, futex_op_and_flags_from_u32, futex_requeue,
+        futex_trylock_pi, futex_unlock_pi, futex_wait, futex_wait_bitset, futex_wait_requeue_pi,
+        futex_waitv, futex_wake, futex_wake_bitset, FutexFlags, FutexOp, FUTEX_WAITV_MAX,
     },
-    syscall::SyscallReturn,
+    syscall::{clock_gettime::ClockId, SyscallReturn},
     time::{
+        clockid_t,
         clocks::{MonotonicClock, RealTimeClock},
         timer::Timeout,
         timespec_t,
@@ -50,7 +52,10 @@ pub fn sys_futex(
             Duration::try_from(time_spec)?
         };
 
-        let is_real_time = futex_flags.contains(FutexFlags::FUTEX_CLOCK_REALTIME);
+        // FUTEX_LOCK_PI always uses CLOCK_REALTIME, while FUTEX_LOCK_PI2 is
+        // the variant that uses CLOCK_MONOTONIC by default.
+        let is_real_time = futex_flags.contains(FutexFlags::FUTEX_CLOCK_REALTIME)
+            || futex_op == FutexOp::FUTEX_LOCK_PI;
         if is_real_time && futex_op == FutexOp::FUTEX_WAIT {
             // Ref: <https://github.com/torvalds/linux/commit/4fbf5d6837bf81fd7a27d771358f4ee6c4f243f8>
             return_errno_with_message!(Errno::ENOSYS, "FUTEX_WAIT cannot use CLOCK_REALTIME");
@@ -131,6 +136,38 @@ pub fn sys_futex(
             )
             .map(|nwakes| nwakes as _)
         }
+        FutexOp::FUTEX_LOCK_PI | FutexOp::FUTEX_LOCK_PI2 => {
+            let timeout = get_futex_timeout(utime_addr)?;
+            futex_lock_pi(futex_addr as _, timeout, ctx, pid).map(|_| 0)
+        }
+        FutexOp::FUTEX_TRYLOCK_PI => futex_trylock_pi(futex_addr as _, ctx, pid).map(|_| 0),
+        FutexOp::FUTEX_UNLOCK_PI => futex_unlock_pi(futex_addr as _, ctx, pid).map(|_| 0),
+        FutexOp::FUTEX_WAIT_REQUEUE_PI => {
+            let timeout = get_futex_timeout(utime_addr)?;
+            futex_wait_requeue_pi(
+                futex_addr as _,
+                futex_val as _,
+                timeout,
+                futex_new_addr as _,
+                ctx,
+                pid,
+            )
+            .map(|_| 0)
+        }
+        FutexOp::FUTEX_CMP_REQUEUE_PI => {
+            let max_nwakes = get_futex_val(futex_val as i32)?;
+            let max_nrequeues = get_futex_val(utime_addr as i32)?;
+            futex_cmp_requeue_pi(
+                futex_addr as _,
+                max_nwakes,
+                max_nrequeues,
+                futex_new_addr as _,
+                bitset as _,
+                ctx,
+                pid,
+            )
+            .map(|nwakes| nwakes as _)
+        }
         _ => {
             warn!("futex op = {:?}", futex_op);
             return_errno_with_message!(Errno::EINVAL, "unsupported futex op");
@@ -145,3 +182,92 @@ pub fn sys_futex(
     debug!("futex returns, tid= {} ", ctx.posix_thread.tid());
     Ok(SyscallReturn::Return(res as _))
 }
+
+pub fn sys_futex_waitv(
+    waiters_addr: Vaddr,
+    nr_futexes: u32,
+    flags: u32,
+    timeout_addr: Vaddr,
+    clockid: clockid_t,
+    ctx: &Context,
+) -> Result<SyscallReturn> {
+    debug!(
+        "waiters_addr = 0x{:x}, nr_futexes = {}, flags = 0x{:x}, timeout_addr = 0x{:x}, clockid = {}",
+        waiters_addr, nr_futexes, flags, timeout_addr, clockid
+    );
+
+    if flags != 0 {
+        return_errno_with_message!(Errno::EINVAL, "the flags must be zero");
+    }
+    if nr_futexes == 0 || nr_futexes as usize > FUTEX_WAITV_MAX {
+        return_errno_with_message!(Errno::EINVAL, "the number of futexes is invalid");
+    }
+
+    let user_space = ctx.user_space();
+
+    let timeout = if timeout_addr == 0 {
+        None
+    } else {
+        let timer_manager = match ClockId::try_from(clockid) {
+            Ok(ClockId::CLOCK_MONOTONIC) => MonotonicClock::timer_manager(),
+            Ok(ClockId::CLOCK_REALTIME) => RealTimeClock::timer_manager(),
+            _ => return_errno_with_message!(Errno::EINVAL, "the clock is not supported"),
+        };
+        let time_spec: timespec_t = user_space.read_val(timeout_addr)?;
+        // The timeout of `futex_waitv` is always an absolute value.
+        let timeout = Timeout::When(Duration::try_from(time_spec)?);
+        Some(ManagedTimeout::new_with_manager(timeout, timer_manager))
+    };
+
+    let mut futexes = Vec::with_capacity(nr_futexes as usize);
+    for i in 0..nr_futexes as usize {
+        let waiter: FutexWaitv =
+            user_space.read_val(waiters_addr + i * core::mem::size_of::<FutexWaitv>())?;
+
+        if waiter.flags & !(FUTEX2_SIZE_U32 | FUTEX2_PRIVATE) != 0 || waiter.__reserved != 0 {
+            return_errno_with_message!(Errno::EINVAL, "the futex flags are invalid");
+        }
+        // Only 32-bit futexes are supported, as in Linux.
+        if waiter.flags & FUTEX2_SIZE_MASK != FUTEX2_SIZE_U32 {
+            return_errno_with_message!(Errno::EINVAL, "the futex size is not supported");
+        }
+        if waiter.uaddr % 4 != 0 {
+            return_errno_with_message!(Errno::EINVAL, "the futex address is not aligned");
+        }
+        if waiter.val >> 32 != 0 {
+            return_errno_with_message!(Errno::EINVAL, "the futex value exceeds 32 bits");
+        }
+        let futex_val = waiter.val as u32 as i32;
+
+        let pid = if waiter.flags & FUTEX2_PRIVATE != 0 {
+            Some(ctx.process.pid())
+        } else {
+            None
+        };
+        futexes.push((waiter.uaddr as Vaddr, futex_val, pid));
+    }
+
+    let index = futex_waitv(&futexes, timeout, ctx).map_err(|err| match err.error() {
+        Errno::ETIME => Error::new(Errno::ETIMEDOUT),
+        Errno::EINTR => Error::new(Errno::ERESTARTSYS),
+        _ => err,
+    })?;
+
+    Ok(SyscallReturn::Return(index as _))
+}
+
+/// The futex to wait on in `futex_waitv`.
+///
+/// Reference: <https://elixir.bootlin.com/linux/v6.13/source/include/uapi/linux/futex.h#L75>.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Pod)]
+struct FutexWaitv {
+    val: u64,
+    uaddr: u64,
+    flags: u32,
+    __reserved: u32,
+}
+
+const FUTEX2_SIZE_MASK: u32 = 0x03;
+const FUTEX2_SIZE_U32: u32 = 0x02;
+const FUTEX2_PRIVATE: u32 = 128;
@@ -1,6 +1,6 @@
 // SPDX-License-Identifier: MPL-2.0
 
-use ostd::{cpu::PinCurrentCpu, task::disable_preempt};
+use ostd::{cpu::PinCurrentCpu, mm::numa, task::disable_preempt};
 
 use super::SyscallReturn;
 use crate::prelude::*;
@@ -21,7 +21,9 @@ pub fn sys_getcpu(cpu: Vaddr, node: Vaddr, _tcache: Vaddr, ctx: &Context) -> Res
             .write_val::<usize>(cpu, &cpuid.as_usize())?;
     }
     if node != 0 {
-        ctx.user_space().write_val::<usize>(node, &0)?; // TODO: NUMA is not supported
+        let node_id = numa::node_of_cpu(cpuid);
+        ctx.user_space()
+            .write_val::<usize>(node, &node_id.as_usize())?;
     }
     Ok(SyscallReturn::Return(0))
 }
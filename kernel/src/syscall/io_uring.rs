@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use core::time::Duration;
+
+use super::SyscallReturn;
+use crate::{
+    fs::{
+        file_table::{get_file_fast, FdFlags, FileDesc},
+        io_uring::{
+            IoUringEnterFlags, IoUringFeatures, IoUringFile, IoUringGeteventsArg, IoUringParams,
+            IoUringSetupFlags, IORING_MAX_CQ_ENTRIES, IORING_MAX_ENTRIES,
+        },
+    },
+    prelude::*,
+    time::timespec_t,
+};
+
+pub fn sys_io_uring_setup(
+    entries: u32,
+    params_addr: Vaddr,
+    ctx: &Context,
+) -> Result<SyscallReturn> {
+    let user_space = ctx.user_space();
+    let mut params = user_space.read_val::<IoUringParams>(params_addr)?;
+    debug!("entries = {}, params = {:?}", entries, params);
+
+    if params.resv.iter().any(|resv| *resv != 0) {
+        return_errno_with_message!(Errno::EINVAL, "the reserved fields are not zero");
+    }
+    let Some(flags) = IoUringSetupFlags::from_bits(params.flags) else {
+        return_errno_with_message!(Errno::EINVAL, "invalid flags");
+    };
+    if flags
+        .intersects(IoUringSetupFlags::IORING_SETUP_SQPOLL | IoUringSetupFlags::IORING_SETUP_SQ_AFF)
+    {
+        // TODO: Support the SQ polling kernel thread. It requires the kernel
+        // thread to access the memory of the submitting process.
+        return_errno_with_message!(Errno::EINVAL, "SQ polling is not supported");
+    }
+    let is_clamped = flags.contains(IoUringSetupFlags::IORING_SETUP_CLAMP);
+
+    if entries == 0 {
+        return_errno_with_message!(Errno::EINVAL, "the number of entries is zero");
+    }
+    let sq_entries = if entries <= IORING_MAX_ENTRIES {
+        entries.next_power_of_two()
+    } else if is_clamped {
+        IORING_MAX_ENTRIES
+    } else {
+        return_errno_with_message!(Errno::EINVAL, "the number of entries is too large");
+    };
+
+    let cq_entries = if flags.contains(IoUringSetupFlags::IORING_SETUP_CQSIZE) {
+        let cq_entries = params.cq_entries;
+        if cq_entries == 0 {
+            return_errno_with_message!(Errno::EINVAL, "the number of CQ entries is zero");
+        }
+        let cq_entries = if cq_entries <= IORING_MAX_CQ_ENTRIES {
+            cq_entries.next_power_of_two()
+        } else if is_clamped {
+            IORING_MAX_CQ_ENTRIES
+        } else {
+            return_errno_with_message!(Errno::EINVAL, "the number of CQ entries is too large");
+        };
+        if cq_entries < sq_entries {
+            return_errno_with_message!(Errno::EINVAL, "the CQ is smaller than the SQ");
+        }
+        cq_entries
+    } else {
+        2 * sq_entries
+    };
+
+    let io_uring = IoUringFile::new(sq_entries, cq_entries, flags)?;
+
+    params.sq_entries = sq_entries;
+    params.cq_entries = cq_entries;
+    params.features = (IoUringFeatures::IORING_FEAT_NODROP
+        | IoUringFeatures::IORING_FEAT_RW_CUR_POS
+        | IoUringFeatures::IORING_FEAT_EXT_ARG)
+        .bits();
+    params.sq_off = io_uring.sq_offsets();
+    params.cq_off = io_uring.cq_offsets();
+    user_space.write_val(params_addr, &params)?;
+
+    let fd = {
+        let file_table = ctx.thread_local.borrow_file_table();
+        let mut file_table_locked = file_table.unwrap().write();
+        file_table_locked.insert(Arc::new(io_uring), FdFlags::CLOEXEC)
+    };
+
+    Ok(SyscallReturn::Return(fd as _))
+}
+
+pub fn sys_io_uring_enter(
+    fd: FileDesc,
+    to_submit: u32,
+    min_complete: u32,
+    flags: u32,
+    arg: Vaddr,
+    arg_size: usize,
+    ctx: &Context,
+) -> Result<SyscallReturn> {
+    debug!(
+        "fd = {}, to_submit = {}, min_complete = {}, flags = {:#x}, arg = {:#x}, arg_size = {}",
+        fd, to_submit, min_complete, flags, arg, arg_size
+    );
+
+    let Some(flags) = IoUringEnterFlags::from_bits(flags) else {
+        return_errno_with_message!(Errno::EINVAL, "invalid flags");
+    };
+
+    let timeout = if flags.contains(IoUringEnterFlags::IORING_ENTER_EXT_ARG) {
+        if arg_size != size_of::<IoUringGeteventsArg>() {
+            return_errno_with_message!(Errno::EINVAL, "invalid size of the extended argument");
+        }
+        let getevents_arg = ctx.user_space().read_val::<IoUringGeteventsArg>(arg)?;
+        if getevents_arg.sigmask != 0 {
+            // TODO: Support the signal mask.
+            return_errno_with_message!(Errno::EINVAL, "the signal mask is not supported");
+        }
+        if getevents_arg.ts != 0 {
+            let timespec = ctx
+                .user_space()
+                .read_val::<timespec_t>(getevents_arg.ts as Vaddr)?;
+            Some(Duration::try_from(timespec)?)
+        } else {
+            None
+        }
+    } else {
+        if arg != 0 {
+            // TODO: Support the signal mask.
+            return_errno_with_message!(Errno::EINVAL, "the signal mask is not supported");
+        }
+        None
+    };
+
+    let mut file_table = ctx.thread_local.borrow_file_table_mut();
+    let file = get_file_fast!(&mut file_table, fd).into_owned();
+    // Drop `file_table` as the submitted operations also look up their files.
+    drop(file_table);
+    let Some(io_uring) = file.downcast_ref::<IoUringFile>() else {
+        return_errno_with_message!(Errno::EOPNOTSUPP, "the file is not an io_uring instance");
+    };
+
+    let nr_submitted = if to_submit > 0 {
+        io_uring.submit(to_submit, ctx)?
+    } else {
+        0
+    };
+
+    if flags.contains(IoUringEnterFlags::IORING_ENTER_GETEVENTS) {
+        match io_uring.wait(min_complete, timeout.as_ref(), ctx) {
+            Ok(()) => (),
+            // Report the submitted SQEs even if the wait fails.
+            Err(_) if nr_submitted > 0 => (),
+            Err(err) if err.error() == Errno::EINTR => {
+                return Err(Error::new(Errno::ERESTARTSYS));
+            }
+            Err(err) => return Err(err),
+        }
+    }
+
+    Ok(SyscallReturn::Return(nr_submitted as _))
+}
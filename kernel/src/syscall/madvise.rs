@@ -3,7 +3,10 @@
 use align_ext::AlignExt;
 
 use super::SyscallReturn;
-use crate::prelude::*;
+use crate::{
+    prelude::*,
+    vm::{vmar::vm_mapping::ForkAdvice, vmo::AccessPattern},
+};
 
 pub fn sys_madvise(
     start: Vaddr,
@@ -32,33 +35,49 @@ pub fn sys_madvise(
         Errno::EINVAL,
         "integer overflow when (start + len)",
     ))?;
+
+    let user_space = ctx.user_space();
+    let root_vmar = user_space.root_vmar();
+    let range = start..end;
     match behavior {
-        MadviseBehavior::MADV_NORMAL
-        | MadviseBehavior::MADV_SEQUENTIAL
-        | MadviseBehavior::MADV_WILLNEED => {
-            // perform a read at first
-            let mut buffer = vec![0u8; len];
-            ctx.user_space()
-                .read_bytes(start, &mut VmWriter::from(buffer.as_mut_slice()))?;
+        MadviseBehavior::MADV_NORMAL => root_vmar.advise_access(range, AccessPattern::Normal),
+        MadviseBehavior::MADV_SEQUENTIAL => {
+            root_vmar.advise_access(range, AccessPattern::Sequential)
+        }
+        MadviseBehavior::MADV_RANDOM => root_vmar.advise_access(range, AccessPattern::Random),
+        MadviseBehavior::MADV_WILLNEED => root_vmar.prefetch_pages(range)?,
+        MadviseBehavior::MADV_DONTNEED | MadviseBehavior::MADV_DONTNEED_LOCKED => {
+            root_vmar.discard_pages(range)?
+        }
+        // The pages can be freed at any time, so they are freed right away.
+        MadviseBehavior::MADV_FREE => root_vmar.discard_pages(range)?,
+        MadviseBehavior::MADV_REMOVE => root_vmar.remove_pages(range)?,
+        MadviseBehavior::MADV_HUGEPAGE => root_vmar.set_allow_huge_pages(range, true)?,
+        MadviseBehavior::MADV_NOHUGEPAGE => root_vmar.set_allow_huge_pages(range, false)?,
+        MadviseBehavior::MADV_COLD => root_vmar.deactivate_pages(range, false)?,
+        MadviseBehavior::MADV_PAGEOUT => root_vmar.deactivate_pages(range, true)?,
+        MadviseBehavior::MADV_POPULATE_READ => root_vmar.populate_pages(range, false)?,
+        MadviseBehavior::MADV_POPULATE_WRITE => root_vmar.populate_pages(range, true)?,
+        MadviseBehavior::MADV_DONTFORK => root_vmar.advise_fork(range, ForkAdvice::DontFork)?,
+        MadviseBehavior::MADV_DOFORK => root_vmar.advise_fork(range, ForkAdvice::DoFork)?,
+        MadviseBehavior::MADV_WIPEONFORK => root_vmar.advise_fork(range, ForkAdvice::WipeOnFork)?,
+        MadviseBehavior::MADV_KEEPONFORK => root_vmar.advise_fork(range, ForkAdvice::KeepOnFork)?,
+        // These advices are hints for KSM, core dumps and memory failure
+        // injection, which do not honor them yet.
+        MadviseBehavior::MADV_MERGEABLE
+        | MadviseBehavior::MADV_UNMERGEABLE
+        | MadviseBehavior::MADV_DONTDUMP
+        | MadviseBehavior::MADV_DODUMP
+        | MadviseBehavior::MADV_HWPOISON => {
+            warn!("madvise behavior {:?} is ignored", behavior);
         }
-        MadviseBehavior::MADV_DONTNEED => {
-            warn!("MADV_DONTNEED isn't implemented, do nothing for now.");
+        MadviseBehavior::MADV_SOFT_OFFLINE => {
+            return_errno_with_message!(Errno::EINVAL, "unsupported madvise behavior");
         }
-        MadviseBehavior::MADV_FREE => madv_free(start, end, ctx)?,
-        _ => todo!(),
     }
     Ok(SyscallReturn::Return(0))
 }
 
-fn madv_free(start: Vaddr, end: Vaddr, ctx: &Context) -> Result<()> {
-    let user_space = ctx.user_space();
-    let root_vmar = user_space.root_vmar();
-    let advised_range = start..end;
-    let _ = root_vmar.remove_mapping(advised_range);
-
-    Ok(())
-}
-
 #[repr(i32)]
 #[derive(Debug, Clone, Copy, TryFromInt)]
 #[expect(non_camel_case_types)]
@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use align_ext::AlignExt;
+use ostd::mm::{numa, vm_space::VmItem};
+
+use super::SyscallReturn;
+use crate::{
+    prelude::*,
+    vm::mempolicy::{MemPolicy, NodeMask},
+};
+
+pub fn sys_set_mempolicy(
+    mode: i32,
+    nodemask: Vaddr,
+    maxnode: u64,
+    ctx: &Context,
+) -> Result<SyscallReturn> {
+    let nodes = read_node_mask(ctx, nodemask, maxnode)?;
+    let policy = MemPolicy::from_raw(mode, nodes)?;
+    debug!(
+        "mode = {}, nodes = {:?}, policy = {:?}",
+        mode, nodes, policy
+    );
+
+    *ctx.posix_thread.mem_policy().lock() = policy;
+    Ok(SyscallReturn::Return(0))
+}
+
+pub fn sys_get_mempolicy(
+    mode_addr: Vaddr,
+    nodemask: Vaddr,
+    maxnode: u64,
+    addr: Vaddr,
+    flags: u64,
+    ctx: &Context,
+) -> Result<SyscallReturn> {
+    let flags = GetFlags::from_bits(flags as u32)
+        .ok_or_else(|| Error::with_message(Errno::EINVAL, "invalid flags"))?;
+    debug!(
+        "mode_addr = {:#x}, nodemask = {:#x}, maxnode = {}, addr = {:#x}, flags = {:?}",
+        mode_addr, nodemask, maxnode, addr, flags
+    );
+
+    if nodemask != 0 && maxnode < numa::num_nodes() as u64 {
+        return_errno_with_message!(Errno::EINVAL, "the node mask is too small");
+    }
+
+    let (mode, nodes) = if flags.contains(GetFlags::MPOL_F_MEMS_ALLOWED) {
+        if flags.intersects(GetFlags::MPOL_F_NODE | GetFlags::MPOL_F_ADDR) {
+            return_errno_with_message!(Errno::EINVAL, "MPOL_F_MEMS_ALLOWED is used with others");
+        }
+        (0, NodeMask::all())
+    } else if flags.contains(GetFlags::MPOL_F_ADDR) {
+        let user_space = ctx.user_space();
+        let root_vmar = user_space.root_vmar();
+        let policy = root_vmar.mem_policy_at(addr)?;
+        if flags.contains(GetFlags::MPOL_F_NODE) {
+            (node_of_page(ctx, addr)? as i32, NodeMask::default())
+        } else {
+            policy.to_raw()
+        }
+    } else {
+        if addr != 0 {
+            return_errno_with_message!(Errno::EINVAL, "the address is given without MPOL_F_ADDR");
+        }
+        let policy = *ctx.posix_thread.mem_policy().lock();
+        if flags.contains(GetFlags::MPOL_F_NODE) {
+            // The node that the next page will be allocated on.
+            let MemPolicy::Interleave(_) = policy else {
+                return_errno_with_message!(Errno::EINVAL, "the policy is not interleaved");
+            };
+            let node = policy
+                .alloc_node()
+                .unwrap_or_else(numa::NodeId::current_racy);
+            (u32::from(node) as i32, NodeMask::default())
+        } else {
+            policy.to_raw()
+        }
+    };
+
+    if mode_addr != 0 {
+        ctx.user_space().write_val(mode_addr, &mode)?;
+    }
+    if nodemask != 0 {
+        write_node_mask(ctx, nodemask, maxnode, nodes)?;
+    }
+    Ok(SyscallReturn::Return(0))
+}
+
+pub fn sys_mbind(
+    start: Vaddr,
+    len: usize,
+    mode: i32,
+    nodemask: Vaddr,
+    maxnode: u64,
+    flags: u32,
+    ctx: &Context,
+) -> Result<SyscallReturn> {
+    // Moving the existing pages is not supported, so the pages allocated
+    // before are left where they are.
+    let _flags = MbindFlags::from_bits(flags)
+        .ok_or_else(|| Error::with_message(Errno::EINVAL, "invalid flags"))?;
+    let nodes = read_node_mask(ctx, nodemask, maxnode)?;
+    let policy = MemPolicy::from_raw(mode, nodes)?;
+    debug!(
+        "start = {:#x}, len = {:#x}, policy = {:?}, flags = {:#x}",
+        start, len, policy, flags
+    );
+
+    if start % PAGE_SIZE != 0 {
+        return_errno_with_message!(Errno::EINVAL, "the start address should be page aligned");
+    }
+    if len == 0 {
+        return Ok(SyscallReturn::Return(0));
+    }
+    let end = start
+        .checked_add(len.align_up(PAGE_SIZE))
+        .ok_or_else(|| Error::with_message(Errno::EINVAL, "the range overflows"))?;
+
+    let user_space = ctx.user_space();
+    let root_vmar = user_space.root_vmar();
+    root_vmar.set_mem_policy(start..end, policy)?;
+    Ok(SyscallReturn::Return(0))
+}
+
+/// Reads a node mask of `maxnode` bits from the user space.
+fn read_node_mask(ctx: &Context, addr: Vaddr, maxnode: u64) -> Result<NodeMask> {
+    // Like Linux, the last bit is not used.
+    let nr_bits = maxnode.saturating_sub(1) as usize;
+    if addr == 0 || nr_bits == 0 {
+        return Ok(NodeMask::default());
+    }
+    if nr_bits > PAGE_SIZE * 8 {
+        return_errno_with_message!(Errno::EINVAL, "the node mask is too large");
+    }
+
+    let nr_words = nr_bits.div_ceil(u64::BITS as usize);
+    let mut bits = 0;
+    for i in 0..nr_words {
+        let mut word = ctx
+            .user_space()
+            .read_val::<u64>(addr + i * size_of::<u64>())?;
+        let nr_remaining_bits = nr_bits - i * u64::BITS as usize;
+        if nr_remaining_bits < u64::BITS as usize {
+            word &= (1 << nr_remaining_bits) - 1;
+        }
+        if i == 0 {
+            bits = word;
+        } else if word != 0 {
+            return_errno_with_message!(Errno::EINVAL, "the nodes do not exist");
+        }
+    }
+
+    NodeMask::from_bits(bits)
+        .ok_or_else(|| Error::with_message(Errno::EINVAL, "the nodes do not exist"))
+}
+
+/// Writes a node mask of `maxnode` bits to the user space.
+fn write_node_mask(ctx: &Context, addr: Vaddr, maxnode: u64, nodes: NodeMask) -> Result<()> {
+    let nr_words = (maxnode as usize).div_ceil(u64::BITS as usize);
+    for i in 0..nr_words {
+        let word = if i == 0 { nodes.bits() } else { 0 };
+        ctx.user_space()
+            .write_val(addr + i * size_of::<u64>(), &word)?;
+    }
+    Ok(())
+}
+
+/// Returns the node of the page at the address, faulting it in if needed.
+fn node_of_page(ctx: &Context, addr: Vaddr) -> Result<u32> {
+    ctx.user_space().read_val::<u8>(addr)?;
+
+    let user_space = ctx.user_space();
+    let root_vmar = user_space.root_vmar();
+    let page_addr = addr.align_down(PAGE_SIZE);
+    let mut cursor = root_vmar
+        .vm_space()
+        .cursor(&(page_addr..page_addr + PAGE_SIZE))?;
+    match cursor.query()? {
+        VmItem::Mapped { frame, .. } => Ok(numa::node_of_paddr(frame.start_paddr()).into()),
+        VmItem::NotMapped { .. } => {
+            return_errno_with_message!(Errno::EFAULT, "the page is not mapped")
+        }
+    }
+}
+
+bitflags! {
+    struct GetFlags: u32 {
+        const MPOL_F_NODE = 1 << 0;
+        const MPOL_F_ADDR = 1 << 1;
+        const MPOL_F_MEMS_ALLOWED = 1 << 2;
+    }
+}
+
+bitflags! {
+    struct MbindFlags: u32 {
+        const MPOL_MF_STRICT = 1 << 0;
+        const MPOL_MF_MOVE = 1 << 1;
+        const MPOL_MF_MOVE_ALL = 1 << 2;
+    }
+}
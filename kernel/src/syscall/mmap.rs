@@ -124,11 +124,10 @@ fn do_sys_mmap(
                 options = options.vmo(shared_vmo);
             }
         } else {
-            let vmo = {
-                let mut file_table = ctx.thread_local.borrow_file_table_mut();
-                let file = get_file_fast!(&mut file_table, fd);
-                let inode_handle = file.as_inode_or_err()?;
+            let mut file_table = ctx.thread_local.borrow_file_table_mut();
+            let file = get_file_fast!(&mut file_table, fd);
 
+            if let Ok(inode_handle) = file.as_inode_or_err() {
                 let access_mode = inode_handle.access_mode();
                 if vm_perms.contains(VmPerms::READ) && !access_mode.is_readable() {
                     return_errno!(Errno::EACCES);
@@ -141,19 +140,21 @@ fn do_sys_mmap(
                 }
 
                 let inode = inode_handle.dentry().inode();
-                inode
+                let vmo = inode
                     .page_cache()
                     .ok_or(Error::with_message(
                         Errno::EBADF,
                         "File does not have page cache",
                     ))?
-                    .to_dyn()
-            };
-
-            options = options
-                .vmo(vmo)
-                .vmo_offset(offset)
-                .handle_page_faults_around();
+                    .to_dyn();
+
+                options = options
+                    .vmo(vmo)
+                    .vmo_offset(offset)
+                    .handle_page_faults_around();
+            } else {
+                options = options.vmo(file.mmap_vmo()?).vmo_offset(offset);
+            }
         }
 
         options
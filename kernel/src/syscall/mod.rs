@@ -4,6 +4,8 @@
 //! The each sub module contains functions that handle real syscall logic.
 pub use clock_gettime::ClockId;
 use ostd::cpu::context::UserContext;
+#[cfg(feature = "syscall_stats")]
+pub use stats::{syscall_stats, SyscallStat, NR_LATENCY_BUCKETS};
 pub use timer_create::create_timer;
 
 use crate::{context::Context, cpu::LinuxAbi, prelude::*};
@@ -21,17 +23,20 @@ mod chdir;
 mod chmod;
 mod chown;
 mod chroot;
+mod clock_getres;
 mod clock_gettime;
 mod clone;
 mod close;
 mod connect;
 mod constants;
+mod copy_file_range;
 mod dup;
 mod epoll;
 mod eventfd;
 mod execve;
 mod exit;
 mod exit_group;
+mod fadvise64;
 mod fallocate;
 mod fcntl;
 mod flock;
@@ -62,6 +67,7 @@ mod gettid;
 mod gettimeofday;
 mod getuid;
 mod getxattr;
+mod io_uring;
 mod ioctl;
 mod kill;
 mod link;
@@ -69,11 +75,13 @@ mod listen;
 mod listxattr;
 mod lseek;
 mod madvise;
+mod mempolicy;
 mod mkdir;
 mod mknod;
 mod mmap;
 mod mount;
 mod mprotect;
+mod mremap;
 mod msync;
 mod munmap;
 mod nanosleep;
@@ -92,6 +100,7 @@ mod pwritev;
 mod read;
 mod readlink;
 mod recvfrom;
+mod recvmmsg;
 mod recvmsg;
 mod removexattr;
 mod rename;
@@ -116,6 +125,7 @@ mod semctl;
 mod semget;
 mod semop;
 mod sendfile;
+mod sendmmsg;
 mod sendmsg;
 mod sendto;
 mod set_priority;
@@ -140,12 +150,16 @@ mod sigaltstack;
 mod signalfd;
 mod socket;
 mod socketpair;
+mod splice;
 mod stat;
 mod statfs;
+#[cfg(feature = "syscall_stats")]
+mod stats;
 mod statx;
 mod symlink;
 mod sync;
 mod sysinfo;
+mod tee;
 mod tgkill;
 mod time;
 mod timer_create;
@@ -159,6 +173,7 @@ mod umount;
 mod uname;
 mod unlink;
 mod utimens;
+mod vmsplice;
 mod wait4;
 mod waitid;
 mod write;
@@ -286,6 +301,48 @@ macro_rules! impl_syscall_nums_and_dispatch_fn {
             pub const $name: u64 = $num;
         )*
 
+        /// The number of the entries in the syscall table, i.e., the largest syscall number
+        /// plus one.
+        pub const NR_SYSCALLS: usize = {
+            let nums = [$( $num as usize ),*];
+            let mut max = 0;
+            let mut i = 0;
+            while i < nums.len() {
+                if nums[i] > max {
+                    max = nums[i];
+                }
+                i += 1;
+            }
+            max + 1
+        };
+
+        /// The names of the syscalls, indexed by the syscall numbers.
+        #[cfg(feature = "syscall_stats")]
+        pub static SYSCALL_NAMES: [Option<&str>; NR_SYSCALLS] = {
+            let mut names = [None; NR_SYSCALLS];
+            $(
+                names[$num] = Some(stringify!($name));
+            )*
+            names
+        };
+
+        /// The syscall handlers, indexed by the syscall numbers.
+        ///
+        /// The table is built at compile time, so dispatching a syscall is a bounds check and
+        /// an indirect call.
+        static SYSCALL_TABLE: [Option<$crate::syscall::SyscallHandler>; NR_SYSCALLS] = {
+            let mut table: [Option<$crate::syscall::SyscallHandler>; NR_SYSCALLS] =
+                [None; NR_SYSCALLS];
+            $(
+                let handler: $crate::syscall::SyscallHandler = |args, ctx, user_ctx| {
+                    $crate::log_syscall_entry!($name);
+                    $crate::syscall::dispatch_fn_inner!(args, ctx, user_ctx, $handler $args)
+                };
+                table[$num] = Some(handler);
+            )*
+            table
+        };
+
         // Then, define the dispatcher function
         pub fn syscall_dispatch(
             syscall_number: u64,
@@ -293,14 +350,14 @@ macro_rules! impl_syscall_nums_and_dispatch_fn {
             ctx: &crate::context::Context,
             user_ctx: &mut ostd::cpu::context::UserContext,
         ) -> $crate::prelude::Result<$crate::syscall::SyscallReturn> {
-            match syscall_number {
-                $(
-                    $num => {
-                        $crate::log_syscall_entry!($name);
-                        $crate::syscall::dispatch_fn_inner!(args, ctx, user_ctx, $handler $args)
-                    }
-                )*
-                _ => {
+            let handler = usize::try_from(syscall_number)
+                .ok()
+                .and_then(|index| SYSCALL_TABLE.get(index))
+                .copied()
+                .flatten();
+            match handler {
+                Some(handler) => handler(args, ctx, user_ctx),
+                None => {
                     log::warn!("Unimplemented syscall number: {}", syscall_number);
                     $crate::return_errno_with_message!($crate::error::Errno::ENOSYS, "Syscall was unimplemented");
                 }
@@ -314,6 +371,9 @@ use dispatch_fn_inner;
 use impl_syscall_nums_and_dispatch_fn;
 use syscall_handler;
 
+/// The type of the entries in the syscall table.
+type SyscallHandler = fn([u64; 6], &Context, &mut UserContext) -> Result<SyscallReturn>;
+
 pub struct SyscallArgument {
     syscall_number: u64,
     args: [u64; 6],
@@ -340,7 +400,41 @@ impl SyscallArgument {
 }
 
 pub fn handle_syscall(ctx: &Context, user_ctx: &mut UserContext) {
+    #[cfg(feature = "syscall_stats")]
+    let start_cycles = ostd::arch::read_tsc();
+
     let syscall_frame = SyscallArgument::new_from_context(user_ctx);
+    let syscall_number = syscall_frame.syscall_number;
+    let [arg0, arg1, arg2, ..] = syscall_frame.args;
+    ostd::tracepoint!(SyscallEnter, syscall_number, arg0, arg1, arg2);
+
+    if let Some(return_value) = handle_trivial_syscall(syscall_number, ctx) {
+        user_ctx.set_syscall_ret(return_value as usize);
+    } else {
+        dispatch_syscall(syscall_frame, ctx, user_ctx);
+    }
+
+    ostd::tracepoint!(SyscallExit, syscall_number, user_ctx.get_syscall_ret());
+
+    #[cfg(feature = "syscall_stats")]
+    stats::record(syscall_number, start_cycles);
+}
+
+/// Handles the syscalls that only read the IDs of the caller.
+///
+/// These syscalls cannot fail, so they skip the syscall table, the logging and the error
+/// conversion. Their costs are dominated by entering and leaving the kernel.
+fn handle_trivial_syscall(syscall_number: u64, ctx: &Context) -> Option<isize> {
+    let return_value = match syscall_number {
+        arch::SYS_GETPID => ctx.process.pid() as isize,
+        arch::SYS_GETTID => ctx.posix_thread.tid() as isize,
+        arch::SYS_GETPPID => ctx.process.parent().pid() as isize,
+        _ => return None,
+    };
+    Some(return_value)
+}
+
+fn dispatch_syscall(syscall_frame: SyscallArgument, ctx: &Context, user_ctx: &mut UserContext) {
     let syscall_return = arch::syscall_dispatch(
         syscall_frame.syscall_number,
         syscall_frame.args,
@@ -8,6 +8,7 @@ use crate::{
         fs_resolver::{FsPath, AT_FDCWD},
         overlayfs::OverlayFS,
         path::Dentry,
+        ramfs::{RamFS, RamFsLimits},
         utils::{FileSystem, InodeType},
     },
     prelude::*,
@@ -184,6 +185,10 @@ fn get_fs(
             let overlay_fs = create_overlayfs(data.as_ref(), ctx)?;
             Ok(overlay_fs)
         }
+        "ramfs" | "tmpfs" => {
+            let limits = parse_ramfs_limits(data.as_ref())?;
+            Ok(RamFS::with_limits(limits))
+        }
         _ => return_errno_with_message!(Errno::EINVAL, "Invalid fs type"),
     }
 }
@@ -235,6 +240,49 @@ fn create_overlayfs(data: &str, ctx: &Context) -> Result<Arc<OverlayFS>> {
     Ok(overlayfs)
 }
 
+/// Parses the `size`, `nr_blocks`, and `nr_inodes` options of tmpfs.
+///
+/// Like tmpfs, a limit of zero means no limit. The other options are ignored.
+fn parse_ramfs_limits(data: &str) -> Result<RamFsLimits> {
+    let mut limits = RamFsLimits::default();
+
+    for entry in data.split(',') {
+        let mut parts = entry.split('=');
+        match (parts.next(), parts.next()) {
+            (Some("size"), Some(size)) => {
+                limits.max_blocks = Some(parse_size(size)?.div_ceil(PAGE_SIZE));
+            }
+            (Some("nr_blocks"), Some(nr_blocks)) => {
+                limits.max_blocks = Some(parse_size(nr_blocks)?);
+            }
+            (Some("nr_inodes"), Some(nr_inodes)) => {
+                limits.max_inodes = Some(parse_size(nr_inodes)?);
+            }
+            _ => (),
+        }
+    }
+
+    limits.max_blocks = limits.max_blocks.filter(|max_blocks| *max_blocks != 0);
+    limits.max_inodes = limits.max_inodes.filter(|max_inodes| *max_inodes != 0);
+    Ok(limits)
+}
+
+/// Parses a number with an optional `k`, `m`, or `g` suffix.
+fn parse_size(size: &str) -> Result<usize> {
+    let (digits, shift) = match size.as_bytes().last() {
+        Some(b'k' | b'K') => (&size[..size.len() - 1], 10),
+        Some(b'm' | b'M') => (&size[..size.len() - 1], 20),
+        Some(b'g' | b'G') => (&size[..size.len() - 1], 30),
+        _ => (size, 0),
+    };
+    let value: usize = digits
+        .parse()
+        .map_err(|_| Error::with_message(Errno::EINVAL, "invalid size"))?;
+    value
+        .checked_mul(1 << shift)
+        .ok_or_else(|| Error::with_message(Errno::EINVAL, "the size overflows"))
+}
+
 bitflags! {
     struct MountFlags: u32 {
         const MS_RDONLY        =   1 << 0;       // Mount read-only.
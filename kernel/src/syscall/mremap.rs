@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use align_ext::AlignExt;
+
+use super::SyscallReturn;
+use crate::prelude::*;
+
+pub fn sys_mremap(
+    old_addr: Vaddr,
+    old_size: usize,
+    new_size: usize,
+    flags: u32,
+    new_addr: Vaddr,
+    ctx: &Context,
+) -> Result<SyscallReturn> {
+    let flags =
+        MremapFlags::from_bits(flags).ok_or(Error::with_message(Errno::EINVAL, "invalid flags"))?;
+    debug!(
+        "old_addr = 0x{:x}, old_size = 0x{:x}, new_size = 0x{:x}, flags = {:?}, new_addr = 0x{:x}",
+        old_addr, old_size, new_size, flags, new_addr
+    );
+
+    if old_addr % PAGE_SIZE != 0 {
+        return_errno_with_message!(Errno::EINVAL, "mremap old_addr must be page-aligned");
+    }
+    if old_size > isize::MAX as usize || new_size > isize::MAX as usize {
+        return_errno_with_message!(Errno::ENOMEM, "mremap size align overflow");
+    }
+    if new_size == 0 {
+        return_errno_with_message!(Errno::EINVAL, "mremap new_size cannot be zero");
+    }
+    if old_size == 0 {
+        // Linux duplicates a shared mapping in this case, which is deprecated.
+        return_errno_with_message!(Errno::EINVAL, "mremap old_size of zero is not supported");
+    }
+
+    let may_move = flags.contains(MremapFlags::MREMAP_MAYMOVE);
+    let new_addr = if flags.contains(MremapFlags::MREMAP_FIXED) {
+        if !may_move {
+            return_errno_with_message!(Errno::EINVAL, "MREMAP_FIXED requires MREMAP_MAYMOVE");
+        }
+        if new_addr % PAGE_SIZE != 0 {
+            return_errno_with_message!(Errno::EINVAL, "mremap new_addr must be page-aligned");
+        }
+        if new_addr.checked_add(new_size).is_none() {
+            return_errno_with_message!(
+                Errno::EINVAL,
+                "integer overflow when (new_addr + new_size)"
+            );
+        }
+        Some(new_addr)
+    } else {
+        None
+    };
+
+    let old_size = old_size.align_up(PAGE_SIZE);
+    let new_size = new_size.align_up(PAGE_SIZE);
+
+    let user_space = ctx.user_space();
+    let root_vmar = user_space.root_vmar();
+    let addr = root_vmar.remap_mapping(old_addr, old_size, new_size, new_addr, may_move)?;
+    Ok(SyscallReturn::Return(addr as _))
+}
+
+bitflags! {
+    struct MremapFlags: u32 {
+        /// The mapping may be moved to a new address.
+        const MREMAP_MAYMOVE = 1;
+        /// The mapping is moved to the address specified by `new_addr`.
+        const MREMAP_FIXED = 2;
+    }
+}
@@ -10,7 +10,10 @@ use crate::{
         file_table::{FileDesc, FileTable},
     },
     prelude::*,
-    process::{signal::Poller, ResourceType},
+    process::{
+        signal::{PollCache, Poller},
+        ResourceType,
+    },
 };
 
 pub fn sys_poll(fds: Vaddr, nfds: u32, timeout: i32, ctx: &Context) -> Result<SyscallReturn> {
@@ -91,25 +94,35 @@ pub fn do_poll(poll_fds: &[PollFd], timeout: Option<&Duration>, ctx: &Context) -
         PollFiles::new_owned(poll_fds, &file_table_locked)
     };
 
-    let poller = match poll_files.register_poller(timeout) {
-        PollerResult::Registered(poller) => poller,
-        PollerResult::FoundEvents(num_events) => return Ok(num_events),
-    };
-
-    loop {
-        match poller.wait() {
-            Ok(()) => (),
-            // We should return zero if the timeout expires
-            // before any file descriptors are ready.
-            Err(err) if err.error() == Errno::ETIME => return Ok(0),
-            Err(err) => return Err(err),
-        };
+    // Fast path: Check the events without registering any poller.
+    let num_events = poll_files.count_events();
+    if num_events > 0 || timeout.is_some_and(Duration::is_zero) {
+        return Ok(num_events);
+    }
 
-        let num_events = poll_files.count_events();
-        if num_events > 0 {
-            return Ok(num_events);
+    // Reuse the poller of the last call if it polled the same files. Otherwise, drop it, which
+    // unregisters it from the files, and register a new poller.
+    let cached = ctx
+        .thread_local
+        .poll_cache()
+        .borrow_mut()
+        .take()
+        .filter(|poll_cache| poll_cache.matches(poll_files.files()));
+    let mut poll_cache = if let Some(mut poll_cache) = cached {
+        poll_cache.poller_mut().reset_timeout(timeout);
+        poll_cache
+    } else {
+        match poll_files.register_poller(timeout) {
+            PollerResult::Registered(poller) => {
+                PollCache::new(poller, poll_files.files().flatten())
+            }
+            PollerResult::FoundEvents(num_events) => return Ok(num_events),
         }
-    }
+    };
+
+    let result = poll_files.wait_events(poll_cache.poller());
+    *ctx.thread_local.poll_cache().borrow_mut() = Some(poll_cache);
+    result
 }
 
 struct PollFiles<'a> {
@@ -154,6 +167,24 @@ enum PollerResult {
 }
 
 impl PollFiles<'_> {
+    /// Waits until some files are ready and returns the number of the ready files.
+    fn wait_events(&self, poller: &Poller) -> Result<usize> {
+        loop {
+            match poller.wait() {
+                Ok(()) => (),
+                // We should return zero if the timeout expires
+                // before any file descriptors are ready.
+                Err(err) if err.error() == Errno::ETIME => return Ok(0),
+                Err(err) => return Err(err),
+            };
+
+            let num_events = self.count_events();
+            if num_events > 0 {
+                return Ok(num_events);
+            }
+        }
+    }
+
     /// Registers the files with a poller, or exits early if some events are detected.
     fn register_poller(&self, timeout: Option<&Duration>) -> PollerResult {
         let mut poller = Poller::new(timeout);
@@ -205,13 +236,20 @@ impl PollFiles<'_> {
         counter
     }
 
-    fn file_at(&self, index: usize) -> Option<&dyn FileLike> {
+    /// Returns the files to poll and the events to poll for.
+    fn files(&self) -> impl ExactSizeIterator<Item = Option<(&Arc<dyn FileLike>, IoEvents)>> {
+        (0..self.poll_fds.len()).map(|index| {
+            let file = self.file_at(index)?;
+            Some((file, self.poll_fds[index].events()))
+        })
+    }
+
+    fn file_at(&self, index: usize) -> Option<&Arc<dyn FileLike>> {
         match &self.files {
             CowFiles::Borrowed(table) => self.poll_fds[index]
                 .fd()
-                .and_then(|fd| table.get_file(fd).ok())
-                .map(Arc::as_ref),
-            CowFiles::Owned(files) => files[index].as_deref(),
+                .and_then(|fd| table.get_file(fd).ok()),
+            CowFiles::Owned(files) => files[index].as_ref(),
         }
     }
 }
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use core::time::Duration;
+
+use super::{recvmsg::recv_one_message, sendmmsg::UIO_MAXIOV, SyscallReturn};
+use crate::{
+    fs::file_table::{get_file_fast, FileDesc},
+    net::socket::SendRecvFlags,
+    prelude::*,
+    time::{clocks::MonotonicClock, timespec_t, Clock},
+    util::net::CUserMMsgHdr,
+};
+
+pub fn sys_recvmmsg(
+    sockfd: FileDesc,
+    user_mmsghdr_ptr: Vaddr,
+    vlen: u32,
+    flags: i32,
+    timeout_ptr: Vaddr,
+    ctx: &Context,
+) -> Result<SyscallReturn> {
+    let flags = SendRecvFlags::from_bits_truncate(flags);
+    let vlen = vlen.min(UIO_MAXIOV) as usize;
+
+    debug!(
+        "sockfd = {}, user_mmsghdr = 0x{:x}, vlen = {}, flags = {:?}, timeout = 0x{:x}",
+        sockfd, user_mmsghdr_ptr, vlen, flags, timeout_ptr
+    );
+
+    let user_space = ctx.user_space();
+    let deadline = if timeout_ptr != 0 {
+        let timeout: timespec_t = user_space.read_val(timeout_ptr)?;
+        Some(MonotonicClock::get().read_time() + Duration::try_from(timeout)?)
+    } else {
+        None
+    };
+
+    let mut file_table = ctx.thread_local.borrow_file_table_mut();
+    // The file is cloned so that the received files can be installed in the file table while
+    // the socket is in use.
+    let file = get_file_fast!(&mut file_table, sockfd).into_owned();
+    let socket = file.as_socket_or_err()?;
+
+    // With `MSG_WAITFORONE`, only the first message is waited for.
+    let waitforone = flags.contains(SendRecvFlags::MSG_WAITFORONE);
+    let mut flags = flags - SendRecvFlags::MSG_WAITFORONE;
+
+    let mut nr_received = 0;
+    while nr_received < vlen {
+        let c_user_mmsghdr_ptr = user_mmsghdr_ptr + nr_received * size_of::<CUserMMsgHdr>();
+        let mut c_user_mmsghdr: CUserMMsgHdr = user_space.read_val(c_user_mmsghdr_ptr)?;
+
+        let c_user_msghdr = &mut c_user_mmsghdr.msg_hdr;
+        let recv_bytes = match recv_one_message(socket, c_user_msghdr, flags, ctx) {
+            Ok((recv_bytes, control_message)) => {
+                c_user_msghdr.write_control_message_to_user(
+                    control_message,
+                    flags,
+                    &mut file_table,
+                )?;
+                recv_bytes
+            }
+            // The error is reported only if no messages are received. Otherwise, the number
+            // of the received messages is returned, and the error is expected to occur again
+            // in the subsequent call.
+            Err(err) if nr_received == 0 => return Err(err),
+            Err(_) => break,
+        };
+
+        c_user_mmsghdr.msg_len = recv_bytes as u32;
+        user_space.write_val(c_user_mmsghdr_ptr, &c_user_mmsghdr)?;
+        nr_received += 1;
+
+        if waitforone {
+            flags |= SendRecvFlags::MSG_DONTWAIT;
+        }
+        // Like Linux, the timeout is only checked after a message is received.
+        if deadline.is_some_and(|deadline| MonotonicClock::get().read_time() >= deadline) {
+            break;
+        }
+    }
+
+    if let Some(deadline) = deadline {
+        // Writes back the remaining time.
+        let remaining = deadline.saturating_sub(MonotonicClock::get().read_time());
+        user_space.write_val(timeout_ptr, &timespec_t::from(remaining))?;
+    }
+
+    Ok(SyscallReturn::Return(nr_received as _))
+}
@@ -3,7 +3,7 @@
 use super::SyscallReturn;
 use crate::{
     fs::file_table::{get_file_fast, FileDesc},
-    net::socket::SendRecvFlags,
+    net::socket::{ControlMessage, SendRecvFlags, Socket},
     prelude::*,
     util::net::CUserMsgHdr,
 };
@@ -14,7 +14,7 @@ pub fn sys_recvmsg(
     flags: i32,
     ctx: &Context,
 ) -> Result<SyscallReturn> {
-    let c_user_msghdr: CUserMsgHdr = ctx.user_space().read_val(user_msghdr_ptr)?;
+    let mut c_user_msghdr: CUserMsgHdr = ctx.user_space().read_val(user_msghdr_ptr)?;
     let flags = SendRecvFlags::from_bits_truncate(flags);
 
     debug!(
@@ -26,6 +26,30 @@ pub fn sys_recvmsg(
     let file = get_file_fast!(&mut file_table, sockfd);
     let socket = file.as_socket_or_err()?;
 
+    let (total_bytes, control_message) = recv_one_message(socket, &mut c_user_msghdr, flags, ctx)?;
+
+    // The socket must not be borrowed from the file table, because the received files are
+    // installed in it.
+    drop(file);
+    c_user_msghdr.write_control_message_to_user(control_message, flags, &mut file_table)?;
+    ctx.user_space()
+        .write_val(user_msghdr_ptr, &c_user_msghdr)?;
+
+    Ok(SyscallReturn::Return(total_bytes as _))
+}
+
+/// Receives a message from the socket into the buffers described by `c_user_msghdr`.
+///
+/// The fields of `c_user_msghdr` that describe the received message, e.g., `msg_flags`, are
+/// updated, and the caller should write them back to user space. The received control message
+/// is returned, and the caller should write it with
+/// [`CUserMsgHdr::write_control_message_to_user`].
+pub(super) fn recv_one_message(
+    socket: &dyn Socket,
+    c_user_msghdr: &mut CUserMsgHdr,
+    flags: SendRecvFlags,
+    ctx: &Context,
+) -> Result<(usize, Option<ControlMessage>)> {
     let (total_bytes, message_header) = {
         let user_space = ctx.user_space();
         let mut io_vec_writer = c_user_msghdr.copy_writer_array_from_user(&user_space)?;
@@ -42,9 +66,8 @@ pub fn sys_recvmsg(
         c_user_msghdr.write_socket_addr_to_user(addr)?;
     }
 
-    if c_user_msghdr.msg_control != 0 {
-        warn!("receiving control message is not supported");
-    }
+    // Like Linux, `MSG_CMSG_CLOEXEC` is reported back in `msg_flags`.
+    c_user_msghdr.msg_flags = (flags & SendRecvFlags::MSG_CMSG_CLOEXEC).bits() as u32;
 
-    Ok(SyscallReturn::Return(total_bytes as _))
+    Ok((total_bytes, message_header.into_control_message()))
 }
@@ -1,8 +1,15 @@
 // SPDX-License-Identifier: MPL-2.0
 
-use super::SyscallReturn;
+use ostd::mm::UntypedMem;
+
+use super::{splice::splice_file_to_pipe, SyscallReturn};
 use crate::{
-    fs::file_table::{FileDesc, WithFileTable},
+    fs::{
+        file_handle::FileLike,
+        file_table::{FileDesc, WithFileTable},
+        pipe::PipeWriter,
+        utils::SeekFrom,
+    },
     prelude::*,
 };
 
@@ -41,7 +48,6 @@ pub fn sys_sendfile(
         .borrow_file_table_mut()
         .read_with(|inner| {
             let out_file = inner.get_file(out_fd)?.clone();
-            // FIXME: the in_file must support mmap-like operations (i.e., it cannot be a socket).
             let in_file = inner.get_file(in_fd)?.clone();
             Ok::<_, Error>((out_file, in_file))
         })?;
@@ -52,22 +58,136 @@ pub fn sys_sendfile(
         count = MAX_COUNT;
     }
 
+    // The offset decides how to read from `in_file`.
+    // If offset is `Some(_)`, the data will be read from the given offset,
+    // and after reading, the file offset of `in_file` will remain unchanged.
+    // If offset is `None`, the data will be read from the file offset,
+    // and the file offset of `in_file` is adjusted
+    // to reflect the number of bytes read from `in_file`.
+    let mut offset = offset.map(|offset| offset as usize);
+
+    let total_len = if let Some(out_pipe) = out_file.downcast_ref::<PipeWriter>() {
+        splice_file_to_pipe(in_file.as_ref(), offset.as_mut(), out_pipe, count, false)?
+    } else if let Some(total_len) =
+        send_cached_pages(out_file.as_ref(), in_file.as_ref(), offset.as_mut(), count)?
+    {
+        total_len
+    } else {
+        send_with_buffer(out_file.as_ref(), in_file.as_ref(), offset.as_mut(), count)?
+    };
+
+    if let Some(offset) = offset {
+        ctx.user_space().write_val(offset_ptr, &(offset as isize))?;
+    }
+
+    Ok(SyscallReturn::Return(total_len as _))
+}
+
+/// Sends the data in the page cache of `in_file` to `out_file`.
+///
+/// The cached pages are written to `out_file` directly, so there is no need
+/// for an intermediate buffer. This method returns `Ok(None)` if `in_file` is
+/// not read through the page cache.
+fn send_cached_pages(
+    out_file: &dyn FileLike,
+    in_file: &dyn FileLike,
+    offset: Option<&mut usize>,
+    count: usize,
+) -> Result<Option<usize>> {
+    /// The maximum number of bytes referenced in the page cache at a time.
+    const MAX_BATCH_LEN: usize = 16 * PAGE_SIZE;
+
+    let Ok(inode_handle) = in_file.as_inode_or_err() else {
+        return Ok(None);
+    };
+
+    let mut pos = match offset.as_deref() {
+        Some(offset) => *offset,
+        None => inode_handle.offset(),
+    };
+    let mut total_len = 0;
+
+    while total_len < count {
+        let max_len = MAX_BATCH_LEN.min(count - total_len);
+
+        let pages = match inode_handle.cached_pages_at(pos, max_len) {
+            Ok(Some(pages)) => pages,
+            Ok(None) if total_len == 0 => return Ok(None),
+            Ok(None) => break,
+            Err(e) => {
+                if total_len > 0 {
+                    warn!("error occurs when trying to read file: {:?}", e);
+                    break;
+                }
+                return Err(e);
+            }
+        };
+        let pages_len: usize = pages.iter().map(|(_, range)| range.len()).sum();
+        if pages_len == 0 {
+            break;
+        }
+
+        // Note: `sendfile` allows sending partial data,
+        // so short reads and short writes are all acceptable
+        let mut written_len = 0;
+        let mut write_res = Ok(());
+        for (frame, range) in pages.iter() {
+            let mut reader = frame.reader();
+            reader.skip(range.start).limit(range.len());
+            match out_file.write(&mut reader.to_fallible()) {
+                Ok(len) => {
+                    written_len += len;
+                    if len < range.len() {
+                        break;
+                    }
+                }
+                Err(e) => {
+                    write_res = Err(e);
+                    break;
+                }
+            }
+        }
+        total_len += written_len;
+        pos += written_len;
+
+        if let Err(e) = write_res {
+            if total_len > 0 {
+                warn!("error occurs when trying to write file: {:?}", e);
+                break;
+            }
+            return Err(e);
+        }
+        if written_len < pages_len {
+            break;
+        }
+    }
+
+    match offset {
+        Some(offset) => *offset = pos,
+        None => {
+            inode_handle.seek(SeekFrom::Current(total_len as isize))?;
+        }
+    }
+
+    Ok(Some(total_len))
+}
+
+/// Sends the data of `in_file` to `out_file` through an intermediate buffer.
+fn send_with_buffer(
+    out_file: &dyn FileLike,
+    in_file: &dyn FileLike,
+    mut offset: Option<&mut usize>,
+    count: usize,
+) -> Result<usize> {
     const BUFFER_SIZE: usize = PAGE_SIZE;
     let mut buffer = vec![0u8; BUFFER_SIZE].into_boxed_slice();
     let mut total_len = 0;
-    let mut offset = offset.map(|offset| offset as usize);
 
     while total_len < count {
-        // The offset decides how to read from `in_file`.
-        // If offset is `Some(_)`, the data will be read from the given offset,
-        // and after reading, the file offset of `in_file` will remain unchanged.
-        // If offset is `None`, the data will be read from the file offset,
-        // and the file offset of `in_file` is adjusted
-        // to reflect the number of bytes read from `in_file`.
         let max_readlen = buffer.len().min(count - total_len);
 
         // Read from `in_file`
-        let read_res = if let Some(offset) = offset.as_mut() {
+        let read_res = if let Some(offset) = offset.as_deref_mut() {
             let res = in_file.read_bytes_at(*offset, &mut buffer[..max_readlen]);
             if let Ok(len) = res.as_ref() {
                 *offset += *len;
@@ -113,9 +233,5 @@ pub fn sys_sendfile(
         }
     }
 
-    if let Some(offset) = offset {
-        ctx.user_space().write_val(offset_ptr, &(offset as isize))?;
-    }
-
-    Ok(SyscallReturn::Return(total_len as _))
+    Ok(total_len)
 }
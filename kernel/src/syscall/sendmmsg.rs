@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use super::{sendmsg::send_one_message, SyscallReturn};
+use crate::{
+    fs::file_table::{get_file_fast, FileDesc},
+    net::socket::SendRecvFlags,
+    prelude::*,
+    util::net::CUserMMsgHdr,
+};
+
+/// The maximum number of the messages that can be sent or received in one syscall.
+pub(super) const UIO_MAXIOV: u32 = 1024;
+
+pub fn sys_sendmmsg(
+    sockfd: FileDesc,
+    user_mmsghdr_ptr: Vaddr,
+    vlen: u32,
+    flags: i32,
+    ctx: &Context,
+) -> Result<SyscallReturn> {
+    let flags = SendRecvFlags::from_bits_truncate(flags);
+    let vlen = vlen.min(UIO_MAXIOV) as usize;
+
+    debug!(
+        "sockfd = {}, user_mmsghdr = 0x{:x}, vlen = {}, flags = {:?}",
+        sockfd, user_mmsghdr_ptr, vlen, flags
+    );
+
+    let mut file_table = ctx.thread_local.borrow_file_table_mut();
+    // The socket file is owned so that the file table can be borrowed again to look up the files
+    // passed with each message.
+    let file = get_file_fast!(&mut file_table, sockfd).into_owned();
+    let socket = file.as_socket_or_err()?;
+
+    let user_space = ctx.user_space();
+    let mut nr_sent = 0;
+    while nr_sent < vlen {
+        let c_user_mmsghdr_ptr = user_mmsghdr_ptr + nr_sent * size_of::<CUserMMsgHdr>();
+        let mut c_user_mmsghdr: CUserMMsgHdr = user_space.read_val(c_user_mmsghdr_ptr)?;
+
+        let c_user_msghdr = &c_user_mmsghdr.msg_hdr;
+        let sent_bytes = match c_user_msghdr
+            .read_control_message_from_user(&mut file_table)
+            .and_then(|control_message| {
+                send_one_message(socket, c_user_msghdr, control_message, flags, ctx)
+            }) {
+            Ok(sent_bytes) => sent_bytes,
+            // The error is reported only if no messages are sent. Otherwise, the number of the
+            // sent messages is returned, and the error is expected to occur again in the
+            // subsequent call.
+            Err(err) if nr_sent == 0 => return Err(err),
+            Err(_) => break,
+        };
+
+        c_user_mmsghdr.msg_len = sent_bytes as u32;
+        user_space.write_val(c_user_mmsghdr_ptr, &c_user_mmsghdr)?;
+        nr_sent += 1;
+    }
+
+    Ok(SyscallReturn::Return(nr_sent as _))
+}
@@ -3,7 +3,7 @@
 use super::SyscallReturn;
 use crate::{
     fs::file_table::{get_file_fast, FileDesc},
-    net::socket::{MessageHeader, SendRecvFlags},
+    net::socket::{ControlMessage, MessageHeader, SendRecvFlags, Socket},
     prelude::*,
     util::net::CUserMsgHdr,
 };
@@ -23,32 +23,38 @@ pub fn sys_sendmsg(
     );
 
     let mut file_table = ctx.thread_local.borrow_file_table_mut();
+    // The files to pass must be looked up before the socket file borrows the file table.
+    let control_message = c_user_msghdr.read_control_message_from_user(&mut file_table)?;
     let file = get_file_fast!(&mut file_table, sockfd);
     let socket = file.as_socket_or_err()?;
 
+    let total_bytes = send_one_message(socket, &c_user_msghdr, control_message, flags, ctx)?;
+
+    Ok(SyscallReturn::Return(total_bytes as _))
+}
+
+/// Sends the message described by `c_user_msghdr` on the socket.
+///
+/// The control message should have been read from `c_user_msghdr` by the caller.
+pub(super) fn send_one_message(
+    socket: &dyn Socket,
+    c_user_msghdr: &CUserMsgHdr,
+    control_message: Option<ControlMessage>,
+    flags: SendRecvFlags,
+    ctx: &Context,
+) -> Result<usize> {
     let user_space = ctx.user_space();
     let (mut io_vec_reader, message_header) = {
         let addr = c_user_msghdr.read_socket_addr_from_user()?;
         let io_vec_reader = c_user_msghdr.copy_reader_array_from_user(&user_space)?;
-
-        let control_message = {
-            if c_user_msghdr.msg_control != 0 {
-                // TODO: support sending control message
-                warn!("control message is not supported now");
-            }
-            None
-        };
-
         (io_vec_reader, MessageHeader::new(addr, control_message))
     };
 
-    let total_bytes = socket
+    socket
         .sendmsg(&mut io_vec_reader, message_header, flags)
         .map_err(|err| match err.error() {
             // FIXME: `sendmsg` should not be restarted if a timeout has been set on the socket using `setsockopt`.
             Errno::EINTR => Error::new(Errno::ERESTARTSYS),
             _ => err,
-        })?;
-
-    Ok(SyscallReturn::Return(total_bytes as _))
+        })
 }
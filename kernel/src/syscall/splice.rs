@@ -0,0 +1,250 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use super::SyscallReturn;
+use crate::{
+    fs::{
+        file_handle::FileLike,
+        file_table::{FileDesc, WithFileTable},
+        pipe::{PipePage, PipeReader, PipeWriter},
+        utils::{SeekFrom, StatusFlags},
+    },
+    prelude::*,
+};
+
+pub fn sys_splice(
+    fd_in: FileDesc,
+    off_in_ptr: Vaddr,
+    fd_out: FileDesc,
+    off_out_ptr: Vaddr,
+    len: usize,
+    flags: u32,
+    ctx: &Context,
+) -> Result<SyscallReturn> {
+    let flags =
+        SpliceFlags::from_bits(flags).ok_or(Error::with_message(Errno::EINVAL, "invalid flags"))?;
+    debug!(
+        "fd_in = {}, off_in = 0x{:x}, fd_out = {}, off_out = 0x{:x}, len = 0x{:x}, flags = {:?}",
+        fd_in, off_in_ptr, fd_out, off_out_ptr, len, flags
+    );
+
+    let (in_file, out_file) = ctx
+        .thread_local
+        .borrow_file_table_mut()
+        .read_with(|inner| {
+            let in_file = inner.get_file(fd_in)?.clone();
+            let out_file = inner.get_file(fd_out)?.clone();
+            Ok::<_, Error>((in_file, out_file))
+        })?;
+
+    if len == 0 {
+        return Ok(SyscallReturn::Return(0));
+    }
+    let is_nonblocking = flags.contains(SpliceFlags::SPLICE_F_NONBLOCK);
+
+    let spliced_len = match (
+        in_file.downcast_ref::<PipeReader>(),
+        out_file.downcast_ref::<PipeWriter>(),
+    ) {
+        (Some(in_pipe), Some(out_pipe)) => {
+            if off_in_ptr != 0 || off_out_ptr != 0 {
+                return_errno_with_message!(Errno::ESPIPE, "pipes cannot have offsets");
+            }
+            if in_pipe.is_peer_of(out_pipe) {
+                return_errno_with_message!(Errno::EINVAL, "cannot splice a pipe to itself");
+            }
+            splice_pipe_to_pipe(in_pipe, out_pipe, len, is_nonblocking)?
+        }
+        (Some(in_pipe), None) => {
+            if off_in_ptr != 0 {
+                return_errno_with_message!(Errno::ESPIPE, "pipes cannot have offsets");
+            }
+            let mut offset = read_offset(off_out_ptr, ctx)?;
+            let spliced_len = splice_pipe_to_file(
+                in_pipe,
+                out_file.as_ref(),
+                offset.as_mut(),
+                len,
+                is_nonblocking,
+            )?;
+            write_offset(off_out_ptr, offset, ctx)?;
+            spliced_len
+        }
+        (None, Some(out_pipe)) => {
+            if off_out_ptr != 0 {
+                return_errno_with_message!(Errno::ESPIPE, "pipes cannot have offsets");
+            }
+            let mut offset = read_offset(off_in_ptr, ctx)?;
+            let spliced_len = splice_file_to_pipe(
+                in_file.as_ref(),
+                offset.as_mut(),
+                out_pipe,
+                len,
+                is_nonblocking,
+            )?;
+            write_offset(off_in_ptr, offset, ctx)?;
+            spliced_len
+        }
+        (None, None) => {
+            return_errno_with_message!(Errno::EINVAL, "neither of the files is a pipe");
+        }
+    };
+
+    Ok(SyscallReturn::Return(spliced_len as _))
+}
+
+/// Moves at most `len` bytes from `in_file` to `out_pipe`.
+///
+/// If `in_file` is read through the page cache, the cached pages are queued to
+/// the pipe by reference. Otherwise, the data are read into the pages of the
+/// pipe. The data are read from `offset` if it is given, and `offset` is then
+/// advanced. Otherwise, the data are read from the file offset of `in_file`.
+pub(super) fn splice_file_to_pipe(
+    in_file: &dyn FileLike,
+    offset: Option<&mut usize>,
+    out_pipe: &PipeWriter,
+    len: usize,
+    is_nonblocking: bool,
+) -> Result<usize> {
+    let is_nonblocking =
+        is_nonblocking || out_pipe.status_flags().contains(StatusFlags::O_NONBLOCK);
+
+    if let Ok(inode_handle) = in_file.as_inode_or_err() {
+        let pos = match offset.as_deref() {
+            Some(offset) => *offset,
+            None => inode_handle.offset(),
+        };
+        // There is no need to reference more pages than the pipe can hold.
+        let max_len = len.min(out_pipe.capacity());
+        if let Some(pages) = inode_handle.cached_pages_at(pos, max_len)? {
+            let pages: Vec<PipePage> = pages
+                .into_iter()
+                .map(|(frame, range)| PipePage::new(frame, range))
+                .collect();
+            if pages.is_empty() {
+                // The end of the file is reached.
+                return Ok(0);
+            }
+
+            let spliced_len = out_pipe.push_pages(&pages, is_nonblocking)?;
+            match offset {
+                Some(offset) => *offset += spliced_len,
+                None => {
+                    inode_handle.seek(SeekFrom::Current(spliced_len as isize))?;
+                }
+            }
+            return Ok(spliced_len);
+        }
+    }
+
+    let mut offset = offset;
+    out_pipe.write_with(len, is_nonblocking, |writer| {
+        let mut writer = writer.to_fallible();
+        match offset.as_deref_mut() {
+            Some(offset) => {
+                let read_len = in_file.read_at(*offset, &mut writer)?;
+                *offset += read_len;
+                Ok(read_len)
+            }
+            None => in_file.read(&mut writer),
+        }
+    })
+}
+
+/// Moves at most `len` bytes from `in_pipe` to `out_file`.
+///
+/// The data are written at `offset` if it is given, and `offset` is then
+/// advanced. Otherwise, the data are written at the file offset of `out_file`.
+fn splice_pipe_to_file(
+    in_pipe: &PipeReader,
+    out_file: &dyn FileLike,
+    mut offset: Option<&mut usize>,
+    len: usize,
+    is_nonblocking: bool,
+) -> Result<usize> {
+    in_pipe.consume_with(len, is_nonblocking, |page| {
+        let mut reader = page.reader().to_fallible();
+        match offset.as_deref_mut() {
+            Some(offset) => {
+                let written_len = out_file.write_at(*offset, &mut reader)?;
+                *offset += written_len;
+                Ok(written_len)
+            }
+            None => out_file.write(&mut reader),
+        }
+    })
+}
+
+/// Moves at most `len` bytes from `in_pipe` to `out_pipe` by reference.
+fn splice_pipe_to_pipe(
+    in_pipe: &PipeReader,
+    out_pipe: &PipeWriter,
+    len: usize,
+    is_nonblocking: bool,
+) -> Result<usize> {
+    transfer_between_pipes(in_pipe, out_pipe, is_nonblocking, || {
+        in_pipe.consume_with(len, true, |page| {
+            out_pipe.push_pages(core::slice::from_ref(page), true)
+        })
+    })
+}
+
+/// Performs `try_transfer` between two pipes, which fails with `EAGAIN` if
+/// `in_pipe` is empty or `out_pipe` is full.
+///
+/// The transfer is retried until it succeeds or fails with other errors,
+/// unless `is_nonblocking` is true or one of the pipes is opened with
+/// `O_NONBLOCK`.
+pub(super) fn transfer_between_pipes<F>(
+    in_pipe: &PipeReader,
+    out_pipe: &PipeWriter,
+    is_nonblocking: bool,
+    mut try_transfer: F,
+) -> Result<usize>
+where
+    F: FnMut() -> Result<usize>,
+{
+    let is_nonblocking = is_nonblocking
+        || (in_pipe.status_flags() | out_pipe.status_flags()).contains(StatusFlags::O_NONBLOCK);
+
+    loop {
+        match try_transfer() {
+            Err(err) if err.error() == Errno::EAGAIN && !is_nonblocking => (),
+            result => return result,
+        }
+
+        in_pipe.wait_readable()?;
+        out_pipe.wait_writable()?;
+    }
+}
+
+fn read_offset(offset_ptr: Vaddr, ctx: &Context) -> Result<Option<usize>> {
+    if offset_ptr == 0 {
+        return Ok(None);
+    }
+
+    let offset: i64 = ctx.user_space().read_val(offset_ptr)?;
+    if offset < 0 {
+        return_errno_with_message!(Errno::EINVAL, "offset cannot be negative");
+    }
+    Ok(Some(offset as usize))
+}
+
+fn write_offset(offset_ptr: Vaddr, offset: Option<usize>, ctx: &Context) -> Result<()> {
+    if let Some(offset) = offset {
+        ctx.user_space().write_val(offset_ptr, &(offset as i64))?;
+    }
+    Ok(())
+}
+
+bitflags! {
+    pub(super) struct SpliceFlags: u32 {
+        /// A hint to move pages instead of copying them.
+        const SPLICE_F_MOVE = 1;
+        /// Do not block on the pipe operations.
+        const SPLICE_F_NONBLOCK = 2;
+        /// A hint that more data will be sent.
+        const SPLICE_F_MORE = 4;
+        /// A hint to gift the user pages to the pipe.
+        const SPLICE_F_GIFT = 8;
+    }
+}
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! The per-syscall statistics of the counts and the latencies.
+//!
+//! The latencies are measured in TSC cycles from the entry to the exit of
+//! [`handle_syscall`](super::handle_syscall), and are recorded in histograms
+//! whose buckets cover the powers of two. The syscalls that never return,
+//! e.g., `exit`, are not recorded.
+
+use core::sync::atomic::{AtomicU64, Ordering};
+
+use super::arch::{NR_SYSCALLS, SYSCALL_NAMES};
+use crate::prelude::*;
+
+/// The number of the buckets in a latency histogram.
+///
+/// The `i`-th bucket counts the latencies in `[2^i, 2^(i+1))` cycles, and the
+/// last bucket also counts all the longer ones.
+pub const NR_LATENCY_BUCKETS: usize = 32;
+
+struct AtomicSyscallStat {
+    count: AtomicU64,
+    total_cycles: AtomicU64,
+    histogram: [AtomicU64; NR_LATENCY_BUCKETS],
+}
+
+impl AtomicSyscallStat {
+    const fn new() -> Self {
+        Self {
+            count: AtomicU64::new(0),
+            total_cycles: AtomicU64::new(0),
+            histogram: [const { AtomicU64::new(0) }; NR_LATENCY_BUCKETS],
+        }
+    }
+}
+
+static STATS: [AtomicSyscallStat; NR_SYSCALLS] = [const { AtomicSyscallStat::new() }; NR_SYSCALLS];
+
+/// Records a syscall that started at `start_cycles`.
+pub(super) fn record(syscall_number: u64, start_cycles: u64) {
+    let Some(stat) = STATS.get(syscall_number as usize) else {
+        return;
+    };
+
+    let cycles = ostd::arch::read_tsc().saturating_sub(start_cycles);
+    let bucket = (cycles.max(1).ilog2() as usize).min(NR_LATENCY_BUCKETS - 1);
+
+    stat.count.fetch_add(1, Ordering::Relaxed);
+    stat.total_cycles.fetch_add(cycles, Ordering::Relaxed);
+    stat.histogram[bucket].fetch_add(1, Ordering::Relaxed);
+}
+
+/// The statistics of a syscall.
+#[derive(Debug, Clone)]
+pub struct SyscallStat {
+    /// The name of the syscall, e.g., `read`.
+    pub name: String,
+    /// The number of times that the syscall has been handled.
+    pub count: u64,
+    /// The total latency of the syscall in TSC cycles.
+    pub total_cycles: u64,
+    /// The latency histogram of the syscall.
+    pub histogram: [u64; NR_LATENCY_BUCKETS],
+}
+
+/// Returns the statistics of the syscalls that have been handled at least once.
+pub fn syscall_stats() -> Vec<SyscallStat> {
+    STATS
+        .iter()
+        .zip(SYSCALL_NAMES.iter())
+        .filter_map(|(stat, name)| {
+            let count = stat.count.load(Ordering::Relaxed);
+            if count == 0 {
+                return None;
+            }
+            let name = name.unwrap_or("unknown");
+            Some(SyscallStat {
+                name: name
+                    .strip_prefix("SYS_")
+                    .unwrap_or(name)
+                    .to_ascii_lowercase(),
+                count,
+                total_cycles: stat.total_cycles.load(Ordering::Relaxed),
+                histogram: stat
+                    .histogram
+                    .each_ref()
+                    .map(|bucket| bucket.load(Ordering::Relaxed)),
+            })
+        })
+        .collect()
+}
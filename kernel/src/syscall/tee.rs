@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use super::{
+    splice::{transfer_between_pipes, SpliceFlags},
+    SyscallReturn,
+};
+use crate::{
+    fs::{
+        file_table::{FileDesc, WithFileTable},
+        pipe::{PipeReader, PipeWriter},
+    },
+    prelude::*,
+};
+
+pub fn sys_tee(
+    fd_in: FileDesc,
+    fd_out: FileDesc,
+    len: usize,
+    flags: u32,
+    ctx: &Context,
+) -> Result<SyscallReturn> {
+    let flags =
+        SpliceFlags::from_bits(flags).ok_or(Error::with_message(Errno::EINVAL, "invalid flags"))?;
+    debug!(
+        "fd_in = {}, fd_out = {}, len = 0x{:x}, flags = {:?}",
+        fd_in, fd_out, len, flags
+    );
+
+    let (in_file, out_file) = ctx
+        .thread_local
+        .borrow_file_table_mut()
+        .read_with(|inner| {
+            let in_file = inner.get_file(fd_in)?.clone();
+            let out_file = inner.get_file(fd_out)?.clone();
+            Ok::<_, Error>((in_file, out_file))
+        })?;
+
+    let (Some(in_pipe), Some(out_pipe)) = (
+        in_file.downcast_ref::<PipeReader>(),
+        out_file.downcast_ref::<PipeWriter>(),
+    ) else {
+        return_errno_with_message!(Errno::EINVAL, "the files are not pipes");
+    };
+    if in_pipe.is_peer_of(out_pipe) {
+        return_errno_with_message!(Errno::EINVAL, "cannot duplicate a pipe to itself");
+    }
+
+    if len == 0 {
+        return Ok(SyscallReturn::Return(0));
+    }
+
+    // The pages are shared by the two pipes without being copied.
+    let is_nonblocking = flags.contains(SpliceFlags::SPLICE_F_NONBLOCK);
+    let duplicated_len = transfer_between_pipes(in_pipe, out_pipe, is_nonblocking, || {
+        in_pipe.peek_with(len, true, |page| {
+            out_pipe.push_pages(core::slice::from_ref(page), true)
+        })
+    })?;
+
+    Ok(SyscallReturn::Return(duplicated_len as _))
+}
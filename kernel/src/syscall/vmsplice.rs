@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use super::{splice::SpliceFlags, SyscallReturn};
+use crate::{
+    fs::{
+        file_table::{get_file_fast, FileDesc},
+        pipe::{PipeReader, PipeWriter},
+    },
+    prelude::*,
+    util::{MultiRead, MultiWrite, VmReaderArray, VmWriterArray},
+};
+
+pub fn sys_vmsplice(
+    fd: FileDesc,
+    io_vec_ptr: Vaddr,
+    io_vec_count: usize,
+    flags: u32,
+    ctx: &Context,
+) -> Result<SyscallReturn> {
+    let flags =
+        SpliceFlags::from_bits(flags).ok_or(Error::with_message(Errno::EINVAL, "invalid flags"))?;
+    debug!(
+        "fd = {}, io_vec_ptr = 0x{:x}, io_vec_count = 0x{:x}, flags = {:?}",
+        fd, io_vec_ptr, io_vec_count, flags
+    );
+
+    let mut file_table = ctx.thread_local.borrow_file_table_mut();
+    let file = get_file_fast!(&mut file_table, fd);
+
+    let is_nonblocking = flags.contains(SpliceFlags::SPLICE_F_NONBLOCK);
+    let user_space = ctx.user_space();
+
+    // The user pages are always copied, even if `SPLICE_F_GIFT` is specified. Gifting the pages
+    // to the pipe would require unmapping them from the user space, which is hardly cheaper
+    // than copying them for the typical sizes of pipes.
+    let len = if let Some(pipe_writer) = file.downcast_ref::<PipeWriter>() {
+        let mut reader_array =
+            VmReaderArray::from_user_io_vecs(&user_space, io_vec_ptr, io_vec_count)?;
+        let len = reader_array.sum_lens();
+        pipe_writer.write_with(len, is_nonblocking, |mut writer| {
+            reader_array.read(&mut writer)
+        })?
+    } else if let Some(pipe_reader) = file.downcast_ref::<PipeReader>() {
+        let mut writer_array =
+            VmWriterArray::from_user_io_vecs(&user_space, io_vec_ptr, io_vec_count)?;
+        let len = writer_array.sum_lens();
+        pipe_reader.consume_with(len, is_nonblocking, |page| {
+            writer_array.write(&mut page.reader())
+        })?
+    } else {
+        return_errno_with_message!(Errno::EBADF, "the file is not a pipe");
+    };
+
+    Ok(SyscallReturn::Return(len as _))
+}
@@ -6,6 +6,7 @@ use core::sync::atomic::Ordering;
 
 use ostd::{
     cpu::{AtomicCpuSet, CpuSet},
+    mm::VmSpace,
     task::Task,
 };
 
@@ -27,12 +28,17 @@ pub type Tid = u32;
 fn post_schedule_handler() {
     let task = Task::current().unwrap();
     let Some(thread_local) = task.as_thread_local() else {
+        // Kernel threads never access the user space, so the last activated
+        // `VmSpace` can be kept without receiving its TLB flush requests.
+        VmSpace::enter_lazy_tlb();
         return;
     };
 
     let root_vmar = thread_local.root_vmar().borrow();
     if let Some(vmar) = root_vmar.as_ref() {
         vmar.vm_space().activate()
+    } else {
+        VmSpace::enter_lazy_tlb();
     }
 }
 
@@ -88,6 +94,19 @@ impl Thread {
         self.task.upgrade().unwrap()
     }
 
+    /// Returns the task associated with this thread, or `None` if the task
+    /// has been dropped after the thread exited.
+    pub fn try_task(&self) -> Option<Arc<Task>> {
+        self.task.upgrade()
+    }
+
+    /// Returns the number of times that this thread has been switched to a CPU.
+    ///
+    /// This function returns zero if the task of this thread has been dropped.
+    pub fn nr_switches(&self) -> u64 {
+        self.task.upgrade().map_or(0, |task| task.nr_switches())
+    }
+
     /// Runs this thread at once.
     #[track_caller]
     pub fn run(&self) {
@@ -16,6 +16,13 @@
 //! `WorkItems`. The `Worker` is responsible for processing these submitted tasks,
 //! and the `WorkerPool` manages and schedules these workers.
 //!
+//! The workers of the global high-priority and normal pools are bound to CPUs, and a work
+//! item is handled on the CPU where it is submitted if its CPU affinity allows. When the
+//! workers of a CPU make no progress while work items are pending, e.g., because they are
+//! blocked, more workers are added to keep the work items flowing. The long-running work
+//! items should be submitted to the global unbound pool instead, whose workers may run on
+//! any CPU.
+//!
 //! # Examples
 //!
 //! The system has a default work queue and worker pool,
@@ -64,13 +71,18 @@
 //!
 //! ```
 
+use core::{
+    sync::atomic::{AtomicU64, Ordering},
+    time::Duration,
+};
+
 use intrusive_collections::linked_list::LinkedList;
-use ostd::cpu::{CpuId, CpuSet};
+use ostd::cpu::{current_cpu_racy, CpuSet};
 use spin::Once;
 use work_item::{WorkItem, WorkItemAdapter};
 use worker_pool::WorkerPool;
 
-use crate::prelude::*;
+use crate::{prelude::*, time::clocks::MonotonicClock};
 
 mod simple_scheduler;
 pub mod work_item;
@@ -79,8 +91,10 @@ pub mod worker_pool;
 
 static WORKERPOOL_NORMAL: Once<Arc<WorkerPool>> = Once::new();
 static WORKERPOOL_HIGH_PRI: Once<Arc<WorkerPool>> = Once::new();
+static WORKERPOOL_UNBOUND: Once<Arc<WorkerPool>> = Once::new();
 static WORKQUEUE_GLOBAL_NORMAL: Once<Arc<WorkQueue>> = Once::new();
 static WORKQUEUE_GLOBAL_HIGH_PRI: Once<Arc<WorkQueue>> = Once::new();
+static WORKQUEUE_GLOBAL_UNBOUND: Once<Arc<WorkQueue>> = Once::new();
 
 /// Submit a function to a global work queue.
 pub fn submit_work_func<F>(work_func: F, work_priority: WorkPriority)
@@ -105,72 +119,195 @@ pub fn submit_work_item(work_item: Arc<WorkItem>, work_priority: WorkPriority) -
     }
 }
 
+/// Submit a function to the global unbound work queue.
+pub fn submit_unbound_work_func<F>(work_func: F)
+where
+    F: Fn() + Send + Sync + 'static,
+{
+    let work_item = WorkItem::new(Box::new(work_func));
+    submit_unbound_work_item(work_item);
+}
+
+/// Submit a work item to the global unbound work queue.
+///
+/// The work items in the unbound queue are handled by workers that are not bound to any
+/// CPU. This suits the long-running work items, which would otherwise delay the other work
+/// items submitted on the same CPU.
+pub fn submit_unbound_work_item(work_item: Arc<WorkItem>) -> bool {
+    WORKQUEUE_GLOBAL_UNBOUND.get().unwrap().enqueue(work_item)
+}
+
 /// A work queue maintains a series of work items to be handled
 /// asynchronously in a process context.
+///
+/// The pending work items are kept in one list for each local pool of the worker pool,
+/// so the workers of different CPUs do not contend for the same list.
 pub struct WorkQueue {
     worker_pool: Weak<WorkerPool>,
-    inner: SpinLock<WorkQueueInner>,
+    pending_work_items: Box<[SpinLock<LinkedList<WorkItemAdapter>>]>,
+    stats: AtomicWorkQueueStats,
+}
+
+/// The statistics of a work queue.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct WorkQueueStats {
+    /// The number of the submitted work items.
+    pub nr_submitted: u64,
+    /// The number of the completed work items.
+    pub nr_completed: u64,
+    /// The total time that the completed work items waited in the queue.
+    pub total_latency: Duration,
+    /// The maximum time that a completed work item waited in the queue.
+    pub max_latency: Duration,
+    /// The total time that the work functions of the completed work items ran.
+    pub total_run_time: Duration,
 }
 
-struct WorkQueueInner {
-    pending_work_items: LinkedList<WorkItemAdapter>,
+#[derive(Default)]
+struct AtomicWorkQueueStats {
+    nr_submitted: AtomicU64,
+    nr_completed: AtomicU64,
+    total_latency_ns: AtomicU64,
+    max_latency_ns: AtomicU64,
+    total_run_time_ns: AtomicU64,
 }
 
 impl WorkQueue {
     /// Create a `WorkQueue` and specify a `WorkerPool` to
     /// process the submitted `WorkItems`.
     pub fn new(worker_pool: Weak<WorkerPool>) -> Arc<Self> {
+        let pool = worker_pool.upgrade().unwrap();
+        let pending_work_items = (0..pool.nr_local_pools())
+            .map(|_| SpinLock::new(LinkedList::new(WorkItemAdapter::NEW)))
+            .collect();
         let queue = Arc::new(WorkQueue {
-            worker_pool: worker_pool.clone(),
-            inner: SpinLock::new(WorkQueueInner {
-                pending_work_items: LinkedList::new(WorkItemAdapter::NEW),
-            }),
+            worker_pool,
+            pending_work_items,
+            stats: AtomicWorkQueueStats::default(),
         });
-        worker_pool
-            .upgrade()
-            .unwrap()
-            .assign_work_queue(queue.clone());
+        pool.assign_work_queue(queue.clone());
         queue
     }
 
-    /// Submit a work item. Return `false` if the work item is currently pending.
+    /// Submit a work item. Return `false` if the work item is currently pending,
+    /// or if the work item cannot run on any CPU of the worker pool.
+    ///
+    /// The work item is handled by the workers of the current CPU if possible.
     pub fn enqueue(&self, work_item: Arc<WorkItem>) -> bool {
-        if !work_item.try_pending() {
+        let Some(worker_pool) = self.worker_pool.upgrade() else {
             return false;
-        }
-        self.inner
-            .disable_irq()
-            .lock()
-            .pending_work_items
-            .push_back(work_item);
+        };
+        let Some(local_index) = self.push_work_item(&worker_pool, work_item) else {
+            return false;
+        };
+        worker_pool.notify(local_index);
 
         true
     }
 
-    /// Request a pending work item. The `request_cpu` indicates the CPU where
-    /// the calling worker is located.
-    fn dequeue(&self, request_cpu: CpuId) -> Option<Arc<WorkItem>> {
-        let mut inner = self.inner.disable_irq().lock();
-        let mut cursor = inner.pending_work_items.front_mut();
-        while let Some(item) = cursor.get() {
-            if item.is_valid_cpu(request_cpu) {
-                return cursor.remove();
+    /// Submit a batch of work items. Return the number of the submitted work items.
+    ///
+    /// The workers are notified once for each local pool that receives work items,
+    /// rather than once for each work item.
+    pub fn enqueue_batch<I>(&self, work_items: I) -> usize
+    where
+        I: IntoIterator<Item = Arc<WorkItem>>,
+    {
+        let Some(worker_pool) = self.worker_pool.upgrade() else {
+            return 0;
+        };
+
+        let mut nr_submitted = 0;
+        let mut notified_indices = Vec::new();
+        for work_item in work_items {
+            let Some(local_index) = self.push_work_item(&worker_pool, work_item) else {
+                continue;
+            };
+            nr_submitted += 1;
+            if !notified_indices.contains(&local_index) {
+                notified_indices.push(local_index);
             }
+        }
+        for local_index in notified_indices {
+            worker_pool.notify(local_index);
+        }
 
-            cursor.move_next();
+        nr_submitted
+    }
+
+    /// Returns the statistics of the work queue.
+    pub fn stats(&self) -> WorkQueueStats {
+        WorkQueueStats {
+            nr_submitted: self.stats.nr_submitted.load(Ordering::Relaxed),
+            nr_completed: self.stats.nr_completed.load(Ordering::Relaxed),
+            total_latency: Duration::from_nanos(
+                self.stats.total_latency_ns.load(Ordering::Relaxed),
+            ),
+            max_latency: Duration::from_nanos(self.stats.max_latency_ns.load(Ordering::Relaxed)),
+            total_run_time: Duration::from_nanos(
+                self.stats.total_run_time_ns.load(Ordering::Relaxed),
+            ),
+        }
+    }
+
+    /// Pushes a work item to the list of the selected local pool, whose index is returned.
+    fn push_work_item(&self, worker_pool: &WorkerPool, work_item: Arc<WorkItem>) -> Option<usize> {
+        if !work_item.try_pending() {
+            return None;
         }
+        let Some(local_index) = worker_pool.select_local_pool(&work_item, current_cpu_racy())
+        else {
+            work_item.set_processing();
+            return None;
+        };
 
-        None
+        work_item.set_submit_time(now_nanos());
+        self.pending_work_items[local_index]
+            .disable_irq()
+            .lock()
+            .push_back(work_item);
+        self.stats.nr_submitted.fetch_add(1, Ordering::Relaxed);
+
+        Some(local_index)
     }
 
-    fn has_pending_work_items(&self, request_cpu: CpuId) -> bool {
-        self.inner
+    /// Request a pending work item. The `local_index` indicates the local pool where
+    /// the calling worker is located.
+    fn dequeue(&self, local_index: usize) -> Option<Arc<WorkItem>> {
+        self.pending_work_items[local_index]
             .disable_irq()
             .lock()
-            .pending_work_items
-            .iter()
-            .any(|item| item.is_valid_cpu(request_cpu))
+            .pop_front()
     }
+
+    fn has_pending_work_items(&self, local_index: usize) -> bool {
+        !self.pending_work_items[local_index]
+            .disable_irq()
+            .lock()
+            .is_empty()
+    }
+
+    /// Runs a work item fetched from the work queue and accounts it.
+    fn run_work_item(&self, work_item: &WorkItem) {
+        let start_time = now_nanos();
+        let latency = start_time.saturating_sub(work_item.submit_time());
+
+        work_item.set_processing();
+        work_item.call_work_func();
+
+        let run_time = now_nanos().saturating_sub(start_time);
+        let stats = &self.stats;
+        stats.nr_completed.fetch_add(1, Ordering::Relaxed);
+        stats.total_latency_ns.fetch_add(latency, Ordering::Relaxed);
+        stats.max_latency_ns.fetch_max(latency, Ordering::Relaxed);
+        stats
+            .total_run_time_ns
+            .fetch_add(run_time, Ordering::Relaxed);
+    }
+}
+
+fn now_nanos() -> u64 {
+    MonotonicClock::get().read_time().as_nanos() as u64
 }
 
 /// Initialize global worker pools and work queues.
@@ -185,10 +322,17 @@ pub fn init() {
         WorkerPool::new(WorkPriority::High, cpu_set)
     });
     WORKERPOOL_HIGH_PRI.get().unwrap().run();
+    WORKERPOOL_UNBOUND.call_once(|| {
+        let cpu_set = CpuSet::new_full();
+        WorkerPool::new_unbound(WorkPriority::Normal, cpu_set)
+    });
+    WORKERPOOL_UNBOUND.get().unwrap().run();
     WORKQUEUE_GLOBAL_NORMAL
         .call_once(|| WorkQueue::new(Arc::downgrade(WORKERPOOL_NORMAL.get().unwrap())));
     WORKQUEUE_GLOBAL_HIGH_PRI
         .call_once(|| WorkQueue::new(Arc::downgrade(WORKERPOOL_HIGH_PRI.get().unwrap())));
+    WORKQUEUE_GLOBAL_UNBOUND
+        .call_once(|| WorkQueue::new(Arc::downgrade(WORKERPOOL_UNBOUND.get().unwrap())));
 }
 
 impl Drop for WorkQueue {
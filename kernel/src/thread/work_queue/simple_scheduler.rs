@@ -5,9 +5,11 @@ use alloc::sync::Weak;
 use super::worker_pool::{WorkerPool, WorkerScheduler};
 
 /// SimpleScheduler is the simplest scheduling implementation.
-/// Only when there is a liveness problem in the workerpool, increase the workers,
-/// set the upper limit of the workers, and do not actively reduce the workers.
-/// And it only adds one worker at a time for each scheduling.
+/// Only when there is a liveness problem in a local pool, i.e., its workers have made no
+/// progress for a whole period while there are pending work items, which suggests that the
+/// workers are blocked, increase the workers, and set the upper limit of the workers.
+/// It only adds one worker at a time for each scheduling, and it only removes one idle
+/// worker at a time when there are too many of them.
 pub struct SimpleScheduler {
     worker_pool: Weak<WorkerPool>,
 }
@@ -20,16 +22,35 @@ impl SimpleScheduler {
 
 const WORKER_LIMIT: u16 = 16;
 
+/// The number of idle workers kept in a local pool.
+const IDLE_WORKER_LIMIT: u16 = 2;
+
 impl WorkerScheduler for SimpleScheduler {
     fn schedule(&self) {
         let worker_pool = self.worker_pool.upgrade().unwrap();
-        for cpu_id in worker_pool.cpu_set().iter() {
-            if !worker_pool.heartbeat(cpu_id)
-                && worker_pool.has_pending_work_items(cpu_id)
-                && !worker_pool.wake_worker(cpu_id)
-                && worker_pool.num_workers(cpu_id) < WORKER_LIMIT
+        for local_index in 0..worker_pool.nr_local_pools() {
+            if !worker_pool.has_pending_work_items(local_index) {
+                if worker_pool.num_idle_workers(local_index) > IDLE_WORKER_LIMIT {
+                    worker_pool.remove_worker(local_index);
+                }
+                continue;
+            }
+            if !worker_pool.heartbeat(local_index)
+                && !worker_pool.wake_worker(local_index)
+                && worker_pool.num_workers(local_index) < WORKER_LIMIT
+            {
+                worker_pool.add_worker(local_index);
+            }
+        }
+    }
+
+    fn schedule_urgent(&self) {
+        let worker_pool = self.worker_pool.upgrade().unwrap();
+        for local_index in 0..worker_pool.nr_local_pools() {
+            if worker_pool.num_workers(local_index) == 0
+                && worker_pool.has_pending_work_items(local_index)
             {
-                worker_pool.add_worker(cpu_id);
+                worker_pool.add_worker(local_index);
             }
         }
     }
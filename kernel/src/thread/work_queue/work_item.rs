@@ -2,7 +2,7 @@
 
 #![expect(dead_code)]
 
-use core::sync::atomic::{AtomicBool, Ordering};
+use core::sync::atomic::{AtomicBool, AtomicU64, Ordering};
 
 use intrusive_collections::{intrusive_adapter, LinkedListAtomicLink};
 use ostd::cpu::{CpuId, CpuSet};
@@ -14,6 +14,8 @@ pub struct WorkItem {
     work_func: Box<dyn Fn() + Send + Sync>,
     cpu_affinity: CpuSet,
     was_pending: AtomicBool,
+    /// The time in nanoseconds when the work item was last submitted.
+    submit_time: AtomicU64,
     link: LinkedListAtomicLink,
 }
 
@@ -26,6 +28,7 @@ impl WorkItem {
             work_func,
             cpu_affinity,
             was_pending: AtomicBool::new(false),
+            submit_time: AtomicU64::new(0),
             link: LinkedListAtomicLink::new(),
         })
     }
@@ -60,6 +63,14 @@ impl WorkItem {
             .is_ok()
     }
 
+    pub(super) fn set_submit_time(&self, nanos: u64) {
+        self.submit_time.store(nanos, Ordering::Relaxed);
+    }
+
+    pub(super) fn submit_time(&self) -> u64 {
+        self.submit_time.load(Ordering::Relaxed)
+    }
+
     pub(super) fn call_work_func(&self) {
         self.work_func.call(())
     }
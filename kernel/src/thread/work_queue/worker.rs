@@ -2,10 +2,7 @@
 
 #![expect(dead_code)]
 
-use ostd::{
-    cpu::{CpuId, CpuSet},
-    task::Task,
-};
+use ostd::{cpu::CpuSet, task::Task};
 
 use super::worker_pool::WorkerPool;
 use crate::{
@@ -15,13 +12,14 @@ use crate::{
 };
 
 /// A worker thread. A `Worker` will attempt to retrieve unfinished
-/// work items from its corresponding `WorkerPool`. If there are none,
-/// it will go to sleep and be rescheduled when a new work item is
-/// added to the `WorkerPool`.
+/// work items from its corresponding local pool in the `WorkerPool`. If
+/// there are none, it will go to sleep and be woken up when a new work
+/// item is added to the local pool.
 pub(super) struct Worker {
     worker_pool: Weak<WorkerPool>,
     bound_task: Arc<Task>,
-    bound_cpu: CpuId,
+    /// The index of the local pool that the worker belongs to.
+    local_index: usize,
     inner: SpinLock<WorkerInner>,
 }
 
@@ -40,16 +38,20 @@ enum WorkerStatus {
 }
 
 impl Worker {
-    /// Creates a new `Worker` to the given `worker_pool`.
-    pub(super) fn new(worker_pool: Weak<WorkerPool>, bound_cpu: CpuId) -> Arc<Self> {
+    /// Creates a new `Worker` to the local pool of the given `worker_pool`.
+    ///
+    /// The worker runs only on the CPUs in `cpu_affinity`.
+    pub(super) fn new(
+        worker_pool: Weak<WorkerPool>,
+        local_index: usize,
+        cpu_affinity: CpuSet,
+    ) -> Arc<Self> {
         Arc::new_cyclic(|worker_ref| {
             let weal_worker = worker_ref.clone();
             let task_fn = Box::new(move || {
                 let current_worker: Arc<Worker> = weal_worker.upgrade().unwrap();
                 current_worker.run_worker_loop();
             });
-            let mut cpu_affinity = CpuSet::new_empty();
-            cpu_affinity.add(bound_cpu);
             let sched_policy =
                 SchedPolicy::Fair(if worker_pool.upgrade().unwrap().is_high_priority() {
                     Nice::MIN
@@ -63,7 +65,7 @@ impl Worker {
             Self {
                 worker_pool,
                 bound_task,
-                bound_cpu,
+                local_index,
                 inner: SpinLock::new(WorkerInner {
                     worker_status: WorkerStatus::Running,
                 }),
@@ -84,19 +86,17 @@ impl Worker {
             let Some(worker_pool) = worker_pool else {
                 break;
             };
-            if let Some(work_item) = worker_pool.fetch_pending_work_item(self.bound_cpu) {
-                work_item.set_processing();
-                work_item.call_work_func();
-                worker_pool.set_heartbeat(self.bound_cpu, true);
+            if let Some((work_queue, work_item)) =
+                worker_pool.fetch_pending_work_item(self.local_index)
+            {
+                work_queue.run_work_item(&work_item);
+                worker_pool.set_heartbeat(self.local_index, true);
             } else {
-                if self.is_destroying() {
+                if !self.try_idle() {
                     break;
                 }
-                self.inner.disable_irq().lock().worker_status = WorkerStatus::Idle;
-                worker_pool.idle_current_worker(self.bound_cpu, self.clone());
-                if !self.is_destroying() {
-                    self.inner.disable_irq().lock().worker_status = WorkerStatus::Running;
-                }
+                worker_pool.idle_current_worker(self.local_index, self.clone());
+                self.try_run();
             }
         }
         self.exit();
@@ -110,6 +110,27 @@ impl Worker {
         self.inner.disable_irq().lock().worker_status == WorkerStatus::Idle
     }
 
+    /// Marks the worker as idle, unless it is being destroyed.
+    fn try_idle(&self) -> bool {
+        let mut inner = self.inner.disable_irq().lock();
+        if inner.worker_status == WorkerStatus::Destroying {
+            return false;
+        }
+        inner.worker_status = WorkerStatus::Idle;
+        true
+    }
+
+    /// Marks the worker as running, unless it is being destroyed.
+    ///
+    /// The check and the update are done atomically, so that a worker that
+    /// is destroyed while it is woken up will not miss the destruction.
+    fn try_run(&self) {
+        let mut inner = self.inner.disable_irq().lock();
+        if inner.worker_status != WorkerStatus::Destroying {
+            inner.worker_status = WorkerStatus::Running;
+        }
+    }
+
     pub(super) fn is_destroying(&self) -> bool {
         self.inner.disable_irq().lock().worker_status == WorkerStatus::Destroying
     }
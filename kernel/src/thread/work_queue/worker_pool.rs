@@ -3,12 +3,12 @@
 #![expect(dead_code)]
 
 use core::{
-    sync::atomic::{AtomicBool, Ordering},
+    sync::atomic::{AtomicBool, AtomicUsize, Ordering},
     time::Duration,
 };
 
 use ostd::{
-    cpu::{CpuId, CpuSet},
+    cpu::{num_cpus, CpuId, CpuSet},
     sync::WaitQueue,
     task::Task,
 };
@@ -18,14 +18,20 @@ use crate::{
     prelude::*,
     sched::{Nice, SchedPolicy},
     thread::{kernel_thread::ThreadOptions, AsThread},
+    time::clocks::MonotonicClock,
 };
 
 /// A pool of workers.
 ///
-/// The `WorkerPool` maintains workers created from different CPUs, while clustering workers
-/// from the same CPU into a `LocalWorkerPool` for better management.
+/// The workers of a `WorkerPool` are clustered into `LocalWorkerPool`s. A bound pool has
+/// one local pool for each CPU, whose workers only run on that CPU. So the work items
+/// submitted on a CPU are handled on the same CPU, and the deferred work scales with the
+/// number of CPUs. An unbound pool has a single local pool, whose workers run on any CPU
+/// of the pool, which suits the long-running work items.
 pub struct WorkerPool {
     local_pools: Vec<Arc<LocalWorkerPool>>,
+    /// The index of the local pool that serves each CPU, indexed by the CPU ID.
+    local_indices: Vec<Option<usize>>,
     /// Monitor invokes `schedule()` in WorkerScheduler to determine whether there is a need for
     /// adding or removing workers.
     monitor: Arc<Monitor>,
@@ -35,9 +41,11 @@ pub struct WorkerPool {
     work_queues: SpinLock<Vec<Arc<WorkQueue>>>,
 }
 
-/// A set of workers for a specific CPU.
+/// A set of workers that serve the same CPUs.
 pub struct LocalWorkerPool {
-    cpu_id: CpuId,
+    index: usize,
+    /// The CPUs on which the workers run.
+    cpu_affinity: CpuSet,
     idle_wait_queue: WaitQueue,
     parent: Weak<WorkerPool>,
     /// A liveness check for LocalWorkerPool. The monitor periodically clears heartbeat,
@@ -45,6 +53,8 @@ pub struct LocalWorkerPool {
     /// an active worker. If there is no heartbeats and there are still pending work items,
     /// it suggests that more workers are needed.
     heartbeat: AtomicBool,
+    nr_workers: AtomicUsize,
+    nr_idle_workers: AtomicUsize,
     workers: SpinLock<VecDeque<Arc<Worker>>>,
 }
 
@@ -56,32 +66,45 @@ pub struct LocalWorkerPool {
 pub trait WorkerScheduler: Sync + Send {
     /// Schedule workers in a worker pool. This needs to solve two problems: when to increase or decrease
     /// workers, and how to add or remove workers to keep the number of workers in a reasonable range.
+    ///
+    /// This is invoked periodically.
     fn schedule(&self);
+
+    /// Schedule workers in a worker pool when work items are submitted to a local pool that
+    /// has no worker yet.
+    fn schedule_urgent(&self);
 }
 
 /// The `Monitor` is responsible for monitoring the `WorkerPool` for scheduling needs.
 ///
-/// Currently, it only performs a liveness check, and attempts to schedule when no workers
-/// are found processing in the pool.
+/// It performs a liveness check periodically, and attempts to schedule when no workers
+/// are found processing in the pool. It also schedules on request, when work items are
+/// submitted but there is no worker to handle them.
 pub struct Monitor {
     worker_pool: Weak<WorkerPool>,
     bound_task: Arc<Task>,
+    request_wait_queue: WaitQueue,
+    is_requested: AtomicBool,
 }
 
 impl LocalWorkerPool {
-    fn new(worker_pool: Weak<WorkerPool>, cpu_id: CpuId) -> Self {
+    fn new(worker_pool: Weak<WorkerPool>, index: usize, cpu_affinity: CpuSet) -> Self {
         LocalWorkerPool {
-            cpu_id,
+            index,
+            cpu_affinity,
             idle_wait_queue: WaitQueue::new(),
             parent: worker_pool,
             heartbeat: AtomicBool::new(false),
+            nr_workers: AtomicUsize::new(0),
+            nr_idle_workers: AtomicUsize::new(0),
             workers: SpinLock::new(VecDeque::new()),
         }
     }
 
     fn add_worker(&self) {
-        let worker = Worker::new(self.parent.clone(), self.cpu_id);
+        let worker = Worker::new(self.parent.clone(), self.index, self.cpu_affinity.clone());
         self.workers.disable_irq().lock().push_back(worker.clone());
+        self.nr_workers.fetch_add(1, Ordering::Relaxed);
         worker.bound_task().as_thread().unwrap().run();
     }
 
@@ -91,9 +114,14 @@ impl LocalWorkerPool {
             if worker.is_idle() {
                 worker.destroy();
                 workers.remove(index);
+                self.nr_workers.fetch_sub(1, Ordering::Relaxed);
                 break;
             }
         }
+        drop(workers);
+
+        // The destroyed worker checks its status once it is woken up.
+        self.idle_wait_queue.wake_all();
     }
 
     fn wake_worker(&self) -> bool {
@@ -104,7 +132,7 @@ impl LocalWorkerPool {
         self.parent
             .upgrade()
             .unwrap()
-            .has_pending_work_items(self.cpu_id)
+            .has_pending_work_items(self.index)
     }
 
     fn heartbeat(&self) -> bool {
@@ -116,8 +144,10 @@ impl LocalWorkerPool {
     }
 
     fn idle_current_worker(&self, worker: Arc<Worker>) {
+        self.nr_idle_workers.fetch_add(1, Ordering::Relaxed);
         self.idle_wait_queue
             .wait_until(|| (worker.is_destroying() || self.has_pending_work_items()).then_some(0));
+        self.nr_idle_workers.fetch_sub(1, Ordering::Relaxed);
     }
 
     fn destroy_all_workers(&self) {
@@ -129,14 +159,46 @@ impl LocalWorkerPool {
 }
 
 impl WorkerPool {
+    /// Creates a bound pool, which has a local pool for each CPU in `cpu_set`.
     pub fn new(priority: WorkPriority, cpu_set: CpuSet) -> Arc<Self> {
+        let local_cpu_sets = cpu_set
+            .iter()
+            .map(|cpu_id| {
+                let mut local_cpu_set = CpuSet::new_empty();
+                local_cpu_set.add(cpu_id);
+                local_cpu_set
+            })
+            .collect();
+        Self::new_with_local_cpu_sets(priority, cpu_set, local_cpu_sets)
+    }
+
+    /// Creates an unbound pool, whose workers run on any CPU in `cpu_set`.
+    pub fn new_unbound(priority: WorkPriority, cpu_set: CpuSet) -> Arc<Self> {
+        let local_cpu_sets = vec![cpu_set.clone()];
+        Self::new_with_local_cpu_sets(priority, cpu_set, local_cpu_sets)
+    }
+
+    fn new_with_local_cpu_sets(
+        priority: WorkPriority,
+        cpu_set: CpuSet,
+        local_cpu_sets: Vec<CpuSet>,
+    ) -> Arc<Self> {
         Arc::new_cyclic(|pool_ref| {
             let mut local_pools = Vec::new();
-            for cpu_id in cpu_set.iter() {
-                local_pools.push(Arc::new(LocalWorkerPool::new(pool_ref.clone(), cpu_id)));
+            let mut local_indices = vec![None; num_cpus()];
+            for (index, local_cpu_set) in local_cpu_sets.into_iter().enumerate() {
+                for cpu_id in local_cpu_set.iter() {
+                    local_indices[cpu_id.as_usize()] = Some(index);
+                }
+                local_pools.push(Arc::new(LocalWorkerPool::new(
+                    pool_ref.clone(),
+                    index,
+                    local_cpu_set,
+                )));
             }
             WorkerPool {
                 local_pools,
+                local_indices,
                 monitor: Monitor::new(pool_ref.clone(), &priority),
                 priority,
                 cpu_set,
@@ -154,69 +216,112 @@ impl WorkerPool {
         self.work_queues.disable_irq().lock().push(work_queue);
     }
 
-    pub fn has_pending_work_items(&self, request_cpu: CpuId) -> bool {
+    pub fn has_pending_work_items(&self, local_index: usize) -> bool {
         self.work_queues
             .disable_irq()
             .lock()
             .iter()
-            .any(|work_queue| work_queue.has_pending_work_items(request_cpu))
+            .any(|work_queue| work_queue.has_pending_work_items(local_index))
     }
 
     pub fn schedule(&self) {
         self.scheduler.schedule();
     }
 
-    pub fn num_workers(&self, cpu_id: CpuId) -> u16 {
-        self.local_pool(cpu_id).workers.disable_irq().lock().len() as u16
+    pub fn schedule_urgent(&self) {
+        self.scheduler.schedule_urgent();
+    }
+
+    /// Returns the number of the local pools.
+    pub fn nr_local_pools(&self) -> usize {
+        self.local_pools.len()
+    }
+
+    pub fn num_workers(&self, local_index: usize) -> u16 {
+        self.local_pools[local_index]
+            .nr_workers
+            .load(Ordering::Relaxed) as u16
+    }
+
+    pub fn num_idle_workers(&self, local_index: usize) -> u16 {
+        self.local_pools[local_index]
+            .nr_idle_workers
+            .load(Ordering::Relaxed) as u16
     }
 
     pub fn cpu_set(&self) -> &CpuSet {
         &self.cpu_set
     }
 
-    pub(super) fn fetch_pending_work_item(&self, request_cpu: CpuId) -> Option<Arc<WorkItem>> {
-        for work_queue in self.work_queues.disable_irq().lock().iter() {
-            let item = work_queue.dequeue(request_cpu);
-            if item.is_some() {
-                return item;
+    /// Selects the local pool to handle the work item submitted on `current_cpu`.
+    ///
+    /// The local pool of the current CPU is preferred if the work item can run on the
+    /// current CPU. Returns `None` if no CPU of the pool is allowed by the work item.
+    pub(super) fn select_local_pool(
+        &self,
+        work_item: &WorkItem,
+        current_cpu: CpuId,
+    ) -> Option<usize> {
+        if work_item.is_valid_cpu(current_cpu) {
+            if let Some(index) = self.local_indices[current_cpu.as_usize()] {
+                return Some(index);
             }
         }
-        None
+        work_item
+            .cpu_affinity()
+            .iter()
+            .find_map(|cpu_id| self.local_indices[cpu_id.as_usize()])
     }
 
-    fn local_pool(&self, cpu_id: CpuId) -> &Arc<LocalWorkerPool> {
-        self.local_pools
-            .iter()
-            .find(|local_pool: &&Arc<LocalWorkerPool>| local_pool.cpu_id == cpu_id)
-            .unwrap()
+    /// Notifies the local pool that work items are submitted to it.
+    ///
+    /// An idle worker is woken up. If the local pool has no worker yet, the monitor is
+    /// requested to add one.
+    pub(super) fn notify(&self, local_index: usize) {
+        let local_pool = &self.local_pools[local_index];
+        if !local_pool.wake_worker() && local_pool.nr_workers.load(Ordering::Relaxed) == 0 {
+            self.monitor.request();
+        }
     }
 
-    pub(super) fn wake_worker(&self, cpu_id: CpuId) -> bool {
-        self.local_pool(cpu_id).wake_worker()
+    pub(super) fn fetch_pending_work_item(
+        &self,
+        local_index: usize,
+    ) -> Option<(Arc<WorkQueue>, Arc<WorkItem>)> {
+        for work_queue in self.work_queues.disable_irq().lock().iter() {
+            if let Some(item) = work_queue.dequeue(local_index) {
+                return Some((work_queue.clone(), item));
+            }
+        }
+        None
+    }
+
+    pub(super) fn wake_worker(&self, local_index: usize) -> bool {
+        self.local_pools[local_index].wake_worker()
     }
 
-    pub(super) fn add_worker(&self, cpu_id: CpuId) {
-        self.local_pool(cpu_id).add_worker();
+    pub(super) fn add_worker(&self, local_index: usize) {
+        self.local_pools[local_index].add_worker();
     }
 
-    pub(super) fn remove_worker(&self, cpu_id: CpuId) {
-        self.local_pool(cpu_id).remove_worker();
+    pub(super) fn remove_worker(&self, local_index: usize) {
+        self.local_pools[local_index].remove_worker();
     }
 
     pub(super) fn is_high_priority(&self) -> bool {
         self.priority == WorkPriority::High
     }
 
-    pub(super) fn heartbeat(&self, cpu_id: CpuId) -> bool {
-        self.local_pool(cpu_id).heartbeat()
+    pub(super) fn heartbeat(&self, local_index: usize) -> bool {
+        self.local_pools[local_index].heartbeat()
     }
 
-    pub(super) fn set_heartbeat(&self, cpu_id: CpuId, heartbeat: bool) {
-        self.local_pool(cpu_id).set_heartbeat(heartbeat)
+    pub(super) fn set_heartbeat(&self, local_index: usize, heartbeat: bool) {
+        self.local_pools[local_index].set_heartbeat(heartbeat)
     }
 
-    pub(super) fn idle_current_worker(&self, cpu_id: CpuId, worker: Arc<Worker>) {
-        self.local_pool(cpu_id).idle_current_worker(worker);
+    pub(super) fn idle_current_worker(&self, local_index: usize, worker: Arc<Worker>) {
+        self.local_pools[local_index].idle_current_worker(worker);
     }
 }
 
@@ -248,6 +353,8 @@ impl Monitor {
             Self {
                 worker_pool,
                 bound_task,
+                request_wait_queue: WaitQueue::new(),
+                is_requested: AtomicBool::new(false),
             }
         })
     }
@@ -256,19 +363,43 @@ impl Monitor {
         self.bound_task.as_thread().unwrap().run()
     }
 
+    /// Requests the monitor to schedule the workers as soon as possible.
+    fn request(&self) {
+        if !self.is_requested.swap(true, Ordering::AcqRel) {
+            self.request_wait_queue.wake_one();
+        }
+    }
+
     fn run_monitor_loop(self: &Arc<Self>) {
-        let sleep_queue = WaitQueue::new();
-        let sleep_duration = Duration::from_millis(100);
+        let period = Duration::from_millis(100);
+        let mut next_period = MonotonicClock::get().read_time();
         loop {
             let worker_pool = self.worker_pool.upgrade();
             let Some(worker_pool) = worker_pool else {
                 break;
             };
-            worker_pool.schedule();
-            for local_pool in worker_pool.local_pools.iter() {
-                local_pool.set_heartbeat(false);
+
+            let now = MonotonicClock::get().read_time();
+            if now >= next_period {
+                worker_pool.schedule();
+                for local_pool in worker_pool.local_pools.iter() {
+                    local_pool.set_heartbeat(false);
+                }
+                next_period = now + period;
+            } else {
+                worker_pool.schedule_urgent();
             }
-            let _ = sleep_queue.wait_until_or_timeout(|| -> Option<()> { None }, &sleep_duration);
+            drop(worker_pool);
+
+            let timeout = next_period.saturating_sub(MonotonicClock::get().read_time());
+            let _ = self.request_wait_queue.wait_until_or_timeout(
+                || {
+                    self.is_requested
+                        .swap(false, Ordering::AcqRel)
+                        .then_some(())
+                },
+                &timeout,
+            );
         }
     }
 }
@@ -4,7 +4,13 @@ use alloc::sync::Arc;
 use core::time::Duration;
 
 use aster_time::read_monotonic_time;
-use ostd::{cpu::PinCurrentCpu, cpu_local, sync::SpinLock, task::disable_preempt, timer::Jiffies};
+use ostd::{
+    cpu::{CpuId, PinCurrentCpu},
+    cpu_local,
+    sync::SpinLock,
+    task::disable_preempt,
+    timer::Jiffies,
+};
 use paste::paste;
 use spin::Once;
 
@@ -143,6 +149,9 @@ impl BootTimeClock {
     }
 }
 
+/// The resolution of the clocks that are computed from the clocksource, in nanoseconds.
+const HIGH_RESOLUTION_NANOS: u64 = 1;
+
 impl Clock for JiffiesClock {
     fn read_time(&self) -> Duration {
         Jiffies::elapsed().as_duration()
@@ -155,12 +164,20 @@ impl Clock for RealTimeClock {
             .duration_since(&SystemTime::UNIX_EPOCH)
             .unwrap()
     }
+
+    fn resolution(&self) -> u64 {
+        HIGH_RESOLUTION_NANOS
+    }
 }
 
 impl Clock for MonotonicClock {
     fn read_time(&self) -> Duration {
         read_monotonic_time()
     }
+
+    fn resolution(&self) -> u64 {
+        HIGH_RESOLUTION_NANOS
+    }
 }
 
 impl Clock for RealTimeCoarseClock {
@@ -179,12 +196,20 @@ impl Clock for MonotonicRawClock {
     fn read_time(&self) -> Duration {
         read_monotonic_time()
     }
+
+    fn resolution(&self) -> u64 {
+        HIGH_RESOLUTION_NANOS
+    }
 }
 
 impl Clock for BootTimeClock {
     fn read_time(&self) -> Duration {
         read_monotonic_time()
     }
+
+    fn resolution(&self) -> u64 {
+        HIGH_RESOLUTION_NANOS
+    }
 }
 
 /// Define the system-wide clocks.
@@ -225,10 +250,17 @@ macro_rules! define_timer_managers {
         fn _init_system_wide_timer_managers() {
             $(
                 let clock = paste! {[<$clock_id _INSTANCE>].get().unwrap().clone()};
-                let timer_manager = TimerManager::new(clock);
+                let local_manager: fn() -> &'static Arc<TimerManager> = || {
+                    let preempt_guard = ostd::task::disable_preempt();
+                    let cpu = preempt_guard.current_cpu();
+                    paste! {
+                        [<$clock_id _MANAGER>].get_on_cpu(cpu).get().unwrap()
+                    }
+                };
                 for cpu in ostd::cpu::all_cpus() {
+                    let timer_manager = TimerManager::new_cpu_local(clock.clone(), local_manager);
                     paste! {
-                        [<$clock_id _MANAGER>].get_on_cpu(cpu).call_once(|| timer_manager.clone());
+                        [<$clock_id _MANAGER>].get_on_cpu(cpu).call_once(|| timer_manager);
                     }
                 }
                 let callback = || {
@@ -241,6 +273,16 @@ macro_rules! define_timer_managers {
                 time::softirq::register_callback(callback);
             )*
         }
+
+        fn _local_timer_managers(cpu: CpuId) -> impl Iterator<Item = &'static Arc<TimerManager>> {
+            [$(
+                paste! {
+                    [<$clock_id _MANAGER>].get_on_cpu(cpu).get()
+                },
+            )*]
+            .into_iter()
+            .flatten()
+        }
     }
 }
 
@@ -282,6 +324,19 @@ fn init_jiffies_clock_manager() {
     time::softirq::register_callback(callback);
 }
 
+/// Returns the number of ticks until the earliest timer that the current CPU
+/// should process may expire, or `None` if there are no such timers.
+///
+/// An idle CPU can sleep for this number of ticks without delaying any timer.
+pub fn ticks_until_next_timer() -> Option<u64> {
+    let preempt_guard = disable_preempt();
+    let cpu = preempt_guard.current_cpu();
+    _local_timer_managers(cpu)
+        .chain(JIFFIES_TIMER_MANAGER.get())
+        .filter_map(|timer_manager| timer_manager.ticks_until_next_expiry())
+        .min()
+}
+
 fn update_coarse_clock() {
     let real_time = RealTimeClock::get().read_time();
     let current = RealTimeCoarseClock::current_ref().get().unwrap();
@@ -6,6 +6,7 @@ use aster_time::NANOS_PER_SECOND;
 use ostd::arch::timer::TIMER_FREQ;
 
 pub mod timer;
+mod wheel;
 
 type Nanos = u64;
 
@@ -4,16 +4,16 @@ use alloc::{
     boxed::Box,
     collections::BinaryHeap,
     sync::{Arc, Weak},
-    vec::Vec,
 };
 use core::{
     sync::atomic::{AtomicBool, Ordering},
     time::Duration,
 };
 
-use ostd::sync::SpinLock;
+use aster_time::NANOS_PER_SECOND;
+use ostd::{arch::timer::TIMER_FREQ, sync::SpinLock};
 
-use super::Clock;
+use super::{wheel::TimerWheel, Clock};
 
 /// A timeout, represented in one of the two ways.
 #[derive(Debug, Clone)]
@@ -94,7 +94,9 @@ impl Timer {
             timer_callback.cancel();
         }
         *timer_callback = Arc::downgrade(&new_timer_callback);
-        self.timer_manager.insert(new_timer_callback);
+        self.timer_manager
+            .arming_manager()
+            .insert(new_timer_callback);
     }
 
     /// Return the current expired time of this timer.
@@ -146,17 +148,67 @@ fn interval_timer_callback(timer: &Weak<Timer>) {
 ///
 /// These created `Timer`s will hold an `Arc` pointer to this manager, hence this manager
 /// will be actually dropped after all the created timers have been dropped.
+///
+/// The timers that expire within a few ticks are kept sorted and expire precisely. The others
+/// are kept in a hierarchical timing wheel (see [`TimerWheel`]), which takes O(1) time to insert a
+/// timer and expires it at the first tick after its expired time.
 pub struct TimerManager {
     clock: Arc<dyn Clock>,
-    timer_callbacks: SpinLock<BinaryHeap<Arc<TimerCallback>>>,
+    timer_callbacks: SpinLock<TimerQueue>,
+    local_manager: Option<fn() -> &'static Arc<TimerManager>>,
+}
+
+struct TimerQueue {
+    precise: BinaryHeap<Arc<TimerCallback>>,
+    wheel: TimerWheel<Arc<TimerCallback>>,
+}
+
+/// The timers that expire within this number of ticks are kept precisely.
+const PRECISE_TICKS: u64 = 4;
+
+/// The length of a tick in nanoseconds.
+const TICK_NANOS: u64 = NANOS_PER_SECOND as u64 / TIMER_FREQ;
+
+/// Converts a time to the first tick that is not earlier than it.
+fn tick_after(time: Duration) -> u64 {
+    (time.as_nanos() as u64).div_ceil(TICK_NANOS)
+}
+
+/// Converts a time to the last tick that is not later than it.
+fn tick_before(time: Duration) -> u64 {
+    time.as_nanos() as u64 / TICK_NANOS
 }
 
 impl TimerManager {
     /// Create a `TimerManager` instance from a clock.
     pub fn new(clock: Arc<dyn Clock>) -> Arc<Self> {
+        Self::new_inner(clock, None)
+    }
+
+    /// Creates a `TimerManager` instance that is one of the CPU-local managers of a clock.
+    ///
+    /// `local_manager` returns the manager of the current CPU. A timer is always armed on the
+    /// manager of the CPU that arms it, so its expiry is handled by that CPU without contending
+    /// for the lock of other managers.
+    pub fn new_cpu_local(
+        clock: Arc<dyn Clock>,
+        local_manager: fn() -> &'static Arc<TimerManager>,
+    ) -> Arc<Self> {
+        Self::new_inner(clock, Some(local_manager))
+    }
+
+    fn new_inner(
+        clock: Arc<dyn Clock>,
+        local_manager: Option<fn() -> &'static Arc<TimerManager>>,
+    ) -> Arc<Self> {
+        let current_tick = tick_before(clock.read_time());
         Arc::new(Self {
             clock,
-            timer_callbacks: SpinLock::new(BinaryHeap::new()),
+            timer_callbacks: SpinLock::new(TimerQueue {
+                precise: BinaryHeap::new(),
+                wheel: TimerWheel::new(current_tick),
+            }),
+            local_manager,
         })
     }
 
@@ -176,30 +228,48 @@ impl TimerManager {
         }
     }
 
+    /// Returns the manager on which the timers of this manager should be armed.
+    fn arming_manager(&self) -> &TimerManager {
+        match self.local_manager {
+            Some(local_manager) => local_manager(),
+            None => self,
+        }
+    }
+
     fn insert(&self, timer_callback: Arc<TimerCallback>) {
-        self.timer_callbacks
-            .disable_irq()
-            .lock()
-            .push(timer_callback);
+        let now_tick = tick_before(self.clock.read_time());
+        let expiry_tick = tick_after(timer_callback.expired_time);
+
+        let mut timer_queue = self.timer_callbacks.disable_irq().lock();
+        if expiry_tick < now_tick + PRECISE_TICKS {
+            timer_queue.precise.push(timer_callback);
+        } else {
+            timer_queue.wheel.reset_if_empty(now_tick);
+            timer_queue.wheel.insert(expiry_tick, timer_callback);
+        }
     }
 
     /// Check the managed timers, and if any have timed out,
     /// call the corresponding callback functions.
     pub fn process_expired_timers(&self) {
         let callbacks = {
-            let mut timeout_list = self.timer_callbacks.disable_irq().lock();
-            if timeout_list.len() == 0 {
+            let mut timer_queue = self.timer_callbacks.disable_irq().lock();
+            if timer_queue.precise.is_empty() && timer_queue.wheel.len() == 0 {
                 return;
             }
 
-            let mut callbacks = Vec::new();
             let current_time = self.clock.read_time();
-            while let Some(t) = timeout_list.peek() {
+            let mut callbacks = timer_queue
+                .wheel
+                .advance(tick_before(current_time), |t| t.is_cancelled());
+
+            let precise = &mut timer_queue.precise;
+            while let Some(t) = precise.peek() {
                 if t.is_cancelled() {
                     // Just ignore the cancelled callback
-                    timeout_list.pop();
+                    precise.pop();
                 } else if t.expired_time <= current_time {
-                    callbacks.push(timeout_list.pop().unwrap());
+                    callbacks.push(precise.pop().unwrap());
                 } else {
                     break;
                 }
@@ -212,6 +282,23 @@ impl TimerManager {
         }
     }
 
+    /// Returns the number of ticks until the earliest managed timer may expire,
+    /// or `None` if there are no timers.
+    ///
+    /// The result may be earlier than the actual expiry, but never later.
+    pub fn ticks_until_next_expiry(&self) -> Option<u64> {
+        let next_expiry = {
+            let timer_queue = self.timer_callbacks.disable_irq().lock();
+            let precise = timer_queue.precise.peek().map(|t| t.expired_time);
+            let wheel = (timer_queue.wheel.next_expiry_tick())
+                .map(|tick| Duration::from_nanos(tick.saturating_mul(TICK_NANOS)));
+            precise.into_iter().chain(wheel).min()?
+        };
+
+        let now = self.clock.read_time();
+        Some(tick_before(next_expiry.saturating_sub(now)))
+    }
+
     /// Create an [`Timer`], which will be managed by this `TimerManager`.
     pub fn create_timer<F>(self: &Arc<Self>, function: F) -> Arc<Timer>
     where
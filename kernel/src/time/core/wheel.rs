@@ -0,0 +1,271 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! A hierarchical timing wheel.
+//!
+//! The wheel has five levels. The first level has 256 slots of one tick each,
+//! and every following level has 64 slots, each of which covers a whole
+//! rotation of the previous level. An entry is placed in the level whose span
+//! covers its distance to the current tick, so inserting an entry is O(1).
+//! When the first level completes a rotation, the due slot of the next level
+//! is cascaded, i.e., its entries are redistributed into the lower levels.
+
+use alloc::vec::Vec;
+
+const LEVEL0_BITS: u32 = 8;
+const LEVEL_BITS: u32 = 6;
+const NR_LEVELS: usize = 5;
+
+/// The maximum distance in ticks that the wheel can represent.
+///
+/// Entries further in the future are kept in the last level and are cascaded
+/// again until they come within reach.
+const MAX_DISTANCE: u64 = (1 << (LEVEL0_BITS + LEVEL_BITS * (NR_LEVELS as u32 - 1))) - 1;
+
+pub(super) struct TimerWheel<T> {
+    /// The next tick to be processed.
+    current_tick: u64,
+    levels: [Level<T>; NR_LEVELS],
+    len: usize,
+}
+
+struct Level<T> {
+    /// The slots, which are allocated on the first insertion.
+    slots: Vec<Vec<(u64, T)>>,
+    len: usize,
+}
+
+impl<T> Level<T> {
+    const fn new() -> Self {
+        Self {
+            slots: Vec::new(),
+            len: 0,
+        }
+    }
+}
+
+impl<T> TimerWheel<T> {
+    /// Creates an empty wheel whose next tick to be processed is `current_tick`.
+    pub(super) const fn new(current_tick: u64) -> Self {
+        Self {
+            current_tick,
+            levels: [
+                Level::new(),
+                Level::new(),
+                Level::new(),
+                Level::new(),
+                Level::new(),
+            ],
+            len: 0,
+        }
+    }
+
+    /// Returns the number of entries in the wheel.
+    pub(super) fn len(&self) -> usize {
+        self.len
+    }
+
+    /// Returns a tick that is not later than the earliest expiry of the
+    /// entries, or `None` if the wheel is empty.
+    ///
+    /// The result is exact for the entries in the first level. For the other
+    /// levels, it is the tick at which the earliest non-empty slot is
+    /// cascaded.
+    pub(super) fn next_expiry_tick(&self) -> Option<u64> {
+        let mut next = None;
+        for (level, slots) in self.levels.iter().enumerate() {
+            if slots.len == 0 {
+                continue;
+            }
+
+            let shift = level_shift(level);
+            let first = self.current_tick.next_multiple_of(1 << shift);
+            let nr_slots = nr_slots(level) as u64;
+            let due = (0..nr_slots).map(|i| first + (i << shift)).find(|tick| {
+                let index = (tick >> shift) & (nr_slots - 1);
+                !slots.slots[index as usize].is_empty()
+            });
+            if let Some(due) = due {
+                next = Some(next.map_or(due, |next: u64| next.min(due)));
+            }
+        }
+        next
+    }
+
+    /// Moves the wheel to `tick` if it is empty.
+    ///
+    /// This avoids walking through the ticks that have passed while there
+    /// was nothing to expire.
+    pub(super) fn reset_if_empty(&mut self, tick: u64) {
+        if self.len == 0 {
+            self.current_tick = tick;
+        }
+    }
+
+    /// Inserts an entry that expires at `expiry_tick`.
+    ///
+    /// If `expiry_tick` has already been processed, the entry expires at the
+    /// next tick to be processed.
+    pub(super) fn insert(&mut self, expiry_tick: u64, entry: T) {
+        let expiry_tick = expiry_tick.max(self.current_tick);
+        self.insert_entry(expiry_tick, entry);
+        self.len += 1;
+    }
+
+    fn insert_entry(&mut self, expiry_tick: u64, entry: T) {
+        let distance = expiry_tick - self.current_tick;
+
+        let (level, index) = if distance < (1 << LEVEL0_BITS) {
+            (0, expiry_tick & ((1 << LEVEL0_BITS) - 1))
+        } else {
+            let mut level = 1;
+            while level < NR_LEVELS - 1 && distance >= 1 << level_shift(level + 1) {
+                level += 1;
+            }
+            let position = if distance > MAX_DISTANCE {
+                self.current_tick + MAX_DISTANCE
+            } else {
+                expiry_tick
+            };
+            (
+                level,
+                (position >> level_shift(level)) & ((1 << LEVEL_BITS) - 1),
+            )
+        };
+
+        let nr_slots = nr_slots(level);
+        let level = &mut self.levels[level];
+        if level.slots.is_empty() {
+            level.slots.resize_with(nr_slots, Vec::new);
+        }
+        level.slots[index as usize].push((expiry_tick, entry));
+        level.len += 1;
+    }
+
+    /// Processes all the ticks up to and including `now_tick` and returns
+    /// the entries that have expired.
+    ///
+    /// The entries for which `is_stale` returns true are dropped instead of
+    /// being cascaded or returned.
+    pub(super) fn advance<F>(&mut self, now_tick: u64, is_stale: F) -> Vec<T>
+    where
+        F: Fn(&T) -> bool,
+    {
+        let mut expired = Vec::new();
+
+        while self.current_tick <= now_tick {
+            if self.len == 0 {
+                self.current_tick = now_tick + 1;
+                break;
+            }
+
+            // Skip to the next tick at which a slot is due if the lower levels are empty.
+            if self.levels[0].len == 0 {
+                let mut shift = LEVEL0_BITS;
+                let mut level = 1;
+                while level < NR_LEVELS - 1 && self.levels[level].len == 0 {
+                    shift += LEVEL_BITS;
+                    level += 1;
+                }
+                let mask = (1 << shift) - 1;
+                if self.current_tick & mask != 0 {
+                    self.current_tick = ((self.current_tick | mask) + 1).min(now_tick + 1);
+                    continue;
+                }
+            }
+
+            let index = self.current_tick & ((1 << LEVEL0_BITS) - 1);
+            if index == 0 {
+                let mut level = 1;
+                while level < NR_LEVELS && self.cascade(level, &is_stale) == 0 {
+                    level += 1;
+                }
+            }
+
+            let level0 = &mut self.levels[0];
+            if level0.len != 0 {
+                let slot = core::mem::take(&mut level0.slots[index as usize]);
+                level0.len -= slot.len();
+                self.len -= slot.len();
+                expired.extend(
+                    slot.into_iter()
+                        .map(|(_, entry)| entry)
+                        .filter(|entry| !is_stale(entry)),
+                );
+            }
+
+            self.current_tick += 1;
+        }
+
+        expired
+    }
+
+    /// Redistributes the due slot of `level` into the lower levels and returns
+    /// the index of the slot.
+    fn cascade<F>(&mut self, level: usize, is_stale: &F) -> u64
+    where
+        F: Fn(&T) -> bool,
+    {
+        let index = (self.current_tick >> level_shift(level)) & ((1 << LEVEL_BITS) - 1);
+
+        let level = &mut self.levels[level];
+        if level.len == 0 {
+            return index;
+        }
+        let slot = core::mem::take(&mut level.slots[index as usize]);
+        level.len -= slot.len();
+
+        for (expiry_tick, entry) in slot {
+            if is_stale(&entry) {
+                self.len -= 1;
+            } else {
+                self.insert_entry(expiry_tick, entry);
+            }
+        }
+
+        index
+    }
+}
+
+/// Returns the number of bits of a tick below the slot index of `level`.
+const fn level_shift(level: usize) -> u32 {
+    if level == 0 {
+        0
+    } else {
+        LEVEL0_BITS + LEVEL_BITS * (level as u32 - 1)
+    }
+}
+
+const fn nr_slots(level: usize) -> usize {
+    if level == 0 {
+        1 << LEVEL0_BITS
+    } else {
+        1 << LEVEL_BITS
+    }
+}
+
+#[cfg(ktest)]
+mod test {
+    use ostd::prelude::*;
+
+    use super::*;
+
+    #[ktest]
+    fn next_expiry_tick() {
+        let mut wheel = TimerWheel::new(100);
+        assert_eq!(wheel.next_expiry_tick(), None);
+
+        // A far entry is cascaded not later than its expiry.
+        wheel.insert(100_000, ());
+        let cascade_tick = wheel.next_expiry_tick().unwrap();
+        assert!((100..=100_000).contains(&cascade_tick));
+
+        // A near entry is exact.
+        wheel.insert(150, ());
+        assert_eq!(wheel.next_expiry_tick(), Some(150));
+
+        assert_eq!(wheel.advance(150, |_| false).len(), 1);
+        assert_eq!(wheel.next_expiry_tick(), Some(cascade_tick));
+        assert_eq!(wheel.advance(100_000, |_| false).len(), 1);
+        assert_eq!(wheel.next_expiry_tick(), None);
+    }
+}
@@ -121,6 +121,7 @@ impl<'a> From<Option<ManagedTimeout<'a>>> for TimeoutExt<'a> {
 }
 
 /// A [`Timeout`] with the associated [`TimerManager`].
+#[derive(Clone)]
 pub struct ManagedTimeout<'a> {
     timeout: Timeout,
     manager: &'a Arc<TimerManager>,
@@ -0,0 +1,331 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! The control and the export of the static tracepoints.
+//!
+//! The tracepoints of OSTD and the kernel (see [`ostd::trace`]) are controlled
+//! through the attributes of `/sys/kernel/tracing`:
+//!
+//! - `set_event` is written with the names of the events to enable, separated
+//!   by whitespaces. A name prefixed with `!` disables the event instead, and
+//!   `none` disables all the events.
+//! - `trace_pipe` is read to pop the records in text, one line for each
+//!   record:
+//!
+//!   ```text
+//!   <cpu> <timestamp in ns> <event>: <field>=<value> ...
+//!   ```
+//!
+//! - `trace_pipe_raw` is read to pop the records in binary, each of which is
+//!   [`RAW_RECORD_SIZE`] bytes in little endian: the timestamp in TSC cycles
+//!   (`u64`), the CPU (`u32`), the event (`u32`), and the arguments
+//!   (`[u64; MAX_TRACE_ARGS]`).
+//!
+//! Reading a pipe consumes the records that fit in the buffer, and returns
+//! zero if there is no record.
+
+use alloc::borrow::Cow;
+use core::{any::Any, fmt::Write};
+
+use aster_systree::{
+    Error as SysTreeError, Result as SysTreeResult, SysAttrFlags, SysAttrSet, SysAttrSetBuilder,
+    SysBranchNode, SysBranchNodeFields, SysNode, SysNodeId, SysNodeType, SysNormalNodeFields,
+    SysObj, SysStr,
+};
+use ostd::{
+    arch::tsc_freq,
+    cpu::CpuId,
+    mm::{FallibleVmRead, FallibleVmWrite, VmReader, VmWriter},
+    trace::{self, TraceEvent, TraceRecord, MAX_TRACE_ARGS},
+};
+
+use crate::prelude::*;
+
+/// The size of a record read from `trace_pipe_raw`.
+pub const RAW_RECORD_SIZE: usize = 16 + 8 * MAX_TRACE_ARGS;
+
+/// The maximum number of bytes that a read of a pipe returns.
+///
+/// The records are formatted with a spin lock held, so the buffer is
+/// allocated beforehand and bounded.
+const MAX_READ_LEN: usize = 64 * 1024;
+
+/// The maximum length of the event names written to `set_event` at once.
+const MAX_SET_EVENT_LEN: usize = 1024;
+
+pub(super) fn init() {
+    let kernel_node = KernelNode::new();
+    kernel_node
+        .fields
+        .add_child(TracingNode::new())
+        .expect("the tracing node is added twice");
+    aster_systree::singleton()
+        .root()
+        .add_child(kernel_node)
+        .expect("`/sys/kernel` is registered twice");
+}
+
+/// The `/sys/kernel` directory.
+#[derive(Debug)]
+struct KernelNode {
+    fields: SysBranchNodeFields<dyn SysObj>,
+    self_ref: Weak<Self>,
+}
+
+impl KernelNode {
+    fn new() -> Arc<Self> {
+        Arc::new_cyclic(|weak_self| Self {
+            fields: SysBranchNodeFields::new(Cow::Borrowed("kernel"), SysAttrSet::new_empty()),
+            self_ref: weak_self.clone(),
+        })
+    }
+}
+
+impl SysObj for KernelNode {
+    fn as_any(&self) -> &dyn Any {
+        self
+    }
+
+    fn arc_as_node(&self) -> Option<Arc<dyn SysNode>> {
+        self.self_ref
+            .upgrade()
+            .map(|arc_self| arc_self as Arc<dyn SysNode>)
+    }
+
+    fn arc_as_branch(&self) -> Option<Arc<dyn SysBranchNode>> {
+        self.self_ref
+            .upgrade()
+            .map(|arc_self| arc_self as Arc<dyn SysBranchNode>)
+    }
+
+    fn id(&self) -> &SysNodeId {
+        self.fields.id()
+    }
+
+    fn type_(&self) -> SysNodeType {
+        SysNodeType::Branch
+    }
+
+    fn name(&self) -> SysStr {
+        Cow::Borrowed("kernel")
+    }
+}
+
+impl SysNode for KernelNode {
+    fn node_attrs(&self) -> &SysAttrSet {
+        self.fields.attr_set()
+    }
+
+    fn read_attr(&self, _name: &str, _writer: &mut VmWriter) -> SysTreeResult<usize> {
+        Err(SysTreeError::AttributeError)
+    }
+
+    fn write_attr(&self, _name: &str, _reader: &mut VmReader) -> SysTreeResult<usize> {
+        Err(SysTreeError::AttributeError)
+    }
+}
+
+impl SysBranchNode for KernelNode {
+    fn visit_child_with(&self, name: &str, f: &mut dyn FnMut(Option<&dyn SysNode>)) {
+        let child = self.child(name).and_then(|child| child.arc_as_node());
+        f(child.as_deref());
+    }
+
+    fn visit_children_with(&self, min_id: u64, f: &mut dyn FnMut(&Arc<dyn SysObj>) -> Option<()>) {
+        let children = self.fields.children.read();
+        for child in children
+            .values()
+            .filter(|child| child.id().as_u64() >= min_id)
+        {
+            if f(child).is_none() {
+                break;
+            }
+        }
+    }
+
+    fn child(&self, name: &str) -> Option<Arc<dyn SysObj>> {
+        self.fields.children.read().get(name).cloned()
+    }
+}
+
+/// The `/sys/kernel/tracing` directory.
+#[derive(Debug)]
+struct TracingNode {
+    fields: SysNormalNodeFields,
+    self_ref: Weak<Self>,
+    /// The number of the lost records that has been reported in `trace_pipe`.
+    nr_reported_lost: Mutex<u64>,
+}
+
+impl TracingNode {
+    fn new() -> Arc<Self> {
+        let mut builder = SysAttrSetBuilder::new();
+        builder
+            .add(Cow::Borrowed("set_event"), SysAttrFlags::CAN_WRITE)
+            .add(Cow::Borrowed("trace_pipe"), SysAttrFlags::CAN_READ)
+            .add(
+                Cow::Borrowed("trace_pipe_raw"),
+                SysAttrFlags::CAN_READ | SysAttrFlags::IS_BINARY,
+            );
+        let attrs = builder.build().unwrap();
+
+        Arc::new_cyclic(|weak_self| Self {
+            fields: SysNormalNodeFields::new(Cow::Borrowed("tracing"), attrs),
+            self_ref: weak_self.clone(),
+            nr_reported_lost: Mutex::new(0),
+        })
+    }
+
+    fn read_trace_pipe(&self, writer: &mut VmWriter) -> SysTreeResult<usize> {
+        let capacity = writer.avail().min(MAX_READ_LEN);
+        let mut output = String::with_capacity(capacity);
+
+        let mut nr_reported_lost = self.nr_reported_lost.lock();
+        let nr_lost = trace::nr_lost_records();
+        if nr_lost != *nr_reported_lost {
+            let _ = writeln!(output, "# lost {} records", nr_lost - *nr_reported_lost);
+            if output.len() > capacity {
+                return Ok(0);
+            }
+            *nr_reported_lost = nr_lost;
+        }
+        drop(nr_reported_lost);
+
+        let tsc_freq = tsc_freq();
+        let mut line = String::with_capacity(128);
+        trace::drain(|cpu, record| {
+            line.clear();
+            format_record(&mut line, cpu, record, tsc_freq);
+            if output.len() + line.len() > capacity {
+                return false;
+            }
+            output.push_str(&line);
+            true
+        });
+
+        write_output(writer, output.as_bytes())
+    }
+
+    fn read_trace_pipe_raw(&self, writer: &mut VmWriter) -> SysTreeResult<usize> {
+        let capacity = writer.avail().min(MAX_READ_LEN);
+        let mut output = Vec::with_capacity(capacity);
+
+        trace::drain(|cpu, record| {
+            if output.len() + RAW_RECORD_SIZE > capacity {
+                return false;
+            }
+            output.extend_from_slice(&record.timestamp.to_le_bytes());
+            output.extend_from_slice(&(cpu.as_usize() as u32).to_le_bytes());
+            output.extend_from_slice(&(record.event as u32).to_le_bytes());
+            for arg in record.args {
+                output.extend_from_slice(&arg.to_le_bytes());
+            }
+            true
+        });
+
+        write_output(writer, &output)
+    }
+
+    fn write_set_event(&self, reader: &mut VmReader) -> SysTreeResult<usize> {
+        let mut buffer = vec![0u8; reader.remain().min(MAX_SET_EVENT_LEN)];
+        let len = reader
+            .read_fallible(&mut VmWriter::from(buffer.as_mut_slice()))
+            .map_err(|_| SysTreeError::AttributeError)?;
+        let names =
+            core::str::from_utf8(&buffer[..len]).map_err(|_| SysTreeError::AttributeError)?;
+
+        // Check all the names before applying any of them.
+        let mut changes = Vec::new();
+        for name in names.split_whitespace() {
+            if name == "none" {
+                changes.push(None);
+                continue;
+            }
+            let (is_enabled, name) = match name.strip_prefix('!') {
+                Some(name) => (false, name),
+                None => (true, name),
+            };
+            let event = TraceEvent::from_name(name)
+                .ok_or(SysTreeError::InternalError("unknown trace event"))?;
+            changes.push(Some((event, is_enabled)));
+        }
+
+        for change in changes {
+            match change {
+                Some((event, true)) => trace::enable(event),
+                Some((event, false)) => trace::disable(event),
+                None => trace::disable_all(),
+            }
+        }
+
+        Ok(len)
+    }
+}
+
+fn format_record(output: &mut String, cpu: CpuId, record: &TraceRecord, tsc_freq: u64) {
+    let timestamp_ns = (record.timestamp as u128 * 1_000_000_000 / tsc_freq.max(1) as u128) as u64;
+    let _ = write!(
+        output,
+        "{} {} {}:",
+        cpu.as_usize(),
+        timestamp_ns,
+        record.event.name()
+    );
+    for (name, value) in record.fields() {
+        let _ = write!(output, " {}={:#x}", name, value);
+    }
+    output.push('\n');
+}
+
+fn write_output(writer: &mut VmWriter, output: &[u8]) -> SysTreeResult<usize> {
+    // The records have been consumed, so they are lost if the buffer turns out to be invalid.
+    writer
+        .write_fallible(&mut VmReader::from(output))
+        .map_err(|_| SysTreeError::AttributeError)
+}
+
+impl SysObj for TracingNode {
+    fn as_any(&self) -> &dyn Any {
+        self
+    }
+
+    fn arc_as_node(&self) -> Option<Arc<dyn SysNode>> {
+        self.self_ref
+            .upgrade()
+            .map(|arc_self| arc_self as Arc<dyn SysNode>)
+    }
+
+    fn id(&self) -> &SysNodeId {
+        self.fields.id()
+    }
+
+    fn type_(&self) -> SysNodeType {
+        SysNodeType::Leaf
+    }
+
+    fn name(&self) -> SysStr {
+        Cow::Borrowed("tracing")
+    }
+}
+
+impl SysNode for TracingNode {
+    fn node_attrs(&self) -> &SysAttrSet {
+        self.fields.attr_set()
+    }
+
+    fn read_attr(&self, name: &str, writer: &mut VmWriter) -> SysTreeResult<usize> {
+        match name {
+            "trace_pipe" => self.read_trace_pipe(writer),
+            "trace_pipe_raw" => self.read_trace_pipe_raw(writer),
+            "set_event" => Err(SysTreeError::PermissionDenied),
+            _ => Err(SysTreeError::AttributeError),
+        }
+    }
+
+    fn write_attr(&self, name: &str, reader: &mut VmReader) -> SysTreeResult<usize> {
+        match name {
+            "set_event" => self.write_set_event(reader),
+            "trace_pipe" | "trace_pipe_raw" => Err(SysTreeError::PermissionDenied),
+            _ => Err(SysTreeError::AttributeError),
+        }
+    }
+}
@@ -2,7 +2,9 @@
 
 mod iovec;
 pub mod net;
+mod per_cpu_counter;
 pub mod random;
 pub mod ring_buffer;
 
 pub use iovec::{MultiRead, MultiWrite, VmReaderArray, VmWriterArray};
+pub use per_cpu_counter::PerCpuCounter;
@@ -9,4 +9,4 @@ pub use addr::{
     CSocketAddrFamily,
 };
 pub use options::{new_raw_socket_option, CSocketOptionLevel};
-pub use socket::{CUserMsgHdr, Protocol, SockFlags, SockType, SOCK_TYPE_MASK};
+pub use socket::{CUserMMsgHdr, CUserMsgHdr, Protocol, SockFlags, SockType, SOCK_TYPE_MASK};
@@ -58,9 +58,10 @@ use crate::{net::socket::options::SocketOption, prelude::*};
 mod ip;
 mod socket;
 mod tcp;
+mod udp;
 mod utils;
 
-use self::{socket::new_socket_option, tcp::new_tcp_option};
+use self::{socket::new_socket_option, tcp::new_tcp_option, udp::new_udp_option};
 
 pub trait RawSocketOption: SocketOption {
     fn read_from_user(&mut self, addr: Vaddr, max_len: u32) -> Result<()>;
@@ -138,6 +139,7 @@ pub fn new_raw_socket_option(
         CSocketOptionLevel::SOL_SOCKET => new_socket_option(name),
         CSocketOptionLevel::SOL_IP => new_ip_option(name),
         CSocketOptionLevel::SOL_TCP => new_tcp_option(name),
+        CSocketOptionLevel::SOL_UDP => new_udp_option(name),
         _ => return_errno_with_message!(Errno::EOPNOTSUPP, "unsupported option level"),
     }
 }
@@ -4,7 +4,8 @@ use super::RawSocketOption;
 use crate::{
     impl_raw_sock_option_get_only, impl_raw_socket_option,
     net::socket::options::{
-        Error, KeepAlive, Linger, RecvBuf, ReuseAddr, ReusePort, SendBuf, SocketOption,
+        BusyPoll, Error, IncomingCpu, KeepAlive, Linger, PreferBusyPoll, RecvBuf, ReuseAddr,
+        ReusePort, SendBuf, SocketOption,
     },
     prelude::*,
 };
@@ -34,8 +35,11 @@ enum CSocketOptionName {
     LINGER = 13,
     BSDCOMPAT = 14,
     REUSEPORT = 15,
+    BUSY_POLL = 46,
+    INCOMING_CPU = 49,
     RCVTIMEO_NEW = 66,
     SNDTIMEO_NEW = 67,
+    PREFER_BUSY_POLL = 69,
 }
 
 pub fn new_socket_option(name: i32) -> Result<Box<dyn RawSocketOption>> {
@@ -48,6 +52,9 @@ pub fn new_socket_option(name: i32) -> Result<Box<dyn RawSocketOption>> {
         CSocketOptionName::REUSEPORT => Ok(Box::new(ReusePort::new())),
         CSocketOptionName::LINGER => Ok(Box::new(Linger::new())),
         CSocketOptionName::KEEPALIVE => Ok(Box::new(KeepAlive::new())),
+        CSocketOptionName::INCOMING_CPU => Ok(Box::new(IncomingCpu::new())),
+        CSocketOptionName::BUSY_POLL => Ok(Box::new(BusyPoll::new())),
+        CSocketOptionName::PREFER_BUSY_POLL => Ok(Box::new(PreferBusyPoll::new())),
         _ => return_errno_with_message!(Errno::ENOPROTOOPT, "unsupported socket-level option"),
     }
 }
@@ -59,3 +66,6 @@ impl_raw_sock_option_get_only!(Error);
 impl_raw_socket_option!(ReusePort);
 impl_raw_socket_option!(Linger);
 impl_raw_socket_option!(KeepAlive);
+impl_raw_socket_option!(IncomingCpu);
+impl_raw_socket_option!(BusyPoll);
+impl_raw_socket_option!(PreferBusyPoll);
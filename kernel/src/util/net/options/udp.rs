@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use super::RawSocketOption;
+use crate::{
+    impl_raw_socket_option,
+    net::socket::ip::datagram::options::{UdpGro, UdpSegment},
+    prelude::*,
+    util::net::options::SocketOption,
+};
+
+/// Socket options for UDP socket.
+///
+/// The raw definitions can be found at:
+/// https://elixir.bootlin.com/linux/v6.0.9/source/include/uapi/linux/udp.h#L29
+#[repr(i32)]
+#[derive(Debug, Clone, Copy, TryFromInt)]
+#[expect(non_camel_case_types)]
+#[expect(clippy::upper_case_acronyms)]
+pub enum CUdpOptionName {
+    /// Never send partially complete segments
+    CORK = 1,
+    /// Set the socket to accept encapsulated packets
+    ENCAP = 100,
+    /// Disable sending checksum for UDP6X
+    NO_CHECK6_TX = 101,
+    /// Disable accepting checksum for UDP6
+    NO_CHECK6_RX = 102,
+    /// Set GSO segmentation size
+    SEGMENT = 103,
+    /// This socket can receive UDP GRO packets
+    GRO = 104,
+}
+
+pub fn new_udp_option(name: i32) -> Result<Box<dyn RawSocketOption>> {
+    let name = CUdpOptionName::try_from(name).map_err(|_| Errno::ENOPROTOOPT)?;
+    match name {
+        CUdpOptionName::SEGMENT => Ok(Box::new(UdpSegment::new())),
+        CUdpOptionName::GRO => Ok(Box::new(UdpGro::new())),
+        _ => return_errno_with_message!(Errno::ENOPROTOOPT, "unsupported udp-level option"),
+    }
+}
+
+impl_raw_socket_option!(UdpSegment);
+impl_raw_socket_option!(UdpGro);
@@ -2,8 +2,11 @@
 
 use super::read_socket_addr_from_user;
 use crate::{
-    net::socket::SocketAddr,
+    current_userspace,
+    fs::file_table::{get_files_fast, FdFlags},
+    net::socket::{ControlMessage, SendRecvFlags, SocketAddr},
     prelude::*,
+    process::posix_thread::FileTableRefMut,
     util::{net::write_socket_addr_with_max_len, VmReaderArray, VmWriterArray},
 };
 
@@ -84,11 +87,11 @@ pub struct CUserMsgHdr {
     /// Scatter/Gather iov array
     pub msg_iov: Vaddr,
     /// The # of elements in msg_iov
-    pub msg_iovlen: u32,
+    pub msg_iovlen: usize,
     /// Ancillary data
     pub msg_control: Vaddr,
     /// Ancillary data buffer length
-    pub msg_controllen: u32,
+    pub msg_controllen: usize,
     /// Flags on received message
     pub msg_flags: u32,
 }
@@ -112,17 +115,121 @@ impl CUserMsgHdr {
         Ok(())
     }
 
+    /// Reads the control message to send from user space.
+    ///
+    /// The files passed with `SCM_RIGHTS` are looked up in `file_table` all at once, without
+    /// locking the file table. Other control messages are not supported yet and are ignored.
+    pub fn read_control_message_from_user(
+        &self,
+        file_table: &mut FileTableRefMut,
+    ) -> Result<Option<ControlMessage>> {
+        if self.msg_control == 0 || self.msg_controllen == 0 {
+            return Ok(None);
+        }
+        // The limit is the same as the default `optmem_max` of Linux.
+        const MAX_CONTROL_LEN: usize = 20480;
+        if self.msg_controllen > MAX_CONTROL_LEN {
+            return_errno_with_message!(Errno::ENOBUFS, "the control message is too long");
+        }
+
+        let mut bytes = vec![0u8; self.msg_controllen];
+        current_userspace!()
+            .read_bytes(self.msg_control, &mut VmWriter::from(bytes.as_mut_slice()))?;
+
+        let fds = ControlMessage::decode_rights(&bytes)?;
+        if fds.is_empty() {
+            return Ok(None);
+        }
+        let files = get_files_fast(file_table, &fds)?;
+
+        Ok(Some(ControlMessage::Rights(files)))
+    }
+
+    /// Writes the received control message to user space.
+    ///
+    /// `msg_controllen` is updated to the length of the written control message. If the buffer
+    /// is too small, the control message is discarded and `MSG_CTRUNC` is set in `msg_flags`.
+    ///
+    /// The files passed with `SCM_RIGHTS` are installed in `file_table` under a single lock. If
+    /// the buffer cannot hold all of them, the remaining files are discarded and `MSG_CTRUNC` is
+    /// set in `msg_flags`.
+    pub fn write_control_message_to_user(
+        &mut self,
+        control_message: Option<ControlMessage>,
+        flags: SendRecvFlags,
+        file_table: &mut FileTableRefMut,
+    ) -> Result<()> {
+        let Some(control_message) = control_message else {
+            self.msg_controllen = 0;
+            return Ok(());
+        };
+
+        let bytes = match control_message {
+            ControlMessage::Rights(files) => {
+                let max_nr_fds = if self.msg_control == 0 {
+                    0
+                } else {
+                    ControlMessage::max_rights_in(self.msg_controllen)
+                };
+                if files.len() > max_nr_fds {
+                    self.msg_flags |= SendRecvFlags::MSG_CTRUNC.bits() as u32;
+                }
+                if max_nr_fds == 0 {
+                    self.msg_controllen = 0;
+                    return Ok(());
+                }
+
+                let fd_flags = if flags.contains(SendRecvFlags::MSG_CMSG_CLOEXEC) {
+                    FdFlags::CLOEXEC
+                } else {
+                    FdFlags::empty()
+                };
+                let fds = file_table
+                    .unwrap()
+                    .write()
+                    .insert_all(files.into_iter().take(max_nr_fds), fd_flags);
+
+                // Like Linux, the padding of the last control message is truncated if there
+                // is no room for it.
+                let mut bytes = ControlMessage::rights_to_bytes(&fds);
+                bytes.truncate(self.msg_controllen);
+                bytes
+            }
+            control_message => control_message.to_bytes(),
+        };
+        if self.msg_control == 0 || bytes.len() > self.msg_controllen {
+            self.msg_controllen = 0;
+            self.msg_flags |= SendRecvFlags::MSG_CTRUNC.bits() as u32;
+            return Ok(());
+        }
+
+        current_userspace!()
+            .write_bytes(self.msg_control, &mut VmReader::from(bytes.as_slice()))?;
+        self.msg_controllen = bytes.len();
+        Ok(())
+    }
+
     pub fn copy_reader_array_from_user<'a>(
         &self,
         user_space: &'a CurrentUserSpace<'a>,
     ) -> Result<VmReaderArray<'a>> {
-        VmReaderArray::from_user_io_vecs(user_space, self.msg_iov, self.msg_iovlen as usize)
+        VmReaderArray::from_user_io_vecs(user_space, self.msg_iov, self.msg_iovlen)
     }
 
     pub fn copy_writer_array_from_user<'a>(
         &self,
         user_space: &'a CurrentUserSpace<'a>,
     ) -> Result<VmWriterArray<'a>> {
-        VmWriterArray::from_user_io_vecs(user_space, self.msg_iov, self.msg_iovlen as usize)
+        VmWriterArray::from_user_io_vecs(user_space, self.msg_iov, self.msg_iovlen)
     }
 }
+
+/// `struct mmsghdr` in Linux, which is used by `sendmmsg` and `recvmmsg`.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Pod)]
+pub struct CUserMMsgHdr {
+    /// The message header
+    pub msg_hdr: CUserMsgHdr,
+    /// The # of bytes transmitted for the message
+    pub msg_len: u32,
+}
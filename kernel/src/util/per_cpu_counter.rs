@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: MPL-2.0
+
+use core::sync::atomic::{AtomicI64, Ordering};
+
+use ostd::{
+    cpu::{num_cpus, PinCurrentCpu},
+    task::disable_preempt,
+};
+
+use crate::prelude::*;
+
+/// A counter whose updates go to per-CPU deltas instead of a single shared value.
+///
+/// Updating the counter does not contend with other CPUs, but reading it sums up the deltas of
+/// all CPUs, and the result is approximate if there are concurrent updates. The deltas are moved
+/// into the base value with [`Self::fold`].
+pub struct PerCpuCounter {
+    base: AtomicI64,
+    deltas: Box<[CpuDelta]>,
+    /// Serializes [`Self::fold`] with [`Self::exact_sum`].
+    ///
+    /// Otherwise, a sum can miss a delta that is being moved into the base value, or count it
+    /// twice.
+    fold_lock: SpinLock<()>,
+}
+
+/// The delta of one CPU, aligned to avoid false sharing with the other CPUs.
+#[repr(align(64))]
+#[derive(Default)]
+struct CpuDelta(AtomicI64);
+
+impl PerCpuCounter {
+    /// Creates a new counter with the initial value.
+    pub fn new(val: i64) -> Self {
+        Self {
+            base: AtomicI64::new(val),
+            deltas: (0..num_cpus()).map(|_| CpuDelta::default()).collect(),
+            fold_lock: SpinLock::new(()),
+        }
+    }
+
+    /// Adds `delta` to the counter.
+    pub fn add(&self, delta: i64) {
+        let preempt_guard = disable_preempt();
+        let cpu = preempt_guard.current_cpu();
+        self.deltas[cpu.as_usize()]
+            .0
+            .fetch_add(delta, Ordering::Relaxed);
+    }
+
+    /// Returns the approximate value of the counter.
+    ///
+    /// The result can be off by the deltas that are concurrently moved into the base value. Use
+    /// [`Self::exact_sum`] if the value decides whether an operation can proceed.
+    pub fn sum(&self) -> i64 {
+        let deltas: i64 = self
+            .deltas
+            .iter()
+            .map(|delta| delta.0.load(Ordering::Relaxed))
+            .sum();
+        self.base.load(Ordering::Relaxed) + deltas
+    }
+
+    /// Returns the value of the counter, which only misses the concurrent updates.
+    pub fn exact_sum(&self) -> i64 {
+        let _fold_guard = self.fold_lock.lock();
+        self.sum()
+    }
+
+    /// Moves the deltas of all CPUs into the base value, and returns the value of the counter.
+    pub fn fold(&self) -> i64 {
+        let _fold_guard = self.fold_lock.lock();
+        for delta in self.deltas.iter() {
+            let val = delta.0.swap(0, Ordering::Relaxed);
+            self.base.fetch_add(val, Ordering::Relaxed);
+        }
+        self.base.load(Ordering::Relaxed)
+    }
+}
+
+impl Debug for PerCpuCounter {
+    fn fmt(&self, f: &mut core::fmt::Formatter) -> core::fmt::Result {
+        f.debug_struct("PerCpuCounter")
+            .field("sum", &self.sum())
+            .finish()
+    }
+}
+
+#[cfg(ktest)]
+mod test {
+    use ostd::prelude::*;
+
+    use super::*;
+
+    #[ktest]
+    fn add_and_fold() {
+        let counter = PerCpuCounter::new(10);
+        counter.add(5);
+        counter.add(-3);
+        assert_eq!(counter.sum(), 12);
+        assert_eq!(counter.exact_sum(), 12);
+        assert_eq!(counter.fold(), 12);
+        assert_eq!(counter.sum(), 12);
+    }
+}
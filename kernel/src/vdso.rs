@@ -30,7 +30,7 @@ use spin::Once;
 use crate::{
     fs::fs_resolver::{FsPath, FsResolver, AT_FDCWD},
     syscall::ClockId,
-    time::{clocks::MonotonicClock, timer::Timeout, SystemTime, START_TIME},
+    time::{clocks::MonotonicClock, timer::Timeout, Clock, SystemTime, START_TIME},
     vm::vmo::{Vmo, VmoOptions},
 };
 
@@ -139,6 +139,9 @@ impl VdsoData {
         let coeff = clocksource.coeff();
         self.set_clock_mode(DEFAULT_CLOCK_MODE);
         self.set_coeff(coeff);
+        // The vDSO reports this value as the resolution of the high-resolution clocks in
+        // `clock_getres`. The coarse ones are reported with the resolution of the timer tick.
+        self.hrtimer_res = MonotonicClock::get().resolution() as u32;
 
         let (last_instant, last_cycles) = clocksource.last_record();
         self.update_high_res_instant(last_instant, last_cycles);
@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! The background collapse of base pages into huge pages.
+//!
+//! The page faults of an anonymous mapping are backed by huge pages only if
+//! the whole aligned huge page range is not mapped yet. The ranges that are
+//! faulted in page by page, e.g., by a stack or a heap growing gradually, are
+//! collapsed into huge pages by a kernel thread, like the `khugepaged` of
+//! Linux. The thread periodically scans the address spaces of the processes,
+//! and collapses a limited number of huge pages in each of them per scan.
+
+use core::time::Duration;
+
+use ostd::sync::WaitQueue;
+
+use crate::{
+    prelude::*,
+    process::process_table,
+    sched::{Nice, SchedPolicy},
+    thread::kernel_thread::ThreadOptions,
+    WaitTimeout,
+};
+
+/// The interval between two scans.
+const SCAN_INTERVAL: Duration = Duration::from_secs(10);
+
+/// The maximum number of huge pages collapsed in a process per scan.
+const MAX_NR_COLLAPSED_PER_SCAN: usize = 8;
+
+pub(super) fn init() {
+    ThreadOptions::new(collapse_huge_pages_loop)
+        .sched_policy(SchedPolicy::Fair(Nice::MAX))
+        .spawn();
+}
+
+fn collapse_huge_pages_loop() {
+    let wait_queue = WaitQueue::new();
+
+    loop {
+        let _ = wait_queue.wait_until_or_timeout(|| None::<()>, &SCAN_INTERVAL);
+
+        let processes: Vec<Arc<_>> = process_table::process_table_mut().iter().cloned().collect();
+        for process in processes {
+            let root_vmar = process.lock_root_vmar();
+            if let Some(root_vmar) = root_vmar.get() {
+                root_vmar.collapse_huge_pages(MAX_NR_COLLAPSED_PER_SCAN);
+            }
+        }
+    }
+}
@@ -0,0 +1,216 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! NUMA memory policies.
+//!
+//! A memory policy tells which NUMA node the pages should be allocated on.
+//! Each thread has a policy, set by `set_mempolicy`, and each mapping may
+//! have one, set by `mbind`. The policy of the mapping takes precedence over
+//! the policy of the thread that faults in the pages.
+//!
+//! The frame allocator always falls back to the nearest node with free memory
+//! if the chosen node runs out of memory. So a [`MemPolicy::Bind`] policy only
+//! chooses the nodes and does not fail the allocations strictly as Linux does.
+
+use core::sync::atomic::{AtomicUsize, Ordering};
+
+use ostd::{
+    mm::numa::{self, NodeId},
+    task::Task,
+};
+
+use crate::{prelude::*, process::posix_thread::AsPosixThread};
+
+/// A memory policy.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum MemPolicy {
+    /// Uses the policy of the thread, or allocates locally if it is the
+    /// policy of the thread.
+    #[default]
+    Default,
+    /// Allocates on the node, falling back to the other nodes.
+    Preferred(NodeId),
+    /// Allocates on the nearest node in the set.
+    Bind(NodeMask),
+    /// Allocates on the nodes in the set in turn.
+    Interleave(NodeMask),
+    /// Allocates on the node of the CPU that allocates.
+    Local,
+}
+
+/// A set of NUMA nodes.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub struct NodeMask(u64);
+
+impl NodeMask {
+    /// The number of bits in the mask, which bounds the number of nodes.
+    pub const NR_BITS: usize = u64::BITS as usize;
+
+    /// Creates a mask from its bits, returning `None` if any of the nodes
+    /// does not exist.
+    pub fn from_bits(bits: u64) -> Option<Self> {
+        let nr_nodes = numa::num_nodes();
+        if nr_nodes < Self::NR_BITS && bits >> nr_nodes != 0 {
+            return None;
+        }
+        Some(Self(bits))
+    }
+
+    /// Returns a mask with all the nodes.
+    pub fn all() -> Self {
+        Self(numa::all_nodes().fold(0, |bits, node| bits | 1 << node.as_usize()))
+    }
+
+    /// Returns the bits of the mask.
+    pub fn bits(&self) -> u64 {
+        self.0
+    }
+
+    /// Returns whether the mask is empty.
+    pub fn is_empty(&self) -> bool {
+        self.0 == 0
+    }
+
+    /// Returns whether the mask contains the node.
+    pub fn contains(&self, node: NodeId) -> bool {
+        self.0 & (1 << node.as_usize()) != 0
+    }
+
+    fn iter(&self) -> impl Iterator<Item = NodeId> + '_ {
+        numa::all_nodes().filter(|node| self.contains(*node))
+    }
+}
+
+impl From<NodeId> for NodeMask {
+    fn from(node: NodeId) -> Self {
+        Self(1 << node.as_usize())
+    }
+}
+
+impl MemPolicy {
+    /// Returns the node that a new page should be allocated on, or `None`
+    /// for the node of the current CPU.
+    ///
+    /// If this is the policy of a mapping and it is [`MemPolicy::Default`],
+    /// the policy of the current thread is used.
+    pub fn alloc_node(&self) -> Option<NodeId> {
+        // Fast path for the machines with a single node.
+        if numa::num_nodes() == 1 {
+            return None;
+        }
+
+        match self {
+            Self::Default => thread_policy().and_then(|policy| policy.alloc_node_local()),
+            policy => policy.alloc_node_local(),
+        }
+    }
+
+    fn alloc_node_local(&self) -> Option<NodeId> {
+        match self {
+            Self::Default | Self::Local => None,
+            Self::Preferred(node) => Some(*node),
+            Self::Bind(mask) => {
+                let current = NodeId::current_racy();
+                numa::nodes_by_distance(current).find(|node| mask.contains(*node))
+            }
+            Self::Interleave(mask) => {
+                static NEXT: AtomicUsize = AtomicUsize::new(0);
+                let nr_nodes = mask.iter().count();
+                let nth = NEXT.fetch_add(1, Ordering::Relaxed) % nr_nodes.max(1);
+                mask.iter().nth(nth)
+            }
+        }
+    }
+
+    /// Returns the mode and the nodes of the policy in the format of Linux.
+    pub fn to_raw(&self) -> (i32, NodeMask) {
+        match self {
+            Self::Default => (MPOL_DEFAULT, NodeMask::default()),
+            Self::Preferred(node) => (MPOL_PREFERRED, NodeMask::from(*node)),
+            Self::Bind(mask) => (MPOL_BIND, *mask),
+            Self::Interleave(mask) => (MPOL_INTERLEAVE, *mask),
+            Self::Local => (MPOL_LOCAL, NodeMask::default()),
+        }
+    }
+
+    /// Creates a policy from the mode and the nodes in the format of Linux.
+    pub fn from_raw(mode: i32, nodes: NodeMask) -> Result<Self> {
+        // The mode flags only affect how the nodes follow the cpusets, which
+        // are not supported.
+        let mode = mode & !(MPOL_F_STATIC_NODES | MPOL_F_RELATIVE_NODES);
+
+        let policy = match mode {
+            MPOL_DEFAULT if nodes.is_empty() => Self::Default,
+            // An empty set of preferred nodes means the local node.
+            MPOL_PREFERRED if nodes.is_empty() => Self::Local,
+            MPOL_PREFERRED => Self::Preferred(nodes.iter().next().unwrap()),
+            MPOL_BIND if !nodes.is_empty() => Self::Bind(nodes),
+            MPOL_INTERLEAVE if !nodes.is_empty() => Self::Interleave(nodes),
+            MPOL_LOCAL if nodes.is_empty() => Self::Local,
+            MPOL_DEFAULT | MPOL_BIND | MPOL_INTERLEAVE | MPOL_LOCAL => {
+                return_errno_with_message!(Errno::EINVAL, "the nodes do not match the mode")
+            }
+            _ => return_errno_with_message!(Errno::EINVAL, "the memory policy is not supported"),
+        };
+        Ok(policy)
+    }
+}
+
+/// Returns the policy of the current thread, if any.
+fn thread_policy() -> Option<MemPolicy> {
+    let task = Task::current()?;
+    let posix_thread = task.as_posix_thread()?;
+    Some(*posix_thread.mem_policy().lock())
+}
+
+pub const MPOL_DEFAULT: i32 = 0;
+pub const MPOL_PREFERRED: i32 = 1;
+pub const MPOL_BIND: i32 = 2;
+pub const MPOL_INTERLEAVE: i32 = 3;
+pub const MPOL_LOCAL: i32 = 4;
+
+const MPOL_F_STATIC_NODES: i32 = 1 << 15;
+const MPOL_F_RELATIVE_NODES: i32 = 1 << 14;
+
+#[cfg(ktest)]
+mod test {
+    use ostd::prelude::*;
+
+    use super::*;
+
+    #[ktest]
+    fn raw_round_trip() {
+        let node = NodeId::new(0).unwrap();
+        let nodes = NodeMask::from(node);
+        for (mode, nodes) in [
+            (MPOL_DEFAULT, NodeMask::default()),
+            (MPOL_PREFERRED, nodes),
+            (MPOL_BIND, nodes),
+            (MPOL_INTERLEAVE, nodes),
+            (MPOL_LOCAL, NodeMask::default()),
+        ] {
+            let policy = MemPolicy::from_raw(mode, nodes).unwrap();
+            assert_eq!(policy.to_raw(), (mode, nodes));
+        }
+    }
+
+    #[ktest]
+    fn invalid_raw() {
+        let nodes = NodeMask::from(NodeId::new(0).unwrap());
+        assert!(MemPolicy::from_raw(MPOL_DEFAULT, nodes).is_err());
+        assert!(MemPolicy::from_raw(MPOL_BIND, NodeMask::default()).is_err());
+        assert!(MemPolicy::from_raw(MPOL_LOCAL, nodes).is_err());
+        assert!(MemPolicy::from_raw(42, nodes).is_err());
+        assert_eq!(
+            MemPolicy::from_raw(MPOL_PREFERRED, NodeMask::default()).unwrap(),
+            MemPolicy::Local
+        );
+    }
+
+    #[ktest]
+    fn bind_stays_in_mask() {
+        for node in numa::all_nodes() {
+            let policy = MemPolicy::Bind(NodeMask::from(node));
+            assert_eq!(policy.alloc_node_local(), Some(node));
+        }
+    }
+}
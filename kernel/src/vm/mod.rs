@@ -19,6 +19,8 @@
 use osdk_frame_allocator::FrameAllocator;
 use osdk_heap_allocator::{type_from_layout, HeapAllocator};
 
+mod khugepaged;
+pub mod mempolicy;
 pub mod page_fault_handler;
 pub mod perms;
 pub mod util;
@@ -36,6 +38,35 @@ const fn slot_type_from_layout(layout: core::alloc::Layout) -> Option<ostd::mm::
     type_from_layout(layout)
 }
 
+pub fn lazy_init() {
+    khugepaged::init();
+    init_fault_around();
+}
+
+/// Applies the `vm.fault_around_pages` option on the kernel command line.
+fn init_fault_around() {
+    use ostd::boot::boot_info;
+
+    use crate::kcmdline::{KCmdlineArg, ModuleArg};
+
+    let karg: KCmdlineArg = boot_info().kernel_cmdline.as_str().into();
+    let Some(args) = karg.get_module_args("vm") else {
+        return;
+    };
+    for arg in args {
+        let ModuleArg::KeyVal(key, value) = arg else {
+            continue;
+        };
+        if key.as_bytes() != b"fault_around_pages" {
+            continue;
+        }
+        match value.to_str().ok().and_then(|value| value.parse().ok()) {
+            Some(nr_pages) => vmar::vm_mapping::set_fault_around_pages(nr_pages),
+            None => log::warn!("[kernel] invalid vm.fault_around_pages: {:?}", value),
+        }
+    }
+}
+
 /// Total physical memory in the entire system in bytes.
 pub fn mem_total() -> usize {
     use ostd::boot::{boot_info, memory_region::MemoryRegionType};
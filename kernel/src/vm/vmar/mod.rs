@@ -7,26 +7,49 @@ mod interval_set;
 mod static_cap;
 pub mod vm_mapping;
 
-use core::{num::NonZeroUsize, ops::Range};
+use core::{
+    num::NonZeroUsize,
+    ops::{Deref, Range},
+    sync::atomic::{AtomicUsize, Ordering},
+};
 
 use align_ext::AlignExt;
 use aster_rights::Rights;
-use ostd::mm::{tlb::TlbFlushOp, PageFlags, PageProperty, VmSpace, MAX_USERSPACE_VADDR};
+use ostd::{
+    cpu_local_cell,
+    mm::{
+        tlb::TlbFlushOp,
+        vm_space::{CursorMut, VmItem},
+        PageFlags, PageProperty, UFrame, VmSpace, MAX_USERSPACE_VADDR,
+    },
+    sync::WaitQueue,
+};
 
 use self::{
     interval_set::{Interval, IntervalSet},
-    vm_mapping::{MappedVmo, VmMapping},
+    vm_mapping::{ForkAdvice, MappedVmo, VmMapping},
 };
 use crate::{
     prelude::*,
     process::{Process, ResourceType},
     thread::exception::PageFaultInfo,
     vm::{
+        mempolicy::MemPolicy,
         perms::VmPerms,
-        vmo::{Vmo, VmoRightsOp},
+        vmo::{AccessPattern, Vmo, VmoRightsOp},
     },
 };
 
+cpu_local_cell! {
+    /// The number of page faults handled on the CPU.
+    static NR_PAGE_FAULTS: u64 = 0;
+}
+
+/// Returns the number of page faults handled since boot.
+pub fn nr_page_faults() -> u64 {
+    NR_PAGE_FAULTS.sum()
+}
+
 /// Virtual Memory Address Regions (VMARs) are a type of capability that manages
 /// user address spaces.
 ///
@@ -88,6 +111,135 @@ impl<R> Vmar<R> {
     pub fn resize_mapping(&self, map_addr: Vaddr, old_size: usize, new_size: usize) -> Result<()> {
         self.0.resize_mapping(map_addr, old_size, new_size)
     }
+
+    /// Remaps the pages in `old_addr..old_addr + old_size` to a mapping of
+    /// `new_size` bytes, and returns the address of the new mapping.
+    ///
+    /// The old range must be within one [`VmMapping`]. The new mapping is
+    /// placed at `new_addr` if it is specified, in which case the existing
+    /// mappings there are unmapped. Otherwise, the mapping is resized in
+    /// place if possible, or moved to a free region if `may_move` is set.
+    ///
+    /// The pages are moved by moving the page table entries, so no pages are
+    /// copied and the cost does not grow with the number of the bytes.
+    pub fn remap_mapping(
+        &self,
+        old_addr: Vaddr,
+        old_size: usize,
+        new_size: usize,
+        new_addr: Option<Vaddr>,
+        may_move: bool,
+    ) -> Result<Vaddr> {
+        self.0
+            .remap_mapping(old_addr, old_size, new_size, new_addr, may_move)
+    }
+
+    /// Advises the VMOs mapped in the range of the expected access pattern.
+    ///
+    /// The anonymous mappings in the range are ignored.
+    pub fn advise_access(&self, range: Range<Vaddr>, pattern: AccessPattern) {
+        self.0.advise_access(range, pattern)
+    }
+
+    /// Unmaps the pages in the range without removing the mappings.
+    ///
+    /// Later accesses fault in the pages again, which are zero-filled for
+    /// anonymous mappings and reloaded from the VMOs for VMO-backed mappings.
+    ///
+    /// The mapped part of the range is processed even if the range is not
+    /// fully mapped, in which case `Err` is returned afterward.
+    pub fn discard_pages(&self, range: Range<Vaddr>) -> Result<()> {
+        self.0.discard_pages(range)
+    }
+
+    /// Zeroes the pages in the range in the VMOs of the shared mappings,
+    /// and unmaps them.
+    ///
+    /// All the mappings in the range must be shared and writable.
+    pub fn remove_pages(&self, range: Range<Vaddr>) -> Result<()> {
+        self.0.remove_pages(range)
+    }
+
+    /// Deactivates the pages in the range, so that they are reclaimed ahead
+    /// of the others.
+    ///
+    /// If `pageout` is set, the clean pages of the VMOs are also unmapped so
+    /// that they can be reclaimed.
+    pub fn deactivate_pages(&self, range: Range<Vaddr>, pageout: bool) -> Result<()> {
+        self.0.deactivate_pages(range, pageout)
+    }
+
+    /// Reads the pages of the VMOs mapped in the range ahead in the background.
+    pub fn prefetch_pages(&self, range: Range<Vaddr>) -> Result<()> {
+        self.0.prefetch_pages(range)
+    }
+
+    /// Faults in all the pages in the range, which must be fully mapped.
+    ///
+    /// If `is_write` is set, the pages are faulted in as if they are written,
+    /// which breaks copy-on-write.
+    pub fn populate_pages(&self, range: Range<Vaddr>, is_write: bool) -> Result<()> {
+        self.0.populate_pages(range, is_write)
+    }
+
+    /// Faults in all the pages in the range, which must be fully mapped, and
+    /// returns the frames that back them.
+    ///
+    /// The returned frames stay alive even if the pages are unmapped later,
+    /// so they can be the targets of DMA. If `is_write` is set, the pages
+    /// are faulted in as if they are written, so that the frames are not
+    /// shared by copy-on-write. See [`PinnedFrames`] for how they are kept
+    /// from becoming copy-on-write later.
+    pub fn pin_pages(&self, range: Range<Vaddr>, is_write: bool) -> Result<PinnedFrames> {
+        self.0.pin_pages(range, is_write)
+    }
+
+    /// Maps the pages of the VMOs mapped in the range that are already
+    /// committed, as if they are faulted in by reads.
+    ///
+    /// No I/O is performed. The pages that are not in memory are still
+    /// faulted in on demand.
+    pub fn map_committed_pages(&self, range: Range<Vaddr>) -> Result<()> {
+        self.0.map_committed_pages(range)
+    }
+
+    /// Sets whether the anonymous mappings in the range can be backed by
+    /// huge pages.
+    ///
+    /// The mappings are split at the boundaries of the range if needed.
+    pub fn set_allow_huge_pages(&self, range: Range<Vaddr>, allow: bool) -> Result<()> {
+        self.0.set_allow_huge_pages(range, allow)
+    }
+
+    /// Applies the advice on how the forked children inherit the mappings in
+    /// the range.
+    ///
+    /// The mappings are split at the boundaries of the range if needed. The
+    /// range must be fully mapped.
+    pub fn advise_fork(&self, range: Range<Vaddr>, advice: ForkAdvice) -> Result<()> {
+        self.0.advise_fork(range, advice)
+    }
+
+    /// Collapses the base pages of the anonymous mappings into huge pages.
+    ///
+    /// At most `max_nr` huge pages are collapsed, and the number of the
+    /// collapsed ones is returned.
+    pub fn collapse_huge_pages(&self, max_nr: usize) -> usize {
+        self.0.collapse_huge_pages(max_nr)
+    }
+
+    /// Sets the NUMA memory policy of the mappings in the range.
+    ///
+    /// The mappings are split at the boundaries of the range if needed. The
+    /// range must be fully mapped.
+    pub fn set_mem_policy(&self, range: Range<Vaddr>, policy: MemPolicy) -> Result<()> {
+        self.0.set_mem_policy(range, policy)
+    }
+
+    /// Returns the NUMA memory policy of the mapping at the address.
+    pub fn mem_policy_at(&self, addr: Vaddr) -> Result<MemPolicy> {
+        self.0.mem_policy_at(addr)
+    }
 }
 
 pub(super) struct Vmar_ {
@@ -99,6 +251,10 @@ pub(super) struct Vmar_ {
     size: usize,
     /// The attached `VmSpace`
     vm_space: Arc<VmSpace>,
+    /// The number of alive `PinnedFrames` of this VMAR
+    nr_pins: AtomicUsize,
+    /// The wait queue to wait for `nr_pins` to become zero
+    unpin_wait_queue: WaitQueue,
 }
 
 struct VmarInner {
@@ -198,7 +354,13 @@ impl VmarInner {
         for vm_mapping in self.vm_mappings.find(&range) {
             mappings_to_remove.push(vm_mapping.map_to_addr());
         }
+        if mappings_to_remove.is_empty() {
+            return Ok(range);
+        }
 
+        // Unmap all the mappings with one cursor, so that the TLB flushes are
+        // batched and synchronized only once.
+        let mut cursor = vm_space.cursor_mut(&range)?;
         for vm_mapping_addr in mappings_to_remove {
             let vm_mapping = self.remove(&vm_mapping_addr).unwrap();
             let vm_mapping_range = vm_mapping.range();
@@ -212,8 +374,10 @@ impl VmarInner {
                 self.insert(right);
             }
 
-            taken.unmap(vm_space)?;
+            taken.unmap(&mut cursor)?;
         }
+        cursor.flusher().dispatch_tlb_flush();
+        cursor.flusher().sync_tlb_flush();
 
         Ok(offset..(offset + size))
     }
@@ -283,6 +447,8 @@ impl Vmar_ {
             base,
             size,
             vm_space,
+            nr_pins: AtomicUsize::new(0),
+            unpin_wait_queue: WaitQueue::new(),
         })
     }
 
@@ -309,7 +475,13 @@ impl Vmar_ {
         for vm_mapping in inner.vm_mappings.find(&range) {
             protect_mappings.push((vm_mapping.map_to_addr(), vm_mapping.perms()));
         }
+        if protect_mappings.is_empty() {
+            return Ok(());
+        }
 
+        // Protect all the mappings with one cursor, so that the TLB flushes
+        // are batched and synchronized only once.
+        let mut cursor = vm_space.cursor_mut(&range)?;
         for (vm_mapping_addr, vm_mapping_perms) in protect_mappings {
             if perms == vm_mapping_perms {
                 continue;
@@ -321,7 +493,7 @@ impl Vmar_ {
             // Protects part of the taken `VmMapping`.
             let (left, taken, right) = vm_mapping.split_range(&intersected_range)?;
 
-            let taken = taken.protect(vm_space.as_ref(), perms);
+            let taken = taken.protect(&mut cursor, perms);
             inner.insert(taken);
 
             // And put the rest back.
@@ -332,13 +504,320 @@ impl Vmar_ {
                 inner.insert(right);
             }
         }
+        cursor.flusher().dispatch_tlb_flush();
+        cursor.flusher().sync_tlb_flush();
+
+        Ok(())
+    }
+
+    fn advise_access(&self, range: Range<Vaddr>, pattern: AccessPattern) {
+        let inner = self.inner.read();
+        for vm_mapping in inner.vm_mappings.find(&range) {
+            vm_mapping.advise_access(pattern);
+        }
+    }
+
+    fn discard_pages(&self, range: Range<Vaddr>) -> Result<()> {
+        let inner = self.inner.read();
+        self.advise_with_cursor(&inner, &range, |vm_mapping, cursor, range| {
+            vm_mapping.discard(cursor, range)
+        })?;
+        Self::check_fully_mapped(&inner, &range)
+    }
+
+    fn remove_pages(&self, range: Range<Vaddr>) -> Result<()> {
+        let inner = self.inner.read();
+        for vm_mapping in inner.vm_mappings.find(&range) {
+            vm_mapping.check_remove()?;
+        }
+
+        // The VMOs are cleared before the pages are unmapped, since the
+        // clearing may sleep, and the pages faulted in meanwhile are unmapped.
+        for vm_mapping in inner.vm_mappings.find(&range) {
+            let intersected_range = get_intersected_range(&range, &vm_mapping.range());
+            vm_mapping.clear_vmo_pages(&intersected_range)?;
+        }
+        self.advise_with_cursor(&inner, &range, |vm_mapping, cursor, range| {
+            vm_mapping.discard(cursor, range)
+        })?;
+        Self::check_fully_mapped(&inner, &range)
+    }
+
+    fn deactivate_pages(&self, range: Range<Vaddr>, pageout: bool) -> Result<()> {
+        let inner = self.inner.read();
+        self.advise_with_cursor(&inner, &range, |vm_mapping, cursor, range| {
+            vm_mapping.deactivate(cursor, range, pageout)
+        })?;
+
+        // The pagers may sleep, so they are advised without the cursor.
+        for vm_mapping in inner.vm_mappings.find(&range) {
+            let intersected_range = get_intersected_range(&range, &vm_mapping.range());
+            vm_mapping.deactivate_vmo_pages(&intersected_range);
+        }
+        Self::check_fully_mapped(&inner, &range)
+    }
+
+    fn prefetch_pages(&self, range: Range<Vaddr>) -> Result<()> {
+        let inner = self.inner.read();
+        for vm_mapping in inner.vm_mappings.find(&range) {
+            let intersected_range = get_intersected_range(&range, &vm_mapping.range());
+            vm_mapping.prefetch(&intersected_range);
+        }
+        Self::check_fully_mapped(&inner, &range)
+    }
+
+    fn populate_pages(&self, range: Range<Vaddr>, is_write: bool) -> Result<()> {
+        let inner = self.inner.read();
+        Self::check_fully_mapped(&inner, &range)?;
+
+        for vm_mapping in inner.vm_mappings.find(&range) {
+            let intersected_range = get_intersected_range(&range, &vm_mapping.range());
+            vm_mapping.populate(&self.vm_space, intersected_range, is_write)?;
+        }
+        Ok(())
+    }
+
+    fn pin_pages(self: &Arc<Self>, range: Range<Vaddr>, is_write: bool) -> Result<PinnedFrames> {
+        debug_assert!(range.start % PAGE_SIZE == 0 && range.end % PAGE_SIZE == 0);
+
+        let inner = self.inner.read();
+        Self::check_fully_mapped(&inner, &range)?;
+
+        // Count the pin before the pages are faulted in. Forks hold the write
+        // lock of `inner` while waiting for the pins to go away, so they cannot
+        // make the pages copy-on-write after this point.
+        self.nr_pins.fetch_add(1, Ordering::Relaxed);
+        let mut pinned = PinnedFrames {
+            frames: Vec::with_capacity(range.len() / PAGE_SIZE),
+            vmar: self.clone(),
+        };
+
+        for vm_mapping in inner.vm_mappings.find(&range) {
+            let intersected_range = get_intersected_range(&range, &vm_mapping.range());
+            vm_mapping.populate(&self.vm_space, intersected_range, is_write)?;
+        }
+
+        // The mappings cannot be removed while `inner` is locked. But the
+        // pages may still be reclaimed in the meantime, which is reported as
+        // an error.
+        let mut cursor = self.vm_space.cursor(&range)?;
+        for va in range.step_by(PAGE_SIZE) {
+            cursor.jump(va)?;
+            let VmItem::Mapped { frame, .. } = cursor.query()? else {
+                return_errno_with_message!(Errno::EFAULT, "the page is reclaimed");
+            };
+            pinned.frames.push(frame);
+        }
+        Ok(pinned)
+    }
+
+    fn unpin(&self) {
+        if self.nr_pins.fetch_sub(1, Ordering::Release) == 1 {
+            self.unpin_wait_queue.wake_all();
+        }
+    }
+
+    fn map_committed_pages(&self, range: Range<Vaddr>) -> Result<()> {
+        let inner = self.inner.read();
+        for vm_mapping in inner.vm_mappings.find(&range) {
+            let intersected_range = get_intersected_range(&range, &vm_mapping.range());
+            vm_mapping.map_committed_pages(&self.vm_space, intersected_range)?;
+        }
+        Ok(())
+    }
+
+    /// Applies `op` to the parts of the mappings in the range with one
+    /// cursor, and then flushes the TLBs at once.
+    fn advise_with_cursor(
+        &self,
+        inner: &VmarInner,
+        range: &Range<Vaddr>,
+        mut op: impl FnMut(&VmMapping, &mut CursorMut, Range<Vaddr>),
+    ) -> Result<()> {
+        let cursor_range = range.start.max(self.base)..range.end.min(self.base + self.size);
+        if cursor_range.is_empty() {
+            return Ok(());
+        }
+
+        let mut cursor = self.vm_space.cursor_mut(&cursor_range)?;
+        for vm_mapping in inner.vm_mappings.find(range) {
+            let intersected_range = get_intersected_range(range, &vm_mapping.range());
+            op(vm_mapping, &mut cursor, intersected_range);
+        }
+        cursor.flusher().dispatch_tlb_flush();
+        cursor.flusher().sync_tlb_flush();
+
+        Ok(())
+    }
+
+    fn check_fully_mapped(inner: &VmarInner, range: &Range<Vaddr>) -> Result<()> {
+        if inner.count_overlap_size(range.clone()) != range.len() {
+            return_errno_with_message!(Errno::ENOMEM, "the range is not fully mapped");
+        }
+        Ok(())
+    }
+
+    fn set_allow_huge_pages(&self, range: Range<Vaddr>, allow: bool) -> Result<()> {
+        let mut inner = self.inner.write();
+
+        let mut affected_mappings = Vec::new();
+        for vm_mapping in inner.vm_mappings.find(&range) {
+            if vm_mapping.allow_huge_pages() != allow {
+                affected_mappings.push(vm_mapping.map_to_addr());
+            }
+        }
+
+        for vm_mapping_addr in affected_mappings {
+            let vm_mapping = inner.remove(&vm_mapping_addr).unwrap();
+            let intersected_range = get_intersected_range(&range, &vm_mapping.range());
+
+            let (left, mut taken, right) = vm_mapping.split_range(&intersected_range)?;
+            taken.set_allow_huge_pages(allow);
+            inner.insert(taken);
+
+            if let Some(left) = left {
+                inner.insert(left);
+            }
+            if let Some(right) = right {
+                inner.insert(right);
+            }
+        }
+
+        Ok(())
+    }
+
+    fn advise_fork(&self, range: Range<Vaddr>, advice: ForkAdvice) -> Result<()> {
+        let mut inner = self.inner.write();
+        Self::check_fully_mapped(&inner, &range)?;
+
+        let mut affected_mappings = Vec::new();
+        for vm_mapping in inner.vm_mappings.find(&range) {
+            if vm_mapping.check_fork_advice(advice)? {
+                affected_mappings.push(vm_mapping.map_to_addr());
+            }
+        }
+
+        for vm_mapping_addr in affected_mappings {
+            let vm_mapping = inner.remove(&vm_mapping_addr).unwrap();
+            let intersected_range = get_intersected_range(&range, &vm_mapping.range());
+
+            let (left, mut taken, right) = vm_mapping.split_range(&intersected_range)?;
+            taken.set_fork_advice(advice);
+            inner.insert(taken);
+
+            if let Some(left) = left {
+                inner.insert(left);
+            }
+            if let Some(right) = right {
+                inner.insert(right);
+            }
+        }
+
+        Ok(())
+    }
+
+    fn set_mem_policy(&self, range: Range<Vaddr>, policy: MemPolicy) -> Result<()> {
+        let mut inner = self.inner.write();
+        if inner.count_overlap_size(range.clone()) != range.len() {
+            return_errno_with_message!(Errno::EFAULT, "the range is not fully mapped");
+        }
+
+        let mut affected_mappings = Vec::new();
+        for vm_mapping in inner.vm_mappings.find(&range) {
+            if vm_mapping.mem_policy() != policy {
+                affected_mappings.push(vm_mapping.map_to_addr());
+            }
+        }
+
+        for vm_mapping_addr in affected_mappings {
+            let vm_mapping = inner.remove(&vm_mapping_addr).unwrap();
+            let intersected_range = get_intersected_range(&range, &vm_mapping.range());
+
+            let (left, mut taken, right) = vm_mapping.split_range(&intersected_range)?;
+            taken.set_mem_policy(policy);
+            inner.insert(taken);
+
+            if let Some(left) = left {
+                inner.insert(left);
+            }
+            if let Some(right) = right {
+                inner.insert(right);
+            }
+        }
 
         Ok(())
     }
 
+    fn mem_policy_at(&self, addr: Vaddr) -> Result<MemPolicy> {
+        let inner = self.inner.read();
+        match inner.vm_mappings.find_one(&addr) {
+            Some(vm_mapping) => Ok(vm_mapping.mem_policy()),
+            None => return_errno_with_message!(Errno::EFAULT, "the address is not mapped"),
+        }
+    }
+
+    fn collapse_huge_pages(&self, max_nr: usize) -> usize {
+        let end = self.base + self.size;
+        let mut addr = self.base;
+        let mut nr_collapsed = 0;
+
+        while nr_collapsed < max_nr {
+            // Scan one huge page range at a time with the read lock, so that
+            // the page faults are not blocked by the ranges that cannot be
+            // collapsed.
+            let huge_page_range = {
+                let inner = self.inner.read();
+                let Some((vm_mapping, huge_page_range)) =
+                    inner.vm_mappings.find(&(addr..end)).find_map(|vm_mapping| {
+                        let huge_page_range = vm_mapping.next_huge_page_range(addr)?;
+                        Some((vm_mapping, huge_page_range))
+                    })
+                else {
+                    break;
+                };
+                addr = huge_page_range.end;
+
+                if !vm_mapping.can_collapse_huge_page(&self.vm_space, &huge_page_range) {
+                    continue;
+                }
+                huge_page_range
+            };
+
+            // Page faults are blocked during the collapse by the write lock.
+            // The mapping may have changed since the scan, so look it up again.
+            let inner = self.inner.write();
+            let Some(vm_mapping) = inner.vm_mappings.find_one(&huge_page_range.start) else {
+                continue;
+            };
+            if vm_mapping
+                .next_huge_page_range(huge_page_range.start)
+                .as_ref()
+                != Some(&huge_page_range)
+            {
+                continue;
+            }
+            let Ok(mut cursor) = self.vm_space.cursor_mut(&huge_page_range) else {
+                continue;
+            };
+            if vm_mapping.collapse_huge_page(&mut cursor, huge_page_range) {
+                nr_collapsed += 1;
+            }
+        }
+
+        nr_collapsed
+    }
+
     /// Handles user space page fault, if the page fault is successfully handled, return Ok(()).
     pub fn handle_page_fault(&self, page_fault_info: &PageFaultInfo) -> Result<()> {
+        NR_PAGE_FAULTS.add_assign(1);
+
         let address = page_fault_info.address;
+        ostd::tracepoint!(
+            PageFault,
+            address,
+            page_fault_info.required_perms.contains(VmPerms::WRITE),
+        );
+
         if !(self.base..self.base + self.size).contains(&address) {
             return_errno_with_message!(Errno::EACCES, "page fault addr is not in current vmar");
         }
@@ -404,6 +883,121 @@ impl Vmar_ {
         Ok(())
     }
 
+    fn remap_mapping(
+        &self,
+        old_addr: Vaddr,
+        old_size: usize,
+        new_size: usize,
+        new_addr: Option<Vaddr>,
+        may_move: bool,
+    ) -> Result<Vaddr> {
+        debug_assert!(old_addr % PAGE_SIZE == 0);
+        debug_assert!(old_size % PAGE_SIZE == 0);
+        debug_assert!(new_size % PAGE_SIZE == 0);
+
+        if old_size == 0 || new_size == 0 {
+            return_errno_with_message!(Errno::EINVAL, "can not remap a mapping of 0 size");
+        }
+        let old_range = old_addr..old_addr + old_size;
+
+        let mut inner = self.inner.write();
+
+        let Some(vm_mapping) = inner.vm_mappings.find_one(&old_addr) else {
+            return_errno_with_message!(Errno::EFAULT, "the old range is not mapped");
+        };
+        if vm_mapping.map_end() < old_range.end {
+            return_errno_with_message!(Errno::EFAULT, "the old range is not in one mapping");
+        }
+        let vm_mapping_addr = vm_mapping.map_to_addr();
+        let is_mapping_end = vm_mapping.map_end() == old_range.end;
+
+        if let Some(new_addr) = new_addr {
+            let new_range = new_addr..new_addr + new_size;
+            if new_range.start < self.base || new_range.end > self.base + self.size {
+                return_errno_with_message!(Errno::EINVAL, "the new range is out of the VMAR");
+            }
+            if is_intersected(&old_range, &new_range) {
+                return_errno_with_message!(Errno::EINVAL, "the old and new ranges overlap");
+            }
+        } else if new_size <= old_size {
+            // Shrinks the mapping in place.
+            if new_size < old_size {
+                inner.alloc_free_region_exact_truncate(
+                    &self.vm_space,
+                    old_addr + new_size,
+                    old_size - new_size,
+                )?;
+            }
+            return Ok(old_addr);
+        } else {
+            // Enlarges the mapping in place if the following region is free.
+            let extra_range = old_range.end..old_addr + new_size;
+            if is_mapping_end
+                && extra_range.end <= self.base + self.size
+                && inner.vm_mappings.find(&extra_range).next().is_none()
+            {
+                inner.check_expand_size(extra_range.len())?;
+                let vm_mapping = inner.remove(&vm_mapping_addr).unwrap();
+                inner.insert(vm_mapping.enlarge(extra_range.len()));
+                return Ok(old_addr);
+            }
+            if !may_move {
+                return_errno_with_message!(Errno::ENOMEM, "the mapping cannot be enlarged");
+            }
+        }
+
+        if new_size > old_size {
+            inner.check_expand_size(new_size - old_size)?;
+        }
+        let new_addr = match new_addr {
+            Some(new_addr) => {
+                inner.alloc_free_region_exact_truncate(&self.vm_space, new_addr, new_size)?;
+                new_addr
+            }
+            None => inner.alloc_free_region(new_size, PAGE_SIZE)?.start,
+        };
+
+        let move_size = old_size.min(new_size);
+        if move_size < old_size {
+            inner.alloc_free_region_exact_truncate(
+                &self.vm_space,
+                old_addr + move_size,
+                old_size - move_size,
+            )?;
+        }
+
+        // Takes the moved part out of the mapping, which may have been split
+        // by the unmapping above.
+        let move_range = old_addr..old_addr + move_size;
+        let vm_mapping_addr = inner.vm_mappings.find_one(&old_addr).unwrap().map_to_addr();
+        let vm_mapping = inner.remove(&vm_mapping_addr).unwrap();
+        let (left, taken, right) = vm_mapping.split_range(&move_range)?;
+        if let Some(left) = left {
+            inner.insert(left);
+        }
+        if let Some(right) = right {
+            inner.insert(right);
+        }
+
+        // Moves the page table entries with one cursor over both the ranges,
+        // so that the TLB flushes are batched and synchronized only once.
+        let cursor_range = old_addr.min(new_addr)..(old_addr.max(new_addr) + move_size);
+        let mut cursor = self.vm_space.cursor_mut(&cursor_range)?;
+        let moved = taken.move_to(&mut cursor, new_addr)?;
+        cursor.flusher().dispatch_tlb_flush();
+        cursor.flusher().sync_tlb_flush();
+        drop(cursor);
+
+        let moved = if new_size > move_size {
+            moved.enlarge(new_size - move_size)
+        } else {
+            moved
+        };
+        inner.insert(moved);
+
+        Ok(new_addr)
+    }
+
     /// Returns the attached `VmSpace`.
     fn vm_space(&self) -> &Arc<VmSpace> {
         &self.vm_space
@@ -417,7 +1011,15 @@ impl Vmar_ {
         };
 
         {
-            let inner = self.inner.read();
+            // Like Linux, forks take the write lock. This also keeps new pins
+            // from being taken while the pages are made copy-on-write.
+            let inner = self.inner.write();
+            // A device may still write to the frames of the pinned pages. If
+            // they became copy-on-write, the next write of this process would
+            // move the page to a new frame, and the device would write to the
+            // child's page instead.
+            self.unpin_wait_queue
+                .wait_until(|| (self.nr_pins.load(Ordering::Acquire) == 0).then_some(()));
             let mut new_inner = new_vmar_.inner.write();
 
             // Clone mappings.
@@ -426,13 +1028,22 @@ impl Vmar_ {
             let mut new_cursor = new_vmspace.cursor_mut(&range).unwrap();
             let cur_vmspace = self.vm_space();
             let mut cur_cursor = cur_vmspace.cursor_mut(&range).unwrap();
+            let mut is_protected = false;
             for vm_mapping in inner.vm_mappings.iter() {
+                if !vm_mapping.is_inherited_on_fork() {
+                    continue;
+                }
+
                 let base = vm_mapping.map_to_addr();
 
                 // Clone the `VmMapping` to the new VMAR.
                 let new_mapping = vm_mapping.new_fork()?;
                 new_inner.insert(new_mapping);
 
+                if !vm_mapping.needs_fork_copy() {
+                    continue;
+                }
+
                 // Protect the mapping and copy to the new page table for COW.
                 cur_cursor.jump(base).unwrap();
                 new_cursor.jump(base).unwrap();
@@ -440,10 +1051,15 @@ impl Vmar_ {
                     page.flags -= PageFlags::W;
                 };
                 new_cursor.copy_from(&mut cur_cursor, vm_mapping.map_size(), &mut op);
+                is_protected = true;
+            }
+
+            // The write-protected entries of all the mappings are flushed at once.
+            if is_protected {
+                cur_cursor.flusher().issue_tlb_flush(TlbFlushOp::All);
+                cur_cursor.flusher().dispatch_tlb_flush();
+                cur_cursor.flusher().sync_tlb_flush();
             }
-            cur_cursor.flusher().issue_tlb_flush(TlbFlushOp::All);
-            cur_cursor.flusher().dispatch_tlb_flush();
-            cur_cursor.flusher().sync_tlb_flush();
         }
 
         Ok(new_vmar_)
@@ -464,6 +1080,30 @@ impl<R> Vmar<R> {
     }
 }
 
+/// The frames of the user pages pinned by [`Vmar::pin_pages`].
+///
+/// The VMAR cannot be forked while any of its `PinnedFrames` are alive. Thus,
+/// the pinned pages do not become copy-on-write, and the frames stay the ones
+/// that are mapped in the VMAR until the DMA that targets them is done.
+pub struct PinnedFrames {
+    frames: Vec<UFrame>,
+    vmar: Arc<Vmar_>,
+}
+
+impl Deref for PinnedFrames {
+    type Target = [UFrame];
+
+    fn deref(&self) -> &Self::Target {
+        &self.frames
+    }
+}
+
+impl Drop for PinnedFrames {
+    fn drop(&mut self) {
+        self.vmar.unpin();
+    }
+}
+
 /// Options for creating a new mapping. The mapping is not allowed to overlap
 /// with any child VMARs. And unless specified otherwise, it is not allowed
 /// to overlap with any existing mapping, either.
@@ -721,3 +1361,201 @@ pub fn get_intersected_range(range1: &Range<usize>, range2: &Range<usize>) -> Ra
     debug_assert!(is_intersected(range1, range2));
     range1.start.max(range2.start)..range1.end.min(range2.end)
 }
+
+#[cfg(ktest)]
+mod test {
+    use ostd::prelude::*;
+
+    use super::*;
+
+    const BASE: Vaddr = 0x1000_0000;
+
+    fn map_anonymous(vmar: &Vmar, addr: Vaddr, nr_pages: usize) {
+        vmar.new_map(nr_pages * PAGE_SIZE, VmPerms::READ | VmPerms::WRITE)
+            .unwrap()
+            .offset(addr)
+            .build()
+            .unwrap();
+    }
+
+    /// Faults in the pages in the range and returns the physical addresses of the frames.
+    fn frame_paddrs(vmar: &Vmar, addr: Vaddr, nr_pages: usize) -> Vec<Paddr> {
+        vmar.pin_pages(addr..addr + nr_pages * PAGE_SIZE, true)
+            .unwrap()
+            .iter()
+            .map(|frame| frame.start_paddr())
+            .collect()
+    }
+
+    fn mapping_range(vmar: &Vmar, addr: Vaddr) -> Range<Vaddr> {
+        let inner = vmar.0.inner.read();
+        let vm_mapping = inner.vm_mappings.find_one(&addr).unwrap();
+        vm_mapping.map_to_addr()..vm_mapping.map_end()
+    }
+
+    fn is_mapped(vmar: &Vmar, addr: Vaddr, nr_pages: usize) -> bool {
+        let range = addr..addr + nr_pages * PAGE_SIZE;
+        Vmar_::check_fully_mapped(&vmar.0.inner.read(), &range).is_ok()
+    }
+
+    /// Returns whether the page at the address is present in the page table.
+    fn is_page_present(vmar: &Vmar, addr: Vaddr) -> bool {
+        let mut cursor = vmar.vm_space().cursor(&(addr..addr + PAGE_SIZE)).unwrap();
+        matches!(cursor.query().unwrap(), VmItem::Mapped { .. })
+    }
+
+    #[ktest]
+    fn remap_grow_in_place() {
+        let vmar = Vmar::<Rights>::new_root();
+        map_anonymous(&vmar, BASE, 2);
+        let paddrs = frame_paddrs(&vmar, BASE, 2);
+
+        let addr = vmar
+            .remap_mapping(BASE, 2 * PAGE_SIZE, 4 * PAGE_SIZE, None, false)
+            .unwrap();
+        assert_eq!(addr, BASE);
+        assert_eq!(mapping_range(&vmar, BASE), BASE..BASE + 4 * PAGE_SIZE);
+        assert_eq!(frame_paddrs(&vmar, BASE, 2), paddrs);
+    }
+
+    #[ktest]
+    fn remap_shrink_in_place() {
+        let vmar = Vmar::<Rights>::new_root();
+        map_anonymous(&vmar, BASE, 4);
+        let paddrs = frame_paddrs(&vmar, BASE, 4);
+
+        let addr = vmar
+            .remap_mapping(BASE, 4 * PAGE_SIZE, 2 * PAGE_SIZE, None, false)
+            .unwrap();
+        assert_eq!(addr, BASE);
+        assert_eq!(mapping_range(&vmar, BASE), BASE..BASE + 2 * PAGE_SIZE);
+        assert_eq!(frame_paddrs(&vmar, BASE, 2), paddrs[..2]);
+        assert!(!is_mapped(&vmar, BASE + 2 * PAGE_SIZE, 1));
+    }
+
+    #[ktest]
+    fn remap_grow_and_move() {
+        let vmar = Vmar::<Rights>::new_root();
+        map_anonymous(&vmar, BASE, 2);
+        // The mapping cannot grow in place because of the following one.
+        map_anonymous(&vmar, BASE + 2 * PAGE_SIZE, 1);
+        let paddrs = frame_paddrs(&vmar, BASE, 2);
+
+        let err = vmar
+            .remap_mapping(BASE, 2 * PAGE_SIZE, 4 * PAGE_SIZE, None, false)
+            .unwrap_err();
+        assert_eq!(err.error(), Errno::ENOMEM);
+        assert_eq!(mapping_range(&vmar, BASE), BASE..BASE + 2 * PAGE_SIZE);
+
+        let addr = vmar
+            .remap_mapping(BASE, 2 * PAGE_SIZE, 4 * PAGE_SIZE, None, true)
+            .unwrap();
+        assert_ne!(addr, BASE);
+        assert_eq!(mapping_range(&vmar, addr), addr..addr + 4 * PAGE_SIZE);
+        // The frames are moved rather than copied.
+        assert_eq!(frame_paddrs(&vmar, addr, 2), paddrs);
+        assert!(!is_mapped(&vmar, BASE, 1));
+        assert!(is_mapped(&vmar, BASE + 2 * PAGE_SIZE, 1));
+    }
+
+    #[ktest]
+    fn remap_part_and_move() {
+        let vmar = Vmar::<Rights>::new_root();
+        map_anonymous(&vmar, BASE, 4);
+        let paddrs = frame_paddrs(&vmar, BASE, 4);
+
+        // Moves the middle two pages, which splits the mapping.
+        let new_addr = BASE + 16 * PAGE_SIZE;
+        let addr = vmar
+            .remap_mapping(
+                BASE + PAGE_SIZE,
+                2 * PAGE_SIZE,
+                2 * PAGE_SIZE,
+                Some(new_addr),
+                true,
+            )
+            .unwrap();
+        assert_eq!(addr, new_addr);
+        assert_eq!(mapping_range(&vmar, BASE), BASE..BASE + PAGE_SIZE);
+        assert_eq!(
+            mapping_range(&vmar, BASE + 3 * PAGE_SIZE),
+            BASE + 3 * PAGE_SIZE..BASE + 4 * PAGE_SIZE
+        );
+        assert!(!is_mapped(&vmar, BASE + PAGE_SIZE, 2));
+        assert_eq!(frame_paddrs(&vmar, new_addr, 2), paddrs[1..3]);
+    }
+
+    #[ktest]
+    fn remap_fixed_overlap() {
+        let vmar = Vmar::<Rights>::new_root();
+        map_anonymous(&vmar, BASE, 2);
+
+        // The new range cannot overlap the old one.
+        let err = vmar
+            .remap_mapping(
+                BASE,
+                2 * PAGE_SIZE,
+                2 * PAGE_SIZE,
+                Some(BASE + PAGE_SIZE),
+                true,
+            )
+            .unwrap_err();
+        assert_eq!(err.error(), Errno::EINVAL);
+        assert_eq!(mapping_range(&vmar, BASE), BASE..BASE + 2 * PAGE_SIZE);
+
+        // The mappings at the new range are replaced.
+        let new_addr = BASE + 16 * PAGE_SIZE;
+        map_anonymous(&vmar, new_addr - PAGE_SIZE, 4);
+        let paddrs = frame_paddrs(&vmar, BASE, 2);
+        let replaced_paddrs = frame_paddrs(&vmar, new_addr - PAGE_SIZE, 4);
+
+        let addr = vmar
+            .remap_mapping(BASE, 2 * PAGE_SIZE, 2 * PAGE_SIZE, Some(new_addr), true)
+            .unwrap();
+        assert_eq!(addr, new_addr);
+        assert!(!is_mapped(&vmar, BASE, 2));
+        assert_eq!(
+            mapping_range(&vmar, new_addr),
+            new_addr..new_addr + 2 * PAGE_SIZE
+        );
+        assert_eq!(frame_paddrs(&vmar, new_addr, 2), paddrs);
+        assert_eq!(
+            frame_paddrs(&vmar, new_addr - PAGE_SIZE, 1),
+            replaced_paddrs[..1]
+        );
+        assert_eq!(
+            frame_paddrs(&vmar, new_addr + 2 * PAGE_SIZE, 1),
+            replaced_paddrs[3..]
+        );
+    }
+
+    #[ktest]
+    fn fork_advice() {
+        let vmar = Vmar::<Rights>::new_root();
+        map_anonymous(&vmar, BASE, 3);
+        frame_paddrs(&vmar, BASE, 3);
+
+        vmar.advise_fork(BASE..BASE + PAGE_SIZE, ForkAdvice::DontFork)
+            .unwrap();
+        let wiped = BASE + 2 * PAGE_SIZE;
+        vmar.advise_fork(wiped..wiped + PAGE_SIZE, ForkAdvice::WipeOnFork)
+            .unwrap();
+
+        let child = Vmar::<Rights>::fork_from(&vmar).unwrap();
+        assert!(!is_mapped(&child, BASE, 1));
+        assert!(is_page_present(&child, BASE + PAGE_SIZE));
+        assert!(is_mapped(&child, wiped, 1));
+        assert!(!is_page_present(&child, wiped));
+        // The parent keeps its pages.
+        assert!(is_page_present(&vmar, wiped));
+
+        // `MADV_KEEPONFORK` and `MADV_DOFORK` undo the advices.
+        vmar.advise_fork(BASE..BASE + 3 * PAGE_SIZE, ForkAdvice::DoFork)
+            .unwrap();
+        vmar.advise_fork(BASE..BASE + 3 * PAGE_SIZE, ForkAdvice::KeepOnFork)
+            .unwrap();
+        let child = Vmar::<Rights>::fork_from(&vmar).unwrap();
+        assert!(is_page_present(&child, BASE));
+        assert!(is_page_present(&child, wiped));
+    }
+}
@@ -4,12 +4,16 @@ use core::{
     cmp::{max, min},
     num::NonZeroUsize,
     ops::Range,
+    sync::atomic::{AtomicUsize, Ordering},
 };
 
 use align_ext::AlignExt;
 use ostd::mm::{
-    tlb::TlbFlushOp, vm_space::VmItem, CachePolicy, FrameAllocOptions, PageFlags, PageProperty,
-    UFrame, VmSpace,
+    numa,
+    tlb::TlbFlushOp,
+    vm_space::{CursorMut, VmItem},
+    CachePolicy, FrameAllocOptions, PageFlags, PageProperty, UFrame, UntypedMem, VmSpace,
+    HUGE_PAGE_SIZE,
 };
 
 use super::interval_set::Interval;
@@ -17,12 +21,56 @@ use crate::{
     prelude::*,
     thread::exception::PageFaultInfo,
     vm::{
+        mempolicy::MemPolicy,
         perms::VmPerms,
         util::duplicate_frame,
-        vmo::{CommitFlags, Vmo, VmoCommitError},
+        vmo::{get_page_idx_range, AccessPattern, CommitFlags, Vmo, VmoCommitError},
     },
 };
 
+/// The default number of pages in the window of the fault-around.
+const DEFAULT_FAULT_AROUND_PAGES: usize = 16;
+
+/// The maximum number of pages in the window of the fault-around, i.e., the
+/// number of pages covered by a last-level page table.
+const MAX_FAULT_AROUND_PAGES: usize = 512;
+
+static FAULT_AROUND_PAGES: AtomicUsize = AtomicUsize::new(DEFAULT_FAULT_AROUND_PAGES);
+
+/// Returns the number of pages in the window of the fault-around.
+pub fn fault_around_pages() -> usize {
+    FAULT_AROUND_PAGES.load(Ordering::Relaxed)
+}
+
+/// Sets the number of pages in the window of the fault-around.
+///
+/// On a read fault in a mapping that handles the page faults around, the
+/// committed pages in the aligned window that contains the faulting page
+/// are mapped as well. The number is rounded down to a power of two and is
+/// capped at [`MAX_FAULT_AROUND_PAGES`]. Setting it to one, or zero, maps
+/// only the faulting page.
+pub fn set_fault_around_pages(nr_pages: usize) {
+    let nr_pages = match nr_pages.min(MAX_FAULT_AROUND_PAGES) {
+        0 => 1,
+        nr_pages => 1 << nr_pages.ilog2(),
+    };
+    FAULT_AROUND_PAGES.store(nr_pages, Ordering::Relaxed);
+}
+
+/// The advice on how a mapping is inherited by the forked children.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum ForkAdvice {
+    /// The children do not inherit the mapping (`MADV_DONTFORK`).
+    DontFork,
+    /// Undoes [`Self::DontFork`] (`MADV_DOFORK`).
+    DoFork,
+    /// The children inherit the mapping with zero-filled pages
+    /// (`MADV_WIPEONFORK`). Only private anonymous mappings accept this.
+    WipeOnFork,
+    /// Undoes [`Self::WipeOnFork`] (`MADV_KEEPONFORK`).
+    KeepOnFork,
+}
+
 /// Mapping a range of physical pages into a `Vmar`.
 ///
 /// A `VmMapping` can bind with a `Vmo` which can provide physical pages for
@@ -62,6 +110,20 @@ pub(super) struct VmMapping {
     /// Whether the mapping needs to handle surrounding pages when handling
     /// page fault.
     handle_page_faults_around: bool,
+    /// Whether the mapping can be backed by transparent huge pages.
+    ///
+    /// Only the anonymous mappings are backed by huge pages. The huge pages
+    /// are mapped by page faults, or by [`Self::collapse_huge_page`].
+    allow_huge_pages: bool,
+    /// The NUMA memory policy of the anonymous pages in the mapping.
+    ///
+    /// The pages of the VMO are allocated by the VMO, not following the
+    /// policy.
+    mem_policy: MemPolicy,
+    /// Whether the mapping is not inherited by the forked children.
+    is_dont_fork: bool,
+    /// Whether the forked children inherit the mapping with zero-filled pages.
+    is_wipe_on_fork: bool,
     /// The permissions of pages in the mapping.
     ///
     /// All pages within the same `VmMapping` have the same permissions.
@@ -91,6 +153,10 @@ impl VmMapping {
             vmo,
             is_shared,
             handle_page_faults_around,
+            allow_huge_pages: true,
+            mem_policy: MemPolicy::Default,
+            is_dont_fork: false,
+            is_wipe_on_fork: false,
             perms,
         }
     }
@@ -102,6 +168,60 @@ impl VmMapping {
         })
     }
 
+    /// Returns whether the page table entries of the mapping need to be
+    /// copied to the child on fork.
+    ///
+    /// A shared VMO-backed mapping maps nothing but the pages of its VMO,
+    /// which the child can fault in from the VMO when it accesses them. So
+    /// the entries are not copied, and the child page table is populated
+    /// lazily. The private mappings may contain pages that exist only in the
+    /// page table, whose entries must be copied and write-protected for COW.
+    ///
+    /// The pages of a mapping that is wiped on fork are not copied either, so
+    /// the child faults in zero-filled pages.
+    pub(super) fn needs_fork_copy(&self) -> bool {
+        !(self.is_shared && self.vmo.is_some()) && !self.is_wipe_on_fork
+    }
+
+    /// Returns whether the mapping is inherited by the forked children.
+    pub(super) fn is_inherited_on_fork(&self) -> bool {
+        !self.is_dont_fork
+    }
+
+    /// Returns whether applying the fork advice changes the mapping.
+    ///
+    /// Like Linux, [`ForkAdvice::WipeOnFork`] is rejected with `EINVAL` for the
+    /// mappings that are shared or backed by VMOs.
+    pub(super) fn check_fork_advice(&self, advice: ForkAdvice) -> Result<bool> {
+        let is_changed = match advice {
+            ForkAdvice::DontFork => !self.is_dont_fork,
+            ForkAdvice::DoFork => self.is_dont_fork,
+            ForkAdvice::WipeOnFork => {
+                if self.is_shared || self.vmo.is_some() {
+                    return_errno_with_message!(
+                        Errno::EINVAL,
+                        "only private anonymous mappings can be wiped on fork"
+                    );
+                }
+                !self.is_wipe_on_fork
+            }
+            ForkAdvice::KeepOnFork => self.is_wipe_on_fork,
+        };
+        Ok(is_changed)
+    }
+
+    /// Applies the fork advice to the mapping.
+    ///
+    /// The advice must have been checked by [`Self::check_fork_advice`].
+    pub(super) fn set_fork_advice(&mut self, advice: ForkAdvice) {
+        match advice {
+            ForkAdvice::DontFork => self.is_dont_fork = true,
+            ForkAdvice::DoFork => self.is_dont_fork = false,
+            ForkAdvice::WipeOnFork => self.is_wipe_on_fork = true,
+            ForkAdvice::KeepOnFork => self.is_wipe_on_fork = false,
+        }
+    }
+
     /// Returns the mapping's start address.
     pub fn map_to_addr(&self) -> Vaddr {
         self.map_to_addr
@@ -121,6 +241,47 @@ impl VmMapping {
     pub fn perms(&self) -> VmPerms {
         self.perms
     }
+
+    /// Returns whether the mapping can be backed by transparent huge pages.
+    pub fn allow_huge_pages(&self) -> bool {
+        self.allow_huge_pages
+    }
+
+    /// Sets whether the mapping can be backed by transparent huge pages.
+    ///
+    /// The huge pages that have been mapped are not affected.
+    pub fn set_allow_huge_pages(&mut self, allow_huge_pages: bool) {
+        self.allow_huge_pages = allow_huge_pages;
+    }
+
+    /// Returns the NUMA memory policy of the mapping.
+    pub fn mem_policy(&self) -> MemPolicy {
+        self.mem_policy
+    }
+
+    /// Sets the NUMA memory policy of the mapping.
+    ///
+    /// The pages that have been allocated are not migrated.
+    pub fn set_mem_policy(&mut self, mem_policy: MemPolicy) {
+        self.mem_policy = mem_policy;
+    }
+
+    /// Returns the options to allocate the anonymous pages of the mapping,
+    /// following the memory policy.
+    fn frame_alloc_options(&self) -> FrameAllocOptions {
+        let mut options = FrameAllocOptions::new();
+        if let Some(node) = self.mem_policy.alloc_node() {
+            options.node(node);
+        }
+        options
+    }
+
+    /// Advises the mapped VMO, if any, of the expected access pattern.
+    pub fn advise_access(&self, pattern: AccessPattern) {
+        if let Some(vmo) = &self.vmo {
+            vmo.vmo.advise_access(pattern);
+        }
+    }
 }
 
 /****************************** Page faults **********************************/
@@ -162,9 +323,17 @@ impl VmMapping {
             return res;
         }
 
+        // The cursor covers the huge page containing the address if the page
+        // can be mapped as a huge page.
+        let huge_page_addr = self.huge_page_addr_of(address);
+        let cursor_range = match huge_page_addr {
+            Some(huge_page_addr) => huge_page_addr..huge_page_addr + HUGE_PAGE_SIZE,
+            None => page_aligned_addr..page_aligned_addr + PAGE_SIZE,
+        };
+
         'retry: loop {
-            let mut cursor =
-                vm_space.cursor_mut(&(page_aligned_addr..page_aligned_addr + PAGE_SIZE))?;
+            let mut cursor = vm_space.cursor_mut(&cursor_range)?;
+            cursor.jump(page_aligned_addr)?;
 
             match cursor.query().unwrap() {
                 VmItem::Mapped {
@@ -206,7 +375,17 @@ impl VmMapping {
                     }
                     cursor.flusher().sync_tlb_flush();
                 }
-                VmItem::NotMapped { .. } => {
+                VmItem::NotMapped { len, .. } => {
+                    // The slot is not smaller than a huge page only if the
+                    // whole huge page containing the address is not mapped.
+                    if let Some(huge_page_addr) = huge_page_addr.filter(|_| len >= HUGE_PAGE_SIZE) {
+                        cursor.jump(huge_page_addr)?;
+                        if self.map_huge_page(&mut cursor, is_write) {
+                            return Ok(());
+                        }
+                        cursor.jump(page_aligned_addr)?;
+                    }
+
                     // Map a new frame to the page fault address.
                     let (frame, is_readonly) = match self.prepare_page(address, is_write) {
                         Ok((frame, is_readonly)) => (frame, is_readonly),
@@ -221,23 +400,7 @@ impl VmMapping {
                         }
                     };
 
-                    let vm_perms = {
-                        let mut perms = self.perms;
-                        if is_readonly {
-                            // COW pages are forced to be read-only.
-                            perms -= VmPerms::WRITE;
-                        }
-                        perms
-                    };
-
-                    let mut page_flags = vm_perms.into();
-                    page_flags |= PageFlags::ACCESSED;
-                    if is_write {
-                        page_flags |= PageFlags::DIRTY;
-                    }
-                    let map_prop = PageProperty::new(page_flags, CachePolicy::Writeback);
-
-                    cursor.map(frame, map_prop);
+                    cursor.map(frame, self.new_page_prop(is_readonly, is_write));
                 }
             }
             break 'retry;
@@ -245,6 +408,56 @@ impl VmMapping {
         Ok(())
     }
 
+    /// Returns the property of a page newly mapped upon a page fault.
+    fn new_page_prop(&self, is_readonly: bool, is_write: bool) -> PageProperty {
+        let mut perms = self.perms;
+        if is_readonly {
+            // COW pages are forced to be read-only.
+            perms -= VmPerms::WRITE;
+        }
+
+        let mut page_flags = PageFlags::from(perms) | PageFlags::ACCESSED;
+        if is_write {
+            page_flags |= PageFlags::DIRTY;
+        }
+        PageProperty::new(page_flags, CachePolicy::Writeback)
+    }
+
+    /// Returns the address of the huge page containing `address`, if the
+    /// huge page can be mapped in the mapping.
+    fn huge_page_addr_of(&self, address: Vaddr) -> Option<Vaddr> {
+        if !self.allow_huge_pages || self.vmo.is_some() {
+            return None;
+        }
+
+        let huge_page_addr = address.align_down(HUGE_PAGE_SIZE);
+        let range = self.range();
+        (range.start <= huge_page_addr && huge_page_addr + HUGE_PAGE_SIZE <= range.end)
+            .then_some(huge_page_addr)
+    }
+
+    /// Maps a new huge page at the address of the cursor.
+    ///
+    /// Returns `false` if the huge page cannot be allocated or mapped, in
+    /// which case the caller should fall back to map base pages.
+    fn map_huge_page(&self, cursor: &mut CursorMut, is_write: bool) -> bool {
+        let Ok(segment) = self
+            .frame_alloc_options()
+            .align(HUGE_PAGE_SIZE)
+            .alloc_segment(HUGE_PAGE_SIZE / PAGE_SIZE)
+        else {
+            return false;
+        };
+
+        let mut page_flags = PageFlags::from(self.perms) | PageFlags::ACCESSED;
+        if is_write {
+            page_flags |= PageFlags::DIRTY;
+        }
+        let map_prop = PageProperty::new(page_flags, CachePolicy::Writeback);
+
+        cursor.map_huge(segment.into(), map_prop).is_ok()
+    }
+
     fn prepare_page(
         &self,
         page_fault_addr: Vaddr,
@@ -252,13 +465,19 @@ impl VmMapping {
     ) -> core::result::Result<(UFrame, bool), VmoCommitError> {
         let mut is_readonly = false;
         let Some(vmo) = &self.vmo else {
-            return Ok((FrameAllocOptions::new().alloc_frame()?.into(), is_readonly));
+            return Ok((
+                self.frame_alloc_options().alloc_frame()?.into(),
+                is_readonly,
+            ));
         };
 
         let page_offset = page_fault_addr.align_down(PAGE_SIZE) - self.map_to_addr;
         if !self.is_shared && page_offset >= vmo.size() {
             // The page index is outside the VMO. This is only allowed in private mapping.
-            return Ok((FrameAllocOptions::new().alloc_frame()?.into(), is_readonly));
+            return Ok((
+                self.frame_alloc_options().alloc_frame()?.into(),
+                is_readonly,
+            ));
         }
 
         let page = vmo.get_committed_frame(page_offset)?;
@@ -275,54 +494,66 @@ impl VmMapping {
         }
     }
 
+    /// Handles a read fault in a VMO-backed mapping, mapping the committed
+    /// pages around the faulting page as well.
+    ///
+    /// The window of [`fault_around_pages`] pages that contains the faulting
+    /// page is mapped with one cursor. Only the faulting page may be read
+    /// from the VMO, which also drives the readahead of the page cache. The
+    /// other pages are mapped only if they are already committed, e.g., read
+    /// ahead by the previous faults, so no I/O is waited for them.
     fn handle_page_faults_around(&self, vm_space: &VmSpace, page_fault_addr: Vaddr) -> Result<()> {
-        const SURROUNDING_PAGE_NUM: usize = 16;
-        const SURROUNDING_PAGE_ADDR_MASK: usize = !(SURROUNDING_PAGE_NUM * PAGE_SIZE - 1);
-
         let vmo = self.vmo.as_ref().unwrap();
-        let around_page_addr = page_fault_addr & SURROUNDING_PAGE_ADDR_MASK;
-        let size = min(vmo.size(), self.map_size.get());
+        let page_fault_addr = page_fault_addr.align_down(PAGE_SIZE);
 
-        let mut start_addr = max(around_page_addr, self.map_to_addr);
-        let end_addr = min(
-            start_addr + SURROUNDING_PAGE_NUM * PAGE_SIZE,
-            self.map_to_addr + size,
-        );
+        let window_size = fault_around_pages() * PAGE_SIZE;
+        let around_page_addr = page_fault_addr.align_down(window_size);
+        let vmo_end = self.map_to_addr + min(vmo.size(), self.map_size.get());
+        let start_addr = max(around_page_addr, self.map_to_addr);
+        let end_addr = min(around_page_addr + window_size, vmo_end.align_up(PAGE_SIZE))
+            .max(page_fault_addr + PAGE_SIZE);
 
-        let vm_perms = self.perms - VmPerms::WRITE;
         'retry: loop {
             let mut cursor = vm_space.cursor_mut(&(start_addr..end_addr))?;
-            let operate =
-                move |commit_fn: &mut dyn FnMut()
-                    -> core::result::Result<UFrame, VmoCommitError>| {
-                    if let VmItem::NotMapped { .. } = cursor.query().unwrap() {
-                        // We regard all the surrounding pages as accessed, no matter
-                        // if it is really so. Then the hardware won't bother to update
-                        // the accessed bit of the page table on following accesses.
-                        let page_flags = PageFlags::from(vm_perms) | PageFlags::ACCESSED;
-                        let page_prop = PageProperty::new(page_flags, CachePolicy::Writeback);
-                        let frame = commit_fn()?;
-                        cursor.map(frame, page_prop);
-                    } else {
-                        let next_addr = cursor.virt_addr() + PAGE_SIZE;
-                        if next_addr < end_addr {
-                            let _ = cursor.jump(next_addr);
-                        }
-                    }
-                    Ok(())
-                };
+            cursor.jump(page_fault_addr)?;
+
+            // The page fault is already handled maybe by other threads.
+            if let VmItem::Mapped { .. } = cursor.query()? {
+                TlbFlushOp::Address(page_fault_addr).perform_on_current();
+                return Ok(());
+            }
 
-            let start_offset = start_addr - self.map_to_addr;
-            let end_offset = end_addr - self.map_to_addr;
-            match vmo.try_operate_on_range(&(start_offset..end_offset), operate) {
-                Ok(_) => return Ok(()),
+            let (frame, is_readonly) = match self.prepare_page(page_fault_addr, false) {
+                Ok((frame, is_readonly)) => (frame, is_readonly),
+                Err(VmoCommitError::Err(e)) => return Err(e),
                 Err(VmoCommitError::NeedIo(index)) => {
+                    drop(cursor);
                     vmo.commit_on(index, CommitFlags::empty())?;
-                    start_addr = index * PAGE_SIZE + self.map_to_addr;
                     continue 'retry;
                 }
-                Err(VmoCommitError::Err(e)) => return Err(e),
+            };
+            cursor.map(frame, self.new_page_prop(is_readonly, false));
+
+            // The surrounding pages are mapped read-only, so that the writes to
+            // them are tracked by the page faults as usual. We regard them as
+            // accessed, no matter if it is really so. Then the hardware won't
+            // bother to update the accessed bit of the page table on following
+            // accesses.
+            let page_prop = self.new_page_prop(true, false);
+            let mut va = start_addr;
+            while va < end_addr && va < vmo_end {
+                if va != page_fault_addr {
+                    cursor.jump(va)?;
+                    if let VmItem::NotMapped { .. } = cursor.query()? {
+                        if let Some(frame) = vmo.committed_page(va - self.map_to_addr) {
+                            cursor.map(frame, page_prop);
+                        }
+                    }
+                }
+                va += PAGE_SIZE;
             }
+
+            return Ok(());
         }
     }
 }
@@ -417,22 +648,45 @@ impl VmMapping {
 /************************** VM Space operations ******************************/
 
 impl VmMapping {
-    /// Unmaps the mapping from the VM space.
-    pub(super) fn unmap(self, vm_space: &VmSpace) -> Result<()> {
+    /// Unmaps the mapping from the VM space with the cursor.
+    ///
+    /// The cursor must cover the range of the mapping. The TLB flushes are
+    /// issued but not dispatched, so the caller can batch them with the ones
+    /// of other mappings.
+    pub(super) fn unmap(self, cursor: &mut CursorMut) -> Result<()> {
         let range = self.range();
-        let mut cursor = vm_space.cursor_mut(&range)?;
+        cursor.jump(range.start)?;
         cursor.unmap(range.len());
-        cursor.flusher().dispatch_tlb_flush();
-        cursor.flusher().sync_tlb_flush();
 
         Ok(())
     }
 
-    /// Change the perms of the mapping.
-    pub(super) fn protect(self, vm_space: &VmSpace, perms: VmPerms) -> Self {
+    /// Moves the mapping to `new_addr` with the cursor, along with the pages
+    /// mapped in it.
+    ///
+    /// The pages are not copied, but the page table entries are moved. The
+    /// cursor must cover the ranges of the mapping both before and after the
+    /// move. The TLB flushes are issued but not dispatched, so the caller can
+    /// batch them with the ones of other mappings.
+    pub(super) fn move_to(self, cursor: &mut CursorMut, new_addr: Vaddr) -> Result<Self> {
+        cursor.jump(self.map_to_addr)?;
+        cursor.move_to(new_addr, self.map_size.get());
+
+        Ok(Self {
+            map_to_addr: new_addr,
+            ..self
+        })
+    }
+
+    /// Change the perms of the mapping with the cursor.
+    ///
+    /// The cursor must cover the range of the mapping. The TLB flushes are
+    /// issued but not dispatched, so the caller can batch them with the ones
+    /// of other mappings.
+    pub(super) fn protect(self, cursor: &mut CursorMut, perms: VmPerms) -> Self {
         let range = self.range();
 
-        let mut cursor = vm_space.cursor_mut(&range).unwrap();
+        cursor.jump(range.start).unwrap();
 
         let op = |p: &mut PageProperty| p.flags = perms.into();
         while cursor.virt_addr() < range.end {
@@ -442,13 +696,386 @@ impl VmMapping {
                 break;
             }
         }
+
+        Self { perms, ..self }
+    }
+}
+
+/******************************** Advices ************************************/
+
+impl VmMapping {
+    /// Unmaps the pages in the range, as advised by `MADV_DONTNEED`.
+    ///
+    /// Later accesses fault in the pages again, which are zero-filled for
+    /// anonymous mappings and reloaded from the VMO for VMO-backed mappings.
+    ///
+    /// The range must be in the mapping and covered by the cursor. The TLB
+    /// flushes are issued but not dispatched, so the caller can batch them
+    /// with the ones of other mappings.
+    pub(super) fn discard(&self, cursor: &mut CursorMut, range: Range<Vaddr>) {
+        cursor.jump(range.start).unwrap();
+        cursor.unmap(range.len());
+    }
+
+    /// Checks whether the pages of the mapping can be removed as advised by
+    /// `MADV_REMOVE`.
+    pub(super) fn check_remove(&self) -> Result<()> {
+        if !self.is_shared {
+            return_errno_with_message!(Errno::EINVAL, "the mapping is not shared");
+        }
+        if !self.perms.contains(VmPerms::WRITE) {
+            return_errno_with_message!(Errno::EACCES, "the mapping is not writable");
+        }
+        Ok(())
+    }
+
+    /// Zeroes the pages of the mapped VMO in the range, as advised by
+    /// `MADV_REMOVE`.
+    ///
+    /// The pages are zeroed in the VMO rather than decommitted, so that the
+    /// other mappings of the VMO, which may still map the old pages, observe
+    /// the removal as well.
+    pub(super) fn clear_vmo_pages(&self, range: &Range<Vaddr>) -> Result<()> {
+        let Some((vmo, offset_range)) = self.vmo_offset_range(range) else {
+            return Ok(());
+        };
+        vmo.vmo.clear(offset_range)
+    }
+
+    /// Reads the pages of the mapped VMO in the range ahead, as advised by
+    /// `MADV_WILLNEED`.
+    ///
+    /// Anonymous mappings are ignored since there is no swap space to read
+    /// their pages from.
+    pub(super) fn prefetch(&self, range: &Range<Vaddr>) {
+        if let Some((vmo, offset_range)) = self.vmo_offset_range(range) {
+            vmo.vmo.prefetch_pages(get_page_idx_range(&offset_range));
+        }
+    }
+
+    /// Deactivates the pages in the range, as advised by `MADV_COLD` or
+    /// `MADV_PAGEOUT` if `pageout` is set.
+    ///
+    /// The accessed bits of the pages are cleared. To page out, the clean
+    /// pages of the mapped VMO are unmapped as well, so that they can be
+    /// reclaimed from the page cache. The other pages, e.g., the anonymous
+    /// ones, stay mapped since there is no swap space to page them out.
+    ///
+    /// The range must be in the mapping and covered by the cursor. The TLB
+    /// flushes are issued but not dispatched.
+    pub(super) fn deactivate(&self, cursor: &mut CursorMut, range: Range<Vaddr>, pageout: bool) {
+        cursor.jump(range.start).unwrap();
+
+        while cursor.virt_addr() < range.end {
+            let next_va = match cursor.query().unwrap() {
+                VmItem::NotMapped { va, len } => va.align_down(len) + len,
+                VmItem::Mapped { va, frame, prop } => {
+                    if pageout
+                        && !prop.flags.contains(PageFlags::DIRTY)
+                        && self.is_vmo_page(va, &frame)
+                    {
+                        cursor.unmap(PAGE_SIZE);
+                        continue;
+                    }
+                    if prop.flags.contains(PageFlags::ACCESSED) {
+                        let op = |p: &mut PageProperty| p.flags -= PageFlags::ACCESSED;
+                        if let Some(va) = cursor.protect_next(PAGE_SIZE, op) {
+                            cursor.flusher().issue_tlb_flush(TlbFlushOp::Range(va));
+                        }
+                        continue;
+                    }
+                    va + PAGE_SIZE
+                }
+            };
+            if next_va >= range.end {
+                break;
+            }
+            cursor.jump(next_va).unwrap();
+        }
+    }
+
+    /// Advises the pager of the mapped VMO that the pages in the range are
+    /// unlikely to be accessed soon.
+    pub(super) fn deactivate_vmo_pages(&self, range: &Range<Vaddr>) {
+        if let Some((vmo, offset_range)) = self.vmo_offset_range(range) {
+            vmo.vmo.deactivate_pages(get_page_idx_range(&offset_range));
+        }
+    }
+
+    /// Faults in the pages in the range, as advised by `MADV_POPULATE_READ`
+    /// or `MADV_POPULATE_WRITE` if `is_write` is set.
+    ///
+    /// The pages are mapped in one pass of a cursor, which only falls back to
+    /// the page fault handler for the pages that need I/O or copy-on-write.
+    pub(super) fn populate(
+        &self,
+        vm_space: &VmSpace,
+        range: Range<Vaddr>,
+        is_write: bool,
+    ) -> Result<()> {
+        let required_perms = if is_write {
+            VmPerms::WRITE
+        } else {
+            VmPerms::READ
+        };
+        if !self.perms.contains(required_perms) {
+            return_errno_with_message!(Errno::EFAULT, "the mapping cannot be accessed");
+        }
+
+        let mut populated_end = range.start;
+        while populated_end < range.end {
+            let Some(fault_addr) =
+                self.populate_with_cursor(vm_space, populated_end..range.end, is_write)?
+            else {
+                break;
+            };
+            let page_fault_info = PageFaultInfo {
+                address: fault_addr,
+                required_perms,
+            };
+            self.handle_page_fault(vm_space, &page_fault_info)?;
+            populated_end = fault_addr + PAGE_SIZE;
+        }
+
+        Ok(())
+    }
+
+    /// Maps the pages in the range with one cursor until a page needs to be
+    /// handled by the page fault handler, whose address is returned.
+    fn populate_with_cursor(
+        &self,
+        vm_space: &VmSpace,
+        range: Range<Vaddr>,
+        is_write: bool,
+    ) -> Result<Option<Vaddr>> {
+        let mut cursor = vm_space.cursor_mut(&range)?;
+
+        while cursor.virt_addr() < range.end {
+            let va = cursor.virt_addr();
+            match cursor.query()? {
+                VmItem::Mapped { prop, .. } => {
+                    if is_write && !prop.flags.contains(PageFlags::W) {
+                        return Ok(Some(va));
+                    }
+                    if va + PAGE_SIZE >= range.end {
+                        break;
+                    }
+                    cursor.jump(va + PAGE_SIZE)?;
+                }
+                VmItem::NotMapped { len, .. } => {
+                    if len >= HUGE_PAGE_SIZE
+                        && va + HUGE_PAGE_SIZE <= range.end
+                        && self.huge_page_addr_of(va) == Some(va)
+                        && self.map_huge_page(&mut cursor, is_write)
+                    {
+                        continue;
+                    }
+
+                    let (frame, is_readonly) = match self.prepare_page(va, is_write) {
+                        Ok((frame, is_readonly)) => (frame, is_readonly),
+                        Err(VmoCommitError::Err(e)) => return Err(e),
+                        Err(VmoCommitError::NeedIo(_)) => return Ok(Some(va)),
+                    };
+                    cursor.map(frame, self.new_page_prop(is_readonly, is_write));
+                }
+            }
+        }
+
+        Ok(None)
+    }
+
+    /// Maps the committed pages of the mapped VMO in the range in one pass
+    /// of a cursor, as if they are faulted in by reads.
+    ///
+    /// This prefaults the pages that are already in memory, e.g., the text
+    /// pages of an executable that stay in the page cache. The other pages
+    /// are left to the page fault handler, so no I/O is performed.
+    pub(super) fn map_committed_pages(
+        &self,
+        vm_space: &VmSpace,
+        range: Range<Vaddr>,
+    ) -> Result<()> {
+        let Some((vmo, offset_range)) = self.vmo_offset_range(&range) else {
+            return Ok(());
+        };
+        let map_start = self.map_to_addr + (offset_range.start - vmo.range.start);
+        let map_end = self.map_to_addr + (offset_range.end - vmo.range.start).align_up(PAGE_SIZE);
+        let page_prop = self.new_page_prop(!self.is_shared, false);
+
+        let mut cursor = vm_space.cursor_mut(&(map_start..map_end))?;
+        let mut va = map_start;
+        while va < map_end {
+            cursor.jump(va)?;
+            if let VmItem::NotMapped { .. } = cursor.query()? {
+                if let Some(frame) = vmo.committed_page(va - self.map_to_addr) {
+                    cursor.map(frame, page_prop);
+                }
+            }
+            va += PAGE_SIZE;
+        }
+
+        Ok(())
+    }
+
+    /// Returns the mapped VMO and the range of the VMO offsets that are
+    /// mapped to the range of virtual addresses.
+    fn vmo_offset_range(&self, range: &Range<Vaddr>) -> Option<(&MappedVmo, Range<usize>)> {
+        let vmo = self.vmo.as_ref()?;
+        let start = vmo.range.start + (range.start - self.map_to_addr);
+        let end = (vmo.range.start + (range.end - self.map_to_addr))
+            .min(vmo.range.end)
+            .min(vmo.vmo.size());
+        (start < end).then_some((vmo, start..end))
+    }
+
+    /// Returns whether the frame mapped at `va` is the page of the mapped VMO,
+    /// rather than a private copy of it.
+    fn is_vmo_page(&self, va: Vaddr, frame: &UFrame) -> bool {
+        let Some(vmo) = &self.vmo else {
+            return false;
+        };
+        let offset = va - self.map_to_addr;
+        offset < vmo.size()
+            && vmo.vmo.committed_paddr(vmo.range.start + offset) == Some(frame.start_paddr())
+    }
+}
+
+/***************************** Huge pages ************************************/
+
+impl VmMapping {
+    /// Returns the first huge page range in the mapping that starts at or
+    /// after `from`.
+    ///
+    /// Returns `None` if there is no such range, or if the base pages in the
+    /// mapping are never collapsed into huge pages.
+    pub(super) fn next_huge_page_range(&self, from: Vaddr) -> Option<Range<Vaddr>> {
+        if !self.allow_huge_pages || self.vmo.is_some() {
+            return None;
+        }
+
+        let start = max(from, self.map_to_addr).align_up(HUGE_PAGE_SIZE);
+        (start + HUGE_PAGE_SIZE <= self.map_end()).then_some(start..start + HUGE_PAGE_SIZE)
+    }
+
+    /// Returns whether the base pages in the huge page range can be collapsed.
+    ///
+    /// This only reads the page table, so the page faults in the mapping need
+    /// not be blocked. The result may be stale by the time of the collapse,
+    /// so [`Self::collapse_huge_page`] checks the range again.
+    pub(super) fn can_collapse_huge_page(
+        &self,
+        vm_space: &VmSpace,
+        huge_page_range: &Range<Vaddr>,
+    ) -> bool {
+        let Ok(mut cursor) = vm_space.cursor(huge_page_range) else {
+            return false;
+        };
+
+        scan_huge_page(huge_page_range, |va| {
+            cursor.jump(va).ok()?;
+            cursor.query().ok()
+        })
+        .is_some()
+    }
+
+    /// Collapses the base pages in the huge page range into a huge page.
+    ///
+    /// The range is collapsed if all the base pages in it are mapped and only
+    /// referenced by the mapping, i.e., they are not shared with other
+    /// processes after forks. The base pages are copied to a new huge page,
+    /// which then replaces them.
+    ///
+    /// The cursor must cover the range, and the page faults in the mapping
+    /// must be blocked during the collapse. Returns whether the range is
+    /// collapsed.
+    pub(super) fn collapse_huge_page(
+        &self,
+        cursor: &mut CursorMut,
+        huge_page_range: Range<Vaddr>,
+    ) -> bool {
+        let Some(items) = scan_huge_page(&huge_page_range, |va| {
+            cursor.jump(va).ok()?;
+            cursor.query().ok()
+        }) else {
+            return false;
+        };
+        let first_paddr = items[0].0.start_paddr();
+
+        // Without a policy, the huge page stays on the node of the base pages,
+        // rather than moving to the node of the collapsing thread.
+        let mut options = self.frame_alloc_options();
+        if self.mem_policy == MemPolicy::Default {
+            options.node(numa::node_of_paddr(first_paddr));
+        }
+        let Ok(segment) = options
+            .zeroed(false)
+            .align(HUGE_PAGE_SIZE)
+            .alloc_segment(HUGE_PAGE_SIZE / PAGE_SIZE)
+        else {
+            return false;
+        };
+
+        // Unmap the base pages and wait for the TLB flushes before the copy,
+        // so that they cannot be modified after being copied.
+        cursor.jump(huge_page_range.start).unwrap();
+        cursor.unmap(HUGE_PAGE_SIZE);
         cursor.flusher().dispatch_tlb_flush();
         cursor.flusher().sync_tlb_flush();
 
-        Self { perms, ..self }
+        let mut writer = segment.writer();
+        for (frame, _) in items.iter() {
+            writer.write(&mut frame.reader());
+        }
+
+        let page_flags = PageFlags::from(self.perms) | PageFlags::ACCESSED | PageFlags::DIRTY;
+        let map_prop = PageProperty::new(page_flags, CachePolicy::Writeback);
+        cursor.jump(huge_page_range.start).unwrap();
+        if cursor.map_huge(segment.into(), map_prop).is_ok() {
+            return true;
+        }
+
+        // Restore the base pages if the huge page cannot be mapped.
+        cursor.jump(huge_page_range.start).unwrap();
+        for (frame, prop) in items {
+            cursor.map(frame, prop);
+        }
+        false
     }
 }
 
+/// Returns the base pages in the huge page range if they can be collapsed.
+///
+/// The base pages can be collapsed if all of them are mapped and only
+/// referenced by the mapping, and they are not mapped by a huge page already.
+fn scan_huge_page(
+    huge_page_range: &Range<Vaddr>,
+    mut query: impl FnMut(Vaddr) -> Option<VmItem>,
+) -> Option<Vec<(UFrame, PageProperty)>> {
+    let mut query_exclusive_frame = |va: Vaddr| {
+        let VmItem::Mapped { frame, prop, .. } = query(va)? else {
+            return None;
+        };
+        // One reference is held by the mapping, and the other by `frame`.
+        (frame.reference_count() == 2).then_some((frame, prop))
+    };
+
+    // Skip the range if it is already mapped by a huge page, which can be
+    // told by the physical addresses of the first and the last pages.
+    let mut query_paddr =
+        |va: Vaddr| query_exclusive_frame(va).map(|(frame, _)| frame.start_paddr());
+    let first_paddr = query_paddr(huge_page_range.start)?;
+    let last_paddr = query_paddr(huge_page_range.end - PAGE_SIZE)?;
+    if first_paddr % HUGE_PAGE_SIZE == 0 && last_paddr == first_paddr + HUGE_PAGE_SIZE - PAGE_SIZE {
+        return None;
+    }
+
+    let mut items = Vec::with_capacity(HUGE_PAGE_SIZE / PAGE_SIZE);
+    for va in huge_page_range.clone().step_by(PAGE_SIZE) {
+        items.push(query_exclusive_frame(va)?);
+    }
+    Some(items)
+}
+
 /// A wrapper that represents a mapped [`Vmo`] and provide required functionalities
 /// that need to be provided to mappings from the VMO.
 #[derive(Debug)]
@@ -482,6 +1109,13 @@ impl MappedVmo {
         self.vmo.try_commit_page(self.range.start + page_offset)
     }
 
+    /// Gets the committed frame at the input offset in the mapped VMO, if
+    /// any, without committing one.
+    fn committed_page(&self, page_offset: usize) -> Option<UFrame> {
+        debug_assert!(page_offset < self.range.len());
+        self.vmo.committed_page(self.range.start + page_offset)
+    }
+
     /// Commits a page at a specific page index.
     ///
     /// This method may involve I/O operations if the VMO needs to fecth
@@ -491,30 +1125,6 @@ impl MappedVmo {
         self.vmo.commit_on(page_idx, commit_flags)
     }
 
-    /// Traverses the indices within a specified range of a VMO sequentially.
-    ///
-    /// For each index position, you have the option to commit the page as well as
-    /// perform other operations.
-    ///
-    /// Once a commit operation needs to perform I/O, it will return a [`VmoCommitError::NeedIo`].
-    fn try_operate_on_range<F>(
-        &self,
-        range: &Range<usize>,
-        operate: F,
-    ) -> core::result::Result<(), VmoCommitError>
-    where
-        F: FnMut(
-            &mut dyn FnMut() -> core::result::Result<UFrame, VmoCommitError>,
-        ) -> core::result::Result<(), VmoCommitError>,
-    {
-        debug_assert!(range.start < self.range.len());
-        debug_assert!(range.end <= self.range.len());
-
-        let range = self.range.start + range.start..self.range.start + range.end;
-
-        self.vmo.try_operate_on_range(&range, operate)
-    }
-
     /// Duplicates the capability.
     pub fn dup(&self) -> Result<Self> {
         Ok(Self {
@@ -34,30 +34,6 @@ impl Vmo<Rights> {
         self.0.commit_on(page_idx, commit_flags)
     }
 
-    /// Traverses the indices within a specified range of a VMO sequentially.
-    ///
-    /// For each index position, you have the option to commit the page as well as
-    /// perform other operations.
-    ///
-    /// Once a commit operation needs to perform I/O, it will return a [`VmoCommitError::NeedIo`].
-    ///
-    /// # Access rights
-    ///
-    /// The method requires the Write right.
-    pub(in crate::vm) fn try_operate_on_range<F>(
-        &self,
-        range: &Range<usize>,
-        operate: F,
-    ) -> core::result::Result<(), VmoCommitError>
-    where
-        F: FnMut(
-            &mut dyn FnMut() -> core::result::Result<UFrame, VmoCommitError>,
-        ) -> core::result::Result<(), VmoCommitError>,
-    {
-        self.check_rights(Rights::WRITE)?;
-        self.0.try_operate_on_range(range, operate)
-    }
-
     /// Decommits the pages specified in the range (in bytes).
     ///
     /// The range must be within the size of the VMO.
@@ -13,7 +13,7 @@ use core::{
 use align_ext::AlignExt;
 use aster_rights::Rights;
 use ostd::{
-    mm::{FrameAllocOptions, UFrame, UntypedMem, VmReader, VmWriter},
+    mm::{FrameAllocOptions, Paddr, UFrame, UntypedMem, VmReader, VmWriter},
     task::disable_preempt,
 };
 use xarray::{Cursor, LockedXArray, XArray};
@@ -26,7 +26,7 @@ mod pager;
 mod static_cap;
 
 pub use options::VmoOptions;
-pub use pager::Pager;
+pub use pager::{AccessPattern, Pager};
 
 /// Virtual Memory Objects (VMOs) are a type of capability that represents a
 /// range of memory pages.
@@ -203,6 +203,12 @@ impl Vmo_ {
     /// This method may involve I/O operations if the VMO needs to fetch a page from
     /// the underlying page cache.
     pub fn commit_on(&self, page_idx: usize, commit_flags: CommitFlags) -> Result<UFrame> {
+        // Look up the page without the lock first, so that concurrent readers of
+        // a committed page never contend nor prepare a page in vain.
+        if let Some(page) = self.committed_page(page_idx * PAGE_SIZE) {
+            return Ok(page);
+        }
+
         let new_page = self.prepare_page(page_idx, commit_flags)?;
 
         let mut locked_pages = self.pages.lock();
@@ -323,6 +329,25 @@ impl Vmo_ {
         }
     }
 
+    /// Returns the physical address of the committed page at the offset, if
+    /// any, without committing the page.
+    pub fn committed_paddr(&self, offset: usize) -> Option<Paddr> {
+        let guard = disable_preempt();
+        let mut cursor = self.pages.cursor(&guard, (offset / PAGE_SIZE) as u64);
+        cursor.load().map(|page| page.start_paddr())
+    }
+
+    /// Returns the committed page at the offset, if any, without committing
+    /// the page.
+    pub fn committed_page(&self, offset: usize) -> Option<UFrame> {
+        let guard = disable_preempt();
+        let mut cursor = self.pages.cursor(&guard, (offset / PAGE_SIZE) as u64);
+        if let Some(page) = cursor.load() {
+            return Some(page.clone());
+        }
+        None
+    }
+
     /// Decommits a range of pages in the VMO.
     pub fn decommit(&self, range: Range<usize>) -> Result<()> {
         let locked_pages = self.pages.lock();
@@ -441,25 +466,17 @@ impl Vmo_ {
         range: Range<usize>,
     ) -> Result<()> {
         let page_idx_range = get_page_idx_range(&range);
-        let mut cursor = locked_pages.cursor_mut(page_idx_range.start as u64);
+        let page_idx_range = page_idx_range.start as u64..page_idx_range.end as u64;
 
         let Some(pager) = &self.pager else {
-            for _ in page_idx_range {
-                cursor.remove();
-                cursor.next();
-            }
+            locked_pages.remove_range(page_idx_range, |_| {});
             return Ok(());
         };
 
         let mut removed_page_idx = Vec::new();
-        for page_idx in page_idx_range {
-            if cursor.remove().is_some() {
-                removed_page_idx.push(page_idx);
-            }
-            cursor.next();
-        }
-
-        drop(cursor);
+        locked_pages.remove_range(page_idx_range, |page_idx| {
+            removed_page_idx.push(page_idx as usize);
+        });
         drop(locked_pages);
 
         for page_idx in removed_page_idx {
@@ -469,6 +486,35 @@ impl Vmo_ {
         Ok(())
     }
 
+    /// Evicts the committed pages that are not used elsewhere.
+    ///
+    /// A page is evicted only if it is referenced by no one other than the
+    /// VMO and `nr_extra_refs` other holders (e.g., the page cache). Unlike
+    /// decommits, the pager is not notified, since eviction is requested by
+    /// the pager itself, which provides the pages again upon later commits.
+    ///
+    /// Returns the evicted pages.
+    fn evict_unused_pages(&self, page_idxs: &[usize], nr_extra_refs: u64) -> Vec<(usize, UFrame)> {
+        let mut locked_pages = self.pages.lock();
+        let mut evicted_pages = Vec::new();
+
+        let mut cursor = locked_pages.cursor_mut(0);
+        for &page_idx in page_idxs {
+            cursor.reset_to(page_idx as u64);
+            let Some(page) = cursor.load() else {
+                continue;
+            };
+            if page.reference_count() > 1 + nr_extra_refs {
+                continue;
+            }
+            let page = page.clone();
+            cursor.remove();
+            evicted_pages.push((page_idx, page));
+        }
+
+        evicted_pages
+    }
+
     /// Returns the flags of current VMO.
     pub fn flags(&self) -> VmoFlags {
         self.flags
@@ -495,6 +541,58 @@ impl<R> Vmo<R> {
     pub fn flags(&self) -> VmoFlags {
         self.0.flags()
     }
+
+    /// Evicts the committed pages that are not used elsewhere.
+    ///
+    /// This is used by pagers to reclaim their pages. A page is evicted only
+    /// if it is referenced by no one other than the VMO and `nr_extra_refs`
+    /// other holders. The evicted pages are returned.
+    ///
+    /// Lockless readers may have loaded an evicted page right before the
+    /// eviction, so the caller should wait for an RCU grace period before
+    /// checking whether the evicted pages are still in use.
+    pub fn evict_unused_pages(
+        &self,
+        page_idxs: &[usize],
+        nr_extra_refs: u64,
+    ) -> Vec<(usize, UFrame)> {
+        self.0.evict_unused_pages(page_idxs, nr_extra_refs)
+    }
+
+    /// Returns the physical address of the committed page at the offset, if
+    /// any, without committing the page.
+    pub fn committed_paddr(&self, offset: usize) -> Option<Paddr> {
+        self.0.committed_paddr(offset)
+    }
+
+    /// Returns the committed page at the offset, if any, without committing
+    /// the page.
+    pub fn committed_page(&self, offset: usize) -> Option<UFrame> {
+        self.0.committed_page(offset)
+    }
+
+    /// Advises the pager of the VMO, if any, of the expected access pattern.
+    pub fn advise_access(&self, pattern: AccessPattern) {
+        if let Some(pager) = &self.0.pager {
+            pager.advise_access(pattern);
+        }
+    }
+
+    /// Asks the pager of the VMO, if any, to read the pages in the range
+    /// ahead in the background.
+    pub fn prefetch_pages(&self, page_idx_range: Range<usize>) {
+        if let Some(pager) = &self.0.pager {
+            pager.prefetch_pages(page_idx_range);
+        }
+    }
+
+    /// Advises the pager of the VMO, if any, that the pages in the range are
+    /// not expected to be accessed soon.
+    pub fn deactivate_pages(&self, page_idx_range: Range<usize>) {
+        if let Some(pager) = &self.0.pager {
+            pager.deactivate_pages(page_idx_range);
+        }
+    }
 }
 
 /// Gets the page index range that contains the offset range of VMO.
@@ -137,14 +137,7 @@ fn committed_pages_if_continuous(flags: VmoFlags, size: usize) -> Result<XArray<
         let frames_num = size / PAGE_SIZE;
         let segment: USegment = FrameAllocOptions::new().alloc_segment(frames_num)?.into();
         let committed_pages = XArray::new();
-        let mut locked_pages = committed_pages.lock();
-        let mut cursor = locked_pages.cursor_mut(0);
-        for frame in segment {
-            cursor.store(frame);
-            cursor.next();
-        }
-        drop(cursor);
-        drop(locked_pages);
+        committed_pages.lock().store_range(0, segment);
         Ok(committed_pages)
     } else {
         // otherwise, we wait for the page is read or write
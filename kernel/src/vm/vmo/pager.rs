@@ -1,5 +1,7 @@
 // SPDX-License-Identifier: MPL-2.0
 
+use core::ops::Range;
+
 use ostd::mm::UFrame;
 
 use crate::prelude::*;
@@ -55,4 +57,34 @@ pub trait Pager: Send + Sync {
     /// Notify the pager that the frame will be fully overwritten soon, so pager can
     /// choose not to initialize it.
     fn commit_overwrite(&self, idx: usize) -> Result<UFrame>;
+
+    /// Advises the pager of the expected access pattern of the VMO.
+    ///
+    /// The pager (e.g., a page cache) may use the hint to tune its
+    /// readahead. The default implementation ignores the hint.
+    fn advise_access(&self, _pattern: AccessPattern) {}
+
+    /// Asks the pager to read the pages in the range ahead in the
+    /// background, without waiting for them.
+    ///
+    /// The default implementation ignores the request.
+    fn prefetch_pages(&self, _idx_range: Range<usize>) {}
+
+    /// Advises the pager that the pages in the range are not expected to be
+    /// accessed soon.
+    ///
+    /// The pager (e.g., a page cache) may reclaim the pages ahead of the
+    /// others. The default implementation ignores the hint.
+    fn deactivate_pages(&self, _idx_range: Range<usize>) {}
+}
+
+/// The expected access pattern of a VMO, as advised by the user.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum AccessPattern {
+    /// No special treatment.
+    Normal,
+    /// The pages are expected to be accessed sequentially.
+    Sequential,
+    /// The pages are expected to be accessed in random order.
+    Random,
 }
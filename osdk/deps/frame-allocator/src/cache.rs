@@ -2,16 +2,54 @@
 
 //! A fixed-size local cache for frame allocation.
 
-use core::{alloc::Layout, cell::RefCell};
+use core::{
+    alloc::Layout,
+    cell::RefCell,
+    sync::atomic::{AtomicUsize, Ordering},
+};
 
 use ostd::{
+    cpu::{local::CpuLocal, CpuId, PinCurrentCpu},
     cpu_local,
-    mm::{Paddr, PAGE_SIZE},
+    mm::{
+        numa::{self, NodeId},
+        Paddr, PAGE_SIZE,
+    },
     trap::DisabledLocalIrqGuard,
 };
 
 cpu_local! {
     static CACHE: RefCell<CacheOfSizes> = RefCell::new(CacheOfSizes::new());
+    static CACHE_HITS: AtomicUsize = AtomicUsize::new(0);
+    static CACHE_MISSES: AtomicUsize = AtomicUsize::new(0);
+    static CACHE_DRAINS: AtomicUsize = AtomicUsize::new(0);
+}
+
+/// Statistics of the CPU-local frame cache on one CPU.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct CacheStats {
+    /// The number of allocations served directly from the cache.
+    pub hits: usize,
+    /// The number of allocations that had to refill the cache from the pools.
+    pub misses: usize,
+    /// The number of deallocations that drained a full cache to the pools.
+    pub drains: usize,
+}
+
+/// Loads the statistics of the CPU-local frame cache on the given CPU.
+///
+/// The counters are updated with relaxed atomics, so the returned values are
+/// only a snapshot and may be slightly stale.
+pub fn load_cache_stats(cpu: CpuId) -> CacheStats {
+    CacheStats {
+        hits: CACHE_HITS.get_on_cpu(cpu).load(Ordering::Relaxed),
+        misses: CACHE_MISSES.get_on_cpu(cpu).load(Ordering::Relaxed),
+        drains: CACHE_DRAINS.get_on_cpu(cpu).load(Ordering::Relaxed),
+    }
+}
+
+fn count(counter: &'static CpuLocal<AtomicUsize>, guard: &DisabledLocalIrqGuard) {
+    counter.get_with(guard).fetch_add(1, Ordering::Relaxed);
 }
 
 struct CacheOfSizes {
@@ -46,17 +84,28 @@ impl<const NR_CONT_FRAMES: usize, const COUNT: usize> CacheArray<NR_CONT_FRAMES,
     /// Allocates a segment of frames.
     ///
     /// It may allocate directly from this cache. If the cache is empty, it
-    /// will fill the cache.
-    fn alloc(&mut self, guard: &DisabledLocalIrqGuard) -> Option<Paddr> {
+    /// will fill the cache in a batch. If the pools cannot provide a whole
+    /// batch, it falls back to allocating a single segment.
+    fn alloc(&mut self, guard: &DisabledLocalIrqGuard, node: NodeId) -> Option<Paddr> {
         if let Some(frame) = self.pop_front() {
+            count(&CACHE_HITS, guard);
             return Some(frame);
         }
 
+        count(&CACHE_MISSES, guard);
+
         let nr_to_alloc = COUNT * 2 / 3;
-        let allocated = super::pools::alloc(
+        let Some(allocated) = super::pools::alloc(
             guard,
             Layout::from_size_align(nr_to_alloc * Self::segment_size(), PAGE_SIZE).unwrap(),
-        )?;
+            node,
+        ) else {
+            return super::pools::alloc(
+                guard,
+                Layout::from_size_align(Self::segment_size(), PAGE_SIZE).unwrap(),
+                node,
+            );
+        };
 
         for i in 1..nr_to_alloc {
             self.push_front(allocated + i * Self::segment_size());
@@ -71,6 +120,8 @@ impl<const NR_CONT_FRAMES: usize, const COUNT: usize> CacheArray<NR_CONT_FRAMES,
     /// deallocate to the global pool.
     fn dealloc(&mut self, guard: &DisabledLocalIrqGuard, addr: Paddr) {
         if self.push_front(addr).is_none() {
+            count(&CACHE_DRAINS, guard);
+
             let nr_to_dealloc = COUNT * 2 / 3 + 1;
 
             let segments = (0..nr_to_dealloc).map(|i| {
@@ -117,27 +168,32 @@ impl CacheOfSizes {
     }
 }
 
-pub(super) fn alloc(guard: &DisabledLocalIrqGuard, layout: Layout) -> Option<Paddr> {
+/// Allocates frames on the given node.
+///
+/// Only the allocations on the node of the current CPU are served by the
+/// cache, so that the cache only holds the local memory.
+pub(super) fn alloc(guard: &DisabledLocalIrqGuard, layout: Layout, node: NodeId) -> Option<Paddr> {
     let nr_frames = layout.size() / PAGE_SIZE;
-    if layout.align() > layout.size() {
-        return super::pools::alloc(guard, layout);
+    if layout.align() > layout.size() || node != numa::node_of_cpu(guard.current_cpu()) {
+        return super::pools::alloc(guard, layout, node);
     }
 
     let cache_cell = CACHE.get_with(guard);
     let mut cache = cache_cell.borrow_mut();
 
     match nr_frames {
-        1 => cache.cache1.alloc(guard),
-        2 => cache.cache2.alloc(guard),
-        3 => cache.cache3.alloc(guard),
-        4 => cache.cache4.alloc(guard),
-        _ => super::pools::alloc(guard, layout),
+        1 => cache.cache1.alloc(guard, node),
+        2 => cache.cache2.alloc(guard, node),
+        3 => cache.cache3.alloc(guard, node),
+        4 => cache.cache4.alloc(guard, node),
+        _ => super::pools::alloc(guard, layout, node),
     }
 }
 
 pub(super) fn dealloc(guard: &DisabledLocalIrqGuard, addr: Paddr, size: usize) {
     let nr_frames = size / PAGE_SIZE;
-    if nr_frames > 4 {
+    // The memory on remote nodes goes back to the pools of its node.
+    if nr_frames > 4 || numa::node_of_paddr(addr) != numa::node_of_cpu(guard.current_cpu()) {
         super::pools::dealloc(guard, [(addr, size)].into_iter());
         return;
     }
@@ -32,8 +32,12 @@ use core::alloc::Layout;
 
 use ostd::{
     cpu::PinCurrentCpu,
-    mm::{frame::GlobalFrameAllocator, Paddr},
-    trap,
+    mm::{
+        frame::GlobalFrameAllocator,
+        numa::{self, NodeId},
+        Paddr,
+    },
+    trap::{self, DisabledLocalIrqGuard},
 };
 
 mod cache;
@@ -45,6 +49,8 @@ mod smp_counter;
 #[cfg(ktest)]
 mod test;
 
+pub use cache::{load_cache_stats, CacheStats};
+
 fast_smp_counter! {
     /// The total size of free memory.
     pub static TOTAL_FREE_SIZE: usize;
@@ -60,17 +66,38 @@ pub fn load_total_free_size() -> usize {
 /// It is a singleton that provides frame allocation for the kernel. If
 /// multiple instances of this struct are created, all the member functions
 /// will eventually access the same allocator.
+///
+/// On NUMA machines, the free memory of each node is kept apart. Frames are
+/// allocated on the node of the current CPU unless another node is asked
+/// for, and on the nearest nodes if the node runs out of memory.
 pub struct FrameAllocator;
 
-impl GlobalFrameAllocator for FrameAllocator {
-    fn alloc(&self, layout: Layout) -> Option<Paddr> {
-        let guard = trap::disable_local();
-        let res = cache::alloc(&guard, layout);
+impl FrameAllocator {
+    fn alloc_with(
+        &self,
+        guard: &DisabledLocalIrqGuard,
+        layout: Layout,
+        node: NodeId,
+    ) -> Option<Paddr> {
+        let res = cache::alloc(guard, layout, node);
         if res.is_some() {
             TOTAL_FREE_SIZE.sub(guard.current_cpu(), layout.size());
         }
         res
     }
+}
+
+impl GlobalFrameAllocator for FrameAllocator {
+    fn alloc(&self, layout: Layout) -> Option<Paddr> {
+        let guard = trap::disable_local();
+        let node = numa::node_of_cpu(guard.current_cpu());
+        self.alloc_with(&guard, layout, node)
+    }
+
+    fn alloc_on_node(&self, layout: Layout, node: NodeId) -> Option<Paddr> {
+        let guard = trap::disable_local();
+        self.alloc_with(&guard, layout, node)
+    }
 
     fn dealloc(&self, addr: Paddr, size: usize) {
         let guard = trap::disable_local();
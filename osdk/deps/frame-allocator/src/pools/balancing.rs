@@ -2,7 +2,7 @@
 
 //! Controlling the balancing between CPU-local free pools and the global free pool.
 
-use ostd::cpu::num_cpus;
+use ostd::mm::numa::{self, NodeId};
 
 use super::{lesser_order_of, BuddyOrder, BuddySet, OnDemandGlobalLock, MAX_LOCAL_BUDDY_ORDER};
 
@@ -10,15 +10,16 @@ use crate::chunk::split_to_order;
 
 /// Controls the expected size of cache for each CPU-local free pool.
 ///
-/// The expected size will be the size of `GLOBAL_POOL` divided by the number
-/// of the CPUs, and then divided by this constant.
+/// The expected size will be the size of the node's pool in `GLOBAL_POOLS`
+/// divided by the number of the CPUs on the node, and then divided by this
+/// constant.
 const CACHE_EXPECTED_PORTION: usize = 2;
 
 /// Returns the expected size of cache for each CPU-local free pool.
 ///
-/// It depends on the size of the global free pool.
-fn cache_expected_size(global_size: usize) -> usize {
-    global_size / num_cpus() / CACHE_EXPECTED_PORTION
+/// It depends on the size of the global free pool of the node.
+fn cache_expected_size(node: NodeId, global_size: usize) -> usize {
+    global_size / numa::nr_cpus_of_node(node).max(1) / CACHE_EXPECTED_PORTION
 }
 
 /// Controls the minimal size of cache for each CPU-local free pool.
@@ -28,9 +29,9 @@ const CACHE_MINIMAL_PORTION: usize = 8;
 
 /// Returns the minimal size of cache for each CPU-local free pool.
 ///
-/// It depends on the size of the global free pool.
-fn cache_minimal_size(global_size: usize) -> usize {
-    cache_expected_size(global_size) / CACHE_MINIMAL_PORTION
+/// It depends on the size of the global free pool of the node.
+fn cache_minimal_size(node: NodeId, global_size: usize) -> usize {
+    cache_expected_size(node, global_size) / CACHE_MINIMAL_PORTION
 }
 
 /// Controls the maximal size of cache for each CPU-local free pool.
@@ -40,18 +41,19 @@ const CACHE_MAXIMAL_MULTIPLIER: usize = 2;
 
 /// Returns the maximal size of cache for each CPU-local free pool.
 ///
-/// It depends on the size of the global free pool.
-fn cache_maximal_size(global_size: usize) -> usize {
-    cache_expected_size(global_size) * CACHE_MAXIMAL_MULTIPLIER
+/// It depends on the size of the global free pool of the node.
+fn cache_maximal_size(node: NodeId, global_size: usize) -> usize {
+    cache_expected_size(node, global_size) * CACHE_MAXIMAL_MULTIPLIER
 }
 
-/// Balances a local cache and the global free pool.
+/// Balances a local cache and the global free pool of the same node.
 pub fn balance(local: &mut BuddySet<MAX_LOCAL_BUDDY_ORDER>, global: &mut OnDemandGlobalLock) {
+    let node = global.local_node;
     let global_size = global.get_global_size();
 
-    let minimal_local_size = cache_minimal_size(global_size);
-    let expected_local_size = cache_expected_size(global_size);
-    let maximal_local_size = cache_maximal_size(global_size);
+    let minimal_local_size = cache_minimal_size(node, global_size);
+    let expected_local_size = cache_expected_size(node, global_size);
+    let maximal_local_size = cache_maximal_size(node, global_size);
 
     let local_size = local.total_size();
 
@@ -10,8 +10,12 @@ use core::{
 };
 
 use ostd::{
+    cpu::PinCurrentCpu,
     cpu_local,
-    mm::Paddr,
+    mm::{
+        numa::{self, NodeId, MAX_NODES},
+        Paddr,
+    },
     sync::{LocalIrqDisabled, SpinLock, SpinLockGuard},
     trap::DisabledLocalIrqGuard,
 };
@@ -20,13 +24,16 @@ use crate::chunk::{greater_order_of, lesser_order_of, size_of_order, split_to_ch
 
 use super::set::BuddySet;
 
-/// The global free buddies.
-static GLOBAL_POOL: SpinLock<BuddySet<MAX_BUDDY_ORDER>, LocalIrqDisabled> =
-    SpinLock::new(BuddySet::new_empty());
-/// A snapshot of the total size of the global free buddies, not precise.
-static GLOBAL_POOL_SIZE: AtomicUsize = AtomicUsize::new(0);
+/// The global free buddies of each NUMA node.
+static GLOBAL_POOLS: [SpinLock<BuddySet<MAX_BUDDY_ORDER>, LocalIrqDisabled>; MAX_NODES] =
+    [const { SpinLock::new(BuddySet::new_empty()) }; MAX_NODES];
+/// Snapshots of the total sizes of the global free buddies of each node, not precise.
+static GLOBAL_POOL_SIZES: [AtomicUsize; MAX_NODES] = [const { AtomicUsize::new(0) }; MAX_NODES];
 
 // CPU-local free buddies.
+//
+// They only contain the memory on the node of the CPU, so that the fast path
+// always allocates local memory.
 cpu_local! {
     static LOCAL_POOL: RefCell<BuddySet<MAX_LOCAL_BUDDY_ORDER>> = RefCell::new(BuddySet::new_empty());
 }
@@ -51,10 +58,11 @@ const MAX_BUDDY_ORDER: BuddyOrder = 32;
 /// chunks.
 const MAX_LOCAL_BUDDY_ORDER: BuddyOrder = 18;
 
-pub(super) fn alloc(guard: &DisabledLocalIrqGuard, layout: Layout) -> Option<Paddr> {
+pub(super) fn alloc(guard: &DisabledLocalIrqGuard, layout: Layout, node: NodeId) -> Option<Paddr> {
+    let local_node = numa::node_of_cpu(guard.current_cpu());
     let local_pool_cell = LOCAL_POOL.get_with(guard);
     let mut local_pool = local_pool_cell.borrow_mut();
-    let mut global_pool = OnDemandGlobalLock::new();
+    let mut global_pool = OnDemandGlobalLock::new(local_node);
 
     let size_order = greater_order_of(layout.size());
     let align_order = greater_order_of(layout.align());
@@ -62,13 +70,15 @@ pub(super) fn alloc(guard: &DisabledLocalIrqGuard, layout: Layout) -> Option<Pad
 
     let mut chunk_addr = None;
 
-    if order < MAX_LOCAL_BUDDY_ORDER {
+    if order < MAX_LOCAL_BUDDY_ORDER && node == local_node {
         chunk_addr = local_pool.alloc_chunk(order);
     }
 
-    // Fall back to the global free lists if the local free lists are empty.
+    // Fall back to the global free lists if the local free lists are empty,
+    // trying the nearer nodes first if the requested node is exhausted.
     if chunk_addr.is_none() {
-        chunk_addr = global_pool.get().alloc_chunk(order);
+        chunk_addr = numa::nodes_by_distance(node)
+            .find_map(|node| global_pool.get_node(node).alloc_chunk(order));
     }
     // TODO: On memory pressure the global pool may be not enough. We may need
     // to merge all buddy chunks from the local pools to the global pool and
@@ -98,9 +108,10 @@ pub(super) fn dealloc(
     guard: &DisabledLocalIrqGuard,
     segments: impl Iterator<Item = (Paddr, usize)>,
 ) {
+    let local_node = numa::node_of_cpu(guard.current_cpu());
     let local_pool_cell = LOCAL_POOL.get_with(guard);
     let mut local_pool = local_pool_cell.borrow_mut();
-    let mut global_pool = OnDemandGlobalLock::new();
+    let mut global_pool = OnDemandGlobalLock::new(local_node);
 
     do_dealloc(&mut local_pool, &mut global_pool, segments);
 
@@ -109,12 +120,21 @@ pub(super) fn dealloc(
     global_pool.update_global_size_if_locked();
 }
 
-pub(super) fn add_free_memory(_guard: &DisabledLocalIrqGuard, addr: Paddr, size: usize) {
-    let mut global_pool = OnDemandGlobalLock::new();
-
-    split_to_chunks(addr, size).for_each(|(addr, order)| {
-        global_pool.get().insert_chunk(addr, order);
-    });
+pub(super) fn add_free_memory(guard: &DisabledLocalIrqGuard, addr: Paddr, size: usize) {
+    let mut global_pool = OnDemandGlobalLock::new(numa::node_of_cpu(guard.current_cpu()));
+
+    // Split the memory at the node boundaries so that each node's pool only
+    // contains the memory on that node.
+    let end = addr + size;
+    let mut start = addr;
+    while start < end {
+        let node = numa::node_of_paddr(start);
+        let node_end = numa::node_range_end(start, end);
+        split_to_chunks(start, node_end - start).for_each(|(addr, order)| {
+            global_pool.get_node(node).insert_chunk(addr, order);
+        });
+        start = node_end;
+    }
 
     global_pool.update_global_size_if_locked();
 }
@@ -125,9 +145,12 @@ fn do_dealloc(
     segments: impl Iterator<Item = (Paddr, usize)>,
 ) {
     segments.for_each(|(addr, size)| {
+        // A segment is allocated from a single node, so its chunks are on the
+        // same node.
+        let node = numa::node_of_paddr(addr);
         split_to_chunks(addr, size).for_each(|(addr, order)| {
-            if order >= MAX_LOCAL_BUDDY_ORDER {
-                global_pool.get().insert_chunk(addr, order);
+            if order >= MAX_LOCAL_BUDDY_ORDER || node != global_pool.local_node {
+                global_pool.get_node(node).insert_chunk(addr, order);
             } else {
                 local_pool.insert_chunk(addr, order);
             }
@@ -141,36 +164,62 @@ type GlobalLockGuard = SpinLockGuard<'static, BuddySet<MAX_BUDDY_ORDER>, LocalIr
 ///
 /// It helps to avoid unnecessarily locking the global pool, and also avoids
 /// repeatedly locking the global pool when it is needed multiple times.
+///
+/// At most one node's global pool is locked at a time, so that CPUs on
+/// different nodes never deadlock by locking each other's pools.
 struct OnDemandGlobalLock {
-    guard: Option<GlobalLockGuard>,
+    /// The node of the current CPU, whose pool is balanced with the local pool.
+    local_node: NodeId,
+    guard: Option<(NodeId, GlobalLockGuard)>,
 }
 
 impl OnDemandGlobalLock {
-    fn new() -> Self {
-        Self { guard: None }
+    fn new(local_node: NodeId) -> Self {
+        Self {
+            local_node,
+            guard: None,
+        }
     }
 
+    /// Locks the global pool of the current CPU's node.
     fn get(&mut self) -> &mut GlobalLockGuard {
-        self.guard.get_or_insert_with(|| GLOBAL_POOL.lock())
+        self.get_node(self.local_node)
+    }
+
+    /// Locks the global pool of the given node.
+    ///
+    /// The pool of another node that is locked before is unlocked.
+    fn get_node(&mut self, node: NodeId) -> &mut GlobalLockGuard {
+        if self
+            .guard
+            .as_ref()
+            .is_some_and(|(locked, _)| *locked != node)
+        {
+            self.update_global_size_if_locked();
+            self.guard = None;
+        }
+        let (_, guard) = self
+            .guard
+            .get_or_insert_with(|| (node, GLOBAL_POOLS[node.as_usize()].lock()));
+        guard
     }
 
-    /// Updates [`GLOBAL_POOL_SIZE`] if the global pool is locked.
+    /// Updates [`GLOBAL_POOL_SIZES`] if a global pool is locked.
     fn update_global_size_if_locked(&self) {
-        if let Some(guard) = self.guard.as_ref() {
-            GLOBAL_POOL_SIZE.store(guard.total_size(), Ordering::Relaxed);
+        if let Some((node, guard)) = self.guard.as_ref() {
+            GLOBAL_POOL_SIZES[node.as_usize()].store(guard.total_size(), Ordering::Relaxed);
         }
     }
 
-    /// Returns the size of the global pool.
+    /// Returns the size of the global pool of the current CPU's node.
     ///
     /// If the global pool is locked, returns the actual size of the global pool.
     /// Otherwise, returns the last snapshot of the global pool size by loading
-    /// [`GLOBAL_POOL_SIZE`].
+    /// [`GLOBAL_POOL_SIZES`].
     fn get_global_size(&self) -> usize {
-        if let Some(guard) = self.guard.as_ref() {
-            guard.total_size()
-        } else {
-            GLOBAL_POOL_SIZE.load(Ordering::Relaxed)
+        match self.guard.as_ref() {
+            Some((node, guard)) if *node == self.local_node => guard.total_size(),
+            _ => GLOBAL_POOL_SIZES[self.local_node.as_usize()].load(Ordering::Relaxed),
         }
     }
 }
@@ -5,11 +5,16 @@
 use core::alloc::Layout;
 
 use ostd::{
-    mm::{frame::GlobalFrameAllocator, FrameAllocOptions, Paddr, Segment, UniqueFrame, PAGE_SIZE},
+    cpu::PinCurrentCpu,
+    mm::{
+        frame::GlobalFrameAllocator, numa, FrameAllocOptions, Paddr, Segment, UniqueFrame,
+        PAGE_SIZE,
+    },
     prelude::ktest,
+    task::disable_preempt,
 };
 
-use super::FrameAllocator;
+use super::{load_cache_stats, FrameAllocator};
 
 #[ktest]
 fn frame_allocator_alloc_layout_match() {
@@ -24,6 +29,32 @@ fn frame_allocator_alloc_layout_match() {
     assert_allocation_well_formed(Layout::from_size_align(PAGE_SIZE * 16, PAGE_SIZE * 16).unwrap());
 }
 
+#[ktest]
+fn frame_allocator_cache_stats_counted() {
+    let preempt_guard = disable_preempt();
+    let cpu = preempt_guard.current_cpu();
+    let before = load_cache_stats(cpu);
+
+    let options = FrameAllocOptions::new();
+    drop(options.alloc_frame().unwrap());
+    drop(options.alloc_frame().unwrap());
+
+    let after = load_cache_stats(cpu);
+    assert!(after.hits + after.misses >= before.hits + before.misses + 2);
+}
+
+#[ktest]
+fn frame_allocator_alloc_on_node() {
+    let layout = Layout::from_size_align(PAGE_SIZE, PAGE_SIZE).unwrap();
+    for node in numa::all_nodes() {
+        // A node without free memory falls back to the nearest node that has.
+        let allocated = FrameAllocator.alloc_on_node(layout, node).unwrap();
+        let allocated_node = numa::node_of_paddr(allocated);
+        assert!(numa::nodes_by_distance(node).any(|node| node == allocated_node));
+        FrameAllocator.dealloc(allocated, PAGE_SIZE);
+    }
+}
+
 #[track_caller]
 fn assert_allocation_well_formed(layout: Layout) {
     let instance = FrameAllocator;
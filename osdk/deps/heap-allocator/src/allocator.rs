@@ -125,17 +125,22 @@ impl Heap {
         }
     }
 
-    fn alloc(&mut self, class: CommonSizeClass) -> Result<HeapSlot, AllocError> {
+    fn alloc_batch(
+        &mut self,
+        class: CommonSizeClass,
+        nr: usize,
+        f: &mut dyn FnMut(HeapSlot),
+    ) -> usize {
         match class {
-            CommonSizeClass::Bytes8 => self.slab8.alloc(),
-            CommonSizeClass::Bytes16 => self.slab16.alloc(),
-            CommonSizeClass::Bytes32 => self.slab32.alloc(),
-            CommonSizeClass::Bytes64 => self.slab64.alloc(),
-            CommonSizeClass::Bytes128 => self.slab128.alloc(),
-            CommonSizeClass::Bytes256 => self.slab256.alloc(),
-            CommonSizeClass::Bytes512 => self.slab512.alloc(),
-            CommonSizeClass::Bytes1024 => self.slab1024.alloc(),
-            CommonSizeClass::Bytes2048 => self.slab2048.alloc(),
+            CommonSizeClass::Bytes8 => self.slab8.alloc_batch(nr, f),
+            CommonSizeClass::Bytes16 => self.slab16.alloc_batch(nr, f),
+            CommonSizeClass::Bytes32 => self.slab32.alloc_batch(nr, f),
+            CommonSizeClass::Bytes64 => self.slab64.alloc_batch(nr, f),
+            CommonSizeClass::Bytes128 => self.slab128.alloc_batch(nr, f),
+            CommonSizeClass::Bytes256 => self.slab256.alloc_batch(nr, f),
+            CommonSizeClass::Bytes512 => self.slab512.alloc_batch(nr, f),
+            CommonSizeClass::Bytes1024 => self.slab1024.alloc_batch(nr, f),
+            CommonSizeClass::Bytes2048 => self.slab2048.alloc_batch(nr, f),
         }
     }
 
@@ -183,25 +188,22 @@ impl<const SLOT_SIZE: usize> ObjectCache<SLOT_SIZE> {
             return Ok(slot);
         }
 
+        // Refill the cache with one more slot than expected in a single
+        // critical section of the global pool, so the extra one can be
+        // returned to the caller.
         let size_class = CommonSizeClass::from_size(SLOT_SIZE).unwrap();
-        let mut global_pool = GLOBAL_POOL.lock();
-        for _ in 0..OBJ_CACHE_EXPECTED_SIZE / SLOT_SIZE {
-            if let Ok(slot) = global_pool.alloc(size_class) {
-                self.list.push(slot);
-                self.list_size += SLOT_SIZE;
-            } else {
-                break;
-            }
-        }
-
-        if let Ok(new_slot) = global_pool.alloc(size_class) {
-            Ok(new_slot)
-        } else if let Some(popped) = self.list.pop() {
-            self.list_size -= SLOT_SIZE;
-            Ok(popped)
-        } else {
-            Err(AllocError)
-        }
+        let nr_refilled = GLOBAL_POOL.lock().alloc_batch(
+            size_class,
+            OBJ_CACHE_EXPECTED_SIZE / SLOT_SIZE + 1,
+            &mut |slot| self.list.push(slot),
+        );
+        self.list_size += nr_refilled * SLOT_SIZE;
+
+        let Some(popped) = self.list.pop() else {
+            return Err(AllocError);
+        };
+        self.list_size -= SLOT_SIZE;
+        Ok(popped)
     }
 
     fn dealloc(&mut self, slot: HeapSlot, class: CommonSizeClass) -> Result<(), AllocError> {
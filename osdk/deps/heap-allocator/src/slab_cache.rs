@@ -37,48 +37,39 @@ impl<const SLOT_SIZE: usize> SlabCache<SLOT_SIZE> {
         }
     }
 
-    /// Allocates a slot from the cache.
+    /// Allocates at most `nr` slots from the cache in a batch.
     ///
-    /// The caller must provide which cache is it because we don't know from
-    /// `&mut self`. The information is used for deallocation.
-    pub fn alloc(&mut self) -> Result<HeapSlot, AllocError> {
-        // Try to allocate from the partial slabs first.
-        if !self.partial.is_empty() {
-            let mut cursor = self.partial.cursor_back_mut();
-            let current = cursor.current_meta().unwrap();
-            let allocated = current.alloc().unwrap();
-            if current.nr_allocated() == current.capacity() {
-                self.full.push_front(cursor.take_current().unwrap());
-            }
-            return Ok(allocated);
-        }
-
-        // If no partial slab is available, try to get an empty slab.
-        if !self.empty.is_empty() {
-            let mut slab = self.empty.pop_front().unwrap();
-            let allocated = slab.meta_mut().alloc().unwrap();
-            self.add_slab(slab);
-            return Ok(allocated);
-        }
-
-        // If no empty slab is available, allocate new slabs.
-        let Ok(mut allocated_empty) = Slab::new() else {
-            log::error!("Failed to allocate a new slab");
-            return Err(AllocError);
-        };
-        let allocated = allocated_empty.meta_mut().alloc().unwrap();
-        self.add_slab(allocated_empty);
-
-        // Allocate more empty slabs and push them into the cache.
-        for _ in 0..EXPECTED_EMPTY_SLABS {
-            if let Ok(allocated_empty) = Slab::new() {
-                self.empty.push_front(allocated_empty);
+    /// Each allocated slot is handed to `f`. Slots are taken from one slab
+    /// until it is full before moving on to the next slab, so the slab lists
+    /// are only manipulated once per slab rather than once per slot.
+    ///
+    /// Returns the number of allocated slots, which may be less than `nr` if
+    /// no more slabs can be allocated.
+    pub fn alloc_batch(&mut self, nr: usize, f: &mut dyn FnMut(HeapSlot)) -> usize {
+        let mut nr_allocated = 0;
+
+        while nr_allocated < nr {
+            let mut slab = if let Some(slab) = self.partial.pop_back() {
+                slab
+            } else if let Some(slab) = self.empty.pop_front() {
+                slab
+            } else if let Ok(slab) = Slab::new() {
+                slab
             } else {
+                log::error!("Failed to allocate a new slab");
                 break;
+            };
+
+            let meta = slab.meta_mut();
+            while nr_allocated < nr && meta.nr_allocated() < meta.capacity() {
+                f(meta.alloc().unwrap());
+                nr_allocated += 1;
             }
+
+            self.add_slab(slab);
         }
 
-        Ok(allocated)
+        nr_allocated
     }
 
     /// Deallocates a slot into the cache.
@@ -225,6 +225,15 @@ pub struct ProfileArgs {
         conflicts_with = "interval"
     )]
     pub parse: Option<PathBuf>,
+    #[arg(
+        long,
+        help = "Parse the samples exported by the in-kernel profiler from a console log",
+        value_name = "PATH",
+        conflicts_with = "samples",
+        conflicts_with = "interval",
+        conflicts_with = "parse"
+    )]
+    pub kernel_samples: Option<PathBuf>,
     #[command(flatten)]
     pub out_args: DebugProfileOutArgs,
     #[command(flatten)]
@@ -393,6 +402,12 @@ pub struct CommonArgs {
         global = true
     )]
     pub strip_elf: bool,
+    #[arg(
+        long = "frame-pointers",
+        help = "Keep the frame pointers in the kernel for the in-kernel sampling profiler",
+        global = true
+    )]
+    pub frame_pointers: bool,
     #[arg(
         long = "target-arch",
         value_name = "ARCH",
@@ -140,6 +140,7 @@ pub fn do_cached_build(
         &build.profile,
         &build.features[..],
         build.no_default_features,
+        build.frame_pointers,
         &build.override_configs[..],
         &cargo_target_directory,
         rustflags,
@@ -192,6 +193,7 @@ fn build_kernel_elf(
     profile: &str,
     features: &[String],
     no_default_features: bool,
+    frame_pointers: bool,
     override_configs: &[String],
     cargo_target_directory: impl AsRef<Path>,
     rustflags: &[&str],
@@ -219,6 +221,12 @@ fn build_kernel_elf(
         "-C no-redzone=y",
     ]);
 
+    if frame_pointers {
+        // The in-kernel sampling profiler walks the kernel stacks with the frame pointers in
+        // the interrupt context, where unwinding with the unwind tables is too slow.
+        rustflags.push("-C force-frame-pointers=yes");
+    }
+
     if matches!(arch, Arch::X86_64) {
         // This is a workaround for <https://github.com/asterinas/asterinas/issues/839>.
         // It makes running on Intel CPUs after Ivy Bridge (2012) faster, but much slower
@@ -7,6 +7,11 @@
 //! and collects the stack trace periodically. The collected data can be
 //! further analyzed using tools like
 //! [flame graph](https://github.com/brendangregg/FlameGraph).
+//!
+//! Alternatively, the kernel can sample itself with the PMU if it is booted
+//! with `profile.freq=<Hz>`, which is much cheaper than halting it with GDB.
+//! The samples are exported to the console, and the profile command parses
+//! them from a console log, e.g., `qemu.log`, with `--kernel-samples`.
 
 use inferno::flamegraph;
 
@@ -28,6 +33,8 @@ use std::{
 pub fn execute_profile_command(_profile: &str, args: &ProfileArgs) {
     if let Some(parse_input) = &args.parse {
         do_parse_stack_traces(parse_input, args);
+    } else if let Some(console_log) = &args.kernel_samples {
+        do_parse_kernel_samples(console_log, args);
     } else {
         do_collect_stack_traces(args);
     }
@@ -49,6 +56,132 @@ fn do_parse_stack_traces(target_file: &PathBuf, args: &ProfileArgs) {
     profile.serialize_to(out_format, out_args.cpu_mask, out_file);
 }
 
+/// The marker of the sample lines exported by the in-kernel profiler.
+const KERNEL_SAMPLE_MARKER: &str = "-<!OSDK_PROF_SAMPLE!>-";
+
+fn do_parse_kernel_samples(console_log: &PathBuf, args: &ProfileArgs) {
+    let file_path = kernel_file_path();
+    let in_file = File::open(console_log).expect("Failed to open the console log");
+
+    let samples = std::io::BufReader::new(in_file)
+        .lines()
+        .map_while(Result::ok)
+        .filter_map(|line| parse_kernel_sample_line(&line))
+        .collect::<Vec<_>>();
+
+    let symbols = symbolize(&file_path, samples.iter().flat_map(|(_, _, addrs)| addrs));
+
+    let mut profile = Profile::default();
+    for (cpu, count, addrs) in samples {
+        let stack = if addrs.is_empty() {
+            vec!["[user]".to_string()]
+        } else {
+            addrs
+                .iter()
+                .enumerate()
+                .map(|(i, addr)| symbols[&call_site(i, *addr)].clone())
+                .collect()
+        };
+        profile.stack_traces.push(HashMap::from([(cpu, stack)]));
+        profile.weights.push(count);
+    }
+
+    let out_args = &args.out_args;
+    let out_path = out_args.output_path(Some(console_log));
+    println!(
+        "{} profile samples parsed. Writing the output to \"{}\".",
+        profile.nr_samples(),
+        out_path.display()
+    );
+
+    let out_file = File::create(out_path).expect("Failed to create output file");
+    profile.serialize_to(out_args.format(), out_args.cpu_mask, out_file);
+}
+
+/// Parses a line of the samples exported by the in-kernel profiler into the
+/// CPU ID, the number of samples and the kernel stack.
+///
+/// The line is `<marker> <cpu> <count> <frames>`, where the frames are either
+/// `user` or the comma separated hexadecimal addresses from the innermost frame.
+/// The kernel stack is empty for the samples taken in the user mode.
+fn parse_kernel_sample_line(line: &str) -> Option<(u32, u32, Vec<u64>)> {
+    let pos = line.find(KERNEL_SAMPLE_MARKER)?;
+    let mut fields = line[pos + KERNEL_SAMPLE_MARKER.len()..].split_whitespace();
+    let cpu = fields.next()?.parse().ok()?;
+    let count = fields.next()?.parse().ok()?;
+    let frames = fields.next()?;
+
+    let addrs = if frames == "user" {
+        Vec::new()
+    } else {
+        frames
+            .split(',')
+            .map(|addr| u64::from_str_radix(addr, 16))
+            .collect::<Result<Vec<_>, _>>()
+            .ok()?
+    };
+    Some((cpu, count, addrs))
+}
+
+/// Returns the address of the call site of a frame.
+///
+/// The frames except the innermost one are return addresses, which may belong
+/// to the next function if the call is the last instruction of a function.
+fn call_site(frame_index: usize, addr: u64) -> u64 {
+    if frame_index == 0 {
+        addr
+    } else {
+        addr - 1
+    }
+}
+
+/// Resolves the function names of the addresses in the kernel with `addr2line`.
+fn symbolize<'a>(
+    file_path: &PathBuf,
+    addrs: impl Iterator<Item = &'a Vec<u64>>,
+) -> HashMap<u64, String> {
+    let mut unique_addrs = addrs
+        .flat_map(|addrs| {
+            addrs
+                .iter()
+                .enumerate()
+                .map(|(i, addr)| call_site(i, *addr))
+        })
+        .collect::<Vec<_>>();
+    unique_addrs.sort_unstable();
+    unique_addrs.dedup();
+
+    let buffer = ProfileBuffer::new();
+    let mut symbols = HashMap::new();
+    // Pass the addresses in chunks to keep the command lines short.
+    for chunk in unique_addrs.chunks(4096) {
+        let output = Command::new("addr2line")
+            .arg("-f")
+            .arg("-C")
+            .arg("-e")
+            .arg(file_path)
+            .args(chunk.iter().map(|addr| format!("{:#x}", addr)))
+            .output()
+            .expect("Failed to execute addr2line");
+
+        // `addr2line -f` prints the function name and the source location of each address.
+        let stdout = String::from_utf8_lossy(&output.stdout);
+        let mut func_names = stdout.lines().step_by(2);
+        for addr in chunk {
+            let func_name = func_names.next().unwrap_or("??");
+            symbols.insert(*addr, buffer.clean_func_name(func_name));
+        }
+    }
+    symbols
+}
+
+fn kernel_file_path() -> PathBuf {
+    get_target_directory()
+        .join("osdk")
+        .join(get_kernel_crate().name)
+        .join(bin_file_name())
+}
+
 macro_rules! profile_round_delimiter {
     () => {
         "-<!OSDK_PROF_BT_ROUND!>-"
@@ -56,10 +189,7 @@ macro_rules! profile_round_delimiter {
 }
 
 fn do_collect_stack_traces(args: &ProfileArgs) {
-    let file_path = get_target_directory()
-        .join("osdk")
-        .join(get_kernel_crate().name)
-        .join(bin_file_name());
+    let file_path = kernel_file_path();
 
     let remote = &args.remote;
     let samples = &args.samples;
@@ -142,6 +272,10 @@ fn do_collect_stack_traces(args: &ProfileArgs) {
 struct Profile {
     // Index 0: capture; Index 1: CPU ID; Index 2: stack frame
     stack_traces: Vec<HashMap<u32, Vec<String>>>,
+    // The number of times that each capture is sampled. The captures without
+    // weights, e.g., those collected with GDB, are sampled once.
+    #[serde(default, skip_serializing_if = "Vec::is_empty")]
+    weights: Vec<u32>,
 }
 
 impl Profile {
@@ -192,29 +326,40 @@ impl Profile {
 
         Self {
             stack_traces: filtered_traces,
+            weights: self.weights.clone(),
         }
     }
 
     fn fold(&self, cpu_mask: u128) -> HashMap<String, u32> {
         let mut folded = HashMap::new();
 
-        for capture in &self.stack_traces {
+        for (i, capture) in self.stack_traces.iter().enumerate() {
             for (cpu_id, stack) in capture {
                 if *cpu_id >= 128 || cpu_mask & (1u128 << *cpu_id) == 0 {
                     continue;
                 }
 
                 let folded_key = stack.iter().rev().cloned().collect::<Vec<_>>().join(";");
-                *folded.entry(folded_key).or_insert(0) += 1;
+                *folded.entry(folded_key).or_insert(0) += self.weight(i);
             }
         }
 
         folded
     }
 
+    fn weight(&self, capture_index: usize) -> u32 {
+        self.weights.get(capture_index).copied().unwrap_or(1)
+    }
+
     fn nr_stack_traces(&self) -> usize {
         self.stack_traces.len()
     }
+
+    fn nr_samples(&self) -> u64 {
+        (0..self.stack_traces.len())
+            .map(|i| self.weight(i) as u64)
+            .sum()
+    }
 }
 
 #[derive(Debug)]
@@ -270,18 +415,7 @@ impl ProfileBuffer {
         }
 
         // Clean the input line
-        let mut processed = line.trim().to_string();
-
-        // Remove everything between angle brackets '<...>'
-        processed = Self::remove_generics(&processed);
-
-        // Remove "::impl{}" and hex addresses
-        processed = self.impl_pattern.replace_all(&processed, "").to_string();
-        processed = self.hex_in_pattern.replace_all(&processed, "").to_string();
-
-        // Remove unnecessary parts like "()" and "(...)"
-        processed = processed.replace("(...)", "");
-        processed = processed.replace("()", "");
+        let processed = self.clean_func_name(line.trim());
 
         // Split the line by spaces and expect the second part to be the function name
         let parts: Vec<&str> = processed.split_whitespace().collect();
@@ -295,6 +429,21 @@ impl ProfileBuffer {
         }
     }
 
+    /// Removes the generics, the `impl` blocks, the hex addresses, and the
+    /// arguments from a function name or a stack frame line.
+    fn clean_func_name(&self, line: &str) -> String {
+        // Remove everything between angle brackets '<...>'
+        let mut processed = Self::remove_generics(line);
+
+        // Remove "::impl{}" and hex addresses
+        processed = self.impl_pattern.replace_all(&processed, "").to_string();
+        processed = self.hex_in_pattern.replace_all(&processed, "").to_string();
+
+        // Remove unnecessary parts like "()" and "(...)"
+        processed = processed.replace("(...)", "");
+        processed.replace("()", "")
+    }
+
     fn remove_generics(line: &str) -> String {
         let mut result = String::new();
         let mut bracket_depth = 0;
@@ -428,3 +577,37 @@ Thread 1 (Thread 1.1 (CPU#0 [running])):
     );
     assert_eq!(stack11[14], "??");
 }
+
+#[cfg(test)]
+#[test]
+fn test_profile_parse_kernel_samples() {
+    let test_case = r#"
+[kernel] Profiling at 10000 Hz
+-<!OSDK_PROF_SAMPLE!>- 0 42 ffffffff880b0f6f,ffffffff8826b205
+[  1.234] some other output-<!OSDK_PROF_SAMPLE!>- 1 7 user
+-<!OSDK_PROF_SAMPLE!>- 1 truncated
+"#;
+
+    let samples = test_case
+        .lines()
+        .filter_map(parse_kernel_sample_line)
+        .collect::<Vec<_>>();
+    assert_eq!(samples.len(), 2);
+    assert_eq!(
+        samples[0],
+        (0, 42, vec![0xffffffff880b0f6f, 0xffffffff8826b205])
+    );
+    assert_eq!(samples[1], (1, 7, vec![]));
+
+    let mut profile = Profile::default();
+    for (cpu, count, addrs) in samples {
+        let stack = addrs.iter().map(|addr| format!("{:x}", addr)).collect();
+        profile.stack_traces.push(HashMap::from([(cpu, stack)]));
+        profile.weights.push(count);
+    }
+    assert_eq!(profile.nr_samples(), 49);
+
+    let folded = profile.fold(u128::MAX);
+    assert_eq!(folded["ffffffff8826b205;ffffffff880b0f6f"], 42);
+    assert_eq!(folded[""], 7);
+}
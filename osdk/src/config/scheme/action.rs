@@ -25,6 +25,10 @@ pub struct BuildScheme {
     pub linux_x86_legacy_boot: bool,
     #[serde(default)]
     pub strip_elf: bool,
+    /// Whether to keep the frame pointers, which the in-kernel sampling
+    /// profiler walks the kernel stacks with
+    #[serde(default)]
+    pub frame_pointers: bool,
     pub encoding: Option<PayloadEncoding>,
 }
 
@@ -41,6 +45,8 @@ pub struct Build {
     pub linux_x86_legacy_boot: bool,
     #[serde(default)]
     pub strip_elf: bool,
+    #[serde(default)]
+    pub frame_pointers: bool,
     pub encoding: PayloadEncoding,
 }
 
@@ -53,6 +59,7 @@ impl Default for Build {
             override_configs: Vec::new(),
             linux_x86_legacy_boot: false,
             strip_elf: false,
+            frame_pointers: false,
             encoding: PayloadEncoding::default(),
         }
     }
@@ -76,6 +83,9 @@ impl Build {
         if common_args.strip_elf {
             self.strip_elf = true;
         }
+        if common_args.frame_pointers {
+            self.frame_pointers = true;
+        }
         if let Some(encoding) = common_args.encoding.clone() {
             self.encoding.clone_from(&encoding);
         }
@@ -99,6 +109,9 @@ impl BuildScheme {
         if parent.strip_elf {
             self.strip_elf = true;
         }
+        if parent.frame_pointers {
+            self.frame_pointers = true;
+        }
         if self.encoding.is_none() {
             self.encoding.clone_from(&parent.encoding);
         }
@@ -112,6 +125,7 @@ impl BuildScheme {
             override_configs: Vec::new(),
             linux_x86_legacy_boot: self.linux_x86_legacy_boot,
             strip_elf: self.strip_elf,
+            frame_pointers: self.frame_pointers,
             encoding: self.encoding.unwrap_or_default(),
         }
     }
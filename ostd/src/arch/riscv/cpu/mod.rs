@@ -18,3 +18,9 @@ pub fn sleep_for_interrupt() {
     crate::task::atomic_mode::might_sleep();
     riscv::asm::wfi();
 }
+
+/// Returns the hardware ID of the current CPU.
+pub(crate) fn current_hw_id() -> u32 {
+    // FIXME: Return the hart ID once it is recorded at boot.
+    0
+}
@@ -2,6 +2,8 @@
 
 //! The IOMMU support.
 
+use core::ops::Range;
+
 use crate::mm::{dma::Daddr, Paddr};
 
 /// An enumeration representing possible errors related to IOMMU.
@@ -15,14 +17,16 @@ pub enum IommuError {
 /// # Safety
 ///
 /// Mapping an incorrect address may lead to a kernel data leak.
-pub(crate) unsafe fn map(_daddr: Daddr, _paddr: Paddr) -> Result<(), IommuError> {
+pub(crate) unsafe fn map(_daddr_range: Range<Daddr>, _paddr: Paddr) -> Result<(), IommuError> {
     Err(IommuError::NoIommu)
 }
 
-pub(crate) fn unmap(_daddr: Daddr) -> Result<(), IommuError> {
+pub(crate) fn unmap(_daddr_range: Range<Daddr>) -> Result<(), IommuError> {
     Err(IommuError::NoIommu)
 }
 
+pub(crate) fn flush_iotlb() {}
+
 pub(crate) fn init() -> Result<(), IommuError> {
     // TODO: We will support IOMMU on RISC-V
     Err(IommuError::NoIommu)
@@ -39,6 +39,15 @@ pub(crate) fn disable_local() {
     riscv::interrupt::disable();
 }
 
+/// Enables local IRQs and halts the CPU until the next interrupt.
+///
+/// The `wfi` instruction resumes on a pending interrupt even if IRQs are
+/// disabled, so no interrupt is missed before IRQs are enabled.
+pub(crate) fn enable_local_and_halt() {
+    riscv::asm::wfi();
+    enable_local();
+}
+
 pub(crate) fn is_local_enabled() -> bool {
     riscv::register::sstatus::read().sie()
 }
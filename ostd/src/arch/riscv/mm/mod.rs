@@ -1,7 +1,10 @@
 // SPDX-License-Identifier: MPL-2.0
 
 use alloc::fmt;
-use core::ops::Range;
+use core::{
+    ops::Range,
+    sync::atomic::{AtomicU32, Ordering},
+};
 
 use crate::{
     mm::{
@@ -243,3 +246,15 @@ pub(crate) fn __memset_fallible(dst: *mut u8, value: u8, size: usize) -> usize {
     unsafe { core::ptr::write_bytes(dst, value, size) };
     0
 }
+
+pub(crate) unsafe fn __atomic_cmpxchg_fallible(ptr: *mut u32, old_val: u32, new_val: u32) -> u64 {
+    // TODO: implement fallible
+    unsafe {
+        riscv::register::sstatus::set_sum();
+    }
+    let atomic = unsafe { AtomicU32::from_ptr(ptr) };
+    let prev = atomic
+        .compare_exchange(old_val, new_val, Ordering::SeqCst, Ordering::SeqCst)
+        .unwrap_or_else(|prev| prev);
+    u64::from(prev)
+}
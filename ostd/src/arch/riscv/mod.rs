@@ -38,6 +38,11 @@ pub(crate) unsafe fn init_on_ap() {
     unimplemented!()
 }
 
+pub(crate) fn parse_numa_info() -> Option<crate::mm::numa::NumaInfo> {
+    // FIXME: Discover the NUMA topology from the device tree.
+    None
+}
+
 pub(crate) fn interrupts_ack(irq_number: usize) {
     unimplemented!()
 }
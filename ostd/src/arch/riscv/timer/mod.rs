@@ -47,3 +47,17 @@ pub(super) fn init() {
         GOLDFISH_IO_MEM.call_once(|| io_mem);
     }
 }
+
+/// Returns whether the tick of the current CPU can be stopped.
+///
+/// The timer interrupts are not supported on RISC-V yet, so there is no tick
+/// to stop.
+pub(crate) fn can_stop_tick() -> bool {
+    false
+}
+
+/// Stops the tick of the current CPU.
+pub(crate) fn stop_tick(_ticks: u64) {}
+
+/// Restarts the tick of the current CPU that has been stopped.
+pub(crate) fn restart_tick() {}
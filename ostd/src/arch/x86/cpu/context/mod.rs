@@ -4,7 +4,7 @@
 
 use alloc::boxed::Box;
 use core::{
-    arch::x86_64::{_fxrstor64, _fxsave64, _xrstor64, _xsave64},
+    arch::x86_64::{_fxrstor64, _fxsave64, _xrstor64, _xsave64, _xsaveopt64},
     fmt::Debug,
     sync::atomic::{AtomicBool, Ordering::Relaxed},
 };
@@ -507,7 +507,15 @@ impl FpuState {
         let mem_addr = &*self.state_area as *const _ as *mut u8;
 
         if CPU_FEATURES.get().unwrap().has_xsave() {
-            unsafe { _xsave64(mem_addr, XFEATURE_MASK_USER_RESTORE) };
+            // `XSAVEOPT` skips the states that are unmodified since they were
+            // restored from this area, which is the common case on context
+            // switches. This area is never modified by software between
+            // `restore` and `save`, which `XSAVEOPT` requires.
+            if *HAS_XSAVEOPT.get().unwrap() {
+                unsafe { _xsaveopt64(mem_addr, XFEATURE_MASK_USER_RESTORE) };
+            } else {
+                unsafe { _xsave64(mem_addr, XFEATURE_MASK_USER_RESTORE) };
+            }
         } else {
             unsafe { _fxsave64(mem_addr) };
         }
@@ -584,6 +592,9 @@ const XFEATURE_MASK_USER_RESTORE: u64 = 0b1110_0111;
 /// The real size in bytes of the XSAVE area containing all states enabled by XCRO | IA32_XSS.
 static XSAVE_AREA_SIZE: Once<usize> = Once::new();
 
+/// Whether the processor supports the `XSAVEOPT` instruction.
+static HAS_XSAVEOPT: Once<bool> = Once::new();
+
 /// The max size in bytes of the XSAVE area.
 const MAX_XSAVE_AREA_SIZE: usize = 4096;
 
@@ -609,6 +620,13 @@ pub(in crate::arch) fn enable_essential_features() {
         size
     });
 
+    HAS_XSAVEOPT.call_once(|| {
+        const XSTATE_CPUID: u32 = 0x0000000d;
+        const XSAVEOPT_BIT: u32 = 1 << 0;
+
+        cpuid::cpuid!(XSTATE_CPUID, 1).eax & XSAVEOPT_BIT != 0
+    });
+
     if CPU_FEATURES.get().unwrap().has_fpu() {
         let mut cr0 = Cr0::read();
         cr0.remove(Cr0Flags::TASK_SWITCHED | Cr0Flags::EMULATE_COPROCESSOR);
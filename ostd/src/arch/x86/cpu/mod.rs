@@ -17,3 +17,21 @@ pub fn sleep_for_interrupt() {
     crate::task::atomic_mode::might_sleep();
     x86_64::instructions::hlt();
 }
+
+/// Returns the hardware ID of the current CPU, which is its initial local APIC ID.
+///
+/// It is the ID that identifies the CPU in the ACPI tables.
+pub(crate) fn current_hw_id() -> u32 {
+    use core::arch::x86_64::{__cpuid, __cpuid_count};
+
+    // SAFETY: The CPUID instruction is always available on x86-64.
+    let max_leaf = unsafe { __cpuid(0) }.eax;
+    if max_leaf >= 0xb {
+        // The x2APIC ID in the extended topology leaf is 32 bits wide.
+        // SAFETY: The leaf is supported as checked above.
+        unsafe { __cpuid_count(0xb, 0) }.edx
+    } else {
+        // SAFETY: The leaf 1 is always supported.
+        unsafe { __cpuid(1) }.ebx >> 24
+    }
+}
@@ -3,7 +3,7 @@
 #![expect(dead_code)]
 
 use alloc::collections::BTreeMap;
-use core::mem::size_of;
+use core::{mem::size_of, ops::Range};
 
 use log::trace;
 use ostd_pod::Pod;
@@ -15,7 +15,7 @@ use crate::{
         dma::Daddr,
         page_prop::{CachePolicy, PageProperty, PrivilegedPageFlags as PrivFlags},
         page_table::{PageTableError, PageTableItem},
-        Frame, FrameAllocOptions, Paddr, PageFlags, PageTable, VmIo, PAGE_SIZE,
+        Frame, FrameAllocOptions, Paddr, PageFlags, PageTable, VmIo,
     },
 };
 
@@ -62,7 +62,8 @@ impl RootTable {
         }
     }
 
-    /// Mapping device address to physical address.
+    /// Mapping the device address range to the physical addresses starting
+    /// from `paddr`.
     ///
     /// # Safety
     ///
@@ -70,7 +71,7 @@ impl RootTable {
     pub(super) unsafe fn map(
         &mut self,
         device: PciDeviceLocation,
-        daddr: Daddr,
+        daddr_range: Range<Daddr>,
         paddr: Paddr,
     ) -> Result<(), ContextTableError> {
         if device.device >= 32 || device.function >= 8 {
@@ -78,7 +79,7 @@ impl RootTable {
         }
 
         self.get_or_create_context_table(device)
-            .map(device, daddr, paddr)?;
+            .map(device, daddr_range, paddr)?;
 
         Ok(())
     }
@@ -86,14 +87,14 @@ impl RootTable {
     pub(super) fn unmap(
         &mut self,
         device: PciDeviceLocation,
-        daddr: Daddr,
+        daddr_range: Range<Daddr>,
     ) -> Result<(), ContextTableError> {
         if device.device >= 32 || device.function >= 8 {
             return Err(ContextTableError::InvalidDeviceId);
         }
 
         self.get_or_create_context_table(device)
-            .unmap(device, daddr)?;
+            .unmap(device, daddr_range)?;
 
         Ok(())
     }
@@ -291,7 +292,7 @@ impl ContextTable {
     unsafe fn map(
         &mut self,
         device: PciDeviceLocation,
-        daddr: Daddr,
+        daddr_range: Range<Daddr>,
         paddr: Paddr,
     ) -> Result<(), ContextTableError> {
         if device.device >= 32 || device.function >= 8 {
@@ -299,14 +300,15 @@ impl ContextTable {
         }
         trace!(
             "Mapping Daddr: {:x?} to Paddr: {:x?} for device: {:x?}",
-            daddr,
+            daddr_range,
             paddr,
             device
         );
+        let len = daddr_range.len();
         self.get_or_create_page_table(device)
             .map(
-                &(daddr..daddr + PAGE_SIZE),
-                &(paddr..paddr + PAGE_SIZE),
+                &daddr_range,
+                &(paddr..paddr + len),
                 PageProperty {
                     flags: PageFlags::RW,
                     cache: CachePolicy::Uncacheable,
@@ -317,15 +319,24 @@ impl ContextTable {
         Ok(())
     }
 
-    fn unmap(&mut self, device: PciDeviceLocation, daddr: Daddr) -> Result<(), ContextTableError> {
+    fn unmap(
+        &mut self,
+        device: PciDeviceLocation,
+        daddr_range: Range<Daddr>,
+    ) -> Result<(), ContextTableError> {
         if device.device >= 32 || device.function >= 8 {
             return Err(ContextTableError::InvalidDeviceId);
         }
-        trace!("Unmapping Daddr: {:x?} for device: {:x?}", daddr, device);
+        trace!(
+            "Unmapping Daddr: {:x?} for device: {:x?}",
+            daddr_range,
+            device
+        );
         let pt = self.get_or_create_page_table(device);
-        let mut cursor = pt.cursor_mut(&(daddr..daddr + PAGE_SIZE)).unwrap();
-        unsafe {
-            let result = cursor.take_next(PAGE_SIZE);
+        let mut cursor = pt.cursor_mut(&daddr_range).unwrap();
+        // The device page table only has base pages, so each item is one page.
+        while cursor.virt_addr() < daddr_range.end {
+            let result = unsafe { cursor.take_next(daddr_range.end - cursor.virt_addr()) };
             debug_assert!(matches!(result, PageTableItem::MappedUntracked { .. }));
         }
         Ok(())
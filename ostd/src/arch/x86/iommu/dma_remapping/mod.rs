@@ -1,5 +1,7 @@
 // SPDX-License-Identifier: MPL-2.0
 
+use core::ops::Range;
+
 pub use context_table::RootTable;
 use log::info;
 use second_stage::{DeviceMode, PageTableEntry, PagingConsts};
@@ -7,7 +9,7 @@ use spin::Once;
 
 use super::IommuError;
 use crate::{
-    arch::iommu::registers::IOMMU_REGS,
+    arch::iommu::registers::{CapabilityFlags, IOMMU_REGS},
     bus::pci::PciDeviceLocation,
     mm::{Daddr, PageTable},
     prelude::Paddr,
@@ -21,35 +23,47 @@ pub fn has_dma_remapping() -> bool {
     PAGE_TABLE.get().is_some()
 }
 
-/// Mapping device address to physical address.
+/// Mapping the device address range to the physical addresses starting from `paddr`.
+///
+/// If the IOMMU caches the non-present entries, the IOTLB is invalidated
+/// before returning. Otherwise, the new mappings take effect immediately.
 ///
 /// # Safety
 ///
 /// Mapping an incorrect address may lead to a kernel data leak.
-pub unsafe fn map(daddr: Daddr, paddr: Paddr) -> Result<(), IommuError> {
+pub unsafe fn map(daddr_range: Range<Daddr>, paddr: Paddr) -> Result<(), IommuError> {
     let Some(table) = PAGE_TABLE.get() else {
         return Err(IommuError::NoIommu);
     };
     // The page table of all devices is the same. So we can use any device ID.
     table
         .lock()
-        .map(PciDeviceLocation::zero(), daddr, paddr)
+        .map(PciDeviceLocation::zero(), daddr_range, paddr)
         .map_err(|err| match err {
             context_table::ContextTableError::InvalidDeviceId => unreachable!(),
             context_table::ContextTableError::ModificationError(err) => {
                 IommuError::ModificationError(err)
             }
-        })
+        })?;
+
+    if IS_CACHING_MODE.get() == Some(&true) {
+        flush_iotlb();
+    }
+    Ok(())
 }
 
-pub fn unmap(daddr: Daddr) -> Result<(), IommuError> {
+/// Unmapping the device address range.
+///
+/// The IOTLB is not invalidated, so the device may still access the pages
+/// until [`flush_iotlb`] is called.
+pub fn unmap(daddr_range: Range<Daddr>) -> Result<(), IommuError> {
     let Some(table) = PAGE_TABLE.get() else {
         return Err(IommuError::NoIommu);
     };
     // The page table of all devices is the same. So we can use any device ID.
     table
         .lock()
-        .unmap(PciDeviceLocation::zero(), daddr)
+        .unmap(PciDeviceLocation::zero(), daddr_range)
         .map_err(|err| match err {
             context_table::ContextTableError::InvalidDeviceId => unreachable!(),
             context_table::ContextTableError::ModificationError(err) => {
@@ -58,6 +72,15 @@ pub fn unmap(daddr: Daddr) -> Result<(), IommuError> {
         })
 }
 
+/// Invalidates all the IOTLB entries, so that the unmapped pages can no
+/// longer be accessed by the devices.
+pub fn flush_iotlb() {
+    if PAGE_TABLE.get().is_none() {
+        return;
+    }
+    IOMMU_REGS.get().unwrap().lock().invalidate_iotlb();
+}
+
 pub fn init() {
     // Create Root Table instance
     let mut root_table = RootTable::new();
@@ -70,6 +93,12 @@ pub fn init() {
 
     // Enable DMA remapping
     let mut iommu_regs = IOMMU_REGS.get().unwrap().lock();
+    IS_CACHING_MODE.call_once(|| {
+        iommu_regs
+            .read_capability()
+            .flags()
+            .contains(CapabilityFlags::CM)
+    });
     iommu_regs.enable_dma_remapping(PAGE_TABLE.get().unwrap());
     info!("[IOMMU] DMA remapping enabled");
 }
@@ -78,3 +107,7 @@ pub fn init() {
 // contexts (e.g., within the virtio-blk module), potentially leading to deadlocks.
 // Once this issue is resolved, `LocalIrqDisabled` is no longer needed.
 static PAGE_TABLE: Once<SpinLock<RootTable, LocalIrqDisabled>> = Once::new();
+
+/// Whether the IOMMU may cache the non-present entries, which requires
+/// invalidations after mapping pages.
+static IS_CACHING_MODE: Once<bool> = Once::new();
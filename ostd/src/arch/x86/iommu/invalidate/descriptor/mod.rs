@@ -10,6 +10,26 @@ impl InterruptEntryCache {
     }
 }
 
+pub struct IotlbInvalidation(pub u128);
+
+impl IotlbInvalidation {
+    const INVALIDATION_TYPE: u128 = 2;
+    const GLOBAL_GRANULARITY: u128 = 1 << 4;
+    const DRAIN_WRITES: u128 = 1 << 6;
+    const DRAIN_READS: u128 = 1 << 7;
+
+    pub fn global_invalidation(drain_reads: bool, drain_writes: bool) -> Self {
+        let mut value = Self::INVALIDATION_TYPE | Self::GLOBAL_GRANULARITY;
+        if drain_reads {
+            value |= Self::DRAIN_READS;
+        }
+        if drain_writes {
+            value |= Self::DRAIN_WRITES;
+        }
+        Self(value)
+    }
+}
+
 pub struct InvalidationWait(pub u128);
 
 impl InvalidationWait {
@@ -15,13 +15,11 @@ pub struct Queue {
 
 impl Queue {
     pub fn append_descriptor(&mut self, descriptor: u128) {
-        if self.tail == self.queue_size {
-            self.tail = 0;
-        }
         self.segment
             .write_val(self.tail * size_of::<u128>(), &descriptor)
             .unwrap();
-        self.tail += 1;
+        // The tail register must wrap around to zero after the last entry.
+        self.tail = (self.tail + 1) % self.queue_size;
     }
 
     pub fn tail(&self) -> usize {
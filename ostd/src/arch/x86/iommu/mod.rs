@@ -8,7 +8,7 @@ mod interrupt_remapping;
 mod invalidate;
 mod registers;
 
-pub(crate) use dma_remapping::{has_dma_remapping, map, unmap};
+pub(crate) use dma_remapping::{flush_iotlb, has_dma_remapping, map, unmap};
 pub(crate) use interrupt_remapping::{alloc_irt_entry, has_interrupt_remapping, IrtEntryHandle};
 
 use crate::{io::IoMemAllocatorBuilder, mm::page_table::PageTableError};
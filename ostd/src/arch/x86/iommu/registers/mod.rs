@@ -11,7 +11,7 @@ mod status;
 use core::ptr::NonNull;
 
 use bit_field::BitField;
-pub use capability::Capability;
+pub use capability::{Capability, CapabilityFlags};
 use command::GlobalCommand;
 use extended_cap::ExtendedCapability;
 pub use extended_cap::ExtendedCapabilityFlags;
@@ -33,7 +33,7 @@ use crate::{
         iommu::{
             fault,
             invalidate::{
-                descriptor::{InterruptEntryCache, InvalidationWait},
+                descriptor::{InterruptEntryCache, InvalidationWait, IotlbInvalidation},
                 QUEUE,
             },
         },
@@ -216,6 +216,43 @@ impl IommuRegisters {
         while !self.read_global_status().contains(GlobalStatus::QIES) {}
     }
 
+    /// Invalidates all the IOTLB entries, and waits for the invalidation to
+    /// complete.
+    ///
+    /// The entries of the unmapped pages may stay in the IOTLB until then.
+    pub(super) fn invalidate_iotlb(&mut self) {
+        if !self.read_global_status().contains(GlobalStatus::QIES) {
+            // Set IVT(63) to 1 to requests IOTLB invalidation and IIRG(61:60) to 01 to indicate global invalidation request.
+            self.invalidate
+                .iotlb_invalidate
+                .as_mut_ptr()
+                .write(0x9000_0000_0000_0000);
+            // Wait for invalidation complete (IVT set to 0).
+            while self.invalidate.iotlb_invalidate.as_ptr().read() & 0x8000_0000_0000_0000 != 0 {}
+            return;
+        }
+
+        let capability_flags = self.read_capability().flags();
+        let mut queue = QUEUE.get().unwrap().lock();
+        queue.append_descriptor(
+            IotlbInvalidation::global_invalidation(
+                capability_flags.contains(CapabilityFlags::DRD),
+                capability_flags.contains(CapabilityFlags::DWD),
+            )
+            .0,
+        );
+
+        // Clear the completion status, which is set again when the hardware
+        // reaches the invalidation wait descriptor after the IOTLB invalidation.
+        self.invalidate.completion_status.as_mut_ptr().write(1);
+        queue.append_descriptor(InvalidationWait::with_interrupt_flag().0);
+        self.invalidate
+            .queue_tail
+            .as_mut_ptr()
+            .write((queue.tail() << 4) as u64);
+        while self.invalidate.completion_status.as_ptr().read() & 1 == 0 {}
+    }
+
     fn global_invalidation(&mut self) {
         // Set ICC(63) to 1 to requests invalidation and CIRG(62:61) to 01 to indicate global invalidation request.
         self.context_command
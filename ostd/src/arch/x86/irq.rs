@@ -58,6 +58,14 @@ pub(crate) fn disable_local() {
     x86_64::instructions::interrupts::disable();
 }
 
+/// Enables local IRQs and halts the CPU until the next interrupt.
+///
+/// The two steps are done atomically, so an interrupt that becomes pending
+/// while IRQs are disabled wakes the CPU up immediately.
+pub(crate) fn enable_local_and_halt() {
+    x86_64::instructions::interrupts::enable_and_hlt();
+}
+
 pub(crate) fn is_local_enabled() -> bool {
     (rflags::read_raw() & RFlags::INTERRUPT_FLAG.bits()) != 0
 }
@@ -2,6 +2,7 @@
 
 pub mod dmar;
 pub mod remapping;
+pub mod srat;
 
 use core::ptr::NonNull;
 
@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! The System Resource Affinity Table (SRAT) and the System Locality
+//! Information Table (SLIT).
+//!
+//! The SRAT assigns the CPUs and the memory ranges to proximity domains, i.e.,
+//! NUMA nodes. The SLIT gives the relative distances between the domains.
+//!
+//! Reference: <https://uefi.org/specs/ACPI/6.5/05_ACPI_Software_Programming_Model.html#system-resource-affinity-table-srat>
+
+use acpi::{
+    sdt::{SdtHeader, Signature},
+    AcpiTable, PhysicalMapping,
+};
+
+use super::{get_acpi_tables, AcpiMemoryHandler};
+use crate::mm::numa::NumaInfo;
+
+#[derive(Debug, Clone, Copy)]
+#[repr(C, packed)]
+struct SratHeader {
+    header: SdtHeader,
+    reserved1: u32,
+    reserved2: u64,
+}
+
+// SAFETY: The `SratHeader` is the header of the SRAT. All its fields are described in the ACPI
+// specification.
+unsafe impl AcpiTable for SratHeader {
+    const SIGNATURE: Signature = Signature::SRAT;
+    fn header(&self) -> &SdtHeader {
+        &self.header
+    }
+}
+
+#[derive(Debug, Clone, Copy)]
+#[repr(C, packed)]
+struct SlitHeader {
+    header: SdtHeader,
+    nr_localities: u64,
+}
+
+// SAFETY: The `SlitHeader` is the header of the SLIT. All its fields are described in the ACPI
+// specification.
+unsafe impl AcpiTable for SlitHeader {
+    const SIGNATURE: Signature = Signature::SLIT;
+    fn header(&self) -> &SdtHeader {
+        &self.header
+    }
+}
+
+const SRAT_LOCAL_APIC: u8 = 0;
+const SRAT_MEMORY: u8 = 1;
+const SRAT_LOCAL_X2APIC: u8 = 2;
+
+/// The bit of the flags in the affinity structures that tells whether the
+/// structure is enabled.
+const AFFINITY_ENABLED: u32 = 1 << 0;
+
+/// Parses the SRAT and the SLIT into the NUMA topology.
+///
+/// It returns `None` if there is no SRAT. This function does not use the heap
+/// since it is called before the frame allocator is initialized.
+pub(crate) fn parse() -> Option<NumaInfo> {
+    let tables = get_acpi_tables()?;
+    let srat = tables.find_table::<SratHeader>().ok()?;
+    let mut info = NumaInfo::new();
+
+    let bytes = table_bytes(&srat);
+    let mut index = core::mem::size_of::<SratHeader>();
+    while index + 2 <= bytes.len() {
+        // CommonHeader { type: u8, length: u8 }
+        let typ = bytes[index];
+        let length = bytes[index + 1] as usize;
+        if length < 2 || index + length > bytes.len() {
+            log::warn!("SRAT: malformed entry of type {} at offset {}", typ, index);
+            break;
+        }
+        let entry = &bytes[index..index + length];
+        let read_u32 =
+            |offset: usize| u32::from_le_bytes(entry[offset..offset + 4].try_into().unwrap());
+
+        match typ {
+            SRAT_LOCAL_APIC if length >= 16 => {
+                if read_u32(4) & AFFINITY_ENABLED != 0 {
+                    // The proximity domain is split into bits 0..8 and bits 8..32.
+                    let domain = u32::from_le_bytes([entry[2], entry[9], entry[10], entry[11]]);
+                    info.add_cpu(domain, entry[3] as u32);
+                }
+            }
+            SRAT_MEMORY if length >= 40 => {
+                if read_u32(28) & AFFINITY_ENABLED != 0 {
+                    let base = read_u32(8) as usize | ((read_u32(12) as usize) << 32);
+                    let len = read_u32(16) as usize | ((read_u32(20) as usize) << 32);
+                    if len != 0 {
+                        info.add_mem_range(read_u32(2), base..base + len);
+                    }
+                }
+            }
+            SRAT_LOCAL_X2APIC if length >= 24 => {
+                if read_u32(12) & AFFINITY_ENABLED != 0 {
+                    info.add_cpu(read_u32(4), read_u32(8));
+                }
+            }
+            // Other affinities (e.g., of the GIC or generic initiators) are not used.
+            _ => {}
+        }
+
+        index += length;
+    }
+
+    if let Ok(slit) = tables.find_table::<SlitHeader>() {
+        let bytes = table_bytes(&slit);
+        let nr_localities = slit.nr_localities as usize;
+        let matrix = &bytes[core::mem::size_of::<SlitHeader>()..];
+        if nr_localities
+            .checked_mul(nr_localities)
+            .is_some_and(|size| matrix.len() >= size)
+        {
+            for from in 0..nr_localities {
+                for to in 0..nr_localities {
+                    info.set_distance(from as u32, to as u32, matrix[from * nr_localities + to]);
+                }
+            }
+        } else {
+            log::warn!("SLIT: truncated distance matrix");
+        }
+    }
+
+    Some(info)
+}
+
+fn table_bytes<T: AcpiTable>(mapping: &PhysicalMapping<AcpiMemoryHandler, T>) -> &[u8] {
+    let length = (mapping.header().length as usize).min(mapping.mapped_length());
+    // SAFETY: `find_table` returns a region of memory that belongs to the ACPI table. This memory
+    // region is valid to read, properly initialized, lives for `'static`, and will never be
+    // mutated.
+    unsafe {
+        core::slice::from_raw_parts(
+            mapping.virtual_start().as_ptr().cast::<u8>().cast_const(),
+            length,
+        )
+    }
+}
@@ -114,6 +114,13 @@ pub trait Apic: ApicTimer {
 
     /// Send a general inter-processor interrupt.
     unsafe fn send_ipi(&self, icr: Icr);
+
+    /// Sets the performance monitoring counter register in the LVT.
+    /// Bit 0-7:   The interrupt vector of the performance monitoring interrupt.
+    /// Bit 16:    Mask bit.
+    ///
+    /// The mask bit is set by the processor when the interrupt is delivered.
+    fn set_lvt_pmi(&self, value: u64);
 }
 
 pub trait ApicTimer {
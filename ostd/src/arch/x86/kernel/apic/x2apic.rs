@@ -2,7 +2,7 @@
 
 use x86::msr::{
     rdmsr, wrmsr, IA32_APIC_BASE, IA32_X2APIC_APICID, IA32_X2APIC_CUR_COUNT, IA32_X2APIC_DIV_CONF,
-    IA32_X2APIC_EOI, IA32_X2APIC_ESR, IA32_X2APIC_ICR, IA32_X2APIC_INIT_COUNT,
+    IA32_X2APIC_EOI, IA32_X2APIC_ESR, IA32_X2APIC_ICR, IA32_X2APIC_INIT_COUNT, IA32_X2APIC_LVT_PMI,
     IA32_X2APIC_LVT_TIMER, IA32_X2APIC_SIVR, IA32_X2APIC_VERSION,
 };
 
@@ -81,6 +81,12 @@ impl super::Apic for X2Apic {
             }
         }
     }
+
+    fn set_lvt_pmi(&self, value: u64) {
+        unsafe {
+            wrmsr(IA32_X2APIC_LVT_PMI, value);
+        }
+    }
 }
 
 impl ApicTimer for X2Apic {
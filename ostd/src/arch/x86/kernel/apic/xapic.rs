@@ -91,6 +91,10 @@ impl super::Apic for XApic {
             }
         }
     }
+
+    fn set_lvt_pmi(&self, value: u64) {
+        self.write(xapic::XAPIC_LVT_PMI, value as u32);
+    }
 }
 
 impl ApicTimer for XApic {
@@ -6,7 +6,7 @@ use alloc::fmt;
 use core::ops::Range;
 
 use cfg_if::cfg_if;
-pub(crate) use util::{__memcpy_fallible, __memset_fallible};
+pub(crate) use util::{__atomic_cmpxchg_fallible, __memcpy_fallible, __memset_fallible};
 use x86_64::{
     instructions::tlb, registers::control::Cr3Flags, structures::paging::PhysFrame, VirtAddr,
 };
@@ -97,8 +97,24 @@ pub(crate) fn tlb_flush_addr_range(range: &Range<Vaddr>) {
 }
 
 /// Flush all TLB entries except for the global-page entries.
+///
+/// If PCID is enabled, only the entries of the current PCID are flushed.
 pub(crate) fn tlb_flush_all_excluding_global() {
-    tlb::flush_all();
+    if !asid::PCID_ENABLED.load(core::sync::atomic::Ordering::Relaxed) {
+        tlb::flush_all();
+        return;
+    }
+
+    // Reloading CR3 flushes the entries of the current PCID. Note that `tlb::flush_all` cannot be
+    // used since it drops the PCID bits, which switches to another PCID.
+    //
+    // SAFETY: Writing the same value back to CR3 only invalidates the TLB entries, which doesn't
+    // affect the memory safety.
+    unsafe {
+        let cr3: u64;
+        core::arch::asm!("mov {}, cr3", out(reg) cr3, options(nomem, nostack, preserves_flags));
+        core::arch::asm!("mov cr3, {}", in(reg) cr3, options(nostack, preserves_flags));
+    }
 }
 
 /// Flush all TLB entries, including global-page entries.
@@ -146,16 +162,20 @@ pub unsafe fn activate_page_table(root_paddr: Paddr, root_pt_cache: CachePolicy)
 
 /// Activate a page table with the specified ASID.
 ///
-/// This function writes to CR3 and sets ASID (Address Space ID) bits.
+/// This function writes to CR3 and sets ASID (Address Space ID) bits. If `flush` is false, the
+/// TLB entries tagged with the ASID are kept, otherwise they are flushed. The TLB entries are
+/// always flushed if PCID is not enabled.
 ///
 /// # Safety
 ///
 /// Changing the level 4 page table is unsafe, because it's possible to violate memory safety by
-/// changing the page mapping.
+/// changing the page mapping. The caller must also ensure that the TLB entries tagged with the
+/// ASID are up-to-date if `flush` is false.
 pub unsafe fn activate_page_table_with_asid(
     root_paddr: Paddr,
     asid: u16,
     root_pt_cache: CachePolicy,
+    flush: bool,
 ) {
     if !asid::PCID_ENABLED.load(core::sync::atomic::Ordering::Relaxed) {
         // If PCID is not supported, just use regular page table activation
@@ -163,23 +183,26 @@ pub unsafe fn activate_page_table_with_asid(
         return;
     }
 
-    // PCID is 12 bits (0-4095)
-    let asid_bits = (asid & 0xFFF) as u64;
+    /// If this bit is set, writing CR3 does not flush the TLB entries of the new PCID.
+    const CR3_NOFLUSH: u64 = 1 << 63;
 
-    // Write CR3 with the PCID bits
-    x86_64::registers::control::Cr3::write(
-        PhysFrame::from_start_address(x86_64::PhysAddr::new(root_paddr as u64)).unwrap(),
-        match root_pt_cache {
-            CachePolicy::Writeback => x86_64::registers::control::Cr3Flags::empty(),
-            CachePolicy::Writethrough => {
-                x86_64::registers::control::Cr3Flags::PAGE_LEVEL_WRITETHROUGH
-            }
-            CachePolicy::Uncacheable => {
-                x86_64::registers::control::Cr3Flags::PAGE_LEVEL_CACHE_DISABLE
-            }
-            _ => panic!("unsupported cache policy for the root page table"),
-        } | Cr3Flags::from_bits_truncate(asid_bits),
-    );
+    let cache_bits = match root_pt_cache {
+        CachePolicy::Writeback => Cr3Flags::empty(),
+        CachePolicy::Writethrough => Cr3Flags::PAGE_LEVEL_WRITETHROUGH,
+        CachePolicy::Uncacheable => Cr3Flags::PAGE_LEVEL_CACHE_DISABLE,
+        _ => panic!("unsupported cache policy for the root page table"),
+    };
+    // PCID is 12 bits (0-4095). Note that `Cr3Flags` cannot represent the PCID bits, so we write
+    // CR3 directly.
+    let mut cr3 = root_paddr as u64 | cache_bits.bits() | (asid & 0xFFF) as u64;
+    if !flush {
+        cr3 |= CR3_NOFLUSH;
+    }
+
+    // SAFETY: The safety is upheld by the caller.
+    unsafe {
+        core::arch::asm!("mov cr3, {}", in(reg) cr3, options(nostack, preserves_flags));
+    }
 }
 
 pub fn current_page_table_paddr() -> Paddr {
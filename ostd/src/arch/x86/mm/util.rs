@@ -2,6 +2,7 @@
 
 core::arch::global_asm!(include_str!("memcpy_fallible.S"));
 core::arch::global_asm!(include_str!("memset_fallible.S"));
+core::arch::global_asm!(include_str!("atomic_cmpxchg_fallible.S"));
 
 extern "C" {
     /// Copies `size` bytes from `src` to `dst`. This function works with exception handling
@@ -12,4 +13,8 @@ extern "C" {
     /// This function works with exception handling and can recover from page fault.
     /// Returns number of bytes that failed to set.
     pub(crate) fn __memset_fallible(dst: *mut u8, value: u8, size: usize) -> usize;
+    /// Atomically replaces the value at `ptr` with `new_val` if it equals `old_val`.
+    /// This function works with exception handling and can recover from page fault.
+    /// Returns the previous value, or `u64::MAX` if the page fault is unresolvable.
+    pub(crate) fn __atomic_cmpxchg_fallible(ptr: *mut u32, old_val: u32, new_val: u32) -> u64;
 }
@@ -12,6 +12,7 @@ pub(crate) mod irq;
 pub(crate) mod kernel;
 pub(crate) mod mm;
 pub(crate) mod pci;
+pub(crate) mod pmu;
 pub mod qemu;
 pub mod serial;
 pub mod task;
@@ -117,6 +118,13 @@ pub(crate) unsafe fn init_on_ap() {
     timer::init_ap();
 }
 
+/// Discovers the NUMA topology from the ACPI SRAT and SLIT.
+///
+/// It can be called before the heap is initialized.
+pub(crate) fn parse_numa_info() -> Option<crate::mm::numa::NumaInfo> {
+    kernel::acpi::srat::parse()
+}
+
 pub(crate) fn interrupts_ack(irq_number: usize) {
     if !cpu::context::CpuException::is_cpu_exception(irq_number as u16) {
         kernel::apic::with_borrow(|apic| {
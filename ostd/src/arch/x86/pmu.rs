@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! The architectural performance monitoring unit (PMU).
+//!
+//! The first general-purpose counter of each CPU is programmed to count the
+//! unhalted core cycles, in both the user and the kernel modes. The counter
+//! starts at `-period`, so it overflows and raises a performance monitoring
+//! interrupt (PMI) after `period` cycles.
+//!
+//! The PMI is delivered through the LVT of the local APIC as a maskable
+//! interrupt. So the code that runs with the local IRQs disabled is sampled
+//! only when it enables the IRQs again.
+//!
+//! Reference: Intel SDM Vol. 3B, Chapter 20 "Performance Monitoring".
+
+use core::{
+    arch::x86_64::__cpuid,
+    mem::size_of,
+    ops::Range,
+    sync::atomic::{AtomicU64, Ordering},
+};
+
+use spin::Once;
+use x86::msr::{
+    rdmsr, wrmsr, IA32_PERFEVTSEL0, IA32_PERF_GLOBAL_CTRL, IA32_PERF_GLOBAL_OVF_CTRL,
+    IA32_PERF_GLOBAL_STATUS, IA32_PMC0,
+};
+
+use crate::{arch::kernel::apic, mm::Vaddr, trap::TrapFrame};
+
+/// The event select and the unit mask of the "UnHalted Core Cycles" event.
+const EVENT_UNHALTED_CORE_CYCLES: u64 = 0x3c;
+/// Counts the events in the user mode.
+const EVTSEL_USR: u64 = 1 << 16;
+/// Counts the events in the kernel mode.
+const EVTSEL_OS: u64 = 1 << 17;
+/// Raises a PMI when the counter overflows.
+const EVTSEL_INT: u64 = 1 << 20;
+/// Enables the counter.
+const EVTSEL_EN: u64 = 1 << 22;
+
+const APIC_LVT_MASK_BIT: u64 = 1 << 16;
+
+/// The number of cycles between two PMIs.
+static PERIOD: AtomicU64 = AtomicU64::new(0);
+
+static PMU_INFO: Once<PmuInfo> = Once::new();
+
+/// The capabilities of the architectural PMU, which are reported by CPUID leaf 0xA.
+struct PmuInfo {
+    version: u32,
+    nr_counters: u32,
+    counter_width: u32,
+    has_cycles_event: bool,
+}
+
+/// Returns the capabilities of the PMU.
+///
+/// They are cached since CPUID is costly, especially in a virtual machine.
+fn pmu_info() -> &'static PmuInfo {
+    PMU_INFO.call_once(read_pmu_info)
+}
+
+fn read_pmu_info() -> PmuInfo {
+    // SAFETY: The CPUID instruction is always available on x86-64.
+    let max_leaf = unsafe { __cpuid(0) }.eax;
+    if max_leaf < 0xa {
+        return PmuInfo {
+            version: 0,
+            nr_counters: 0,
+            counter_width: 0,
+            has_cycles_event: false,
+        };
+    }
+
+    // SAFETY: CPUID leaf 0xA is supported as checked above.
+    let leaf = unsafe { __cpuid(0xa) };
+    PmuInfo {
+        version: leaf.eax & 0xff,
+        nr_counters: (leaf.eax >> 8) & 0xff,
+        counter_width: (leaf.eax >> 16) & 0xff,
+        // A set bit means that the event is _not_ available.
+        has_cycles_event: ((leaf.eax >> 24) & 0xff) >= 1 && (leaf.ebx & 1) == 0,
+    }
+}
+
+/// Returns whether the PMU can raise interrupts on the overflows of the cycle counter.
+pub(crate) fn is_supported() -> bool {
+    let info = pmu_info();
+    info.version >= 1 && info.nr_counters >= 1 && info.has_cycles_event
+}
+
+/// Sets the number of cycles between two PMIs on all the CPUs.
+///
+/// The new period takes effect on a CPU the next time it is restarted or it
+/// handles a PMI.
+pub(crate) fn set_period(period: u64) {
+    PERIOD.store(period.max(1), Ordering::Relaxed);
+}
+
+/// Starts the cycle counter on the current CPU, which raises PMIs as `vector`.
+///
+/// # Safety
+///
+/// The caller must ensure that [`is_supported`] returns true, and that
+/// `vector` is the vector of an allocated [`IrqLine`](crate::trap::IrqLine).
+pub(crate) unsafe fn start_on_current_cpu(vector: u8) {
+    // SAFETY: The MSRs exist since the PMU is supported.
+    unsafe {
+        wrmsr(IA32_PERFEVTSEL0, 0);
+        reload_counter();
+        apic::with_borrow(|apic| apic.set_lvt_pmi(vector as u64));
+        wrmsr(
+            IA32_PERFEVTSEL0,
+            EVENT_UNHALTED_CORE_CYCLES | EVTSEL_USR | EVTSEL_OS | EVTSEL_INT | EVTSEL_EN,
+        );
+        if pmu_info().version >= 2 {
+            let global_ctrl = rdmsr(IA32_PERF_GLOBAL_CTRL);
+            wrmsr(IA32_PERF_GLOBAL_CTRL, global_ctrl | 1);
+        }
+    }
+}
+
+/// Stops the cycle counter on the current CPU.
+///
+/// # Safety
+///
+/// The caller must ensure that [`is_supported`] returns true.
+pub(crate) unsafe fn stop_on_current_cpu() {
+    // SAFETY: The MSRs exist since the PMU is supported.
+    unsafe { wrmsr(IA32_PERFEVTSEL0, 0) };
+    apic::with_borrow(|apic| apic.set_lvt_pmi(APIC_LVT_MASK_BIT));
+}
+
+/// Acknowledges the overflow of the cycle counter on the current CPU and reloads it.
+///
+/// Returns false if the counter has not overflowed, i.e., the interrupt is spurious.
+///
+/// # Safety
+///
+/// The caller must ensure that the cycle counter is started on the current CPU,
+/// and that `vector` is the vector passed to [`start_on_current_cpu`].
+pub(crate) unsafe fn handle_overflow(vector: u8) -> bool {
+    // SAFETY: The MSRs exist since the counter is started.
+    unsafe {
+        if pmu_info().version >= 2 {
+            if rdmsr(IA32_PERF_GLOBAL_STATUS) & 1 == 0 {
+                return false;
+            }
+            wrmsr(IA32_PERF_GLOBAL_OVF_CTRL, 1);
+        }
+        reload_counter();
+    }
+    // The LVT entry has been masked when the PMI was delivered.
+    apic::with_borrow(|apic| apic.set_lvt_pmi(vector as u64));
+    true
+}
+
+unsafe fn reload_counter() {
+    let width = pmu_info().counter_width.clamp(32, 64);
+    let mask = if width == 64 {
+        u64::MAX
+    } else {
+        (1 << width) - 1
+    };
+    let period = PERIOD.load(Ordering::Relaxed);
+    // SAFETY: The caller ensures that the MSR exists.
+    unsafe { wrmsr(IA32_PMC0, period.wrapping_neg() & mask) };
+}
+
+/// Walks the kernel stack that the trap frame is interrupted from, with the frame pointers.
+///
+/// The interrupted instruction pointer and the return addresses are written
+/// to `frames`, from the innermost frame, and the number of them is returned.
+/// A frame pointer is followed only if it lies in `stack`, so a corrupted
+/// or a missing frame pointer ends the walk early instead of faulting.
+pub(crate) fn walk_kernel_stack(
+    trap_frame: &TrapFrame,
+    stack: Range<Vaddr>,
+    frames: &mut [Vaddr],
+) -> usize {
+    if frames.is_empty() {
+        return 0;
+    }
+    frames[0] = trap_frame.rip;
+
+    let mut nr_frames = 1;
+    let mut frame_pointer = trap_frame.rbp;
+    while nr_frames < frames.len() {
+        // A frame holds the saved frame pointer and the return address.
+        let frame_end = frame_pointer.wrapping_add(2 * size_of::<usize>());
+        if frame_pointer % size_of::<usize>() != 0
+            || frame_pointer < stack.start
+            || frame_end > stack.end
+            || frame_end < frame_pointer
+        {
+            break;
+        }
+
+        let frame = frame_pointer as *const usize;
+        // SAFETY: The frame lies in the kernel stack, which is mapped.
+        let (next_frame_pointer, return_address) =
+            unsafe { (frame.read_volatile(), frame.add(1).read_volatile()) };
+        if return_address == 0 {
+            break;
+        }
+        frames[nr_frames] = return_address;
+        nr_frames += 1;
+
+        // The stack grows downwards, so the frames of the callers are at higher addresses.
+        if next_frame_pointer <= frame_pointer {
+            break;
+        }
+        frame_pointer = next_frame_pointer;
+    }
+
+    nr_frames
+}
@@ -41,18 +41,47 @@ pub(super) fn init_ap(timer_irq: &IrqLine) {
 
 /// A callback that needs to be called on timer interrupt.
 pub(super) fn timer_callback() {
+    set_next_deadline(1);
+}
+
+/// Returns whether the timer interrupts are armed one at a time, i.e., in the
+/// TSC-deadline mode.
+///
+/// Only in this mode the next timer interrupt can be delayed to stop the tick.
+pub(super) fn is_deadline_mode() -> bool {
+    matches!(CONFIG.get(), Some(Config::DeadlineMode { .. }))
+}
+
+/// Arms the next timer interrupt of the current CPU to fire after `ticks`
+/// ticks.
+///
+/// This has no effect in the periodic mode.
+pub(super) fn set_next_deadline(ticks: u64) {
     use x86::msr::{wrmsr, IA32_TSC_DEADLINE};
 
     match CONFIG.get().expect("ACPI timer config is not initialized") {
         Config::DeadlineMode { tsc_interval } => {
             let tsc_value = unsafe { _rdtsc() };
-            let next_tsc_value = tsc_interval + tsc_value;
+            let next_tsc_value = tsc_interval.saturating_mul(ticks) + tsc_value;
             unsafe { wrmsr(IA32_TSC_DEADLINE, next_tsc_value) };
         }
         Config::PeriodicMode { .. } => {}
     }
 }
 
+/// Returns the number of ticks elapsed since the timer is initialized, as
+/// measured by the TSC, or `None` if not in the TSC-deadline mode.
+pub(super) fn elapsed_ticks() -> Option<u64> {
+    match CONFIG.get()? {
+        Config::DeadlineMode { tsc_interval } => {
+            let tsc_value = unsafe { _rdtsc() };
+            let elapsed = tsc_value.saturating_sub(TSC_AT_INIT.load(Ordering::Relaxed));
+            Some(elapsed / tsc_interval)
+        }
+        Config::PeriodicMode { .. } => None,
+    }
+}
+
 /// Determines if the current system supports tsc_deadline mode APIC timer
 fn is_tsc_deadline_mode_supported() -> bool {
     use x86::cpuid::cpuid;
@@ -92,6 +121,9 @@ fn init_periodic_mode(timer_irq: &IrqLine, init_count: u64) {
 
 static CONFIG: spin::Once<Config> = spin::Once::new();
 
+/// The TSC value when the timer is initialized in the TSC-deadline mode.
+static TSC_AT_INIT: AtomicU64 = AtomicU64::new(0);
+
 enum Config {
     DeadlineMode { tsc_interval: u64 },
     PeriodicMode { init_count: u64 },
@@ -101,6 +133,7 @@ fn init_deadline_mode_config() {
     info!("[Timer]: Enable APIC TSC deadline mode");
 
     let tsc_interval = tsc_freq() / TIMER_FREQ;
+    TSC_AT_INIT.store(unsafe { _rdtsc() }, Ordering::Relaxed);
     CONFIG.call_once(|| Config::DeadlineMode { tsc_interval });
 }
 
@@ -60,11 +60,47 @@ pub(super) fn init_ap() {
     }
 }
 
-fn timer_callback(_: &TrapFrame) {
+/// Returns whether the tick of the current CPU can be stopped.
+pub(crate) fn can_stop_tick() -> bool {
+    kernel::apic::exists() && apic::is_deadline_mode()
+}
+
+/// Stops the tick of the current CPU, leaving only one timer interrupt to
+/// fire after `ticks` ticks.
+///
+/// The tick should be restarted with [`restart_tick`] on the next interrupt.
+pub(crate) fn stop_tick(ticks: u64) {
+    debug_assert!(can_stop_tick());
+    apic::set_next_deadline(ticks);
+}
+
+/// Restarts the tick of the current CPU that has been stopped.
+pub(crate) fn restart_tick() {
     let irq_guard = trap::disable_local();
-    if irq_guard.current_cpu() == CpuId::bsp() {
-        crate::timer::jiffies::ELAPSED.fetch_add(1, Ordering::SeqCst);
+    update_jiffies(irq_guard.current_cpu());
+    apic::set_next_deadline(1);
+}
+
+/// Advances the jiffies.
+///
+/// In the TSC-deadline mode, the ticks of the BSP may be stopped, so the
+/// jiffies are caught up with the TSC on the ticks of any CPU. Otherwise, the
+/// jiffies count the ticks of the BSP.
+fn update_jiffies(cpu: CpuId) {
+    use crate::timer::jiffies::ELAPSED;
+
+    if let Some(ticks) = kernel::apic::exists().then(apic::elapsed_ticks).flatten() {
+        if ELAPSED.load(Ordering::Relaxed) < ticks {
+            ELAPSED.fetch_max(ticks, Ordering::SeqCst);
+        }
+    } else if cpu == CpuId::bsp() {
+        ELAPSED.fetch_add(1, Ordering::SeqCst);
     }
+}
+
+fn timer_callback(_: &TrapFrame) {
+    let irq_guard = trap::disable_local();
+    update_jiffies(irq_guard.current_cpu());
 
     let callbacks_guard = INTERRUPT_CALLBACKS.get_with(&irq_guard);
     for callback in callbacks_guard.borrow().iter() {
@@ -7,7 +7,7 @@ use alloc::boxed::Box;
 use x86_64::{
     instructions::tables::{lgdt, load_tss},
     registers::{
-        model_specific::Star,
+        model_specific::{Msr, Star},
         segmentation::{Segment, CS},
     },
     structures::{
@@ -18,7 +18,7 @@ use x86_64::{
     PrivilegeLevel, VirtAddr,
 };
 
-use crate::cpu::local::CpuLocal;
+use crate::cpu::{local::CpuLocal, CpuId};
 
 /// Initializes and loads the GDT and TSS.
 ///
@@ -47,15 +47,33 @@ pub(super) unsafe fn init() {
     // intended for switching to a new kernel CS.
     assert_eq!(CS::get_reg(), KERNEL_CS);
 
-    // Allocate a new GDT with 8 entries.
+    let cpu = crate::cpu::current_cpu_racy();
+
+    // Allocate a new GDT with 16 entries.
     let gdt = Box::new([
-        0, KCODE64, KDATA, /* UCODE32 (not used) */ 0, UDATA, UCODE64, tss0, tss1,
+        0,
+        KCODE64,
+        KDATA,
+        /* UCODE32 (not used) */ 0,
+        UDATA,
+        UCODE64,
+        tss0,
+        tss1,
+        0,
+        0,
+        0,
+        0,
+        0,
+        0,
+        0,
+        cpunode_descriptor(cpu),
     ]);
     let gdt = &*Box::leak(gdt);
     assert_eq!(gdt[KERNEL_CS.index() as usize], KCODE64);
     assert_eq!(gdt[KERNEL_SS.index() as usize], KDATA);
     assert_eq!(gdt[USER_CS.index() as usize], UCODE64);
     assert_eq!(gdt[USER_SS.index() as usize], UDATA);
+    assert_eq!(gdt[CPUNODE_INDEX], cpunode_descriptor(cpu));
 
     // Load the new GDT.
     let gdtr = DescriptorTablePointer {
@@ -85,6 +103,53 @@ pub(super) unsafe fn init() {
     assert_eq!(gdt[(syscall.index() + 1) as usize], KDATA);
     // SAFETY: The selector points to correct kernel/user code/data descriptors in the GDT.
     unsafe { Star::write_raw(sysret.0, syscall.0) };
+
+    // Expose the CPU number to `rdtscp` and `rdpid` as well.
+    if has_tsc_aux() {
+        // SAFETY: Writing `IA32_TSC_AUX` only changes the value returned by `rdtscp` and `rdpid`,
+        // which the kernel does not rely on.
+        unsafe { Msr::new(MSR_TSC_AUX).write(cpunode_data(cpu)) };
+    }
+}
+
+/// The GDT index of the per-CPU segment that the vDSO reads the CPU and node numbers from.
+///
+/// The vDSO `getcpu` executes `lsl` on the selector of this segment (with RPL 3), so the index
+/// must match `GDT_ENTRY_CPUNODE` in Linux.
+const CPUNODE_INDEX: usize = 15;
+
+const MSR_TSC_AUX: u32 = 0xC000_0103;
+
+/// Returns the CPU and node numbers in the format that the vDSO expects.
+///
+/// The lower 12 bits hold the CPU number and the upper bits hold the node number.
+fn cpunode_data(cpu: CpuId) -> u64 {
+    let node = crate::mm::numa::node_of_cpu(cpu).as_usize() as u64;
+    (node << 12) | (cpu.as_usize() as u64 & 0xfff)
+}
+
+/// Returns a user-readable data descriptor whose segment limit is `cpunode_data(cpu)`.
+///
+/// The segment is never loaded. It exists only so that `lsl` can read its limit from user space.
+fn cpunode_descriptor(cpu: CpuId) -> u64 {
+    // Present, DPL 3, read-only, expand-down, accessed, 32-bit data segment.
+    const CPUNODE_FLAGS: u64 = 0x0040_F500_0000_0000;
+
+    let limit = cpunode_data(cpu);
+    CPUNODE_FLAGS | (limit & 0xffff) | (((limit >> 16) & 0xf) << 48)
+}
+
+fn has_tsc_aux() -> bool {
+    use core::arch::x86_64::{__cpuid, __cpuid_count};
+
+    // Check for RDTSCP (bit 27 of edx in CPUID function 0x8000_0001)
+    let has_rdtscp = unsafe { __cpuid(0x8000_0000).eax } >= 0x8000_0001
+        && unsafe { __cpuid(0x8000_0001).edx } & (1 << 27) != 0;
+    // Check for RDPID (bit 22 of ecx in CPUID function 7)
+    let has_rdpid =
+        unsafe { __cpuid(0).eax } >= 7 && unsafe { __cpuid_count(7, 0).ecx } & (1 << 22) != 0;
+
+    has_rdtscp || has_rdpid
 }
 
 // The linker script makes sure that the `.cpu_local_tss` section is at the beginning of the area
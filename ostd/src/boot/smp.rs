@@ -143,6 +143,7 @@ pub fn register_ap_entry(entry: fn()) {
 fn ap_early_entry(cpu_id: u32) -> ! {
     // SAFETY: `cpu_id` is the correct value of the CPU ID.
     unsafe { cpu::init_on_ap(cpu_id) };
+    crate::mm::numa::init_current_cpu();
 
     crate::arch::enable_cpu_features();
 
@@ -5,7 +5,7 @@
 use core::cell::UnsafeCell;
 
 use super::{__cpu_local_end, __cpu_local_start, single_instr::*};
-use crate::arch;
+use crate::{arch, cpu::CpuId, mm::paddr_to_vaddr};
 
 /// Defines an inner-mutable CPU-local variable.
 ///
@@ -253,3 +253,47 @@ impl<T: 'static + SingleInstructionStore> CpuLocalCell<T> {
         }
     }
 }
+
+// Accessors for the per-CPU counters.
+//
+// A statistic counter is a `u64` CPU-local cell that each CPU adds to with
+// `add_assign`, which takes a single instruction and needs neither atomic
+// operations nor disabling IRQs. The counter is summed over the CPUs only
+// when it is read, so updating it never bounces a cache line between CPUs.
+
+impl CpuLocalCell<u64> {
+    /// Gets the value of the per-CPU object on a specific CPU.
+    ///
+    /// The CPU may be adding to the object at the same time, so the value can
+    /// be outdated as soon as it is returned. This is suitable for statistic
+    /// counters, but not for anything that the correctness depends on.
+    pub fn load_on_cpu(&'static self, cpu_id: CpuId) -> u64 {
+        let ptr = if cpu_id.as_usize() == 0 {
+            // The BSP uses the statically linked storage.
+            self.0.get().cast_const()
+        } else {
+            let offset = self as *const _ as usize - __cpu_local_start as usize;
+            // SAFETY: At this time we have a non-BSP `CpuId`, so the CPU-local
+            // storages for APs must have been initialized. See
+            // `CpuLocal::get_on_cpu` for details.
+            let storage = unsafe {
+                *super::CPU_LOCAL_STORAGES
+                    .get_unchecked()
+                    .get_unchecked(cpu_id.as_usize() - 1)
+            };
+            (paddr_to_vaddr(storage) + offset) as *const u64
+        };
+
+        // SAFETY: The pointer points to the CPU-local object on the CPU, which
+        // is valid and aligned. An aligned 64-bit load does not tear, so it
+        // returns either the old or the new value if the CPU is updating it.
+        unsafe { ptr.read_volatile() }
+    }
+
+    /// Gets the sum of the per-CPU objects on all the CPUs.
+    pub fn sum(&'static self) -> u64 {
+        crate::cpu::all_cpus()
+            .map(|cpu_id| self.load_on_cpu(cpu_id))
+            .fold(0, u64::wrapping_add)
+    }
+}
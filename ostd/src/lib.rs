@@ -41,10 +41,13 @@ pub mod logger;
 pub mod mm;
 pub mod panic;
 pub mod prelude;
+#[cfg(target_arch = "x86_64")]
+pub mod profiler;
 pub mod smp;
 pub mod sync;
 pub mod task;
 pub mod timer;
+pub mod trace;
 pub mod trap;
 pub mod user;
 pub mod util;
@@ -95,6 +98,10 @@ unsafe fn init() {
     // 3. No CPU-local objects have been accessed yet.
     unsafe { cpu::init_on_bsp() };
 
+    // The NUMA topology decides which node the free memory is added to.
+    mm::numa::init();
+    mm::numa::init_current_cpu();
+
     // SAFETY: We are on the BSP and APs are not yet started.
     let meta_pages = unsafe { mm::frame::meta::init() };
     // The frame allocator should be initialized immediately after the metadata
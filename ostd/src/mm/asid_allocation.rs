@@ -3,8 +3,22 @@
 //! Address Space ID (ASID) allocation.
 //!
 //! This module provides functions to allocate and deallocate ASIDs.
-
-use core::sync::atomic::{AtomicU16, Ordering};
+//!
+//! It also tracks the TLB entries tagged with the ASIDs on each CPU. An address
+//! space bumps its TLB generation whenever its mappings are changed, while each
+//! CPU remembers which address space last used an ASID on the CPU, and up to
+//! which TLB generation the TLB entries tagged with the ASID are up-to-date.
+//! So switching to an address space only needs to flush its TLB entries if they
+//! are stale, and there is no need to send TLB shootdowns to the CPUs that are
+//! not running the address space. Since an ASID may be reused by another
+//! address space after it is deallocated or after the ASID generation rolls
+//! over, the TLB entries are also flushed if the ASID was last used by another
+//! address space.
+
+use core::{
+    cell::RefCell,
+    sync::atomic::{AtomicU16, Ordering},
+};
 
 use log;
 
@@ -17,7 +31,7 @@ use alloc::collections::{btree_map::Entry, BTreeMap};
 /// that the TLB entries for this address space need to be flushed
 /// using INVPCID on context switch.
 pub use crate::arch::mm::ASID_CAP;
-use crate::sync::SpinLock;
+use crate::{cpu_local, sync::SpinLock, trap::DisabledLocalIrqGuard};
 
 /// The special ASID value that indicates the TLB entries for this
 /// address space need to be flushed on context switch.
@@ -133,7 +147,7 @@ impl AsidAllocator {
 /// Returns the allocated ASID, or `ASID_FLUSH_REQUIRED` if no ASIDs are available.
 pub fn allocate() -> u16 {
     let generation = current_generation();
-    
+
     // Try bitmap allocation first
     {
         let mut asid_allocator = ASID_ALLOCATOR.lock();
@@ -227,3 +241,73 @@ pub fn increment_generation() {
     // Update the generation
     ASID_GENERATION.store(next_generation, Ordering::Release);
 }
+
+/// The number of ASIDs whose TLB entries are tracked on each CPU.
+const NR_TRACKED_ASIDS: usize = 8;
+
+/// The TLB entries tagged with an ASID on a CPU.
+#[derive(Clone, Copy)]
+struct TrackedAsid {
+    asid: u16,
+    /// The ID of the address space that last used the ASID.
+    vm_space_id: u64,
+    /// The TLB generation of the address space, up to which the TLB entries
+    /// are up-to-date.
+    tlb_gen: u64,
+}
+
+struct CpuAsids {
+    tracked: [Option<TrackedAsid>; NR_TRACKED_ASIDS],
+    /// The slot to be replaced when an untracked ASID is used.
+    next_victim: usize,
+}
+
+cpu_local! {
+    static CPU_ASIDS: RefCell<CpuAsids> = RefCell::new(CpuAsids {
+        tracked: [None; NR_TRACKED_ASIDS],
+        next_victim: 0,
+    });
+}
+
+/// Switches the current CPU to the address space with the ASID.
+///
+/// The address space is identified by `vm_space_id`, and its current TLB
+/// generation is `tlb_gen`. This function returns whether the TLB entries
+/// tagged with the ASID on the current CPU are up-to-date, i.e., whether they
+/// can be kept without being flushed. Either way, the TLB entries are regarded
+/// as up-to-date afterward, so the caller must flush them if `false` is
+/// returned.
+pub(crate) fn switch_to(
+    asid: u16,
+    vm_space_id: u64,
+    tlb_gen: u64,
+    irq_guard: &DisabledLocalIrqGuard,
+) -> bool {
+    if asid == ASID_FLUSH_REQUIRED {
+        return false;
+    }
+
+    let cpu_asids = CPU_ASIDS.get_with(irq_guard);
+    let mut cpu_asids = cpu_asids.borrow_mut();
+    let new_tracked = TrackedAsid {
+        asid,
+        vm_space_id,
+        tlb_gen,
+    };
+
+    if let Some(tracked) = cpu_asids
+        .tracked
+        .iter_mut()
+        .flatten()
+        .find(|tracked| tracked.asid == asid)
+    {
+        let is_up_to_date = tracked.vm_space_id == vm_space_id && tracked.tlb_gen == tlb_gen;
+        *tracked = new_tracked;
+        return is_up_to_date;
+    }
+
+    let victim = cpu_asids.next_victim;
+    cpu_asids.tracked[victim] = Some(new_tracked);
+    cpu_asids.next_victim = (victim + 1) % NR_TRACKED_ASIDS;
+    false
+}
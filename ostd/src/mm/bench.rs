@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! Microbenchmarks of the memory management primitives.
+
+use core::sync::atomic::AtomicU64;
+
+use crate::{
+    cpu::{CpuSet, PinCurrentCpu},
+    mm::{
+        heap::Slab,
+        page_table::{PageTable, PageTableItem, UserMode},
+        tlb::{TlbFlushOp, TlbFlusher},
+        CachePolicy, FrameAllocOptions, PageFlags, PageProperty, PAGE_SIZE,
+    },
+    prelude::*,
+    task::disable_preempt,
+    util::bench::{bench, bench_contended},
+};
+
+const ITERS: usize = 10_000;
+
+mod frame {
+    use super::*;
+
+    #[ktest]
+    fn bench_alloc_frame() {
+        bench("FrameAllocOptions::alloc_frame", ITERS, || {
+            let frame = FrameAllocOptions::new()
+                .zeroed(false)
+                .alloc_frame()
+                .unwrap();
+            drop(frame);
+        });
+    }
+
+    #[ktest]
+    fn bench_alloc_frame_zeroed() {
+        bench("FrameAllocOptions::alloc_frame (zeroed)", ITERS, || {
+            let frame = FrameAllocOptions::new().alloc_frame().unwrap();
+            drop(frame);
+        });
+    }
+
+    #[ktest]
+    fn bench_alloc_frame_contended() {
+        bench_contended("FrameAllocOptions::alloc_frame", ITERS, || {
+            let frame = FrameAllocOptions::new()
+                .zeroed(false)
+                .alloc_frame()
+                .unwrap();
+            drop(frame);
+        });
+    }
+}
+
+mod heap {
+    use super::*;
+
+    #[ktest]
+    fn bench_slab_alloc() {
+        let mut slab = Slab::<64>::new().unwrap();
+        bench("SlabMeta::alloc + Slab::dealloc", ITERS, || {
+            let slot = slab.meta_mut().alloc().unwrap();
+            slab.dealloc(slot).unwrap();
+        });
+    }
+
+    #[ktest]
+    fn bench_box_alloc() {
+        bench("Box::new (64 bytes)", ITERS, || {
+            let boxed = Box::new([0u8; 64]);
+            drop(core::hint::black_box(boxed));
+        });
+    }
+
+    #[ktest]
+    fn bench_box_alloc_contended() {
+        bench_contended("Box::new (64 bytes)", ITERS, || {
+            let boxed = Box::new([0u8; 64]);
+            drop(core::hint::black_box(boxed));
+        });
+    }
+}
+
+mod tlb {
+    use super::*;
+
+    #[ktest]
+    fn bench_flush_self() {
+        let tlb_gen = AtomicU64::new(0);
+        let preempt_guard = disable_preempt();
+        let mut target_cpus = CpuSet::new_empty();
+        target_cpus.add(preempt_guard.current_cpu());
+        let mut flusher = TlbFlusher::new(target_cpus, &tlb_gen, preempt_guard);
+
+        bench("TlbFlusher dispatch (self)", ITERS, || {
+            flusher.issue_tlb_flush(TlbFlushOp::Address(PAGE_SIZE));
+            flusher.dispatch_tlb_flush();
+        });
+    }
+
+    #[ktest]
+    fn bench_flush_all_cpus() {
+        let tlb_gen = AtomicU64::new(0);
+        let mut flusher = TlbFlusher::new(CpuSet::new_full(), &tlb_gen, disable_preempt());
+
+        bench("TlbFlusher dispatch + sync (all CPUs)", ITERS, || {
+            flusher.issue_tlb_flush(TlbFlushOp::Address(PAGE_SIZE));
+            flusher.dispatch_tlb_flush();
+            flusher.sync_tlb_flush();
+        });
+    }
+}
+
+mod page_table {
+    use super::*;
+
+    #[ktest]
+    fn bench_cursor_map_unmap() {
+        let page_table = PageTable::<UserMode>::empty();
+        let frame = FrameAllocOptions::new().alloc_frame().unwrap();
+        let prop = PageProperty::new(PageFlags::RW, CachePolicy::Writeback);
+        let range = PAGE_SIZE..PAGE_SIZE * 2;
+
+        bench("Cursor map + take_next (one page)", ITERS, || {
+            let mut cursor = page_table.cursor_mut(&range).unwrap();
+            // SAFETY: The page table is a user page table that is never
+            // activated, so the mapping cannot affect the kernel.
+            unsafe {
+                cursor.map(frame.clone().into(), prop);
+                cursor.jump(range.start).unwrap();
+                cursor.take_next(PAGE_SIZE);
+            }
+        });
+    }
+
+    #[ktest]
+    fn bench_cursor_map_range() {
+        const NR_PAGES: usize = 512;
+
+        let page_table = PageTable::<UserMode>::empty();
+        let frame = FrameAllocOptions::new().alloc_frame().unwrap();
+        let prop = PageProperty::new(PageFlags::RW, CachePolicy::Writeback);
+        let range = PAGE_SIZE..PAGE_SIZE * (NR_PAGES + 1);
+
+        let cycles = bench("Cursor map + take_next (512 pages)", ITERS / 100, || {
+            let mut cursor = page_table.cursor_mut(&range).unwrap();
+            // SAFETY: The page table is a user page table that is never
+            // activated, so the mapping cannot affect the kernel.
+            unsafe {
+                for _ in 0..NR_PAGES {
+                    cursor.map(frame.clone().into(), prop);
+                }
+                cursor.jump(range.start).unwrap();
+                while !matches!(
+                    cursor.take_next(range.end - cursor.virt_addr()),
+                    PageTableItem::NotMapped { .. }
+                ) {}
+            }
+        });
+        println!(
+            "[bench] {:<40} {:>10} cycles/page",
+            "Cursor map + take_next (512 pages)",
+            cycles / NR_PAGES as u64
+        );
+    }
+}
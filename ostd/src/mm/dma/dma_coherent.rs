@@ -5,9 +5,8 @@ use core::ops::Deref;
 
 use cfg_if::cfg_if;
 
-use super::{check_and_insert_dma_mapping, remove_dma_mapping, DmaError, HasDaddr};
+use super::{check_and_insert_dma_mapping, iommu_cache, remove_dma_mapping, DmaError, HasDaddr};
 use crate::{
-    arch::iommu,
     mm::{
         dma::{dma_type, Daddr, DmaType},
         io::VmIoOnce,
@@ -88,13 +87,7 @@ impl DmaCoherent {
                 start_paddr as Daddr
             }
             DmaType::Iommu => {
-                for i in 0..frame_count {
-                    let paddr = start_paddr + (i * PAGE_SIZE);
-                    // SAFETY: the `paddr` is restricted by the `start_paddr` and `frame_count` of the `segment`.
-                    unsafe {
-                        iommu::map(paddr as Daddr, paddr).unwrap();
-                    }
-                }
+                iommu_cache::map(start_paddr..start_paddr + frame_count * PAGE_SIZE);
                 start_paddr as Daddr
             }
         };
@@ -147,10 +140,7 @@ impl Drop for DmaCoherentInner {
                 });
             }
             DmaType::Iommu => {
-                for i in 0..frame_count {
-                    let paddr = start_paddr + (i * PAGE_SIZE);
-                    iommu::unmap(paddr).unwrap();
-                }
+                iommu_cache::unmap(&self.segment);
             }
         }
         if !self.is_cache_coherent {
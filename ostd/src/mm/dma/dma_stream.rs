@@ -3,9 +3,8 @@
 use alloc::sync::Arc;
 use core::ops::Range;
 
-use super::{check_and_insert_dma_mapping, remove_dma_mapping, DmaError, HasDaddr};
+use super::{check_and_insert_dma_mapping, iommu_cache, remove_dma_mapping, DmaError, HasDaddr};
 use crate::{
-    arch::iommu,
     error::Error,
     mm::{
         dma::{dma_type, Daddr, DmaType},
@@ -78,13 +77,7 @@ impl DmaStream {
                 start_paddr as Daddr
             }
             DmaType::Iommu => {
-                for i in 0..frame_count {
-                    let paddr = start_paddr + (i * PAGE_SIZE);
-                    // SAFETY: the `paddr` is restricted by the `start_paddr` and `frame_count` of the `segment`.
-                    unsafe {
-                        iommu::map(paddr as Daddr, paddr).unwrap();
-                    }
-                }
+                iommu_cache::map(start_paddr..start_paddr + frame_count * PAGE_SIZE);
                 start_paddr as Daddr
             }
         };
@@ -188,10 +181,7 @@ impl Drop for DmaStreamInner {
                 });
             }
             DmaType::Iommu => {
-                for i in 0..frame_count {
-                    let paddr = start_paddr + (i * PAGE_SIZE);
-                    iommu::unmap(paddr).unwrap();
-                }
+                iommu_cache::unmap(&self.segment);
             }
         }
         remove_dma_mapping(start_paddr, frame_count);
@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! The IOMMU mappings of DMA buffers, which are unmapped lazily.
+//!
+//! The IOMMU maps device addresses identically to physical addresses, and
+//! all devices share one IOMMU page table. Unmapping pages is only complete
+//! after the IOTLB is invalidated, which waits for the hardware and costs far
+//! more than changing the page table. So the pages of the dropped DMA mappings
+//! are put in a flush queue instead of being unmapped at once:
+//!  - If a queued page is mapped for DMA again, it is just taken out of the
+//!    queue, since its IOMMU mapping is still in place. Buffers that are
+//!    mapped and unmapped repeatedly, e.g., the bio segments of the block
+//!    devices, are thus mapped in the IOMMU only once.
+//!  - When the queue is full, or when the oldest queued page has waited for
+//!    [`FLUSH_TIMEOUT`], all the queued pages are unmapped, and the IOTLB is
+//!    invalidated once for all of them.
+//!
+//! The queue holds a reference to each queued page, so that the page is not
+//! freed and reused until its IOTLB entries are invalidated. Otherwise, a
+//! device could still access the page after it is reused.
+//!
+//! Like the lazy IOTLB flushing of Linux, this trades strict isolation for
+//! performance: a device may access a page for a while after the DMA mapping
+//! of the page is dropped.
+
+use alloc::collections::BTreeMap;
+use core::{
+    ops::Range,
+    sync::atomic::{AtomicU64, Ordering},
+    time::Duration,
+};
+
+use crate::{
+    arch::{iommu, timer::TIMER_FREQ},
+    mm::{dma::Daddr, Paddr, UFrame, USegment, PAGE_SIZE},
+    sync::{LocalIrqDisabled, SpinLock},
+    timer::{self, Jiffies},
+};
+
+/// The maximum number of pages in the flush queue.
+const MAX_QUEUED_PAGES: usize = 4096;
+
+/// The maximum time that a page waits in the flush queue, which is the same
+/// as that of Linux.
+const FLUSH_TIMEOUT: Duration = Duration::from_millis(10);
+
+/// The pages that are still mapped in the IOMMU but no longer used for DMA.
+///
+/// The lock also serializes the IOMMU mapping and unmapping, so that a page
+/// cannot be mapped again while the queue is being flushed.
+//
+// The lock disables IRQs since DMA mappings can be dropped in IRQ handlers.
+static FLUSH_QUEUE: SpinLock<BTreeMap<Paddr, UFrame>, LocalIrqDisabled> =
+    SpinLock::new(BTreeMap::new());
+
+/// The jiffies when the flush queue became non-empty, or `u64::MAX` if it is
+/// empty.
+static QUEUED_SINCE: AtomicU64 = AtomicU64::new(u64::MAX);
+
+pub(super) fn init() {
+    // Only an atomic load is done on the ticks while the queue is empty.
+    timer::register_callback(flush_if_timed_out);
+}
+
+/// Maps the pages in `paddr_range` in the IOMMU.
+pub(super) fn map(paddr_range: Range<Paddr>) {
+    let mut queue = FLUSH_QUEUE.lock();
+
+    // Map the runs of the pages that are not in the queue.
+    let mut run_start = None;
+    for paddr in paddr_range.clone().step_by(PAGE_SIZE) {
+        if queue.remove(&paddr).is_none() {
+            run_start.get_or_insert(paddr);
+        } else if let Some(start) = run_start.take() {
+            map_in_iommu(start..paddr);
+        }
+    }
+    if let Some(start) = run_start {
+        map_in_iommu(start..paddr_range.end);
+    }
+    if queue.is_empty() {
+        QUEUED_SINCE.store(u64::MAX, Ordering::Relaxed);
+    }
+}
+
+/// Unmaps the pages of `segment` from the IOMMU lazily.
+///
+/// The pages are kept alive until they are unmapped and the IOTLB is
+/// invalidated.
+pub(super) fn unmap(segment: &USegment) {
+    let mut queue = FLUSH_QUEUE.lock();
+
+    if queue.is_empty() {
+        QUEUED_SINCE.store(Jiffies::elapsed().as_u64(), Ordering::Relaxed);
+    }
+    queue.extend(segment.clone().map(|frame| (frame.start_paddr(), frame)));
+    if queue.len() < MAX_QUEUED_PAGES {
+        return;
+    }
+
+    let flushed = flush(&mut queue);
+    // Free the pages, if they are the last references, without the lock.
+    drop(queue);
+    drop(flushed);
+}
+
+/// Flushes the queue if the oldest queued page has waited for too long.
+fn flush_if_timed_out() {
+    let timeout = FLUSH_TIMEOUT.as_millis() as u64 * TIMER_FREQ / 1000;
+    let queued_since = QUEUED_SINCE.load(Ordering::Relaxed);
+    if Jiffies::elapsed().as_u64() < queued_since.saturating_add(timeout.max(1)) {
+        return;
+    }
+
+    let mut queue = FLUSH_QUEUE.lock();
+    if queue.is_empty() {
+        return;
+    }
+    let flushed = flush(&mut queue);
+    drop(queue);
+    drop(flushed);
+}
+
+fn map_in_iommu(paddr_range: Range<Paddr>) {
+    let daddr_range = paddr_range.start as Daddr..paddr_range.end as Daddr;
+    // SAFETY: The pages belong to the DMA mapping that is being established.
+    unsafe {
+        iommu::map(daddr_range, paddr_range.start).unwrap();
+    }
+}
+
+/// Unmaps the queued pages and invalidates the IOTLB.
+///
+/// Returns the pages, which can be freed only after this.
+#[must_use]
+fn flush(queue: &mut BTreeMap<Paddr, UFrame>) -> BTreeMap<Paddr, UFrame> {
+    let flushed = core::mem::take(queue);
+    QUEUED_SINCE.store(u64::MAX, Ordering::Relaxed);
+
+    let mut paddrs = flushed.keys().copied().peekable();
+    while let Some(start) = paddrs.next() {
+        let mut end = start + PAGE_SIZE;
+        while paddrs.next_if_eq(&end).is_some() {
+            end += PAGE_SIZE;
+        }
+        iommu::unmap(start as Daddr..end as Daddr).unwrap();
+    }
+
+    iommu::flush_iotlb();
+    flushed
+}
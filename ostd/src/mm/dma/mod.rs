@@ -2,6 +2,7 @@
 
 mod dma_coherent;
 mod dma_stream;
+mod iommu_cache;
 #[cfg(ktest)]
 mod test;
 
@@ -60,6 +61,7 @@ pub fn dma_type() -> DmaType {
 
 pub fn init() {
     DMA_MAPPING_SET.call_once(|| SpinLock::new(BTreeSet::new()));
+    iommu_cache::init();
 }
 
 /// Checks whether the physical addresses has dma mapping.
@@ -174,6 +174,29 @@ mod dma_stream {
         assert!(dma_stream_child.is_err());
     }
 
+    #[ktest]
+    fn remap_after_drop() {
+        let segment = FrameAllocOptions::new()
+            .alloc_segment_with(3, |_| ())
+            .unwrap();
+        let dma_stream =
+            DmaStream::map(segment.clone().into(), DmaDirection::Bidirectional, false).unwrap();
+        drop(dma_stream);
+
+        // The pages whose unmapping is deferred can be mapped again, either
+        // partially or together with the other pages.
+        let dma_stream_child = DmaStream::map(
+            segment.slice(&(PAGE_SIZE..PAGE_SIZE * 2)).into(),
+            DmaDirection::ToDevice,
+            false,
+        )
+        .unwrap();
+        drop(dma_stream_child);
+        let dma_stream =
+            DmaStream::map(segment.clone().into(), DmaDirection::FromDevice, false).unwrap();
+        assert_eq!(dma_stream.daddr(), segment.start_paddr() as Daddr);
+    }
+
     #[ktest]
     fn read_write() {
         let segment = FrameAllocOptions::new()
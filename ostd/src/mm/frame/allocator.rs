@@ -9,16 +9,36 @@ use align_ext::AlignExt;
 use super::{meta::AnyFrameMeta, segment::Segment, Frame};
 use crate::{
     boot::memory_region::MemoryRegionType,
+    cpu_local_cell,
     error::Error,
     impl_frame_meta_for,
-    mm::{paddr_to_vaddr, Paddr, PAGE_SIZE},
+    mm::{numa::NodeId, paddr_to_vaddr, Paddr, PAGE_SIZE},
     prelude::*,
     util::ops::range_difference,
 };
 
+cpu_local_cell! {
+    /// The number of frames allocated on the CPU.
+    static NR_ALLOCATED_FRAMES: u64 = 0;
+    /// The number of frames deallocated on the CPU.
+    static NR_DEALLOCATED_FRAMES: u64 = 0;
+}
+
+/// Returns the number of frames allocated since boot.
+pub fn nr_allocated_frames() -> u64 {
+    NR_ALLOCATED_FRAMES.sum()
+}
+
+/// Returns the number of frames deallocated since boot.
+pub fn nr_deallocated_frames() -> u64 {
+    NR_DEALLOCATED_FRAMES.sum()
+}
+
 /// Options for allocating physical memory frames.
 pub struct FrameAllocOptions {
     zeroed: bool,
+    align: usize,
+    node: Option<NodeId>,
 }
 
 impl Default for FrameAllocOptions {
@@ -30,7 +50,11 @@ impl Default for FrameAllocOptions {
 impl FrameAllocOptions {
     /// Creates new options for allocating the specified number of frames.
     pub fn new() -> Self {
-        Self { zeroed: true }
+        Self {
+            zeroed: true,
+            align: PAGE_SIZE,
+            node: None,
+        }
     }
 
     /// Sets whether the allocated frames should be initialized with zeros.
@@ -45,6 +69,41 @@ impl FrameAllocOptions {
         self
     }
 
+    /// Sets the alignment of the physical address of the allocated segments.
+    ///
+    /// This is useful to allocate the segments that are mapped as huge pages,
+    /// which must be aligned to their sizes.
+    ///
+    /// By default, the segments are aligned to [`PAGE_SIZE`].
+    ///
+    /// # Panics
+    ///
+    /// This method panics if `align` is not a power of two or is smaller than
+    /// [`PAGE_SIZE`].
+    pub fn align(&mut self, align: usize) -> &mut Self {
+        assert!(align.is_power_of_two() && align >= PAGE_SIZE);
+        self.align = align;
+        self
+    }
+
+    /// Sets the NUMA node that the frames should be allocated on.
+    ///
+    /// If the node runs out of memory, the frames are allocated on the nearest
+    /// node that has free memory.
+    ///
+    /// By default, the frames are allocated on the node of the current CPU.
+    pub fn node(&mut self, node: NodeId) -> &mut Self {
+        self.node = Some(node);
+        self
+    }
+
+    fn alloc_layout(&self, layout: Layout) -> Option<Paddr> {
+        match self.node {
+            Some(node) => get_global_frame_allocator().alloc_on_node(layout, node),
+            None => get_global_frame_allocator().alloc(layout),
+        }
+    }
+
     /// Allocates a single untyped frame without metadata.
     pub fn alloc_frame(&self) -> Result<Frame<()>> {
         self.alloc_frame_with(())
@@ -53,10 +112,11 @@ impl FrameAllocOptions {
     /// Allocates a single frame with additional metadata.
     pub fn alloc_frame_with<M: AnyFrameMeta>(&self, metadata: M) -> Result<Frame<M>> {
         let single_layout = Layout::from_size_align(PAGE_SIZE, PAGE_SIZE).unwrap();
-        let frame = get_global_frame_allocator()
-            .alloc(single_layout)
+        let frame = self
+            .alloc_layout(single_layout)
             .map(|paddr| Frame::from_unused(paddr, metadata).unwrap())
             .ok_or(Error::NoMemory)?;
+        NR_ALLOCATED_FRAMES.add_assign(1);
 
         if self.zeroed {
             let addr = paddr_to_vaddr(frame.start_paddr()) as *mut u8;
@@ -87,13 +147,14 @@ impl FrameAllocOptions {
         if nframes == 0 {
             return Err(Error::InvalidArgs);
         }
-        let layout = Layout::from_size_align(nframes * PAGE_SIZE, PAGE_SIZE).unwrap();
-        let segment = get_global_frame_allocator()
-            .alloc(layout)
+        let layout = Layout::from_size_align(nframes * PAGE_SIZE, self.align).unwrap();
+        let segment = self
+            .alloc_layout(layout)
             .map(|start| {
                 Segment::from_unused(start..start + nframes * PAGE_SIZE, metadata_fn).unwrap()
             })
             .ok_or(Error::NoMemory)?;
+        NR_ALLOCATED_FRAMES.add_assign(nframes as u64);
 
         if self.zeroed {
             let addr = paddr_to_vaddr(segment.start_paddr()) as *mut u8;
@@ -153,6 +214,17 @@ pub trait GlobalFrameAllocator: Sync {
     /// allocated, they may be returned in any order with any number of calls.
     fn alloc(&self, layout: Layout) -> Option<Paddr>;
 
+    /// Allocates a contiguous range of frames, preferably on a NUMA node.
+    ///
+    /// It follows the same contract as [`GlobalFrameAllocator::alloc`]. The
+    /// allocator should allocate on `node` if it can, and fall back to the
+    /// nearer nodes first otherwise. The default implementation ignores the
+    /// node.
+    fn alloc_on_node(&self, layout: Layout, node: NodeId) -> Option<Paddr> {
+        let _ = node;
+        self.alloc(layout)
+    }
+
     /// Deallocates a contiguous range of frames.
     ///
     /// The caller guarantees that `addr` and `size` are both aligned to
@@ -188,6 +260,12 @@ pub(super) fn get_global_frame_allocator() -> &'static dyn GlobalFrameAllocator
     unsafe { __GLOBAL_FRAME_ALLOCATOR_REF }
 }
 
+/// Returns a single frame to the global frame allocator.
+pub(super) fn dealloc_frame(paddr: Paddr) {
+    get_global_frame_allocator().dealloc(paddr, PAGE_SIZE);
+    NR_DEALLOCATED_FRAMES.add_assign(1);
+}
+
 /// Initializes the global frame allocator.
 ///
 /// It just does adds the frames to the global frame allocator. Calling it
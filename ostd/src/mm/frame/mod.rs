@@ -246,7 +246,7 @@ impl<M: AnyFrameMeta + ?Sized> Drop for Frame<M> {
             // SAFETY: this is the last reference and is about to be dropped.
             unsafe { self.slot().drop_last_in_place() };
 
-            allocator::get_global_frame_allocator().dealloc(self.start_paddr(), PAGE_SIZE);
+            allocator::dealloc_frame(self.start_paddr());
         }
     }
 }
@@ -107,7 +107,9 @@ impl<M: AnyFrameMeta> Segment<M> {
         }
         Ok(segment)
     }
+}
 
+impl<M: AnyFrameMeta + ?Sized> Segment<M> {
     /// Restores the [`Segment`] from the raw physical address range.
     ///
     /// # Safety
@@ -123,9 +125,7 @@ impl<M: AnyFrameMeta> Segment<M> {
             _marker: core::marker::PhantomData,
         }
     }
-}
 
-impl<M: AnyFrameMeta + ?Sized> Segment<M> {
     /// Gets the start physical address of the contiguous frames.
     pub fn start_paddr(&self) -> Paddr {
         self.range.start
@@ -277,6 +277,13 @@ impl<M: AnyUFrameMeta> From<Segment<M>> for USegment {
     }
 }
 
+impl From<USegment> for Segment<dyn AnyFrameMeta> {
+    fn from(seg: USegment) -> Self {
+        // SAFETY: The metadata is coerceable and the struct is transmutable.
+        unsafe { core::mem::transmute(seg) }
+    }
+}
+
 impl TryFrom<Segment<dyn AnyFrameMeta>> for USegment {
     type Error = Segment<dyn AnyFrameMeta>;
 
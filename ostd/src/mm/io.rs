@@ -47,7 +47,7 @@ use align_ext::AlignExt;
 use inherit_methods_macro::inherit_methods;
 
 use crate::{
-    arch::mm::{__memcpy_fallible, __memset_fallible},
+    arch::mm::{__atomic_cmpxchg_fallible, __memcpy_fallible, __memset_fallible},
     mm::{
         kspace::{KERNEL_BASE_VADDR, KERNEL_END_VADDR},
         MAX_USERSPACE_VADDR,
@@ -859,6 +859,34 @@ impl VmWriter<'_, Fallible> {
         Ok(())
     }
 
+    /// Atomically compares and exchanges a `u32` value at the cursor.
+    ///
+    /// If the value equals `old_val`, it is replaced by `new_val`. This method
+    /// returns the previous value, which equals `old_val` if and only if the
+    /// exchange succeeds. The cursor is not moved.
+    ///
+    /// This is useful for memory shared with user space, e.g., futex words,
+    /// which user space may update concurrently with its own atomic
+    /// instructions.
+    ///
+    /// If the cursor is not aligned to 4 bytes or fewer than 4 bytes are
+    /// available, this method returns [`Error::InvalidArgs`]. If the page fault
+    /// is unresolvable, it returns [`Error::PageFault`].
+    pub fn atomic_compare_exchange_u32(&self, old_val: u32, new_val: u32) -> Result<u32> {
+        if self.avail() < core::mem::size_of::<u32>()
+            || self.cursor as usize % core::mem::align_of::<u32>() != 0
+        {
+            return Err(Error::InvalidArgs);
+        }
+
+        // SAFETY: The cursor is in user space for 4 bytes and properly aligned.
+        let prev = unsafe { __atomic_cmpxchg_fallible(self.cursor.cast(), old_val, new_val) };
+        if prev == u64::MAX {
+            return Err(Error::PageFault);
+        }
+        Ok(prev as u32)
+    }
+
     /// Writes `len` zeros to the target memory.
     ///
     /// This method attempts to fill up to `len` bytes with zeros. If the available
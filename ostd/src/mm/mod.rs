@@ -14,11 +14,14 @@ pub mod frame;
 pub mod heap;
 mod io;
 pub(crate) mod kspace;
+pub mod numa;
 pub(crate) mod page_prop;
 pub(crate) mod page_table;
 pub mod tlb;
 pub mod vm_space;
 
+#[cfg(ktest)]
+mod bench;
 #[cfg(ktest)]
 mod test;
 
@@ -77,6 +80,12 @@ pub(crate) trait PagingConstsTrait: Clone + Debug + Default + Send + Sync + 'sta
 /// The page size
 pub const PAGE_SIZE: usize = page_size::<PagingConsts>(1);
 
+/// The size of the smallest huge page, i.e., the page size at level 2.
+///
+/// Huge pages of this size can be mapped into the user space with
+/// [`vm_space::CursorMut::map_huge`].
+pub const HUGE_PAGE_SIZE: usize = page_size::<PagingConsts>(2);
+
 /// The page size at a given level.
 pub(crate) const fn page_size<C: PagingConstsTrait>(level: PagingLevel) -> usize {
     C::BASE_PAGE_SIZE << (nr_subpage_per_huge::<C>().ilog2() as usize * (level as usize - 1))
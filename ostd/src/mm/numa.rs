@@ -0,0 +1,421 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! Non-uniform memory access (NUMA) topology.
+//!
+//! On a NUMA machine, the CPUs and the physical memory are grouped into nodes.
+//! A CPU accesses the memory on its own node faster than the memory on the
+//! other nodes. How much slower a remote access is is given by the
+//! [`distance`] between the two nodes.
+//!
+//! The topology is discovered from the firmware (the ACPI SRAT and SLIT on
+//! x86) before the frame allocator is initialized, so that the frame allocator
+//! can keep the free memory of each node apart. If the firmware does not
+//! describe the topology, the whole machine is a single node.
+
+use core::{
+    ops::Range,
+    sync::atomic::{AtomicU32, AtomicUsize, Ordering},
+};
+
+use align_ext::AlignExt;
+use spin::Once;
+
+use crate::{
+    cpu::{CpuId, CpuSet},
+    cpu_local,
+    mm::{Paddr, PAGE_SIZE},
+};
+
+/// The maximum number of NUMA nodes.
+///
+/// The nodes beyond this number are folded into the existing nodes.
+pub const MAX_NODES: usize = 8;
+
+/// The distance from a node to itself.
+pub const LOCAL_DISTANCE: u8 = 10;
+
+/// The distance between two different nodes if the firmware does not tell.
+pub const REMOTE_DISTANCE: u8 = 20;
+
+/// The maximum number of the memory ranges with different affinities.
+const MAX_MEM_RANGES: usize = 32;
+
+/// The maximum number of CPUs with affinities.
+const MAX_CPU_AFFINITIES: usize = 512;
+
+/// The ID of a NUMA node.
+#[derive(Clone, Copy, Debug, PartialEq, Eq, PartialOrd, Ord, Hash)]
+pub struct NodeId(u32);
+
+impl NodeId {
+    /// Creates a node ID, returning `None` if the node does not exist.
+    pub fn new(raw: u32) -> Option<Self> {
+        ((raw as usize) < num_nodes()).then_some(Self(raw))
+    }
+
+    /// Returns the node of the current CPU.
+    ///
+    /// The result may be outdated if the task migrates to another CPU, which
+    /// is fine for choosing where to allocate memory.
+    pub fn current_racy() -> Self {
+        node_of_cpu(crate::cpu::current_cpu_racy())
+    }
+
+    /// Converts the node ID to a `usize`.
+    pub const fn as_usize(self) -> usize {
+        self.0 as usize
+    }
+}
+
+impl From<NodeId> for u32 {
+    fn from(node: NodeId) -> Self {
+        node.0
+    }
+}
+
+/// Returns the number of NUMA nodes.
+///
+/// It is at least one.
+pub fn num_nodes() -> usize {
+    NUMA_INFO.get().map_or(1, |info| info.nr_nodes)
+}
+
+/// Returns an iterator over all NUMA nodes.
+pub fn all_nodes() -> impl Iterator<Item = NodeId> {
+    (0..num_nodes() as u32).map(NodeId)
+}
+
+/// Returns the node that a CPU belongs to.
+pub fn node_of_cpu(cpu: CpuId) -> NodeId {
+    NodeId(CPU_NODE.get_on_cpu(cpu).load(Ordering::Relaxed))
+}
+
+/// Returns the CPUs that belong to a node.
+pub fn cpus_of_node(node: NodeId) -> CpuSet {
+    let mut cpus = CpuSet::new_empty();
+    for cpu in crate::cpu::all_cpus().filter(|cpu| node_of_cpu(*cpu) == node) {
+        cpus.add(cpu);
+    }
+    cpus
+}
+
+/// Returns the number of CPUs that belong to a node.
+///
+/// It is zero for a node with memory but without CPUs.
+pub fn nr_cpus_of_node(node: NodeId) -> usize {
+    NR_CPUS_OF_NODE[node.as_usize()].load(Ordering::Relaxed)
+}
+
+/// Returns the node that a physical address belongs to.
+///
+/// Addresses not described by the firmware belong to the first node.
+pub fn node_of_paddr(paddr: Paddr) -> NodeId {
+    let Some(info) = NUMA_INFO.get() else {
+        return NodeId(0);
+    };
+    info.mem_ranges[..info.nr_mem_ranges]
+        .iter()
+        .find(|range| range.start <= paddr && paddr < range.end)
+        .map_or(NodeId(0), |range| range.node)
+}
+
+/// Returns the end of the memory range that contains `paddr` and belongs to
+/// a single node, clipped to `end`.
+///
+/// It helps to split a memory range that spans multiple nodes.
+pub fn node_range_end(paddr: Paddr, end: Paddr) -> Paddr {
+    let Some(info) = NUMA_INFO.get() else {
+        return end;
+    };
+    let ranges = &info.mem_ranges[..info.nr_mem_ranges];
+    let boundary = match ranges
+        .iter()
+        .find(|range| range.start <= paddr && paddr < range.end)
+    {
+        Some(range) => range.end,
+        // The address belongs to no range, so it extends to the next range.
+        None => ranges
+            .iter()
+            .map(|range| range.start)
+            .filter(|start| *start > paddr)
+            .min()
+            .unwrap_or(end),
+    };
+    boundary.min(end)
+}
+
+/// Returns the distance between two nodes.
+///
+/// The distance from a node to itself is [`LOCAL_DISTANCE`]. Larger distances
+/// mean slower memory accesses.
+pub fn distance(from: NodeId, to: NodeId) -> u8 {
+    match NUMA_INFO.get() {
+        Some(info) => info.distances[from.as_usize()][to.as_usize()],
+        None => LOCAL_DISTANCE,
+    }
+}
+
+/// Returns an iterator over all nodes from the nearest to the farthest to
+/// `node`, starting with `node` itself.
+///
+/// This is the order in which memory should be taken when the memory of
+/// `node` runs out.
+pub fn nodes_by_distance(node: NodeId) -> impl Iterator<Item = NodeId> {
+    let info = NUMA_INFO.get();
+    let nr_nodes = num_nodes();
+    (0..nr_nodes).map(move |i| match info {
+        Some(info) => info.fallbacks[node.as_usize()][i],
+        None => node,
+    })
+}
+
+/// The NUMA topology described by the firmware.
+///
+/// It is built with fixed-size arrays since it is built before the heap is
+/// available.
+pub(crate) struct NumaInfo {
+    /// The firmware's proximity domains of the nodes.
+    domains: [u32; MAX_NODES],
+    nr_nodes: usize,
+    mem_ranges: [MemAffinity; MAX_MEM_RANGES],
+    nr_mem_ranges: usize,
+    cpus: [CpuAffinity; MAX_CPU_AFFINITIES],
+    nr_cpus: usize,
+    distances: [[u8; MAX_NODES]; MAX_NODES],
+    /// The nodes sorted by the distances from each node.
+    fallbacks: [[NodeId; MAX_NODES]; MAX_NODES],
+}
+
+#[derive(Clone, Copy)]
+struct MemAffinity {
+    start: Paddr,
+    end: Paddr,
+    node: NodeId,
+}
+
+#[derive(Clone, Copy)]
+struct CpuAffinity {
+    hw_id: u32,
+    node: NodeId,
+}
+
+impl NumaInfo {
+    /// Creates an empty topology.
+    pub(crate) const fn new() -> Self {
+        let mut distances = [[REMOTE_DISTANCE; MAX_NODES]; MAX_NODES];
+        let mut i = 0;
+        while i < MAX_NODES {
+            distances[i][i] = LOCAL_DISTANCE;
+            i += 1;
+        }
+
+        Self {
+            domains: [0; MAX_NODES],
+            nr_nodes: 0,
+            mem_ranges: [MemAffinity {
+                start: 0,
+                end: 0,
+                node: NodeId(0),
+            }; MAX_MEM_RANGES],
+            nr_mem_ranges: 0,
+            cpus: [CpuAffinity {
+                hw_id: 0,
+                node: NodeId(0),
+            }; MAX_CPU_AFFINITIES],
+            nr_cpus: 0,
+            distances,
+            fallbacks: [[NodeId(0); MAX_NODES]; MAX_NODES],
+        }
+    }
+
+    /// Adds a range of memory that belongs to a proximity domain.
+    pub(crate) fn add_mem_range(&mut self, domain: u32, range: Range<Paddr>) {
+        let node = self.node_of_domain(domain);
+        // The frame allocator splits the memory at the boundaries of the ranges.
+        let range = range.start.align_down(PAGE_SIZE)..range.end.align_down(PAGE_SIZE);
+        if range.is_empty() {
+            return;
+        }
+        if self.nr_mem_ranges == MAX_MEM_RANGES {
+            log::warn!("NUMA: too many memory ranges, ignoring {:#x?}", range);
+            return;
+        }
+        self.mem_ranges[self.nr_mem_ranges] = MemAffinity {
+            start: range.start,
+            end: range.end,
+            node,
+        };
+        self.nr_mem_ranges += 1;
+    }
+
+    /// Adds a CPU that belongs to a proximity domain.
+    ///
+    /// `hw_id` is the ID of the CPU in the firmware tables, which is the
+    /// local APIC ID on x86.
+    pub(crate) fn add_cpu(&mut self, domain: u32, hw_id: u32) {
+        let node = self.node_of_domain(domain);
+        if self.nr_cpus == MAX_CPU_AFFINITIES {
+            log::warn!("NUMA: too many CPUs, ignoring CPU {}", hw_id);
+            return;
+        }
+        self.cpus[self.nr_cpus] = CpuAffinity { hw_id, node };
+        self.nr_cpus += 1;
+    }
+
+    /// Sets the distance between two proximity domains.
+    ///
+    /// Unknown domains are ignored.
+    pub(crate) fn set_distance(&mut self, from_domain: u32, to_domain: u32, distance: u8) {
+        let (Some(from), Some(to)) = (self.find_domain(from_domain), self.find_domain(to_domain))
+        else {
+            return;
+        };
+        // Folded domains may share a node, whose distance to itself is local.
+        if from != to {
+            self.distances[from.as_usize()][to.as_usize()] = distance;
+        }
+    }
+
+    fn find_domain(&self, domain: u32) -> Option<NodeId> {
+        self.domains[..self.nr_nodes]
+            .iter()
+            .position(|d| *d == domain)
+            .map(|i| NodeId(i as u32))
+            .or_else(|| (self.nr_nodes == MAX_NODES).then_some(Self::folded_node(domain)))
+    }
+
+    fn node_of_domain(&mut self, domain: u32) -> NodeId {
+        if let Some(node) = self.find_domain(domain) {
+            return node;
+        }
+        let node = NodeId(self.nr_nodes as u32);
+        self.domains[self.nr_nodes] = domain;
+        self.nr_nodes += 1;
+        node
+    }
+
+    fn folded_node(domain: u32) -> NodeId {
+        NodeId(domain % MAX_NODES as u32)
+    }
+
+    fn compute_fallbacks(&mut self) {
+        for from in 0..self.nr_nodes {
+            let fallbacks = &mut self.fallbacks[from];
+            for (i, node) in fallbacks[..self.nr_nodes].iter_mut().enumerate() {
+                *node = NodeId(i as u32);
+            }
+            // The node itself comes first, then the nearer nodes. Ties are broken
+            // by the node IDs so that the order is deterministic.
+            let distances = &self.distances[from];
+            fallbacks[..self.nr_nodes].sort_unstable_by_key(|node| {
+                (distances[node.as_usize()], node.0 != from as u32, node.0)
+            });
+        }
+    }
+}
+
+static NUMA_INFO: Once<NumaInfo> = Once::new();
+
+static NR_CPUS_OF_NODE: [AtomicUsize; MAX_NODES] = [const { AtomicUsize::new(0) }; MAX_NODES];
+
+cpu_local! {
+    static CPU_NODE: AtomicU32 = AtomicU32::new(0);
+}
+
+/// Discovers the NUMA topology.
+///
+/// It must be called before the frame allocator is initialized, so that the
+/// free memory is added to the right nodes.
+pub(crate) fn init() {
+    let Some(mut info) = crate::arch::parse_numa_info() else {
+        return;
+    };
+    if info.nr_nodes <= 1 {
+        return;
+    }
+    info.compute_fallbacks();
+
+    log::info!("NUMA: {} nodes", info.nr_nodes);
+    for node in 0..info.nr_nodes {
+        log::info!(
+            "NUMA: node {} (domain {}) distances {:?}",
+            node,
+            info.domains[node],
+            &info.distances[node][..info.nr_nodes]
+        );
+    }
+    NUMA_INFO.call_once(|| info);
+}
+
+/// Records the node of the current CPU.
+///
+/// It must be called once on each CPU, after [`init`] and before the CPU
+/// allocates memory.
+pub(crate) fn init_current_cpu() {
+    let node = match NUMA_INFO.get() {
+        Some(info) => {
+            let hw_id = crate::arch::cpu::current_hw_id();
+            info.cpus[..info.nr_cpus]
+                .iter()
+                .find(|cpu| cpu.hw_id == hw_id)
+                .map_or(NodeId(0), |cpu| cpu.node)
+        }
+        None => NodeId(0),
+    };
+
+    let cpu = crate::cpu::current_cpu_racy();
+    CPU_NODE.get_on_cpu(cpu).store(node.0, Ordering::Relaxed);
+    NR_CPUS_OF_NODE[node.as_usize()].fetch_add(1, Ordering::Relaxed);
+}
+
+#[cfg(ktest)]
+mod test {
+    use super::*;
+    use crate::prelude::*;
+
+    #[ktest]
+    fn fallbacks_sorted_by_distance() {
+        let mut info = NumaInfo::new();
+        info.add_mem_range(7, 0..0x1000);
+        info.add_mem_range(3, 0x1000..0x2000);
+        info.add_mem_range(5, 0x2000..0x3000);
+        info.set_distance(7, 3, 30);
+        info.set_distance(7, 5, 20);
+        info.set_distance(3, 7, 30);
+        info.set_distance(3, 5, 15);
+        info.set_distance(5, 7, 20);
+        info.set_distance(5, 3, 15);
+        info.compute_fallbacks();
+
+        let order = |node: usize| {
+            info.fallbacks[node][..3]
+                .iter()
+                .map(|node| node.0)
+                .collect::<Vec<_>>()
+        };
+        assert_eq!(order(0), vec![0, 2, 1]);
+        assert_eq!(order(1), vec![1, 2, 0]);
+        assert_eq!(order(2), vec![2, 1, 0]);
+    }
+
+    #[ktest]
+    fn folded_domains() {
+        let mut info = NumaInfo::new();
+        for domain in 0..MAX_NODES as u32 + 2 {
+            info.add_cpu(domain, domain);
+        }
+        assert_eq!(info.nr_nodes, MAX_NODES);
+        assert_eq!(info.cpus[MAX_NODES].node, NodeId(0));
+        assert_eq!(info.cpus[MAX_NODES + 1].node, NodeId(1));
+    }
+
+    #[ktest]
+    fn single_node_without_firmware() {
+        if NUMA_INFO.get().is_some() {
+            return;
+        }
+        assert_eq!(num_nodes(), 1);
+        assert_eq!(node_of_paddr(0x1234_5000), NodeId(0));
+        assert_eq!(nodes_by_distance(NodeId(0)).count(), 1);
+    }
+}
@@ -65,6 +65,7 @@
 //! table cursor should add additional entry point checks to prevent these defined
 //! behaviors if they are not wanted.
 
+use alloc::vec::Vec;
 use core::{
     any::TypeId, marker::PhantomData, mem::ManuallyDrop, ops::Range, sync::atomic::Ordering,
 };
@@ -73,12 +74,12 @@ use align_ext::AlignExt;
 
 use super::{
     page_size, pte_index, Child, Entry, KernelMode, MapTrackingStatus, PageTable,
-    PageTableEntryTrait, PageTableError, PageTableMode, PageTableNode, PagingConstsTrait,
-    PagingLevel, RawPageTableNode, UserMode,
+    PageTableEntryTrait, PageTableError, PageTableMode, PageTableNode, PageTablePageMeta,
+    PagingConstsTrait, PagingLevel, RawPageTableNode, UserMode,
 };
 use crate::{
     mm::{
-        frame::{meta::AnyFrameMeta, Frame},
+        frame::{meta::AnyFrameMeta, Frame, Segment},
         kspace::should_map_as_tracked,
         paddr_to_vaddr, Paddr, PageProperty, Vaddr,
     },
@@ -215,6 +216,10 @@ impl<'a, M: PageTableMode, E: PageTableEntryTrait, C: PagingConstsTrait> Cursor<
     }
 
     /// Gets the information of the current slot.
+    ///
+    /// A tracked huge page is reported in the granularity of base pages, i.e.,
+    /// the reported page is the frame in the huge page mapped at the current
+    /// virtual address.
     pub fn query(&mut self) -> Result<PageTableItem, PageTableError> {
         if self.va >= self.barrier_va.end {
             return Err(PageTableError::InvalidVaddr(self.va));
@@ -224,7 +229,14 @@ impl<'a, M: PageTableMode, E: PageTableEntryTrait, C: PagingConstsTrait> Cursor<
             let level = self.level;
             let va = self.va;
 
-            match self.cur_entry().to_owned() {
+            let cur_entry = self.cur_entry();
+            if cur_entry.is_huge_frame() {
+                let offset = va - va.align_down(page_size::<C>(level));
+                let (page, prop) = cur_entry.to_owned_frame_in_huge(offset);
+                return Ok(PageTableItem::Mapped { va, page, prop });
+            }
+
+            match cur_entry.to_owned() {
                 Child::PageTable(pt) => {
                     self.push_level(pt.lock());
                     continue;
@@ -238,6 +250,7 @@ impl<'a, M: PageTableMode, E: PageTableEntryTrait, C: PagingConstsTrait> Cursor<
                 Child::Frame(page, prop) => {
                     return Ok(PageTableItem::Mapped { va, page, prop });
                 }
+                Child::HugeFrame(_, _, _) => unreachable!("Already checked"),
                 Child::Untracked(pa, plevel, prop) => {
                     debug_assert_eq!(plevel, level);
                     return Ok(PageTableItem::MappedUntracked {
@@ -264,6 +277,21 @@ impl<'a, M: PageTableMode, E: PageTableEntryTrait, C: PagingConstsTrait> Cursor<
         self.va = next_va;
     }
 
+    /// Traverses forward to the slot next to the one reported by [`Self::query`].
+    ///
+    /// Since a tracked huge page is reported in the granularity of base pages,
+    /// the cursor moves to the next base page if it is in a tracked huge page.
+    /// Otherwise, it is the same as [`Self::move_forward`].
+    pub(in crate::mm) fn move_forward_queried(&mut self) {
+        let page_size = page_size::<C>(self.level);
+        let next_va = self.va + C::BASE_PAGE_SIZE;
+        if next_va % page_size != 0 && self.cur_entry().is_huge_frame() {
+            self.va = next_va;
+        } else {
+            self.move_forward();
+        }
+    }
+
     /// Jumps to the given virtual address.
     /// If the target address is out of the range, this method will return `Err`.
     ///
@@ -345,7 +373,7 @@ impl<M: PageTableMode, E: PageTableEntryTrait, C: PagingConstsTrait> Iterator
     fn next(&mut self) -> Option<Self::Item> {
         let result = self.query();
         if result.is_ok() {
-            self.move_forward();
+            self.move_forward_queried();
         }
         result.ok()
     }
@@ -443,6 +471,10 @@ impl<'a, M: PageTableMode, E: PageTableEntryTrait, C: PagingConstsTrait> CursorM
                 Child::Frame(_, _) => {
                     panic!("Mapping a smaller page in an already mapped huge page");
                 }
+                Child::HugeFrame(_, _, _) => {
+                    let split_child = cur_entry.split_if_huge().unwrap();
+                    self.0.push_level(split_child);
+                }
                 Child::Untracked(_, _, _) => {
                     panic!("Mapping a tracked page in an untracked range");
                 }
@@ -461,10 +493,118 @@ impl<'a, M: PageTableMode, E: PageTableEntryTrait, C: PagingConstsTrait> CursorM
             Child::PageTable(_) => {
                 todo!("Dropping page table nodes while mapping requires TLB flush")
             }
+            Child::HugeFrame(_, _, _) => unreachable!("Mapping a page at the level of huge pages"),
             Child::Untracked(_, _, _) => panic!("Mapping a tracked page in an untracked range"),
         }
     }
 
+    /// Maps the range starting from the current address to a huge page.
+    ///
+    /// The huge page is a [`Segment`] of which the size is the page size of a
+    /// level higher than 1, and the current address must be aligned to the
+    /// size. The huge page is only mapped if there are no mappings in the
+    /// range.
+    ///
+    /// If the range was occupied by an empty page table node, the node is
+    /// removed and returned. It must not be dropped until the TLB entries of
+    /// the range are flushed, since the MMU may still cache it.
+    ///
+    /// It returns the segment back if the huge page cannot be mapped, i.e.,
+    ///  - the size of the segment is not the page size of any level;
+    ///  - the current address is not aligned to the size;
+    ///  - the range is out of the range of the cursor, or the cursor does not
+    ///    hold the lock of the page table node containing the huge page;
+    ///  - there are mappings in the range.
+    ///
+    /// # Safety
+    ///
+    /// The caller should ensure that the virtual range being mapped does
+    /// not affect kernel's memory safety.
+    pub unsafe fn map_huge(
+        &mut self,
+        seg: Segment<dyn AnyFrameMeta>,
+        prop: PageProperty,
+    ) -> Result<Option<Frame<dyn AnyFrameMeta>>, Segment<dyn AnyFrameMeta>> {
+        self.map_huge_inner(seg, prop, true)
+    }
+
+    /// Maps the range starting from the current address to a huge page.
+    ///
+    /// This is the same as [`Self::map_huge`], except that an empty page
+    /// table node occupying the range is only replaced if `replace_empty_node`
+    /// is `true`.
+    ///
+    /// # Safety
+    ///
+    /// The same as [`Self::map_huge`].
+    unsafe fn map_huge_inner(
+        &mut self,
+        seg: Segment<dyn AnyFrameMeta>,
+        prop: PageProperty,
+        replace_empty_node: bool,
+    ) -> Result<Option<Frame<dyn AnyFrameMeta>>, Segment<dyn AnyFrameMeta>> {
+        let size = seg.size();
+        let Some(level) =
+            (2..=C::HIGHEST_TRANSLATION_LEVEL).find(|level| page_size::<C>(*level) == size)
+        else {
+            return Err(seg);
+        };
+        if self.0.va % size != 0
+            || self.0.va + size > self.0.barrier_va.end
+            || self.0.guard_level < level
+        {
+            return Err(seg);
+        }
+        debug_assert!(self.0.should_map_as_tracked());
+
+        // The locked nodes from the guard level to the current level all
+        // contain the current address, so we can go up to the huge page level.
+        while self.0.level < level {
+            self.0.pop_level();
+        }
+        // Go down to the huge page level.
+        while self.0.level > level {
+            let cur_level = self.0.level;
+            let cur_entry = self.0.cur_entry();
+            if cur_entry.is_node() {
+                let Child::PageTable(pt) = cur_entry.to_owned() else {
+                    unreachable!("Already checked");
+                };
+                self.0.push_level(pt.lock());
+            } else if cur_entry.is_none() {
+                let pt = PageTableNode::<E, C>::alloc(cur_level - 1, MapTrackingStatus::Tracked);
+                let _ = cur_entry.replace(Child::PageTable(pt.clone_raw()));
+                self.0.push_level(pt);
+            } else {
+                return Err(seg);
+            }
+        }
+
+        let cur_entry = self.0.cur_entry();
+        if cur_entry.is_node() {
+            let Child::PageTable(pt) = cur_entry.to_owned() else {
+                unreachable!("Already checked");
+            };
+            if !replace_empty_node || pt.lock().nr_children() != 0 {
+                return Err(seg);
+            }
+        } else if !cur_entry.is_none() {
+            return Err(seg);
+        }
+
+        let old = cur_entry.replace(Child::HugeFrame(seg, level, prop));
+        self.0.move_forward();
+
+        match old {
+            Child::None => Ok(None),
+            Child::PageTable(pt) => {
+                let pt: Frame<PageTablePageMeta<E, C>> = pt.into();
+                Ok(Some(pt.into()))
+            }
+            _ => unreachable!("Already checked"),
+        }
+    }
+
     /// Maps the range starting from the current address to a physical address range.
     ///
     /// The function will map as more huge pages as possible, and it will split
@@ -523,11 +663,11 @@ impl<'a, M: PageTableMode, E: PageTableEntryTrait, C: PagingConstsTrait> CursorM
                         let _ = cur_entry.replace(Child::PageTable(pt.clone_raw()));
                         self.0.push_level(pt);
                     }
-                    Child::Frame(_, _) => {
-                        panic!("Mapping a smaller page in an already mapped huge page");
+                    Child::Frame(_, _) | Child::HugeFrame(_, _, _) => {
+                        panic!("Mapping an untracked page in a tracked range");
                     }
                     Child::Untracked(_, _, _) => {
-                        let split_child = cur_entry.split_if_untracked_huge().unwrap();
+                        let split_child = cur_entry.split_if_huge().unwrap();
                         self.0.push_level(split_child);
                     }
                 }
@@ -593,6 +733,14 @@ impl<'a, M: PageTableMode, E: PageTableEntryTrait, C: PagingConstsTrait> CursorM
                 continue;
             }
 
+            // Go down if it maps to a tracked huge page, since the frames in the
+            // huge page are taken one by one.
+            if cur_entry.is_huge_frame() {
+                let split_child = cur_entry.split_if_huge().unwrap();
+                self.0.push_level(split_child);
+                continue;
+            }
+
             // Go down if not applicable or if the entry points to a child page table.
             if cur_entry.is_node()
                 || cur_va % page_size::<C>(cur_level) != 0
@@ -620,8 +768,9 @@ impl<'a, M: PageTableMode, E: PageTableEntryTrait, C: PagingConstsTrait> CursorM
                     Child::Frame(_, _) => {
                         panic!("Removing part of a huge page");
                     }
+                    Child::HugeFrame(_, _, _) => unreachable!("Already checked"),
                     Child::Untracked(_, _, _) => {
-                        let split_child = cur_entry.split_if_untracked_huge().unwrap();
+                        let split_child = cur_entry.split_if_huge().unwrap();
                         self.0.push_level(split_child);
                     }
                 }
@@ -645,7 +794,7 @@ impl<'a, M: PageTableMode, E: PageTableEntryTrait, C: PagingConstsTrait> CursorM
                         prop,
                     }
                 }
-                Child::PageTable(_) | Child::None => unreachable!(),
+                Child::PageTable(_) | Child::HugeFrame(_, _, _) | Child::None => unreachable!(),
             };
 
             self.0.move_forward();
@@ -717,10 +866,10 @@ impl<'a, M: PageTableMode, E: PageTableEntryTrait, C: PagingConstsTrait> CursorM
             }
 
             // Go down if the page size is too big and we are protecting part
-            // of untracked huge pages.
+            // of huge pages.
             if cur_va % page_size::<C>(cur_level) != 0 || cur_va + page_size::<C>(cur_level) > end {
                 let split_child = cur_entry
-                    .split_if_untracked_huge()
+                    .split_if_huge()
                     .expect("Protecting part of a huge page");
                 self.0.push_level(split_child);
                 continue;
@@ -817,7 +966,195 @@ impl<'a, M: PageTableMode, E: PageTableEntryTrait, C: PagingConstsTrait> CursorM
                     debug_assert_eq!(mapped_page_size, page_size::<C>(src.0.level));
                     src.0.move_forward();
                 }
+                Child::HugeFrame(seg, _, mut prop) => {
+                    // Do protection.
+                    src_entry.protect(op);
+
+                    // Do copy. If the huge page cannot be mapped as a whole,
+                    // map the frames in it one by one. Empty page table nodes
+                    // are not replaced since the TLB cannot be flushed here.
+                    op(&mut prop);
+                    self.jump(src_va).unwrap();
+                    if let Err(seg) = self.map_huge_inner(seg, prop, false) {
+                        for page in seg {
+                            let original = self.map(page, prop);
+                            assert!(original.is_none());
+                        }
+                    }
+
+                    src.0.move_forward();
+                }
             }
         }
     }
+
+    /// Moves the mappings in the range from the current address with the
+    /// provided length to the range starting from `dst_va`.
+    ///
+    /// A page table entry is moved as a whole if the source range covers it
+    /// and its destination address is aligned to its size. So a child page
+    /// table node is moved together with all the mappings under it, and the
+    /// cost is proportional to the number of the moved entries rather than
+    /// the number of the mapped pages. The mapped pages are not copied.
+    ///
+    /// The empty page table nodes that occupied the destination range are
+    /// replaced and returned. They must not be dropped until the TLB entries
+    /// of the destination range are flushed, since the MMU may still cache
+    /// them.
+    ///
+    /// After the operation, the cursor is at the end of the source range.
+    ///
+    /// # Safety
+    ///
+    /// The caller should ensure that moving the mappings does not affect
+    /// kernel's memory safety.
+    ///
+    /// # Panics
+    ///
+    /// This function will panic if:
+    ///  - either one of the ranges is out of the range where the cursor is
+    ///    required to operate;
+    ///  - either one of the ranges only covers a part of a page;
+    ///  - the ranges overlap;
+    ///  - the destination range contains mapped pages.
+    pub unsafe fn move_to(&mut self, dst_va: Vaddr, len: usize) -> Vec<Frame<dyn AnyFrameMeta>> {
+        assert!(len % page_size::<C>(1) == 0 && dst_va % page_size::<C>(1) == 0);
+        let src_start = self.0.va;
+        let src_end = src_start + len;
+        assert!(src_end <= self.0.barrier_va.end);
+        assert!(self.0.barrier_va.start <= dst_va && dst_va + len <= self.0.barrier_va.end);
+        assert!(src_end <= dst_va || dst_va + len <= src_start);
+
+        let mut removed_nodes = Vec::new();
+        while self.0.va < src_end {
+            let cur_va = self.0.va;
+            let cur_level = self.0.level;
+            let size = page_size::<C>(cur_level);
+            let cur_entry = self.0.cur_entry();
+
+            // Skip if it is already absent.
+            if cur_entry.is_none() {
+                if cur_va + size > src_end {
+                    self.0.va = src_end;
+                    break;
+                }
+                self.0.move_forward();
+                continue;
+            }
+
+            let dst_cur_va = dst_va + (cur_va - src_start);
+            if cur_va % size == 0 && cur_va + size <= src_end && dst_cur_va % size == 0 {
+                let child = cur_entry.replace(Child::None);
+                let result = self.place_at(dst_cur_va, cur_level, child);
+
+                self.0.jump(cur_va).unwrap();
+                self.go_down_to(cur_level);
+                match result {
+                    Ok(removed_node) => {
+                        removed_nodes.extend(removed_node);
+                        self.0.move_forward();
+                        continue;
+                    }
+                    Err(child) => {
+                        // The destination is occupied by page table nodes
+                        // with children, so the entry is moved piece by piece.
+                        let _ = self.0.cur_entry().replace(child);
+                    }
+                }
+            }
+
+            // Go down since only a part of the entry is moved.
+            let cur_entry = self.0.cur_entry();
+            if cur_entry.is_node() {
+                let Child::PageTable(pt) = cur_entry.to_owned() else {
+                    unreachable!("Already checked");
+                };
+                self.0.push_level(pt.lock());
+            } else {
+                let split_child = cur_entry
+                    .split_if_huge()
+                    .expect("Moving part of a huge page");
+                self.0.push_level(split_child);
+            }
+        }
+
+        removed_nodes
+    }
+
+    /// Places `child` at the entry that maps `va` in the page table node of
+    /// `level`.
+    ///
+    /// The page table nodes on the way are created if they do not exist. If
+    /// the entry is occupied by an empty page table node, the node is
+    /// replaced and returned. If it is occupied by a page table node with
+    /// children, `child` is returned back.
+    ///
+    /// # Panics
+    ///
+    /// This function will panic if `va` is already mapped.
+    fn place_at(
+        &mut self,
+        va: Vaddr,
+        level: PagingLevel,
+        child: Child<E, C>,
+    ) -> Result<Option<Frame<dyn AnyFrameMeta>>, Child<E, C>> {
+        self.0.jump(va).unwrap();
+        // The locked nodes from the guard level to the current level all
+        // contain the address, so we can go up to the level.
+        while self.0.level < level {
+            self.0.pop_level();
+        }
+        while self.0.level > level {
+            let cur_level = self.0.level;
+            let is_tracked = self.0.guards[cur_level as usize - 1]
+                .as_ref()
+                .unwrap()
+                .is_tracked();
+            let cur_entry = self.0.cur_entry();
+            if cur_entry.is_node() {
+                let Child::PageTable(pt) = cur_entry.to_owned() else {
+                    unreachable!("Already checked");
+                };
+                self.0.push_level(pt.lock());
+            } else if cur_entry.is_none() {
+                let pt = PageTableNode::<E, C>::alloc(cur_level - 1, is_tracked);
+                let _ = cur_entry.replace(Child::PageTable(pt.clone_raw()));
+                self.0.push_level(pt);
+            } else {
+                panic!("Moving mappings to a mapped range");
+            }
+        }
+
+        let cur_entry = self.0.cur_entry();
+        if cur_entry.is_node() {
+            let Child::PageTable(pt) = cur_entry.to_owned() else {
+                unreachable!("Already checked");
+            };
+            if pt.lock().nr_children() != 0 {
+                return Err(child);
+            }
+        } else if !cur_entry.is_none() {
+            panic!("Moving mappings to a mapped range");
+        }
+
+        match cur_entry.replace(child) {
+            Child::None => Ok(None),
+            Child::PageTable(pt) => {
+                let pt: Frame<PageTablePageMeta<E, C>> = pt.into();
+                Ok(Some(pt.into()))
+            }
+            _ => unreachable!("Already checked"),
+        }
+    }
+
+    /// Goes down to the page table node of `level` through the existing
+    /// page table nodes.
+    fn go_down_to(&mut self, level: PagingLevel) {
+        while self.0.level > level {
+            let Child::PageTable(pt) = self.0.cur_entry().to_owned() else {
+                panic!("No page table node to go down");
+            };
+            self.0.push_level(pt.lock());
+        }
+    }
 }
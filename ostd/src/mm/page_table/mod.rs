@@ -100,10 +100,14 @@ impl PageTable<UserMode> {
 
     /// Activates the page table with the specified ASID.
     ///
+    /// If `flush` is false, the TLB entries tagged with the ASID are kept.
+    ///
     /// # Safety
     ///
-    /// The user-mode page table is safe to activate since the kernel mappings are shared.
-    pub fn activate_with_asid(&self, asid: u16) {
+    /// The user-mode page table is safe to activate since the kernel mappings are shared. The
+    /// caller must ensure that the TLB entries tagged with the ASID are up-to-date if `flush` is
+    /// false.
+    pub(in crate::mm) unsafe fn activate_with_asid(&self, asid: u16, flush: bool) {
         // If ASID is ASID_FLUSH_REQUIRED, use 0 as actual ASID
         let actual_asid = if asid == crate::mm::asid_allocation::ASID_FLUSH_REQUIRED {
             0
@@ -119,6 +123,9 @@ impl PageTable<UserMode> {
                 self.root.paddr(),
                 actual_asid,
                 root_pt_cache,
+                // ASID 0 is shared by the page tables without their own ASIDs, so its TLB
+                // entries are always flushed.
+                flush || actual_asid == 0,
             );
         }
     }
@@ -8,9 +8,9 @@ use super::{MapTrackingStatus, PageTableEntryTrait, RawPageTableNode};
 use crate::{
     arch::mm::{PageTableEntry, PagingConsts},
     mm::{
-        frame::{inc_frame_ref_count, meta::AnyFrameMeta, Frame},
+        frame::{inc_frame_ref_count, meta::AnyFrameMeta, Frame, Segment},
         page_prop::PageProperty,
-        Paddr, PagingConstsTrait, PagingLevel,
+        page_size, Paddr, PagingConstsTrait, PagingLevel, PAGE_SIZE,
     },
 };
 
@@ -26,6 +26,11 @@ pub(in crate::mm) enum Child<
 > {
     PageTable(RawPageTableNode<E, C>),
     Frame(Frame<dyn AnyFrameMeta>, PageProperty),
+    /// A tracked huge page, which is mapped by a PTE at a level higher than 1.
+    ///
+    /// The segment covers the whole huge page, so the PTE holds a reference
+    /// count to each of the frames in the huge page.
+    HugeFrame(Segment<dyn AnyFrameMeta>, PagingLevel, PageProperty),
     /// Pages not tracked by handles.
     Untracked(Paddr, PagingLevel, PageProperty),
     None,
@@ -51,6 +56,11 @@ impl<E: PageTableEntryTrait, C: PagingConstsTrait> Child<E, C> {
             Child::Frame(p, _) => {
                 node_level == p.level() && is_tracked == MapTrackingStatus::Tracked
             }
+            Child::HugeFrame(seg, level, _) => {
+                node_level == *level
+                    && seg.size() == page_size::<C>(*level)
+                    && is_tracked == MapTrackingStatus::Tracked
+            }
             Child::Untracked(_, level, _) => {
                 node_level == *level && is_tracked == MapTrackingStatus::Untracked
             }
@@ -77,6 +87,7 @@ impl<E: PageTableEntryTrait, C: PagingConstsTrait> Child<E, C> {
                 let level = page.level();
                 E::new_page(page.into_raw(), level, prop)
             }
+            Child::HugeFrame(seg, level, prop) => E::new_page(seg.into_raw().start, level, prop),
             Child::Untracked(pa, level, prop) => E::new_page(pa, level, prop),
             Child::None => E::new_absent(),
         }
@@ -112,6 +123,13 @@ impl<E: PageTableEntryTrait, C: PagingConstsTrait> Child<E, C> {
         }
 
         match is_tracked {
+            MapTrackingStatus::Tracked if level > 1 => {
+                let range = paddr..paddr + page_size::<C>(level);
+                // SAFETY: The physical address range points to a valid huge
+                // page, of which the PTE holds a reference to each frame.
+                let seg = unsafe { Segment::<dyn AnyFrameMeta>::from_raw(range) };
+                Child::HugeFrame(seg, level, pte.prop())
+            }
             MapTrackingStatus::Tracked => {
                 // SAFETY: The physical address points to a valid page.
                 let page = unsafe { Frame::<dyn AnyFrameMeta>::from_raw(paddr) };
@@ -152,6 +170,18 @@ impl<E: PageTableEntryTrait, C: PagingConstsTrait> Child<E, C> {
         }
 
         match is_tracked {
+            MapTrackingStatus::Tracked if level > 1 => {
+                let range = paddr..paddr + page_size::<C>(level);
+                for frame_paddr in range.clone().step_by(PAGE_SIZE) {
+                    // SAFETY: The physical address is valid and the PTE already
+                    // owns the reference to the frame.
+                    unsafe { inc_frame_ref_count(frame_paddr) };
+                }
+                // SAFETY: The physical address range points to a valid huge
+                // page and we have increased the reference count of each frame.
+                let seg = unsafe { Segment::<dyn AnyFrameMeta>::from_raw(range) };
+                Child::HugeFrame(seg, level, pte.prop())
+            }
             MapTrackingStatus::Tracked => {
                 // SAFETY: The physical address is valid and the PTE already owns
                 // the reference to the page.
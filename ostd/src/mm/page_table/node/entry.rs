@@ -2,8 +2,15 @@
 
 //! This module provides accessors to the page table entries in a node.
 
+use core::mem::ManuallyDrop;
+
 use super::{Child, MapTrackingStatus, PageTableEntryTrait, PageTableNode};
-use crate::mm::{nr_subpage_per_huge, page_prop::PageProperty, page_size, PagingConstsTrait};
+use crate::mm::{
+    frame::{inc_frame_ref_count, meta::AnyFrameMeta, Frame, Segment},
+    nr_subpage_per_huge,
+    page_prop::PageProperty,
+    page_size, PagingConstsTrait, PAGE_SIZE,
+};
 
 /// A view of an entry in a page table node.
 ///
@@ -38,6 +45,42 @@ impl<'a, E: PageTableEntryTrait, C: PagingConstsTrait> Entry<'a, E, C> {
         self.pte.is_present() && !self.pte.is_last(self.node.level())
     }
 
+    /// Returns if the entry maps to a tracked huge page.
+    pub(in crate::mm) fn is_huge_frame(&self) -> bool {
+        let level = self.node.level();
+        self.pte.is_present()
+            && level > 1
+            && self.pte.is_last(level)
+            && self.node.is_tracked() == MapTrackingStatus::Tracked
+    }
+
+    /// Gets a owned handle to a frame in the tracked huge page that the entry
+    /// maps to, with the mapping properties of the huge page.
+    ///
+    /// The frame is the one that is `offset` bytes from the start of the huge
+    /// page. This is cheaper than [`Self::to_owned`], which takes a reference
+    /// to each frame in the huge page.
+    ///
+    /// # Panics
+    ///
+    /// The method panics if the entry does not map to a tracked huge page, or
+    /// if the offset is out of the huge page.
+    pub(in crate::mm) fn to_owned_frame_in_huge(
+        &self,
+        offset: usize,
+    ) -> (Frame<dyn AnyFrameMeta>, PageProperty) {
+        assert!(self.is_huge_frame());
+        assert!(offset < page_size::<C>(self.node.level()));
+
+        let paddr = self.pte.paddr() + offset / PAGE_SIZE * PAGE_SIZE;
+        // SAFETY: The physical address is valid and the PTE already owns the
+        // reference to the frame.
+        unsafe { inc_frame_ref_count(paddr) };
+        // SAFETY: The physical address points to a valid frame.
+        let frame = unsafe { Frame::<dyn AnyFrameMeta>::from_raw(paddr) };
+        (frame, self.pte.prop())
+    }
+
     /// Gets a owned handle to the child.
     pub(in crate::mm) fn to_owned(&self) -> Child<E, C> {
         // SAFETY: The entry structure represents an existent entry with the
@@ -102,36 +145,49 @@ impl<'a, E: PageTableEntryTrait, C: PagingConstsTrait> Entry<'a, E, C> {
         old_child
     }
 
-    /// Splits the entry to smaller pages if it maps to a untracked huge page.
+    /// Splits the entry to smaller pages if it maps to a huge page.
     ///
-    /// If the entry does map to a untracked huge page, it is split into smaller
-    /// pages mapped by a child page table node. The new child page table node
-    /// is returned.
+    /// If the entry does map to a huge page, it is split into smaller pages
+    /// mapped by a child page table node. The new child page table node is
+    /// returned. The smaller pages have the same mapping properties as the
+    /// huge page, so the translations of the huge page are not changed.
     ///
-    /// If the entry does not map to a untracked huge page, the method returns
-    /// `None`.
-    pub(in crate::mm) fn split_if_untracked_huge(self) -> Option<PageTableNode<E, C>> {
+    /// If the entry does not map to a huge page, the method returns `None`.
+    pub(in crate::mm) fn split_if_huge(self) -> Option<PageTableNode<E, C>> {
         let level = self.node.level();
+        let is_tracked = self.node.is_tracked();
 
-        if !(self.pte.is_last(level)
-            && level > 1
-            && self.node.is_tracked() == MapTrackingStatus::Untracked)
-        {
+        if !(self.pte.is_last(level) && level > 1 && self.pte.is_present()) {
             return None;
         }
 
         let pa = self.pte.paddr();
         let prop = self.pte.prop();
+        let small_size = page_size::<C>(level - 1);
 
-        let mut new_page = PageTableNode::<E, C>::alloc(level - 1, MapTrackingStatus::Untracked);
+        let mut new_page = PageTableNode::<E, C>::alloc(level - 1, is_tracked);
         for i in 0..nr_subpage_per_huge::<C>() {
-            let small_pa = pa + i * page_size::<C>(level - 1);
-            let _ = new_page
-                .entry(i)
-                .replace(Child::Untracked(small_pa, level - 1, prop));
+            let small_pa = pa + i * small_size;
+            let small_child = if is_tracked != MapTrackingStatus::Tracked {
+                Child::Untracked(small_pa, level - 1, prop)
+            } else if level > 2 {
+                let range = small_pa..small_pa + small_size;
+                // SAFETY: The frames are owned by the huge page, of which the
+                // ownership is transferred to the smaller pages. The huge page
+                // is forgotten below.
+                let seg = unsafe { Segment::<dyn AnyFrameMeta>::from_raw(range) };
+                Child::HugeFrame(seg, level - 1, prop)
+            } else {
+                // SAFETY: The same as above.
+                let frame = unsafe { Frame::<dyn AnyFrameMeta>::from_raw(small_pa) };
+                Child::Frame(frame, prop)
+            };
+            let _ = new_page.entry(i).replace(small_child);
         }
 
-        let _ = self.replace(Child::PageTable(new_page.clone_raw()));
+        let old_child = self.replace(Child::PageTable(new_page.clone_raw()));
+        // The references to the frames have been transferred to the smaller pages.
+        let _ = ManuallyDrop::new(old_child);
 
         Some(new_page)
     }
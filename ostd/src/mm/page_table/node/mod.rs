@@ -36,11 +36,11 @@ use core::{
 };
 
 pub(in crate::mm) use self::{child::Child, entry::Entry};
-use super::{nr_subpage_per_huge, PageTableEntryTrait};
+use super::{nr_subpage_per_huge, page_size, PageTableEntryTrait};
 use crate::{
     arch::mm::{PageTableEntry, PagingConsts},
     mm::{
-        frame::{inc_frame_ref_count, meta::AnyFrameMeta, Frame},
+        frame::{inc_frame_ref_count, meta::AnyFrameMeta, Frame, Segment},
         paddr_to_vaddr,
         page_table::{load_pte, store_pte},
         FrameAllocOptions, Infallible, Paddr, PagingConstsTrait, PagingLevel, VmReader,
@@ -366,6 +366,11 @@ unsafe impl<E: PageTableEntryTrait, C: PagingConstsTrait> AnyFrameMeta for PageT
                     // SAFETY: The PTE points to a page table node. The ownership
                     // of the child is transferred to the child then dropped.
                     drop(unsafe { Frame::<Self>::from_raw(paddr) });
+                } else if is_tracked == MapTrackingStatus::Tracked && level > 1 {
+                    let range = paddr..paddr + page_size::<C>(level);
+                    // SAFETY: The PTE points to a tracked huge page. The ownership
+                    // of the frames is transferred to the segment then dropped.
+                    drop(unsafe { Segment::<dyn AnyFrameMeta>::from_raw(range) });
                 } else if is_tracked == MapTrackingStatus::Tracked {
                     // SAFETY: The PTE points to a tracked page. The ownership
                     // of the child is transferred to the child then dropped.
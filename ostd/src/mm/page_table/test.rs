@@ -697,6 +697,196 @@ mod tracked_mapping {
         // Confirms that the child remains unmapped.
         assert!(child_pt.query(range.start + 10).is_none());
     }
+
+    #[ktest]
+    fn tracked_huge_map_split() {
+        let page_table = setup_page_table::<UserMode>();
+        let huge_size = page_size::<PagingConsts>(2);
+        let range = huge_size..(huge_size * 2);
+        let page_property = PageProperty::new(PageFlags::RW, CachePolicy::Writeback);
+
+        // Allocates and maps a huge page.
+        let segment = FrameAllocOptions::default()
+            .align(huge_size)
+            .alloc_segment(huge_size / PAGE_SIZE)
+            .unwrap();
+        let start_paddr = segment.start_paddr();
+        let old = unsafe {
+            page_table
+                .cursor_mut(&range)
+                .unwrap()
+                .map_huge(segment.into(), page_property)
+                .unwrap()
+        };
+        assert!(old.is_none());
+
+        // Confirms the mapping, which is queried in base pages.
+        assert_eq!(
+            page_table.query(range.start + PAGE_SIZE + 10).unwrap().0,
+            start_paddr + PAGE_SIZE + 10
+        );
+        let mut cursor = page_table.cursor(&range).unwrap();
+        cursor.next().unwrap();
+        let item = cursor.next().unwrap();
+        let PageTableItem::Mapped { va, page, .. } = item else {
+            panic!("Expected `PageTableItem::Mapped`, got {:#x?}", item);
+        };
+        assert_eq!(va, range.start + PAGE_SIZE);
+        assert_eq!(page.start_paddr(), start_paddr + PAGE_SIZE);
+        drop(cursor);
+
+        // Unmaps a part of the huge page, which splits the huge page.
+        let unmapped_item = unsafe { page_table.cursor_mut(&range).unwrap().take_next(PAGE_SIZE) };
+        let PageTableItem::Mapped { va, page, .. } = unmapped_item else {
+            panic!(
+                "Expected `PageTableItem::Mapped`, got {:#x?}",
+                unmapped_item
+            );
+        };
+        assert_eq!(va, range.start);
+        assert_eq!(page.start_paddr(), start_paddr);
+        assert_eq!(page.reference_count(), 1);
+
+        // Confirms that the rest of the huge page remains mapped.
+        assert!(page_table.query(range.start + 10).is_none());
+        assert_eq!(
+            page_table.query(range.end - PAGE_SIZE + 10).unwrap().0,
+            start_paddr + huge_size - PAGE_SIZE + 10
+        );
+    }
+
+    #[ktest]
+    fn tracked_huge_copy_on_write() {
+        let page_table = setup_page_table::<UserMode>();
+        let huge_size = page_size::<PagingConsts>(2);
+        let range = huge_size..(huge_size * 2);
+        let page_property = PageProperty::new(PageFlags::RW, CachePolicy::Writeback);
+
+        let segment = FrameAllocOptions::default()
+            .align(huge_size)
+            .alloc_segment(huge_size / PAGE_SIZE)
+            .unwrap();
+        let start_paddr = segment.start_paddr();
+        unsafe {
+            page_table
+                .cursor_mut(&range)
+                .unwrap()
+                .map_huge(segment.into(), page_property)
+                .unwrap();
+        }
+
+        // Copies the huge page to a child page table.
+        let child_pt = setup_page_table::<UserMode>();
+        {
+            let parent_range = 0..MAX_USERSPACE_VADDR;
+            let mut child_cursor = child_pt.cursor_mut(&parent_range).unwrap();
+            let mut parent_cursor = page_table.cursor_mut(&parent_range).unwrap();
+            unsafe {
+                child_cursor.copy_from(
+                    &mut parent_cursor,
+                    parent_range.len(),
+                    &mut |prop: &mut PageProperty| prop.flags -= PageFlags::W,
+                );
+            }
+        }
+
+        // Both of the page tables map the huge page as read-only.
+        for pt in [&page_table, &child_pt] {
+            let (paddr, prop) = pt.query(range.end - 10).unwrap();
+            assert_eq!(paddr, start_paddr + huge_size - 10);
+            assert_eq!(prop.flags, PageFlags::R);
+        }
+        let item = page_table.cursor(&range).unwrap().query().unwrap();
+        let PageTableItem::Mapped { page, .. } = item else {
+            panic!("Expected `PageTableItem::Mapped`, got {:#x?}", item);
+        };
+        assert_eq!(page.reference_count(), 3);
+
+        // Dropping the child page table releases its references.
+        drop(child_pt);
+        assert_eq!(page.reference_count(), 2);
+    }
+
+    #[ktest]
+    fn tracked_move_mappings() {
+        let page_table = setup_page_table::<UserMode>();
+        let huge_size = page_size::<PagingConsts>(2);
+        let src_range = huge_size..(huge_size * 3);
+        let dst_start = huge_size * 4;
+        let page_property = PageProperty::new(PageFlags::RW, CachePolicy::Writeback);
+
+        // Maps a base page and a huge page in the source range.
+        let frame = FrameAllocOptions::default().alloc_frame().unwrap();
+        let segment = FrameAllocOptions::default()
+            .align(huge_size)
+            .alloc_segment(huge_size / PAGE_SIZE)
+            .unwrap();
+        let seg_paddr = segment.start_paddr();
+        unsafe {
+            let mut cursor = page_table.cursor_mut(&src_range).unwrap();
+            cursor.map(frame.clone().into(), page_property);
+            cursor.jump(src_range.start + huge_size).unwrap();
+            cursor.map_huge(segment.into(), page_property).unwrap();
+        }
+
+        // Moves the mappings to the aligned destination range.
+        let removed_nodes = unsafe {
+            page_table
+                .cursor_mut(&(src_range.start..dst_start + src_range.len()))
+                .unwrap()
+                .move_to(dst_start, src_range.len())
+        };
+        assert!(removed_nodes.is_empty());
+
+        assert!(page_table.query(src_range.start + 10).is_none());
+        assert!(page_table.query(src_range.end - 10).is_none());
+        assert_eq!(
+            page_table.query(dst_start + 10).unwrap().0,
+            frame.start_paddr() + 10
+        );
+        let (paddr, prop) = page_table.query(dst_start + src_range.len() - 10).unwrap();
+        assert_eq!(paddr, seg_paddr + huge_size - 10);
+        assert_eq!(prop.flags, PageFlags::RW);
+        assert_eq!(frame.reference_count(), 2);
+    }
+
+    #[ktest]
+    fn tracked_move_mappings_unaligned() {
+        let page_table = setup_page_table::<UserMode>();
+        let huge_size = page_size::<PagingConsts>(2);
+        let src_range = huge_size..(huge_size * 2);
+        let dst_start = huge_size * 3 + PAGE_SIZE;
+        let page_property = PageProperty::new(PageFlags::RW, CachePolicy::Writeback);
+
+        let segment = FrameAllocOptions::default()
+            .align(huge_size)
+            .alloc_segment(huge_size / PAGE_SIZE)
+            .unwrap();
+        let seg_paddr = segment.start_paddr();
+        unsafe {
+            page_table
+                .cursor_mut(&src_range)
+                .unwrap()
+                .map_huge(segment.into(), page_property)
+                .unwrap();
+        }
+
+        // The huge page cannot be moved as a whole, so it is split.
+        unsafe {
+            let _ = page_table
+                .cursor_mut(&(src_range.start..dst_start + src_range.len()))
+                .unwrap()
+                .move_to(dst_start, src_range.len());
+        }
+
+        assert!(page_table.query(src_range.start + 10).is_none());
+        for offset in [10, huge_size / 2 + 10, huge_size - 10] {
+            assert_eq!(
+                page_table.query(dst_start + offset).unwrap().0,
+                seg_paddr + offset
+            );
+        }
+    }
 }
 
 mod untracked_mapping {
@@ -5,7 +5,7 @@
 use alloc::vec::Vec;
 use core::{
     ops::Range,
-    sync::atomic::{AtomicBool, Ordering},
+    sync::atomic::{AtomicBool, AtomicU64, Ordering},
 };
 
 use super::{
@@ -22,22 +22,39 @@ use crate::{
 /// A TLB flusher that is aware of which CPUs are needed to be flushed.
 ///
 /// The flusher needs to stick to the current CPU.
-pub struct TlbFlusher<G: PinCurrentCpu> {
+///
+/// The flush requests to the remote CPUs are batched: the requests issued
+/// before a dispatch are sent with a single IPI to each CPU, and no more IPIs
+/// are sent to a CPU if a previous IPI to it has not been handled yet, since
+/// the pending IPI will perform all the queued requests. Besides, no requests
+/// are sent to the CPUs in the lazy TLB mode (see [`enter_lazy_tlb`]), which
+/// will flush the TLB entries when they switch back to the address space,
+/// except for the requests that free page table nodes.
+pub struct TlbFlusher<'a, G: PinCurrentCpu> {
     target_cpus: CpuSet,
+    // The TLB generation of the address space to be flushed.
+    tlb_gen: &'a AtomicU64,
+    // The CPUs with the requests that are issued but not dispatched.
+    pending_cpus: CpuSet,
+    // The CPUs with the requests that are dispatched but not synchronized.
+    unsynced_cpus: CpuSet,
     // Better to store them here since loading and counting them from the CPUs
     // list brings non-trivial overhead.
     need_remote_flush: bool,
     need_self_flush: bool,
-    have_unsynced_flush: bool,
     _pin_current: G,
 }
 
-impl<G: PinCurrentCpu> TlbFlusher<G> {
+impl<'a, G: PinCurrentCpu> TlbFlusher<'a, G> {
     /// Creates a new TLB flusher with the specified CPUs to be flushed.
     ///
+    /// The TLB generation of the address space, `tlb_gen`, is increased
+    /// whenever a request is issued, so that the CPUs that are not targeted
+    /// can find their TLB entries stale when they switch to the address space.
+    ///
     /// The flusher needs to stick to the current CPU. So please provide a
     /// guard that implements [`PinCurrentCpu`].
-    pub fn new(target_cpus: CpuSet, pin_current_guard: G) -> Self {
+    pub fn new(target_cpus: CpuSet, tlb_gen: &'a AtomicU64, pin_current_guard: G) -> Self {
         let current_cpu = pin_current_guard.current_cpu();
 
         let mut need_self_flush = false;
@@ -52,9 +69,11 @@ impl<G: PinCurrentCpu> TlbFlusher<G> {
         }
         Self {
             target_cpus,
+            tlb_gen,
+            pending_cpus: CpuSet::new_empty(),
+            unsynced_cpus: CpuSet::new_empty(),
             need_remote_flush,
             need_self_flush,
-            have_unsynced_flush: false,
             _pin_current: pin_current_guard,
         }
     }
@@ -63,9 +82,9 @@ impl<G: PinCurrentCpu> TlbFlusher<G> {
     ///
     /// This function does not guarantee to flush the TLB entries on either
     /// this CPU or remote CPUs. The flush requests are only performed when
-    /// [`Self::dispatch_tlb_flush`] is called.
-    pub fn issue_tlb_flush(&self, op: TlbFlushOp) {
-        self.issue_tlb_flush_(op, None);
+    /// [`Self::dispatch_tlb_flush`] is called, or when the flusher is dropped.
+    pub fn issue_tlb_flush(&mut self, op: TlbFlushOp) {
+        self.issue_tlb_flush_(op, None, false);
     }
 
     /// Dispatches all the pending TLB flush requests.
@@ -75,19 +94,24 @@ impl<G: PinCurrentCpu> TlbFlusher<G> {
     /// synchronous. Upon the return of this function, the TLB entries may not
     /// be coherent.
     pub fn dispatch_tlb_flush(&mut self) {
-        if !self.need_remote_flush {
+        if self.pending_cpus.is_empty() {
             return;
         }
 
-        for cpu in self.target_cpus.iter() {
-            ACK_REMOTE_FLUSH
-                .get_on_cpu(cpu)
-                .store(false, Ordering::Relaxed);
+        let mut ipi_cpus = CpuSet::new_empty();
+        for cpu in self.pending_cpus.iter() {
+            // If an IPI has been sent to the CPU but not handled yet, it will
+            // perform our requests as well. See also `do_remote_flush`.
+            if !IPI_PENDING.get_on_cpu(cpu).swap(true, Ordering::SeqCst) {
+                ipi_cpus.add(cpu);
+            }
+            self.unsynced_cpus.add(cpu);
         }
+        self.pending_cpus.clear();
 
-        crate::smp::inter_processor_call(&self.target_cpus, do_remote_flush);
-
-        self.have_unsynced_flush = true;
+        if !ipi_cpus.is_empty() {
+            crate::smp::inter_processor_call(&ipi_cpus, do_remote_flush);
+        }
     }
 
     /// Waits for all the previous TLB flush requests to be completed.
@@ -106,7 +130,7 @@ impl<G: PinCurrentCpu> TlbFlusher<G> {
     /// processed in IRQs, two CPUs may deadlock if they are waiting for each
     /// other's TLB coherence.
     pub fn sync_tlb_flush(&mut self) {
-        if !self.have_unsynced_flush {
+        if self.unsynced_cpus.is_empty() {
             return;
         }
 
@@ -115,13 +139,13 @@ impl<G: PinCurrentCpu> TlbFlusher<G> {
             "Waiting for remote flush with IRQs disabled"
         );
 
-        for cpu in self.target_cpus.iter() {
+        for cpu in self.unsynced_cpus.iter() {
             while !ACK_REMOTE_FLUSH.get_on_cpu(cpu).load(Ordering::Acquire) {
                 core::hint::spin_loop();
             }
         }
 
-        self.have_unsynced_flush = false;
+        self.unsynced_cpus.clear();
     }
 
     /// Issues a TLB flush request that must happen before dropping the page.
@@ -131,8 +155,28 @@ impl<G: PinCurrentCpu> TlbFlusher<G> {
     /// flushed. Otherwise if the page is recycled for other purposes, the user
     /// space program can still access the page through the TLB entries. This
     /// method is designed to be used in such cases.
-    pub fn issue_tlb_flush_with(&self, op: TlbFlushOp, drop_after_flush: Frame<dyn AnyFrameMeta>) {
-        self.issue_tlb_flush_(op, Some(drop_after_flush));
+    pub fn issue_tlb_flush_with(
+        &mut self,
+        op: TlbFlushOp,
+        drop_after_flush: Frame<dyn AnyFrameMeta>,
+    ) {
+        self.issue_tlb_flush_(op, Some(drop_after_flush), false);
+    }
+
+    /// Issues a TLB flush request that must happen before dropping the page
+    /// table node.
+    ///
+    /// Unlike [`Self::issue_tlb_flush_with`], the request is also sent to the
+    /// CPUs in the lazy TLB mode. They still have the address space activated,
+    /// so the MMU may walk the page table node speculatively and cache it in
+    /// the paging-structure caches, even if the CPU does not access the user
+    /// space. The node can only be recycled after these caches are flushed.
+    pub fn issue_tlb_flush_with_pt_node(
+        &mut self,
+        op: TlbFlushOp,
+        pt_node: Frame<dyn AnyFrameMeta>,
+    ) {
+        self.issue_tlb_flush_(op, Some(pt_node), true);
     }
 
     /// Whether the TLB flusher needs to flush the TLB entries on other CPUs.
@@ -145,9 +189,22 @@ impl<G: PinCurrentCpu> TlbFlusher<G> {
         self.need_self_flush
     }
 
-    fn issue_tlb_flush_(&self, op: TlbFlushOp, drop_after_flush: Option<Frame<dyn AnyFrameMeta>>) {
+    fn issue_tlb_flush_(
+        &mut self,
+        op: TlbFlushOp,
+        drop_after_flush: Option<Frame<dyn AnyFrameMeta>>,
+        include_lazy_cpus: bool,
+    ) {
         let op = op.optimize_for_large_range();
 
+        // The CPUs that are not targeted may still have the stale TLB entries
+        // tagged with the ASID of the address space. This makes them flush
+        // the entries when switching to the address space.
+        //
+        // This must be done before checking the lazy TLB mode. See
+        // `exit_lazy_tlb`.
+        self.tlb_gen.fetch_add(1, Ordering::SeqCst);
+
         // Fast path for single CPU cases.
         if !self.need_remote_flush {
             if self.need_self_flush {
@@ -158,12 +215,30 @@ impl<G: PinCurrentCpu> TlbFlusher<G> {
 
         // Slow path for multi-CPU cases.
         for cpu in self.target_cpus.iter() {
+            if !include_lazy_cpus && LAZY_TLB.get_on_cpu(cpu).load(Ordering::SeqCst) {
+                continue;
+            }
+
             let mut op_queue = FLUSH_OPS.get_on_cpu(cpu).lock();
             op_queue.push(op.clone(), drop_after_flush.clone());
+            ACK_REMOTE_FLUSH
+                .get_on_cpu(cpu)
+                .store(false, Ordering::Relaxed);
+            drop(op_queue);
+
+            self.pending_cpus.add(cpu);
         }
     }
 }
 
+impl<G: PinCurrentCpu> Drop for TlbFlusher<'_, G> {
+    fn drop(&mut self) {
+        // The issued requests must be performed eventually. Otherwise, the
+        // pages to be dropped will never be recycled.
+        self.dispatch_tlb_flush();
+    }
+}
+
 /// The operation to flush TLB entries.
 #[derive(Debug, Clone)]
 pub enum TlbFlushOp {
@@ -205,13 +280,26 @@ impl TlbFlushOp {
 // The queues of pending requests on each CPU.
 cpu_local! {
     static FLUSH_OPS: SpinLock<OpsStack, LocalIrqDisabled> = SpinLock::new(OpsStack::new());
-    /// Whether this CPU finishes the last remote flush request.
+    /// Whether this CPU finishes all the queued remote flush requests.
+    ///
+    /// This is only modified while holding the lock of `FLUSH_OPS`.
     static ACK_REMOTE_FLUSH: AtomicBool = AtomicBool::new(true);
+    /// Whether an IPI to perform the remote flush requests is sent to this CPU
+    /// but not handled yet.
+    static IPI_PENDING: AtomicBool = AtomicBool::new(false);
+    /// Whether this CPU is in the lazy TLB mode.
+    static LAZY_TLB: AtomicBool = AtomicBool::new(false);
 }
 
 fn do_remote_flush() {
     let current_cpu = crate::cpu::current_cpu_racy(); // Safe because we are in IRQs.
 
+    // Clear the flag before taking the requests, so that the requests queued
+    // after this point will be sent with a new IPI.
+    IPI_PENDING
+        .get_on_cpu(current_cpu)
+        .store(false, Ordering::SeqCst);
+
     let mut op_queue = FLUSH_OPS.get_on_cpu(current_cpu).lock();
     op_queue.flush_all();
 
@@ -220,6 +308,32 @@ fn do_remote_flush() {
         .store(true, Ordering::Release);
 }
 
+/// Enters the lazy TLB mode on the current CPU.
+///
+/// This should be called when the CPU switches to a task that does not access
+/// the user space, e.g., a kernel thread. The CPU keeps the last activated
+/// address space, but the TLB flush requests of the address space are not sent
+/// to the CPU until it exits the lazy TLB mode with [`exit_lazy_tlb`].
+pub(crate) fn enter_lazy_tlb(pin_current_guard: &impl PinCurrentCpu) {
+    LAZY_TLB
+        .get_on_cpu(pin_current_guard.current_cpu())
+        .store(true, Ordering::SeqCst);
+}
+
+/// Exits the lazy TLB mode on the current CPU.
+///
+/// It returns whether the CPU was in the lazy TLB mode. If so, the caller must
+/// check the TLB generation of the activated address space, and flush the TLB
+/// entries if they are stale.
+pub(crate) fn exit_lazy_tlb(pin_current_guard: &impl PinCurrentCpu) -> bool {
+    // This pairs with the `SeqCst` operations in `TlbFlusher::issue_tlb_flush_`.
+    // Either the flusher sees that we are not in the lazy TLB mode and sends
+    // the requests to us, or we see its new TLB generation afterward.
+    LAZY_TLB
+        .get_on_cpu(pin_current_guard.current_cpu())
+        .swap(false, Ordering::SeqCst)
+}
+
 /// If a TLB flushing request exceeds this threshold, we flush all.
 pub(crate) const FLUSH_ALL_RANGE_THRESHOLD: usize = 32 * PAGE_SIZE;
 
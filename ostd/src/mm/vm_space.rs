@@ -9,27 +9,29 @@
 //! powerful concurrent accesses to the page table, and suffers from the same
 //! validity concerns as described in [`super::page_table::cursor`].
 
-use core::{ops::Range, sync::atomic::Ordering};
+use core::{
+    ops::Range,
+    sync::atomic::{AtomicU64, Ordering},
+};
 
 use crate::{
     arch::mm::{
-        current_page_table_paddr, invpcid_all_excluding_global, tlb_flush_all_excluding_global,
-        PageTableEntry, PagingConsts,
+        current_page_table_paddr, tlb_flush_all_excluding_global, PageTableEntry, PagingConsts,
     },
     cpu::{AtomicCpuSet, CpuSet, PinCurrentCpu},
     cpu_local_cell,
     mm::{
-        asid_allocation::{self, ASID_FLUSH_REQUIRED},
+        asid_allocation,
         io::Fallible,
         kspace::KERNEL_PAGE_TABLE,
         page_table::{self, PageTable, PageTableItem, UserMode},
-        tlb::{TlbFlushOp, TlbFlusher, FLUSH_ALL_RANGE_THRESHOLD},
-        PageProperty, UFrame, VmReader, VmWriter, MAX_USERSPACE_VADDR,
+        tlb::{self, TlbFlushOp, TlbFlusher, FLUSH_ALL_RANGE_THRESHOLD},
+        PageProperty, UFrame, USegment, VmReader, VmWriter, MAX_USERSPACE_VADDR,
     },
     prelude::*,
     sync::{PreemptDisabled, RwLock, RwLockReadGuard},
     task::{disable_preempt, DisabledPreemptGuard},
-    Error,
+    trap, Error,
 };
 
 /// A virtual address space for user-mode tasks, enabling safe manipulation of user-space memory.
@@ -77,8 +79,16 @@ pub struct VmSpace {
     /// ASID
     asid: u16,
     asid_generation: u16,
+    /// The unique ID, which tells whether the TLB entries tagged with the ASID
+    /// belong to this VM space.
+    id: u64,
+    /// The TLB generation, which is increased whenever the TLB entries may
+    /// become stale.
+    tlb_gen: AtomicU64,
 }
 
+static NEXT_VM_SPACE_ID: AtomicU64 = AtomicU64::new(0);
+
 impl VmSpace {
     /// Creates a new VM address space.
     pub fn new() -> Self {
@@ -88,6 +98,8 @@ impl VmSpace {
             cpus: AtomicCpuSet::new(CpuSet::new_empty()),
             asid: asid_allocation::allocate(),
             asid_generation: asid_allocation::current_generation(),
+            id: NEXT_VM_SPACE_ID.fetch_add(1, Ordering::Relaxed),
+            tlb_gen: AtomicU64::new(0),
         }
     }
 
@@ -121,6 +133,9 @@ impl VmSpace {
             // SAFETY: We have ensured that the page table is not activated on
             // other CPUs and no cursors are alive.
             unsafe { self.pt.clear() };
+            // The other CPUs may still have the stale TLB entries tagged with
+            // our ASID.
+            self.tlb_gen.fetch_add(1, Ordering::SeqCst);
             if cpus_set_is_single_self {
                 tlb_flush_all_excluding_global();
             }
@@ -159,19 +174,35 @@ impl VmSpace {
             CursorMut {
                 pt_cursor,
                 activation_lock,
-                flusher: TlbFlusher::new(self.cpus.load(Ordering::Relaxed), disable_preempt()),
+                flusher: TlbFlusher::new(
+                    self.cpus.load(Ordering::Relaxed),
+                    &self.tlb_gen,
+                    disable_preempt(),
+                ),
             }
         })?)
     }
 
     /// Activates the page table on the current CPU.
+    ///
+    /// This also makes the current CPU exit the lazy TLB mode (see
+    /// [`Self::enter_lazy_tlb`]).
     pub fn activate(self: &Arc<Self>) {
         let preempt_guard = disable_preempt();
         let cpu = preempt_guard.current_cpu();
 
         let last_ptr = ACTIVATED_VM_SPACE.load();
+        let was_lazy = tlb::exit_lazy_tlb(&preempt_guard);
 
         if last_ptr == Arc::as_ptr(self) {
+            // The TLB flush requests were not sent to us in the lazy TLB mode.
+            // So check whether we have missed any.
+            if was_lazy {
+                let tlb_gen = self.tlb_gen.load(Ordering::SeqCst);
+                if !self.switch_asid(tlb_gen) {
+                    tlb_flush_all_excluding_global();
+                }
+            }
             return;
         }
 
@@ -179,15 +210,10 @@ impl VmSpace {
         // we add the CPU to the CPU set.
         let _activation_lock = self.activation_lock.write();
 
-        let current_generation = asid_allocation::current_generation();
-        let need_flush =
-            self.asid == ASID_FLUSH_REQUIRED || self.asid_generation != current_generation;
-
-        if need_flush {
-            unsafe {
-                invpcid_all_excluding_global();
-            }
-        }
+        // Check whether the TLB entries tagged with our ASID on this CPU are
+        // up-to-date. If so, they can be kept after the switch.
+        let tlb_gen = self.tlb_gen.load(Ordering::SeqCst);
+        let need_flush = !self.switch_asid(tlb_gen);
 
         // Record ourselves in the CPU set and the activated VM space pointer.
         self.cpus.add(cpu, Ordering::Relaxed);
@@ -201,7 +227,31 @@ impl VmSpace {
             last.cpus.remove(cpu, Ordering::Relaxed);
         }
 
-        self.pt.activate_with_asid(self.asid);
+        // SAFETY: The TLB entries tagged with our ASID are up-to-date if no
+        // flush is needed, as checked above.
+        unsafe { self.pt.activate_with_asid(self.asid, need_flush) };
+    }
+
+    /// Records that the current CPU switches to our ASID, returning whether
+    /// the TLB entries tagged with it are up-to-date.
+    fn switch_asid(&self, tlb_gen: u64) -> bool {
+        let irq_guard = trap::disable_local();
+        asid_allocation::switch_to(self.asid, self.id, tlb_gen, &irq_guard)
+    }
+
+    /// Makes the current CPU enter the lazy TLB mode.
+    ///
+    /// This should be called when the CPU switches to a task that will not
+    /// access the user space, e.g., a kernel thread. The activated `VmSpace` is
+    /// kept, but the CPU will not be interrupted to flush its TLB entries until
+    /// a `VmSpace` is activated again (see [`Self::activate`]), which flushes
+    /// the stale TLB entries if necessary.
+    ///
+    /// Users must ensure that no user space memory is accessed in the lazy TLB
+    /// mode, since the TLB entries may be stale.
+    pub fn enter_lazy_tlb() {
+        let preempt_guard = disable_preempt();
+        tlb::enter_lazy_tlb(&preempt_guard);
     }
 
     /// Creates a reader to read data from the user space of the current task.
@@ -289,7 +339,7 @@ impl Iterator for Cursor<'_> {
     fn next(&mut self) -> Option<Self::Item> {
         let result = self.query();
         if result.is_ok() {
-            self.0.move_forward();
+            self.0.move_forward_queried();
         }
         result.ok()
     }
@@ -325,10 +375,10 @@ pub struct CursorMut<'a, 'b> {
     activation_lock: RwLockReadGuard<'b, (), PreemptDisabled>,
     // We have a read lock so the CPU set in the flusher is always a superset
     // of actual activated CPUs.
-    flusher: TlbFlusher<DisabledPreemptGuard>,
+    flusher: TlbFlusher<'a, DisabledPreemptGuard>,
 }
 
-impl CursorMut<'_, '_> {
+impl<'a> CursorMut<'a, '_> {
     /// Query about the current slot.
     ///
     /// This is the same as [`Cursor::query`].
@@ -355,7 +405,7 @@ impl CursorMut<'_, '_> {
     }
 
     /// Get the dedicated TLB flusher for this cursor.
-    pub fn flusher(&mut self) -> &mut TlbFlusher<DisabledPreemptGuard> {
+    pub fn flusher(&mut self) -> &mut TlbFlusher<'a, DisabledPreemptGuard> {
         &mut self.flusher
     }
 
@@ -374,6 +424,41 @@ impl CursorMut<'_, '_> {
         }
     }
 
+    /// Map a segment into the current slot as a huge page.
+    ///
+    /// The size of the segment must be the size of a huge page supported by
+    /// the architecture, e.g., 2 MiB on x86-64, and the current address must
+    /// be aligned to the size. The huge page is only mapped if there are no
+    /// mappings in the range. Otherwise, the segment is returned back.
+    ///
+    /// The huge page is split into smaller pages later if only a part of it
+    /// is unmapped, protected, or mapped to other frames.
+    ///
+    /// This method will bring the cursor to the next slot after the
+    /// modification if the huge page is mapped.
+    pub fn map_huge(
+        &mut self,
+        segment: USegment,
+        prop: PageProperty,
+    ) -> core::result::Result<(), USegment> {
+        let start_va = self.virt_addr();
+        let size = segment.size();
+        // SAFETY: It is safe to map untyped memory into the userspace.
+        let old_pt = match unsafe { self.pt_cursor.map_huge(segment.into(), prop) } {
+            Ok(old_pt) => old_pt,
+            Err(segment) => return Err(segment.try_into().unwrap()),
+        };
+
+        if let Some(old_pt) = old_pt {
+            // The empty page table node may still be cached by the MMU.
+            let op = TlbFlushOp::Range(start_va..start_va + size);
+            self.flusher.issue_tlb_flush_with_pt_node(op, old_pt);
+            self.flusher.dispatch_tlb_flush();
+        }
+
+        Ok(())
+    }
+
     /// Clear the mapping starting from the current slot.
     ///
     /// This method will bring the cursor forward by `len` bytes in the virtual
@@ -382,10 +467,12 @@ impl CursorMut<'_, '_> {
     /// Already-absent mappings encountered by the cursor will be skipped. It
     /// is valid to unmap a range that is not mapped.
     ///
-    /// It must issue and dispatch a TLB flush after the operation. Otherwise,
-    /// the memory safety will be compromised. Please call this function less
-    /// to avoid the overhead of TLB flush. Using a large `len` is wiser than
-    /// splitting the operation into multiple small ones.
+    /// It issues TLB flush requests for the unmapped pages, which are
+    /// dispatched by calling [`TlbFlusher::dispatch_tlb_flush`] on
+    /// [`Self::flusher`], or when the cursor is dropped. So the requests of
+    /// consecutive unmaps are batched until then. Please call this function
+    /// less to avoid the overhead of TLB flush. Using a large `len` is wiser
+    /// than splitting the operation into multiple small ones.
     ///
     /// # Panics
     ///
@@ -420,8 +507,40 @@ impl CursorMut<'_, '_> {
         if !self.flusher.need_remote_flush() && tlb_prefer_flush_all {
             self.flusher.issue_tlb_flush(TlbFlushOp::All);
         }
+    }
+
+    /// Moves the mappings starting from the current slot to `dst_va`.
+    ///
+    /// The mapped frames are not copied. Instead, the page table entries are
+    /// moved, at the highest levels possible, so moving a large range takes
+    /// time proportional to the number of the page table nodes rather than
+    /// the number of the pages.
+    ///
+    /// This method will bring the cursor forward by `len` bytes in the virtual
+    /// address space after the modification.
+    ///
+    /// It issues one TLB flush request for the source range, which is
+    /// dispatched in the same way as the requests of [`Self::unmap`].
+    ///
+    /// # Panics
+    ///
+    /// This method will panic if:
+    ///  - either one of the ranges is out of the range of the cursor, or is
+    ///    not page-aligned;
+    ///  - the ranges overlap;
+    ///  - the destination range contains mapped pages.
+    pub fn move_to(&mut self, dst_va: Vaddr, len: usize) {
+        let start_va = self.virt_addr();
+        // SAFETY: The frames are still mapped into the userspace after the move.
+        let removed_nodes = unsafe { self.pt_cursor.move_to(dst_va, len) };
 
-        self.flusher.dispatch_tlb_flush();
+        for node in removed_nodes {
+            // The empty page table nodes may still be cached by the MMU.
+            let op = TlbFlushOp::Range(dst_va..dst_va + len);
+            self.flusher.issue_tlb_flush_with_pt_node(op, node);
+        }
+        self.flusher
+            .issue_tlb_flush(TlbFlushOp::Range(start_va..start_va + len));
     }
 
     /// Applies the operation to the next slot of mapping within the range.
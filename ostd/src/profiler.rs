@@ -0,0 +1,206 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! A sampling profiler.
+//!
+//! Once started, the profiler interrupts each CPU after a fixed number of
+//! cycles and takes a [`Sample`] of what the CPU is doing: the kernel stack,
+//! if the CPU is interrupted in the kernel mode, or the user instruction
+//! pointer otherwise. The kernel stacks are walked with the frame pointers,
+//! so the kernel should be built with `cargo osdk build --frame-pointers`.
+//!
+//! The samples are pushed into per-CPU ring buffers in the interrupt context,
+//! without any locks. A single consumer, e.g., a kernel thread, pops them out
+//! with [`drain`] and exports them. If a ring buffer is full, the new samples
+//! are dropped and counted in [`nr_dropped_samples`].
+
+use core::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+
+use spin::Once;
+
+use crate::{
+    arch::{pmu, trap::is_kernel_interrupted, tsc_freq},
+    cpu::{all_cpus, num_cpus, CpuId, CpuSet, PinCurrentCpu},
+    prelude::*,
+    smp::inter_processor_call,
+    sync::SpinLock,
+    task::Task,
+    trap::{self, IrqLine, TrapFrame},
+    util::spsc_ring::SpscRing,
+    Error,
+};
+
+/// The maximum number of frames that are recorded in a sample.
+pub const MAX_STACK_DEPTH: usize = 32;
+
+/// The maximum sampling frequency in Hz.
+pub const MAX_FREQ: u64 = 100_000;
+
+/// The number of samples that a ring buffer can hold.
+const RING_CAPACITY: usize = 4096;
+
+/// A sample of what a CPU is doing.
+#[derive(Clone, Copy)]
+pub struct Sample {
+    user_ip: Option<Vaddr>,
+    nr_frames: usize,
+    frames: [Vaddr; MAX_STACK_DEPTH],
+}
+
+impl Sample {
+    /// Returns the user instruction pointer if the CPU is interrupted in the user mode.
+    pub fn user_ip(&self) -> Option<Vaddr> {
+        self.user_ip
+    }
+
+    /// Returns the kernel stack, from the innermost frame.
+    ///
+    /// The first address is the interrupted instruction pointer, and the
+    /// others are the return addresses. The stack is empty if the CPU is
+    /// interrupted in the user mode.
+    pub fn kernel_stack(&self) -> &[Vaddr] {
+        &self.frames[..self.nr_frames]
+    }
+}
+
+/// The per-CPU ring buffers of the samples.
+///
+/// The producer of a ring is the PMI handler on the CPU, and the consumer is
+/// whoever holds [`DRAIN_LOCK`].
+static RINGS: Once<Box<[SpscRing<Sample>]>> = Once::new();
+static PROFILER_IRQ: Once<IrqLine> = Once::new();
+static IS_RUNNING: AtomicBool = AtomicBool::new(false);
+static NR_DROPPED_SAMPLES: AtomicU64 = AtomicU64::new(0);
+static DRAIN_LOCK: SpinLock<()> = SpinLock::new(());
+
+/// Starts sampling all the CPUs at `freq` Hz.
+///
+/// The frequency is in the cycles of the CPUs, which are assumed to run at
+/// the TSC frequency, so the idle and the halted CPUs are not sampled.
+///
+/// # Errors
+///
+/// Returns [`Error::NotEnoughResources`] if the CPU has no usable PMU, and
+/// [`Error::InvalidArgs`] if the frequency is out of range or the profiler
+/// is already running.
+pub fn start(freq: u64) -> Result<()> {
+    if freq == 0 || freq > MAX_FREQ {
+        return Err(Error::InvalidArgs);
+    }
+    if !pmu::is_supported() {
+        return Err(Error::NotEnoughResources);
+    }
+
+    PROFILER_IRQ.try_call_once(|| {
+        let mut irq = IrqLine::alloc()?;
+        irq.on_active(handle_pmi);
+        Ok::<_, Error>(irq)
+    })?;
+    RINGS.call_once(|| {
+        (0..num_cpus())
+            .map(|_| SpscRing::new(RING_CAPACITY))
+            .collect()
+    });
+
+    if IS_RUNNING.swap(true, Ordering::AcqRel) {
+        return Err(Error::InvalidArgs);
+    }
+
+    pmu::set_period(tsc_freq() / freq);
+    inter_processor_call(&CpuSet::new_full(), || {
+        let vector = PROFILER_IRQ.get().unwrap().num();
+        // SAFETY: The PMU is supported and the vector is allocated.
+        unsafe { pmu::start_on_current_cpu(vector) };
+    });
+
+    Ok(())
+}
+
+/// Stops sampling.
+///
+/// The samples that have been taken remain in the ring buffers until they are drained.
+pub fn stop() {
+    if !IS_RUNNING.swap(false, Ordering::AcqRel) {
+        return;
+    }
+
+    inter_processor_call(&CpuSet::new_full(), || {
+        // SAFETY: The PMU is supported since the profiler has been started.
+        unsafe { pmu::stop_on_current_cpu() };
+    });
+}
+
+/// Returns whether the profiler is running.
+pub fn is_running() -> bool {
+    IS_RUNNING.load(Ordering::Relaxed)
+}
+
+/// Pops all the samples that have been taken, and calls `f` with each of them
+/// and the CPU on which it is taken.
+///
+/// The samples of a CPU are visited in the order they are taken. `f` must not
+/// sleep, since the samples are drained with a spin lock held.
+pub fn drain(mut f: impl FnMut(CpuId, &Sample)) {
+    let Some(rings) = RINGS.get() else {
+        return;
+    };
+
+    let _guard = DRAIN_LOCK.lock();
+    for cpu in all_cpus() {
+        // SAFETY: The consumers are serialized by `DRAIN_LOCK`.
+        unsafe {
+            rings[cpu.as_usize()].pop_while(|sample| {
+                f(cpu, sample);
+                true
+            })
+        };
+    }
+}
+
+/// Returns the number of the samples that are dropped because the ring buffers are full.
+pub fn nr_dropped_samples() -> u64 {
+    NR_DROPPED_SAMPLES.load(Ordering::Relaxed)
+}
+
+fn handle_pmi(trap_frame: &TrapFrame) {
+    // A PMI may be pending when the profiler is stopped.
+    if !is_running() {
+        return;
+    }
+
+    let irq_guard = trap::disable_local();
+    let vector = PROFILER_IRQ.get().unwrap().num();
+    // SAFETY: The interrupt is raised by the PMU, so the counter is started
+    // with the vector on the current CPU.
+    if !unsafe { pmu::handle_overflow(vector) } {
+        return;
+    }
+
+    let mut sample = Sample {
+        user_ip: None,
+        nr_frames: 0,
+        frames: [0; MAX_STACK_DEPTH],
+    };
+    if !is_kernel_interrupted() {
+        sample.user_ip = Some(trap_frame.rip);
+    } else {
+        sample.nr_frames = match Task::current() {
+            Some(task) => {
+                pmu::walk_kernel_stack(trap_frame, task.kernel_stack_range(), &mut sample.frames)
+            }
+            // The bootstrap stack is not known, so only the instruction pointer is recorded.
+            None => {
+                sample.frames[0] = trap_frame.rip;
+                1
+            }
+        };
+    }
+
+    let ring = &RINGS.get().unwrap()[irq_guard.current_cpu().as_usize()];
+    // SAFETY: The ring of a CPU is only pushed by the PMI handler on the CPU
+    // with the local IRQs disabled.
+    let is_pushed = unsafe { ring.push(sample) };
+
+    if !is_pushed {
+        NR_DROPPED_SAMPLES.fetch_add(1, Ordering::Relaxed);
+    }
+}
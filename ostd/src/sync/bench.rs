@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! Microbenchmarks of the synchronization primitives.
+
+use spin::Once;
+
+use crate::{
+    prelude::*,
+    sync::{LocalIrqDisabled, Mutex, Rcu, RwLock, SpinLock},
+    util::bench::{bench, bench_contended},
+};
+
+const ITERS: usize = 100_000;
+
+mod spin_lock {
+    use super::*;
+
+    #[ktest]
+    fn bench_lock() {
+        let lock = SpinLock::new(0u64);
+        bench("SpinLock::lock", ITERS, || {
+            *lock.lock() += 1;
+        });
+    }
+
+    #[ktest]
+    fn bench_lock_irq_disabled() {
+        let lock = SpinLock::new(0u64);
+        bench("SpinLock::disable_irq().lock", ITERS, || {
+            *lock.disable_irq().lock() += 1;
+        });
+    }
+
+    #[ktest]
+    fn bench_lock_contended() {
+        static LOCK: SpinLock<u64, LocalIrqDisabled> = SpinLock::new(0);
+        bench_contended("SpinLock::disable_irq().lock", ITERS / 10, || {
+            *LOCK.lock() += 1;
+        });
+    }
+}
+
+mod mutex {
+    use super::*;
+
+    // The contended variant is absent since the remote CPUs of
+    // `bench_contended` cannot sleep.
+    #[ktest]
+    fn bench_lock() {
+        let lock = Mutex::new(0u64);
+        bench("Mutex::lock", ITERS, || {
+            *lock.lock() += 1;
+        });
+    }
+}
+
+mod rw_lock {
+    use super::*;
+
+    #[ktest]
+    fn bench_read() {
+        let lock = RwLock::new(0u64);
+        bench("RwLock::read", ITERS, || {
+            core::hint::black_box(*lock.read());
+        });
+    }
+
+    #[ktest]
+    fn bench_read_contended() {
+        static LOCK: RwLock<u64> = RwLock::new(0);
+        bench_contended("RwLock::read", ITERS / 10, || {
+            core::hint::black_box(*LOCK.read());
+        });
+    }
+}
+
+mod rcu {
+    use super::*;
+
+    #[ktest]
+    fn bench_read() {
+        let rcu = Rcu::new(Box::new(0u64));
+        bench("Rcu::read", ITERS, || {
+            core::hint::black_box(**rcu.read().get());
+        });
+    }
+
+    #[ktest]
+    fn bench_update() {
+        let rcu = Rcu::new(Box::new(0u64));
+        bench("Rcu::update", ITERS / 10, || {
+            rcu.update(Box::new(1u64));
+        });
+    }
+
+    #[ktest]
+    fn bench_read_contended() {
+        static RCU: Once<Rcu<Box<u64>>> = Once::new();
+        RCU.call_once(|| Rcu::new(Box::new(0u64)));
+        bench_contended("Rcu::read", ITERS / 10, || {
+            core::hint::black_box(**RCU.get().unwrap().read().get());
+        });
+    }
+}
@@ -2,8 +2,11 @@
 
 //! Useful synchronization primitives.
 
+#[cfg(ktest)]
+mod bench;
 mod guard;
 mod mutex;
+mod owner_spin;
 mod rcu;
 mod rwarc;
 mod rwlock;
@@ -11,11 +14,15 @@ mod rwmutex;
 mod spin;
 mod wait;
 
-pub(crate) use self::rcu::finish_grace_period;
+pub(crate) use self::rcu::{finish_grace_period, rcu_needs_cpu};
 pub use self::{
     guard::{GuardTransfer, LocalIrqDisabled, PreemptDisabled, SpinGuardian, WriteIrqDisabled},
     mutex::{ArcMutexGuard, Mutex, MutexGuard},
-    rcu::{non_null, Rcu, RcuDrop, RcuOption, RcuOptionReadGuard, RcuReadGuard},
+    owner_spin::{lock_contention_stats, LockContentionStats},
+    rcu::{
+        non_null, synchronize_rcu, synchronize_rcu_expedited, Rcu, RcuDrop, RcuOption,
+        RcuOptionReadGuard, RcuReadGuard,
+    },
     rwarc::{RoArc, RwArc},
     rwlock::{
         ArcRwLockReadGuard, ArcRwLockUpgradeableGuard, ArcRwLockWriteGuard, RwLock,
@@ -5,14 +5,22 @@ use core::{
     cell::UnsafeCell,
     fmt,
     ops::{Deref, DerefMut},
-    sync::atomic::{AtomicBool, Ordering},
+    sync::atomic::{AtomicUsize, Ordering},
 };
 
-use super::WaitQueue;
+use super::{
+    owner_spin::{current_owner, OwnerSpin, NO_OWNER},
+    WaitQueue,
+};
 
 /// A mutex with waitqueue.
+///
+/// A task that fails to acquire the mutex spins while the owner is running on another CPU,
+/// and sleeps on the waitqueue otherwise.
 pub struct Mutex<T: ?Sized> {
-    lock: AtomicBool,
+    /// The owner of the mutex, or [`NO_OWNER`] if the mutex is not locked.
+    lock: AtomicUsize,
+    spin: OwnerSpin,
     queue: WaitQueue,
     val: UnsafeCell<T>,
 }
@@ -21,7 +29,8 @@ impl<T> Mutex<T> {
     /// Creates a new mutex.
     pub const fn new(val: T) -> Self {
         Self {
-            lock: AtomicBool::new(false),
+            lock: AtomicUsize::new(NO_OWNER),
+            spin: OwnerSpin::new(),
             queue: WaitQueue::new(),
             val: UnsafeCell::new(val),
         }
@@ -34,7 +43,11 @@ impl<T: ?Sized> Mutex<T> {
     /// This method runs in a block way until the mutex can be acquired.
     #[track_caller]
     pub fn lock(&self) -> MutexGuard<T> {
-        self.queue.wait_until(|| self.try_lock())
+        if let Some(guard) = self.try_lock() {
+            return guard;
+        }
+        self.spin
+            .lock_contended(&self.queue, || self.owner(), || self.try_lock())
     }
 
     /// Acquires the mutex through an [`Arc`].
@@ -45,7 +58,11 @@ impl<T: ?Sized> Mutex<T> {
     /// [`lock`]: Self::lock
     #[track_caller]
     pub fn lock_arc(self: &Arc<Self>) -> ArcMutexGuard<T> {
-        self.queue.wait_until(|| self.try_lock_arc())
+        if let Some(guard) = self.try_lock_arc() {
+            return guard;
+        }
+        self.spin
+            .lock_contended(&self.queue, || self.owner(), || self.try_lock_arc())
     }
 
     /// Tries Acquire the mutex immedidately.
@@ -84,13 +101,27 @@ impl<T: ?Sized> Mutex<T> {
     }
 
     fn acquire_lock(&self) -> bool {
-        self.lock
-            .compare_exchange(false, true, Ordering::Acquire, Ordering::Relaxed)
-            .is_ok()
+        let is_acquired = self
+            .lock
+            .compare_exchange(
+                NO_OWNER,
+                current_owner(),
+                Ordering::Acquire,
+                Ordering::Relaxed,
+            )
+            .is_ok();
+        if is_acquired {
+            self.spin.set_owner_cpu();
+        }
+        is_acquired
     }
 
     fn release_lock(&self) {
-        self.lock.store(false, Ordering::Release);
+        self.lock.store(NO_OWNER, Ordering::Release);
+    }
+
+    fn owner(&self) -> usize {
+        self.lock.load(Ordering::Relaxed)
     }
 }
 
@@ -170,17 +201,28 @@ mod test {
     #[ktest]
     fn test_mutex_try_lock_does_not_unlock() {
         let lock = Mutex::new(0);
-        assert!(!lock.lock.load(Ordering::Relaxed));
+        assert_eq!(lock.lock.load(Ordering::Relaxed), NO_OWNER);
 
         // A successful lock
         let guard1 = lock.lock();
-        assert!(lock.lock.load(Ordering::Relaxed));
+        assert_ne!(lock.lock.load(Ordering::Relaxed), NO_OWNER);
 
         // A failed `try_lock` won't drop the lock
         assert!(lock.try_lock().is_none());
-        assert!(lock.lock.load(Ordering::Relaxed));
+        assert_ne!(lock.lock.load(Ordering::Relaxed), NO_OWNER);
 
         // Ensure the lock is held until here
         drop(guard1);
     }
+
+    #[ktest]
+    fn test_mutex_records_owner() {
+        let lock = Mutex::new(0);
+
+        let guard = lock.lock();
+        assert_eq!(lock.owner(), current_owner());
+
+        drop(guard);
+        assert_eq!(lock.owner(), NO_OWNER);
+    }
 }
@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! Optimistic spinning for the sleeping locks.
+//!
+//! A task that fails to acquire a [`Mutex`] or a [`RwMutex`] spins for a
+//! while before it sleeps, as long as the owner of the lock is running on
+//! another CPU. If the critical section is short, the lock is released before
+//! long and the costs of sleeping and being woken up are saved.
+//!
+//! Only one task spins on a lock at a time, and the others sleep right away.
+//! This serves the same purpose as the MCS queue of spinners in Linux, which
+//! keeps the cache line of the lock from bouncing between the spinners.
+//!
+//! [`Mutex`]: super::Mutex
+//! [`RwMutex`]: super::RwMutex
+
+use core::sync::atomic::{AtomicBool, AtomicU32, AtomicU64, Ordering};
+
+use super::WaitQueue;
+use crate::{
+    cpu::{current_cpu_racy, CpuId},
+    task::{is_running_on, Task},
+};
+
+/// The owner value that means that the lock is not owned by a known task.
+pub(super) const NO_OWNER: usize = 0;
+
+/// The owner value of the locks acquired in the bootstrap context.
+const BOOTSTRAP_OWNER: usize = 1;
+
+/// The maximum number of times that a task checks the lock before it sleeps.
+const MAX_SPIN_COUNT: usize = 1 << 10;
+
+/// Returns the owner value that identifies the current task.
+pub(super) fn current_owner() -> usize {
+    match Task::current() {
+        Some(task) => &*task as *const Task as usize,
+        None => BOOTSTRAP_OWNER,
+    }
+}
+
+/// The spinning state of a sleeping lock.
+pub(super) struct OwnerSpin {
+    /// The CPU on which the owner acquired the lock.
+    owner_cpu: AtomicU32,
+    /// Whether a task is spinning on the lock.
+    has_spinner: AtomicBool,
+}
+
+impl OwnerSpin {
+    pub(super) const fn new() -> Self {
+        Self {
+            owner_cpu: AtomicU32::new(0),
+            has_spinner: AtomicBool::new(false),
+        }
+    }
+
+    /// Records the current CPU as the CPU of the owner.
+    ///
+    /// This method should be called right after the lock is acquired by a writer.
+    pub(super) fn set_owner_cpu(&self) {
+        self.owner_cpu
+            .store(current_cpu_racy().as_usize() as u32, Ordering::Relaxed);
+    }
+
+    /// Acquires the lock after `try_acquire` has failed once.
+    ///
+    /// The method spins while `owner` returns a task that is running, and sleeps on `queue`
+    /// otherwise. `owner` returns [`NO_OWNER`] if the lock is free, or if it is held by readers,
+    /// in which case the method spins until the spin count runs out.
+    #[track_caller]
+    pub(super) fn lock_contended<G, O, F>(&self, queue: &WaitQueue, owner: O, try_acquire: F) -> G
+    where
+        O: Fn() -> usize,
+        F: Fn() -> Option<G>,
+    {
+        STATS.contended.fetch_add(1, Ordering::Relaxed);
+
+        if let Some(guard) = self.spin(owner, &try_acquire) {
+            STATS.spin_acquired.fetch_add(1, Ordering::Relaxed);
+            return guard;
+        }
+
+        STATS.blocked.fetch_add(1, Ordering::Relaxed);
+        queue.wait_until(try_acquire)
+    }
+
+    fn spin<G, O, F>(&self, owner: O, try_acquire: &F) -> Option<G>
+    where
+        O: Fn() -> usize,
+        F: Fn() -> Option<G>,
+    {
+        if self.has_spinner.swap(true, Ordering::Acquire) {
+            return None;
+        }
+
+        let mut result = None;
+        for _ in 0..MAX_SPIN_COUNT {
+            if let Some(guard) = try_acquire() {
+                result = Some(guard);
+                break;
+            }
+            if !self.is_owner_running(owner()) {
+                break;
+            }
+            core::hint::spin_loop();
+        }
+
+        self.has_spinner.store(false, Ordering::Release);
+        result
+    }
+
+    fn is_owner_running(&self, owner: usize) -> bool {
+        match owner {
+            NO_OWNER | BOOTSTRAP_OWNER => true,
+            owner => {
+                let Ok(cpu) = CpuId::try_from(self.owner_cpu.load(Ordering::Relaxed) as usize)
+                else {
+                    return false;
+                };
+                is_running_on(owner as *const Task, cpu)
+            }
+        }
+    }
+}
+
+/// The statistics of the contention on the sleeping locks.
+///
+/// The statistics are accumulated over all the [`Mutex`]es and [`RwMutex`]es.
+///
+/// [`Mutex`]: super::Mutex
+/// [`RwMutex`]: super::RwMutex
+#[derive(Debug, Clone, Copy, Default)]
+pub struct LockContentionStats {
+    /// The number of lock acquisitions that found the lock held.
+    pub contended: u64,
+    /// The number of contended acquisitions that succeeded by spinning.
+    pub spin_acquired: u64,
+    /// The number of contended acquisitions that waited in the wait queue.
+    pub blocked: u64,
+}
+
+struct AtomicLockContentionStats {
+    contended: AtomicU64,
+    spin_acquired: AtomicU64,
+    blocked: AtomicU64,
+}
+
+static STATS: AtomicLockContentionStats = AtomicLockContentionStats {
+    contended: AtomicU64::new(0),
+    spin_acquired: AtomicU64::new(0),
+    blocked: AtomicU64::new(0),
+};
+
+/// Returns the statistics of the contention on the sleeping locks.
+pub fn lock_contention_stats() -> LockContentionStats {
+    LockContentionStats {
+        contended: STATS.contended.load(Ordering::Relaxed),
+        spin_acquired: STATS.spin_acquired.load(Ordering::Relaxed),
+        blocked: STATS.blocked.load(Ordering::Relaxed),
+    }
+}
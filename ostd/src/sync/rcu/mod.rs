@@ -17,7 +17,10 @@ use non_null::NonNullPtr;
 use spin::once::Once;
 
 use self::monitor::RcuMonitor;
-use crate::task::{atomic_mode::AsAtomicModeGuard, disable_preempt, DisabledPreemptGuard};
+use crate::{
+    cpu::CpuId,
+    task::{atomic_mode::AsAtomicModeGuard, disable_preempt, DisabledPreemptGuard},
+};
 
 mod monitor;
 pub mod non_null;
@@ -500,6 +503,36 @@ pub unsafe fn finish_grace_period() {
     }
 }
 
+/// Returns whether RCU needs the CPU to keep ticking.
+///
+/// A CPU must not stop its tick if it has not passed a quiescent state in the
+/// current grace period or if it has callbacks that wait for a grace period.
+/// Otherwise, the CPU is reported as quiescent by the new grace periods that
+/// start while its tick is stopped.
+pub(crate) fn rcu_needs_cpu(cpu: CpuId) -> bool {
+    RCU_MONITOR
+        .get()
+        .is_some_and(|rcu_monitor| rcu_monitor.needs_cpu(cpu))
+}
+
+/// Waits until all the RCU read-side critical sections in progress complete.
+///
+/// The function sleeps until a full grace period has passed, so it must not be
+/// called in atomic mode.
+pub fn synchronize_rcu() {
+    RCU_MONITOR.get().unwrap().synchronize(false);
+}
+
+/// Waits until all the RCU read-side critical sections in progress complete,
+/// with a lower latency than [`synchronize_rcu`].
+///
+/// Instead of waiting for the other CPUs to reschedule by themselves, the
+/// function sends them IPIs to make them pass quiescent states. This disturbs
+/// all the CPUs, so it should be reserved for latency-critical updaters.
+pub fn synchronize_rcu_expedited() {
+    RCU_MONITOR.get().unwrap().synchronize(true);
+}
+
 static RCU_MONITOR: Once<RcuMonitor> = Once::new();
 
 pub fn init() {
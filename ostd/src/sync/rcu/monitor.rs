@@ -1,22 +1,57 @@
 // SPDX-License-Identifier: MPL-2.0
 
 use alloc::collections::VecDeque;
-use core::sync::atomic::{
-    AtomicBool,
-    Ordering::{self, Relaxed},
+use core::{
+    cell::RefCell,
+    sync::atomic::{
+        fence, AtomicBool, AtomicU64, AtomicUsize,
+        Ordering::{self, Acquire, Relaxed, Release, SeqCst},
+    },
 };
 
 use crate::{
     cpu::{AtomicCpuSet, CpuId, CpuSet, PinCurrentCpu},
+    cpu_local,
     prelude::*,
-    sync::SpinLock,
-    task::atomic_mode::AsAtomicModeGuard,
+    sync::{SpinLock, WaitQueue},
+    task::scheduler,
+    timer, trap,
 };
 
+/// The number of callbacks that a CPU queues locally before it hands them
+/// over to the global state.
+const LOCAL_BATCH_SIZE: usize = 64;
+
+/// The number of pending callbacks above which the CPUs are forced to pass
+/// quiescent states, so that the memory held by the callbacks is bounded.
+const FORCE_QS_THRESHOLD: usize = 10_000;
+
+cpu_local! {
+    /// The callbacks that are queued on a CPU but not yet handed over to the
+    /// global state.
+    static LOCAL_CALLBACKS: RefCell<Callbacks> = RefCell::new(VecDeque::new());
+    /// The sequence number of the last grace period in which the CPU has
+    /// passed a quiescent state.
+    static REPORTED_GP_SEQ: AtomicU64 = AtomicU64::new(0);
+}
+
 /// A RCU monitor ensures the completion of _grace periods_ by keeping track
 /// of each CPU's passing _quiescent states_.
+///
+/// The callbacks are first queued on the local CPU. They are handed over to
+/// the global state in batches, i.e., when a CPU has queued enough of them,
+/// when no grace period is in progress, or when the CPU passes a quiescent
+/// state. This keeps the global lock off the path of most of the updates.
 pub struct RcuMonitor {
     is_monitoring: AtomicBool,
+    /// The sequence number of the current grace period.
+    gp_seq: AtomicU64,
+    /// The number of the callbacks that have not been invoked.
+    nr_pending: AtomicUsize,
+    /// The number of the expedited waiters.
+    nr_expedited: AtomicUsize,
+    /// The CPUs that have local callbacks.
+    cpus_with_callbacks: AtomicCpuSet,
     state: SpinLock<State>,
 }
 
@@ -28,44 +63,69 @@ impl RcuMonitor {
     pub fn new() -> Self {
         Self {
             is_monitoring: AtomicBool::new(false),
+            gp_seq: AtomicU64::new(0),
+            nr_pending: AtomicUsize::new(0),
+            nr_expedited: AtomicUsize::new(0),
+            cpus_with_callbacks: AtomicCpuSet::new(CpuSet::new_empty()),
             state: SpinLock::new(State::new()),
         }
     }
 
     pub(super) unsafe fn finish_grace_period(&self) {
+        let irq_guard = trap::disable_local();
+        let cpu = irq_guard.current_cpu();
+
         // Fast path
-        if !self.is_monitoring.load(Relaxed) {
+        let has_local_callbacks = self.cpus_with_callbacks.contains(cpu, Relaxed);
+        if !has_local_callbacks && !self.needs_report(cpu) {
             return;
         }
 
         // Check if the current GP is complete after passing the quiescent state
         // on the current CPU. If GP is complete, take the callbacks of the current
         // GP.
+        let mut force_targets = None;
         let callbacks = {
             let mut state = self.state.disable_irq().lock();
-            let cpu = state.as_atomic_mode_guard().current_cpu();
-            if state.current_gp.is_complete() {
-                return;
+            if has_local_callbacks {
+                self.flush_local_callbacks(&mut state, &irq_guard);
+                if state.current_gp.is_complete() {
+                    force_targets = self.start_grace_period(&mut state, cpu);
+                }
             }
 
-            state.current_gp.finish_grace_period(cpu);
-            if !state.current_gp.is_complete() {
-                return;
+            let gp_seq = self.gp_seq.load(Relaxed);
+            let reported_gp_seq = REPORTED_GP_SEQ.get_on_cpu(cpu);
+            if !state.current_gp.is_complete() && reported_gp_seq.load(Relaxed) != gp_seq {
+                reported_gp_seq.store(gp_seq, Relaxed);
+                state.current_gp.finish_grace_period(cpu);
             }
+            if !state.current_gp.is_complete() {
+                Callbacks::new()
+            } else {
+                // Now that the current GP is complete, take its callbacks
+                let current_callbacks = state.current_gp.take_callbacks();
+                self.nr_pending.fetch_sub(current_callbacks.len(), Relaxed);
 
-            // Now that the current GP is complete, take its callbacks
-            let current_callbacks = state.current_gp.take_callbacks();
+                // Check if we need to watch for a next GP. The local callbacks of
+                // other CPUs are handed over when they pass the quiescent states.
+                force_targets = if !state.next_callbacks.is_empty()
+                    || !self.cpus_with_callbacks.load(Relaxed).is_empty()
+                {
+                    self.start_grace_period(&mut state, cpu)
+                } else {
+                    self.is_monitoring.store(false, Relaxed);
+                    None
+                };
 
-            // Check if we need to watch for a next GP
-            if !state.next_callbacks.is_empty() {
-                let callbacks = core::mem::take(&mut state.next_callbacks);
-                state.current_gp.restart(callbacks);
-            } else {
-                self.is_monitoring.store(false, Relaxed);
+                current_callbacks
             }
-
-            current_callbacks
         };
+        drop(irq_guard);
+
+        if let Some(targets) = force_targets {
+            scheduler::preempt_cpus(&targets);
+        }
 
         // Invoke the callbacks to notify the completion of GP
         for f in callbacks {
@@ -77,23 +137,169 @@ impl RcuMonitor {
     where
         F: FnOnce() + Send + 'static,
     {
-        let mut state = self.state.disable_irq().lock();
+        let irq_guard = trap::disable_local();
+        let cpu = irq_guard.current_cpu();
 
-        state.next_callbacks.push_back(Box::new(f));
+        let nr_local = {
+            let mut local_callbacks = LOCAL_CALLBACKS.get_with(&irq_guard).borrow_mut();
+            local_callbacks.push_back(Box::new(f));
+            local_callbacks.len()
+        };
+        self.cpus_with_callbacks.add(cpu, Relaxed);
+        let nr_pending = self.nr_pending.fetch_add(1, Relaxed) + 1;
 
-        if !state.current_gp.is_complete() {
+        if nr_local < LOCAL_BATCH_SIZE && self.is_monitoring.load(Relaxed) {
             return;
         }
 
+        let force_targets = {
+            let mut state = self.state.disable_irq().lock();
+            self.flush_local_callbacks(&mut state, &irq_guard);
+
+            if state.current_gp.is_complete() {
+                self.start_grace_period(&mut state, cpu)
+            } else if nr_pending >= FORCE_QS_THRESHOLD && !state.is_forced {
+                state.is_forced = true;
+                Some(self.unreported_cpus(&state, cpu))
+            } else {
+                None
+            }
+        };
+        drop(irq_guard);
+
+        if let Some(targets) = force_targets {
+            scheduler::preempt_cpus(&targets);
+        }
+    }
+
+    /// Waits until a full grace period has passed.
+    ///
+    /// If `is_expedited` is true, the other CPUs are forced to pass quiescent
+    /// states instead of being waited for until they reschedule by themselves.
+    pub(super) fn synchronize(&self, is_expedited: bool) {
+        let completion = Arc::new(Completion {
+            is_done: AtomicBool::new(false),
+            wait_queue: WaitQueue::new(),
+        });
+
+        if is_expedited {
+            self.nr_expedited.fetch_add(1, Relaxed);
+        }
+
+        let force_targets = {
+            let irq_guard = trap::disable_local();
+            let cpu = irq_guard.current_cpu();
+
+            let mut state = self.state.disable_irq().lock();
+            // The callback bypasses the local list to be waited for by the
+            // next grace period right away.
+            let completion = completion.clone();
+            state.next_callbacks.push_back(Box::new(move || {
+                completion.is_done.store(true, Release);
+                completion.wait_queue.wake_all();
+            }));
+            self.nr_pending.fetch_add(1, Relaxed);
+
+            if state.current_gp.is_complete() {
+                self.start_grace_period(&mut state, cpu)
+            } else if is_expedited {
+                state.is_forced = true;
+                Some(self.unreported_cpus(&state, cpu))
+            } else {
+                None
+            }
+        };
+
+        if let Some(targets) = force_targets {
+            scheduler::preempt_cpus(&targets);
+        }
+
+        // The current CPU passes its quiescent state when it goes to sleep.
+        completion
+            .wait_queue
+            .wait_until(|| completion.is_done.load(Acquire).then_some(()));
+
+        if is_expedited {
+            self.nr_expedited.fetch_sub(1, Relaxed);
+        }
+    }
+
+    /// Returns whether the CPU has to pass a quiescent state or has local
+    /// callbacks, in which case its tick must not be stopped.
+    pub(super) fn needs_cpu(&self, cpu: CpuId) -> bool {
+        self.cpus_with_callbacks.contains(cpu, Relaxed) || self.needs_report(cpu)
+    }
+
+    /// Returns whether the CPU has not passed a quiescent state in the current GP.
+    fn needs_report(&self, cpu: CpuId) -> bool {
+        self.is_monitoring.load(Relaxed)
+            && REPORTED_GP_SEQ.get_on_cpu(cpu).load(Relaxed) != self.gp_seq.load(Acquire)
+    }
+
+    /// Hands over the local callbacks of the current CPU to the next GP.
+    fn flush_local_callbacks(&self, state: &mut State, irq_guard: &trap::DisabledLocalIrqGuard) {
+        let cpu = irq_guard.current_cpu();
+        self.cpus_with_callbacks.remove(cpu, Relaxed);
+
+        let mut local_callbacks = LOCAL_CALLBACKS.get_with(irq_guard).borrow_mut();
+        state.next_callbacks.append(&mut local_callbacks);
+    }
+
+    /// Starts a new GP that waits for the next callbacks.
+    ///
+    /// Returns the CPUs to be forced to pass quiescent states, if there are
+    /// too many pending callbacks or there are expedited waiters.
+    fn start_grace_period(&self, state: &mut State, this_cpu: CpuId) -> Option<CpuSet> {
         let callbacks = core::mem::take(&mut state.next_callbacks);
         state.current_gp.restart(callbacks);
+        let gp_seq = self.gp_seq.fetch_add(1, Release) + 1;
         self.is_monitoring.store(true, Relaxed);
+
+        // The CPUs whose ticks are stopped are idle, so they are not in any
+        // read-side critical sections. They have checked that they need not
+        // report before stopping the tick, which is ordered with the above
+        // `gp_seq` update by the fences.
+        fence(SeqCst);
+        for cpu in timer::tick_stopped_cpus().iter() {
+            if cpu != this_cpu {
+                REPORTED_GP_SEQ.get_on_cpu(cpu).store(gp_seq, Relaxed);
+                // SAFETY: The CPU is not in any read-side critical sections.
+                unsafe { state.current_gp.finish_grace_period(cpu) };
+            }
+        }
+
+        state.is_forced = self.nr_pending.load(Relaxed) >= FORCE_QS_THRESHOLD
+            || self.nr_expedited.load(Relaxed) > 0;
+        state
+            .is_forced
+            .then(|| self.unreported_cpus(state, this_cpu))
     }
+
+    /// Returns the other CPUs that have not passed quiescent states in the current GP.
+    fn unreported_cpus(&self, state: &State, this_cpu: CpuId) -> CpuSet {
+        let reported = state.current_gp.cpu_mask.load(Relaxed);
+
+        let mut targets = CpuSet::new_empty();
+        for cpu in CpuSet::new_full().iter() {
+            if cpu != this_cpu && !reported.contains(cpu) {
+                targets.add(cpu);
+            }
+        }
+        targets
+    }
+}
+
+struct Completion {
+    is_done: AtomicBool,
+    wait_queue: WaitQueue,
 }
 
 struct State {
     current_gp: GracePeriod,
     next_callbacks: Callbacks,
+    /// Whether the CPUs have been forced to pass quiescent states in the
+    /// current GP.
+    is_forced: bool,
 }
 
 impl State {
@@ -101,6 +307,7 @@ impl State {
         Self {
             current_gp: GracePeriod::new(),
             next_callbacks: VecDeque::new(),
+            is_forced: false,
         }
     }
 }
@@ -11,7 +11,10 @@ use core::{
     },
 };
 
-use super::WaitQueue;
+use super::{
+    owner_spin::{current_owner, OwnerSpin, NO_OWNER},
+    WaitQueue,
+};
 
 /// A mutex that provides data access to either one writer or many readers.
 ///
@@ -25,7 +28,8 @@ use super::WaitQueue;
 /// The writing and reading portions cannot be active simultaneously, when
 /// one portion is in progress, the other portion will sleep. This is
 /// suitable for scenarios where the mutex is expected to be held for a
-/// period of time, which can avoid wasting CPU resources.
+/// period of time, which can avoid wasting CPU resources. Before sleeping,
+/// a task spins for a short while if the writer is running on another CPU.
 ///
 /// This implementation provides the upgradeable read mutex (`upread mutex`).
 /// The `upread mutex` can be upgraded to write mutex atomically, useful in
@@ -92,6 +96,9 @@ pub struct RwMutex<T: ?Sized> {
     /// - **Bit 61:** Indicates if an upgradeable reader is being upgraded.
     /// - **Bits 60-0:** Reader mutex count.
     lock: AtomicUsize,
+    /// The writer that holds the mutex, or [`NO_OWNER`] if there is none.
+    owner: AtomicUsize,
+    spin: OwnerSpin,
     /// Threads that fail to acquire the mutex will sleep on this waitqueue.
     queue: WaitQueue,
     val: UnsafeCell<T>,
@@ -109,6 +116,8 @@ impl<T> RwMutex<T> {
         Self {
             val: UnsafeCell::new(val),
             lock: AtomicUsize::new(0),
+            owner: AtomicUsize::new(NO_OWNER),
+            spin: OwnerSpin::new(),
             queue: WaitQueue::new(),
         }
     }
@@ -123,7 +132,11 @@ impl<T: ?Sized> RwMutex<T> {
     /// will acquire the mutex.
     #[track_caller]
     pub fn read(&self) -> RwMutexReadGuard<T> {
-        self.queue.wait_until(|| self.try_read())
+        if let Some(guard) = self.try_read() {
+            return guard;
+        }
+        self.spin
+            .lock_contended(&self.queue, || self.owner(), || self.try_read())
     }
 
     /// Acquires a write mutex and sleep until it can be acquired.
@@ -134,7 +147,11 @@ impl<T: ?Sized> RwMutex<T> {
     /// will acquire the mutex.
     #[track_caller]
     pub fn write(&self) -> RwMutexWriteGuard<T> {
-        self.queue.wait_until(|| self.try_write())
+        if let Some(guard) = self.try_write() {
+            return guard;
+        }
+        self.spin
+            .lock_contended(&self.queue, || self.owner(), || self.try_write())
     }
 
     /// Acquires a upread mutex and sleep until it can be acquired.
@@ -149,7 +166,11 @@ impl<T: ?Sized> RwMutex<T> {
     /// upgread method.
     #[track_caller]
     pub fn upread(&self) -> RwMutexUpgradeableGuard<T> {
-        self.queue.wait_until(|| self.try_upread())
+        if let Some(guard) = self.try_upread() {
+            return guard;
+        }
+        self.spin
+            .lock_contended(&self.queue, || self.owner(), || self.try_upread())
     }
 
     /// Attempts to acquire a read mutex.
@@ -174,6 +195,7 @@ impl<T: ?Sized> RwMutex<T> {
             .compare_exchange(0, WRITER, Acquire, Relaxed)
             .is_ok()
         {
+            self.set_owner();
             Some(RwMutexWriteGuard { inner: self })
         } else {
             None
@@ -200,6 +222,15 @@ impl<T: ?Sized> RwMutex<T> {
     pub fn get_mut(&mut self) -> &mut T {
         self.val.get_mut()
     }
+
+    fn set_owner(&self) {
+        self.owner.store(current_owner(), Relaxed);
+        self.spin.set_owner_cpu();
+    }
+
+    fn owner(&self) -> usize {
+        self.owner.load(Relaxed)
+    }
 }
 
 impl<T: ?Sized + fmt::Debug> fmt::Debug for RwMutex<T> {
@@ -316,6 +347,7 @@ impl<T: ?Sized, R: Deref<Target = RwMutex<T>>> DerefMut for RwMutexWriteGuard_<T
 
 impl<T: ?Sized, R: Deref<Target = RwMutex<T>>> Drop for RwMutexWriteGuard_<T, R> {
     fn drop(&mut self) {
+        self.inner.owner.store(NO_OWNER, Relaxed);
         self.inner.lock.fetch_and(!WRITER, Release);
 
         // When the current writer releases, wake up all the sleeping threads.
@@ -368,6 +400,7 @@ impl<T: ?Sized, R: Deref<Target = RwMutex<T>> + Clone> RwMutexUpgradeableGuard_<
             Relaxed,
         );
         if res.is_ok() {
+            self.inner.set_owner();
             let inner = self.inner.clone();
             drop(self);
             Ok(RwMutexWriteGuard_ { inner })
@@ -1,7 +1,12 @@
 // SPDX-License-Identifier: MPL-2.0
 
 use alloc::{collections::VecDeque, sync::Arc};
-use core::sync::atomic::{AtomicBool, AtomicU32, Ordering};
+use core::{
+    ptr::NonNull,
+    sync::atomic::{AtomicBool, AtomicU32, Ordering},
+};
+
+use smallvec::SmallVec;
 
 use super::{LocalIrqDisabled, SpinLock};
 use crate::task::{scheduler, Task};
@@ -43,9 +48,56 @@ use crate::task::{scheduler, Task};
 pub struct WaitQueue {
     // A copy of `wakers.len()`, used for the lock-free fast path in `wake_one` and `wake_all`.
     num_wakers: AtomicU32,
-    wakers: SpinLock<VecDeque<Arc<Waker>>, LocalIrqDisabled>,
+    wakers: SpinLock<VecDeque<WaitEntry>, LocalIrqDisabled>,
+}
+
+/// An entry of a [`WaitQueue`].
+enum WaitEntry {
+    /// A waker enqueued by [`WaitQueue::enqueue`].
+    Waker(Arc<Waker>),
+    /// A waiter of [`WaitQueue::wait_until`], which lives on the stack of the waiting thread.
+    ///
+    /// The waiter removes its entry before it returns, unless the entry has been popped and the
+    /// waiter has been woken with the lock of the wait queue held. So the pointer is valid as
+    /// long as it is in the wait queue.
+    Node(NonNull<WaitNode>),
 }
 
+// SAFETY: A `WaitNode` is only accessed through shared references, and all its fields are `Sync`.
+unsafe impl Send for WaitEntry {}
+
+/// A waiter of [`WaitQueue::wait_until`].
+///
+/// Unlike a [`Waiter`], a `WaitNode` needs no heap allocation, and it is never left behind in the
+/// wait queue to consume a wake event that is meant for another waiter.
+struct WaitNode {
+    task: Arc<Task>,
+    has_woken: AtomicBool,
+}
+
+impl WaitNode {
+    /// Marks the node as woken and returns the task to wake up.
+    ///
+    /// This method must be called with the lock of the wait queue held, right after the node is
+    /// popped. The node must not be accessed afterwards, since the waiter may return at any time.
+    fn wake(&self) -> Arc<Task> {
+        let task = self.task.clone();
+        self.has_woken.store(true, Ordering::Release);
+        task
+    }
+
+    #[track_caller]
+    fn wait(&self) {
+        while !self.has_woken.load(Ordering::Acquire) {
+            scheduler::park_current(|| self.has_woken.load(Ordering::Acquire));
+        }
+    }
+}
+
+/// The maximum number of threads that [`WaitQueue::wake_all`] wakes up with one acquisition of
+/// the lock. The threads are handed to the scheduler in a batch.
+const WAKE_BATCH_SIZE: usize = 16;
+
 impl WaitQueue {
     /// Creates a new, empty wait queue.
     pub const fn new() -> Self {
@@ -74,14 +126,18 @@ impl WaitQueue {
             return res;
         }
 
-        let (waiter, _) = Waiter::new_pair();
-        let cond = || {
-            self.enqueue(waiter.waker());
-            cond()
+        let node = WaitNode {
+            task: Task::current().unwrap().cloned(),
+            has_woken: AtomicBool::new(false),
         };
-        waiter
-            .wait_until_or_cancelled(cond, || Ok::<(), ()>(()))
-            .unwrap()
+        loop {
+            self.enqueue_node(&node);
+            if let Some(res) = cond() {
+                self.remove_node(&node);
+                return res;
+            }
+            node.wait();
+        }
     }
 
     /// Wakes up one waiting thread, if there is one at the point of time when this method is
@@ -94,15 +150,26 @@ impl WaitQueue {
 
         loop {
             let mut wakers = self.wakers.lock();
-            let Some(waker) = wakers.pop_front() else {
+            let Some(entry) = wakers.pop_front() else {
                 return false;
             };
             self.num_wakers.fetch_sub(1, Ordering::Release);
-            // Avoid holding lock when calling `wake_up`
-            drop(wakers);
 
-            if waker.wake_up() {
-                return true;
+            match entry {
+                WaitEntry::Node(node) => {
+                    // SAFETY: The node is valid because it has just been popped.
+                    let task = unsafe { node.as_ref() }.wake();
+                    drop(wakers);
+                    scheduler::unpark_target(task);
+                    return true;
+                }
+                WaitEntry::Waker(waker) => {
+                    // Avoid holding lock when calling `wake_up`
+                    drop(wakers);
+                    if waker.wake_up() {
+                        return true;
+                    }
+                }
             }
         }
     }
@@ -117,16 +184,31 @@ impl WaitQueue {
         let mut num_woken = 0;
 
         loop {
+            let mut tasks = SmallVec::<[Arc<Task>; WAKE_BATCH_SIZE]>::new();
+
             let mut wakers = self.wakers.lock();
-            let Some(waker) = wakers.pop_front() else {
-                break;
-            };
-            self.num_wakers.fetch_sub(1, Ordering::Release);
-            // Avoid holding lock when calling `wake_up`
+            while tasks.len() < WAKE_BATCH_SIZE {
+                let Some(entry) = wakers.pop_front() else {
+                    break;
+                };
+                self.num_wakers.fetch_sub(1, Ordering::Release);
+
+                let task = match entry {
+                    // SAFETY: The node is valid because it has just been popped.
+                    WaitEntry::Node(node) => Some(unsafe { node.as_ref() }.wake()),
+                    WaitEntry::Waker(waker) => waker.claim(),
+                };
+                tasks.extend(task);
+            }
+            let is_drained = wakers.is_empty();
+            // Avoid holding lock when waking up the tasks
             drop(wakers);
 
-            if waker.wake_up() {
-                num_woken += 1;
+            num_woken += tasks.len();
+            scheduler::unpark_targets(&mut tasks.into_iter());
+
+            if is_drained {
+                break;
             }
         }
 
@@ -143,10 +225,40 @@ impl WaitQueue {
     /// Enqueues the input [`Waker`] to the wait queue.
     #[doc(hidden)]
     pub fn enqueue(&self, waker: Arc<Waker>) {
+        self.push_entry(WaitEntry::Waker(waker));
+    }
+
+    fn enqueue_node(&self, node: &WaitNode) {
+        node.has_woken.store(false, Ordering::Relaxed);
+        self.push_entry(WaitEntry::Node(NonNull::from(node)));
+    }
+
+    fn push_entry(&self, entry: WaitEntry) {
         let mut wakers = self.wakers.lock();
-        wakers.push_back(waker);
+        wakers.push_back(entry);
         self.num_wakers.fetch_add(1, Ordering::Acquire);
     }
+
+    /// Removes the node from the wait queue if it has not been popped by a waker.
+    fn remove_node(&self, node: &WaitNode) {
+        // A woken node has been popped and will no longer be accessed by the waker.
+        if node.has_woken.load(Ordering::Acquire) {
+            return;
+        }
+
+        let mut wakers = self.wakers.lock();
+        if node.has_woken.load(Ordering::Relaxed) {
+            return;
+        }
+        // The node has been pushed just before, so it is likely to be near the back.
+        let node_ptr = NonNull::from(node);
+        let index = wakers
+            .iter()
+            .rposition(|entry| matches!(entry, WaitEntry::Node(ptr) if *ptr == node_ptr))
+            .unwrap();
+        wakers.remove(index);
+        self.num_wakers.fetch_sub(1, Ordering::Release);
+    }
 }
 
 impl Default for WaitQueue {
@@ -260,14 +372,24 @@ impl Waker {
     /// delivered, _or_ that the waiter will be dropped after being woken. It's up to the caller to
     /// handle the latter case properly to avoid missing the wake event.
     pub fn wake_up(&self) -> bool {
-        if self.has_woken.swap(true, Ordering::Release) {
+        let Some(task) = self.claim() else {
             return false;
-        }
-        scheduler::unpark_target(self.task.clone());
+        };
+        scheduler::unpark_target(task);
 
         true
     }
 
+    /// Marks the associated [`Waiter`] as woken and returns the task to wake up.
+    ///
+    /// This method returns `None` if the waiter has already been woken or dropped.
+    fn claim(&self) -> Option<Arc<Task>> {
+        if self.has_woken.swap(true, Ordering::Release) {
+            return None;
+        }
+        Some(self.task.clone())
+    }
+
     #[track_caller]
     fn do_wait(&self) {
         while !self.has_woken.swap(false, Ordering::Acquire) {
@@ -326,6 +448,22 @@ mod test {
         });
     }
 
+    #[ktest]
+    fn queue_wait_removes_waiter() {
+        let queue = WaitQueue::new();
+
+        // The first check fails, so a waiter is enqueued before the second check succeeds.
+        let mut nr_checks = 0;
+        queue.wait_until(|| {
+            nr_checks += 1;
+            (nr_checks == 2).then_some(())
+        });
+
+        assert_eq!(nr_checks, 2);
+        assert!(queue.is_empty());
+        assert!(!queue.wake_one());
+    }
+
     #[ktest]
     fn waiter_wake_twice() {
         let (_waiter, waker) = Waiter::new_pair();
@@ -1,18 +1,18 @@
 // SPDX-License-Identifier: MPL-2.0
 
-use core::sync::atomic::Ordering;
+use core::{cell::RefCell, sync::atomic::Ordering};
 
 use crate::{
     arch::mm::tlb_flush_addr_range,
     cpu::{AtomicCpuSet, CpuSet, PinCurrentCpu},
-    impl_frame_meta_for,
+    cpu_local, impl_frame_meta_for,
     mm::{
         kspace::kvirt_area::{KVirtArea, Tracked},
         page_prop::{CachePolicy, PageFlags, PageProperty, PrivilegedPageFlags},
         FrameAllocOptions, PAGE_SIZE,
     },
     prelude::*,
-    trap::DisabledLocalIrqGuard,
+    trap::{self, DisabledLocalIrqGuard},
 };
 
 /// The kernel stack size of a task, specified in pages.
@@ -31,15 +31,38 @@ pub const DEFAULT_STACK_SIZE_IN_PAGES: u32 = 128;
 
 pub static KERNEL_STACK_SIZE: usize = STACK_SIZE_IN_PAGES as usize * PAGE_SIZE;
 
+/// The maximum number of kernel stacks cached on each CPU.
+///
+/// Each cached stack holds [`KERNEL_STACK_SIZE`] bytes of memory, so the cache
+/// is kept small. It only needs to absorb the bursts of thread exits and
+/// creations.
+const MAX_CACHED_STACKS_PER_CPU: usize = 4;
+
+cpu_local! {
+    /// The kernel stacks that are freed on this CPU and can be reused.
+    static STACK_CACHE: RefCell<Vec<StackArea>> = RefCell::new(Vec::new());
+}
+
 #[derive(Debug)]
 #[expect(dead_code)]
 pub struct KernelStack {
-    kvirt_area: KVirtArea<Tracked>,
-    tlb_coherent: AtomicCpuSet,
+    /// The mapped area, which is `None` only when it is being dropped.
+    area: Option<StackArea>,
     end_vaddr: Vaddr,
     has_guard_page: bool,
 }
 
+/// The virtual area of a kernel stack and its mapped pages.
+///
+/// The mapping of the area never changes once created. So a cached area can
+/// be handed to a new task as is, and the CPUs that have flushed their TLBs
+/// for it need not do it again.
+#[derive(Debug)]
+struct StackArea {
+    kvirt_area: KVirtArea<Tracked>,
+    tlb_coherent: AtomicCpuSet,
+}
+
 #[derive(Debug, Default)]
 struct KernelStackMeta;
 
@@ -50,11 +73,63 @@ impl KernelStack {
     ///
     /// 4 additional pages are allocated and regarded as guard pages, which
     /// should not be accessed.
-    //
-    // TODO: We map kernel stacks in the kernel virtual areas, which incurs
-    // non-negligible TLB and mapping overhead on task creation. This could
-    // be improved by caching/reusing kernel stacks with a pool.
+    ///
+    /// The stack is reused from the per-CPU cache if possible, which saves
+    /// the allocation and the mapping of the pages. Like a newly allocated
+    /// stack, a reused stack is not zeroed.
     pub fn new_with_guard_page() -> Result<Self> {
+        let cached_area = {
+            let irq_guard = trap::disable_local();
+            STACK_CACHE.get_with(&irq_guard).borrow_mut().pop()
+        };
+        let area = match cached_area {
+            Some(area) => area,
+            None => StackArea::new()?,
+        };
+
+        let end_vaddr = area.kvirt_area.range().start + 2 * PAGE_SIZE + KERNEL_STACK_SIZE;
+        Ok(Self {
+            area: Some(area),
+            end_vaddr,
+            has_guard_page: true,
+        })
+    }
+
+    /// Flushes the TLB for the current CPU if necessary.
+    pub(super) fn flush_tlb(&self, irq_guard: &DisabledLocalIrqGuard) {
+        let area = self.area.as_ref().unwrap();
+        let cur_cpu = irq_guard.current_cpu();
+        if !area.tlb_coherent.contains(cur_cpu, Ordering::Relaxed) {
+            tlb_flush_addr_range(&area.kvirt_area.range());
+            area.tlb_coherent.add(cur_cpu, Ordering::Relaxed);
+        }
+    }
+
+    pub fn end_vaddr(&self) -> Vaddr {
+        self.end_vaddr
+    }
+}
+
+impl Drop for KernelStack {
+    fn drop(&mut self) {
+        let area = self.area.take().unwrap();
+
+        let irq_guard = trap::disable_local();
+        let mut cache = STACK_CACHE.get_with(&irq_guard).borrow_mut();
+        if cache.len() < MAX_CACHED_STACKS_PER_CPU {
+            cache.push(area);
+            return;
+        }
+        drop(cache);
+        drop(irq_guard);
+
+        // The cache is full. Unmap the area and free the pages.
+        drop(area);
+    }
+}
+
+impl StackArea {
+    fn new() -> Result<Self> {
         let pages = FrameAllocOptions::new()
             .zeroed(false)
             .alloc_segment_with(KERNEL_STACK_SIZE / PAGE_SIZE, |_| KernelStackMeta)?;
@@ -63,34 +138,17 @@ impl KernelStack {
             cache: CachePolicy::Writeback,
             priv_flags: PrivilegedPageFlags::empty(),
         };
-        let new_kvirt_area = KVirtArea::<Tracked>::map_pages(
+        let kvirt_area = KVirtArea::<Tracked>::map_pages(
             KERNEL_STACK_SIZE + 4 * PAGE_SIZE,
             2 * PAGE_SIZE,
             pages.into_iter(),
             prop,
         );
-        let mapped_start = new_kvirt_area.range().start + 2 * PAGE_SIZE;
-        let mapped_end = mapped_start + KERNEL_STACK_SIZE;
         Ok(Self {
-            kvirt_area: new_kvirt_area,
+            kvirt_area,
             tlb_coherent: AtomicCpuSet::new(CpuSet::new_empty()),
-            end_vaddr: mapped_end,
-            has_guard_page: true,
         })
     }
-
-    /// Flushes the TLB for the current CPU if necessary.
-    pub(super) fn flush_tlb(&self, irq_guard: &DisabledLocalIrqGuard) {
-        let cur_cpu = irq_guard.current_cpu();
-        if !self.tlb_coherent.contains(cur_cpu, Ordering::Relaxed) {
-            tlb_flush_addr_range(&self.kvirt_area.range());
-            self.tlb_coherent.add(cur_cpu, Ordering::Relaxed);
-        }
-    }
-
-    pub fn end_vaddr(&self) -> Vaddr {
-        self.end_vaddr
-    }
 }
 
 const fn parse_u32_or_default(size: Option<&str>, default: u32) -> u32 {
@@ -111,3 +169,21 @@ const fn parse_u32(input: &str) -> u32 {
     }
     output
 }
+
+#[cfg(ktest)]
+mod test {
+    use super::*;
+    use crate::{prelude::*, task::disable_preempt};
+
+    #[ktest]
+    fn freed_stack_is_reused() {
+        let _preempt_guard = disable_preempt();
+
+        let stack = KernelStack::new_with_guard_page().unwrap();
+        let end_vaddr = stack.end_vaddr();
+        drop(stack);
+
+        let stack = KernelStack::new_with_guard_page().unwrap();
+        assert_eq!(stack.end_vaddr(), end_vaddr);
+    }
+}
@@ -13,13 +13,15 @@ use core::{
     any::Any,
     borrow::Borrow,
     cell::{Cell, SyncUnsafeCell},
-    ops::Deref,
+    ops::{Deref, Range},
     ptr::NonNull,
-    sync::atomic::AtomicBool,
+    sync::atomic::{AtomicBool, AtomicU64, Ordering},
 };
 
 use kernel_stack::KernelStack;
 use processor::current_task;
+pub(crate) use processor::is_running_on;
+pub use processor::nr_context_switches;
 use spin::Once;
 use utils::ForceSync;
 
@@ -60,6 +62,8 @@ pub struct Task {
     /// This is to enforce not context switching to an already running task.
     /// See [`processor::switch_to_task`] for more details.
     switched_to_cpu: AtomicBool,
+    /// The number of times that the task has been switched to a CPU.
+    nr_switches: AtomicU64,
 
     schedule_info: TaskScheduleInfo,
 }
@@ -122,6 +126,18 @@ impl Task {
         &self.schedule_info
     }
 
+    /// Returns the number of times that the task has been switched to a CPU.
+    pub fn nr_switches(&self) -> u64 {
+        self.nr_switches.load(Ordering::Relaxed)
+    }
+
+    /// Returns the range of the mapped kernel stack of the task.
+    #[cfg_attr(not(target_arch = "x86_64"), expect(dead_code))]
+    pub(crate) fn kernel_stack_range(&self) -> Range<Vaddr> {
+        let end = self.kstack.end_vaddr();
+        end - kernel_stack::KERNEL_STACK_SIZE..end
+    }
+
     /// Returns the user context of this task, if it has.
     pub fn user_ctx(&self) -> Option<&Arc<UserContext>> {
         if self.user_ctx.is_some() {
@@ -263,6 +279,7 @@ impl TaskOptions {
                 cpu: AtomicCpuId::default(),
             },
             switched_to_cpu: AtomicBool::new(false),
+            nr_switches: AtomicU64::new(0),
         };
 
         Ok(new_task)
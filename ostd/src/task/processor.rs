@@ -1,10 +1,17 @@
 // SPDX-License-Identifier: MPL-2.0
 
 use alloc::sync::Arc;
-use core::{ptr::NonNull, sync::atomic::Ordering};
+use core::{
+    ptr::NonNull,
+    sync::atomic::{AtomicPtr, Ordering},
+};
 
 use super::{context_switch, Task, TaskContext, POST_SCHEDULE_HANDLER};
-use crate::{cpu_local_cell, trap::DisabledLocalIrqGuard};
+use crate::{
+    cpu::{CpuId, PinCurrentCpu},
+    cpu_local, cpu_local_cell,
+    trap::DisabledLocalIrqGuard,
+};
 
 cpu_local_cell! {
     /// The `Arc<Task>` (casted by [`Arc::into_raw`]) that is the current task.
@@ -15,6 +22,16 @@ cpu_local_cell! {
     static PREVIOUS_TASK_PTR: *const Task = core::ptr::null();
     /// An unsafe cell to store the context of the bootstrap code.
     static BOOTSTRAP_CONTEXT: TaskContext = TaskContext::new();
+    /// The number of context switches on the processor.
+    static NR_CONTEXT_SWITCHES: u64 = 0;
+}
+
+cpu_local! {
+    /// A copy of [`CURRENT_TASK_PTR`] that can be read from other CPUs.
+    ///
+    /// The pointer must not be dereferenced. It is only used to tell whether a task is running on
+    /// the CPU.
+    static RUNNING_TASK_PTR: AtomicPtr<Task> = AtomicPtr::new(core::ptr::null_mut());
 }
 
 /// Returns a pointer to the current task running on the processor.
@@ -24,6 +41,21 @@ pub(super) fn current_task() -> Option<NonNull<Task>> {
     NonNull::new(CURRENT_TASK_PTR.load().cast_mut())
 }
 
+/// Returns whether the task at `task_ptr` is running on the CPU `cpu`.
+///
+/// The result may be outdated as soon as it is returned.
+pub(crate) fn is_running_on(task_ptr: *const Task, cpu: CpuId) -> bool {
+    core::ptr::eq(
+        RUNNING_TASK_PTR.get_on_cpu(cpu).load(Ordering::Relaxed),
+        task_ptr,
+    )
+}
+
+/// Returns the number of context switches on all the processors since boot.
+pub fn nr_context_switches() -> u64 {
+    NR_CONTEXT_SWITCHES.sum()
+}
+
 /// Calls this function to switch to other task
 ///
 /// If current task is none, then it will use the default task context and it
@@ -61,13 +93,18 @@ pub(super) fn switch_to_task(next_task: Arc<Task>) {
         BOOTSTRAP_CONTEXT.as_mut_ptr()
     };
 
+    crate::tracepoint!(SchedSwitch, current_task_ptr, Arc::as_ptr(&next_task));
     before_switching_to(&next_task, &irq_guard);
 
     // `before_switching_to` guarantees that from now on, and while the next task is running on the
     // CPU, its context can be used exclusively.
     let next_task_ctx_ptr = next_task.ctx().get().cast_const();
 
-    CURRENT_TASK_PTR.store(Arc::into_raw(next_task));
+    let next_task_ptr = Arc::into_raw(next_task);
+    RUNNING_TASK_PTR
+        .get_on_cpu(irq_guard.current_cpu())
+        .store(next_task_ptr.cast_mut(), Ordering::Relaxed);
+    CURRENT_TASK_PTR.store(next_task_ptr);
     debug_assert!(PREVIOUS_TASK_PTR.load().is_null());
     PREVIOUS_TASK_PTR.store(current_task_ptr);
 
@@ -105,6 +142,9 @@ fn before_switching_to(next_task: &Task, irq_guard: &DisabledLocalIrqGuard) {
         log::warn!("Switching to a task already running in the foreground");
         core::hint::spin_loop();
     }
+
+    next_task.nr_switches.fetch_add(1, Ordering::Relaxed);
+    NR_CONTEXT_SWITCHES.add_assign(1);
 }
 
 /// Does cleanups after switching to a task.
@@ -45,6 +45,38 @@ pub trait Scheduler<T = Task>: Sync + Send {
     /// that CPU.
     fn enqueue(&self, runnable: Arc<T>, flags: EnqueueFlags) -> Option<CpuId>;
 
+    /// Enqueues a batch of runnable tasks.
+    ///
+    /// The IDs of the CPUs whose `current` needs to be preempted are added to `preempt_cpus`.
+    ///
+    /// The default implementation enqueues the tasks one by one. Scheduler developers can
+    /// override it to lock each per-CPU runqueue only once for the whole batch.
+    fn enqueue_batch(
+        &self,
+        runnables: &mut dyn Iterator<Item = Arc<T>>,
+        flags: EnqueueFlags,
+        preempt_cpus: &mut CpuSet,
+    ) {
+        for runnable in runnables {
+            if let Some(cpu_id) = self.enqueue(runnable, flags) {
+                preempt_cpus.add(cpu_id);
+            }
+        }
+    }
+
+    /// Moves a task to the position entailed by its scheduling attributes, after they change.
+    ///
+    /// Tasks that are not in any runqueue should be left alone; they are placed according to
+    /// their new attributes when they are enqueued next time. If the `current` of a CPU needs
+    /// to be preempted as a result, this method returns the id of that CPU.
+    ///
+    /// The default implementation does nothing, which suits schedulers that ignore the
+    /// attributes of tasks once they are enqueued.
+    fn requeue(&self, runnable: &Arc<T>) -> Option<CpuId> {
+        let _ = runnable;
+        None
+    }
+
     /// Gets an immutable access to the local runqueue of the current CPU core.
     fn local_rq_with(&self, f: &mut dyn FnMut(&dyn LocalRunQueue<T>));
 
@@ -158,6 +190,7 @@ where
 
 /// Unblocks a target task.
 pub(crate) fn unpark_target(runnable: Arc<Task>) {
+    crate::tracepoint!(SchedWakeup, Arc::as_ptr(&runnable));
     let preempt_cpu = SCHEDULER
         .get()
         .unwrap()
@@ -167,6 +200,45 @@ pub(crate) fn unpark_target(runnable: Arc<Task>) {
     }
 }
 
+/// Unblocks a batch of target tasks.
+pub(crate) fn unpark_targets(runnables: &mut dyn Iterator<Item = Arc<Task>>) {
+    let mut preempt_cpus = CpuSet::new_empty();
+    let mut runnables =
+        runnables.inspect(|runnable| crate::tracepoint!(SchedWakeup, Arc::as_ptr(runnable)));
+    SCHEDULER
+        .get()
+        .unwrap()
+        .enqueue_batch(&mut runnables, EnqueueFlags::Wake, &mut preempt_cpus);
+    if preempt_cpus.is_empty() {
+        return;
+    }
+
+    let preempt_guard = disable_preempt();
+    let current_cpu = preempt_guard.current_cpu();
+    if preempt_cpus.contains(current_cpu) {
+        preempt_cpus.remove(current_cpu);
+        cpu_local::set_need_preempt();
+    }
+    if !preempt_cpus.is_empty() {
+        crate::smp::inter_processor_call(&preempt_cpus, || {
+            cpu_local::set_need_preempt();
+        });
+    }
+}
+
+/// Notifies the scheduler that the scheduling attributes of a task have changed.
+///
+/// If the task is waiting in a runqueue, it is moved according to its new attributes, and the
+/// CPU of the runqueue is asked to reschedule if necessary.
+pub fn requeue_target(runnable: &Arc<Task>) {
+    let Some(scheduler) = SCHEDULER.get() else {
+        return;
+    };
+    if let Some(preempt_cpu_id) = scheduler.requeue(runnable) {
+        set_need_preempt(preempt_cpu_id);
+    }
+}
+
 /// Enqueues a newly built task.
 ///
 /// Note that the new task is not guaranteed to run at once.
@@ -201,6 +273,20 @@ fn set_need_preempt(cpu_id: CpuId) {
     }
 }
 
+/// Asks the CPUs in `targets` to reschedule at their next preemption points.
+///
+/// This is used to force the CPUs to pass RCU quiescent states.
+pub(crate) fn preempt_cpus(targets: &CpuSet) {
+    crate::smp::inter_processor_call(targets, || {
+        cpu_local::set_need_preempt();
+    });
+}
+
+/// Returns whether the current CPU has been asked to reschedule.
+pub(crate) fn need_preempt() -> bool {
+    cpu_local::need_preempt()
+}
+
 /// Dequeues the current task from its runqueue.
 ///
 /// This should only be called if the current is to exit.
@@ -240,6 +326,16 @@ fn reschedule<F>(mut f: F)
 where
     F: FnMut(&mut dyn LocalRunQueue) -> ReschedAction,
 {
+    // A task that can be rescheduled is not in any RCU read-side critical section, even if it
+    // keeps running on the CPU. Reporting the quiescent state here lets idle CPUs and the CPUs
+    // that are forced to reschedule finish grace periods without a context switch.
+    if cpu_local::get_guard_count() == 0 && crate::arch::irq::is_local_enabled() {
+        // SAFETY: RCU read-side critical sections disable preemption, which is enabled here.
+        unsafe {
+            crate::sync::finish_grace_period();
+        }
+    }
+
     let next_task = loop {
         let mut action = ReschedAction::DoNothing;
         SCHEDULER.get().unwrap().local_mut_rq_with(&mut |rq| {
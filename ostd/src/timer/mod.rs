@@ -3,11 +3,13 @@
 //! The timer support.
 
 pub(crate) mod jiffies;
+pub(crate) mod nohz;
 
 use alloc::{boxed::Box, vec::Vec};
 use core::cell::RefCell;
 
 pub use jiffies::Jiffies;
+pub use nohz::{sleep_without_tick, tick_stopped_cpus};
 
 use crate::{cpu_local, trap};
 
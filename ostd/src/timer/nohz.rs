@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! Stopping the tick of idle CPUs.
+//!
+//! An idle CPU that is woken up by the tick every [`TIMER_FREQ`]th of a second
+//! only to find nothing to do wastes power and, in a VM, steals time from the
+//! other vCPUs. [`sleep_without_tick`] instead arms one timer interrupt at the
+//! time when the CPU has something to do next and sleeps until then.
+//!
+//! The tick is restarted on the first interrupt that the sleeping CPU
+//! receives, before any interrupt handler runs. So the interrupt handlers and
+//! the tasks always see a ticking CPU.
+//!
+//! [`TIMER_FREQ`]: crate::arch::timer::TIMER_FREQ
+
+use core::sync::atomic::{fence, Ordering};
+
+use spin::Once;
+
+use crate::{
+    arch::{irq, timer},
+    cpu::{AtomicCpuSet, CpuId, CpuSet, PinCurrentCpu},
+    cpu_local_cell,
+    sync::rcu_needs_cpu,
+    task::{atomic_mode::might_sleep, scheduler},
+    trap,
+};
+
+cpu_local_cell! {
+    static IS_TICK_STOPPED: bool = false;
+}
+
+/// The CPUs whose ticks are stopped.
+static TICK_STOPPED_CPUS: Once<AtomicCpuSet> = Once::new();
+
+/// Halts the current CPU until the next interrupt, stopping the tick for at
+/// most `max_ticks` ticks.
+///
+/// This function behaves like [`sleep_for_interrupt`], except that the timer
+/// interrupts are not delivered before `max_ticks` ticks pass, so that the CPU
+/// can stay halted longer. The caller, which is usually the idle loop, should
+/// pass the number of ticks until the next timer it has armed expires.
+///
+/// The tick is not stopped if the timer hardware cannot arm a single timer
+/// interrupt, if the current task has been asked to reschedule, or if RCU
+/// needs the CPU to pass a quiescent state. In the last case, the CPU still
+/// halts until the next tick.
+///
+/// [`sleep_for_interrupt`]: crate::cpu::sleep_for_interrupt
+#[track_caller]
+pub fn sleep_without_tick(max_ticks: u64) {
+    might_sleep();
+    if max_ticks <= 1 || !timer::can_stop_tick() {
+        crate::cpu::sleep_for_interrupt();
+        return;
+    }
+
+    let irq_guard = trap::disable_local();
+    let cpu = irq_guard.current_cpu();
+
+    // A wakeup may have happened after the caller decided to sleep.
+    if scheduler::need_preempt() {
+        return;
+    }
+
+    IS_TICK_STOPPED.store(true);
+    stopped_cpus().add(cpu, Ordering::Relaxed);
+    // Either the grace periods that start from now on see this CPU in
+    // `TICK_STOPPED_CPUS`, or this CPU sees them. See `RcuMonitor`.
+    fence(Ordering::SeqCst);
+    if rcu_needs_cpu(cpu) {
+        // Keep ticking so that the grace period makes progress, but still
+        // halt until the next tick instead of spinning in the idle loop.
+        start_tick(cpu);
+        drop(irq_guard);
+        crate::cpu::sleep_for_interrupt();
+        return;
+    }
+
+    timer::stop_tick(max_ticks);
+    // The tick is restarted by `irq_enter` on the interrupt that wakes the CPU.
+    irq::enable_local_and_halt();
+    drop(irq_guard);
+}
+
+/// Returns the CPUs whose ticks are stopped.
+///
+/// The CPUs are idle and do not react to anything but interrupts. Work that
+/// is left to such a CPU (e.g., load balancing) should be done by another CPU
+/// or requested with an inter-processor interrupt.
+pub fn tick_stopped_cpus() -> CpuSet {
+    TICK_STOPPED_CPUS
+        .get()
+        .map_or_else(CpuSet::new_empty, |cpus| cpus.load(Ordering::Relaxed))
+}
+
+/// Restarts the tick of the current CPU if it has been stopped.
+///
+/// This is called on each interrupt before the interrupt handlers.
+pub(crate) fn irq_enter() {
+    if !IS_TICK_STOPPED.load() {
+        return;
+    }
+
+    let irq_guard = trap::disable_local();
+    start_tick(irq_guard.current_cpu());
+    timer::restart_tick();
+}
+
+fn stopped_cpus() -> &'static AtomicCpuSet {
+    TICK_STOPPED_CPUS.call_once(|| AtomicCpuSet::new(CpuSet::new_empty()))
+}
+
+fn start_tick(cpu: CpuId) {
+    IS_TICK_STOPPED.store(false);
+    stopped_cpus().remove(cpu, Ordering::Relaxed);
+    // The interrupt handlers may enter RCU read-side critical sections after
+    // this, which must be waited for by the grace periods that start later.
+    fence(Ordering::SeqCst);
+}
@@ -0,0 +1,249 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! Static tracepoints.
+//!
+//! A tracepoint is a fixed point in the kernel that reports a [`TraceEvent`]
+//! with up to [`MAX_TRACE_ARGS`] integer arguments. It is placed with the
+//! [`tracepoint!`] macro:
+//!
+//! ```ignore
+//! ostd::tracepoint!(PageFault, addr, is_write);
+//! ```
+//!
+//! A disabled tracepoint costs a load and a well-predicted branch. An
+//! enabled tracepoint writes a [`TraceRecord`] into the ring buffer of the
+//! current CPU without any locks, and a single consumer pops the records out
+//! with [`drain`]. If a ring buffer is full, the new records are dropped and
+//! counted in [`nr_lost_records`].
+//!
+//! [`tracepoint!`]: crate::tracepoint
+
+use core::sync::atomic::{AtomicU64, Ordering};
+
+use spin::Once;
+
+use crate::{
+    arch::read_tsc,
+    cpu::{all_cpus, num_cpus, CpuId, PinCurrentCpu},
+    prelude::*,
+    sync::SpinLock,
+    trap,
+    util::spsc_ring::SpscRing,
+};
+
+/// The maximum number of arguments of a tracepoint.
+pub const MAX_TRACE_ARGS: usize = 4;
+
+/// The number of records that a ring buffer can hold.
+const RING_CAPACITY: usize = 8192;
+
+/// The events reported by the tracepoints.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+#[repr(u8)]
+pub enum TraceEvent {
+    /// A system call is entered.
+    SyscallEnter,
+    /// A system call returns.
+    SyscallExit,
+    /// A CPU switches from a task to another.
+    SchedSwitch,
+    /// A task is woken up.
+    SchedWakeup,
+    /// A user page fault is handled.
+    PageFault,
+    /// A block I/O request is submitted.
+    BioSubmit,
+    /// A block I/O request is completed.
+    BioComplete,
+    /// A network packet is received.
+    NetRx,
+    /// A network packet is transmitted.
+    NetTx,
+}
+
+impl TraceEvent {
+    /// All the events.
+    pub const ALL: [TraceEvent; 9] = [
+        Self::SyscallEnter,
+        Self::SyscallExit,
+        Self::SchedSwitch,
+        Self::SchedWakeup,
+        Self::PageFault,
+        Self::BioSubmit,
+        Self::BioComplete,
+        Self::NetRx,
+        Self::NetTx,
+    ];
+
+    /// Returns the name of the event.
+    pub const fn name(self) -> &'static str {
+        match self {
+            Self::SyscallEnter => "syscall_enter",
+            Self::SyscallExit => "syscall_exit",
+            Self::SchedSwitch => "sched_switch",
+            Self::SchedWakeup => "sched_wakeup",
+            Self::PageFault => "page_fault",
+            Self::BioSubmit => "bio_submit",
+            Self::BioComplete => "bio_complete",
+            Self::NetRx => "net_rx",
+            Self::NetTx => "net_tx",
+        }
+    }
+
+    /// Returns the names of the arguments that the tracepoints of the event report.
+    pub const fn field_names(self) -> &'static [&'static str] {
+        match self {
+            Self::SyscallEnter => &["nr", "arg0", "arg1", "arg2"],
+            Self::SyscallExit => &["nr", "ret"],
+            Self::SchedSwitch => &["prev", "next"],
+            Self::SchedWakeup => &["task"],
+            Self::PageFault => &["addr", "write"],
+            Self::BioSubmit => &["bio", "type", "sector", "nr_sectors"],
+            Self::BioComplete => &["bio", "status"],
+            Self::NetRx | Self::NetTx => &["len"],
+        }
+    }
+
+    /// Returns the event with the name.
+    pub fn from_name(name: &str) -> Option<Self> {
+        Self::ALL.into_iter().find(|event| event.name() == name)
+    }
+
+    /// Returns whether the tracepoints of the event are enabled.
+    #[inline(always)]
+    pub fn is_enabled(self) -> bool {
+        ENABLED_EVENTS.load(Ordering::Relaxed) & self.mask() != 0
+    }
+
+    const fn mask(self) -> u64 {
+        1 << self as u8
+    }
+}
+
+/// A record written by an enabled tracepoint.
+#[derive(Clone, Copy, Debug)]
+#[repr(C)]
+pub struct TraceRecord {
+    /// The TSC value when the record is written.
+    pub timestamp: u64,
+    /// The event.
+    pub event: TraceEvent,
+    /// The arguments, whose unused slots are zeros.
+    pub args: [u64; MAX_TRACE_ARGS],
+}
+
+impl TraceRecord {
+    /// Returns the arguments with their names.
+    pub fn fields(&self) -> impl Iterator<Item = (&'static str, u64)> + '_ {
+        self.event
+            .field_names()
+            .iter()
+            .copied()
+            .zip(self.args.iter().copied())
+    }
+}
+
+/// The bitmap of the enabled events.
+static ENABLED_EVENTS: AtomicU64 = AtomicU64::new(0);
+/// The per-CPU ring buffers of the records.
+///
+/// The producer of a ring is the code running on the CPU with the local IRQs
+/// disabled, and the consumer is whoever holds [`DRAIN_LOCK`].
+static RINGS: Once<Box<[SpscRing<TraceRecord>]>> = Once::new();
+static NR_LOST_RECORDS: AtomicU64 = AtomicU64::new(0);
+static DRAIN_LOCK: SpinLock<()> = SpinLock::new(());
+
+/// Enables the tracepoints of the event.
+pub fn enable(event: TraceEvent) {
+    // The ring buffers are allocated on demand, so they cost no memory unless tracing is used.
+    RINGS.call_once(|| {
+        (0..num_cpus())
+            .map(|_| SpscRing::new(RING_CAPACITY))
+            .collect()
+    });
+    ENABLED_EVENTS.fetch_or(event.mask(), Ordering::Relaxed);
+}
+
+/// Disables the tracepoints of the event.
+///
+/// The records that have been written remain in the ring buffers until they are drained.
+pub fn disable(event: TraceEvent) {
+    ENABLED_EVENTS.fetch_and(!event.mask(), Ordering::Relaxed);
+}
+
+/// Disables the tracepoints of all the events.
+pub fn disable_all() {
+    ENABLED_EVENTS.store(0, Ordering::Relaxed);
+}
+
+/// Writes a record of the event into the ring buffer of the current CPU.
+///
+/// This function is called by [`tracepoint!`] when the event is enabled, and
+/// it should not be called directly.
+///
+/// [`tracepoint!`]: crate::tracepoint
+#[cold]
+#[doc(hidden)]
+pub fn record(event: TraceEvent, args: &[u64]) {
+    // The event may be enabled and disabled between the check and the call.
+    let Some(rings) = RINGS.get() else {
+        return;
+    };
+
+    let mut record = TraceRecord {
+        timestamp: read_tsc(),
+        event,
+        args: [0; MAX_TRACE_ARGS],
+    };
+    let nr_args = args.len().min(MAX_TRACE_ARGS);
+    record.args[..nr_args].copy_from_slice(&args[..nr_args]);
+
+    let irq_guard = trap::disable_local();
+    let ring = &rings[irq_guard.current_cpu().as_usize()];
+    // SAFETY: The ring of a CPU is only pushed on the CPU with the local IRQs disabled.
+    let is_pushed = unsafe { ring.push(record) };
+
+    if !is_pushed {
+        NR_LOST_RECORDS.fetch_add(1, Ordering::Relaxed);
+    }
+}
+
+/// Pops the records that have been written, and calls `f` with each of them
+/// and the CPU on which it is written, as long as `f` returns true.
+///
+/// The records of a CPU are visited in the order they are written. The
+/// record for which `f` returns false is left in the ring buffer, and the
+/// next CPU is visited. `f` must not sleep, since the records are drained
+/// with a spin lock held.
+pub fn drain(mut f: impl FnMut(CpuId, &TraceRecord) -> bool) {
+    let Some(rings) = RINGS.get() else {
+        return;
+    };
+
+    let _guard = DRAIN_LOCK.lock();
+    for cpu in all_cpus() {
+        // SAFETY: The consumers are serialized by `DRAIN_LOCK`.
+        unsafe { rings[cpu.as_usize()].pop_while(|record| f(cpu, record)) };
+    }
+}
+
+/// Returns the number of the records that are lost because the ring buffers are full.
+pub fn nr_lost_records() -> u64 {
+    NR_LOST_RECORDS.load(Ordering::Relaxed)
+}
+
+/// Reports an event at a tracepoint.
+///
+/// The first argument is the name of a [`TraceEvent`] variant, and the others
+/// are the arguments of the event, which are cast to `u64` with `as`. The
+/// arguments are not evaluated if the event is disabled.
+///
+/// [`TraceEvent`]: crate::trace::TraceEvent
+#[macro_export]
+macro_rules! tracepoint {
+    ($event:ident $(, $arg:expr)* $(,)?) => {
+        if $crate::trace::TraceEvent::$event.is_enabled() {
+            $crate::trace::record($crate::trace::TraceEvent::$event, &[$(($arg) as u64),*]);
+        }
+    };
+}
@@ -71,6 +71,7 @@ pub(crate) fn call_irq_callback_functions(trap_frame: &TrapFrame, irq_number: us
     // bottom half cannot be reentrant for the same reason.
     INTERRUPT_NESTED_LEVEL.add_assign(1);
 
+    crate::timer::nohz::irq_enter();
     process_top_half(trap_frame, irq_number);
     crate::arch::interrupts_ack(irq_number);
 
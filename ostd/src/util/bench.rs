@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! A tiny microbenchmark harness for ktests.
+//!
+//! Benchmarks are ordinary `#[ktest]` functions that call [`bench`] or
+//! [`bench_contended`]. The results are printed in cycles per operation, as
+//! measured by [`read_tsc`], so that they can be compared across runs on the
+//! same machine.
+
+use core::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+
+use crate::{
+    arch::read_tsc,
+    cpu::{num_cpus, CpuSet, PinCurrentCpu},
+    prelude::*,
+    smp::inter_processor_call,
+    sync::SpinLock,
+    trap,
+};
+
+/// The number of iterations that are run before the measurement starts.
+const WARMUP_ITERS: usize = 64;
+
+/// Measures the average cost of `op` on the current CPU.
+///
+/// `op` is run `iters` times after a short warm-up. Returns the average
+/// number of cycles per operation, which is also printed together with
+/// `name`.
+pub(crate) fn bench(name: &str, iters: usize, mut op: impl FnMut()) -> u64 {
+    for _ in 0..WARMUP_ITERS {
+        op();
+    }
+
+    let start = read_tsc();
+    for _ in 0..iters {
+        op();
+    }
+    let cycles = read_tsc().wrapping_sub(start) / iters as u64;
+
+    println!("[bench] {:<40} {:>10} cycles/op", name, cycles);
+    cycles
+}
+
+/// Measures the average cost of `op` while all CPUs run it concurrently.
+///
+/// The current CPU and every other CPU run `op` `iters` times, starting at
+/// the same moment. The remote CPUs run `op` via [`inter_processor_call`], so
+/// `op` must not sleep and must be safe to call with local IRQs disabled.
+///
+/// Returns the average number of cycles per operation over all CPUs, or
+/// `None` if there is only one CPU. The result is also printed.
+pub(crate) fn bench_contended(name: &str, iters: usize, op: fn()) -> Option<u64> {
+    let nr_cpus = num_cpus();
+    if nr_cpus < 2 {
+        println!("[bench] {:<40} skipped (single CPU)", name);
+        return None;
+    }
+
+    // Only one contended benchmark can run at a time.
+    let _bench_guard = CONTENDED_BENCH.lock();
+
+    CONTENDED_OP.lock().replace(op);
+    CONTENDED_ITERS.store(iters, Ordering::Relaxed);
+    CONTENDED_CYCLES.store(0, Ordering::Relaxed);
+    NR_READY.store(0, Ordering::Relaxed);
+    NR_DONE.store(0, Ordering::Relaxed);
+    START.store(false, Ordering::Release);
+
+    let irq_guard = trap::disable_local();
+    let mut targets = CpuSet::new_full();
+    targets.remove(irq_guard.current_cpu());
+    drop(irq_guard);
+    inter_processor_call(&targets, contended_worker);
+
+    while NR_READY.load(Ordering::Acquire) < nr_cpus - 1 {
+        core::hint::spin_loop();
+    }
+    START.store(true, Ordering::Release);
+    contended_worker_body(op, iters);
+    while NR_DONE.load(Ordering::Acquire) < nr_cpus {
+        core::hint::spin_loop();
+    }
+
+    let cycles = CONTENDED_CYCLES.load(Ordering::Relaxed) / (iters * nr_cpus) as u64;
+    println!(
+        "[bench] {:<40} {:>10} cycles/op ({} CPUs)",
+        name, cycles, nr_cpus
+    );
+    Some(cycles)
+}
+
+static CONTENDED_BENCH: SpinLock<()> = SpinLock::new(());
+static CONTENDED_OP: SpinLock<Option<fn()>> = SpinLock::new(None);
+static CONTENDED_ITERS: AtomicUsize = AtomicUsize::new(0);
+static CONTENDED_CYCLES: AtomicU64 = AtomicU64::new(0);
+static NR_READY: AtomicUsize = AtomicUsize::new(0);
+static NR_DONE: AtomicUsize = AtomicUsize::new(0);
+static START: AtomicBool = AtomicBool::new(false);
+
+/// The entry of the remote CPUs, called in the IRQ context.
+fn contended_worker() {
+    let op = CONTENDED_OP.lock().unwrap();
+    let iters = CONTENDED_ITERS.load(Ordering::Relaxed);
+
+    NR_READY.fetch_add(1, Ordering::Release);
+    while !START.load(Ordering::Acquire) {
+        core::hint::spin_loop();
+    }
+    contended_worker_body(op, iters);
+}
+
+fn contended_worker_body(op: fn(), iters: usize) {
+    let start = read_tsc();
+    for _ in 0..iters {
+        op();
+    }
+    let cycles = read_tsc().wrapping_sub(start);
+
+    CONTENDED_CYCLES.fetch_add(cycles, Ordering::Relaxed);
+    NR_DONE.fetch_add(1, Ordering::Release);
+}
@@ -2,10 +2,13 @@
 
 //! Utility types and methods.
 
+#[cfg(ktest)]
+pub(crate) mod bench;
 mod either;
 mod macros;
 pub(crate) mod marker;
 pub(crate) mod ops;
 pub(crate) mod range_alloc;
+pub(crate) mod spsc_ring;
 
 pub use either::Either;
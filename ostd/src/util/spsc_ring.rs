@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: MPL-2.0
+
+//! A lock-free single-producer, single-consumer ring buffer.
+
+use core::{
+    cell::UnsafeCell,
+    mem::MaybeUninit,
+    sync::atomic::{AtomicUsize, Ordering},
+};
+
+use crate::prelude::*;
+
+/// A lock-free single-producer, single-consumer ring buffer of fixed capacity.
+///
+/// The ring is meant to be used as a per-CPU buffer of events: the producer
+/// is the code running on the CPU, which should push with the local IRQs
+/// disabled if the interrupt handlers push too, and the consumer is whoever
+/// holds a lock that serializes the consumers.
+pub(crate) struct SpscRing<T> {
+    slots: Box<[UnsafeCell<MaybeUninit<T>>]>,
+    /// The index of the next item to be popped, which is written by the consumer.
+    head: AtomicUsize,
+    /// The index of the next item to be pushed, which is written by the producer.
+    tail: AtomicUsize,
+}
+
+// SAFETY: A slot is accessed either by the producer before it publishes the
+// slot with `tail`, or by the consumer before it returns the slot with `head`,
+// but never by both at the same time.
+unsafe impl<T: Send> Sync for SpscRing<T> {}
+
+impl<T: Copy> SpscRing<T> {
+    /// Creates an empty ring that can hold `capacity` items.
+    ///
+    /// # Panics
+    ///
+    /// This method panics if `capacity` is not a power of two.
+    pub(crate) fn new(capacity: usize) -> Self {
+        assert!(capacity.is_power_of_two());
+
+        let slots = (0..capacity)
+            .map(|_| UnsafeCell::new(MaybeUninit::uninit()))
+            .collect();
+        Self {
+            slots,
+            head: AtomicUsize::new(0),
+            tail: AtomicUsize::new(0),
+        }
+    }
+
+    /// Pushes an item, or returns false if the ring is full.
+    ///
+    /// # Safety
+    ///
+    /// The method must not be called concurrently, i.e., there is only one producer.
+    pub(crate) unsafe fn push(&self, item: T) -> bool {
+        let tail = self.tail.load(Ordering::Relaxed);
+        if tail.wrapping_sub(self.head.load(Ordering::Acquire)) == self.slots.len() {
+            return false;
+        }
+
+        let slot = self.slots[tail & (self.slots.len() - 1)].get();
+        // SAFETY: The slot is not visible to the consumer until `tail` is advanced,
+        // and the caller ensures that there is no other producer.
+        unsafe { (*slot).write(item) };
+
+        self.tail.store(tail.wrapping_add(1), Ordering::Release);
+        true
+    }
+
+    /// Pops the items in the order they are pushed, as long as `f` returns true.
+    ///
+    /// The item for which `f` returns false is left in the ring.
+    ///
+    /// # Safety
+    ///
+    /// The method must not be called concurrently, i.e., there is only one consumer.
+    pub(crate) unsafe fn pop_while(&self, mut f: impl FnMut(&T) -> bool) {
+        let mut head = self.head.load(Ordering::Relaxed);
+        let tail = self.tail.load(Ordering::Acquire);
+        while head != tail {
+            let slot = self.slots[head & (self.slots.len() - 1)].get();
+            // SAFETY: The slot has been initialized by the producer before `tail`
+            // is advanced, and it is not reused until `head` is advanced.
+            if !f(unsafe { (*slot).assume_init_ref() }) {
+                break;
+            }
+            head = head.wrapping_add(1);
+            self.head.store(head, Ordering::Release);
+        }
+    }
+}
@@ -0,0 +1,205 @@
+// SPDX-License-Identifier: MPL-2.0
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// The copies cover whole blocks as well as unaligned heads and tails for any
+// block size up to this one.
+#define BLOCK_SIZE 4096
+#define SRC_SIZE (BLOCK_SIZE * 8 + 123)
+
+static char src_path[256];
+static char dst_path[256];
+static char buf[SRC_SIZE];
+
+#define THROW_ERROR(fmt, ...)                                             \
+	do {                                                              \
+		fprintf(stderr, "%s: " fmt " [%s]\n", __func__,           \
+			##__VA_ARGS__, strerror(errno));                  \
+		exit(EXIT_FAILURE);                                       \
+	} while (0)
+
+static char pattern_at(off_t offset)
+{
+	return (char)(offset * 7 + offset / BLOCK_SIZE + 3);
+}
+
+static int open_src(void)
+{
+	int fd;
+
+	fd = open(src_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		THROW_ERROR("open %s", src_path);
+
+	for (off_t i = 0; i < SRC_SIZE; i++)
+		buf[i] = pattern_at(i);
+	if (write(fd, buf, SRC_SIZE) != SRC_SIZE)
+		THROW_ERROR("write");
+	// Some of the pages are written back, and some are left dirty.
+	if (fsync(fd) < 0)
+		THROW_ERROR("fsync");
+	if (pwrite(fd, buf + BLOCK_SIZE, 10, BLOCK_SIZE) != 10)
+		THROW_ERROR("pwrite");
+	if (lseek(fd, 0, SEEK_SET) < 0)
+		THROW_ERROR("lseek");
+
+	return fd;
+}
+
+static int open_dst(off_t size)
+{
+	int fd;
+
+	fd = open(dst_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		THROW_ERROR("open %s", dst_path);
+	if (ftruncate(fd, size) < 0)
+		THROW_ERROR("ftruncate");
+
+	return fd;
+}
+
+// Checks that `len` bytes at `dst_off` of `fd` are the source bytes at
+// `src_off`, and that the bytes around them are still zeros.
+static void check_copied(int fd, off_t src_off, off_t dst_off, size_t len)
+{
+	off_t size = lseek(fd, 0, SEEK_END);
+	static char dst[SRC_SIZE * 2];
+
+	if (size < dst_off + (off_t)len || size > (off_t)sizeof(dst))
+		THROW_ERROR("unexpected size %ld", (long)size);
+	if (pread(fd, dst, size, 0) != size)
+		THROW_ERROR("pread");
+
+	for (off_t i = 0; i < size; i++) {
+		char expected = 0;
+
+		if (i >= dst_off && i < dst_off + (off_t)len)
+			expected = pattern_at(src_off + i - dst_off);
+		if (dst[i] != expected)
+			THROW_ERROR("byte %ld is %d, but expected %d", (long)i,
+				    dst[i], expected);
+	}
+}
+
+// Copies `len` bytes at `src_off` to `dst_off` of an empty file with the
+// explicit offsets, which are advanced.
+static void test_copy(int src_fd, off_t src_off, off_t dst_off, size_t len)
+{
+	int dst_fd = open_dst(0);
+	loff_t in_off = src_off, out_off = dst_off;
+	ssize_t copied;
+
+	copied = copy_file_range(src_fd, &in_off, dst_fd, &out_off, len, 0);
+	if (copied != (ssize_t)len)
+		THROW_ERROR("copy %ld bytes from %ld to %ld, but got %ld",
+			    (long)len, (long)src_off, (long)dst_off,
+			    (long)copied);
+	if (in_off != src_off + (off_t)len || out_off != dst_off + (off_t)len)
+		THROW_ERROR("the offsets are not advanced");
+	if (lseek(src_fd, 0, SEEK_CUR) != 0 || lseek(dst_fd, 0, SEEK_CUR) != 0)
+		THROW_ERROR("the file offsets are changed");
+
+	check_copied(dst_fd, src_off, dst_off, len);
+	close(dst_fd);
+}
+
+static void test_copy_with_file_offsets(int src_fd)
+{
+	int dst_fd = open_dst(BLOCK_SIZE);
+	ssize_t copied;
+
+	if (lseek(src_fd, BLOCK_SIZE, SEEK_SET) < 0 ||
+	    lseek(dst_fd, BLOCK_SIZE, SEEK_SET) < 0)
+		THROW_ERROR("lseek");
+
+	// The copy stops at the end of the source.
+	copied = copy_file_range(src_fd, NULL, dst_fd, NULL, SRC_SIZE, 0);
+	if (copied != SRC_SIZE - BLOCK_SIZE)
+		THROW_ERROR("got %ld", (long)copied);
+	if (lseek(src_fd, 0, SEEK_CUR) != SRC_SIZE ||
+	    lseek(dst_fd, 0, SEEK_CUR) != SRC_SIZE)
+		THROW_ERROR("the file offsets are not advanced");
+	check_copied(dst_fd, BLOCK_SIZE, BLOCK_SIZE, SRC_SIZE - BLOCK_SIZE);
+
+	// Nothing is copied at the end of the source.
+	copied = copy_file_range(src_fd, NULL, dst_fd, NULL, SRC_SIZE, 0);
+	if (copied != 0)
+		THROW_ERROR("got %ld at the end", (long)copied);
+
+	if (lseek(src_fd, 0, SEEK_SET) < 0)
+		THROW_ERROR("lseek");
+	close(dst_fd);
+}
+
+static void test_overwrite(int src_fd)
+{
+	int dst_fd = open_dst(0);
+	loff_t in_off = 0, out_off = 0;
+
+	// The blocks cached or written before are replaced.
+	if (copy_file_range(src_fd, &in_off, dst_fd, &out_off, SRC_SIZE, 0) !=
+	    SRC_SIZE)
+		THROW_ERROR("copy the whole file");
+	if (pwrite(dst_fd, "x", 1, BLOCK_SIZE * 2) != 1)
+		THROW_ERROR("pwrite");
+	in_off = 0;
+	out_off = 0;
+	if (copy_file_range(src_fd, &in_off, dst_fd, &out_off, SRC_SIZE, 0) !=
+	    SRC_SIZE)
+		THROW_ERROR("copy the whole file again");
+	check_copied(dst_fd, 0, 0, SRC_SIZE);
+	close(dst_fd);
+}
+
+static void test_same_file(int src_fd)
+{
+	loff_t in_off = 0, out_off = BLOCK_SIZE;
+
+	if (copy_file_range(src_fd, &in_off, src_fd, &out_off, BLOCK_SIZE * 2,
+			    0) != -1 ||
+	    errno != EINVAL)
+		THROW_ERROR("copy the overlapping ranges");
+}
+
+int main(int argc, char **argv)
+{
+	int src_fd;
+
+	if (argc != 2) {
+		printf("Usage: %s <directory>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	snprintf(src_path, sizeof(src_path), "%s/copy_file_range_src", argv[1]);
+	snprintf(dst_path, sizeof(dst_path), "%s/copy_file_range_dst", argv[1]);
+
+	src_fd = open_src();
+
+	// Block-aligned ranges, with and without unaligned tails.
+	test_copy(src_fd, 0, 0, SRC_SIZE);
+	test_copy(src_fd, BLOCK_SIZE, BLOCK_SIZE * 2, BLOCK_SIZE * 4);
+	test_copy(src_fd, BLOCK_SIZE * 2, 0, BLOCK_SIZE * 3 + 100);
+	// Equally unaligned ranges, with unaligned heads.
+	test_copy(src_fd, 100, BLOCK_SIZE + 100, BLOCK_SIZE * 5);
+	// Differently unaligned ranges.
+	test_copy(src_fd, 10, 20, BLOCK_SIZE * 5 + 30);
+	test_copy(src_fd, BLOCK_SIZE, 1, BLOCK_SIZE * 2);
+
+	test_copy_with_file_offsets(src_fd);
+	test_overwrite(src_fd);
+	test_same_file(src_fd);
+
+	close(src_fd);
+	unlink(src_path);
+	unlink(dst_path);
+
+	printf("copy_file_range tests passed on %s\n", argv[1]);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: MPL-2.0
+
+#define _GNU_SOURCE
+
+#include <linux/futex.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../network/test.h"
+
+#ifndef SYS_futex_waitv
+#define SYS_futex_waitv 449
+#endif
+
+#define FUTEX2_SIZE_U32_ 0x02
+#define FUTEX2_PRIVATE_ 128
+#define FUTEX_WAITV_MAX_ 128
+
+struct futex_waitv_ {
+	uint64_t val;
+	uint64_t uaddr;
+	uint32_t flags;
+	uint32_t __reserved;
+};
+
+static uint32_t words[FUTEX_WAITV_MAX_ + 1];
+static struct futex_waitv_ waiters[FUTEX_WAITV_MAX_ + 1];
+
+static long futex_waitv(struct futex_waitv_ *waiters, unsigned int nr,
+			struct timespec *timeout)
+{
+	return syscall(SYS_futex_waitv, waiters, nr, 0, timeout,
+		       CLOCK_MONOTONIC);
+}
+
+static void init_waiters(unsigned int nr)
+{
+	for (unsigned int i = 0; i < nr; i++) {
+		words[i] = 0;
+		waiters[i].val = 0;
+		waiters[i].uaddr = (uintptr_t)&words[i];
+		waiters[i].flags = FUTEX2_SIZE_U32_ | FUTEX2_PRIVATE_;
+		waiters[i].__reserved = 0;
+	}
+}
+
+static void *wait_thread(void *arg)
+{
+	*(long *)arg = futex_waitv(waiters, 3, NULL);
+	return NULL;
+}
+
+FN_TEST(wake_index)
+{
+	pthread_t thread;
+	long ret = -1;
+
+	init_waiters(3);
+	TEST_SUCC(pthread_create(&thread, NULL, wait_thread, &ret));
+
+	// Keep waking until the thread has queued itself on every futex.
+	while (syscall(SYS_futex, &words[2], FUTEX_WAKE_PRIVATE, 1, NULL, NULL,
+		       0) == 0)
+		usleep(1000);
+
+	TEST_SUCC(pthread_join(thread, NULL));
+	TEST_RES(ret, _ret == 2);
+}
+END_TEST()
+
+FN_TEST(value_mismatch)
+{
+	init_waiters(3);
+	words[1] = 1;
+
+	TEST_ERRNO(futex_waitv(waiters, 3, NULL), EAGAIN);
+}
+END_TEST()
+
+FN_TEST(timeout)
+{
+	struct timespec timeout;
+
+	init_waiters(2);
+	CHECK(clock_gettime(CLOCK_MONOTONIC, &timeout));
+	timeout.tv_nsec += 50 * 1000 * 1000;
+	if (timeout.tv_nsec >= 1000 * 1000 * 1000) {
+		timeout.tv_sec += 1;
+		timeout.tv_nsec -= 1000 * 1000 * 1000;
+	}
+
+	TEST_ERRNO(futex_waitv(waiters, 2, &timeout), ETIMEDOUT);
+}
+END_TEST()
+
+FN_TEST(invalid_args)
+{
+	init_waiters(FUTEX_WAITV_MAX_ + 1);
+
+	TEST_ERRNO(futex_waitv(waiters, 0, NULL), EINVAL);
+	TEST_ERRNO(futex_waitv(waiters, FUTEX_WAITV_MAX_ + 1, NULL), EINVAL);
+
+	waiters[0].__reserved = 1;
+	TEST_ERRNO(futex_waitv(waiters, 1, NULL), EINVAL);
+	waiters[0].__reserved = 0;
+
+	waiters[0].uaddr += 1;
+	TEST_ERRNO(futex_waitv(waiters, 1, NULL), EINVAL);
+	waiters[0].uaddr -= 1;
+
+	TEST_ERRNO(syscall(SYS_futex_waitv, waiters, 1, 1, NULL,
+			   CLOCK_MONOTONIC),
+		   EINVAL);
+}
+END_TEST()
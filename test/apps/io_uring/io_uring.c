@@ -0,0 +1,350 @@
+// SPDX-License-Identifier: MPL-2.0
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "../network/test.h"
+
+#define FILE_NAME "/tmp/io_uring_test.txt"
+
+struct ring {
+	int fd;
+	struct io_uring_params params;
+	void *sq_ring;
+	void *cq_ring;
+	struct io_uring_sqe *sqes;
+};
+
+static int io_uring_setup(unsigned int entries, struct io_uring_params *params)
+{
+	return syscall(SYS_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int fd, unsigned int to_submit,
+			  unsigned int min_complete, unsigned int flags,
+			  void *arg, size_t arg_size)
+{
+	return syscall(SYS_io_uring_enter, fd, to_submit, min_complete, flags,
+		       arg, arg_size);
+}
+
+#define SQ_FIELD(ring, field) \
+	((uint32_t *)((char *)(ring)->sq_ring + (ring)->params.sq_off.field))
+#define CQ_FIELD(ring, field) \
+	((uint32_t *)((char *)(ring)->cq_ring + (ring)->params.cq_off.field))
+
+static int ring_init(struct ring *ring, unsigned int entries,
+		     unsigned int cq_entries)
+{
+	struct io_uring_params *params = &ring->params;
+
+	memset(params, 0, sizeof(*params));
+	if (cq_entries != 0) {
+		params->flags = IORING_SETUP_CQSIZE;
+		params->cq_entries = cq_entries;
+	}
+
+	ring->fd = io_uring_setup(entries, params);
+	if (ring->fd < 0)
+		return -1;
+
+	ring->sq_ring = mmap(NULL,
+			     params->sq_off.array +
+				     params->sq_entries * sizeof(uint32_t),
+			     PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd,
+			     IORING_OFF_SQ_RING);
+	if (ring->sq_ring == MAP_FAILED)
+		return -1;
+
+	ring->cq_ring = mmap(NULL,
+			     params->cq_off.cqes +
+				     params->cq_entries *
+					     sizeof(struct io_uring_cqe),
+			     PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd,
+			     IORING_OFF_CQ_RING);
+	if (ring->cq_ring == MAP_FAILED)
+		return -1;
+
+	ring->sqes = mmap(NULL,
+			  params->sq_entries * sizeof(struct io_uring_sqe),
+			  PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd,
+			  IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED)
+		return -1;
+
+	return 0;
+}
+
+// Queues an SQE and returns it so that the caller can fill it in.
+static struct io_uring_sqe *ring_push_sqe(struct ring *ring, uint8_t opcode,
+					  uint64_t user_data)
+{
+	uint32_t tail = *SQ_FIELD(ring, tail);
+	uint32_t index = tail & *SQ_FIELD(ring, ring_mask);
+	struct io_uring_sqe *sqe = &ring->sqes[index];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = opcode;
+	sqe->user_data = user_data;
+	SQ_FIELD(ring, array)[index] = index;
+	__atomic_store_n(SQ_FIELD(ring, tail), tail + 1, __ATOMIC_RELEASE);
+
+	return sqe;
+}
+
+static uint32_t ring_cq_ready(struct ring *ring)
+{
+	return __atomic_load_n(CQ_FIELD(ring, tail), __ATOMIC_ACQUIRE) -
+	       *CQ_FIELD(ring, head);
+}
+
+// Reaps the oldest CQE, which must exist.
+static void ring_pop_cqe(struct ring *ring, struct io_uring_cqe *cqe)
+{
+	uint32_t head = *CQ_FIELD(ring, head);
+	struct io_uring_cqe *cqes = (struct io_uring_cqe *)CQ_FIELD(ring, cqes);
+
+	*cqe = cqes[head & *CQ_FIELD(ring, ring_mask)];
+	__atomic_store_n(CQ_FIELD(ring, head), head + 1, __ATOMIC_RELEASE);
+}
+
+static struct ring ring;
+static int file_fd;
+static int sk_pair[2];
+
+FN_SETUP(init)
+{
+	CHECK(ring_init(&ring, 4, 0));
+
+	file_fd = CHECK(open(FILE_NAME, O_RDWR | O_CREAT | O_TRUNC, 0644));
+	CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sk_pair));
+}
+END_SETUP()
+
+FN_TEST(setup_params)
+{
+	TEST_RES(ring.params.sq_entries, _ret == 4);
+	TEST_RES(ring.params.cq_entries, _ret == 8);
+	TEST_RES(ring.params.features & IORING_FEAT_NODROP, _ret != 0);
+
+	TEST_RES(*SQ_FIELD(&ring, ring_entries), _ret == 4);
+	TEST_RES(*SQ_FIELD(&ring, ring_mask), _ret == 3);
+	TEST_RES(*CQ_FIELD(&ring, ring_entries), _ret == 8);
+	TEST_RES(*CQ_FIELD(&ring, ring_mask), _ret == 7);
+	TEST_RES(ring_cq_ready(&ring), _ret == 0);
+
+	TEST_RES(fcntl(ring.fd, F_GETFD), _ret == FD_CLOEXEC);
+}
+END_TEST()
+
+FN_TEST(nop)
+{
+	struct io_uring_cqe cqe;
+
+	ring_push_sqe(&ring, IORING_OP_NOP, 0x1234);
+	TEST_RES(io_uring_enter(ring.fd, 1, 1, IORING_ENTER_GETEVENTS, NULL, 0),
+		 _ret == 1);
+	TEST_RES(*SQ_FIELD(&ring, head), _ret == *SQ_FIELD(&ring, tail));
+
+	TEST_RES(ring_cq_ready(&ring), _ret == 1);
+	ring_pop_cqe(&ring, &cqe);
+	TEST_RES(cqe.user_data, _ret == 0x1234);
+	TEST_RES(cqe.res, _ret == 0);
+}
+END_TEST()
+
+FN_TEST(read_write)
+{
+	char wbuf[] = "Hello, io_uring!";
+	char rbuf[sizeof(wbuf)] = { 0 };
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe cqe;
+
+	sqe = ring_push_sqe(&ring, IORING_OP_WRITE, 1);
+	sqe->fd = file_fd;
+	sqe->addr = (uintptr_t)wbuf;
+	sqe->len = sizeof(wbuf);
+	sqe->off = 4;
+	TEST_RES(io_uring_enter(ring.fd, 1, 1, IORING_ENTER_GETEVENTS, NULL, 0),
+		 _ret == 1);
+	ring_pop_cqe(&ring, &cqe);
+	TEST_RES(cqe.user_data, _ret == 1);
+	TEST_RES(cqe.res, _ret == sizeof(wbuf));
+
+	// Writes with explicit offsets do not move the file position.
+	TEST_RES(lseek(file_fd, 0, SEEK_CUR), _ret == 0);
+
+	sqe = ring_push_sqe(&ring, IORING_OP_READ, 2);
+	sqe->fd = file_fd;
+	sqe->addr = (uintptr_t)rbuf;
+	sqe->len = sizeof(rbuf);
+	sqe->off = 4;
+	TEST_RES(io_uring_enter(ring.fd, 1, 1, IORING_ENTER_GETEVENTS, NULL, 0),
+		 _ret == 1);
+	ring_pop_cqe(&ring, &cqe);
+	TEST_RES(cqe.user_data, _ret == 2);
+	TEST_RES(cqe.res, _ret == sizeof(rbuf));
+	TEST_RES(memcmp(wbuf, rbuf, sizeof(wbuf)), _ret == 0);
+
+	// Reading at the end of the file returns zero bytes.
+	sqe = ring_push_sqe(&ring, IORING_OP_READ, 3);
+	sqe->fd = file_fd;
+	sqe->addr = (uintptr_t)rbuf;
+	sqe->len = sizeof(rbuf);
+	sqe->off = 4 + sizeof(wbuf);
+	TEST_RES(io_uring_enter(ring.fd, 1, 1, IORING_ENTER_GETEVENTS, NULL, 0),
+		 _ret == 1);
+	ring_pop_cqe(&ring, &cqe);
+	TEST_RES(cqe.user_data, _ret == 3);
+	TEST_RES(cqe.res, _ret == 0);
+}
+END_TEST()
+
+FN_TEST(bad_fd)
+{
+	char buf[4];
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe cqe;
+
+	sqe = ring_push_sqe(&ring, IORING_OP_READ, 4);
+	sqe->fd = 1000;
+	sqe->addr = (uintptr_t)buf;
+	sqe->len = sizeof(buf);
+	TEST_RES(io_uring_enter(ring.fd, 1, 1, IORING_ENTER_GETEVENTS, NULL, 0),
+		 _ret == 1);
+	ring_pop_cqe(&ring, &cqe);
+	TEST_RES(cqe.user_data, _ret == 4);
+	TEST_RES(cqe.res, _ret == -EBADF);
+}
+END_TEST()
+
+FN_TEST(pending_recv)
+{
+	char wbuf[] = "data";
+	char rbuf[sizeof(wbuf)] = { 0 };
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe cqe;
+
+	sqe = ring_push_sqe(&ring, IORING_OP_RECV, 5);
+	sqe->fd = sk_pair[0];
+	sqe->addr = (uintptr_t)rbuf;
+	sqe->len = sizeof(rbuf);
+	TEST_RES(io_uring_enter(ring.fd, 1, 0, 0, NULL, 0), _ret == 1);
+
+	// No data has arrived, so the operation stays pending.
+	usleep(10 * 1000);
+	TEST_RES(ring_cq_ready(&ring), _ret == 0);
+
+	TEST_RES(write(sk_pair[1], wbuf, sizeof(wbuf)), _ret == sizeof(wbuf));
+	TEST_RES(io_uring_enter(ring.fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0),
+		 _ret == 0);
+
+	TEST_RES(ring_cq_ready(&ring), _ret == 1);
+	ring_pop_cqe(&ring, &cqe);
+	TEST_RES(cqe.user_data, _ret == 5);
+	TEST_RES(cqe.res, _ret == sizeof(wbuf));
+	TEST_RES(memcmp(wbuf, rbuf, sizeof(wbuf)), _ret == 0);
+}
+END_TEST()
+
+FN_TEST(cq_overflow)
+{
+	struct ring small;
+	struct io_uring_cqe cqe;
+
+	TEST_SUCC(ring_init(&small, 2, 2));
+	TEST_RES(small.params.cq_entries, _ret == 2);
+
+	for (int i = 0; i < 2; i++) {
+		ring_push_sqe(&small, IORING_OP_NOP, 2 * i);
+		ring_push_sqe(&small, IORING_OP_NOP, 2 * i + 1);
+		TEST_RES(io_uring_enter(small.fd, 2, 0, 0, NULL, 0), _ret == 2);
+	}
+
+	// The CQEs beyond the CQ ring size are kept instead of being dropped.
+	TEST_RES(ring_cq_ready(&small), _ret == 2);
+	TEST_RES(*SQ_FIELD(&small, flags) & IORING_SQ_CQ_OVERFLOW, _ret != 0);
+	TEST_RES(*CQ_FIELD(&small, overflow), _ret == 0);
+
+	ring_pop_cqe(&small, &cqe);
+	TEST_RES(cqe.user_data, _ret == 0);
+	ring_pop_cqe(&small, &cqe);
+	TEST_RES(cqe.user_data, _ret == 1);
+
+	// Waiting for events flushes the overflowed CQEs in order.
+	TEST_RES(io_uring_enter(small.fd, 0, 0, IORING_ENTER_GETEVENTS, NULL,
+				0),
+		 _ret == 0);
+	TEST_RES(ring_cq_ready(&small), _ret == 2);
+	TEST_RES(*SQ_FIELD(&small, flags) & IORING_SQ_CQ_OVERFLOW, _ret == 0);
+
+	ring_pop_cqe(&small, &cqe);
+	TEST_RES(cqe.user_data, _ret == 2);
+	TEST_RES(cqe.res, _ret == 0);
+	ring_pop_cqe(&small, &cqe);
+	TEST_RES(cqe.user_data, _ret == 3);
+	TEST_RES(cqe.res, _ret == 0);
+
+	TEST_SUCC(close(small.fd));
+}
+END_TEST()
+
+// SQ polling is not supported yet. Linux accepts it.
+FN_TEST(sqpoll_unsupported)
+{
+	struct io_uring_params params;
+
+	memset(&params, 0, sizeof(params));
+	params.flags = IORING_SETUP_SQPOLL;
+	TEST_ERRNO(io_uring_setup(4, &params), EINVAL);
+}
+END_TEST()
+
+// Signal masks are not supported yet. Linux accepts them.
+FN_TEST(sigmask_unsupported)
+{
+	sigset_t sigmask;
+	struct io_uring_getevents_arg arg;
+
+	sigemptyset(&sigmask);
+	TEST_ERRNO(io_uring_enter(ring.fd, 0, 0, IORING_ENTER_GETEVENTS,
+				  &sigmask, _NSIG / 8),
+		   EINVAL);
+
+	memset(&arg, 0, sizeof(arg));
+	arg.sigmask = (uintptr_t)&sigmask;
+	arg.sigmask_sz = _NSIG / 8;
+	TEST_ERRNO(io_uring_enter(ring.fd, 0, 0,
+				  IORING_ENTER_GETEVENTS |
+					  IORING_ENTER_EXT_ARG,
+				  &arg, sizeof(arg)),
+		   EINVAL);
+
+	// Without a signal mask, the extended argument is accepted.
+	arg.sigmask = 0;
+	arg.sigmask_sz = 0;
+	TEST_RES(io_uring_enter(ring.fd, 0, 0,
+				IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+				&arg, sizeof(arg)),
+		 _ret == 0);
+}
+END_TEST()
+
+FN_SETUP(cleanup)
+{
+	CHECK(close(sk_pair[0]));
+	CHECK(close(sk_pair[1]));
+	CHECK(close(file_fd));
+	CHECK(unlink(FILE_NAME));
+	CHECK(close(ring.fd));
+}
+END_SETUP()
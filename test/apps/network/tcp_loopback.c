@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: MPL-2.0
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#define STREAM_LEN (1024 * 1024)
+#define CHUNK_LEN 3000
+
+static int sk_listen;
+
+static char pattern_at(long offset)
+{
+	return (char)(offset * 13 + offset / 251);
+}
+
+static void connect_pair(int *client, int *server)
+{
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+
+	CHECK(getsockname(sk_listen, (struct sockaddr *)&addr, &addrlen));
+
+	*client = CHECK(socket(PF_INET, SOCK_STREAM, 0));
+	CHECK(connect(*client, (struct sockaddr *)&addr, sizeof(addr)));
+	*server = CHECK(accept(sk_listen, NULL, NULL));
+}
+
+static int wait_for(int fd, short events)
+{
+	struct pollfd pfd = { .fd = fd, .events = events };
+
+	return poll(&pfd, 1, 1000) == 1 ? pfd.revents : -1;
+}
+
+// Receives exactly `len` bytes, or fewer if the end of the stream is reached.
+static long recv_all(int fd, char *buf, long len)
+{
+	long total = 0;
+
+	while (total < len) {
+		long ret = recv(fd, buf + total, len - total, 0);
+
+		if (ret < 0)
+			return -1;
+		if (ret == 0)
+			break;
+		total += ret;
+	}
+
+	return total;
+}
+
+FN_SETUP(init)
+{
+	struct sockaddr_in addr = { .sin_family = AF_INET };
+
+	signal(SIGPIPE, SIG_IGN);
+
+	CHECK(inet_aton("127.0.0.1", &addr.sin_addr));
+	sk_listen = CHECK(socket(PF_INET, SOCK_STREAM, 0));
+	CHECK(bind(sk_listen, (struct sockaddr *)&addr, sizeof(addr)));
+	CHECK(listen(sk_listen, 4));
+}
+END_SETUP()
+
+static void *send_stream(void *arg)
+{
+	int fd = (long)arg;
+	char buf[CHUNK_LEN];
+	long sent = 0;
+
+	while (sent < STREAM_LEN) {
+		long len = STREAM_LEN - sent < CHUNK_LEN ? STREAM_LEN - sent :
+							   CHUNK_LEN;
+		long ret;
+
+		for (long i = 0; i < len; i++)
+			buf[i] = pattern_at(sent + i);
+		ret = send(fd, buf, len, 0);
+		if (ret < 0)
+			return (void *)-1L;
+		sent += ret;
+	}
+
+	// The FIN must not overtake the data.
+	return (void *)(long)close(fd);
+}
+
+FN_TEST(stream_order)
+{
+	static char buf[STREAM_LEN];
+	int client, server;
+	pthread_t thread;
+	void *ret;
+
+	connect_pair(&client, &server);
+
+	TEST_RES(pthread_create(&thread, NULL, send_stream,
+				(void *)(long)client),
+		 _ret == 0);
+	TEST_RES(recv_all(server, buf, STREAM_LEN), _ret == STREAM_LEN);
+	TEST_RES(pthread_join(thread, &ret), _ret == 0 && ret == NULL);
+
+	for (long i = 0; i < STREAM_LEN; i++) {
+		if (buf[i] != pattern_at(i)) {
+			TEST_RES(i, _ret == STREAM_LEN);
+			break;
+		}
+	}
+	TEST_RES(recv(server, buf, 1, 0), _ret == 0);
+
+	TEST_SUCC(close(server));
+}
+END_TEST()
+
+FN_TEST(shutdown_read)
+{
+	int client, server;
+	char buf[8];
+
+	connect_pair(&client, &server);
+
+	// The data sent before and after the receiving half is shut down arrive
+	// in order.
+	TEST_RES(send(client, "abc", 3, 0), _ret == 3);
+	TEST_RES(wait_for(server, POLLIN), _ret & POLLIN);
+	TEST_SUCC(shutdown(server, SHUT_RD));
+	TEST_RES(send(client, "def", 3, 0), _ret == 3);
+
+	TEST_RES(recv(server, buf, 2, 0),
+		 _ret == 2 && memcmp(buf, "ab", 2) == 0);
+	// Reads do not block after the shutdown, so wait for the data.
+	usleep(100 * 1000);
+	TEST_RES(recv(server, buf, sizeof(buf), 0),
+		 _ret == 4 && memcmp(buf, "cdef", 4) == 0);
+	TEST_RES(recv(server, buf, sizeof(buf), MSG_DONTWAIT), _ret == 0);
+
+	// The other direction still works.
+	TEST_RES(send(server, "xyz", 3, 0), _ret == 3);
+	TEST_RES(recv(client, buf, sizeof(buf), 0),
+		 _ret == 3 && memcmp(buf, "xyz", 3) == 0);
+
+	TEST_SUCC(close(client));
+	TEST_SUCC(close(server));
+}
+END_TEST()
+
+FN_TEST(close_with_unread_data)
+{
+	int client, server;
+	char buf[8];
+
+	connect_pair(&client, &server);
+
+	// Closing a socket with unread data resets the connection.
+	TEST_RES(send(client, "abc", 3, 0), _ret == 3);
+	TEST_RES(wait_for(server, POLLIN), _ret & POLLIN);
+	TEST_SUCC(close(server));
+
+	TEST_RES(wait_for(client, POLLIN), _ret & (POLLERR | POLLHUP));
+	TEST_ERRNO(recv(client, buf, sizeof(buf), 0), ECONNRESET);
+	TEST_RES(recv(client, buf, sizeof(buf), 0), _ret == 0);
+	TEST_ERRNO(send(client, "def", 3, 0), EPIPE);
+
+	TEST_SUCC(close(client));
+}
+END_TEST()
+
+FN_TEST(close_after_data)
+{
+	int client, server;
+	char buf[8];
+
+	connect_pair(&client, &server);
+
+	// The data sent before closing are received before the end of the
+	// stream, and the peer can still send without resetting the connection.
+	TEST_RES(send(client, "abc", 3, 0), _ret == 3);
+	TEST_RES(send(client, "def", 3, 0), _ret == 3);
+	TEST_SUCC(close(client));
+
+	TEST_RES(recv_all(server, buf, sizeof(buf)),
+		 _ret == 6 && memcmp(buf, "abcdef", 6) == 0);
+	TEST_RES(recv(server, buf, sizeof(buf), 0), _ret == 0);
+
+	TEST_SUCC(close(server));
+}
+END_TEST()
+
+FN_SETUP(cleanup)
+{
+	CHECK(close(sk_listen));
+}
+END_SETUP()
@@ -0,0 +1,213 @@
+// SPDX-License-Identifier: MPL-2.0
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+#define NR_MSGS 4
+#define MSG_SIZE 16
+#define SEG_SIZE 100
+#define NR_SEGS 3
+
+static int sk_send;
+static int sk_recv;
+
+static char bufs[NR_MSGS][SEG_SIZE * NR_SEGS];
+static struct iovec iovs[NR_MSGS];
+static struct mmsghdr msgs[NR_MSGS];
+
+// Prepares `NR_MSGS` messages of `MSG_SIZE` bytes, where the i-th message is
+// filled with `'a' + i`.
+static struct mmsghdr *prepare_msgs(void)
+{
+	for (int i = 0; i < NR_MSGS; i++) {
+		memset(bufs[i], 'a' + i, MSG_SIZE);
+		iovs[i].iov_base = bufs[i];
+		iovs[i].iov_len = MSG_SIZE;
+		memset(&msgs[i], 0, sizeof(msgs[i]));
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	return msgs;
+}
+
+// Prepares `NR_MSGS` empty buffers of `sizeof(bufs[0])` bytes.
+static struct mmsghdr *prepare_bufs(void)
+{
+	for (int i = 0; i < NR_MSGS; i++) {
+		memset(bufs[i], 0, sizeof(bufs[i]));
+		iovs[i].iov_base = bufs[i];
+		iovs[i].iov_len = sizeof(bufs[i]);
+		memset(&msgs[i], 0, sizeof(msgs[i]));
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	return msgs;
+}
+
+FN_SETUP(init)
+{
+	struct sockaddr_in addr = { .sin_family = AF_INET };
+	socklen_t addrlen = sizeof(addr);
+
+	CHECK(inet_aton("127.0.0.1", &addr.sin_addr));
+
+	sk_recv = CHECK(socket(PF_INET, SOCK_DGRAM, 0));
+	CHECK(bind(sk_recv, (struct sockaddr *)&addr, sizeof(addr)));
+	CHECK(getsockname(sk_recv, (struct sockaddr *)&addr, &addrlen));
+
+	sk_send = CHECK(socket(PF_INET, SOCK_DGRAM, 0));
+	CHECK(connect(sk_send, (struct sockaddr *)&addr, sizeof(addr)));
+}
+END_SETUP()
+
+FN_TEST(send_and_recv_batches)
+{
+	TEST_RES(sendmmsg(sk_send, prepare_msgs(), 3, 0), _ret == 3);
+
+	// Only the queued messages are received without blocking.
+	TEST_RES(recvmmsg(sk_recv, prepare_bufs(), NR_MSGS, MSG_DONTWAIT, NULL),
+		 _ret == 3 && msgs[0].msg_len == MSG_SIZE &&
+			 msgs[2].msg_len == MSG_SIZE && bufs[0][0] == 'a' &&
+			 bufs[2][0] == 'c');
+
+	TEST_ERRNO(recvmmsg(sk_recv, prepare_bufs(), NR_MSGS, MSG_DONTWAIT,
+			    NULL),
+		   EAGAIN);
+}
+END_TEST()
+
+FN_TEST(send_partial_batch)
+{
+	// The second message is invalid, so only the first one is sent.
+	prepare_msgs();
+	msgs[1].msg_hdr.msg_iov = (void *)1;
+	TEST_RES(sendmmsg(sk_send, msgs, 3, 0), _ret == 1);
+
+	// The error is reported if no messages are sent.
+	TEST_ERRNO(sendmmsg(sk_send, &msgs[1], 2, 0), EFAULT);
+
+	TEST_RES(recvmmsg(sk_recv, prepare_bufs(), NR_MSGS, MSG_DONTWAIT, NULL),
+		 _ret == 1 && msgs[0].msg_len == MSG_SIZE && bufs[0][0] == 'a');
+}
+END_TEST()
+
+FN_TEST(waitforone)
+{
+	// Only the first message is waited for.
+	TEST_RES(sendmmsg(sk_send, prepare_msgs(), 2, 0), _ret == 2);
+	TEST_RES(recvmmsg(sk_recv, prepare_bufs(), NR_MSGS, MSG_WAITFORONE,
+			  NULL),
+		 _ret == 2 && bufs[1][0] == 'b');
+}
+END_TEST()
+
+static void *send_later(void *arg)
+{
+	usleep(100 * 1000);
+	return (void *)(long)sendmmsg(sk_send, prepare_msgs(), 1, 0);
+}
+
+FN_TEST(waitforone_blocks)
+{
+	struct mmsghdr recv_msgs[NR_MSGS];
+	char recv_bufs[NR_MSGS][MSG_SIZE];
+	struct iovec recv_iovs[NR_MSGS];
+	pthread_t thread;
+	void *ret;
+
+	memset(recv_msgs, 0, sizeof(recv_msgs));
+	for (int i = 0; i < NR_MSGS; i++) {
+		recv_iovs[i].iov_base = recv_bufs[i];
+		recv_iovs[i].iov_len = MSG_SIZE;
+		recv_msgs[i].msg_hdr.msg_iov = &recv_iovs[i];
+		recv_msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	TEST_RES(pthread_create(&thread, NULL, send_later, NULL), _ret == 0);
+	TEST_RES(recvmmsg(sk_recv, recv_msgs, NR_MSGS, MSG_WAITFORONE, NULL),
+		 _ret == 1 && recv_msgs[0].msg_len == MSG_SIZE);
+	TEST_RES(pthread_join(thread, &ret), _ret == 0 && (long)ret == 1);
+}
+END_TEST()
+
+// Receives a datagram and returns its length. `gso_size` is set to the size of
+// the coalesced segments reported by `UDP_GRO`, or zero if it is not reported.
+static int recv_gro(int sk, int *gso_size)
+{
+	char control[CMSG_SPACE(sizeof(int))];
+	struct iovec iov = { .iov_base = bufs[0], .iov_len = sizeof(bufs[0]) };
+	struct msghdr msg = { .msg_iov = &iov,
+			      .msg_iovlen = 1,
+			      .msg_control = control,
+			      .msg_controllen = sizeof(control) };
+	struct cmsghdr *cmsg;
+	int len;
+
+	len = recvmsg(sk, &msg, MSG_DONTWAIT);
+	if (len < 0)
+		return len;
+
+	*gso_size = 0;
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+			memcpy(gso_size, CMSG_DATA(cmsg), sizeof(int));
+	return len;
+}
+
+FN_TEST(udp_gro)
+{
+	int seg_size = SEG_SIZE;
+	int enable = 1, disable = 0;
+	int gso_size;
+
+	memset(bufs[0], 'x', SEG_SIZE * NR_SEGS);
+	TEST_SUCC(setsockopt(sk_send, SOL_UDP, UDP_SEGMENT, &seg_size,
+			     sizeof(seg_size)));
+
+	// The segments are received one by one without `UDP_GRO`.
+	TEST_RES(send(sk_send, bufs[0], SEG_SIZE * NR_SEGS, 0),
+		 _ret == SEG_SIZE * NR_SEGS);
+	for (int i = 0; i < NR_SEGS; i++)
+		TEST_RES(recv_gro(sk_recv, &gso_size),
+			 _ret == SEG_SIZE && gso_size == 0);
+	TEST_ERRNO(recv_gro(sk_recv, &gso_size), EAGAIN);
+
+	// The segments are coalesced with `UDP_GRO`, and the segment size is
+	// reported in the control message.
+	TEST_SUCC(setsockopt(sk_recv, SOL_UDP, UDP_GRO, &enable,
+			     sizeof(enable)));
+	memset(bufs[0], 'x', SEG_SIZE * NR_SEGS);
+	TEST_RES(send(sk_send, bufs[0], SEG_SIZE * NR_SEGS, 0),
+		 _ret == SEG_SIZE * NR_SEGS);
+	TEST_RES(recv_gro(sk_recv, &gso_size),
+		 _ret == SEG_SIZE * NR_SEGS && gso_size == SEG_SIZE);
+	TEST_ERRNO(recv_gro(sk_recv, &gso_size), EAGAIN);
+
+	TEST_SUCC(setsockopt(sk_recv, SOL_UDP, UDP_GRO, &disable,
+			     sizeof(disable)));
+	TEST_SUCC(setsockopt(sk_send, SOL_UDP, UDP_SEGMENT, &disable,
+			     sizeof(disable)));
+}
+END_TEST()
+
+FN_SETUP(cleanup)
+{
+	CHECK(close(sk_send));
+	CHECK(close(sk_recv));
+}
+END_SETUP()
@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: MPL-2.0
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "test.h"
+
+static int sk_pair[2];
+static int pipe_fds[2];
+
+static int send_fds(int sk, const char *data, const int *fds, int nr_fds)
+{
+	char control[CMSG_SPACE(sizeof(int) * 4)] = { 0 };
+	struct iovec iov = { .iov_base = (void *)data,
+			     .iov_len = strlen(data) };
+	struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+	struct cmsghdr *cmsg;
+
+	if (nr_fds > 0) {
+		msg.msg_control = control;
+		msg.msg_controllen = CMSG_SPACE(sizeof(int) * nr_fds);
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int) * nr_fds);
+		memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * nr_fds);
+	}
+
+	return sendmsg(sk, &msg, 0);
+}
+
+// Receives at most `max_nr_fds` files and returns the number of the received
+// ones, or -1 on failures. `msg_flags` is set to the flags of the message.
+static int recv_fds(int sk, int flags, int *fds, int max_nr_fds,
+		    int *msg_flags)
+{
+	char control[CMSG_SPACE(sizeof(int) * 4)] = { 0 };
+	char data[16];
+	struct iovec iov = { .iov_base = data, .iov_len = sizeof(data) };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = control,
+		.msg_controllen = CMSG_LEN(sizeof(int) * max_nr_fds),
+	};
+	struct cmsghdr *cmsg;
+	int nr_fds = 0;
+
+	if (recvmsg(sk, &msg, flags) < 0)
+		return -1;
+	*msg_flags = msg.msg_flags;
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (cmsg->cmsg_level != SOL_SOCKET ||
+		    cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+		nr_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * nr_fds);
+	}
+
+	return nr_fds;
+}
+
+FN_SETUP(init)
+{
+	CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sk_pair));
+	CHECK(pipe(pipe_fds));
+}
+END_SETUP()
+
+FN_TEST(pass_fd)
+{
+	int fd, msg_flags;
+	char buf[8];
+
+	TEST_RES(send_fds(sk_pair[0], "a", &pipe_fds[1], 1), _ret == 1);
+	TEST_RES(recv_fds(sk_pair[1], 0, &fd, 1, &msg_flags),
+		 _ret == 1 && msg_flags == 0 && fd != pipe_fds[1]);
+
+	// The received file is the write end of the pipe.
+	TEST_RES(write(fd, "b", 1), _ret == 1);
+	TEST_RES(read(pipe_fds[0], buf, sizeof(buf)),
+		 _ret == 1 && buf[0] == 'b');
+	TEST_RES(fcntl(fd, F_GETFD), _ret == 0);
+	TEST_SUCC(close(fd));
+}
+END_TEST()
+
+FN_TEST(cmsg_cloexec)
+{
+	int fd, msg_flags;
+
+	TEST_RES(send_fds(sk_pair[0], "a", &pipe_fds[0], 1), _ret == 1);
+	TEST_RES(recv_fds(sk_pair[1], MSG_CMSG_CLOEXEC, &fd, 1, &msg_flags),
+		 _ret == 1 && msg_flags == MSG_CMSG_CLOEXEC);
+	TEST_RES(fcntl(fd, F_GETFD), _ret == FD_CLOEXEC);
+	TEST_SUCC(close(fd));
+}
+END_TEST()
+
+FN_TEST(ctrunc)
+{
+	int fds[4], msg_flags;
+
+	// Only the files that fit in the control buffer are received.
+	TEST_RES(send_fds(sk_pair[0], "a", pipe_fds, 2), _ret == 1);
+	TEST_RES(recv_fds(sk_pair[1], 0, fds, 1, &msg_flags),
+		 _ret == 1 && msg_flags == MSG_CTRUNC);
+	TEST_SUCC(close(fds[0]));
+
+	// No files are received without a control buffer.
+	TEST_RES(send_fds(sk_pair[0], "a", pipe_fds, 2), _ret == 1);
+	TEST_RES(recv_fds(sk_pair[1], 0, fds, 0, &msg_flags),
+		 _ret == 0 && msg_flags == MSG_CTRUNC);
+}
+END_TEST()
+
+FN_TEST(bad_fd)
+{
+	int fds[2] = { pipe_fds[0], -1 };
+
+	TEST_ERRNO(send_fds(sk_pair[0], "a", fds, 2), EBADF);
+}
+END_TEST()
+
+FN_SETUP(cleanup)
+{
+	CHECK(close(sk_pair[0]));
+	CHECK(close(sk_pair[1]));
+	CHECK(close(pipe_fds[0]));
+	CHECK(close(pipe_fds[1]));
+}
+END_SETUP()
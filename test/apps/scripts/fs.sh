@@ -53,6 +53,11 @@ test_fdatasync() {
     rm -f /exfat/test_fdatasync.txt
 }
 
+test_copy_file_range() {
+    copy_file_range/copy_file_range /
+    copy_file_range/copy_file_range /ext2
+}
+
 echo "Start ext2 fs test......"
 test_ext2 "/ext2" "test_file.txt"
 echo "All ext2 fs test passed."
@@ -61,6 +66,10 @@ echo "Start fdatasync test......"
 test_fdatasync
 echo "All fdatasync test passed."
 
+echo "Start copy_file_range test......"
+test_copy_file_range
+echo "All copy_file_range test passed."
+
 pipe/pipe_err
 pipe/short_rw
 epoll/epoll_err
@@ -31,8 +31,11 @@ sleep 0.2
 ./send_buf_full
 ./tcp_err
 ./tcp_poll
+./tcp_loopback
 ./udp_err
+./udp_mmsg
 ./unix_err
+./unix_scm_rights
 
 ./netlink_route
 ./rtnl_err
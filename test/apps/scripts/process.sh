@@ -21,9 +21,11 @@ exit/exit_procfs
 eventfd2/eventfd2
 fork/fork
 fork_c/fork
+futex/futex_waitv
 getpid/getpid
 hello_pie/hello
 hello_world/hello_world
+io_uring/io_uring
 itimer/setitimer
 itimer/timer_create
 mmap/mmap_and_fork
@@ -34,6 +36,7 @@ process/job_control
 pthread/pthread_test
 pty/open_pty
 sched/sched_attr
+sem/semop
 shm/posix_shm
 signal_c/parent_death_signal
 signal_c/signal_test
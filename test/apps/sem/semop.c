@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: MPL-2.0
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sys/sem.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../network/test.h"
+
+#define TIMEOUT_MS 100
+
+static int sem_id;
+
+static long elapsed_ms(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000 +
+	       (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static int sem_add(short op, const struct timespec *timeout)
+{
+	struct sembuf buf = { .sem_num = 0, .sem_op = op, .sem_flg = 0 };
+
+	return semtimedop(sem_id, &buf, 1, timeout);
+}
+
+static void wait_for_ncnt(int ncnt)
+{
+	while (semctl(sem_id, 0, GETNCNT) != ncnt)
+		usleep(1000);
+}
+
+FN_SETUP(init)
+{
+	sem_id = CHECK(semget(IPC_PRIVATE, 1, IPC_CREAT | 0600));
+}
+END_SETUP()
+
+FN_TEST(timeout)
+{
+	struct timespec timeout = { .tv_sec = 0,
+				    .tv_nsec = TIMEOUT_MS * 1000000 };
+	struct timespec start;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	TEST_ERRNO(sem_add(-1, &timeout), EAGAIN);
+	TEST_RES(elapsed_ms(&start), _ret >= TIMEOUT_MS);
+	TEST_RES(semctl(sem_id, 0, GETNCNT), _ret == 0);
+
+	// The timed-out operation must not linger and consume later posts.
+	TEST_SUCC(sem_add(1, NULL));
+	TEST_SUCC(sem_add(-1, &timeout));
+	TEST_RES(semctl(sem_id, 0, GETVAL), _ret == 0);
+}
+END_TEST()
+
+static void *wait_forever(void *arg)
+{
+	return (void *)(long)sem_add(-1, NULL);
+}
+
+static void *wait_with_timeout(void *arg)
+{
+	struct timespec timeout = { .tv_sec = 0,
+				    .tv_nsec = TIMEOUT_MS * 1000000 };
+
+	if (sem_add(-1, &timeout) == 0 || errno != EAGAIN)
+		return (void *)-1L;
+	return NULL;
+}
+
+FN_TEST(two_threads_wait)
+{
+	pthread_t waiter, timed_waiter;
+	void *ret;
+
+	// Both threads wait on the same semaphore. When one of them times out,
+	// only its own operation should be removed.
+	TEST_RES(pthread_create(&waiter, NULL, wait_forever, NULL), _ret == 0);
+	wait_for_ncnt(1);
+	TEST_RES(pthread_create(&timed_waiter, NULL, wait_with_timeout, NULL),
+		 _ret == 0);
+	wait_for_ncnt(2);
+
+	TEST_RES(pthread_join(timed_waiter, &ret), _ret == 0);
+	TEST_RES((long)ret, _ret == 0);
+	TEST_RES(semctl(sem_id, 0, GETNCNT), _ret == 1);
+
+	TEST_SUCC(sem_add(1, NULL));
+	TEST_RES(pthread_join(waiter, &ret), _ret == 0);
+	TEST_RES((long)ret, _ret == 0);
+	TEST_RES(semctl(sem_id, 0, GETNCNT), _ret == 0);
+	TEST_RES(semctl(sem_id, 0, GETVAL), _ret == 0);
+}
+END_TEST()
+
+FN_SETUP(cleanup)
+{
+	CHECK(semctl(sem_id, 0, IPC_RMID));
+}
+END_SETUP()
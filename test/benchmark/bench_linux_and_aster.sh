@@ -18,6 +18,7 @@ fi
 # Set up paths
 BENCHMARK_ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")" &>/dev/null && pwd)"
 source "${BENCHMARK_ROOT}/common/prepare_host.sh"
+source "${BENCHMARK_ROOT}/common/result_file.sh"
 RESULT_TEMPLATE="${BENCHMARK_ROOT}/result_template.json"
 
 # Parse benchmark results
@@ -62,23 +63,6 @@ generate_template() {
     ]' > "${RESULT_TEMPLATE}"
 }
 
-# Extract the result file path based on benchmark location
-extract_result_file() {
-    local bench_result="$1"
-    local relative_path="${bench_result#*/benchmark/}"
-    local first_dir="${relative_path%%/*}"
-    local filename=$(basename "$bench_result")
-
-    # Handle different naming conventions for result files
-    if [[ "$filename" == bench_* ]]; then
-        local second_part=$(dirname "$bench_result" | awk -F"/benchmark/$first_dir/" '{print $2}' | cut -d'/' -f1)
-        echo "result_${first_dir}-${second_part}.json"
-    else
-        local result_file="result_${relative_path//\//-}"
-        echo "${result_file/.yaml/.json}"
-    fi
-}
-
 # Run the specified benchmark with runtime configurations
 run_benchmark() {
     local benchmark="$1"
@@ -117,6 +101,11 @@ run_benchmark() {
          esac
      done <<< "$runtime_configs_str"
 
+    # The regression harness sweeps the SMP count of any benchmark job
+    if [[ -n "${BENCH_SMP}" ]]; then
+        smp_val="${BENCH_SMP}"
+    fi
+
     # Prepare commands for Asterinas and Linux using arrays
     local asterinas_cmd_arr=(make run "BENCHMARK=${benchmark}")
     # Add scheme part only if it's not empty and the platform is not TDX (OSDK doesn't support multiple SCHEME)
@@ -208,7 +197,7 @@ parse_results() {
     local legend=$(yq -r '.chart.legend // {system}' "$bench_result")
 
     generate_template "$unit" "$legend"
-    parse_raw_results "$search_pattern" "$nth_occurrence" "$result_index" "$(extract_result_file "$bench_result")"
+    parse_raw_results "$search_pattern" "$nth_occurrence" "$result_index" "${BENCH_RESULT_DIR:-.}/$(extract_result_file "$bench_result")"
 }
 
 # Clean up temporary files
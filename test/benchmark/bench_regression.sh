@@ -0,0 +1,230 @@
+#!/bin/bash
+
+# SPDX-License-Identifier: MPL-2.0
+
+# Run benchmark jobs repeatedly, summarize the results statistically, and
+# check them for regressions against the previous results and native Linux.
+
+set -e
+set -o pipefail
+
+BENCHMARK_ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")" &>/dev/null && pwd)"
+source "${BENCHMARK_ROOT}/common/result_file.sh"
+
+# Default options
+RUNS=5
+WARMUP=1
+SMP_LIST=""
+THRESHOLD=""
+PLATFORM="x86"
+HISTORY_FILE="${BENCHMARK_ROOT}/bench_history.jsonl"
+
+# The statistics of an array of results.
+#
+# `p99` is the 99th percentile in the worse direction, i.e., the low end of
+# the results if bigger is better. `ci95` is the 95% confidence interval of
+# the mean, based on Student's t-distribution.
+STATS_JQ='
+def t_value($df):
+    [12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+     2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+     2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042][$df - 1] // 1.960;
+def stats($bigger):
+    sort as $s | length as $n
+    | ($s | add / $n) as $mean
+    | (if $n > 1 then $s | map((. - $mean) * (. - $mean)) | add / ($n - 1) | sqrt else 0 end) as $sd
+    | (if $n > 1 then t_value($n - 1) * $sd / ($n | sqrt) else 0 end) as $half
+    | {
+        runs: $n,
+        median: (if $n % 2 == 1 then $s[($n - 1) / 2] else ($s[$n / 2 - 1] + $s[$n / 2]) / 2 end),
+        p99: (if $bigger then $s[$n - (0.99 * $n | ceil)] else $s[(0.99 * $n | ceil) - 1] end),
+        mean: $mean,
+        stddev: $sd,
+        ci95: [$mean - $half, $mean + $half]
+      };
+def is_worse($a; $b; $bigger; $threshold):
+    if $bigger then $a * $threshold < $b else $a > $b * $threshold end;
+def is_disjoint($x; $y):
+    $x.ci95[1] < $y.ci95[0] or $y.ci95[1] < $x.ci95[0];
+'
+
+print_help() {
+    echo "Usage: $0 [options] <bench_suite>/<bench_job>..."
+    echo "  -n <runs>       The number of measured runs (default: ${RUNS})."
+    echo "  -w <runs>       The number of warmup runs, whose results are discarded (default: ${WARMUP})."
+    echo "  -s <smp,...>    The SMP counts to sweep (default: the job's own configuration)."
+    echo "  -t <threshold>  The regression threshold, e.g., 110% (default: the job's alert threshold)."
+    echo "  -p <platform>   The platform passed to bench_linux_and_aster.sh (default: ${PLATFORM})."
+    echo "  -H <file>       The history file of the results (default: ${HISTORY_FILE})."
+}
+
+# Convert a threshold like "130%" to a ratio like 1.3
+threshold_ratio() {
+    local threshold="${1%\%}"
+    awk -v threshold="$threshold" 'BEGIN { print threshold / 100 }'
+}
+
+# Find the SMP count that a job runs with if it is not swept
+default_smp() {
+    local job_dir="$1"
+    local config smp
+
+    while read -r config; do
+        smp=$(yq -r '.runtime_config.smp // empty' "$config")
+        if [[ -n "$smp" ]]; then
+            echo "$smp"
+            return
+        fi
+    done < <(list_result_configs "$job_dir")
+    echo 1
+}
+
+# Summarize the runs of a result, compare it with the baseline, and record it
+summarize_result() {
+    local job="$1"
+    local smp="$2"
+    local config="$3"
+    local work_dir="$4"
+
+    local result_file=$(extract_result_file "$config")
+    local unit=$(yq -r '.chart.unit // empty' "$config")
+    local bigger=$(yq -r '.alert.bigger_is_better != false' "$config")
+    local threshold="${THRESHOLD:-$(yq -r '.alert.threshold // "110%"' "$config")}"
+    threshold=$(threshold_ratio "$threshold")
+
+    local aster_values linux_values
+    aster_values=$(jq -s '[.[][] | select(.extra == "aster_result") | .value | tonumber]' \
+        "${work_dir}"/run_*/"${result_file}")
+    linux_values=$(jq -s '[.[][] | select(.extra == "linux_result") | .value | tonumber]' \
+        "${work_dir}"/run_*/"${result_file}")
+
+    local record
+    record=$(jq -n -c "${STATS_JQ}"'{
+            time: $time,
+            commit: $commit,
+            platform: $platform,
+            benchmark: $benchmark,
+            result: $result,
+            smp: $smp,
+            unit: $unit,
+            bigger_is_better: $bigger,
+            aster: ($aster | stats($bigger)),
+            linux: ($linux | stats($bigger))
+        }' \
+        --arg time "$(date -u +%Y-%m-%dT%H:%M:%SZ)" \
+        --arg commit "$(git -C "${BENCHMARK_ROOT}" rev-parse --short HEAD 2>/dev/null || echo unknown)" \
+        --arg platform "$PLATFORM" \
+        --arg benchmark "$job" \
+        --arg result "$(basename "${result_file#result_}" .json)" \
+        --argjson smp "$smp" \
+        --arg unit "$unit" \
+        --argjson bigger "$bigger" \
+        --argjson aster "$aster_values" \
+        --argjson linux "$linux_values")
+
+    # The baseline is the last result of the same benchmark in the history
+    local baseline="null"
+    if [[ -f "${HISTORY_FILE}" ]]; then
+        baseline=$(jq -c --argjson current "$record" \
+            'select(.platform == $current.platform and .result == $current.result
+                    and .smp == $current.smp)' "${HISTORY_FILE}" | tail -n 1)
+        baseline="${baseline:-null}"
+    fi
+
+    # A regression is a change beyond the threshold that is also statistically significant
+    local verdict
+    verdict=$(jq -n -r "${STATS_JQ}"'
+        $current as $c | $c.bigger_is_better as $bigger
+        | [
+            (if $baseline != null
+                and is_worse($c.aster.median; $baseline.aster.median; $bigger; $threshold)
+                and is_disjoint($c.aster; $baseline.aster)
+             then "REGRESSION(baseline=\($baseline.aster.median)@\($baseline.commit))" else empty end),
+            (if is_worse($c.aster.median; $c.linux.median; $bigger; $threshold)
+             then "BEHIND_LINUX" else empty end)
+          ]
+        | join(" ")' \
+        --argjson current "$record" \
+        --argjson baseline "$baseline" \
+        --argjson threshold "$threshold")
+
+    echo "$record" >> "${HISTORY_FILE}"
+    jq -r --arg verdict "$verdict" \
+        '"\(.result) smp=\(.smp): Asterinas \(.aster.median) (p99 \(.aster.p99), ci95 \(.aster.ci95 | map(. * 1000 | round / 1000))) vs Linux \(.linux.median) \(.unit) \($verdict)"' \
+        <<< "$record" | tee -a "${SUMMARY_FILE}"
+
+    [[ "$verdict" != *REGRESSION* ]]
+}
+
+# Run a benchmark job with an SMP count repeatedly
+run_job() {
+    local job="$1"
+    local smp="$2"
+    local work_dir
+    work_dir=$(mktemp -d)
+
+    local i
+    for ((i = 1; i <= WARMUP + RUNS; i++)); do
+        local run_dir="${work_dir}/run_${i}"
+        if ((i <= WARMUP)); then
+            run_dir="${work_dir}/warmup_${i}"
+            echo "Warming up ${job} with SMP=${smp} (${i}/${WARMUP})..."
+        else
+            echo "Running ${job} with SMP=${smp} ($((i - WARMUP))/${RUNS})..."
+        fi
+        mkdir -p "${run_dir}"
+        BENCH_SMP="${smp}" BENCH_RESULT_DIR="${run_dir}" \
+            bash "${BENCHMARK_ROOT}/bench_linux_and_aster.sh" "${job}" "${PLATFORM}"
+    done
+
+    local status=0
+    local config
+    while read -r config; do
+        summarize_result "$job" "$smp" "$config" "$work_dir" || status=1
+    done < <(list_result_configs "${BENCHMARK_ROOT}/${job}")
+
+    rm -rf "${work_dir}"
+    return $status
+}
+
+main() {
+    local opt
+    while getopts "n:w:s:t:p:H:h" opt; do
+        case "$opt" in
+            n) RUNS="$OPTARG" ;;
+            w) WARMUP="$OPTARG" ;;
+            s) SMP_LIST="${OPTARG//,/ }" ;;
+            t) THRESHOLD="$OPTARG" ;;
+            p) PLATFORM="$OPTARG" ;;
+            H) HISTORY_FILE="$OPTARG" ;;
+            h) print_help; exit 0 ;;
+            *) print_help; exit 1 ;;
+        esac
+    done
+    shift $((OPTIND - 1))
+
+    if [[ $# -eq 0 ]] || ((RUNS < 1)); then
+        print_help
+        exit 1
+    fi
+
+    SUMMARY_FILE=$(mktemp)
+    local status=0
+    local job smp
+    for job in "$@"; do
+        if [[ ! -d "${BENCHMARK_ROOT}/${job}" ]]; then
+            echo "Error: benchmark job '${job}' does not exist" >&2
+            exit 1
+        fi
+        for smp in ${SMP_LIST:-$(default_smp "${BENCHMARK_ROOT}/${job}")}; do
+            run_job "$job" "$smp" || status=1
+        done
+    done
+
+    echo "Summary (${RUNS} runs, ${WARMUP} warmup runs, history in ${HISTORY_FILE}):"
+    cat "${SUMMARY_FILE}"
+    rm -f "${SUMMARY_FILE}"
+    exit $status
+}
+
+main "$@"
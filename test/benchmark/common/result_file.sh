@@ -0,0 +1,34 @@
+#!/bin/bash
+
+# SPDX-License-Identifier: MPL-2.0
+
+# Extract the result file path based on benchmark location
+extract_result_file() {
+    local bench_result="$1"
+    local relative_path="${bench_result#*/benchmark/}"
+    local first_dir="${relative_path%%/*}"
+    local filename=$(basename "$bench_result")
+
+    # Handle different naming conventions for result files
+    if [[ "$filename" == bench_* ]]; then
+        local second_part=$(dirname "$bench_result" | awk -F"/benchmark/$first_dir/" '{print $2}' | cut -d'/' -f1)
+        echo "result_${first_dir}-${second_part}.json"
+    else
+        local result_file="result_${relative_path//\//-}"
+        echo "${result_file/.yaml/.json}"
+    fi
+}
+
+# List the result configuration files of a benchmark job
+list_result_configs() {
+    local job_dir="$1"
+
+    if [[ -f "${job_dir}/bench_result.yaml" ]]; then
+        echo "${job_dir}/bench_result.yaml"
+        return
+    fi
+    for job_yaml in "${job_dir}"/bench_results/*; do
+        [[ -f "$job_yaml" ]] && echo "$job_yaml"
+    done
+    return 0
+}